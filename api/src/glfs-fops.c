@@ -263,7 +263,8 @@ glfs_creat (struct glfs *fs, const char *path, int flags, mode_t mode)
 		goto out;
 	}
 
-	ret = syncop_create (subvol, &loc, flags, mode, glfd->fd, xattr_req);
+	ret = syncop_create (subvol, &loc, flags, mode, glfd->fd, xattr_req,
+			     &iatt);
 out:
 	loc_wipe (&loc);
 
@@ -717,6 +718,230 @@ glfs_writev_async (struct glfs_fd *glfd, const struct iovec *iov, int count,
 }
 
 
+///// zero-copy /////
+
+void
+glfs_buf_release (struct glfs_buf *buf)
+{
+	if (!buf)
+		return;
+
+	if (buf->iobref)
+		iobref_unref (buf->iobref);
+
+	GF_FREE (buf->iov);
+	GF_FREE (buf);
+}
+
+
+int
+glfs_buf_iovec (struct glfs_buf *buf, const struct iovec **iov, int *iovcnt)
+{
+	if (!buf || !iov || !iovcnt) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*iov = buf->iov;
+	*iovcnt = buf->count;
+
+	return 0;
+}
+
+
+static struct glfs_buf *
+glfs_buf_from_iobuf (struct iobuf *iobuf, size_t size)
+{
+	struct glfs_buf *buf = NULL;
+	int              ret = -1;
+
+	buf = GF_CALLOC (1, sizeof (*buf), glfs_mt_glfs_buf_t);
+	if (!buf)
+		goto out;
+
+	buf->iov = GF_CALLOC (1, sizeof (*buf->iov), gf_common_mt_iovec);
+	if (!buf->iov)
+		goto out;
+
+	buf->iobref = iobref_new ();
+	if (!buf->iobref)
+		goto out;
+
+	ret = iobref_add (buf->iobref, iobuf);
+	if (ret)
+		goto out;
+
+	buf->iov[0].iov_base = iobuf_ptr (iobuf);
+	buf->iov[0].iov_len = size;
+	buf->count = 1;
+out:
+	/* the iobref (if any) holds its own ref now */
+	iobuf_unref (iobuf);
+
+	if (ret) {
+		glfs_buf_release (buf);
+		buf = NULL;
+		errno = ENOMEM;
+	}
+
+	return buf;
+}
+
+
+struct glfs_buf *
+glfs_buf_alloc (struct glfs *fs, size_t size, void **ptr)
+{
+	struct iobuf    *iobuf = NULL;
+	struct glfs_buf *buf = NULL;
+
+	__glfs_entry_fs (fs);
+
+	iobuf = iobuf_get2 (fs->ctx->iobuf_pool, size);
+	if (!iobuf) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	buf = glfs_buf_from_iobuf (iobuf, size);
+	if (buf && ptr)
+		*ptr = buf->iov[0].iov_base;
+
+	return buf;
+}
+
+
+struct glfs_buf *
+glfs_buf_register (struct glfs *fs, void *ptr, size_t size,
+		   glfs_buf_release_cbk fn, void *data)
+{
+	struct iobuf    *iobuf = NULL;
+
+	__glfs_entry_fs (fs);
+
+	if (!ptr || !size) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	iobuf = iobuf_get_external (fs->ctx->iobuf_pool, ptr, size, fn, data);
+	if (!iobuf) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return glfs_buf_from_iobuf (iobuf, size);
+}
+
+
+ssize_t
+glfs_pread_zc (struct glfs_fd *glfd, size_t count, off_t offset, int flags,
+	       struct glfs_buf **bufp)
+{
+	xlator_t        *subvol = NULL;
+	int              ret = -1;
+	struct iovec    *iov = NULL;
+	int              cnt = 0;
+	struct iobref   *iobref = NULL;
+	struct glfs_buf *buf = NULL;
+
+	__glfs_entry_fd (glfd);
+
+	if (!bufp) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	*bufp = NULL;
+
+	subvol = glfs_fd_subvol (glfd);
+
+	ret = syncop_readv (subvol, glfd->fd, count, offset,
+			    0, &iov, &cnt, &iobref);
+	if (ret <= 0)
+		goto out;
+
+	buf = GF_CALLOC (1, sizeof (*buf), glfs_mt_glfs_buf_t);
+	if (!buf) {
+		errno = ENOMEM;
+		ret = -1;
+		goto out;
+	}
+
+	/* hand over the reply vector and the refs on the
+	   iobufs backing it, no copying */
+	buf->iov = iov;
+	buf->count = cnt;
+	buf->iobref = iobref;
+	iov = NULL;
+	iobref = NULL;
+
+	glfd->offset = (offset + ret);
+
+	*bufp = buf;
+out:
+	if (iov)
+		GF_FREE (iov);
+	if (iobref)
+		iobref_unref (iobref);
+
+	return ret;
+}
+
+
+ssize_t
+glfs_read_zc (struct glfs_fd *glfd, size_t count, int flags,
+	      struct glfs_buf **bufp)
+{
+	return glfs_pread_zc (glfd, count, glfd->offset, flags, bufp);
+}
+
+
+ssize_t
+glfs_pwritev_zc (struct glfs_fd *glfd, struct glfs_buf *buf,
+		 const struct iovec *iovec, int iovcnt, off_t offset,
+		 int flags)
+{
+	xlator_t       *subvol = NULL;
+	int             ret = -1;
+	size_t          size = 0;
+
+	__glfs_entry_fd (glfd);
+
+	if (!buf) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* default to the whole buffer */
+	if (!iovec) {
+		iovec = buf->iov;
+		iovcnt = buf->count;
+	}
+
+	subvol = glfs_fd_subvol (glfd);
+
+	size = iov_length (iovec, iovcnt);
+
+	/* the iobref keeps the (possibly application owned) memory
+	   alive for as long as any translator holds on to it */
+	ret = syncop_writev (subvol, glfd->fd, iovec, iovcnt, offset,
+			     buf->iobref, flags);
+	if (ret <= 0)
+		return ret;
+
+	glfd->offset = (offset + size);
+
+	return ret;
+}
+
+
+ssize_t
+glfs_write_zc (struct glfs_fd *glfd, struct glfs_buf *buf, int flags)
+{
+	return glfs_pwritev_zc (glfd, buf, NULL, 0, glfd->offset, flags);
+}
+
+
 int
 glfs_fsync (struct glfs_fd *glfd)
 {
@@ -1125,7 +1350,7 @@ glfs_mkdir (struct glfs *fs, const char *path, mode_t mode)
 		goto out;
 	}
 
-	ret = syncop_mkdir (subvol, &loc, mode, xattr_req);
+	ret = syncop_mkdir (subvol, &loc, mode, xattr_req, &iatt);
 out:
 	loc_wipe (&loc);
 
@@ -1420,6 +1645,39 @@ gf_dirent_to_dirent (gf_dirent_t *gf_dirent, struct dirent *dirent)
 }
 
 
+static void
+glfd_entries_link (struct glfs_fd *glfd, gf_dirent_t *entries)
+{
+	gf_dirent_t     *entry = NULL;
+	inode_t         *linked_inode = NULL;
+
+	list_for_each_entry (entry, &entries->list, list) {
+		if (!entry->inode)
+			continue;
+
+		if (uuid_is_null (entry->d_stat.ia_gfid)) {
+			/* not linkable, do not trust the attributes either */
+			inode_unref (entry->inode);
+			entry->inode = NULL;
+			continue;
+		}
+
+		linked_inode = inode_link (entry->inode, glfd->fd->inode,
+					   entry->d_name, &entry->d_stat);
+		if (!linked_inode) {
+			inode_unref (entry->inode);
+			entry->inode = NULL;
+			continue;
+		}
+
+		inode_lookup (linked_inode);
+
+		inode_unref (entry->inode);
+		entry->inode = linked_inode;
+	}
+}
+
+
 int
 glfd_entry_refresh (struct glfs_fd *glfd)
 {
@@ -1437,9 +1695,16 @@ glfd_entry_refresh (struct glfs_fd *glfd)
 	INIT_LIST_HEAD (&entries.list);
 	INIT_LIST_HEAD (&old.list);
 
-	ret = syncop_readdir (subvol, glfd->fd, 131072, glfd->offset,
-			      &entries);
+	if (glfd->readdirplus)
+		ret = syncop_readdirp (subvol, glfd->fd, 131072, glfd->offset,
+				       NULL, &entries);
+	else
+		ret = syncop_readdir (subvol, glfd->fd, 131072, glfd->offset,
+				      &entries);
 	if (ret >= 0) {
+		if (glfd->readdirplus)
+			glfd_entries_link (glfd, &entries);
+
 		/* spurious errno is dangerous for glfd_entry_next() */
 		errno = 0;
 
@@ -1516,6 +1781,286 @@ out:
 }
 
 
+static int
+glfd_entry_stat (struct glfs_fd *glfd, gf_dirent_t *entry, struct stat *stat)
+{
+	xlator_t        *subvol = NULL;
+	loc_t            loc = {0, };
+	struct iatt      iatt = {0, };
+	int              ret = -1;
+
+	if (entry->inode) {
+		iatt_to_stat (&entry->d_stat, stat);
+		return 0;
+	}
+
+	/* entry was fetched by a plain readdir (e.g. glfs_readdir_r()
+	   was used on this fd earlier), look it up the slow way */
+	subvol = glfs_fd_subvol (glfd);
+	if (!subvol) {
+		errno = EIO;
+		return -1;
+	}
+
+	ret = glfs_resolve_at (glfs_from_glfd (glfd), subvol,
+			       glfd->fd->inode, entry->d_name, &loc,
+			       &iatt, 0);
+	if (ret == 0)
+		iatt_to_stat (&iatt, stat);
+
+	loc_wipe (&loc);
+
+	return ret;
+}
+
+
+int
+glfs_readdirplus_r (struct glfs_fd *glfd, struct stat *stat,
+		    struct dirent *buf, struct dirent **res)
+{
+	int              ret = 0;
+	gf_dirent_t     *entry = NULL;
+
+	__glfs_entry_fd (glfd);
+
+	if (glfd->fd->inode->ia_type != IA_IFDIR) {
+		ret = -1;
+		errno = EBADF;
+		goto out;
+	}
+
+	/* from now on fetch attributes along with the names */
+	glfd->readdirplus = 1;
+
+	errno = 0;
+	entry = glfd_entry_next (glfd);
+	if (errno)
+		ret = -1;
+
+	if (res) {
+		if (entry)
+			*res = buf;
+		else
+			*res = NULL;
+	}
+
+	if (entry) {
+		gf_dirent_to_dirent (entry, buf);
+		if (stat)
+			ret = glfd_entry_stat (glfd, entry, stat);
+	}
+out:
+	return ret;
+}
+
+
+struct glfs_lookup_batch {
+	pthread_mutex_t     mutex;
+	pthread_cond_t      cond;
+	int                 pending;
+};
+
+
+struct glfs_lookup_local {
+	struct glfs_lookup_batch *batch;
+	loc_t                     loc;
+	dict_t                   *xattr_req;
+	uuid_t                    gfid;
+	struct iatt               iatt;
+	int                       op_ret;
+	int                       op_errno;
+};
+
+
+static int
+glfs_lookup_multi_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+		       int32_t op_ret, int32_t op_errno, inode_t *inode,
+		       struct iatt *buf, dict_t *xdata, struct iatt *postparent)
+{
+	struct glfs_lookup_local *local = NULL;
+	struct glfs_lookup_batch *batch = NULL;
+	inode_t                  *linked_inode = NULL;
+
+	local = cookie;
+	batch = local->batch;
+
+	local->op_ret = op_ret;
+	local->op_errno = op_errno;
+
+	if (op_ret == 0) {
+		local->iatt = *buf;
+
+		linked_inode = inode_link (local->loc.inode, local->loc.parent,
+					   local->loc.name, buf);
+		if (linked_inode) {
+			inode_lookup (linked_inode);
+			inode_unref (linked_inode);
+		}
+	}
+
+	STACK_DESTROY (frame->root);
+
+	pthread_mutex_lock (&batch->mutex);
+	{
+		if (--batch->pending == 0)
+			pthread_cond_signal (&batch->cond);
+	}
+	pthread_mutex_unlock (&batch->mutex);
+
+	return 0;
+}
+
+
+static int
+glfs_lookup_local_init (struct glfs_lookup_local *local, inode_t *parent,
+			const char *name)
+{
+	int ret = -1;
+
+	local->loc.name = name;
+	local->loc.parent = inode_ref (parent);
+	uuid_copy (local->loc.pargfid, parent->gfid);
+
+	local->loc.inode = inode_grep (parent->table, parent, name);
+	if (local->loc.inode) {
+		uuid_copy (local->loc.gfid, local->loc.inode->gfid);
+	} else {
+		local->loc.inode = inode_new (parent->table);
+		if (!local->loc.inode)
+			goto out;
+
+		local->xattr_req = dict_new ();
+		if (!local->xattr_req)
+			goto out;
+
+		uuid_generate (local->gfid);
+		ret = dict_set_static_bin (local->xattr_req, "gfid-req",
+					   local->gfid, 16);
+		if (ret)
+			goto out;
+	}
+
+	ret = glfs_loc_touchup (&local->loc);
+out:
+	if (ret)
+		errno = ENOMEM;
+	return ret;
+}
+
+
+int
+glfs_lstat_multi (struct glfs *fs, const char *path, const char *names[],
+		  int count, struct stat *stats, int *errnos)
+{
+	int                        ret = -1;
+	int                        i = 0;
+	int                        found = 0;
+	xlator_t                  *subvol = NULL;
+	loc_t                      loc = {0, };
+	struct iatt                iatt = {0, };
+	struct glfs_lookup_local  *locals = NULL;
+	struct glfs_lookup_batch   batch;
+	call_frame_t              *frame = NULL;
+
+	__glfs_entry_fs (fs);
+
+	if (count < 0 || (count && (!names || !stats || !errnos))) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		ret = -1;
+		errno = EIO;
+		goto out;
+	}
+
+	/* the directory is resolved only once for all the names */
+	ret = glfs_resolve (fs, subvol, path, &loc, &iatt);
+	if (ret)
+		goto out;
+
+	if (!IA_ISDIR (iatt.ia_type)) {
+		ret = -1;
+		errno = ENOTDIR;
+		goto out;
+	}
+
+	locals = GF_CALLOC (count ? count : 1, sizeof (*locals),
+			    glfs_mt_glfs_lookup_t);
+	if (!locals) {
+		ret = -1;
+		errno = ENOMEM;
+		goto out;
+	}
+
+	pthread_mutex_init (&batch.mutex, NULL);
+	pthread_cond_init (&batch.cond, NULL);
+	batch.pending = 0;
+
+	for (i = 0; i < count; i++) {
+		locals[i].batch = &batch;
+		locals[i].op_ret = -1;
+		locals[i].op_errno = ENOMEM;
+
+		if (!names[i] || !names[i][0] || strchr (names[i], '/')) {
+			locals[i].op_errno = EINVAL;
+			continue;
+		}
+
+		if (glfs_lookup_local_init (&locals[i], loc.inode, names[i]))
+			continue;
+		frame = create_frame (THIS, THIS->ctx->pool);
+		if (!frame)
+			continue;
+
+		pthread_mutex_lock (&batch.mutex);
+		{
+			batch.pending++;
+		}
+		pthread_mutex_unlock (&batch.mutex);
+
+		/* all lookups are in flight together, the whole batch
+		   costs about one round trip */
+		STACK_WIND_COOKIE (frame, glfs_lookup_multi_cbk, &locals[i],
+				   subvol, subvol->fops->lookup,
+				   &locals[i].loc, locals[i].xattr_req);
+	}
+
+	pthread_mutex_lock (&batch.mutex);
+	{
+		while (batch.pending)
+			pthread_cond_wait (&batch.cond, &batch.mutex);
+	}
+	pthread_mutex_unlock (&batch.mutex);
+
+	pthread_mutex_destroy (&batch.mutex);
+	pthread_cond_destroy (&batch.cond);
+
+	for (i = 0; i < count; i++) {
+		if (locals[i].op_ret == 0) {
+			iatt_to_stat (&locals[i].iatt, &stats[i]);
+			errnos[i] = 0;
+			found++;
+		} else {
+			errnos[i] = locals[i].op_errno;
+		}
+
+		loc_wipe (&locals[i].loc);
+		if (locals[i].xattr_req)
+			dict_unref (locals[i].xattr_req);
+	}
+
+	ret = found;
+out:
+	loc_wipe (&loc);
+	GF_FREE (locals);
+
+	return ret;
+}
+
+
 int
 glfs_statvfs (struct glfs *fs, const char *path, struct statvfs *buf)
 {
@@ -0,0 +1,631 @@
+/*
+  Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+
+#include "glfs-internal.h"
+#include "glfs-mem-types.h"
+#include "syncop.h"
+#include "glfs.h"
+#include "glfs-handles.h"
+
+
+static int
+glfs_loc_from_inode (inode_t *inode, loc_t *loc)
+{
+	char *path = NULL;
+	int   ret = -1;
+
+	loc->inode = inode_ref (inode);
+	uuid_copy (loc->gfid, inode->gfid);
+
+	/* for an inode known only by gfid this is "<gfid:...>" */
+	ret = inode_path (inode, NULL, &path);
+	loc->path = path;
+	if (ret < 0 || !path) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+static inode_t *
+glfs_h_lookup_gfid (struct glfs *fs, xlator_t *subvol, uuid_t gfid,
+		    struct iatt *iatt)
+{
+	loc_t        loc = {0, };
+	inode_t     *inode = NULL;
+	struct iatt  ciatt = {0, };
+	char        *path = NULL;
+	int          ret = -1;
+
+	loc.inode = inode_new (subvol->itable);
+	if (!loc.inode) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	uuid_copy (loc.gfid, gfid);
+
+	ret = gf_asprintf (&path, INODE_PATH_FMT, uuid_utoa (gfid));
+	if (ret < 0) {
+		errno = ENOMEM;
+		goto out;
+	}
+	loc.path = path;
+
+	/* nameless lookup, no path walk */
+	ret = syncop_lookup (subvol, &loc, NULL, &ciatt, NULL, NULL);
+	if (ret)
+		goto out;
+
+	inode = inode_link (loc.inode, NULL, NULL, &ciatt);
+	if (!inode) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	inode_lookup (inode);
+
+	if (iatt)
+		*iatt = ciatt;
+out:
+	loc_wipe (&loc);
+
+	return inode;
+}
+
+
+/* The object might have been obtained on a graph which is no longer the
+   active one, in which case its inode is looked up afresh (by gfid) in the
+   inode table of @subvol.
+*/
+static inode_t *
+glfs_h_resolve_inode (struct glfs *fs, xlator_t *subvol,
+		      struct glfs_object *object)
+{
+	inode_t *inode = NULL;
+
+	if (object->inode && object->inode->table->xl == subvol)
+		return inode_ref (object->inode);
+
+	inode = inode_find (subvol->itable, object->gfid);
+	if (!inode)
+		inode = glfs_h_lookup_gfid (fs, subvol, object->gfid, NULL);
+	if (!inode)
+		return NULL;
+
+	/* remember it for the next time */
+	if (object->inode)
+		inode_unref (object->inode);
+	object->inode = inode_ref (inode);
+
+	return inode;
+}
+
+
+static struct glfs_object *
+glfs_h_object_new (inode_t *inode)
+{
+	struct glfs_object *object = NULL;
+
+	object = GF_CALLOC (1, sizeof (*object), glfs_mt_glfs_object_t);
+	if (!object) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	object->inode = inode_ref (inode);
+	uuid_copy (object->gfid, inode->gfid);
+
+	return object;
+}
+
+
+struct glfs_object *
+glfs_h_lookupat (struct glfs *fs, struct glfs_object *parent,
+		 const char *path, struct stat *stat)
+{
+	int                 ret = -1;
+	xlator_t           *subvol = NULL;
+	inode_t            *inode = NULL;
+	loc_t               loc = {0, };
+	struct iatt         iatt = {0, };
+	struct glfs_object *object = NULL;
+
+	__glfs_entry_fs (fs);
+
+	if (!path) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		errno = EIO;
+		goto out;
+	}
+
+	if (parent) {
+		inode = glfs_h_resolve_inode (fs, subvol, parent);
+		if (!inode) {
+			errno = ESTALE;
+			goto out;
+		}
+	}
+
+	ret = glfs_resolve_at (fs, subvol, inode, path, &loc, &iatt, 0);
+	if (ret)
+		goto out;
+
+	object = glfs_h_object_new (loc.inode);
+	if (object && stat)
+		iatt_to_stat (&iatt, stat);
+out:
+	loc_wipe (&loc);
+
+	if (inode)
+		inode_unref (inode);
+
+	return object;
+}
+
+
+int
+glfs_h_stat (struct glfs *fs, struct glfs_object *object, struct stat *stat)
+{
+	int              ret = -1;
+	xlator_t        *subvol = NULL;
+	inode_t         *inode = NULL;
+	loc_t            loc = {0, };
+	struct iatt      iatt = {0, };
+
+	__glfs_entry_fs (fs);
+
+	if (!object) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		ret = -1;
+		errno = EIO;
+		goto out;
+	}
+
+	inode = glfs_h_resolve_inode (fs, subvol, object);
+	if (!inode) {
+		ret = -1;
+		errno = ESTALE;
+		goto out;
+	}
+
+	ret = glfs_loc_from_inode (inode, &loc);
+	if (ret)
+		goto out;
+
+	ret = syncop_stat (subvol, &loc, &iatt);
+
+	if (ret == 0 && stat)
+		iatt_to_stat (&iatt, stat);
+out:
+	loc_wipe (&loc);
+
+	if (inode)
+		inode_unref (inode);
+
+	return ret;
+}
+
+
+/* Common to creat and mkdir: fill @loc for @name under @parent, with a
+   fresh inode, and @xattr_req with the gfid to be used for it.
+*/
+static int
+glfs_h_entry_prepare (struct glfs *fs, xlator_t *subvol,
+		      struct glfs_object *parent, const char *name,
+		      loc_t *loc, dict_t **xattr_req, uuid_t gfid)
+{
+	int      ret = -1;
+	inode_t *pinode = NULL;
+
+	if (!parent || !name || !name[0] || strchr (name, '/')) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	pinode = glfs_h_resolve_inode (fs, subvol, parent);
+	if (!pinode) {
+		errno = ESTALE;
+		return -1;
+	}
+
+	*xattr_req = dict_new ();
+	if (!*xattr_req) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	uuid_generate (gfid);
+	ret = dict_set_static_bin (*xattr_req, "gfid-req", gfid, 16);
+	if (ret) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	loc->parent = inode_ref (pinode);
+	uuid_copy (loc->pargfid, pinode->gfid);
+	loc->name = name;
+
+	loc->inode = inode_new (pinode->table);
+	if (!loc->inode) {
+		ret = -1;
+		errno = ENOMEM;
+		goto out;
+	}
+
+	ret = glfs_loc_touchup (loc);
+out:
+	inode_unref (pinode);
+
+	return ret;
+}
+
+
+static struct glfs_object *
+glfs_h_entry_link (loc_t *loc, struct iatt *iatt, struct stat *stat)
+{
+	inode_t            *inode = NULL;
+	struct glfs_object *object = NULL;
+
+	inode = inode_link (loc->inode, loc->parent, loc->name, iatt);
+	if (!inode) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	inode_lookup (inode);
+
+	object = glfs_h_object_new (inode);
+	if (object && stat)
+		iatt_to_stat (iatt, stat);
+
+	inode_unref (inode);
+
+	return object;
+}
+
+
+struct glfs_object *
+glfs_h_creat (struct glfs *fs, struct glfs_object *parent, const char *name,
+	      int flags, mode_t mode, struct stat *stat)
+{
+	int                 ret = -1;
+	xlator_t           *subvol = NULL;
+	loc_t               loc = {0, };
+	struct iatt         iatt = {0, };
+	uuid_t              gfid;
+	dict_t             *xattr_req = NULL;
+	fd_t               *fd = NULL;
+	struct glfs_object *object = NULL;
+
+	__glfs_entry_fs (fs);
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		errno = EIO;
+		goto out;
+	}
+
+	ret = glfs_h_entry_prepare (fs, subvol, parent, name, &loc,
+				    &xattr_req, gfid);
+	if (ret)
+		goto out;
+
+	fd = fd_create (loc.inode, getpid());
+	if (!fd) {
+		errno = ENOMEM;
+		goto out;
+	}
+
+	ret = syncop_create (subvol, &loc, flags, mode, fd, xattr_req, &iatt);
+	if (ret)
+		goto out;
+
+	object = glfs_h_entry_link (&loc, &iatt, stat);
+out:
+	loc_wipe (&loc);
+
+	if (xattr_req)
+		dict_unref (xattr_req);
+
+	if (fd)
+		fd_unref (fd);
+
+	return object;
+}
+
+
+struct glfs_object *
+glfs_h_mkdir (struct glfs *fs, struct glfs_object *parent, const char *name,
+	      mode_t mode, struct stat *stat)
+{
+	int                 ret = -1;
+	xlator_t           *subvol = NULL;
+	loc_t               loc = {0, };
+	struct iatt         iatt = {0, };
+	uuid_t              gfid;
+	dict_t             *xattr_req = NULL;
+	struct glfs_object *object = NULL;
+
+	__glfs_entry_fs (fs);
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		errno = EIO;
+		goto out;
+	}
+
+	ret = glfs_h_entry_prepare (fs, subvol, parent, name, &loc,
+				    &xattr_req, gfid);
+	if (ret)
+		goto out;
+
+	ret = syncop_mkdir (subvol, &loc, mode, xattr_req, &iatt);
+	if (ret)
+		goto out;
+
+	object = glfs_h_entry_link (&loc, &iatt, stat);
+out:
+	loc_wipe (&loc);
+
+	if (xattr_req)
+		dict_unref (xattr_req);
+
+	return object;
+}
+
+
+int
+glfs_h_unlink (struct glfs *fs, struct glfs_object *parent, const char *name)
+{
+	int              ret = -1;
+	xlator_t        *subvol = NULL;
+	inode_t         *pinode = NULL;
+	loc_t            loc = {0, };
+	struct iatt      iatt = {0, };
+
+	__glfs_entry_fs (fs);
+
+	if (!parent || !name || !name[0] || strchr (name, '/')) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		ret = -1;
+		errno = EIO;
+		goto out;
+	}
+
+	pinode = glfs_h_resolve_inode (fs, subvol, parent);
+	if (!pinode) {
+		ret = -1;
+		errno = ESTALE;
+		goto out;
+	}
+
+	/* only @name is looked up, @parent is not walked again */
+	ret = glfs_resolve_at (fs, subvol, pinode, name, &loc, &iatt, 0);
+	if (ret)
+		goto out;
+
+	if (IA_ISDIR (iatt.ia_type))
+		ret = syncop_rmdir (subvol, &loc);
+	else
+		ret = syncop_unlink (subvol, &loc);
+
+	if (ret == 0)
+		inode_unlink (loc.inode, loc.parent, loc.name);
+out:
+	loc_wipe (&loc);
+
+	if (pinode)
+		inode_unref (pinode);
+
+	return ret;
+}
+
+
+static struct glfs_fd *
+glfs_h_open_common (struct glfs *fs, struct glfs_object *object, int flags,
+		    int dir)
+{
+	int              ret = -1;
+	struct glfs_fd  *glfd = NULL;
+	xlator_t        *subvol = NULL;
+	inode_t         *inode = NULL;
+	loc_t            loc = {0, };
+
+	__glfs_entry_fs (fs);
+
+	if (!object) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		errno = EIO;
+		goto out;
+	}
+
+	inode = glfs_h_resolve_inode (fs, subvol, object);
+	if (!inode) {
+		errno = ESTALE;
+		goto out;
+	}
+
+	if (dir && !IA_ISDIR (inode->ia_type)) {
+		errno = ENOTDIR;
+		goto out;
+	}
+
+	if (!dir && IA_ISDIR (inode->ia_type)) {
+		errno = EISDIR;
+		goto out;
+	}
+
+	if (!dir && !IA_ISREG (inode->ia_type)) {
+		errno = EINVAL;
+		goto out;
+	}
+
+	glfd = GF_CALLOC (1, sizeof (*glfd), glfs_mt_glfs_fd_t);
+	if (!glfd) {
+		errno = ENOMEM;
+		goto out;
+	}
+	INIT_LIST_HEAD (&glfd->entries);
+
+	ret = glfs_loc_from_inode (inode, &loc);
+	if (ret)
+		goto out;
+
+	glfd->fd = fd_create (inode, getpid());
+	if (!glfd->fd) {
+		ret = -1;
+		errno = ENOMEM;
+		goto out;
+	}
+
+	if (dir)
+		ret = syncop_opendir (subvol, &loc, glfd->fd);
+	else
+		ret = syncop_open (subvol, &loc, flags, glfd->fd);
+out:
+	loc_wipe (&loc);
+
+	if (inode)
+		inode_unref (inode);
+
+	if (ret && glfd) {
+		glfs_fd_destroy (glfd);
+		glfd = NULL;
+	}
+
+	return glfd;
+}
+
+
+struct glfs_fd *
+glfs_h_open (struct glfs *fs, struct glfs_object *object, int flags)
+{
+	return glfs_h_open_common (fs, object, flags, 0);
+}
+
+
+struct glfs_fd *
+glfs_h_opendir (struct glfs *fs, struct glfs_object *object)
+{
+	return glfs_h_open_common (fs, object, 0, 1);
+}
+
+
+int
+glfs_h_extract_handle (struct glfs_object *object, unsigned char *handle,
+		       int len)
+{
+	if (!object || !handle) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (len < GFAPI_HANDLE_LENGTH) {
+		errno = ERANGE;
+		return -1;
+	}
+
+	memcpy (handle, object->gfid, GFAPI_HANDLE_LENGTH);
+
+	return GFAPI_HANDLE_LENGTH;
+}
+
+
+struct glfs_object *
+glfs_h_create_from_handle (struct glfs *fs, unsigned char *handle, int len,
+			   struct stat *stat)
+{
+	xlator_t           *subvol = NULL;
+	inode_t            *inode = NULL;
+	uuid_t              gfid;
+	struct iatt         iatt = {0, };
+	struct glfs_object *object = NULL;
+	int                 ret = -1;
+
+	__glfs_entry_fs (fs);
+
+	if (!handle || len != GFAPI_HANDLE_LENGTH) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	memcpy (gfid, handle, GFAPI_HANDLE_LENGTH);
+
+	subvol = glfs_active_subvol (fs);
+	if (!subvol) {
+		errno = EIO;
+		goto out;
+	}
+
+	inode = inode_find (subvol->itable, gfid);
+	if (inode) {
+		object = glfs_h_object_new (inode);
+		if (object && stat) {
+			ret = glfs_h_stat (fs, object, stat);
+			if (ret) {
+				glfs_h_close (object);
+				object = NULL;
+			}
+		}
+		goto out;
+	}
+
+	inode = glfs_h_lookup_gfid (fs, subvol, gfid, &iatt);
+	if (!inode)
+		goto out;
+
+	object = glfs_h_object_new (inode);
+	if (object && stat)
+		iatt_to_stat (&iatt, stat);
+out:
+	if (inode)
+		inode_unref (inode);
+
+	return object;
+}
+
+
+int
+glfs_h_close (struct glfs_object *object)
+{
+	if (!object)
+		return 0;
+
+	if (object->inode)
+		inode_unref (object->inode);
+
+	GF_FREE (object);
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/*
+  Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+
+#ifndef _GLFS_HANDLES_H
+#define _GLFS_HANDLES_H
+
+#include "glfs.h"
+
+/*
+ * HANDLE BASED OPERATIONS
+ *
+ * The calls here operate on objects (files, directories, symlinks ..)
+ * identified by their gfid, instead of by path. A path (or a name relative
+ * to a parent object) is resolved only once to obtain the object, after
+ * which all operations on it go straight to the inode without walking the
+ * namespace again. This suits servers which hand out their own file
+ * handles (e.g NFS-Ganesha) and can store the gfid in them.
+ *
+ * Notes:
+ *
+ * - Objects hold a reference on the inode and must be released with
+ *   glfs_h_close().
+ *
+ * - A handle extracted with glfs_h_extract_handle() is stable across
+ *   restarts and can be turned back into an object with
+ *   glfs_h_create_from_handle().
+ */
+
+__BEGIN_DECLS
+
+/* Size of a handle (gfid) in bytes */
+#define GFAPI_HANDLE_LENGTH 16
+
+struct glfs_object;
+typedef struct glfs_object glfs_object_t;
+
+
+/*
+  SYNOPSIS
+
+  glfs_h_lookupat: Resolve a path to an object.
+
+  DESCRIPTION
+
+  Resolves @path relative to @parent, or to the root of the virtual mount
+  if @parent is NULL or @path is absolute. Symlinks in the last component
+  are not followed.
+
+  RETURN VALUES
+
+  NULL   : Failure. @errno will be set with the type of failure.
+  Others : The object. @stat (if not NULL) is filled with its attributes.
+
+ */
+
+glfs_object_t *glfs_h_lookupat (glfs_t *fs, glfs_object_t *parent,
+				const char *path, struct stat *stat);
+
+glfs_object_t *glfs_h_creat (glfs_t *fs, glfs_object_t *parent,
+			     const char *name, int flags, mode_t mode,
+			     struct stat *stat);
+
+glfs_object_t *glfs_h_mkdir (glfs_t *fs, glfs_object_t *parent,
+			     const char *name, mode_t mode,
+			     struct stat *stat);
+
+int glfs_h_unlink (glfs_t *fs, glfs_object_t *parent, const char *name);
+
+int glfs_h_stat (glfs_t *fs, glfs_object_t *object, struct stat *stat);
+
+glfs_fd_t *glfs_h_open (glfs_t *fs, glfs_object_t *object, int flags);
+
+glfs_fd_t *glfs_h_opendir (glfs_t *fs, glfs_object_t *object);
+
+int glfs_h_close (glfs_object_t *object);
+
+
+/*
+  SYNOPSIS
+
+  glfs_h_extract_handle: Get the handle of an object.
+
+  DESCRIPTION
+
+  Copies the handle (gfid) of @object into @handle, which must be at least
+  GFAPI_HANDLE_LENGTH bytes long.
+
+  RETURN VALUES
+
+  -1     : Failure. @errno will be set with the type of failure.
+  Others : Length of the handle.
+
+ */
+
+int glfs_h_extract_handle (glfs_object_t *object, unsigned char *handle,
+			   int len);
+
+/*
+  SYNOPSIS
+
+  glfs_h_create_from_handle: Get the object for a handle.
+
+  DESCRIPTION
+
+  Returns the object known by @handle. If it is not cached already, a
+  single lookup by gfid is performed, without resolving any path.
+
+  RETURN VALUES
+
+  NULL   : Failure. @errno will be set with the type of failure.
+  Others : The object. @stat (if not NULL) is filled with its attributes.
+
+ */
+
+glfs_object_t *glfs_h_create_from_handle (glfs_t *fs, unsigned char *handle,
+					  int len, struct stat *stat);
+
+__END_DECLS
+
+#endif /* !_GLFS_HANDLES_H */
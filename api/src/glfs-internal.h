@@ -43,6 +43,22 @@ struct glfs_fd {
 	fd_t              *fd;
 	struct list_head   entries;
 	gf_dirent_t       *next;
+	int                readdirplus; /* entries carry attributes */
+};
+
+/* A reference on data buffers owned by the stack (iobufs), handed out to
+   or registered by the application for zero-copy I/O. */
+struct glfs_buf {
+	struct iovec      *iov;
+	int                count;
+	struct iobref     *iobref;
+};
+
+/* An object (file, directory ..) referred to by its gfid rather than
+   by path. See glfs-handles.h */
+struct glfs_object {
+	inode_t           *inode;
+	uuid_t             gfid;
 };
 
 #define DEFAULT_EVENT_POOL_SIZE           16384
@@ -57,6 +73,10 @@ int glfs_resolve (struct glfs *fs, xlator_t *subvol, const char *path, loc_t *lo
 		  struct iatt *iatt);
 int glfs_lresolve (struct glfs *fs, xlator_t *subvol, const char *path, loc_t *loc,
 		   struct iatt *iatt);
+int glfs_resolve_at (struct glfs *fs, xlator_t *subvol, inode_t *at,
+		     const char *origpath, loc_t *loc, struct iatt *iatt,
+		     int follow);
+int glfs_loc_touchup (loc_t *loc);
 void glfs_first_lookup (xlator_t *subvol);
 
 static inline void
@@ -22,6 +22,9 @@ enum glfs_mem_types_ {
 	glfs_mt_glfs_fd_t,
 	glfs_mt_glfs_io_t,
 	glfs_mt_volfile_t,
+	glfs_mt_glfs_buf_t,
+	glfs_mt_glfs_lookup_t,
+	glfs_mt_glfs_object_t,
         glfs_mt_end
 
 };
@@ -346,6 +346,119 @@ int glfs_pwritev_async (glfs_fd_t *fd, const struct iovec *iov, int count,
 			off_t offset, int flags, glfs_io_cbk fn, void *data);
 
 
+/*
+ * ZERO-COPY I/O
+ *
+ * The calls below let the application work directly on the buffers which
+ * travel through the translator stack, instead of having data copied
+ * between its own memory and gluster's iobufs on every read and write.
+ */
+
+/* A reference on one or more data buffers owned by the stack. */
+struct glfs_buf;
+typedef struct glfs_buf glfs_buf_t;
+
+typedef void (*glfs_buf_release_cbk) (void *ptr, void *data);
+
+/*
+  SYNOPSIS
+
+  glfs_pread_zc: Read from a file without copying the data.
+
+  DESCRIPTION
+
+  Reads up to @count bytes at @offset and hands the reply buffers, as
+  received from the network, over to the caller. The data is accessed with
+  glfs_buf_iovec() and must be given back with glfs_buf_release().
+
+  PARAMETERS
+
+  @bufp: Will point to the buffer reference on success. Left NULL at
+         end of file or on failure.
+
+  RETURN VALUES
+
+  -1     : Failure. @errno will be set with the type of failure.
+  Others : Number of bytes read (0 at end of file).
+
+ */
+
+ssize_t glfs_pread_zc (glfs_fd_t *fd, size_t count, off_t offset, int flags,
+		       glfs_buf_t **bufp);
+ssize_t glfs_read_zc (glfs_fd_t *fd, size_t count, int flags,
+		      glfs_buf_t **bufp);
+
+/*
+  SYNOPSIS
+
+  glfs_buf_alloc: Allocate a buffer from gluster's I/O buffer pool.
+
+  DESCRIPTION
+
+  The returned buffer can be filled in by the application (through @ptr)
+  and then written out with glfs_pwritev_zc() without further copies.
+
+  RETURN VALUES
+
+  NULL   : Failure. @errno will be set with the type of failure.
+  Others : Buffer reference of @size bytes, starting at *@ptr.
+
+ */
+
+glfs_buf_t *glfs_buf_alloc (glfs_t *fs, size_t size, void **ptr);
+
+/*
+  SYNOPSIS
+
+  glfs_buf_register: Lend application memory to gluster for writing.
+
+  DESCRIPTION
+
+  Wraps @size bytes at @ptr into a buffer which can be passed to
+  glfs_pwritev_zc(). Translators (e.g. write-behind) may keep referring to
+  the memory after the write call returns, so the application must not
+  modify or free it until @fn is called with @ptr and @data. This happens
+  once glfs_buf_release() has been called and gluster is done with it.
+
+  RETURN VALUES
+
+  NULL   : Failure. @errno will be set with the type of failure.
+  Others : Buffer reference over the registered memory.
+
+ */
+
+glfs_buf_t *glfs_buf_register (glfs_t *fs, void *ptr, size_t size,
+			       glfs_buf_release_cbk fn, void *data);
+
+/*
+  SYNOPSIS
+
+  glfs_pwritev_zc: Write from a gluster buffer without copying the data.
+
+  DESCRIPTION
+
+  Writes the regions described by @iov, which must lie within the memory
+  of @buf, at @offset. If @iov is NULL the whole of @buf is written.
+  @buf remains owned by the caller and must still be released with
+  glfs_buf_release().
+
+  RETURN VALUES
+
+  -1     : Failure. @errno will be set with the type of failure.
+  Others : Number of bytes written.
+
+ */
+
+ssize_t glfs_pwritev_zc (glfs_fd_t *fd, glfs_buf_t *buf,
+			 const struct iovec *iov, int iovcnt, off_t offset,
+			 int flags);
+ssize_t glfs_write_zc (glfs_fd_t *fd, glfs_buf_t *buf, int flags);
+
+int glfs_buf_iovec (glfs_buf_t *buf, const struct iovec **iov, int *iovcnt);
+
+void glfs_buf_release (glfs_buf_t *buf);
+
+
 off_t glfs_lseek (glfs_fd_t *fd, off_t offset, int whence);
 
 int glfs_truncate (glfs_t *fs, const char *path, off_t length);
@@ -387,6 +500,62 @@ glfs_fd_t *glfs_opendir (glfs_t *fs, const char *path);
 int glfs_readdir_r (glfs_fd_t *fd, struct dirent *dirent,
 		    struct dirent **result);
 
+/*
+  SYNOPSIS
+
+  glfs_readdirplus_r: Read a directory entry along with its attributes.
+
+  DESCRIPTION
+
+  Works like glfs_readdir_r(), and in addition fills @stat with the
+  attributes of the entry (as glfs_lstat() would, without following
+  symlinks). The attributes are fetched in bulk with the names, so
+  listing a directory with attributes costs no extra round trips per
+  entry.
+
+  PARAMETERS
+
+  @stat: Attributes of the returned entry. May be NULL.
+
+  RETURN VALUES
+
+   0 : Success. *@result is NULL at the end of the directory.
+  -1 : Failure. @errno will be set with the type of failure.
+
+ */
+
+int glfs_readdirplus_r (glfs_fd_t *fd, struct stat *stat, struct dirent *dirent,
+			struct dirent **result);
+
+/*
+  SYNOPSIS
+
+  glfs_lstat_multi: Fetch the attributes of many names in one directory.
+
+  DESCRIPTION
+
+  Resolves @path once, then looks up all of the @count entries in
+  @names (plain names, not paths) concurrently. Symlinks are not
+  followed.
+
+  PARAMETERS
+
+  @stats: Array of @count elements, @stats[i] is filled in for @names[i]
+          if @errnos[i] is 0.
+
+  @errnos: Array of @count elements, receives 0 or the errno for each name.
+
+  RETURN VALUES
+
+  -1     : Failure to resolve @path. @errno will be set with the type
+           of failure.
+  Others : Number of names whose attributes were fetched.
+
+ */
+
+int glfs_lstat_multi (glfs_t *fs, const char *path, const char *names[],
+		      int count, struct stat *stats, int *errnos);
+
 long glfs_telldir (glfs_fd_t *fd);
 
 void glfs_seekdir (glfs_fd_t *fd, long offset);
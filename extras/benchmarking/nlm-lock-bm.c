@@ -0,0 +1,259 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <limits.h>
+#include <argp.h>
+
+#ifndef UNIX_PATH_MAX
+#define UNIX_PATH_MAX 108
+#endif
+
+/* POSIX locks belong to processes, so every worker is forked to show up
+ * as a lock owner of its own on the NFS client and in NLM */
+struct nlm_bm_config {
+        char dir[UNIX_PATH_MAX];
+        long iters;
+        int  procs;
+        int  files;
+};
+static struct nlm_bm_config nlm_bm_config;
+
+static error_t
+nlm_bm_parse_long (char *arg, long *val)
+{
+        char *tmp = NULL;
+        long  l   = 0;
+
+        l = strtol (arg, &tmp, 10);
+        if ((l == LONG_MAX) || (l == LONG_MIN) || (tmp && *tmp) || (l <= 0))
+                return -1;
+
+        *val = l;
+        return 0;
+}
+
+static error_t
+nlm_bm_parse_opts (int key, char *arg,
+                   struct argp_state *_state)
+{
+        long val = 0;
+
+        switch (key) {
+        case 'd':
+        {
+                int len = 0;
+                len = strlen (arg);
+                if (len >= UNIX_PATH_MAX) {
+                        fprintf (stderr, "directory name too long (%s)\n",
+                                 arg);
+                        return -1;
+                }
+
+                strncpy (nlm_bm_config.dir, arg, len);
+                nlm_bm_config.dir[len] = '\0';
+        }
+        break;
+
+        case 'p':
+                if (nlm_bm_parse_long (arg, &val) == -1) {
+                        fprintf (stderr, "invalid process count (%s)\n", arg);
+                        return -1;
+                }
+                nlm_bm_config.procs = val;
+                break;
+
+        case 'n':
+                if (nlm_bm_parse_long (arg, &val) == -1) {
+                        fprintf (stderr, "invalid file count (%s)\n", arg);
+                        return -1;
+                }
+                nlm_bm_config.files = val;
+                break;
+
+        case 'r':
+                if (nlm_bm_parse_long (arg, &val) == -1) {
+                        fprintf (stderr, "invalid iteration count (%s)\n",
+                                 arg);
+                        return -1;
+                }
+                nlm_bm_config.iters = val;
+                break;
+        }
+
+        return 0;
+}
+
+static struct argp_option nlm_bm_options[] = {
+        {"dir", 'd', "DIRECTORY", 0,
+         "directory on the NFS mount to lock files in (defaults to .)"},
+        {"procs", 'p', "COUNT", 0,
+         "number of processes taking locks (defaults to 4)"},
+        {"files", 'n', "COUNT", 0,
+         "number of files each process locks in turn (defaults to 16)"},
+        {"iters", 'r', "ITERS", 0,
+         "number of lock-unlock pairs per process (defaults to 10000)"},
+        {0, 0, 0, 0, 0}
+};
+
+static struct argp argp = {
+  nlm_bm_options,
+  nlm_bm_parse_opts,
+  "",
+  "nlm-lock-bm - tool to measure the lock/unlock rate NLM sustains with "
+  "many lock owners and files"
+};
+
+static void
+nlm_bm_default_config (void)
+{
+        strcpy (nlm_bm_config.dir, ".");
+        nlm_bm_config.procs = 4;
+        nlm_bm_config.files = 16;
+        nlm_bm_config.iters = 10000;
+}
+
+static int
+nlm_bm_setlk (int fd, short type)
+{
+        struct flock lock = {0, };
+
+        lock.l_type = type;
+        lock.l_whence = SEEK_SET;
+        lock.l_start = 0;
+        lock.l_len = 0;
+
+        while (fcntl (fd, F_SETLKW, &lock) == -1) {
+                if (errno != EINTR)
+                        return -1;
+        }
+
+        return 0;
+}
+
+static int
+nlm_bm_worker (int id)
+{
+        int  *fds  = NULL;
+        char  path[UNIX_PATH_MAX + 32];
+        long  i    = 0;
+        int   ret  = -1;
+        int   fd   = -1;
+
+        fds = calloc (nlm_bm_config.files, sizeof (*fds));
+        if (!fds)
+                goto out;
+
+        /* every process locks the same set of files, so owners contend
+         * on them as well as spread over them */
+        for (i = 0; i < nlm_bm_config.files; i++) {
+                snprintf (path, sizeof (path), "%s/nlm-lock-bm.%ld",
+                          nlm_bm_config.dir, i);
+                fds[i] = open (path, O_RDWR | O_CREAT, 0644);
+                if (fds[i] == -1) {
+                        fprintf (stderr, "[%d] open (%s) failed (%s)\n", id,
+                                 path, strerror (errno));
+                        goto out;
+                }
+        }
+
+        for (i = 0; i < nlm_bm_config.iters; i++) {
+                fd = fds[(i + id) % nlm_bm_config.files];
+
+                if (nlm_bm_setlk (fd, F_WRLCK) == -1 ||
+                    nlm_bm_setlk (fd, F_UNLCK) == -1) {
+                        fprintf (stderr, "[%d] fcntl failed (%s)\n", id,
+                                 strerror (errno));
+                        goto out;
+                }
+        }
+
+        ret = 0;
+out:
+        if (fds) {
+                for (i = 0; i < nlm_bm_config.files; i++) {
+                        if (fds[i] > 0)
+                                close (fds[i]);
+                }
+                free (fds);
+        }
+
+        return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+        int             ret    = -1;
+        int             i      = 0;
+        int             status = 0;
+        int             failed = 0;
+        pid_t           pid    = -1;
+        struct timeval  start  = {0, };
+        struct timeval  end    = {0, };
+        double          secs   = 0;
+
+        nlm_bm_default_config ();
+
+        ret = argp_parse (&argp, argc, argv, 0, 0, NULL);
+        if (ret != 0) {
+                ret = -1;
+                fprintf (stderr, "%s: argp_parse() failed\n", argv[0]);
+                goto err;
+        }
+
+        gettimeofday (&start, NULL);
+
+        for (i = 0; i < nlm_bm_config.procs; i++) {
+                pid = fork ();
+                if (pid == -1) {
+                        fprintf (stderr, "%s: fork failed (%s)\n", argv[0],
+                                 strerror (errno));
+                        failed++;
+                        break;
+                }
+
+                if (pid == 0)
+                        exit (nlm_bm_worker (i) ? 1 : 0);
+        }
+
+        while (wait (&status) > 0) {
+                if (!WIFEXITED (status) || WEXITSTATUS (status))
+                        failed++;
+        }
+
+        gettimeofday (&end, NULL);
+
+        if (failed) {
+                ret = -1;
+                fprintf (stderr, "%s: %d processes failed\n", argv[0],
+                         failed);
+                goto err;
+        }
+
+        secs = (end.tv_sec - start.tv_sec) +
+                (end.tv_usec - start.tv_usec) / 1000000.0;
+        printf ("%d processes, %d files, %ld lock-unlock pairs each: "
+                "%.2f secs, %.0f locks/sec\n", nlm_bm_config.procs,
+                nlm_bm_config.files, nlm_bm_config.iters, secs,
+                (nlm_bm_config.procs * nlm_bm_config.iters) / secs);
+
+        ret = 0;
+err:
+        return ret;
+}
@@ -997,6 +997,9 @@ cleanup_and_exit (int signum)
 
         glusterfs_pidfile_cleanup (ctx);
 
+        /* write out what the logger thread still has queued */
+        gf_log_flush ();
+
         exit (0);
 #if 0
         /* TODO: Properly do cleanup_and_exit(), with synchronization */
@@ -445,6 +445,9 @@ gf_print_trace (int32_t signum, glusterfs_ctx_t *ctx)
          * which helps in debugging.
          */
         fflush (ctx->log.gf_log_logfile);
+        /* in async mode the messages leading up to the crash may still be
+         * queued for the logger thread */
+        gf_log_crash_drain (ctx, ctx->log.gf_log_logfile);
         /* Pending frames, (if any), list them in order */
         ret = write (fd, "pending frames:\n", 16);
         if (ret < 0)
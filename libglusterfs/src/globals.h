@@ -21,13 +21,14 @@
  *
  * 3.3.0                - 1
  * 3.3.Next/3.Next      - 2
+ * volume locks         - 3
  *
  * TODO: Change above comment once gluster version is finalised
  * TODO: Finalize the op-version ranges
  */
 #define GD_OP_VERSION_MIN  1 /* MIN is the fresh start op-version, mostly
                                 should not change */
-#define GD_OP_VERSION_MAX  2 /* MAX VERSION is the maximum count in VME table,
+#define GD_OP_VERSION_MAX  3 /* MAX VERSION is the maximum count in VME table,
                                 should keep changing with introduction of newer
                                 versions */
 
@@ -83,6 +83,8 @@
 #define GF_XATTR_NODE_UUID_KEY  "trusted.glusterfs.node-uuid"
 #define GF_XATTR_VOL_ID_KEY   "trusted.glusterfs.volume-id"
 #define GF_XATTR_LOCKINFO_KEY   "trusted.glusterfs.lockinfo"
+#define GF_XATTR_COPY_TO_KEY    "trusted.glusterfs.copy-to"
+#define GF_XATTR_COPY_TO_TIMEOUT_KEY "trusted.glusterfs.copy-to-timeout"
 
 #define GF_READDIR_SKIP_DIRS       "readdir-filter-directories"
 
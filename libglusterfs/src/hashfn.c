@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef _CONFIG_H
 #define _CONFIG_H
@@ -90,7 +91,7 @@ uint32_t SuperFastHash (const char * data, int32_t len) {
 
 /* Davies-Meyer hashing function implementation
  */
-static int
+static inline void
 dm_round (int rounds, uint32_t *array, uint32_t *h0, uint32_t *h1)
 {
         uint32_t sum = 0;
@@ -115,8 +116,6 @@ dm_round (int rounds, uint32_t *array, uint32_t *h0, uint32_t *h1)
 
         *h0 += b0;
         *h1 += b1;
-
-        return 0;
 }
 
 
@@ -131,57 +130,223 @@ __pad (int len)
         return pad;
 }
 
+/* Words are read in host order, wherever they are aligned */
+static inline uint32_t
+dm_word (const char *msg)
+{
+        uint32_t word = 0;
+
+        memcpy (&word, msg, sizeof (word));
+
+        return word;
+}
+
+/* The block at @msg holds the last (len % 16) bytes: whole words, then the
+   remaining bytes shifted in behind the length pad, then pads */
+static inline void
+dm_last_block (const char *msg, int len, uint32_t *array)
+{
+        uint32_t pad   = 0;
+        int      rem   = 0;
+        int      words = 0;
+        int      bytes = 0;
+        int      j     = 0;
+
+        pad   = __pad (len);
+        rem   = len % 16;
+        words = rem / 4;
+        bytes = rem % 4;
+
+        for (j = 0; j < words; j++)
+                array[j] = dm_word (msg + 4 * j);
+
+        for (; j < 4; j++)
+                array[j] = pad;
+
+        if (words < 4) {
+                msg += 4 * words;
+                while (bytes--) {
+                        array[words] <<= 8;
+                        array[words] |= *msg++;
+                }
+        }
+}
+
 uint32_t
 gf_dm_hashfn (const char *msg, int len)
 {
         uint32_t  h0 = 0x9464a485;
         uint32_t  h1 = 0x542e1a94;
         uint32_t  array[4];
-        uint32_t  pad = 0;
         int       i = 0;
-        int       j = 0;
         int       full_quads = 0;
-        int       full_words = 0;
-        int       full_bytes = 0;
-        uint32_t *intmsg = NULL;
-        int       word = 0;
-
 
-        intmsg = (uint32_t *) msg;
-        pad = __pad (len);
-
-        full_bytes   = len;
-        full_words   = len / 4;
-        full_quads   = len / 16;
+        full_quads = len / 16;
 
         for (i = 0; i < full_quads; i++) {
-                for (j = 0; j < 4; j++) {
-                        word     = *intmsg;
-                        array[j] = word;
-                        intmsg++;
-                        full_words--;
-                        full_bytes -= 4;
-                }
+                array[0] = dm_word (msg);
+                array[1] = dm_word (msg + 4);
+                array[2] = dm_word (msg + 8);
+                array[3] = dm_word (msg + 12);
+                msg += 16;
+
                 dm_round (DM_PARTROUNDS, &array[0], &h0, &h1);
         }
 
-        for (j = 0; j < 4; j++) {
-                if (full_words) {
-                        word     = *intmsg;
-                        array[j] = word;
-                        intmsg++;
-                        full_words--;
-                        full_bytes -= 4;
-                } else {
-                        array[j] = pad;
-                        while (full_bytes) {
-                                array[j] <<= 8;
-                                array[j] |= msg[len - full_bytes];
-                                full_bytes--;
+        dm_last_block (msg, len, array);
+        dm_round (DM_FULLROUNDS, &array[0], &h0, &h1);
+
+        return h0 ^ h1;
+}
+
+#if defined(__GNUC__)
+
+#define DM_LANES 4
+
+typedef uint32_t dm_vec_t __attribute__ ((vector_size (DM_LANES * 4)));
+
+/* DM_LANES names hashed in lock step, each lane exactly as gf_dm_hashfn
+   would. Every step runs the full rounds and keeps the state after the
+   partial ones for lanes that are still in front of their last block */
+static void
+dm_hash_lanes (const char **msgs, const int *lens, uint32_t *hashes,
+               const int *idx)
+{
+        uint32_t  words[4][DM_LANES];
+        uint32_t  partial[DM_LANES];
+        uint32_t  last[DM_LANES];
+        uint32_t  array[4];
+        int       blocks[DM_LANES];
+        dm_vec_t  a[4];
+        dm_vec_t  h0;
+        dm_vec_t  h1;
+        dm_vec_t  b0;
+        dm_vec_t  b1;
+        dm_vec_t  p0;
+        dm_vec_t  p1;
+        dm_vec_t  sum;
+        dm_vec_t  part_m;
+        dm_vec_t  last_m;
+        const char *msg = NULL;
+        int       steps = 0;
+        int       step = 0;
+        int       l = 0;
+        int       j = 0;
+        int       r = 0;
+
+        for (l = 0; l < DM_LANES; l++) {
+                blocks[l] = lens[idx[l]] / 16 + 1;
+                if (blocks[l] > steps)
+                        steps = blocks[l];
+                h0[l] = 0x9464a485;
+                h1[l] = 0x542e1a94;
+        }
+
+        for (step = 0; step < steps; step++) {
+                for (l = 0; l < DM_LANES; l++) {
+                        msg = msgs[idx[l]] + 16 * step;
+                        partial[l] = last[l] = 0;
+                        if (step < blocks[l] - 1) {
+                                for (j = 0; j < 4; j++)
+                                        words[j][l] = dm_word (msg + 4 * j);
+                                partial[l] = ~0U;
+                                continue;
+                        }
+
+                        if (step == blocks[l] - 1) {
+                                dm_last_block (msg, lens[idx[l]], array);
+                                last[l] = ~0U;
+                        } else {
+                                memset (array, 0, sizeof (array));
                         }
+
+                        for (j = 0; j < 4; j++)
+                                words[j][l] = array[j];
+                }
+
+                for (j = 0; j < 4; j++)
+                        memcpy (&a[j], words[j], sizeof (a[j]));
+                memcpy (&part_m, partial, sizeof (part_m));
+                memcpy (&last_m, last, sizeof (last_m));
+
+                b0 = h0;
+                b1 = h1;
+                memset (&sum, 0, sizeof (sum));
+
+                for (r = 0; r < DM_PARTROUNDS; r++) {
+                        sum += DM_DELTA;
+                        b0  += ((b1 << 4) + a[0])
+                                ^ (b1 + sum)
+                                ^ ((b1 >> 5) + a[1]);
+                        b1  += ((b0 << 4) + a[2])
+                                ^ (b0 + sum)
+                                ^ ((b0 >> 5) + a[3]);
                 }
+
+                p0 = b0;
+                p1 = b1;
+
+                for (; r < DM_FULLROUNDS; r++) {
+                        sum += DM_DELTA;
+                        b0  += ((b1 << 4) + a[0])
+                                ^ (b1 + sum)
+                                ^ ((b1 >> 5) + a[1]);
+                        b1  += ((b0 << 4) + a[2])
+                                ^ (b0 + sum)
+                                ^ ((b0 >> 5) + a[3]);
+                }
+
+                h0 += (p0 & part_m) | (b0 & last_m);
+                h1 += (p1 & part_m) | (b1 & last_m);
         }
-        dm_round (DM_FULLROUNDS, &array[0], &h0, &h1);
 
-        return h0 ^ h1;
+        for (l = 0; l < DM_LANES; l++)
+                hashes[idx[l]] = h0[l] ^ h1[l];
+}
+
+#endif /* __GNUC__ */
+
+#define DM_BATCH     64
+#define DM_BUCKETS   4
+
+/* gf_dm_hashfn of @cnt names at once, for callers holding a batch of them
+   such as a readdir reply. Names of as many blocks share lanes, so that
+   no lane idles while another works through a longer name */
+void
+gf_dm_hashfn_multi (const char **msgs, const int *lens, uint32_t *hashes,
+                    int cnt)
+{
+        int  idx[DM_BATCH];
+        int  fill[DM_BUCKETS + 1];
+        int  base = 0;
+        int  n = 0;
+        int  b = 0;
+        int  i = 0;
+
+        for (base = 0; base < cnt; base += DM_BATCH) {
+                n = ((cnt - base) < DM_BATCH) ? (cnt - base) : DM_BATCH;
+
+                /* counting sort by blocks, the long ones together */
+                memset (fill, 0, sizeof (fill));
+                for (i = 0; i < n; i++) {
+                        b = lens[base + i] / 16;
+                        fill[((b < DM_BUCKETS) ? b : DM_BUCKETS - 1) + 1]++;
+                }
+                for (b = 1; b <= DM_BUCKETS; b++)
+                        fill[b] += fill[b - 1];
+                for (i = 0; i < n; i++) {
+                        b = lens[base + i] / 16;
+                        idx[fill[(b < DM_BUCKETS) ? b : DM_BUCKETS - 1]++] =
+                                base + i;
+                }
+
+                i = 0;
+#if defined(__GNUC__)
+                for (; i + DM_LANES <= n; i += DM_LANES)
+                        dm_hash_lanes (msgs, lens, hashes, idx + i);
+#endif
+                for (; i < n; i++)
+                        hashes[idx[i]] = gf_dm_hashfn (msgs[idx[i]],
+                                                       lens[idx[i]]);
+        }
 }
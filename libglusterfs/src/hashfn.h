@@ -23,5 +23,8 @@ uint32_t SuperFastHash (const char * data, int32_t len);
 
 uint32_t gf_dm_hashfn (const char *msg, int len);
 
+void gf_dm_hashfn_multi (const char **msgs, const int *lens, uint32_t *hashes,
+                         int cnt);
+
 uint32_t ReallySimpleHash (char *path, int len);
 #endif /* __HASHFN_H__ */
@@ -140,13 +140,21 @@ out:
 void
 __iobuf_arena_destroy (struct iobuf_arena *iobuf_arena)
 {
+        struct iobuf_pool  *iobuf_pool = NULL;
+
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf_arena, out);
 
+        iobuf_pool = iobuf_arena->iobuf_pool;
+
         __iobuf_arena_destroy_iobufs (iobuf_arena);
 
         if (iobuf_arena->mem_base
-            && iobuf_arena->mem_base != MAP_FAILED)
+            && iobuf_arena->mem_base != MAP_FAILED) {
+                if (iobuf_pool->arena_del_cbk)
+                        iobuf_pool->arena_del_cbk (iobuf_arena,
+                                                   iobuf_pool->arena_cbk_data);
                 munmap (iobuf_arena->mem_base, iobuf_arena->arena_size);
+        }
 
         GF_FREE (iobuf_arena);
 out:
@@ -194,6 +202,12 @@ __iobuf_arena_alloc (struct iobuf_pool *iobuf_pool, size_t page_size,
                 goto err;
         }
 
+        /* a failed registration only means the consumer has to take
+           its slow path for the iobufs of this arena */
+        if (iobuf_pool->arena_add_cbk)
+                iobuf_pool->arena_add_cbk (iobuf_arena,
+                                           iobuf_pool->arena_cbk_data);
+
         iobuf_pool->arena_cnt++;
 
         return iobuf_arena;
@@ -308,6 +322,55 @@ out:
         return;
 }
 
+static void
+__iobuf_pool_arena_list_cbk (struct list_head *head, iobuf_arena_cbk_t fn,
+                             void *data)
+{
+        struct iobuf_arena *iobuf_arena = NULL;
+
+        list_for_each_entry (iobuf_arena, head, list) {
+                if (iobuf_arena->mem_base)
+                        fn (iobuf_arena, data);
+        }
+}
+
+
+/* Installs the callbacks for arenas mapped and unmapped from now on, and
+   calls @add for every arena mapped so far. Arenas can move between the
+   lists of the pool, so @add must cope with seeing one of them twice.
+ */
+int
+iobuf_pool_set_arena_cbks (struct iobuf_pool *iobuf_pool,
+                           iobuf_arena_cbk_t add, iobuf_arena_cbk_t del,
+                           void *data)
+{
+        int                 i          = 0;
+        int                 ret        = -1;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+
+        pthread_mutex_lock (&iobuf_pool->mutex);
+        {
+                iobuf_pool->arena_add_cbk  = add;
+                iobuf_pool->arena_del_cbk  = del;
+                iobuf_pool->arena_cbk_data = data;
+
+                for (i = 0; add && (i < IOBUF_ARENA_MAX_INDEX); i++) {
+                        __iobuf_pool_arena_list_cbk (&iobuf_pool->arenas[i],
+                                                     add, data);
+                        __iobuf_pool_arena_list_cbk (&iobuf_pool->filled[i],
+                                                     add, data);
+                        __iobuf_pool_arena_list_cbk (&iobuf_pool->purge[i],
+                                                     add, data);
+                }
+        }
+        pthread_mutex_unlock (&iobuf_pool->mutex);
+
+        ret = 0;
+out:
+        return ret;
+}
+
 static void
 iobuf_create_stdalloc_arena (struct iobuf_pool *iobuf_pool)
 {
@@ -571,6 +634,51 @@ out:
 }
 
 
+/* Wrap memory owned by the caller in an iobuf, so that it can travel down
+   the stack (and be held in iobrefs) exactly like pool memory. @release is
+   invoked once the last reference is dropped, after which the memory is
+   the caller's again.
+*/
+struct iobuf *
+iobuf_get_external (struct iobuf_pool *iobuf_pool, void *ptr, size_t size,
+                    iobuf_release_cbk_t release, void *data)
+{
+        struct iobuf       *iobuf       = NULL;
+        struct iobuf_arena *iobuf_arena = NULL;
+        struct iobuf_arena *trav        = NULL;
+
+        GF_VALIDATE_OR_GOTO ("iobuf", iobuf_pool, out);
+        GF_VALIDATE_OR_GOTO ("iobuf", ptr, out);
+
+        /* external iobufs are accounted in the misc (stdalloc) arena, so
+           that iobuf_put() releases them without touching any lists */
+        list_for_each_entry (trav, &iobuf_pool->arenas[IOBUF_ARENA_MAX_INDEX],
+                             list) {
+                iobuf_arena = trav;
+                break;
+        }
+
+        iobuf = GF_CALLOC (1, sizeof (*iobuf), gf_common_mt_iobuf);
+        if (!iobuf)
+                goto out;
+
+        iobuf->ptr = ptr;
+        iobuf->free_ptr = NULL;
+        iobuf->release = release;
+        iobuf->release_data = data;
+        iobuf->iobuf_arena = iobuf_arena;
+        LOCK_INIT (&iobuf->lock);
+
+        /* Hold a ref because you are allocating and using it */
+        iobuf->ref = 1;
+
+        gf_log ("iobuf", GF_LOG_TRACE, "wrapped external memory %p (%zu "
+                "bytes) in iobuf %p", ptr, size, iobuf);
+out:
+        return iobuf;
+}
+
+
 struct iobuf *
 iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size)
 {
@@ -650,7 +758,25 @@ out:
         return iobuf;
 }
 
-void
+static void
+iobuf_free_stdalloc (struct iobuf *iobuf)
+{
+        gf_log ("iobuf", GF_LOG_DEBUG, "freeing the iobuf (%p) "
+                "allocated with standard calloc()", iobuf);
+
+        /* free up properly without bothering about lists and all */
+        LOCK_DESTROY (&iobuf->lock);
+        if (iobuf->release)
+                iobuf->release (iobuf->ptr, iobuf->release_data);
+        GF_FREE (iobuf->free_ptr);
+        GF_FREE (iobuf);
+}
+
+
+/* returns 1 for iobufs outside of the arenas (standard calloc() or
+   external memory), which the caller frees with iobuf_free_stdalloc()
+   once it has dropped the pool mutex */
+int
 __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
 {
         struct iobuf_pool *iobuf_pool = NULL;
@@ -662,16 +788,8 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
         iobuf_pool = iobuf_arena->iobuf_pool;
 
         index = gf_iobuf_get_arena_index (iobuf_arena->page_size);
-        if (index == -1) {
-                gf_log ("iobuf", GF_LOG_DEBUG, "freeing the iobuf (%p) "
-                        "allocated with standard calloc()", iobuf);
-
-                /* free up properly without bothering about lists and all */
-                LOCK_DESTROY (&iobuf->lock);
-                GF_FREE (iobuf->free_ptr);
-                GF_FREE (iobuf);
-                return;
-        }
+        if (index == -1)
+                return 1;
 
         if (iobuf_arena->passive_cnt == 0) {
                 list_del (&iobuf_arena->list);
@@ -690,7 +808,7 @@ __iobuf_put (struct iobuf *iobuf, struct iobuf_arena *iobuf_arena)
                 __iobuf_arena_prune (iobuf_pool, iobuf_arena, index);
         }
 out:
-        return;
+        return 0;
 }
 
 
@@ -699,6 +817,7 @@ iobuf_put (struct iobuf *iobuf)
 {
         struct iobuf_arena *iobuf_arena = NULL;
         struct iobuf_pool  *iobuf_pool = NULL;
+        int                 stdalloc   = 0;
 
         GF_VALIDATE_OR_GOTO ("iobuf", iobuf, out);
 
@@ -716,10 +835,15 @@ iobuf_put (struct iobuf *iobuf)
 
         pthread_mutex_lock (&iobuf_pool->mutex);
         {
-                __iobuf_put (iobuf, iobuf_arena);
+                stdalloc = __iobuf_put (iobuf, iobuf_arena);
         }
         pthread_mutex_unlock (&iobuf_pool->mutex);
 
+        /* the release callback of external memory may get or put iobufs
+           of this pool itself */
+        if (stdalloc)
+                iobuf_free_stdalloc (iobuf);
+
 out:
         return;
 }
@@ -48,6 +48,16 @@ struct iobuf_arena;
 /* expandable and contractable pool of memory, internally broken into arenas */
 struct iobuf_pool;
 
+/* called when the last reference on an iobuf wrapping caller-owned
+   memory (see iobuf_get_external()) goes away */
+typedef void (*iobuf_release_cbk_t) (void *ptr, void *data);
+
+/* called for every arena mapped from (and unmapped back to) the operating
+   system, so that the memory can be registered with a device once (see
+   iobuf_pool_set_arena_cbks()) */
+typedef int (*iobuf_arena_cbk_t) (struct iobuf_arena *iobuf_arena,
+                                  void *data);
+
 struct iobuf_init_config {
         size_t   pagesize;
         int32_t  num_pages;
@@ -70,6 +80,9 @@ struct iobuf {
 
         void                *free_ptr; /* in case of stdalloc, this is the
                                           one to be freed */
+        iobuf_release_cbk_t  release;  /* in case of external memory, this
+                                          is how it is handed back */
+        void                *release_data;
 };
 
 
@@ -123,6 +136,10 @@ struct iobuf_pool {
 
         uint64_t            request_misses; /* mostly the requests for higher
                                                value of iobufs */
+
+        iobuf_arena_cbk_t   arena_add_cbk; /* called under @mutex */
+        iobuf_arena_cbk_t   arena_del_cbk;
+        void               *arena_cbk_data;
 };
 
 
@@ -158,4 +175,13 @@ void   iobuf_stats_dump (struct iobuf_pool *iobuf_pool);
 
 struct iobuf *
 iobuf_get2 (struct iobuf_pool *iobuf_pool, size_t page_size);
+
+struct iobuf *
+iobuf_get_external (struct iobuf_pool *iobuf_pool, void *ptr, size_t size,
+                    iobuf_release_cbk_t release, void *data);
+
+int
+iobuf_pool_set_arena_cbks (struct iobuf_pool *iobuf_pool,
+                           iobuf_arena_cbk_t add, iobuf_arena_cbk_t del,
+                           void *data);
 #endif /* !_IOBUF_H_ */
@@ -26,6 +26,7 @@
 #include "logging.h"
 #include "defaults.h"
 #include "glusterfs.h"
+#include "statedump.h"
 
 #ifdef GF_LINUX_HOST_OS
 #include <syslog.h>
@@ -45,6 +46,62 @@ struct _log_msg {
         struct list_head queue;
 };
 
+/* A message queued on a ring: the header is followed by the file name,
+ * function, calling functions, domain and message, each nul terminated.
+ * Records never wrap, the end of the ring is padded out instead. */
+typedef struct gf_log_rec_ {
+        uint32_t        size;      /* whole record, 8 byte aligned */
+        uint32_t        level;     /* GF_LOG_REC_PAD to skip to the start */
+        uint32_t        len;       /* of the strings */
+        int32_t         line;
+        int32_t         graph_id;
+        uint16_t        function;  /* offsets of the strings */
+        uint16_t        callstr;
+        uint16_t        domain;
+        uint16_t        msg;
+        struct timeval  tv;
+} gf_log_rec_t;
+
+#define GF_LOG_REC_PAD          ((uint32_t) -1)
+#define GF_LOG_REC_ALIGN(sz)    (((sz) + 7) & ~((uint64_t) 7))
+#define GF_LOG_REC_STR(rec, o)  ((char *)((rec) + 1) + (o))
+
+/* single producer (the owning thread), single consumer (the logger) */
+typedef struct gf_log_ring_ {
+        struct list_head   list;
+        char              *buf;
+        uint32_t           size;
+        volatile uint64_t  head;     /* moved by the owning thread */
+        volatile uint64_t  tail;     /* moved by the logger */
+        volatile uint64_t  dropped;
+        uint64_t           dropped_seen;
+        volatile int       orphaned; /* the owning thread is gone */
+} gf_log_ring_t;
+
+typedef struct gf_log_logger_ {
+        glusterfs_ctx_t   *ctx;
+        gf_log_ring_t    **rings;    /* snapshot taken for each pass */
+        uint64_t          *ends;
+        int                count;
+        int                alloc;
+        gf_log_rec_t      *last;     /* last message written out */
+        size_t             last_size;
+        uint64_t           repeats;
+        struct timeval     repeat_tv;
+} gf_log_logger_t;
+
+static char *gf_log_level_strings[] = {"",  /* NONE */
+                                       "M", /* EMERGENCY */
+                                       "A", /* ALERT */
+                                       "C", /* CRITICAL */
+                                       "E", /* ERROR */
+                                       "W", /* WARNING */
+                                       "N", /* NOTICE */
+                                       "I", /* INFO */
+                                       "D", /* DEBUG */
+                                       "T", /* TRACE */
+                                       ""};
+
 void
 gf_log_logrotate (int signum)
 {
@@ -101,6 +158,16 @@ gf_log_fini (void)
         pthread_mutex_destroy (&THIS->ctx->log.logfile_mutex);
 }
 
+static void
+gf_log_ring_orphan (void *data)
+{
+        gf_log_ring_t *ring = data;
+
+        /* the logger frees it once it has written out the rest */
+        __sync_synchronize ();
+        ring->orphaned = 1;
+}
+
 
 void
 gf_log_globals_init (void *data)
@@ -113,6 +180,15 @@ gf_log_globals_init (void *data)
         ctx->log.gf_log_syslog    = 1;
         ctx->log.sys_log_level    = GF_LOG_CRITICAL;
 
+        ctx->log.logmode          = GF_LOG_MODE_SYNC;
+        ctx->log.logformat        = GF_LOG_FORMAT_TEXT;
+        ctx->log.buf_size         = GF_LOG_BUF_SIZE_DEFAULT;
+        ctx->log.flush_timeout    = GF_LOG_FLUSH_TIMEOUT_DEFAULT;
+        pthread_mutex_init (&ctx->log.logger_lock, NULL);
+        pthread_cond_init (&ctx->log.logger_cond, NULL);
+        INIT_LIST_HEAD (&ctx->log.rings);
+        pthread_key_create (&ctx->log.ring_key, gf_log_ring_orphan);
+
 #ifdef GF_LINUX_HOST_OS
         /* For the 'syslog' output. one can grep 'GlusterFS' in syslog
            for serious logs */
@@ -166,6 +242,728 @@ gf_log_init (void *data, const char *file)
         return 0;
 }
 
+
+/* reopens the log file after it has been rotated */
+static int
+gf_log_rotate (glusterfs_ctx_t *ctx)
+{
+        FILE *new_logfile = NULL;
+        int   fd          = -1;
+
+        fd = open (ctx->log.filename,
+                   O_CREAT | O_RDONLY, S_IRUSR | S_IWUSR);
+        if (fd < 0) {
+                gf_log ("logrotate", GF_LOG_ERROR,
+                        "%s", strerror (errno));
+                return -1;
+        }
+        close (fd);
+
+        new_logfile = fopen (ctx->log.filename, "a");
+        if (!new_logfile) {
+                gf_log ("logrotate", GF_LOG_CRITICAL,
+                        "failed to open logfile %s (%s)",
+                        ctx->log.filename, strerror (errno));
+                return 0;
+        }
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                if (ctx->log.logfile)
+                        fclose (ctx->log.logfile);
+
+                ctx->log.gf_log_logfile = ctx->log.logfile = new_logfile;
+        }
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+
+        return 0;
+}
+
+static void
+gf_log_fmt_tv (char *timestr, size_t size, struct timeval *tv)
+{
+        gf_time_fmt (timestr, size, tv->tv_sec, gf_timefmt_FT);
+        snprintf (timestr + strlen (timestr), size - strlen (timestr),
+                  ".%"GF_PRI_SUSECONDS, tv->tv_usec);
+}
+
+/* fills in the header and the strings before the message, returns the
+ * offset of the message in the record or -1 if they are too long */
+static int
+gf_log_rec_fill (gf_log_rec_t *rec, gf_loglevel_t level, const char *file,
+                 const char *function, int line, int graph_id,
+                 const char *callstr, const char *domain, struct timeval *tv)
+{
+        size_t  flen  = strlen (file) + 1;
+        size_t  fnlen = strlen (function) + 1;
+        size_t  cslen = strlen (callstr) + 1;
+        size_t  dlen  = strlen (domain) + 1;
+        char   *str   = NULL;
+
+        if (flen + fnlen + cslen + dlen > UINT16_MAX)
+                return -1;
+
+        rec->level = level;
+        rec->line = line;
+        rec->graph_id = graph_id;
+        rec->tv = *tv;
+
+        str = GF_LOG_REC_STR (rec, 0);
+        memcpy (str, file, flen);
+        rec->function = flen;
+        memcpy (str + rec->function, function, fnlen);
+        rec->callstr = rec->function + fnlen;
+        memcpy (str + rec->callstr, callstr, cslen);
+        rec->domain = rec->callstr + cslen;
+        memcpy (str + rec->domain, domain, dlen);
+        rec->msg = rec->domain + dlen;
+
+        return rec->msg;
+}
+
+static size_t
+gf_log_rec_prefix_size (const char *file, const char *function,
+                        const char *callstr, const char *domain)
+{
+        return sizeof (gf_log_rec_t) + strlen (file) + strlen (function) +
+                strlen (callstr) + strlen (domain) + 4;
+}
+
+static gf_log_ring_t *
+gf_log_get_ring (gf_log_handle_t *log)
+{
+        gf_log_ring_t *ring = NULL;
+
+        ring = pthread_getspecific (log->ring_key);
+        if (ring && ring->size == log->buf_size)
+                return ring;
+
+        /* log-buf-size changed, the logger drains and frees the old one */
+        if (ring)
+                gf_log_ring_orphan (ring);
+
+        ring = CALLOC (1, sizeof (*ring) + log->buf_size);
+        if (!ring) {
+                pthread_setspecific (log->ring_key, NULL);
+                return NULL;
+        }
+        ring->buf = (char *)(ring + 1);
+        ring->size = log->buf_size;
+
+        pthread_mutex_lock (&log->logger_lock);
+        {
+                list_add_tail (&ring->list, &log->rings);
+        }
+        pthread_mutex_unlock (&log->logger_lock);
+
+        pthread_setspecific (log->ring_key, ring);
+
+        return ring;
+}
+
+/* Queues a message on the calling thread's ring, formatting it in place.
+ * Never waits for the logger: a message which does not fit is dropped and
+ * counted. Returns -1 only if the message has to be written synchronously. */
+static int
+gf_log_enqueue (glusterfs_ctx_t *ctx, xlator_t *this, const char *domain,
+                const char *file, const char *function, int line,
+                gf_loglevel_t level, const char *callstr, const char *fmt,
+                va_list ap)
+{
+        gf_log_handle_t *log      = &ctx->log;
+        gf_log_ring_t   *ring     = NULL;
+        gf_log_rec_t    *rec      = NULL;
+        const char      *basename = NULL;
+        struct timeval   tv       = {0,};
+        uint64_t         head     = 0;
+        uint64_t         space    = 0;
+        uint64_t         off      = 0;
+        uint64_t         contig   = 0;
+        uint64_t         avail    = 0;
+        uint64_t         need     = 0;
+        size_t           prefix   = 0;
+        int              len      = -1;
+        va_list          aq;
+
+        ring = gf_log_get_ring (log);
+        if (!ring)
+                return -1;
+
+        basename = strrchr (file, '/');
+        if (basename)
+                basename++;
+        else
+                basename = file;
+
+        prefix = gf_log_rec_prefix_size (basename, function, callstr, domain);
+        if (prefix - sizeof (*rec) > UINT16_MAX)
+                return -1;
+
+        gettimeofday (&tv, NULL);
+
+        head = ring->head;
+        space = ring->size - (head - ring->tail);
+        __sync_synchronize ();
+
+        off = head & (ring->size - 1);
+        contig = ring->size - off;
+        avail = (space < contig) ? space : contig;
+
+        if (avail > prefix) {
+                va_copy (aq, ap);
+                len = vsnprintf (ring->buf + off + prefix, avail - prefix,
+                                 fmt, aq);
+                va_end (aq);
+                if (len < 0)
+                        return -1;
+
+                need = GF_LOG_REC_ALIGN (prefix + len + 1);
+                if (need <= avail)
+                        goto fill;
+        }
+
+        if (len < 0) {
+                va_copy (aq, ap);
+                len = vsnprintf (NULL, 0, fmt, aq);
+                va_end (aq);
+                if (len < 0)
+                        return -1;
+                need = GF_LOG_REC_ALIGN (prefix + len + 1);
+        }
+
+        /* start over at the beginning of the ring */
+        if (space < contig + need) {
+                ring->dropped++;
+                return 0;
+        }
+
+        rec = (gf_log_rec_t *)(ring->buf + off);
+        rec->size = contig;
+        rec->level = GF_LOG_REC_PAD;
+        head += contig;
+        off = 0;
+
+        vsnprintf (ring->buf + prefix, need - prefix, fmt, ap);
+fill:
+        rec = (gf_log_rec_t *)(ring->buf + off);
+        gf_log_rec_fill (rec, level, basename, function, line,
+                         ((this->graph) ? this->graph->id : 0), callstr,
+                         domain, &tv);
+        rec->size = need;
+        rec->len = prefix - sizeof (*rec) + len + 1;
+
+        __sync_synchronize ();
+        ring->head = head + need;
+
+        if (log->logger_idle)
+                pthread_cond_signal (&log->logger_cond);
+
+        return 0;
+}
+
+static void
+gf_log_json_str (FILE *fp, const char *key, const char *str)
+{
+        const unsigned char *c = (const unsigned char *) str;
+
+        fprintf (fp, ",\"%s\":\"", key);
+        for (; *c; c++) {
+                if (*c == '"' || *c == '\\')
+                        fprintf (fp, "\\%c", *c);
+                else if (*c < 0x20)
+                        fprintf (fp, "\\u%04x", *c);
+                else
+                        fputc (*c, fp);
+        }
+        fputc ('"', fp);
+}
+
+/* writes out a message, or the summary of its repeats when repeats is set */
+static void
+gf_log_write_rec (glusterfs_ctx_t *ctx, FILE *fp, gf_log_rec_t *rec,
+                  uint64_t repeats, struct timeval *until)
+{
+        char        timestr[256]  = {0,};
+        char        untilstr[256] = {0,};
+        const char *level         = NULL;
+        char       *file          = GF_LOG_REC_STR (rec, 0);
+        char       *function      = GF_LOG_REC_STR (rec, rec->function);
+        char       *callstr       = GF_LOG_REC_STR (rec, rec->callstr);
+        char       *domain        = GF_LOG_REC_STR (rec, rec->domain);
+        char       *msg           = GF_LOG_REC_STR (rec, rec->msg);
+
+        gf_log_fmt_tv (timestr, sizeof timestr, &rec->tv);
+        if (repeats)
+                gf_log_fmt_tv (untilstr, sizeof untilstr, until);
+        level = gf_log_level_strings[rec->level];
+
+        if (ctx->log.logformat == GF_LOG_FORMAT_JSON) {
+                fprintf (fp, "{\"time\":\"%s\",\"level\":\"%s\"", timestr,
+                         level);
+                gf_log_json_str (fp, "file", file);
+                fprintf (fp, ",\"line\":%d", rec->line);
+                gf_log_json_str (fp, "function", function);
+                if (*callstr)
+                        gf_log_json_str (fp, "callers", callstr);
+                fprintf (fp, ",\"graph\":%d", rec->graph_id);
+                gf_log_json_str (fp, "domain", domain);
+                gf_log_json_str (fp, "message", msg);
+                if (repeats)
+                        fprintf (fp, ",\"repeated\":%"PRIu64",\"until\":\"%s\"",
+                                 repeats, untilstr);
+                fprintf (fp, "}\n");
+        } else if (repeats) {
+                fprintf (fp, "The message \"%s [%s:%d:%s] %d-%s: %s\" repeated "
+                         "%"PRIu64" times between [%s] and [%s]\n", level,
+                         file, rec->line, function, rec->graph_id, domain, msg,
+                         repeats, timestr, untilstr);
+        } else {
+                fprintf (fp, "[%s] %s [%s:%d:%s] %s%s%d-%s: %s\n", timestr,
+                         level, file, rec->line, function, callstr,
+                         (*callstr) ? " " : "", rec->graph_id, domain, msg);
+        }
+
+#ifdef GF_LINUX_HOST_OS
+        /* We want only serious log in 'syslog', not our debug
+           and trace logs */
+        if (!repeats && ctx->log.gf_log_syslog && rec->level &&
+            (rec->level <= ctx->log.sys_log_level))
+                syslog ((rec->level-1), "[%s] %s [%s:%d:%s] %d-%s: %s\n",
+                        timestr, level, file, rec->line, function,
+                        rec->graph_id, domain, msg);
+#endif
+}
+
+static void
+gf_log_logger_flush_repeats (gf_log_logger_t *logger, FILE *fp)
+{
+        if (!logger->repeats)
+                return;
+
+        gf_log_write_rec (logger->ctx, fp, logger->last, logger->repeats,
+                          &logger->repeat_tv);
+        logger->repeats = 0;
+}
+
+static int
+gf_log_rec_same (gf_log_rec_t *a, gf_log_rec_t *b)
+{
+        return (a->level == b->level && a->line == b->line &&
+                a->graph_id == b->graph_id && a->len == b->len &&
+                !memcmp (a + 1, b + 1, a->len));
+}
+
+static void
+gf_log_logger_write (gf_log_logger_t *logger, FILE *fp, gf_log_rec_t *rec)
+{
+        gf_log_handle_t *log  = &logger->ctx->log;
+        gf_log_rec_t    *last = NULL;
+        size_t           size = 0;
+
+        /* repeats of the last message within flush-timeout of its first
+         * occurrence are only counted */
+        if (log->flush_timeout && logger->last &&
+            gf_log_rec_same (rec, logger->last) &&
+            (rec->tv.tv_sec - logger->last->tv.tv_sec) < log->flush_timeout) {
+                logger->repeats++;
+                logger->repeat_tv = rec->tv;
+                log->suppressed++;
+                return;
+        }
+
+        gf_log_logger_flush_repeats (logger, fp);
+        gf_log_write_rec (logger->ctx, fp, rec, 0, NULL);
+
+        size = sizeof (*rec) + rec->len;
+        if (size > logger->last_size) {
+                last = realloc (logger->last, size);
+                if (!last) {
+                        FREE (logger->last);
+                        logger->last_size = 0;
+                        return;
+                }
+                logger->last = last;
+                logger->last_size = size;
+        }
+        memcpy (logger->last, rec, size);
+}
+
+/* takes the rings with something to write out, frees the drained ones of
+ * exited threads; returns the drops not reported yet */
+static uint64_t
+gf_log_logger_snapshot (gf_log_logger_t *logger)
+{
+        gf_log_handle_t  *log     = &logger->ctx->log;
+        gf_log_ring_t    *ring    = NULL;
+        gf_log_ring_t    *tmp     = NULL;
+        gf_log_ring_t   **rings   = NULL;
+        uint64_t         *ends    = NULL;
+        uint64_t          dropped = 0;
+        int               orphan  = 0;
+
+        logger->count = 0;
+
+        pthread_mutex_lock (&log->logger_lock);
+        {
+                list_for_each_entry_safe (ring, tmp, &log->rings, list) {
+                        orphan = ring->orphaned;
+                        __sync_synchronize ();
+
+                        dropped += ring->dropped - ring->dropped_seen;
+                        ring->dropped_seen = ring->dropped;
+
+                        if (orphan && ring->head == ring->tail) {
+                                list_del (&ring->list);
+                                FREE (ring);
+                                continue;
+                        }
+
+                        if (ring->head == ring->tail)
+                                continue;
+
+                        if (logger->count == logger->alloc) {
+                                rings = realloc (logger->rings,
+                                                 (logger->alloc + 16) *
+                                                 sizeof (*rings));
+                                if (!rings)
+                                        break;
+                                logger->rings = rings;
+                                ends = realloc (logger->ends,
+                                                (logger->alloc + 16) *
+                                                sizeof (*ends));
+                                if (!ends)
+                                        break;
+                                logger->ends = ends;
+                                logger->alloc += 16;
+                        }
+
+                        logger->rings[logger->count] = ring;
+                        logger->ends[logger->count] = ring->head;
+                        logger->count++;
+                }
+        }
+        pthread_mutex_unlock (&log->logger_lock);
+
+        __sync_synchronize ();
+
+        return dropped;
+}
+
+static gf_log_rec_t *
+gf_log_ring_front (gf_log_ring_t *ring, uint64_t end)
+{
+        gf_log_rec_t *rec = NULL;
+
+        while (ring->tail < end) {
+                rec = (gf_log_rec_t *)(ring->buf +
+                                       (ring->tail & (ring->size - 1)));
+                if (rec->level != GF_LOG_REC_PAD)
+                        return rec;
+                ring->tail += rec->size;
+        }
+
+        return NULL;
+}
+
+/* writes out everything queued so far, the rings merged in time order */
+static void
+gf_log_logger_drain (gf_log_logger_t *logger, int final)
+{
+        glusterfs_ctx_t *ctx     = logger->ctx;
+        FILE            *fp      = NULL;
+        gf_log_rec_t    *rec     = NULL;
+        gf_log_rec_t    *best    = NULL;
+        uint64_t         dropped = 0;
+        struct timeval   now     = {0,};
+        int              i       = 0;
+        int              idx     = -1;
+        union {
+                gf_log_rec_t rec;
+                char         buf[512];
+        } note;
+
+        if (ctx->log.logrotate) {
+                ctx->log.logrotate = 0;
+                gf_log_rotate (ctx);
+        }
+
+        dropped = gf_log_logger_snapshot (logger);
+
+        pthread_mutex_lock (&ctx->log.logfile_mutex);
+        {
+                fp = ctx->log.logfile ? ctx->log.logfile : stderr;
+
+                for (;;) {
+                        best = NULL;
+                        for (i = 0; i < logger->count; i++) {
+                                rec = gf_log_ring_front (logger->rings[i],
+                                                         logger->ends[i]);
+                                if (rec && (!best ||
+                                            timercmp (&rec->tv, &best->tv, <))) {
+                                        best = rec;
+                                        idx = i;
+                                }
+                        }
+                        if (!best)
+                                break;
+
+                        gf_log_logger_write (logger, fp, best);
+
+                        __sync_synchronize ();
+                        logger->rings[idx]->tail += best->size;
+                }
+
+                gettimeofday (&now, NULL);
+                if (logger->repeats &&
+                    (final || (now.tv_sec - logger->last->tv.tv_sec) >=
+                     ctx->log.flush_timeout))
+                        gf_log_logger_flush_repeats (logger, fp);
+
+                if (dropped) {
+                        ctx->log.dropped += dropped;
+                        i = gf_log_rec_fill (&note.rec, GF_LOG_WARNING,
+                                             "logging.c", __FUNCTION__,
+                                             __LINE__, 0, "", "logging", &now);
+                        snprintf (GF_LOG_REC_STR (&note.rec, i),
+                                  sizeof (note) - sizeof (note.rec) - i,
+                                  "dropped %"PRIu64" messages, increase "
+                                  "log-buf-size", dropped);
+                        gf_log_write_rec (ctx, fp, &note.rec, 0, NULL);
+                }
+
+                fflush (fp);
+        }
+        pthread_mutex_unlock (&ctx->log.logfile_mutex);
+}
+
+static int
+gf_log_pending (gf_log_handle_t *log)
+{
+        gf_log_ring_t *ring = NULL;
+
+        list_for_each_entry (ring, &log->rings, list) {
+                if (ring->head != ring->tail)
+                        return 1;
+        }
+
+        return 0;
+}
+
+static void *
+gf_log_logger (void *data)
+{
+        gf_log_logger_t  logger = {0,};
+        gf_log_handle_t *log    = NULL;
+        struct timespec  ts     = {0,};
+        int              stop   = 0;
+
+        logger.ctx = data;
+        log = &logger.ctx->log;
+
+        for (;;) {
+                gf_log_logger_drain (&logger, stop);
+                if (stop)
+                        break;
+
+                pthread_mutex_lock (&log->logger_lock);
+                {
+                        /* producers only signal an idle logger, without
+                         * the lock: a missed wakeup costs a second */
+                        log->logger_idle = 1;
+                        __sync_synchronize ();
+                        if (!log->logger_stop && !gf_log_pending (log)) {
+                                ts.tv_sec = time (NULL) + 1;
+                                ts.tv_nsec = 0;
+                                pthread_cond_timedwait (&log->logger_cond,
+                                                        &log->logger_lock,
+                                                        &ts);
+                        }
+                        log->logger_idle = 0;
+                        stop = log->logger_stop;
+                }
+                pthread_mutex_unlock (&log->logger_lock);
+        }
+
+        FREE (logger.rings);
+        FREE (logger.ends);
+        FREE (logger.last);
+
+        return NULL;
+}
+
+int
+gf_log_set_logmode (gf_log_mode_t mode)
+{
+        glusterfs_ctx_t *ctx = THIS->ctx;
+        gf_log_handle_t *log = &ctx->log;
+        int              ret = 0;
+
+        if (mode == GF_LOG_MODE_ASYNC) {
+                pthread_mutex_lock (&log->logger_lock);
+                {
+                        if (!log->logger_running && !log->logger_stop) {
+                                ret = pthread_create (&log->logger, NULL,
+                                                      gf_log_logger, ctx);
+                                if (ret == 0)
+                                        log->logger_running = 1;
+                        }
+                        ret = log->logger_running ? 0 : -1;
+                }
+                pthread_mutex_unlock (&log->logger_lock);
+
+                if (ret)
+                        return -1;
+        }
+
+        /* rings left over from async mode are still written out */
+        log->logmode = mode;
+
+        return 0;
+}
+
+void
+gf_log_set_logformat (gf_log_format_t format)
+{
+        THIS->ctx->log.logformat = format;
+}
+
+void
+gf_log_set_log_buf_size (uint32_t buf_size)
+{
+        uint32_t size = GF_LOG_BUF_SIZE_MIN;
+
+        /* rings are indexed by masking */
+        while (size < buf_size && size < (1U << 31))
+                size <<= 1;
+
+        THIS->ctx->log.buf_size = size;
+}
+
+void
+gf_log_set_log_flush_timeout (uint32_t timeout)
+{
+        THIS->ctx->log.flush_timeout = timeout;
+}
+
+/* front of a ring for the crash handler, which cannot trust the records:
+ * a torn one drops what is left of the ring */
+static gf_log_rec_t *
+gf_log_ring_front_crash (gf_log_ring_t *ring)
+{
+        gf_log_rec_t *rec = NULL;
+
+        while (ring->tail < ring->head) {
+                rec = (gf_log_rec_t *)(ring->buf +
+                                       (ring->tail & (ring->size - 1)));
+                if ((rec->size < sizeof (*rec)) || (rec->size > ring->size) ||
+                    (rec->size & 7)) {
+                        ring->tail = ring->head;
+                        break;
+                }
+                if (rec->level != GF_LOG_REC_PAD) {
+                        if (rec->level > GF_LOG_TRACE) {
+                                ring->tail = ring->head;
+                                break;
+                        }
+                        return rec;
+                }
+                ring->tail += rec->size;
+        }
+
+        return NULL;
+}
+
+/* for the crash handler: writes out whatever is still queued on the rings,
+ * merged in time order, straight to fp. No locks are taken and nothing is
+ * allocated, since the crashing thread may hold either, so this is best
+ * effort: the logger may write some of the same messages out again. */
+void
+gf_log_crash_drain (void *data, FILE *fp)
+{
+        glusterfs_ctx_t *ctx   = data;
+        gf_log_ring_t   *ring  = NULL;
+        gf_log_ring_t   *from  = NULL;
+        gf_log_rec_t    *rec   = NULL;
+        gf_log_rec_t    *best  = NULL;
+        int              limit = 0;
+
+        /* bounded, in case the list itself is garbage */
+        for (limit = 1 << 20; limit > 0; limit--) {
+                best = NULL;
+                list_for_each_entry (ring, &ctx->log.rings, list) {
+                        rec = gf_log_ring_front_crash (ring);
+                        if (rec && (!best ||
+                                    timercmp (&rec->tv, &best->tv, <))) {
+                                best = rec;
+                                from = ring;
+                        }
+                }
+                if (!best)
+                        break;
+
+                gf_log_write_rec (ctx, fp, best, 0, NULL);
+                from->tail += best->size;
+        }
+
+        fflush (fp);
+}
+
+/* writes out everything queued and goes back to synchronous logging, for
+ * use on exit */
+void
+gf_log_flush (void)
+{
+        gf_log_handle_t *log     = &THIS->ctx->log;
+        int              running = 0;
+
+        pthread_mutex_lock (&log->logger_lock);
+        {
+                log->logmode = GF_LOG_MODE_SYNC;
+                log->logger_stop = 1;
+                running = log->logger_running;
+                pthread_cond_signal (&log->logger_cond);
+        }
+        pthread_mutex_unlock (&log->logger_lock);
+
+        if (running)
+                pthread_join (log->logger, NULL);
+}
+
+void
+gf_log_stats_dump (void *data)
+{
+        glusterfs_ctx_t *ctx    = data;
+        gf_log_ring_t   *ring   = NULL;
+        uint64_t         queued = 0;
+        int              rings  = 0;
+
+        if (!ctx)
+                return;
+
+        pthread_mutex_lock (&ctx->log.logger_lock);
+        {
+                list_for_each_entry (ring, &ctx->log.rings, list) {
+                        queued += ring->head - ring->tail;
+                        rings++;
+                }
+        }
+        pthread_mutex_unlock (&ctx->log.logger_lock);
+
+        gf_proc_dump_add_section ("logging");
+        gf_proc_dump_write ("mode", "%s",
+                            (ctx->log.logmode == GF_LOG_MODE_ASYNC) ?
+                            "async" : "sync");
+        gf_proc_dump_write ("format", "%s",
+                            (ctx->log.logformat == GF_LOG_FORMAT_JSON) ?
+                            "json" : "text");
+        gf_proc_dump_write ("buf_size", "%u", ctx->log.buf_size);
+        gf_proc_dump_write ("flush_timeout", "%u", ctx->log.flush_timeout);
+        gf_proc_dump_write ("rings", "%d", rings);
+        gf_proc_dump_write ("queued_bytes", "%"PRIu64, queued);
+        gf_proc_dump_write ("dropped", "%"PRIu64, ctx->log.dropped);
+        gf_proc_dump_write ("suppressed", "%"PRIu64, ctx->log.suppressed);
+}
+
 void
 set_sys_log_level (gf_loglevel_t level)
 {
@@ -357,6 +1155,16 @@ _gf_log_callingfn (const char *domain, const char *file, const char *function,
         } while (0);
 #endif /* HAVE_BACKTRACE */
 
+        if (ctx->log.logmode == GF_LOG_MODE_ASYNC &&
+            level > GF_LOG_CRITICAL) {
+                va_start (ap, fmt);
+                ret = gf_log_enqueue (ctx, this, domain, file, function, line,
+                                      level, callstr, fmt, ap);
+                va_end (ap);
+                if (ret == 0)
+                        goto out;
+        }
+
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
@@ -426,7 +1234,6 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
          gf_loglevel_t level, const char *fmt, ...)
 {
         const char    *basename = NULL;
-        FILE          *new_logfile = NULL;
         va_list        ap;
         char           timestr[256] = {0,};
         struct timeval tv = {0,};
@@ -435,7 +1242,6 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
         char          *msg  = NULL;
         size_t         len  = 0;
         int            ret  = 0;
-        int            fd   = -1;
         xlator_t      *this = NULL;
         glusterfs_ctx_t *ctx = NULL;
 
@@ -469,38 +1275,23 @@ _gf_log (const char *domain, const char *file, const char *function, int line,
         }
 
 
+        if (ctx->log.logmode == GF_LOG_MODE_ASYNC &&
+            level > GF_LOG_CRITICAL) {
+                va_start (ap, fmt);
+                ret = gf_log_enqueue (ctx, this, domain, file, function, line,
+                                      level, "", fmt, ap);
+                va_end (ap);
+                if (ret == 0)
+                        goto out;
+        }
+
         if (ctx->log.logrotate) {
                 ctx->log.logrotate = 0;
 
-                fd = open (ctx->log.filename,
-                           O_CREAT | O_RDONLY, S_IRUSR | S_IWUSR);
-                if (fd < 0) {
-                        gf_log ("logrotate", GF_LOG_ERROR,
-                                "%s", strerror (errno));
+                if (gf_log_rotate (ctx) == -1)
                         return -1;
-                }
-                close (fd);
-
-                new_logfile = fopen (ctx->log.filename, "a");
-                if (!new_logfile) {
-                        gf_log ("logrotate", GF_LOG_CRITICAL,
-                                "failed to open logfile %s (%s)",
-                                ctx->log.filename, strerror (errno));
-                        goto log;
-                }
-
-                pthread_mutex_lock (&ctx->log.logfile_mutex);
-                {
-                        if (ctx->log.logfile)
-                                fclose (ctx->log.logfile);
-
-                        ctx->log.gf_log_logfile = ctx->log.logfile = new_logfile;
-                }
-                pthread_mutex_unlock (&ctx->log.logfile_mutex);
-
         }
 
-log:
         ret = gettimeofday (&tv, NULL);
         if (-1 == ret)
                 goto out;
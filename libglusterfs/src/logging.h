@@ -19,6 +19,8 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <pthread.h>
+#include "list.h"
 
 #ifdef GF_DARWIN_HOST_OS
 #define GF_PRI_FSBLK       "u"
@@ -59,6 +61,20 @@ typedef enum {
         GF_LOG_TRACE,      /* full trace of operation */
 } gf_loglevel_t;
 
+typedef enum {
+        GF_LOG_MODE_SYNC,  /* written out by the thread logging the message */
+        GF_LOG_MODE_ASYNC, /* queued on the thread, written out by the logger */
+} gf_log_mode_t;
+
+typedef enum {
+        GF_LOG_FORMAT_TEXT,
+        GF_LOG_FORMAT_JSON, /* one object per line */
+} gf_log_format_t;
+
+#define GF_LOG_BUF_SIZE_DEFAULT       (64 * 1024)
+#define GF_LOG_BUF_SIZE_MIN           4096
+#define GF_LOG_FLUSH_TIMEOUT_DEFAULT  120
+
 typedef struct gf_log_handle_ {
         pthread_mutex_t  logfile_mutex;
         uint8_t          logrotate;
@@ -72,6 +88,24 @@ typedef struct gf_log_handle_ {
         char            *cmd_log_filename;
         FILE            *cmdlogfile;
 
+        /* async logging: every thread queues its messages on a ring of its
+         * own, the logger thread merges them in time order and writes them
+         * out. Messages not fitting in a ring are dropped and counted. */
+        gf_log_mode_t    logmode;
+        gf_log_format_t  logformat;
+        uint32_t         buf_size;      /* of each ring, power of two */
+        uint32_t         flush_timeout; /* secs repeats of a message are
+                                           held back, 0 writes them all */
+        pthread_key_t    ring_key;
+        pthread_mutex_t  logger_lock;   /* rings list, logger state */
+        pthread_cond_t   logger_cond;
+        struct list_head rings;
+        pthread_t        logger;
+        char             logger_running;
+        char             logger_stop;
+        volatile char    logger_idle;
+        uint64_t         dropped;
+        uint64_t         suppressed;
 } gf_log_handle_t;
 
 void gf_log_globals_init (void *ctx);
@@ -81,6 +115,14 @@ void gf_log_logrotate (int signum);
 
 void gf_log_cleanup (void);
 
+int gf_log_set_logmode (gf_log_mode_t mode);
+void gf_log_set_logformat (gf_log_format_t format);
+void gf_log_set_log_buf_size (uint32_t buf_size);
+void gf_log_set_log_flush_timeout (uint32_t timeout);
+void gf_log_flush (void);
+void gf_log_crash_drain (void *ctx, FILE *fp);
+void gf_log_stats_dump (void *ctx);
+
 int _gf_log (const char *domain, const char *file,
              const char *function, int32_t line, gf_loglevel_t level,
              const char *fmt, ...)
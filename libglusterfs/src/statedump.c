@@ -765,6 +765,8 @@ gf_proc_dump_info (int signum, glusterfs_ctx_t *ctx)
         if (GF_PROC_DUMP_IS_OPTION_ENABLED (callpool))
                 gf_proc_dump_pending_frames (ctx->pool);
 
+        gf_log_stats_dump (ctx);
+
         if (ctx->master) {
                 gf_proc_dump_add_section ("fuse");
                 gf_proc_dump_xlator_info (ctx->master);
@@ -516,6 +516,9 @@ entry_copy (gf_dirent_t *source)
         sink->d_type = source->d_type;
         sink->d_stat = source->d_stat;
 
+        if (source->inode)
+                sink->inode = inode_ref (source->inode);
+
         return sink;
 }
 
@@ -1145,6 +1148,9 @@ syncop_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         args->op_ret   = op_ret;
         args->op_errno = op_errno;
 
+        if (buf)
+                args->iatt1 = *buf;
+
         __wake (args);
 
         return 0;
@@ -1152,13 +1158,16 @@ syncop_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
 int
 syncop_create (xlator_t *subvol, loc_t *loc, int32_t flags, mode_t mode,
-               fd_t *fd, dict_t *xdata)
+               fd_t *fd, dict_t *xdata, struct iatt *iatt)
 {
         struct syncargs args = {0, };
 
         SYNCOP (subvol, (&args), syncop_create_cbk, subvol->fops->create,
                 loc, flags, mode, 0, fd, xdata);
 
+        if (iatt)
+                *iatt = args.iatt1;
+
         errno = args.op_errno;
         return args.op_ret;
 
@@ -1557,6 +1566,9 @@ syncop_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         args->op_ret   = op_ret;
         args->op_errno = op_errno;
 
+        if (buf)
+                args->iatt1 = *buf;
+
         __wake (args);
 
         return 0;
@@ -1564,13 +1576,17 @@ syncop_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
 
 int
-syncop_mkdir (xlator_t *subvol, loc_t *loc, mode_t mode, dict_t *dict)
+syncop_mkdir (xlator_t *subvol, loc_t *loc, mode_t mode, dict_t *dict,
+              struct iatt *iatt)
 {
         struct syncargs args = {0, };
 
         SYNCOP (subvol, (&args), syncop_mkdir_cbk, subvol->fops->mkdir,
                 loc, mode, 0, dict);
 
+        if (iatt)
+                *iatt = args.iatt1;
+
         errno = args.op_errno;
         return args.op_ret;
 
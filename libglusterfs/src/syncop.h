@@ -228,7 +228,9 @@ int syncop_removexattr (xlator_t *subvol, loc_t *loc, const char *name);
 int syncop_fremovexattr (xlator_t *subvol, fd_t *fd, const char *name);
 
 int syncop_create (xlator_t *subvol, loc_t *loc, int32_t flags, mode_t mode,
-                   fd_t *fd, dict_t *dict);
+                   fd_t *fd, dict_t *dict,
+                   /* out */
+                   struct iatt *iatt);
 int syncop_open (xlator_t *subvol, loc_t *loc, int32_t flags, fd_t *fd);
 int syncop_close (fd_t *fd);
 
@@ -258,7 +260,9 @@ int syncop_symlink (xlator_t *subvol, loc_t *loc, const char *newpath,
 int syncop_readlink (xlator_t *subvol, loc_t *loc, char **buffer, size_t size);
 int syncop_mknod (xlator_t *subvol, loc_t *loc, mode_t mode, dev_t rdev,
                   dict_t *dict);
-int syncop_mkdir (xlator_t *subvol, loc_t *loc, mode_t mode, dict_t *dict);
+int syncop_mkdir (xlator_t *subvol, loc_t *loc, mode_t mode, dict_t *dict,
+                  /* out */
+                  struct iatt *iatt);
 int syncop_link (xlator_t *subvol, loc_t *oldloc, loc_t *newloc);
 int syncop_fsyncdir (xlator_t *subvol, fd_t *fd, int datasync);
 int syncop_access (xlator_t *subvol, loc_t *loc, int32_t mask);
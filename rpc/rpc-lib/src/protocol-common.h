@@ -164,6 +164,10 @@ enum glusterd_mgmt_procnum {
         GLUSTERD_MGMT_CLUSTER_UNLOCK,
         GLUSTERD_MGMT_STAGE_OP,
         GLUSTERD_MGMT_COMMIT_OP,
+        GLUSTERD_MGMT_VOLUME_LOCK,
+        GLUSTERD_MGMT_VOLUME_UNLOCK,
+        GLUSTERD_MGMT_VOLUME_STAGE_OP,
+        GLUSTERD_MGMT_VOLUME_COMMIT_OP,
         GLUSTERD_MGMT_MAXVALUE,
 };
 
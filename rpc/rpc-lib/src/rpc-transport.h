@@ -207,6 +207,11 @@ struct rpc_transport {
 
         uint64_t                   total_bytes_read;
         uint64_t                   total_bytes_write;
+        /* read and write syscalls it took to move the messages */
+        uint64_t                   total_read_calls;
+        uint64_t                   total_write_calls;
+        uint64_t                   total_msgs_read;
+        uint64_t                   total_msgs_write;
 
         struct list_head           list;
         int                        bind_insecure;
@@ -244,6 +244,134 @@ gf_rdma_destroy_post (gf_rdma_post_t *post)
 }
 
 
+static gf_rdma_arena_mr_t *
+__gf_rdma_arena_mr_find (gf_rdma_device_t *device,
+                         struct iobuf_arena *iobuf_arena)
+{
+        gf_rdma_arena_mr_t *arena_mr = NULL;
+
+        list_for_each_entry (arena_mr, &device->all_mr, list) {
+                if (arena_mr->iobuf_arena == iobuf_arena)
+                        return arena_mr;
+        }
+
+        return NULL;
+}
+
+
+/* iobuf arenas are registered with every device once, when they are mapped
+ * (or when the device comes up), so that payloads living in iobufs can be
+ * used as the local side of RDMA reads and writes without a registration
+ * per request. The registration is for local access only: an rkey covering
+ * a whole arena would let any peer read and write every iobuf of the
+ * process. Chunks advertised to a peer are still registered per request and
+ * cover only that request's payload.
+ */
+static int
+gf_rdma_register_arena (struct iobuf_arena *iobuf_arena, void *data)
+{
+        glusterfs_ctx_t    *ctx      = NULL;
+        gf_rdma_device_t   *device   = NULL;
+        gf_rdma_arena_mr_t *arena_mr = NULL;
+
+        ctx = data;
+
+        for (device = ctx->ib; device != NULL; device = device->next) {
+                if (device->pd == NULL)
+                        continue;
+
+                pthread_mutex_lock (&device->all_mr_lock);
+                {
+                        if (__gf_rdma_arena_mr_find (device, iobuf_arena))
+                                goto unlock;
+
+                        arena_mr = GF_CALLOC (1, sizeof (*arena_mr),
+                                              gf_common_mt_rdma_arena_mr);
+                        if (arena_mr == NULL)
+                                goto unlock;
+
+                        arena_mr->mr = ibv_reg_mr (device->pd,
+                                                   iobuf_arena->mem_base,
+                                                   iobuf_arena->arena_size,
+                                                   IBV_ACCESS_LOCAL_WRITE);
+                        if (arena_mr->mr == NULL) {
+                                gf_log (GF_RDMA_LOG_NAME, GF_LOG_WARNING,
+                                        "registering iobuf arena of %zu bytes "
+                                        "with %s failed (%s)",
+                                        iobuf_arena->arena_size,
+                                        device->device_name, strerror (errno));
+                                GF_FREE (arena_mr);
+                                goto unlock;
+                        }
+
+                        arena_mr->iobuf_arena = iobuf_arena;
+                        list_add (&arena_mr->list, &device->all_mr);
+                }
+        unlock:
+                pthread_mutex_unlock (&device->all_mr_lock);
+        }
+
+        return 0;
+}
+
+
+static int
+gf_rdma_deregister_arena (struct iobuf_arena *iobuf_arena, void *data)
+{
+        glusterfs_ctx_t    *ctx      = NULL;
+        gf_rdma_device_t   *device   = NULL;
+        gf_rdma_arena_mr_t *arena_mr = NULL;
+
+        ctx = data;
+
+        for (device = ctx->ib; device != NULL; device = device->next) {
+                pthread_mutex_lock (&device->all_mr_lock);
+                {
+                        arena_mr = __gf_rdma_arena_mr_find (device,
+                                                            iobuf_arena);
+                        if (arena_mr)
+                                list_del_init (&arena_mr->list);
+                }
+                pthread_mutex_unlock (&device->all_mr_lock);
+
+                if (arena_mr) {
+                        ibv_dereg_mr (arena_mr->mr);
+                        GF_FREE (arena_mr);
+                }
+        }
+
+        return 0;
+}
+
+
+/* memory region of the arena holding [ptr, ptr + len), if it has one. The
+ * arena stays mapped while the caller holds a ref on the iobuf.
+ */
+static struct ibv_mr *
+gf_rdma_get_arena_mr (gf_rdma_device_t *device, void *ptr, size_t len)
+{
+        gf_rdma_arena_mr_t *arena_mr = NULL;
+        struct ibv_mr      *mr       = NULL;
+        char               *base     = NULL;
+
+        pthread_mutex_lock (&device->all_mr_lock);
+        {
+                list_for_each_entry (arena_mr, &device->all_mr, list) {
+                        base = arena_mr->iobuf_arena->mem_base;
+                        if (((char *)ptr >= base)
+                            && ((char *)ptr + len
+                                <= base + arena_mr->iobuf_arena->arena_size)) {
+                                mr = arena_mr->mr;
+                                break;
+                        }
+                }
+        }
+        pthread_mutex_unlock (&device->all_mr_lock);
+
+        return mr;
+}
+
+
 static int32_t
 __gf_rdma_quota_get (gf_rdma_peer_t *peer)
 {
@@ -712,7 +840,7 @@ out:
 
 
 static inline void
-__gf_rdma_deregister_mr (struct ibv_mr **mr, int count)
+__gf_rdma_deregister_mr (struct ibv_mr **mr, uint32_t shared, int count)
 {
         int i = 0;
 
@@ -721,6 +849,8 @@ __gf_rdma_deregister_mr (struct ibv_mr **mr, int count)
         }
 
         for (i = 0; i < count; i++) {
+                if (shared & (1 << i))
+                        continue;
                 ibv_dereg_mr (mr[i]);
         }
 
@@ -776,7 +906,7 @@ __gf_rdma_request_context_destroy (gf_rdma_request_context_t *context)
 
         peer = context->peer;
 
-        __gf_rdma_deregister_mr (context->mr, context->mr_count);
+        __gf_rdma_deregister_mr (context->mr, 0, context->mr_count);
 
         priv = peer->trans->private;
 
@@ -816,7 +946,7 @@ gf_rdma_post_context_destroy (gf_rdma_post_context_t *ctx)
                 goto out;
         }
 
-        __gf_rdma_deregister_mr (ctx->mr, ctx->mr_count);
+        __gf_rdma_deregister_mr (ctx->mr, ctx->mr_shared, ctx->mr_count);
 
         if (ctx->iobref != NULL) {
                 iobref_unref (ctx->iobref);
@@ -1290,6 +1420,15 @@ __gf_rdma_register_local_mr_for_rdma (gf_rdma_peer_t *peer,
                  * Infiniband Architecture Specification Volume 1
                  * (Release 1.2.1)
                  */
+                ctx->mr[ctx->mr_count] = gf_rdma_get_arena_mr (device,
+                                                      vector[i].iov_base,
+                                                      vector[i].iov_len);
+                if (ctx->mr[ctx->mr_count] != NULL) {
+                        ctx->mr_shared |= (1 << ctx->mr_count);
+                        ctx->mr_count++;
+                        continue;
+                }
+
                 ctx->mr[ctx->mr_count] = ibv_reg_mr (device->pd,
                                                      vector[i].iov_base,
                                                      vector[i].iov_len,
@@ -3425,103 +3564,117 @@ out:
 }
 
 
-static void *
-gf_rdma_recv_completion_proc (void *data)
+/* Completion channels are non-blocking and watched by the event pool. An
+ * event only says that the CQ has something; it is re-armed before it is
+ * polled empty, so nothing that completes in between is missed.
+ */
+static void
+gf_rdma_drain_completions (gf_rdma_device_t *device,
+                           struct ibv_comp_channel *chan,
+                           void (*handler) (gf_rdma_device_t *device,
+                                            struct ibv_wc *wc))
 {
-        struct ibv_comp_channel *chan      = NULL;
-        gf_rdma_device_t        *device    = NULL;;
-        gf_rdma_post_t          *post      = NULL;
-        gf_rdma_peer_t          *peer      = NULL;
-        struct ibv_cq           *event_cq  = NULL;
-        struct ibv_wc            wc        = {0, };
-        void                    *event_ctx = NULL;
-        int32_t                  ret       = 0;
+        struct ibv_cq *event_cq  = NULL;
+        void          *event_ctx = NULL;
+        struct ibv_wc  wc[GF_RDMA_WC_BATCH];
+        int32_t        ret       = 0;
+        int            i         = 0;
 
-        chan = data;
+        while (ibv_get_cq_event (chan, &event_cq, &event_ctx) == 0) {
+                ibv_ack_cq_events (event_cq, 1);
 
-        while (1) {
-                ret = ibv_get_cq_event (chan, &event_cq, &event_ctx);
+                ret = ibv_req_notify_cq (event_cq, 0);
                 if (ret) {
                         gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "ibv_get_cq_event failed, terminating recv "
-                                "thread %d (%d)", ret, errno);
-                        continue;
+                                "ibv_req_notify_cq on %s failed: %d (%d)",
+                                device->device_name, ret, errno);
                 }
 
-                device = event_ctx;
+                while ((ret = ibv_poll_cq (event_cq, GF_RDMA_WC_BATCH,
+                                           wc)) > 0) {
+                        for (i = 0; i < ret; i++)
+                                handler (device, &wc[i]);
+                }
 
-                ret = ibv_req_notify_cq (event_cq, 0);
-                if (ret) {
+                if (ret < 0) {
                         gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "ibv_req_notify_cq on %s failed, terminating "
-                                "recv thread: %d (%d)",
+                                "ibv_poll_cq on `%s' returned error "
+                                "(ret = %d, errno = %d)",
                                 device->device_name, ret, errno);
-                        continue;
                 }
+        }
 
-                device = (gf_rdma_device_t *) event_ctx;
+        if (errno != EAGAIN) {
+                gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
+                        "ibv_get_cq_event on `%s' failed (%s)",
+                        device->device_name, strerror (errno));
+        }
+}
 
-                while ((ret = ibv_poll_cq (event_cq, 1, &wc)) > 0) {
-                        post = (gf_rdma_post_t *) (long) wc.wr_id;
 
-                        pthread_mutex_lock (&device->qpreg.lock);
-                        {
-                                peer = __gf_rdma_lookup_peer (device,
-                                                              wc.qp_num);
-
-                                /*
-                                 * keep a refcount on transport so that it
-                                 * does not get freed because of some error
-                                 * indicated by wc.status till we are done
-                                 * with usage of peer and thereby that of trans.
-                                 */
-                                if (peer != NULL) {
-                                        rpc_transport_ref (peer->trans);
-                                }
-                        }
-                        pthread_mutex_unlock (&device->qpreg.lock);
+static void
+gf_rdma_handle_recv_completion (gf_rdma_device_t *device, struct ibv_wc *wc)
+{
+        gf_rdma_post_t          *post      = NULL;
+        gf_rdma_peer_t          *peer      = NULL;
 
-                        if (wc.status != IBV_WC_SUCCESS) {
-                                gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                        "recv work request on `%s' returned "
-                                        "error (%d)", device->device_name,
-                                        wc.status);
-                                if (peer) {
-                                        rpc_transport_unref (peer->trans);
-                                        rpc_transport_disconnect (peer->trans);
-                                }
+        post = (gf_rdma_post_t *) (long) wc->wr_id;
 
-                                if (post) {
-                                        gf_rdma_post_unref (post);
-                                }
-                                continue;
-                        }
+        pthread_mutex_lock (&device->qpreg.lock);
+        {
+                peer = __gf_rdma_lookup_peer (device, wc->qp_num);
 
-                        if (peer) {
-                                gf_rdma_process_recv (peer, &wc);
-                                rpc_transport_unref (peer->trans);
-                        } else {
-                                gf_log (GF_RDMA_LOG_NAME,
-                                        GF_LOG_DEBUG,
-                                        "could not lookup peer for qp_num: %d",
-                                        wc.qp_num);
-                        }
+                /*
+                 * keep a refcount on transport so that it
+                 * does not get freed because of some error
+                 * indicated by wc.status till we are done
+                 * with usage of peer and thereby that of trans.
+                 */
+                if (peer != NULL) {
+                        rpc_transport_ref (peer->trans);
+                }
+        }
+        pthread_mutex_unlock (&device->qpreg.lock);
 
-                        gf_rdma_post_unref (post);
+        if (wc->status != IBV_WC_SUCCESS) {
+                gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
+                        "recv work request on `%s' returned "
+                        "error (%d)", device->device_name,
+                        wc->status);
+                if (peer) {
+                        rpc_transport_unref (peer->trans);
+                        rpc_transport_disconnect (peer->trans);
                 }
 
-                if (ret < 0) {
-                        gf_log (GF_RDMA_LOG_NAME,
-                                GF_LOG_ERROR,
-                                "ibv_poll_cq on `%s' returned error "
-                                "(ret = %d, errno = %d)",
-                                device->device_name, ret, errno);
-                        continue;
+                if (post) {
+                        gf_rdma_post_unref (post);
                 }
-                ibv_ack_cq_events (event_cq, 1);
+                return;
         }
 
-        return NULL;
+        if (peer) {
+                gf_rdma_process_recv (peer, wc);
+                rpc_transport_unref (peer->trans);
+        } else {
+                gf_log (GF_RDMA_LOG_NAME,
+                        GF_LOG_DEBUG,
+                        "could not lookup peer for qp_num: %d",
+                        wc->qp_num);
+        }
+
+        gf_rdma_post_unref (post);
+}
+
+
+static int
+gf_rdma_recv_completion_event (int fd, int idx, void *data,
+                               int poll_in, int poll_out, int poll_err)
+{
+        gf_rdma_device_t *device = data;
+
+        gf_rdma_drain_completions (device, device->recv_chan,
+                                   gf_rdma_handle_recv_completion);
+        return 0;
 }
 
 
@@ -3608,115 +3761,85 @@ out:
 }
 
 
-static void *
-gf_rdma_send_completion_proc (void *data)
+static void
+gf_rdma_handle_send_completion (gf_rdma_device_t *device, struct ibv_wc *wc)
 {
-        struct ibv_comp_channel *chan       = NULL;
         gf_rdma_post_t          *post       = NULL;
         gf_rdma_peer_t          *peer       = NULL;
-        struct ibv_cq           *event_cq   = NULL;
-        void                    *event_ctx  = NULL;
-        gf_rdma_device_t        *device     = NULL;
-        struct ibv_wc            wc         = {0, };
         char                     is_request = 0;
         int32_t                  ret        = 0, quota_ret = 0;
 
-        chan = data;
-        while (1) {
-                ret = ibv_get_cq_event (chan, &event_cq, &event_ctx);
-                if (ret) {
-                        gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "ibv_get_cq_event on failed, terminating "
-                                "send thread: %d (%d)", ret, errno);
-                        continue;
-                }
+        post = (gf_rdma_post_t *) (long) wc->wr_id;
 
-                device = event_ctx;
+        pthread_mutex_lock (&device->qpreg.lock);
+        {
+                peer = __gf_rdma_lookup_peer (device, wc->qp_num);
 
-                ret = ibv_req_notify_cq (event_cq, 0);
-                if (ret) {
-                        gf_log (GF_RDMA_LOG_NAME,  GF_LOG_ERROR,
-                                "ibv_req_notify_cq on %s failed, terminating "
-                                "send thread: %d (%d)",
-                                device->device_name, ret, errno);
-                        continue;
+                /*
+                 * keep a refcount on transport so that it
+                 * does not get freed because of some error
+                 * indicated by wc.status, till we are done
+                 * with usage of peer and thereby that of trans.
+                 */
+                if (peer != NULL) {
+                        rpc_transport_ref (peer->trans);
                 }
+        }
+        pthread_mutex_unlock (&device->qpreg.lock);
 
-                while ((ret = ibv_poll_cq (event_cq, 1, &wc)) > 0) {
-                        post = (gf_rdma_post_t *) (long) wc.wr_id;
-
-                        pthread_mutex_lock (&device->qpreg.lock);
-                        {
-                                peer = __gf_rdma_lookup_peer (device, wc.qp_num);
-
-                                /*
-                                 * keep a refcount on transport so that it
-                                 * does not get freed because of some error
-                                 * indicated by wc.status, till we are done
-                                 * with usage of peer and thereby that of trans.
-                                 */
-                                if (peer != NULL) {
-                                        rpc_transport_ref (peer->trans);
-                                }
-                        }
-                        pthread_mutex_unlock (&device->qpreg.lock);
-
-                        if (wc.status != IBV_WC_SUCCESS) {
-                                gf_rdma_handle_failed_send_completion (peer, &wc);
-                        } else {
-                                gf_rdma_handle_successful_send_completion (peer,
-                                                                           &wc);
-                        }
-
-                        if (post) {
-                                is_request = post->ctx.is_request;
-
-                                ret = gf_rdma_post_unref (post);
-                                if ((ret == 0)
-                                    && (wc.status == IBV_WC_SUCCESS)
-                                    && !is_request
-                                    && (post->type == GF_RDMA_SEND_POST)
-                                    && (peer != NULL)) {
-                                        /* An GF_RDMA_RECV_POST can end up in
-                                         * gf_rdma_send_completion_proc for
-                                         * rdma-reads, and we do not take
-                                         * quota for getting an GF_RDMA_RECV_POST.
-                                         */
-
-                                        /*
-                                         * if it is request, quota is returned
-                                         * after reply has come.
-                                         */
-                                        quota_ret = gf_rdma_quota_put (peer);
-                                        if (quota_ret < 0) {
-                                                gf_log ("rdma", GF_LOG_DEBUG,
-                                                        "failed to send "
-                                                        "message");
-                                        }
-                                }
-                        }
-
-                        if (peer) {
-                                rpc_transport_unref (peer->trans);
-                        } else {
-                                gf_log (GF_RDMA_LOG_NAME, GF_LOG_DEBUG,
-                                        "could not lookup peer for qp_num: %d",
-                                        wc.qp_num);
+        if (wc->status != IBV_WC_SUCCESS) {
+                gf_rdma_handle_failed_send_completion (peer, wc);
+        } else {
+                gf_rdma_handle_successful_send_completion (peer, wc);
+        }
+
+        if (post) {
+                is_request = post->ctx.is_request;
+
+                ret = gf_rdma_post_unref (post);
+                if ((ret == 0)
+                    && (wc->status == IBV_WC_SUCCESS)
+                    && !is_request
+                    && (post->type == GF_RDMA_SEND_POST)
+                    && (peer != NULL)) {
+                        /* An GF_RDMA_RECV_POST can end up in
+                         * gf_rdma_handle_send_completion for
+                         * rdma-reads, and we do not take
+                         * quota for getting an GF_RDMA_RECV_POST.
+                         */
+
+                        /*
+                         * if it is request, quota is returned
+                         * after reply has come.
+                         */
+                        quota_ret = gf_rdma_quota_put (peer);
+                        if (quota_ret < 0) {
+                                gf_log ("rdma", GF_LOG_DEBUG,
+                                        "failed to send "
+                                        "message");
                         }
                 }
+        }
 
-                if (ret < 0) {
-                        gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "ibv_poll_cq on `%s' returned error (ret = %d,"
-                                " errno = %d)",
-                                device->device_name, ret, errno);
-                        continue;
-                }
-
-                ibv_ack_cq_events (event_cq, 1);
+        if (peer) {
+                rpc_transport_unref (peer->trans);
+        } else {
+                gf_log (GF_RDMA_LOG_NAME, GF_LOG_DEBUG,
+                        "could not lookup peer for qp_num: %d",
+                        wc->qp_num);
         }
+}
 
-        return NULL;
+
+static int
+gf_rdma_send_completion_event (int fd, int idx, void *data,
+                               int poll_in, int poll_out, int poll_err)
+{
+        gf_rdma_device_t *device = data;
+
+        gf_rdma_drain_completions (device, device->send_chan,
+                                   gf_rdma_handle_send_completion);
+        return 0;
 }
 
 
@@ -3821,6 +3944,28 @@ gf_rdma_queue_init (gf_rdma_queue_t *queue)
 }
 
 
+static int
+gf_rdma_register_comp_channel (glusterfs_ctx_t *ctx, gf_rdma_device_t *device,
+                               struct ibv_comp_channel *chan,
+                               event_handler_t handler)
+{
+        int flags = 0;
+
+        flags = fcntl (chan->fd, F_GETFL);
+        if ((flags == -1)
+            || (fcntl (chan->fd, F_SETFL, flags | O_NONBLOCK) == -1)) {
+                gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
+                        "%s: could not make completion channel "
+                        "non-blocking (%s)", device->device_name,
+                        strerror (errno));
+                return -1;
+        }
+
+        return event_register (ctx->event_pool, chan->fd, handler, device,
+                               1, 0);
+}
+
+
 static gf_rdma_device_t *
 gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
 {
@@ -3832,6 +3977,8 @@ gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
         uint8_t            active_port = 0;
         int32_t            ret         = 0;
         int32_t            i           = 0;
+        int                send_idx    = -1;
+        int                recv_idx    = -1;
         gf_rdma_device_t  *trav        = NULL;
 
         priv        = this->private;
@@ -3859,6 +4006,8 @@ gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
                 priv->device = trav;
 
                 trav->context = ibctx;
+                INIT_LIST_HEAD (&trav->all_mr);
+                pthread_mutex_init (&trav->all_mr_lock, NULL);
 
                 ret = ib_get_active_port (trav->context);
 
@@ -3915,9 +4064,6 @@ gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
                 trav->device_name = gf_strdup (device_name);
                 trav->port = port;
 
-                trav->next = ctx->ib;
-                ctx->ib = trav;
-
                 trav->send_chan = ibv_create_comp_channel (trav->context);
                 if (!trav->send_chan) {
                         gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
@@ -4023,33 +4169,26 @@ gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
                         return NULL;
                 }
 
-                /* completion threads */
-                ret = pthread_create (&trav->send_thread,
-                                      NULL,
-                                      gf_rdma_send_completion_proc,
-                                      trav->send_chan);
-                if (ret) {
-                        gf_rdma_destroy_posts (this);
-                        mem_pool_destroy (trav->ioq_pool);
-                        mem_pool_destroy (trav->request_ctx_pool);
-                        mem_pool_destroy (trav->reply_info_pool);
-                        ibv_dealloc_pd (trav->pd);
-                        gf_rdma_destroy_cq (this);
-                        ibv_destroy_comp_channel (trav->recv_chan);
-                        ibv_destroy_comp_channel (trav->send_chan);
-                        GF_FREE ((char *)trav->device_name);
-                        GF_FREE (trav);
-
-                        gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "could not create send completion thread");
-                        return NULL;
+                /* qpreg */
+                pthread_mutex_init (&trav->qpreg.lock, NULL);
+                for (i=0; i<42; i++) {
+                        trav->qpreg.ents[i].next = &trav->qpreg.ents[i];
+                        trav->qpreg.ents[i].prev = &trav->qpreg.ents[i];
                 }
 
-                ret = pthread_create (&trav->recv_thread,
-                                      NULL,
-                                      gf_rdma_recv_completion_proc,
-                                      trav->recv_chan);
-                if (ret) {
+                /* completions are handled from the event pool */
+                send_idx = gf_rdma_register_comp_channel (ctx, trav,
+                                                          trav->send_chan,
+                                                          gf_rdma_send_completion_event);
+                if (send_idx != -1)
+                        recv_idx = gf_rdma_register_comp_channel (ctx, trav,
+                                                                  trav->recv_chan,
+                                                                  gf_rdma_recv_completion_event);
+                if (recv_idx == -1) {
+                        if (send_idx != -1)
+                                event_unregister (ctx->event_pool,
+                                                  trav->send_chan->fd,
+                                                  send_idx);
                         gf_rdma_destroy_posts (this);
                         mem_pool_destroy (trav->ioq_pool);
                         mem_pool_destroy (trav->request_ctx_pool);
@@ -4060,17 +4199,21 @@ gf_rdma_get_device (rpc_transport_t *this, struct ibv_context *ibctx)
                         ibv_destroy_comp_channel (trav->send_chan);
                         GF_FREE ((char *)trav->device_name);
                         GF_FREE (trav);
+
                         gf_log (GF_RDMA_LOG_NAME, GF_LOG_ERROR,
-                                "could not create recv completion thread");
+                                "could not register completion channels "
+                                "with the event pool");
                         return NULL;
                 }
 
-                /* qpreg */
-                pthread_mutex_init (&trav->qpreg.lock, NULL);
-                for (i=0; i<42; i++) {
-                        trav->qpreg.ents[i].next = &trav->qpreg.ents[i];
-                        trav->qpreg.ents[i].prev = &trav->qpreg.ents[i];
-                }
+                trav->next = ctx->ib;
+                ctx->ib = trav;
+
+                /* register the iobufs with the new device, it is looked at
+                 * for every arena mapped from now on as well */
+                iobuf_pool_set_arena_cbks (ctx->iobuf_pool,
+                                           gf_rdma_register_arena,
+                                           gf_rdma_deregister_arena, ctx);
         }
         return trav;
 }
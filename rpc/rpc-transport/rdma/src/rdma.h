@@ -41,6 +41,9 @@
 #define GF_RDMA_VERSION                1
 #define GF_RDMA_POOL_SIZE              512
 
+/* work completions taken off a CQ per ibv_poll_cq() */
+#define GF_RDMA_WC_BATCH               16
+
 /* Additional attributes */
 #define GF_RDMA_TIMEOUT                14
 #define GF_RDMA_RETRY_CNT              7
@@ -260,6 +263,8 @@ typedef struct __gf_rdma_peer gf_rdma_peer_t;
 struct __gf_rdma_post_context {
         struct ibv_mr     *mr[GF_RDMA_MAX_SEGMENTS];
         int                mr_count;
+        uint32_t           mr_shared;   /* bit i set: mr[i] is the one of an
+                                         * iobuf arena, not ours to drop */
         struct iovec       vector[MAX_IOVEC];
         int                count;
         struct iobref     *iobref;
@@ -308,6 +313,14 @@ struct __gf_rdma_qpreg {
 };
 typedef struct __gf_rdma_qpreg gf_rdma_qpreg_t;
 
+/* an iobuf arena registered with a device for as long as it is mapped */
+struct __gf_rdma_arena_mr {
+        struct list_head    list;
+        struct iobuf_arena *iobuf_arena;
+        struct ibv_mr      *mr;
+};
+typedef struct __gf_rdma_arena_mr gf_rdma_arena_mr_t;
+
 /* context per device, stored in global glusterfs_ctx_t->ib */
 struct __gf_rdma_device {
         struct __gf_rdma_device *next;
@@ -320,7 +333,8 @@ struct __gf_rdma_device {
         struct ibv_comp_channel *send_chan, *recv_chan;
         struct ibv_cq *send_cq, *recv_cq;
         gf_rdma_queue_t sendq, recvq;
-        pthread_t send_thread, recv_thread;
+        struct list_head all_mr;        /* gf_rdma_arena_mr_t */
+        pthread_mutex_t all_mr_lock;
         struct mem_pool *request_ctx_pool;
         struct mem_pool *ioq_pool;
         struct mem_pool *reply_info_pool;
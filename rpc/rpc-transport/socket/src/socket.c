@@ -246,6 +246,40 @@ out:
 #define ssl_read_one(t,b,l)  ssl_do((t),(b),(l),(SSL_trinary_func *)SSL_read)
 #define ssl_write_one(t,b,l) ssl_do((t),(b),(l),(SSL_trinary_func *)SSL_write)
 
+/*
+ * See whether OpenSSL handed the keys of the connection to the kernel.
+ * Where it did, the socket is read and written directly, with plain
+ * readv and writev, and the kernel does the encryption.
+ */
+void
+ssl_setup_ktls (rpc_transport_t *this)
+{
+	socket_private_t *priv = this->private;
+
+        priv->ssl_ktls_send = _gf_false;
+        priv->ssl_ktls_recv = _gf_false;
+
+#ifdef GF_SOCKET_KTLS
+        priv->ssl_ktls_send = BIO_get_ktls_send(SSL_get_wbio(priv->ssl_ssl));
+        /*
+         * Reading the socket directly only works while the peer sends
+         * nothing but application data, which TLS 1.2 does once the
+         * handshake is over. A record that is not gives EIO, like the
+         * alert before a disconnect should.
+         */
+        if ((SSL_version(priv->ssl_ssl) == TLS1_2_VERSION) &&
+            !SSL_has_pending(priv->ssl_ssl)) {
+                priv->ssl_ktls_recv =
+                        BIO_get_ktls_recv(SSL_get_rbio(priv->ssl_ssl));
+        }
+#endif
+
+        gf_log(this->name,GF_LOG_INFO,"kernel TLS %s",
+               priv->ssl_ktls_send ?
+               (priv->ssl_ktls_recv ? "enabled" : "enabled for sending") :
+               "not available");
+}
+
 int
 ssl_setup_connection (rpc_transport_t *this, int server)
 {
@@ -297,6 +331,7 @@ ssl_setup_connection (rpc_transport_t *this, int server)
 		NID_commonName, peer_CN, sizeof(peer_CN)-1);
 	peer_CN[sizeof(peer_CN)-1] = '\0';
 	gf_log(this->name,GF_LOG_INFO,"peer CN = %s", peer_CN);
+        ssl_setup_ktls(this);
 	return 0;
 
 	/* Error paths. */
@@ -331,11 +366,12 @@ __socket_ssl_readv (rpc_transport_t *this, struct iovec *opvector, int opcount)
 	priv = this->private;
 	sock = priv->sock;
 
-	if (priv->use_ssl) {
+	if (priv->use_ssl && !priv->ssl_ktls_recv) {
 		ret = ssl_read_one (this, opvector->iov_base, opvector->iov_len);
 	} else {
 		ret = readv (sock, opvector, opcount);
 	}
+	this->total_read_calls++;
 
 	return ret;
 }
@@ -425,6 +461,65 @@ out:
 }
 
 
+/*
+ * Write as much of @vector as fits into one TLS record, copying small
+ * elements (the record marker, RPC headers) together so that they do not
+ * go out as records of their own.
+ */
+ssize_t
+ssl_writev_one (rpc_transport_t *this, struct iovec *vector, int count)
+{
+	char    buf[GF_SOCKET_SSL_GATHER];
+	size_t  len = 0;
+	int     i = 0;
+
+	if ((count == 1) || (vector[0].iov_len + vector[1].iov_len >
+			     sizeof (buf))) {
+		return ssl_write_one (this, vector[0].iov_base,
+				      vector[0].iov_len);
+	}
+
+	for (i = 0; (i < count) && (len + vector[i].iov_len <= sizeof (buf));
+	     i++) {
+		memcpy (buf + len, vector[i].iov_base, vector[i].iov_len);
+		len += vector[i].iov_len;
+	}
+
+	return ssl_write_one (this, buf, len);
+}
+
+
+/*
+ * Write @vector to the socket, as a zero-copy send if it is large enough
+ * (see GF_SOCKET_ZEROCOPY).
+ */
+ssize_t
+__socket_sendv (rpc_transport_t *this, struct iovec *vector, int count)
+{
+        socket_private_t *priv = this->private;
+#ifdef GF_SOCKET_ZEROCOPY
+        struct msghdr     msg  = {0, };
+        ssize_t           ret  = -1;
+
+        if (priv->zerocopy &&
+            iov_length (vector, count) >= priv->zerocopy_threshold) {
+                msg.msg_iov = vector;
+                msg.msg_iovlen = count;
+
+                ret = sendmsg (priv->sock, &msg, MSG_ZEROCOPY);
+                if (ret > 0) {
+                        priv->zc_next++;
+                        priv->zc_sends++;
+                }
+                /* ENOBUFS: too many sends waiting for completion, copy */
+                if ((ret != -1) || (errno != ENOBUFS))
+                        return ret;
+        }
+#endif
+        return writev (priv->sock, vector, count);
+}
+
+
 /*
  * return value:
  *   0 = success (completed)
@@ -438,7 +533,6 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
               int write)
 {
         socket_private_t *priv = NULL;
-        int               sock = -1;
         int               ret = -1;
         struct iovec     *opvector = NULL;
         int               opcount = 0;
@@ -448,7 +542,6 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
         GF_VALIDATE_OR_GOTO ("socket", this->private, out);
 
         priv = this->private;
-        sock = priv->sock;
 
         opvector = vector;
         opcount  = count;
@@ -466,13 +559,13 @@ __socket_rwv (rpc_transport_t *this, struct iovec *vector, int count,
                         continue;
                 }
                 if (write) {
-			if (priv->use_ssl) {
-				ret = ssl_write_one(this,
-					opvector->iov_base, opvector->iov_len);
+			if (priv->use_ssl && !priv->ssl_ktls_send) {
+				ret = ssl_writev_one(this, opvector, opcount);
 			}
 			else {
-				ret = writev (sock, opvector, opcount);
+				ret = __socket_sendv (this, opvector, opcount);
 			}
+			this->total_write_calls++;
 
                         if (ret == 0 || (ret == -1 && errno == EAGAIN)) {
                                 /* done for now */
@@ -970,45 +1063,235 @@ __socket_ioq_flush (rpc_transport_t *this)
                 __socket_ioq_entry_free (entry);
         }
 
+        /* the kernel holds on to the pages of zero-copy sends itself */
+        while (!list_empty (&priv->zc_ioq)) {
+                entry = list_entry (priv->zc_ioq.next, struct ioq, list);
+                __socket_ioq_entry_free (entry);
+        }
+
 out:
         return;
 }
 
 
+/*
+ * All of @entry was handed to the kernel. If part of it went out with
+ * MSG_ZEROCOPY, the kernel may still read from its vector (the record
+ * marker in the entry as well as the iobufs), so it is kept until those
+ * sends complete.
+ */
+void
+__socket_ioq_entry_done (rpc_transport_t *this, struct ioq *entry, int direct)
+{
+	socket_private_t *priv = this->private;
+	char              a_byte = 0;
+
+        this->total_msgs_write++;
+
+        if (entry->zc)
+                list_move_tail (&entry->list, &priv->zc_ioq);
+        else
+                __socket_ioq_entry_free (entry);
+
+        if (priv->own_thread) {
+                /*
+                 * The pipe should only remain readable if there are
+                 * more entries after this, so drain the byte
+                 * representing this entry.
+                 */
+                if (!direct && read(priv->pipe[0],&a_byte,1) < 1) {
+                        gf_log(this->name,GF_LOG_WARNING,
+                               "read error on pipe");
+                }
+        }
+}
+
+
+/*
+ * Write out @entry together with the entries queued behind it, as many as
+ * fit into one vector, so that a burst of replies takes one writev instead
+ * of one each. Returns 0 if all of them were written, as __socket_rwv
+ * otherwise.
+ */
 int
 __socket_ioq_churn_entry (rpc_transport_t *this, struct ioq *entry, int direct)
 {
+        socket_private_t *priv = NULL;
+        struct iovec      vector[GF_SOCKET_IOQ_GATHER_IOV];
+        struct iovec     *iov = NULL;
+        struct ioq       *last = NULL;
+        struct ioq       *next = NULL;
+        int               count = 0;
+        int               done = 0;
+        size_t            bytes = 0;
+        size_t            len = 0;
+        uint32_t          zc_next = 0;
         int               ret = -1;
-	socket_private_t *priv = NULL;
-	char              a_byte = 0;
 
-        ret = __socket_writev (this, entry->pending_vector,
-                               entry->pending_count,
-                               &entry->pending_vector,
-                               &entry->pending_count);
+        priv = this->private;
 
-        if (ret == 0) {
-                /* current entry was completely written */
-                GF_ASSERT (entry->pending_count == 0);
-                __socket_ioq_entry_free (entry);
-		priv = this->private;
-		if (priv->own_thread) {
-			/*
-			 * The pipe should only remain readable if there are
-			 * more entries after this, so drain the byte
-			 * representing this entry.
-			 */
-			if (!direct && read(priv->pipe[0],&a_byte,1) < 1) {
-				gf_log(this->name,GF_LOG_WARNING,
-				       "read error on pipe");
-			}
-		}
+        /* a direct write is of a message not queued yet */
+        last = entry;
+        for (;;) {
+                memcpy (&vector[count], last->pending_vector,
+                        last->pending_count * sizeof (struct iovec));
+                count += last->pending_count;
+
+                if (direct || (last->list.next == &priv->ioq))
+                        break;
+                next = list_entry (last->list.next, struct ioq, list);
+                if (count + next->pending_count > GF_SOCKET_IOQ_GATHER_IOV)
+                        break;
+                last = next;
         }
 
-        return ret;
+        zc_next = priv->zc_next;
+
+        ret = __socket_rwv (this, vector, count, NULL, NULL, &bytes, 1);
+
+        /* account what was written to the entries it came from */
+        while (!done) {
+                done = (entry == last);
+                next = list_entry (entry->list.next, struct ioq, list);
+
+                if (bytes && (priv->zc_next != zc_next)) {
+                        entry->zc = 1;
+                        entry->zc_id = priv->zc_next - 1;
+                }
+
+                len = iov_length (entry->pending_vector, entry->pending_count);
+                if (bytes < len) {
+                        iov = entry->pending_vector;
+                        while (bytes) {
+                                if (bytes >= iov->iov_len) {
+                                        bytes -= iov->iov_len;
+                                        iov++;
+                                        entry->pending_count--;
+                                } else {
+                                        iov->iov_base += bytes;
+                                        iov->iov_len -= bytes;
+                                        bytes = 0;
+                                }
+                        }
+                        entry->pending_vector = iov;
+                        return (ret < 0) ? -1 : 1;
+                }
+
+                bytes -= len;
+                entry->pending_count = 0;
+                __socket_ioq_entry_done (this, entry, direct);
+                entry = next;
+        }
+
+        return 0;
 }
 
 
+/*
+ * Turn on zero-copy sends for a new socket, if it is plain TCP.
+ */
+void
+__socket_zerocopy_init (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+#ifdef GF_SOCKET_ZEROCOPY
+        int               on   = 1;
+#endif
+
+        priv->zerocopy = _gf_false;
+        priv->zc_next = 0;
+        priv->zc_sends = 0;
+        priv->zc_done = 0;
+        priv->zc_copied = 0;
+
+#ifdef GF_SOCKET_ZEROCOPY
+        if (!priv->zerocopy_threshold || priv->use_ssl)
+                return;
+
+        if (setsockopt (priv->sock, SOL_SOCKET, SO_ZEROCOPY, &on,
+                        sizeof (on)) < 0) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "not using zero-copy sends (%s)", strerror (errno));
+                return;
+        }
+
+        priv->zerocopy = _gf_true;
+#endif
+}
+
+
+#ifdef GF_SOCKET_ZEROCOPY
+/*
+ * Read the completions of zero-copy sends from the error queue of the
+ * socket, and free the entries that were waiting for them. Returns the
+ * number of completions read.
+ */
+int
+__socket_zerocopy_reap (rpc_transport_t *this)
+{
+        socket_private_t         *priv = this->private;
+        struct msghdr             msg = {0, };
+        char                      control[128];
+        struct cmsghdr           *cmsg = NULL;
+        struct sock_extended_err *serr = NULL;
+        struct ioq               *entry = NULL;
+        struct ioq               *tmp = NULL;
+        uint32_t                  lo = 0;
+        uint32_t                  hi = 0;
+        int                       count = 0;
+
+        for (;;) {
+                memset (&msg, 0, sizeof (msg));
+                msg.msg_control = control;
+                msg.msg_controllen = sizeof (control);
+
+                if (recvmsg (priv->sock, &msg,
+                             MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+                        break;
+
+                for (cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+                     cmsg = CMSG_NXTHDR (&msg, cmsg)) {
+                        if (!((cmsg->cmsg_level == SOL_IP &&
+                               cmsg->cmsg_type == IP_RECVERR) ||
+                              (cmsg->cmsg_level == SOL_IPV6 &&
+                               cmsg->cmsg_type == IPV6_RECVERR)))
+                                continue;
+
+                        serr = (struct sock_extended_err *)CMSG_DATA (cmsg);
+                        if ((serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY) ||
+                            (serr->ee_errno != 0))
+                                continue;
+
+                        /* sends lo to hi, both included, are done with */
+                        lo = serr->ee_info;
+                        hi = serr->ee_data;
+                        count++;
+
+                        priv->zc_done += hi - lo + 1;
+                        if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                                priv->zc_copied += hi - lo + 1;
+
+                        list_for_each_entry_safe (entry, tmp, &priv->zc_ioq,
+                                                  list) {
+                                if ((uint32_t)(entry->zc_id - lo) <= hi - lo)
+                                        __socket_ioq_entry_free (entry);
+                        }
+                }
+        }
+
+        if (priv->zerocopy && (priv->zc_done >= GF_SOCKET_ZEROCOPY_PROBE) &&
+            (priv->zc_copied == priv->zc_done)) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "zero-copy sends are copied on this connection, "
+                        "not using them");
+                priv->zerocopy = _gf_false;
+        }
+
+        return count;
+}
+#endif
+
+
 int
 __socket_ioq_churn (rpc_transport_t *this)
 {
@@ -1053,6 +1336,13 @@ socket_event_poll_err (rpc_transport_t *this)
 
         priv = this->private;
 
+        gf_log (this->name, GF_LOG_DEBUG,
+                "%"PRIu64" messages in %"PRIu64" writes, %"PRIu64" in %"
+                PRIu64" reads, %"PRIu64" zero-copy sends (%"PRIu64" copied)",
+                this->total_msgs_write, this->total_write_calls,
+                this->total_msgs_read, this->total_read_calls,
+                priv->zc_sends, priv->zc_copied);
+
         pthread_mutex_lock (&priv->lock);
         {
                 __socket_ioq_flush (this);
@@ -2115,6 +2405,7 @@ socket_event_poll_in (rpc_transport_t *this)
         ret = socket_proto_state_machine (this, &pollin);
 
         if (pollin != NULL) {
+                this->total_msgs_read++;
                 ret = rpc_transport_notify (this, RPC_TRANSPORT_MSG_RECEIVED,
                                             pollin);
                 rpc_transport_pollin_destroy (pollin);
@@ -2222,6 +2513,19 @@ socket_event_handler (int fd, int idx, void *data,
 
 	ret = (priv->connected == 1) ? 0 : socket_connect_finish(this);
 
+#ifdef GF_SOCKET_ZEROCOPY
+        if (!ret && poll_err &&
+            (priv->zerocopy || (priv->zc_sends != priv->zc_done))) {
+                /* completions of zero-copy sends come as errors */
+                pthread_mutex_lock (&priv->lock);
+                {
+                        if (__socket_zerocopy_reap (this) > 0)
+                                poll_err = 0;
+                }
+                pthread_mutex_unlock (&priv->lock);
+        }
+#endif
+
         if (!ret && poll_out) {
                 ret = socket_event_poll_out (this);
         }
@@ -2243,6 +2547,47 @@ out:
 }
 
 
+/*
+ * The kernel does the TLS records of this connection both ways, so it can
+ * be polled like any plain socket: hand it to the event pool and let its
+ * own thread go. Returns -1 if it has to stay with the thread.
+ */
+int
+socket_ktls_handover (rpc_transport_t *this)
+{
+        socket_private_t *priv = this->private;
+        int               ret  = -1;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                /* a disconnect is waiting for the thread */
+                if (priv->ot_state != OT_ALIVE)
+                        goto unlock;
+
+                priv->own_thread = _gf_false;
+                priv->idx = event_register (this->ctx->event_pool, priv->sock,
+                                            socket_event_handler, this, 1,
+                                            !list_empty (&priv->ioq));
+                if (priv->idx == -1) {
+                        priv->own_thread = _gf_true;
+                        goto unlock;
+                }
+
+                close (priv->pipe[0]);
+                close (priv->pipe[1]);
+                priv->ot_state = OT_IDLE;
+                ret = 0;
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+
+        if (ret == 0)
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "TLS done by the kernel, using system polling thread");
+        return ret;
+}
+
+
 void *
 socket_poller (void *ctx)
 {
@@ -2252,7 +2597,7 @@ socket_poller (void *ctx)
 	gf_boolean_t      to_write = _gf_false;
 	int               ret = 0;
 
-        if (priv->use_ssl) {
+        if (priv->use_ssl && !priv->ssl_ssl) {
                 if (ssl_setup_connection(this,priv->connected) < 0) {
                         gf_log (this->name,GF_LOG_ERROR, "%s setup failed",
                                 priv->connected ? "server" : "client");
@@ -2286,6 +2631,12 @@ socket_poller (void *ctx)
                         "asynchronous rpc_transport_notify failed");
         }
 
+        if (priv->own_thread_auto && priv->ssl_ktls_send &&
+            priv->ssl_ktls_recv) {
+                if (socket_ktls_handover (this) == 0)
+                        return NULL;
+        }
+
 	for (;;) {
 		pthread_mutex_lock(&priv->lock);
 		to_write = !list_empty(&priv->ioq);
@@ -2511,6 +2862,9 @@ socket_server_event_handler (int fd, int idx, void *data,
 			new_priv->use_ssl = priv->use_ssl;
 			new_priv->sock = new_sock;
 			new_priv->own_thread = priv->own_thread;
+			new_priv->own_thread_auto = priv->own_thread_auto;
+                        new_priv->zerocopy_threshold = priv->zerocopy_threshold;
+                        __socket_zerocopy_init (new_trans);
 
                         new_priv->ssl_ctx = priv->ssl_ctx;
 			if (priv->use_ssl && !priv->own_thread) {
@@ -2736,6 +3090,8 @@ socket_connect (rpc_transport_t *this, int port)
                                         strerror (errno));
                 }
 
+                __socket_zerocopy_init (this);
+
                 SA (&this->myinfo.sockaddr)->sa_family =
                         SA (&this->peerinfo.sockaddr)->sa_family;
 
@@ -2770,6 +3126,10 @@ socket_connect (rpc_transport_t *this, int port)
                         goto unlock;
                 }
 
+                /* the last connection may have gone to the event pool */
+                if (priv->own_thread_auto)
+                        priv->own_thread = priv->use_ssl;
+
 		if (priv->use_ssl && !priv->own_thread) {
 			ret = ssl_setup_connection(this,0);
 			if (ret < 0) {
@@ -3267,6 +3627,19 @@ reconfigure (rpc_transport_t *this, dict_t *options)
 
         priv->windowsize = (int)windowsize;
 
+        /* taken over by the connections accepted from now on */
+        priv->zerocopy_threshold = GF_SOCKET_ZEROCOPY_THRESHOLD;
+        optstr = NULL;
+        if (dict_get_str (options, "transport.socket.zerocopy-threshold",
+                          &optstr) == 0) {
+                if (gf_string2bytesize (optstr,
+                                        &priv->zerocopy_threshold) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format: %s", optstr);
+                        goto out;
+                }
+        }
+
         ret = 0;
 out:
         return ret;
@@ -3304,7 +3677,9 @@ socket_init (rpc_transport_t *this)
         priv->nodelay = 1;
         priv->bio = 0;
         priv->windowsize = GF_DEFAULT_SOCKET_WINDOW_SIZE;
+        priv->zerocopy_threshold = GF_SOCKET_ZEROCOPY_THRESHOLD;
         INIT_LIST_HEAD (&priv->ioq);
+        INIT_LIST_HEAD (&priv->zc_ioq);
 
         /* All the below section needs 'this->options' to be present */
         if (!this->options)
@@ -3412,6 +3787,18 @@ socket_init (rpc_transport_t *this)
                 }
         }
 
+        optstr = NULL;
+        if (dict_get_str (this->options,
+                          "transport.socket.zerocopy-threshold",
+                          &optstr) == 0) {
+                if (gf_string2bytesize (optstr,
+                                        &priv->zerocopy_threshold) != 0) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid number format: %s", optstr);
+                        return -1;
+                }
+        }
+
         priv->windowsize = (int)windowsize;
 
         priv->ssl_enabled = _gf_false;
@@ -3464,20 +3851,41 @@ socket_init (rpc_transport_t *this)
         priv->use_ssl = priv->ssl_enabled;
 
 	priv->own_thread = priv->use_ssl;
+#ifdef GF_SOCKET_KTLS
+        priv->own_thread_auto = priv->use_ssl;
+#endif
 	if (dict_get_str(this->options,OWN_THREAD_OPT,&optstr) == 0) {
+                priv->own_thread_auto = _gf_false;
                 if (gf_string2boolean (optstr, &priv->own_thread) != 0) {
                         gf_log (this->name, GF_LOG_ERROR,
 				"invalid value given for own-thread boolean");
 		}
 	}
 	gf_log(this->name,GF_LOG_INFO,"using %s polling thread",
+	       priv->own_thread_auto ? "private (system with kernel TLS)" :
 	       priv->own_thread ? "private" : "system");
 
 	if (priv->use_ssl) {
 		SSL_library_init();
 		SSL_load_error_strings();
+#ifdef GF_SOCKET_KTLS
+		/*
+		 * Still talks TLSv1 to peers that only do that, but gets TLS
+		 * 1.2 with the others, which the kernel can take over from
+		 * OpenSSL. No 1.3, whose session tickets and key updates after
+		 * the handshake could not be read from the socket directly.
+		 */
+		priv->ssl_meth = (SSL_METHOD *)SSLv23_method();
+#else
 		priv->ssl_meth = (SSL_METHOD *)TLSv1_method();
+#endif
 		priv->ssl_ctx = SSL_CTX_new(priv->ssl_meth);
+#ifdef GF_SOCKET_KTLS
+		SSL_CTX_set_options(priv->ssl_ctx, SSL_OP_NO_SSLv2 |
+				    SSL_OP_NO_SSLv3 | SSL_OP_NO_RENEGOTIATION |
+				    SSL_OP_ENABLE_KTLS);
+		SSL_CTX_set_max_proto_version(priv->ssl_ctx, TLS1_2_VERSION);
+#endif
 
                 if (SSL_CTX_set_cipher_list(priv->ssl_ctx,
                                             "HIGH:-SSLv2") == 0) {
@@ -3667,5 +4075,12 @@ struct volume_options options[] = {
 	{ .key   = {OWN_THREAD_OPT},
 	  .type  = GF_OPTION_TYPE_BOOL
 	},
+        { .key   = {"transport.socket.zerocopy-threshold"},
+          .type  = GF_OPTION_TYPE_SIZET,
+          .default_value = "64KB",
+          .description = "Messages of at least this size are sent with "
+                         "MSG_ZEROCOPY on TCP connections without SSL. "
+                         "0 turns zero-copy sends off."
+        },
         { .key = {NULL} }
 };
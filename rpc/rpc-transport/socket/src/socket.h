@@ -26,6 +26,10 @@
 #include "mem-pool.h"
 #include "globals.h"
 
+#ifdef GF_LINUX_HOST_OS
+#include <linux/errqueue.h>
+#endif
+
 #ifndef MAX_IOVEC
 #define MAX_IOVEC 16
 #endif /* MAX_IOVEC */
@@ -47,6 +51,42 @@
 #define GF_MIN_SOCKET_WINDOW_SIZE       (0)
 #define GF_USE_DEFAULT_KEEPALIVE        (-1)
 
+/*
+ * OpenSSL can hand the keys of a TLS connection to the kernel after the
+ * handshake (setsockopt TLS_TX and TLS_RX), which then encrypts what is
+ * written to the socket and decrypts what is read from it.
+ */
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+#define GF_SOCKET_KTLS
+#endif
+
+/* Small elements of a vector written without kTLS are copied together
+ * into one record of up to this size, instead of a record each.
+ */
+#define GF_SOCKET_SSL_GATHER            (16 * GF_UNIT_KB)
+
+/* Queued messages are written out together, with one writev for as many
+ * of them as fit into a vector of this size.
+ */
+#define GF_SOCKET_IOQ_GATHER_IOV        256
+
+/*
+ * Writes of at least zerocopy-threshold bytes on plain TCP connections are
+ * sent with MSG_ZEROCOPY: the kernel transmits from the pages of the
+ * message instead of copying them, and reports on the error queue of the
+ * socket when it is done with them. The messages are kept (with their
+ * iobrefs) until then.
+ */
+#if defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY) && \
+        defined(SO_EE_ORIGIN_ZEROCOPY)
+#define GF_SOCKET_ZEROCOPY
+#endif
+#define GF_SOCKET_ZEROCOPY_THRESHOLD    (64 * GF_UNIT_KB)
+/* Stop using MSG_ZEROCOPY on a connection if the first sends were all
+ * copied anyway (as over loopback), it only costs there.
+ */
+#define GF_SOCKET_ZEROCOPY_PROBE        16
+
 typedef enum {
         SP_STATE_NADA = 0,
         SP_STATE_COMPLETE,
@@ -106,6 +146,9 @@ struct ioq {
         struct iovec      *pending_vector;
         int                pending_count;
         struct iobref     *iobref;
+        /* part of it went out with MSG_ZEROCOPY, up to send zc_id */
+        char               zc;
+        uint32_t           zc_id;
 };
 
 typedef struct {
@@ -228,8 +271,24 @@ typedef struct {
 	pthread_t              thread;
 	int                    pipe[2];
 	gf_boolean_t           own_thread;
+        /* own_thread was not configured: connections whose TLS records
+         * are done by the kernel both ways go to the event pool after the
+         * handshake.
+         */
+        gf_boolean_t           own_thread_auto;
+        gf_boolean_t           ssl_ktls_send;
+        gf_boolean_t           ssl_ktls_recv;
         ot_state_t             ot_state;
         pthread_cond_t         ot_event;
+
+        uint64_t               zerocopy_threshold;
+        gf_boolean_t           zerocopy;        /* SO_ZEROCOPY is set */
+        /* written out, waiting for the kernel to complete their sends */
+        struct list_head       zc_ioq;
+        uint32_t               zc_next;         /* id of the next send */
+        uint64_t               zc_sends;
+        uint64_t               zc_done;
+        uint64_t               zc_copied;
 } socket_private_t;
 
 
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests eager locking of directories for entry transactions. Consecutive
+#creates/unlinks in a directory share its entrylk, and a rename (which does
+#not share it) must wake up the delayed post-op instead of waiting for
+#post-op-delay secs. No pending changelog must be left on the directory.
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 replica 2 $H0:$B0/r2_0 $H0:$B0/r2_1
+
+TEST $CLI volume set $V0 cluster.entry-eager-lock on
+EXPECT "on" volume_option $V0 cluster.entry-eager-lock
+
+TEST $CLI volume set $V0 cluster.post-op-delay-secs 3
+EXPECT "3" volume_option $V0 cluster.post-op-delay-secs
+
+TEST $CLI volume start $V0
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+TEST gluster volume profile $V0 start
+for i in {1..50}
+do
+        touch $M0/dir/f$i
+done
+for i in {1..25}
+do
+        rm -f $M0/dir/f$i
+done
+TEST mkdir $M0/dir/subdir
+TEST mv $M0/dir/f26 $M0/dir/subdir/f26
+
+#Test if the MAX ENTRYLK fop latency is of the order of seconds.
+entrylk_max_latency=$($CLI volume profile $V0 info | grep ENTRYLK | awk 'BEGIN {max = 0} {if ($6 > max) max=$6;} END {print max}' | cut -d. -f 1 | egrep "[0-9]{7,}")
+
+TEST [ -z $entrylk_max_latency ]
+
+EXPECT "24" echo $(ls $B0/r2_0/dir | grep -c "^f")
+EXPECT "24" echo $(ls $B0/r2_1/dir | grep -c "^f")
+
+TEST rm -rf $M0/dir/subdir
+
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/r2_0/dir trusted.afr.$V0-client-0
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/r2_0/dir trusted.afr.$V0-client-1
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/r2_1/dir trusted.afr.$V0-client-0
+EXPECT "0x000000000000000000000000" afr_get_changelog_xattr $B0/r2_1/dir trusted.afr.$V0-client-1
+
+cleanup;
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests that readv requests split across the replicas
+#(cluster.read-split-size) return the same data as unsplit ones, including
+#reads which hit the end of file in the middle of a chunk.
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 replica 3 $H0:$B0/r3_0 $H0:$B0/r3_1 $H0:$B0/r3_2
+TEST $CLI volume set $V0 cluster.read-split-size 64KB
+EXPECT "64KB" volume_option $V0 cluster.read-split-size
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume start $V0
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST dd if=/dev/urandom of=$B0/data bs=1k count=5003
+TEST cp $B0/data $M0/data
+
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+EXPECT "$(md5sum < $B0/data)" echo "$(dd if=$M0/data bs=1M 2>/dev/null | md5sum)"
+
+#Bring a replica down, the remaining two should still serve split reads
+TEST kill_brick $V0 $H0 $B0/r3_2
+EXPECT "$(md5sum < $B0/data)" echo "$(dd if=$M0/data bs=1M 2>/dev/null | md5sum)"
+
+rm -f $B0/data
+cleanup;
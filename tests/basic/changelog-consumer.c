@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+
+#include <glusterfs/gfchangelog/gf-changelog.h>
+
+/* Consumes the changelogs of a brick once: prints the name of every
+ * changelog handed out, followed by its changes, and marks it done. */
+int
+main (int argc, char *argv[])
+{
+        char     path[PATH_MAX] = {0, };
+        char     line[PATH_MAX] = {0, };
+        char    *name           = NULL;
+        ssize_t  ret            = 0;
+        FILE    *fp             = NULL;
+
+        if (argc != 3) {
+                fprintf (stderr, "usage: %s <brick> <scratch-dir>\n",
+                         argv[0]);
+                return 1;
+        }
+
+        if (gf_changelog_register (argv[1], argv[2])) {
+                fprintf (stderr, "register failed: %s\n", strerror (errno));
+                return 1;
+        }
+
+        if (gf_changelog_scan () < 0) {
+                fprintf (stderr, "scan failed: %s\n", strerror (errno));
+                return 1;
+        }
+
+        while ((ret = gf_changelog_next_change (path, sizeof (path))) > 0) {
+                name = strrchr (path, '/');
+                printf ("%s\n", name ? name + 1 : path);
+
+                fp = fopen (path, "r");
+                if (!fp) {
+                        fprintf (stderr, "open of %s failed: %s\n", path,
+                                 strerror (errno));
+                        return 1;
+                }
+                while (fgets (line, sizeof (line), fp))
+                        printf ("%s", line);
+                fclose (fp);
+
+                if (gf_changelog_done (path)) {
+                        fprintf (stderr, "done of %s failed: %s\n", path,
+                                 strerror (errno));
+                        return 1;
+                }
+        }
+
+        if (ret < 0) {
+                fprintf (stderr, "next_change failed: %s\n", strerror (errno));
+                return 1;
+        }
+
+        return 0;
+}
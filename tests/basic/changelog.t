@@ -0,0 +1,115 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests the changelog translator. Modifications made through the mount
+#must be journalled on the brick, and the journal must be rolled over into
+#CHANGELOG.<n> files every rollover-time seconds. A rolled journal is never
+#replaced, and libgfchangelog hands each of them out exactly once.
+
+CHANGELOG_DIR=$B0/${V0}0/.glusterfs/changelogs
+
+function rolled_changelogs()
+{
+        local count=$(ls $CHANGELOG_DIR 2>/dev/null | \
+                      grep -c '^CHANGELOG\.[0-9]*$')
+        echo $count
+}
+
+function build_tester()
+{
+        local cfile=$1
+        local fname=$(basename "$cfile")
+        local execname="${fname%.*}"
+        gcc -g -o $(dirname $cfile)/$execname $cfile -lgfchangelog
+}
+
+#names of the journals handed out by a consumer run
+function consumed()
+{
+        grep '^CHANGELOG\.[0-9]*$' $1 | sort
+}
+
+function changelog_has()
+{
+        local count=$(cat $CHANGELOG_DIR/CHANGELOG.* 2>/dev/null | \
+                      grep -c -a "$1")
+        echo $count
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 changelog.changelog on
+TEST $CLI volume set $V0 changelog.rollover-time 2
+EXPECT "on" volume_option $V0 changelog.changelog
+
+TEST $CLI volume start $V0
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+TEST touch $M0/dir/file
+TEST dd if=/dev/zero of=$M0/dir/file bs=4k count=16
+TEST chmod 600 $M0/dir/file
+TEST mv $M0/dir/file $M0/dir/renamed
+TEST ln $M0/dir/renamed $M0/dir/link
+
+EXPECT_WITHIN 10 "[1-9][0-9]*" rolled_changelogs
+
+#entry records carry the names, each rename both of them
+EXPECT_WITHIN 10 "1" changelog_has "renamed"
+EXPECT "1" changelog_has "link"
+
+#consume the journals through libgfchangelog
+CONSUMER=$(dirname $0)/changelog-consumer
+SCRATCH=$(mktemp -d)
+TEST build_tester $(dirname $0)/changelog-consumer.c
+TEST "$CONSUMER $B0/${V0}0 $SCRATCH > $B0/consumed.1"
+TEST [ $(consumed $B0/consumed.1 | wc -l) -ge 1 ]
+EXPECT "1" grep -c "RENAME.*/file .*/renamed$" $B0/consumed.1
+
+#none of them is handed out again
+sleep 3
+TEST "$CONSUMER $B0/${V0}0 $SCRATCH > $B0/consumed.2"
+EXPECT "" comm -12 <(consumed $B0/consumed.1) <(consumed $B0/consumed.2)
+
+#a journal whose name sorts before the consumed ones is still handed out
+first=$(consumed $B0/consumed.1 | head -1)
+TEST cp $CHANGELOG_DIR/$first $CHANGELOG_DIR/CHANGELOG.1
+TEST "$CONSUMER $B0/${V0}0 $SCRATCH > $B0/consumed.3"
+EXPECT "1" grep -c "^CHANGELOG\.1$" $B0/consumed.3
+
+#journals already holding the next names are kept, rollover goes past them
+now=$(date +%s)
+for i in {0..9}
+do
+        echo stale > $CHANGELOG_DIR/CHANGELOG.$((now + i))
+done
+sleep 6
+TEST touch $M0/dir/late
+EXPECT_WITHIN 10 "1" changelog_has "late"
+for i in {0..9}
+do
+        EXPECT "stale" cat $CHANGELOG_DIR/CHANGELOG.$((now + i))
+        rm -f $CHANGELOG_DIR/CHANGELOG.$((now + i))
+done
+
+rm -rf $SCRATCH $CONSUMER $B0/consumed.*
+
+#nothing is journalled once change-logging is disabled
+TEST $CLI volume set $V0 changelog.changelog off
+sleep 3
+count=$(rolled_changelogs)
+TEST touch $M0/dir/untracked
+sleep 3
+EXPECT "$count" rolled_changelogs
+EXPECT "0" changelog_has "untracked"
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
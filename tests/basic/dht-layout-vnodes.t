@@ -0,0 +1,72 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests cluster.layout-vnodes. Directories get ring layouts, and adding
+#a brick only moves files onto it, never between the bricks already there.
+
+function layout_field()
+{
+        getfattr -e hex -n trusted.glusterfs.dht $1 2>/dev/null | \
+                sed -n 's/^trusted.glusterfs.dht=0x//p' | cut -c $2
+}
+
+function brick_files()
+{
+        ls $1 | sort
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 cluster.layout-vnodes 64
+EXPECT "64" volume_option $V0 cluster.layout-vnodes
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 \
+               --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+
+#type DHT_HASH_TYPE_DM_VNODE with 64 points on each brick
+EXPECT "00000002" layout_field $B0/${V0}0/dir 9-16
+EXPECT "00000040" layout_field $B0/${V0}1/dir 25-32
+
+for i in {1..100}
+do
+        echo $i > $M0/dir/file$i
+done
+
+EXPECT "100" echo $(ls $M0/dir | wc -l)
+TEST [ $(ls $B0/${V0}0/dir | wc -l) -gt 0 ]
+TEST [ $(ls $B0/${V0}1/dir | wc -l) -gt 0 ]
+
+brick_files $B0/${V0}0/dir > $B0/before0
+brick_files $B0/${V0}1/dir > $B0/before1
+
+TEST $CLI volume add-brick $V0 $H0:$B0/${V0}2
+TEST $CLI volume rebalance $V0 start force
+EXPECT_WITHIN 120 "completed" rebalance_status_field $V0
+
+EXPECT "00000002" layout_field $B0/${V0}2/dir 9-16
+
+#about a third of the files moved, all of them to the new brick
+moved=$(ls $B0/${V0}2/dir | wc -l)
+TEST [ $moved -gt 0 ]
+TEST [ $moved -lt 60 ]
+EXPECT "" echo $(brick_files $B0/${V0}0/dir | comm -13 $B0/before0 -)
+EXPECT "" echo $(brick_files $B0/${V0}1/dir | comm -13 $B0/before1 -)
+
+EXPECT "100" echo $(ls $M0/dir | wc -l)
+EXPECT "57" cat $M0/dir/file57
+
+rm -f $B0/before0 $B0/before1
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
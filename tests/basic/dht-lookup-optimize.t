@@ -0,0 +1,60 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests lookup-optimize and negative-lookup-timeout. Directories created
+#through distribute carry a committed layout, for which a miss on the hashed
+#subvolume is final; rewriting the layout with fix-layout uncommits it.
+
+function commit_hash()
+{
+        getfattr -e hex -n trusted.glusterfs.dht.commithash $1 2>/dev/null | \
+                sed -n 's/^trusted.glusterfs.dht.commithash=//p'
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1,2}
+TEST $CLI volume set $V0 cluster.lookup-optimize on
+TEST $CLI volume set $V0 cluster.negative-lookup-timeout 5
+EXPECT "on" volume_option $V0 cluster.lookup-optimize
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 --negative-timeout=0 \
+               -s $H0 --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+TEST [ "$(commit_hash $B0/${V0}0/dir)" != "" ]
+TEST [ "$(commit_hash $B0/${V0}0/dir)" != "0x00000000" ]
+
+for i in {1..50}
+do
+        touch $M0/dir/file$i
+done
+
+#every file is found, missing ones are not
+EXPECT "50" echo $(ls $M0/dir | wc -l)
+TEST stat $M0/dir/file17
+TEST ! stat $M0/dir/missing
+
+#a name remembered as missing is found once created through the mount
+TEST ! stat $M0/dir/later
+TEST touch $M0/dir/later
+TEST stat $M0/dir/later
+TEST mv $M0/dir/file1 $M0/dir/renamed
+TEST stat $M0/dir/renamed
+TEST ! stat $M0/dir/file1
+
+#fix-layout rewrites the layout without a stamp
+TEST $CLI volume rebalance $V0 fix-layout start
+EXPECT_WITHIN 60 "completed" rebalance_status_field $V0
+EXPECT "0x00000000" commit_hash $B0/${V0}0/dir
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
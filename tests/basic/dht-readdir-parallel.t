@@ -0,0 +1,47 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests readdir-parallel. Directory chunks are read ahead from all the
+#subvolumes at once, the listing must still show every entry exactly once,
+#including directories when readdir-optimize filters them on the bricks.
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1,2,3}
+TEST $CLI volume set $V0 cluster.readdir-parallel on
+EXPECT "on" volume_option $V0 cluster.readdir-parallel
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+for i in {1..1000}
+do
+        touch $M0/dir/file$i
+done
+for i in {1..20}
+do
+        mkdir $M0/dir/subdir$i
+done
+
+EXPECT "1020" echo $(ls $M0/dir | wc -l)
+EXPECT "1020" echo $(ls $M0/dir | sort -u | wc -l)
+EXPECT "1020" echo $(ls -l $M0/dir | grep -c -e file -e subdir)
+
+TEST $CLI volume set $V0 cluster.readdir-optimize on
+EXPECT "1020" echo $(ls $M0/dir | sort -u | wc -l)
+EXPECT "20" echo $(ls -l $M0/dir | grep -c "^d")
+
+#files removed under a listing are not shown again
+TEST rm -f $M0/dir/file{1..500}
+EXPECT "520" echo $(ls $M0/dir | wc -l)
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
@@ -0,0 +1,55 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#Rebalance between bricks on the same host lets the source brick copy the
+#data into the destination itself. Large and sparse files must arrive
+#intact, and holes must stay holes.
+
+REBALANCE_LOG=/var/log/glusterfs/$V0-rebalance.log
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 \
+               --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+for i in {1..20}
+do
+        dd if=/dev/urandom of=$M0/dir/file$i bs=1M count=3 2>/dev/null
+done
+TEST dd if=/dev/urandom of=$M0/dir/sparse bs=64k count=2 seek=100
+TEST truncate -s 64M $M0/dir/sparse
+
+md5sum $M0/dir/* | sed "s,$M0/,," > $B0/before
+
+TEST $CLI volume add-brick $V0 $H0:$B0/${V0}1
+rm -f $REBALANCE_LOG
+TEST $CLI volume rebalance $V0 start force
+EXPECT_WITHIN 120 "completed" rebalance_status_field $V0
+
+moved=$(ls $B0/${V0}1/dir | wc -l)
+TEST [ $moved -gt 0 ]
+EXPECT "" echo $(md5sum $M0/dir/* | sed "s,$M0/,," | diff - $B0/before)
+
+#every file was copied by the brick, none streamed through rebalance
+EXPECT "$moved" grep -c "copied locally from" $REBALANCE_LOG
+
+#wherever it ended up, the sparse file still takes about 128k
+sparse=$(ls $B0/${V0}0/dir/sparse $B0/${V0}1/dir/sparse 2>/dev/null | \
+         xargs -n1 stat -c "%s %b %B" | awk '$1 == 67108864 { print $2 * $3 }')
+TEST [ $sparse -lt 1048576 ]
+
+rm -f $B0/before
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
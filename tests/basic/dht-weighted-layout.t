@@ -0,0 +1,68 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests cluster.subvol-weights. Directory layouts give every subvolume a
+#share of the hash space in proportion to its weight, for contiguous ranges
+#and for cluster.layout-vnodes rings alike.
+
+function layout_field()
+{
+        local hex=$(getfattr -e hex -n trusted.glusterfs.dht $1 2>/dev/null | \
+                    sed -n 's/^trusted.glusterfs.dht=0x//p' | cut -c $2)
+        echo $((16#$hex))
+}
+
+function range_size()
+{
+        echo $(( $(layout_field $1 25-32) - $(layout_field $1 17-24) + 1 ))
+}
+
+function share_ratio()
+{
+        local a=$(range_size $1)
+        local b=$(range_size $2)
+        echo $(( (a + b / 2) / b ))
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 cluster.subvol-weights $V0-client-0:3,$V0-client-1:1
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 \
+               --volfile-id=$V0 $M0
+
+TEST mkdir $M0/dir
+EXPECT "3" share_ratio $B0/${V0}0/dir $B0/${V0}1/dir
+
+for i in {1..100}
+do
+        touch $M0/dir/file$i
+done
+
+EXPECT "100" echo $(ls $M0/dir | wc -l)
+TEST [ $(ls $B0/${V0}0/dir | wc -l) -gt $(ls $B0/${V0}1/dir | wc -l) ]
+
+#rings give the heavier subvolume more points
+TEST $CLI volume set $V0 cluster.layout-vnodes 64
+TEST mkdir $M0/ring
+EXPECT "96" layout_field $B0/${V0}0/ring 25-32
+EXPECT "32" layout_field $B0/${V0}1/ring 25-32
+
+#without weights fix-layout evens the shares out again
+TEST $CLI volume reset $V0 cluster.layout-vnodes
+TEST $CLI volume reset $V0 cluster.subvol-weights
+TEST $CLI volume rebalance $V0 fix-layout start
+EXPECT_WITHIN 60 "completed" rebalance_status_field $V0
+EXPECT "1" share_ratio $B0/${V0}0/dir $B0/${V0}1/dir
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
@@ -0,0 +1,48 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests that volumes come back the same after glusterd restarts. Their
+#files are read once each at startup and a volume's files are all replaced
+#together when it changes.
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 replica 2 $H0:$B0/${V0}{0..15}
+TEST $CLI volume set $V0 performance.cache-size 16MB
+TEST $CLI volume set $V0 performance.io-thread-count 8
+TEST $CLI volume set $V0 auth.allow 127.0.0.1
+TEST $CLI volume start $V0
+
+$CLI volume info $V0 > $B0/info0
+TEST ! ls /var/lib/glusterd/vols/$V0/*.tmp
+TEST ! ls /var/lib/glusterd/vols/$V0/bricks/*.tmp
+
+TEST killall glusterd
+EXPECT_WITHIN 20 "" pidof glusterd
+TEST glusterd
+TEST pidof glusterd
+
+$CLI volume info $V0 > $B0/info1
+TEST diff $B0/info0 $B0/info1
+EXPECT "16MB" volume_option $V0 performance.cache-size
+EXPECT "Started" volinfo_field $V0 'Status'
+
+#a change after the restart is stored again in full
+TEST $CLI volume reset $V0 performance.io-thread-count
+TEST killall glusterd
+EXPECT_WITHIN 20 "" pidof glusterd
+TEST glusterd
+TEST pidof glusterd
+EXPECT "" volume_option $V0 performance.io-thread-count
+EXPECT "127.0.0.1" volume_option $V0 auth.allow
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+rm -f $B0/info0 $B0/info1
+
+cleanup;
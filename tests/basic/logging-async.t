@@ -0,0 +1,63 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests diagnostics.client-log-mode async. Threads only queue their
+#messages, the logger thread writes them out (as json here), and whatever
+#is still queued gets written out when the client exits.
+
+function logging_field ()
+{
+        local fpath=$(generate_mount_statedump $V0)
+        sed -n '/^\[logging\]/,/^\[/p' $fpath | grep "^$1=" | cut -f2 -d'='
+        rm -f $fpath
+}
+
+function json_lines ()
+{
+        grep -c '^{"time":' $1
+}
+
+function logged ()
+{
+        grep -q "$2" $1 && echo "Y" || echo "N"
+}
+
+cleanup;
+mkdir -p $M0
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 diagnostics.client-log-mode async
+TEST $CLI volume set $V0 diagnostics.client-log-format json
+TEST $CLI volume set $V0 diagnostics.client-log-buf-size 128KB
+EXPECT "async" volume_option $V0 diagnostics.client-log-mode
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 --log-file=$B0/client.log $M0
+EXPECT "async" logging_field mode
+EXPECT "json" logging_field format
+EXPECT "131072" logging_field buf_size
+EXPECT "0" logging_field dropped
+
+#the client connecting to the brick logs after the graph is up
+EXPECT_WITHIN 5 "Y" logged $B0/client.log '^{"time":.*"domain":"'$V0'-client-0"'
+TEST touch $M0/file
+TEST umount $M0
+EXPECT_WITHIN 5 "Y" logged $B0/client.log '"message":"Unmounting'
+TEST [ $(json_lines $B0/client.log) -gt 0 ]
+
+#back to messages written out by the thread logging them
+TEST $CLI volume set $V0 diagnostics.client-log-mode sync
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+EXPECT "sync" logging_field mode
+TEST umount $M0
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+rm -f $B0/client.log
+
+cleanup;
@@ -0,0 +1,71 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests nfs.fh-cache-size and nfs.fh-cache-file. The NFS server keeps
+#the parent and name of the file handles it hands out, saves them, and
+#still resolves the handles a client holds after it is restarted.
+
+function get_nfs_pid ()
+{
+        ps aux | grep glusterfs | grep -E "nfs/run/nfs.pid" | \
+                awk '{print $2}' | head -1
+}
+
+function nfs_fhcache_field ()
+{
+        local fpath=$(generate_statedump $(get_nfs_pid))
+        grep "^fh-cache.$1=" $fpath | cut -f2 -d'='
+        rm -f $fpath
+}
+
+function gfid_in_snapshot ()
+{
+        local gfid=$(getfattr -e hex -n trusted.gfid $1 2>/dev/null | \
+                     sed -n 's/^trusted.gfid=0x//p')
+        gfid=${gfid:0:8}-${gfid:8:4}-${gfid:12:4}-${gfid:16:4}-${gfid:20:12}
+        grep -c "^$gfid " $2
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 nfs.fh-cache-size 4096
+TEST $CLI volume set $V0 nfs.fh-cache-file $B0/fh-cache
+EXPECT "4096" volume_option $V0 nfs.fh-cache-size
+TEST $CLI volume start $V0
+
+## Wait for volume to register with rpc.mountd
+sleep 5;
+TEST mount -t nfs -o vers=3,nolock,soft,intr,noac $H0:/$V0 $N0
+
+TEST mkdir $N0/dir
+for i in {1..20}
+do
+        echo $i > $N0/dir/file$i
+done
+
+EXPECT "4096" nfs_fhcache_field size
+
+#written out within a minute
+brick=$(ls -d $B0/${V0}*/dir/file7 | head -1)
+EXPECT_WITHIN 90 "1" gfid_in_snapshot $brick $B0/fh-cache
+
+#readable by the server only, whatever its umask
+EXPECT "600" stat -c %a $B0/fh-cache
+
+#the client keeps using its handles across a restart of the NFS server
+TEST kill -9 $(get_nfs_pid)
+TEST $CLI volume start $V0 force
+sleep 5;
+EXPECT "7" cat $N0/dir/file7
+TEST [ $(nfs_fhcache_field hard-resolves) -gt 0 ]
+
+TEST umount $N0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
@@ -0,0 +1,70 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests nfs.readdir-cache-timeout and nfs.readdir-cache-entries. The NFS
+#server reads a directory ahead of a client paging through it, serves the
+#following pages from memory, and drops them when an entry op changes the
+#directory or a file in it changes through the server.
+
+function get_nfs_pid ()
+{
+        ps aux | grep glusterfs | grep -E "nfs/run/nfs.pid" | \
+                awk '{print $2}' | head -1
+}
+
+function nfs_dircache_field ()
+{
+        local fpath=$(generate_statedump $(get_nfs_pid))
+        grep "^readdir-cache.$1=" $fpath | cut -f2 -d'='
+        rm -f $fpath
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 nfs.readdir-cache-timeout 60
+TEST $CLI volume set $V0 nfs.readdir-cache-entries 100000
+EXPECT "60" volume_option $V0 nfs.readdir-cache-timeout
+TEST $CLI volume start $V0
+
+## Wait for volume to register with rpc.mountd
+sleep 5;
+TEST mount -t nfs -o vers=3,nolock,soft,intr,noac,rsize=4096 $H0:/$V0 $N0
+
+TEST mkdir $N0/dir
+for i in {1..2000}
+do
+        touch $N0/dir/file$i
+done
+
+EXPECT "60" nfs_dircache_field timeout
+
+#more pages were served than read from the volume
+EXPECT "2000" echo $(ls $N0/dir | wc -l)
+TEST [ $(nfs_dircache_field hits) -gt $(nfs_dircache_field fetches) ]
+
+#entry ops through the server show up in the next listing
+TEST rm -f $N0/dir/file7
+TEST touch $N0/dir/new
+TEST mv $N0/dir/file8 $N0/dir/moved
+EXPECT "2000" echo $(ls $N0/dir | wc -l)
+TEST ls $N0/dir/new $N0/dir/moved
+TEST ! ls $N0/dir/file7
+TEST [ $(nfs_dircache_field invalidations) -gt 0 ]
+
+#a write through the server shows up in the sizes of the next listing
+EXPECT "2000" echo $(ls -l $N0/dir | grep -c "^-")
+TEST dd if=/dev/zero of=$N0/dir/file9 bs=1024 count=4 conv=notrunc
+EXPECT "4096" echo $(ls -l $N0/dir | awk '$NF == "file9" {print $5}')
+TEST truncate -s 100 $N0/dir/file10
+EXPECT "100" echo $(ls -l $N0/dir | awk '$NF == "file10" {print $5}')
+
+TEST umount $N0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
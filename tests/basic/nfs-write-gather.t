@@ -0,0 +1,74 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests nfs.write-gather-size. Streams of UNSTABLE writes are gathered
+#on the NFS server, and what the client wrote is visible through the NFS
+#mount and the bricks once it does a COMMIT (fsync or close).
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 nfs.write-gather-size 512KB
+TEST $CLI volume set $V0 nfs.write-gather-budget 4MB
+EXPECT "512KB" volume_option $V0 nfs.write-gather-size
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 \
+               --volfile-id=$V0 $M0
+
+## Wait for volume to register with rpc.mountd
+sleep 5;
+TEST mount -t nfs -o vers=3,nolock,soft,intr $H0:/$V0 $N0
+
+TEST dd if=/dev/urandom of=$B0/src bs=64k count=80
+sum=$(md5sum < $B0/src)
+
+#sequential writes, flushed by COMMIT on close
+TEST dd if=$B0/src of=$N0/seq bs=64k conv=fsync
+EXPECT "$sum" echo "$(md5sum < $M0/seq)"
+EXPECT "$sum" echo "$(md5sum < $N0/seq)"
+
+#writes to several files at once run over the budget
+for i in {1..8}
+do
+        dd if=$B0/src of=$N0/par$i bs=64k 2>/dev/null &
+done
+wait
+TEST sync
+for i in {1..8}
+do
+        EXPECT "$sum" echo "$(md5sum < $M0/par$i)"
+done
+
+#the size seen over NFS includes the UNSTABLE writes not committed yet
+TEST dd if=$B0/src of=$N0/size bs=64k count=3 conv=notrunc
+EXPECT "196608" stat -c %s $N0/size
+
+#without a COMMIT the data still reaches the bricks
+TEST dd if=$B0/src of=$N0/aged bs=64k count=1
+EXPECT_WITHIN 5 "65536" stat -c %s $M0/aged
+
+#a gathered write failing on the volume is reported to the client, which
+#does not resend it forever
+TEST mkdir $N0/quota
+TEST $CLI volume quota $V0 enable
+TEST $CLI volume quota $V0 limit-usage /quota 1MB
+TEST ! dd if=$B0/src of=$N0/quota/file bs=64k conv=fsync
+#and writes within the limit are gathered again
+TEST rm -f $N0/quota/file
+TEST dd if=$B0/src of=$N0/quota/small bs=64k count=4 conv=fsync
+EXPECT "$(head -c 262144 $B0/src | md5sum)" echo "$(md5sum < $M0/quota/small)"
+TEST $CLI volume quota $V0 disable
+
+TEST umount $N0
+TEST umount $M0
+rm -f $B0/src
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
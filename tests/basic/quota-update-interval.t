@@ -0,0 +1,49 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests batched quota propagation. With quota-update-interval set, size
+#changes are gathered and propagated up the tree periodically, the usage
+#reported for a directory must still converge to what was written below it.
+
+function usage()
+{
+        $CLI volume quota $V0 list | grep -- "^/$1 " | awk '{print $3}'
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume start $V0
+TEST $CLI volume quota $V0 enable
+TEST $CLI volume set $V0 features.quota-update-interval 2
+EXPECT "2" volume_option $V0 features.quota-update-interval
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST mkdir -p $M0/dir/a/b/c
+TEST $CLI volume quota $V0 limit-usage /dir 100MB
+
+#many small appends to files at different depths
+for i in {1..64}
+do
+        dd if=/dev/zero of=$M0/dir/a/b/c/file bs=16k count=1 seek=$((i-1)) \
+           conv=notrunc 2>/dev/null
+        dd if=/dev/zero of=$M0/dir/a/file bs=16k count=1 seek=$((i-1)) \
+           conv=notrunc 2>/dev/null
+done
+
+EXPECT_WITHIN 30 "2.0MB" usage dir
+
+#and removals are propagated as well
+TEST rm -f $M0/dir/a/b/c/file
+EXPECT_WITHIN 30 "1.0MB" usage dir
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
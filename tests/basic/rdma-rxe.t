@@ -0,0 +1,52 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests the rdma transport over soft-RoCE (rxe), so it runs without an
+#HCA. Large writes and reads go through RDMA read/write on the registered
+#iobufs, small ones inline; data has to get through the same either way.
+#RXE_NETDEV picks the interface to put rxe on, the default route otherwise.
+
+cleanup;
+
+RXE_DEV=gf_rxe0
+RXE_NETDEV=${RXE_NETDEV:=$(ip -o -4 route show default | awk '{print $5; exit}')}
+
+if ! modprobe rdma_rxe 2>/dev/null || ! which rdma > /dev/null 2>&1 \
+   || [ -z "$RXE_NETDEV" ]; then
+        SKIP_TESTS
+        exit 0
+fi
+
+rdma link add $RXE_DEV type rxe netdev $RXE_NETDEV 2>/dev/null
+if ! rdma link show | grep -q "$RXE_DEV"; then
+        SKIP_TESTS
+        exit 0
+fi
+mkdir -p $M0
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 transport tcp,rdma $H0:$B0/${V0}{0,1}
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0.rdma $M0
+TEST dd if=/dev/urandom of=$B0/data bs=1M count=16
+TEST cp $B0/data $M0/data
+TEST dd if=/dev/urandom of=$B0/small bs=1k count=1
+TEST cp $B0/small $M0/small
+TEST umount $M0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0.rdma $M0
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+EXPECT "$(md5sum < $B0/small)" echo "$(md5sum < $M0/small)"
+TEST umount $M0
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+rm -f $B0/data $B0/small
+
+cleanup;
+rdma link delete $RXE_DEV 2>/dev/null
@@ -0,0 +1,50 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests server.zerocopy-threshold. Large read replies are sent with
+#MSG_ZEROCOPY and held until the kernel is done with them, queued replies
+#go out together; data has to get through the same either way, and both
+#ends count the syscalls it took.
+
+function brick_dump_field ()
+{
+        local fpath=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+        grep "^server.xprt0.$1=" $fpath | cut -f2 -d'='
+        rm -f $fpath
+}
+
+cleanup;
+mkdir -p $M0
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume set $V0 server.zerocopy-threshold 4KB
+EXPECT "4KB" volume_option $V0 server.zerocopy-threshold
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+TEST dd if=/dev/urandom of=$B0/data bs=1M count=8
+TEST cp $B0/data $M0/data
+TEST umount $M0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+TEST [ $(brick_dump_field msgs-write) -gt 0 ]
+TEST [ $(brick_dump_field write-calls) -gt 0 ]
+TEST umount $M0
+
+#the same with plain copying sends
+TEST $CLI volume set $V0 server.zerocopy-threshold 0
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+TEST umount $M0
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+rm -f $B0/data
+
+cleanup;
@@ -0,0 +1,57 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+#This tests SSL connections with and without kernel TLS. Connections whose
+#records the kernel takes over go to the event pool after the handshake,
+#the others keep their own polling thread and encrypt in OpenSSL; data has
+#to get through the same either way.
+
+SSL_BASE=/etc/ssl
+SSL_KEY=$SSL_BASE/glusterfs.key
+SSL_CERT=$SSL_BASE/glusterfs.pem
+SSL_CA=$SSL_BASE/glusterfs.ca
+
+function mount_log ()
+{
+        echo /var/log/glusterfs/$(echo ${M0:1} | tr / -).log
+}
+
+cleanup;
+rm -f $SSL_BASE/glusterfs.*
+mkdir -p $M0
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST openssl genrsa -out $SSL_KEY 2048
+TEST openssl req -new -x509 -key $SSL_KEY -subj /CN=Anyone -out $SSL_CERT
+ln $SSL_CERT $SSL_CA
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}{0,1}
+TEST $CLI volume set $V0 server.ssl on
+TEST $CLI volume set $V0 client.ssl on
+TEST $CLI volume start $V0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+TEST dd if=/dev/urandom of=$B0/data bs=1M count=8
+TEST cp $B0/data $M0/data
+TEST umount $M0
+
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 $M0
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+TEST grep -q "kernel TLS" $(mount_log)
+TEST umount $M0
+
+#the same with OpenSSL doing the records in a thread of its own
+TEST glusterfs --volfile-server=$H0 --volfile-id=$V0 \
+     --xlator-option "$V0-client-0.transport.socket.own-thread=on" \
+     --xlator-option "$V0-client-1.transport.socket.own-thread=on" $M0
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/data)"
+TEST umount $M0
+
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+rm -f $B0/data
+
+cleanup;
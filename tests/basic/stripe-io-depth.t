@@ -0,0 +1,79 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests cluster.stripe-io-depth. Reads and writes spanning many stripe
+#units keep at most io-depth subrequests in flight, and with coalesce on a
+#subvolume gets all its units of a request in one subrequest.
+
+function stripe_stat()
+{
+        local fpath=$(generate_mount_statedump $V0)
+        grep "^subvolumes\[$1\]\.$2=" $fpath | cut -f2 -d'='
+        rm -f $fpath
+}
+
+cleanup;
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 stripe 4 $H0:$B0/${V0}{0,1,2,3}
+TEST $CLI volume set $V0 cluster.stripe-block-size 16KB
+TEST $CLI volume set $V0 cluster.stripe-coalesce on
+TEST $CLI volume set $V0 cluster.stripe-io-depth 2
+TEST $CLI volume set $V0 performance.write-behind off
+TEST $CLI volume set $V0 performance.read-ahead off
+TEST $CLI volume set $V0 performance.io-cache off
+TEST $CLI volume set $V0 performance.quick-read off
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 \
+               --volfile-id=$V0 $M0
+
+TEST dd if=/dev/urandom of=$B0/data bs=1M count=4
+TEST dd if=$B0/data of=$M0/file bs=128k conv=fsync
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/file)"
+
+#coalesced bricks hold a quarter of the file each, without holes
+for i in {0..3}
+do
+        EXPECT "1048576" stat -c %s $B0/${V0}$i/file
+done
+
+#a 128k request covers 8 units on 4 subvolumes, one subrequest each
+EXPECT "1" echo $(( $(stripe_stat 0 peak_inflight) <= 2 ))
+TEST [ $(stripe_stat 0 writes) -le 32 ]
+EXPECT "0" stripe_stat 0 inflight
+
+#one subrequest at a time
+TEST $CLI volume set $V0 cluster.stripe-io-depth 1
+TEST dd if=$M0/file of=$B0/back bs=128k iflag=direct
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $B0/back)"
+
+#holes: the bricks not holding the last unit end early, so most units of
+#a 128k read come back empty and are filled in with zeroes
+TEST $CLI volume set $V0 cluster.stripe-io-depth 16
+TEST rm -f $B0/data $M0/file
+for off in 0 37 300 611
+do
+        TEST dd if=/dev/urandom of=$B0/data bs=1k count=4 seek=$off \
+                conv=notrunc
+done
+TEST cp --sparse=always $B0/data $M0/file
+TEST dd if=$M0/file of=$B0/back bs=128k iflag=direct
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $B0/back)"
+EXPECT "0" stripe_stat 0 inflight
+
+#short reads at the end of the file
+TEST truncate -s 100000 $B0/data
+TEST truncate -s 100000 $M0/file
+EXPECT "$(md5sum < $B0/data)" echo "$(md5sum < $M0/file)"
+
+rm -f $B0/data $B0/back
+
+TEST umount $M0
+TEST $CLI volume stop $V0
+TEST $CLI volume delete $V0
+
+cleanup;
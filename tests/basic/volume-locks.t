@@ -0,0 +1,84 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#This tests transactions on different volumes running at the same time.
+#Each takes the lock of its own volume only, volume status shares the lock
+#of its volume with other status commands, and operations for the whole
+#cluster still lock out all the others.
+
+function set_many ()
+{
+        local vol=$1
+        local ret=0
+        for i in {1..20}
+        do
+                $CLI volume set $vol performance.cache-size ${i}MB \
+                        > /dev/null 2>&1
+                (( ret += $? ))
+        done
+        echo $ret
+}
+
+function status_many ()
+{
+        local vol=${1:-$V0}
+        local ret=0
+        for i in {1..20}
+        do
+                $CLI volume status $vol > /dev/null 2>&1
+                (( ret += $? ))
+        done
+        echo $ret
+}
+
+#retries while status commands hold the lock of the volume
+function retry_cli ()
+{
+        for i in {1..50}
+        do
+                $CLI "$@" > /dev/null 2>&1 && { echo "0"; return; }
+                sleep 0.2
+        done
+        echo "1"
+}
+
+cleanup;
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume create $V1 $H0:$B0/${V1}0
+TEST $CLI volume start $V0
+
+set_many $V0 > $B0/set0 &
+set_many $V1 > $B0/set1 &
+status_many > $B0/status0 &
+status_many > $B0/status1 &
+wait
+
+EXPECT "0" cat $B0/set0
+EXPECT "0" cat $B0/set1
+EXPECT "0" cat $B0/status0
+EXPECT "0" cat $B0/status1
+EXPECT "20MB" volume_option $V0 performance.cache-size
+EXPECT "20MB" volume_option $V1 performance.cache-size
+
+#cluster wide options and volumes on their own
+TEST $CLI volume set all cluster.server-quorum-ratio 60
+TEST $CLI volume start $V1
+TEST $CLI volume stop $V1
+TEST $CLI volume delete $V1
+
+#status of a volume being stopped and deleted meanwhile
+status_many $V0 > /dev/null &
+EXPECT "0" retry_cli volume stop $V0
+EXPECT "0" retry_cli volume delete $V0
+wait
+TEST pidof glusterd
+TEST ! $CLI volume info $V0
+rm -f $B0/set0 $B0/set1 $B0/status0 $B0/status1
+
+cleanup;
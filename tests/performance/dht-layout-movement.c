@@ -0,0 +1,449 @@
+/*
+  Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Simulates adding bricks to a distribute volume and reports the share of
+ * files whose hashed subvolume changes, for the contiguous layouts written
+ * by fix-layout and for cluster.layout-vnodes ring layouts. Both follow
+ * dht-selfheal.c and dht-layout.c; only gf_dm_hashfn is shared with them.
+ *
+ *   dht-layout-movement <bricks> <added> <vnodes> <files>
+ *
+ * Build: gcc -D_CONFIG_H -I libglusterfs/src dht-layout-movement.c \
+ *            libglusterfs/src/hashfn.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+
+#include "hashfn.h"
+
+#define SIM_DIRS 16
+
+struct sim_entry {
+        char      name[64];
+        int       member;       /* has a range or ring points */
+        uint32_t  start;        /* ring id for vnode layouts */
+        uint32_t  stop;         /* vnode count for vnode layouts */
+};
+
+struct sim_range {
+        uint32_t  start;
+        uint32_t  stop;
+        int       subvol;
+};
+
+struct sim_point {
+        uint32_t  point;
+        int       member;
+};
+
+static uint32_t
+sim_hash (const char *name)
+{
+        return gf_dm_hashfn (name, strlen (name));
+}
+
+static int
+sim_entry_cmp (const void *a, const void *b)
+{
+        return strcmp (((const struct sim_entry *) a)->name,
+                       ((const struct sim_entry *) b)->name);
+}
+
+static void
+sim_subvols (struct sim_entry *list, int cnt, int members)
+{
+        int i = 0;
+
+        memset (list, 0, cnt * sizeof (*list));
+        for (i = 0; i < cnt; i++) {
+                snprintf (list[i].name, sizeof (list[i].name),
+                          "sim-client-%d", i);
+                list[i].member = (i < members);
+        }
+
+        /* dht_layout_sort_volname */
+        qsort (list, cnt, sizeof (*list), sim_entry_cmp);
+}
+
+/* dht_selfheal_layout_new_directory */
+static void
+sim_classic_new (struct sim_entry *list, int cnt, const char *path)
+{
+        uint32_t chunk = 0;
+        uint32_t start = 0;
+        int      left  = 0;
+        int      first = 0;
+        int      n     = 0;
+        int      i     = 0;
+
+        for (i = 0; i < cnt; i++)
+                left += list[i].member;
+
+        chunk = ((unsigned long) 0xffffffff) / left;
+        first = sim_hash (path) % cnt;
+
+        for (n = 0; n < cnt; n++) {
+                i = (first + n) % cnt;
+                if (!list[i].member)
+                        continue;
+                list[i].start = start;
+                list[i].stop  = start + chunk - 1;
+                if (--left == 0) {
+                        list[i].stop = 0xffffffff;
+                        break;
+                }
+                start += chunk;
+        }
+}
+
+static uint32_t
+sim_overlap (struct sim_entry *old, int o, struct sim_entry *new, int n)
+{
+        if ((old[o].start == old[o].stop) || (new[n].start == new[n].stop))
+                return 0;
+        if ((old[o].start > new[n].stop) || (old[o].stop < new[n].start))
+                return 0;
+
+        return ((old[o].stop < new[n].stop) ? old[o].stop : new[n].stop) -
+               ((old[o].start > new[n].start) ? old[o].start : new[n].start)
+               + 1;
+}
+
+/* dht_selfheal_layout_maximize_overlap */
+static void
+sim_classic_fix (struct sim_entry *new, struct sim_entry *old, int cnt)
+{
+        uint32_t *table = NULL;
+        uint32_t  best  = 0;
+        uint32_t  cur   = 0;
+        uint32_t  swap  = 0;
+        int       pick  = 0;
+        int       i     = 0;
+        int       j     = 0;
+
+        table = calloc (cnt * cnt, sizeof (*table));
+        for (i = 0; i < cnt; i++)
+                for (j = 0; j < cnt; j++)
+                        table[i * cnt + j] = sim_overlap (old, j, new, i);
+
+        for (i = 0; i < cnt; i++) {
+                best = 0;
+                pick = i;
+                for (j = i + 1; j < cnt; j++) {
+                        cur = table[i * cnt + i] + table[j * cnt + j];
+                        swap = table[i * cnt + j] + table[j * cnt + i];
+                        if ((swap > cur) && (swap - cur > best)) {
+                                best = swap - cur;
+                                pick = j;
+                        }
+                }
+                if (pick == i)
+                        continue;
+
+                swap = new[i].start;
+                new[i].start = new[pick].start;
+                new[pick].start = swap;
+                swap = new[i].stop;
+                new[i].stop = new[pick].stop;
+                new[pick].stop = swap;
+                for (j = 0; j < cnt; j++) {
+                        swap = table[i * cnt + j];
+                        table[i * cnt + j] = table[pick * cnt + j];
+                        table[pick * cnt + j] = swap;
+                }
+        }
+
+        free (table);
+}
+
+static int
+sim_range_cmp (const void *a, const void *b)
+{
+        const struct sim_range *x = a;
+        const struct sim_range *y = b;
+
+        return (x->start < y->start) ? -1 : (x->start > y->start);
+}
+
+static int
+sim_classic_ranges (struct sim_entry *list, int cnt, struct sim_range *ranges)
+{
+        int i = 0;
+        int n = 0;
+
+        for (i = 0; i < cnt; i++) {
+                if (!list[i].member)
+                        continue;
+                ranges[n].start  = list[i].start;
+                ranges[n].stop   = list[i].stop;
+                ranges[n].subvol = atoi (strrchr (list[i].name, '-') + 1);
+                n++;
+        }
+        qsort (ranges, n, sizeof (*ranges), sim_range_cmp);
+
+        return n;
+}
+
+/* dht_selfheal_vnode_id */
+static void
+sim_vnode_ids (struct sim_entry *list, int cnt, uint32_t vnodes)
+{
+        uint32_t id = 0;
+        int      i  = 0;
+        int      j  = 0;
+
+        for (i = 0; i < cnt; i++) {
+                if (!list[i].member)
+                        continue;
+                id = sim_hash (list[i].name);
+again:
+                if (!id)
+                        id = 1;
+                for (j = 0; j < i; j++) {
+                        if (list[j].member && (list[j].start == id)) {
+                                id++;
+                                goto again;
+                        }
+                }
+                list[i].start = id;
+                list[i].stop  = vnodes;
+        }
+}
+
+static int
+sim_point_cmp (const void *a, const void *b)
+{
+        const struct sim_point *x = a;
+        const struct sim_point *y = b;
+
+        if (x->point != y->point)
+                return (x->point < y->point) ? -1 : 1;
+        return x->member - y->member;
+}
+
+static void
+sim_ring_add (struct sim_range *ranges, int *n, uint32_t start, uint32_t stop,
+              int subvol)
+{
+        if (*n && (ranges[*n - 1].subvol == subvol) &&
+            (ranges[*n - 1].stop + 1 == start)) {
+                ranges[*n - 1].stop = stop;
+                return;
+        }
+        ranges[*n].start  = start;
+        ranges[*n].stop   = stop;
+        ranges[*n].subvol = subvol;
+        (*n)++;
+}
+
+/* dht_layout_index_ring */
+static int
+sim_vnode_ranges (struct sim_entry *list, int cnt, struct sim_range *ranges)
+{
+        struct sim_point *points = NULL;
+        uint32_t          buf[2];
+        uint32_t          start  = 0;
+        uint32_t          k      = 0;
+        int               total  = 0;
+        int               n      = 0;
+        int               i      = 0;
+
+        for (i = 0; i < cnt; i++)
+                total += list[i].member ? list[i].stop : 0;
+
+        points = calloc (total, sizeof (*points));
+        for (i = 0; i < cnt; i++) {
+                if (!list[i].member)
+                        continue;
+                for (k = 0; k < list[i].stop; k++) {
+                        buf[0] = htonl (list[i].start);
+                        buf[1] = htonl (k);
+                        points[n].point = gf_dm_hashfn ((char *) buf,
+                                                        sizeof (buf));
+                        points[n].member =
+                                atoi (strrchr (list[i].name, '-') + 1);
+                        n++;
+                }
+        }
+        qsort (points, total, sizeof (*points), sim_point_cmp);
+
+        n = 0;
+        for (i = 0; i < total; i++) {
+                if (i && (points[i].point == points[i - 1].point))
+                        continue;
+                sim_ring_add (ranges, &n, start, points[i].point,
+                              points[i].member);
+                if (points[i].point == 0xffffffff)
+                        break;
+                start = points[i].point + 1;
+        }
+        if (i == total)
+                sim_ring_add (ranges, &n, start, 0xffffffff,
+                              points[0].member);
+
+        free (points);
+        return n;
+}
+
+/* dht_layout_index_search */
+static int
+sim_search (struct sim_range *ranges, int cnt, uint32_t hash)
+{
+        int low   = 0;
+        int high  = cnt - 1;
+        int mid   = 0;
+        int found = -1;
+
+        while (low <= high) {
+                mid = low + (high - low) / 2;
+                if (ranges[mid].start <= hash) {
+                        found = mid;
+                        low = mid + 1;
+                } else {
+                        high = mid - 1;
+                }
+        }
+
+        if ((found < 0) || (ranges[found].stop < hash))
+                return -1;
+        return ranges[found].subvol;
+}
+
+static void
+sim_report (const char *type, struct sim_range **before, int *before_cnt,
+            struct sim_range **after, int *after_cnt, int bricks, int files)
+{
+        long     *load  = NULL;
+        long      moved = 0;
+        long      max   = 0;
+        long      total = 0;
+        char      name[64];
+        uint32_t  hash  = 0;
+        int       from  = 0;
+        int       to    = 0;
+        int       d     = 0;
+        int       f     = 0;
+        int       i     = 0;
+
+        load = calloc (bricks, sizeof (*load));
+
+        for (d = 0; d < SIM_DIRS; d++) {
+                for (f = 0; f < files; f++) {
+                        snprintf (name, sizeof (name), "file.%d.%d", d, f);
+                        hash = sim_hash (name);
+                        from = sim_search (before[d], before_cnt[d], hash);
+                        to = sim_search (after[d], after_cnt[d], hash);
+                        if (from != to)
+                                moved++;
+                        if (to >= 0)
+                                load[to]++;
+                        total++;
+                }
+        }
+
+        for (i = 0; i < bricks; i++)
+                if (load[i] > max)
+                        max = load[i];
+
+        printf ("%s moved=%.4f max-load=%.4f\n", type,
+                (double) moved / total, (double) max * bricks / total);
+
+        free (load);
+}
+
+int
+main (int argc, char *argv[])
+{
+        struct sim_entry  *old     = NULL;
+        struct sim_entry  *new     = NULL;
+        struct sim_range  *before[SIM_DIRS];
+        struct sim_range  *after[SIM_DIRS];
+        int                before_cnt[SIM_DIRS];
+        int                after_cnt[SIM_DIRS];
+        char               path[64];
+        int                bricks  = 0;
+        int                added   = 0;
+        int                vnodes  = 0;
+        int                files   = 0;
+        int                total   = 0;
+        int                d       = 0;
+
+        if (argc != 5) {
+                fprintf (stderr, "usage: %s <bricks> <added> <vnodes> "
+                         "<files>\n", argv[0]);
+                return 1;
+        }
+
+        bricks = atoi (argv[1]);
+        added  = atoi (argv[2]);
+        vnodes = atoi (argv[3]);
+        files  = atoi (argv[4]);
+        total  = bricks + added;
+
+        if ((bricks < 1) || (added < 0) || (vnodes < 1) || (files < 1))
+                return 1;
+
+        old = calloc (total, sizeof (*old));
+        new = calloc (total, sizeof (*new));
+
+        printf ("ideal moved=%.4f\n", (double) added / total);
+
+        for (d = 0; d < SIM_DIRS; d++) {
+                snprintf (path, sizeof (path), "/dir.%d", d);
+                before[d] = calloc (total + 1, sizeof (struct sim_range));
+                after[d] = calloc (total + 1, sizeof (struct sim_range));
+
+                sim_subvols (old, total, bricks);
+                sim_classic_new (old, total, path);
+                before_cnt[d] = sim_classic_ranges (old, total, before[d]);
+
+                sim_subvols (new, total, total);
+                sim_classic_new (new, total, path);
+                sim_classic_fix (new, old, total);
+                after_cnt[d] = sim_classic_ranges (new, total, after[d]);
+        }
+
+        sim_report ("classic", before, before_cnt, after, after_cnt, total,
+                    files);
+
+        for (d = 0; d < SIM_DIRS; d++) {
+                free (before[d]);
+                free (after[d]);
+                before[d] = calloc (total * vnodes + 1,
+                                    sizeof (struct sim_range));
+                after[d] = calloc (total * vnodes + 1,
+                                   sizeof (struct sim_range));
+
+                sim_subvols (old, total, bricks);
+                sim_vnode_ids (old, total, vnodes);
+                before_cnt[d] = sim_vnode_ranges (old, total, before[d]);
+
+                sim_subvols (new, total, total);
+                sim_vnode_ids (new, total, vnodes);
+                after_cnt[d] = sim_vnode_ranges (new, total, after[d]);
+        }
+
+        sim_report ("vnode", before, before_cnt, after, after_cnt, total,
+                    files);
+
+        for (d = 0; d < SIM_DIRS; d++) {
+                free (before[d]);
+                free (after[d]);
+        }
+        free (old);
+        free (new);
+
+        return 0;
+}
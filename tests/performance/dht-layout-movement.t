@@ -0,0 +1,47 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+#Simulated add-brick: share of files changing their hashed subvolume with
+#the contiguous layouts of fix-layout and with cluster.layout-vnodes rings.
+#A ring only gives up the new brick's fair share.
+
+cleanup;
+
+SRC=$(dirname $0)/../..
+
+function build_tester ()
+{
+        local cfile=$1
+        local fname=$(basename "$cfile")
+        local execname="${fname%.*}"
+        gcc -g -D_CONFIG_H -I $SRC/libglusterfs/src -o \
+                $(dirname $cfile)/$execname $cfile \
+                $SRC/libglusterfs/src/hashfn.c
+}
+
+function moved ()
+{
+        $(dirname $0)/dht-layout-movement $1 $2 128 20000 | \
+                awk -v type=$3 '$1 == type { split ($2, f, "="); print f[2] }'
+}
+
+function within ()
+{
+        awk -v got=$1 -v want=$2 -v slack=$3 \
+                'BEGIN { print ((got <= want * slack) ? "yes" : "no") }'
+}
+
+TEST build_tester $(dirname $0)/dht-layout-movement.c
+
+TEST $(dirname $0)/dht-layout-movement 20 1 128 20000
+
+#20 -> 21 bricks, 1/21 of the files should move
+EXPECT "yes" within $(moved 20 1 vnode) 0.0476 1.5
+EXPECT "no" within $(moved 20 1 classic) 0.0476 1.5
+
+#4 -> 5 bricks
+EXPECT "yes" within $(moved 4 1 vnode) 0.2 1.5
+
+TEST rm -f $(dirname $0)/dht-layout-movement
+cleanup;
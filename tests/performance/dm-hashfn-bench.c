@@ -0,0 +1,270 @@
+/*
+  Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+  This file is part of GlusterFS.
+
+  This file is licensed to you under your choice of the GNU Lesser
+  General Public License, version 3 or any later version (LGPLv3 or
+  later), or the GNU General Public License, version 2 (GPLv2), in all
+  cases as published by the Free Software Foundation.
+*/
+
+/*
+ * Checks gf_dm_hashfn and gf_dm_hashfn_multi against the original scalar
+ * implementation, kept below as ref_dm_hashfn, and times all three.
+ *
+ *   dm-hashfn-bench fuzz <iterations>
+ *   dm-hashfn-bench bench <names> <passes>
+ *
+ * Build: gcc -O2 -D_CONFIG_H -I libglusterfs/src dm-hashfn-bench.c \
+ *            libglusterfs/src/hashfn.c
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+#include "hashfn.h"
+
+#define DM_DELTA 0x9E3779B9
+#define DM_FULLROUNDS 10
+#define DM_PARTROUNDS 6
+
+#define FUZZ_MAXLEN   300
+#define FUZZ_BATCH    64
+
+/* libglusterfs/src/hashfn.c as it was before gf_dm_hashfn_multi */
+static int
+ref_dm_round (int rounds, uint32_t *array, uint32_t *h0, uint32_t *h1)
+{
+        uint32_t sum = 0;
+        int      n = 0;
+        uint32_t b0  = 0;
+        uint32_t b1  = 0;
+
+        b0 = *h0;
+        b1 = *h1;
+
+        n = rounds;
+
+        do {
+                sum += DM_DELTA;
+                b0  += ((b1 << 4) + array[0])
+                        ^ (b1 + sum)
+                        ^ ((b1 >> 5) + array[1]);
+                b1  += ((b0 << 4) + array[2])
+                        ^ (b0 + sum)
+                        ^ ((b0 >> 5) + array[3]);
+        } while (--n);
+
+        *h0 += b0;
+        *h1 += b1;
+
+        return 0;
+}
+
+
+static uint32_t
+ref_pad (int len)
+{
+        uint32_t pad = 0;
+
+        pad = (uint32_t) len | ((uint32_t) len << 8);
+        pad |= pad << 16;
+
+        return pad;
+}
+
+static uint32_t
+ref_dm_hashfn (const char *msg, int len)
+{
+        uint32_t  h0 = 0x9464a485;
+        uint32_t  h1 = 0x542e1a94;
+        uint32_t  array[4];
+        uint32_t  pad = 0;
+        int       i = 0;
+        int       j = 0;
+        int       full_quads = 0;
+        int       full_words = 0;
+        int       full_bytes = 0;
+        uint32_t *intmsg = NULL;
+        int       word = 0;
+
+
+        intmsg = (uint32_t *) msg;
+        pad = ref_pad (len);
+
+        full_bytes   = len;
+        full_words   = len / 4;
+        full_quads   = len / 16;
+
+        for (i = 0; i < full_quads; i++) {
+                for (j = 0; j < 4; j++) {
+                        word     = *intmsg;
+                        array[j] = word;
+                        intmsg++;
+                        full_words--;
+                        full_bytes -= 4;
+                }
+                ref_dm_round (DM_PARTROUNDS, &array[0], &h0, &h1);
+        }
+
+        for (j = 0; j < 4; j++) {
+                if (full_words) {
+                        word     = *intmsg;
+                        array[j] = word;
+                        intmsg++;
+                        full_words--;
+                        full_bytes -= 4;
+                } else {
+                        array[j] = pad;
+                        while (full_bytes) {
+                                array[j] <<= 8;
+                                array[j] |= msg[len - full_bytes];
+                                full_bytes--;
+                        }
+                }
+        }
+        ref_dm_round (DM_FULLROUNDS, &array[0], &h0, &h1);
+
+        return h0 ^ h1;
+}
+
+static double
+now (void)
+{
+        struct timeval tv = {0, };
+
+        gettimeofday (&tv, NULL);
+        return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+fill (char *buf, int len)
+{
+        int i = 0;
+
+        /* high bytes too, they are shifted in sign extended */
+        for (i = 0; i < len; i++)
+                buf[i] = random () & 0xff;
+}
+
+static int
+fuzz (long iterations)
+{
+        char        pool[FUZZ_BATCH][FUZZ_MAXLEN + 4];
+        const char *msgs[FUZZ_BATCH];
+        int         lens[FUZZ_BATCH];
+        uint32_t    hashes[FUZZ_BATCH];
+        uint32_t    want = 0;
+        long        it   = 0;
+        int         cnt  = 0;
+        int         i    = 0;
+
+        srandom (0x5eed);
+
+        for (it = 0; it < iterations; it++) {
+                cnt = random () % (FUZZ_BATCH + 1);
+                for (i = 0; i < cnt; i++) {
+                        /* short names are the common case */
+                        lens[i] = (random () % 4) ? random () % 40
+                                                  : random () % FUZZ_MAXLEN;
+                        /* and names need not be aligned */
+                        msgs[i] = pool[i] + random () % 4;
+                        fill ((char *) msgs[i], lens[i]);
+                }
+
+                gf_dm_hashfn_multi (msgs, lens, hashes, cnt);
+
+                for (i = 0; i < cnt; i++) {
+                        want = ref_dm_hashfn (msgs[i], lens[i]);
+                        if ((gf_dm_hashfn (msgs[i], lens[i]) != want) ||
+                            (hashes[i] != want)) {
+                                fprintf (stderr, "mismatch at iteration %ld "
+                                         "length %d: %08x %08x want %08x\n",
+                                         it, lens[i],
+                                         gf_dm_hashfn (msgs[i], lens[i]),
+                                         hashes[i], want);
+                                return 1;
+                        }
+                }
+        }
+
+        printf ("fuzz ok=%ld\n", iterations);
+        return 0;
+}
+
+static int
+bench (int names, int passes)
+{
+        char       **msgs   = NULL;
+        int         *lens   = NULL;
+        uint32_t    *hashes = NULL;
+        uint32_t     sink   = 0;
+        double       start  = 0;
+        double       ref    = 0;
+        double       scalar = 0;
+        double       multi  = 0;
+        int          p      = 0;
+        int          i      = 0;
+
+        msgs = calloc (names, sizeof (*msgs));
+        lens = calloc (names, sizeof (*lens));
+        hashes = calloc (names, sizeof (*hashes));
+
+        for (i = 0; i < names; i++) {
+                msgs[i] = malloc (64);
+                if (i % 2)
+                        lens[i] = sprintf (msgs[i], "file.%d", i);
+                else
+                        lens[i] = sprintf (msgs[i], "IMG_%08d_export.jpeg", i);
+        }
+
+        start = now ();
+        for (p = 0; p < passes; p++)
+                for (i = 0; i < names; i++)
+                        sink ^= ref_dm_hashfn (msgs[i], lens[i]);
+        ref = now () - start;
+
+        start = now ();
+        for (p = 0; p < passes; p++)
+                for (i = 0; i < names; i++)
+                        sink ^= gf_dm_hashfn (msgs[i], lens[i]);
+        scalar = now () - start;
+
+        start = now ();
+        for (p = 0; p < passes; p++) {
+                gf_dm_hashfn_multi ((const char **) msgs, lens, hashes, names);
+                sink ^= hashes[p % names];
+        }
+        multi = now () - start;
+
+        printf ("names=%d passes=%d sink=%08x\n", names, passes, sink);
+        printf ("reference %.1f Mnames/s\n", names * passes / ref / 1e6);
+        printf ("scalar %.1f Mnames/s\n", names * passes / scalar / 1e6);
+        printf ("multi %.1f Mnames/s\n", names * passes / multi / 1e6);
+        printf ("speedup %.2f\n", ref / multi);
+
+        for (i = 0; i < names; i++)
+                free (msgs[i]);
+        free (msgs);
+        free (lens);
+        free (hashes);
+
+        return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+        if ((argc == 3) && !strcmp (argv[1], "fuzz"))
+                return fuzz (atol (argv[2]));
+
+        if ((argc == 4) && !strcmp (argv[1], "bench"))
+                return bench (atoi (argv[2]), atoi (argv[3]));
+
+        fprintf (stderr, "usage: %s fuzz <iterations> | "
+                 "bench <names> <passes>\n", argv[0]);
+        return 1;
+}
@@ -0,0 +1,30 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+
+#gf_dm_hashfn and the batched gf_dm_hashfn_multi must give the same hashes
+#as the original Davies-Meyer code, or every directory layout on disk would
+#point at the wrong subvolume. Also prints their relative throughput.
+
+cleanup;
+
+SRC=$(dirname $0)/../..
+
+function build_tester ()
+{
+        local cfile=$1
+        local fname=$(basename "$cfile")
+        local execname="${fname%.*}"
+        gcc -g -O2 -D_CONFIG_H -I $SRC/libglusterfs/src -o \
+                $(dirname $cfile)/$execname $cfile \
+                $SRC/libglusterfs/src/hashfn.c
+}
+
+TEST build_tester $(dirname $0)/dm-hashfn-bench.c
+
+EXPECT "fuzz ok=100000" $(dirname $0)/dm-hashfn-bench fuzz 100000
+
+TEST $(dirname $0)/dm-hashfn-bench bench 100000 20
+
+TEST rm -f $(dirname $0)/dm-hashfn-bench
+cleanup;
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+/* Holds many byte-range locks on one file and times lock, conflict check
+ * and unlock, as databases and MPI-IO applications do on shared files.
+ * Lock i covers [2 * i * SLOT, 2 * i * SLOT + SLOT), leaving a hole of
+ * SLOT bytes between every two locks.
+ */
+
+#define SLOT 4096
+
+static long long
+usec_since (struct timeval *start)
+{
+        struct timeval now = {0, };
+
+        gettimeofday (&now, NULL);
+
+        return (now.tv_sec - start->tv_sec) * 1000000LL +
+                (now.tv_usec - start->tv_usec);
+}
+
+static int
+set_lock (int fd, int cmd, short type, off_t start, off_t len)
+{
+        struct flock lock = {0, };
+
+        lock.l_type   = type;
+        lock.l_whence = SEEK_SET;
+        lock.l_start  = start;
+        lock.l_len    = len;
+
+        return fcntl (fd, cmd, &lock);
+}
+
+static void
+report (const char *phase, long long usec, int count)
+{
+        printf ("%-16s %8d ops %10lld usec %8.2f usec/op\n", phase, count,
+                usec, count ? (double) usec / count : 0.0);
+}
+
+int
+run_child (char *filename, int count, int notify)
+{
+        int            fd    = -1, ret = -1, i = 0;
+        struct timeval start = {0, };
+
+        fd = open (filename, O_RDWR);
+        if (fd < 0) {
+                fprintf (stderr, "open failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        /* every lock held by the parent must be seen as a conflict */
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                if (set_lock (fd, F_SETLK, F_WRLCK, 2 * i * SLOT,
+                              SLOT) == 0) {
+                        fprintf (stderr, "lock %d granted over a held "
+                                 "range\n", i);
+                        goto out;
+                }
+        }
+        report ("conflict", usec_since (&start), count);
+
+        /* the holes in between are free */
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                if (set_lock (fd, F_SETLK, F_WRLCK, (2 * i + 1) * SLOT,
+                              SLOT) < 0) {
+                        fprintf (stderr, "lock on hole %d failed (%s)\n", i,
+                                 strerror (errno));
+                        goto out;
+                }
+        }
+        report ("lock-holes", usec_since (&start), count);
+
+        if (write (notify, "x", 1) != 1) {
+                fprintf (stderr, "notify failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        /* wait for the parent to release the first range */
+        gettimeofday (&start, NULL);
+        if (set_lock (fd, F_SETLKW, F_WRLCK, 0, SLOT) < 0) {
+                fprintf (stderr, "blocking lock failed (%s)\n",
+                         strerror (errno));
+                goto out;
+        }
+        report ("blocked-grant", usec_since (&start), 1);
+
+        ret = 0;
+out:
+        if (fd >= 0)
+                close (fd);
+
+        return ret;
+}
+
+int
+main (int argc, char *argv[])
+{
+        int            fd       = -1, ret = -1, status = 0, i = 0;
+        int            count    = 0;
+        char          *filename = NULL;
+        int            pipefd[2] = {-1, -1};
+        char           c        = 0;
+        pid_t          pid      = 0;
+        struct timeval start    = {0, };
+
+        if (argc != 3) {
+                fprintf (stderr, "Usage: %s <filename> <lock-count>\n",
+                         argv[0]);
+                goto out;
+        }
+
+        filename = argv[1];
+        count = atoi (argv[2]);
+        if (count <= 0) {
+                fprintf (stderr, "invalid lock count %s\n", argv[2]);
+                goto out;
+        }
+
+        fd = open (filename, O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+                fprintf (stderr, "open failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                if (set_lock (fd, F_SETLK, F_WRLCK, 2 * i * SLOT,
+                              SLOT) < 0) {
+                        fprintf (stderr, "lock %d failed (%s)\n", i,
+                                 strerror (errno));
+                        goto out;
+                }
+        }
+        report ("lock", usec_since (&start), count);
+
+        if (pipe (pipefd) < 0) {
+                fprintf (stderr, "pipe failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        fflush (stdout);
+
+        pid = fork ();
+        if (pid < 0) {
+                fprintf (stderr, "fork failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        if (pid == 0)
+                exit (run_child (filename, count, pipefd[1]) ? 1 : 0);
+
+        close (pipefd[1]);
+
+        /* wait for the child to run through its non-blocking phases, give
+           it time to queue its blocking lock, then release everything */
+        if (read (pipefd[0], &c, 1) != 1) {
+                fprintf (stderr, "child failed before blocking\n");
+                goto out;
+        }
+        sleep (1);
+
+        gettimeofday (&start, NULL);
+        for (i = 0; i < count; i++) {
+                if (set_lock (fd, F_SETLK, F_UNLCK, 2 * i * SLOT,
+                              SLOT) < 0) {
+                        fprintf (stderr, "unlock %d failed (%s)\n", i,
+                                 strerror (errno));
+                        goto out;
+                }
+        }
+        report ("unlock", usec_since (&start), count);
+
+        if (waitpid (pid, &status, 0) < 0) {
+                fprintf (stderr, "waitpid failed (%s)\n", strerror (errno));
+                goto out;
+        }
+
+        if (!WIFEXITED (status) || WEXITSTATUS (status)) {
+                fprintf (stderr, "child failed\n");
+                goto out;
+        }
+
+        ret = 0;
+out:
+        if (fd >= 0)
+                close (fd);
+
+        return ret;
+}
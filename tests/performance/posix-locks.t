@@ -0,0 +1,40 @@
+#!/bin/bash
+
+. $(dirname $0)/../include.rc
+. $(dirname $0)/../volume.rc
+
+#Lock-heavy benchmark for the locks translator: thousands of byte-range
+#locks held on one file, checked for conflicts from another process, then
+#released one by one while a blocked lock waits to be granted.
+
+cleanup;
+
+function build_tester ()
+{
+    local cfile=$1
+    local fname=$(basename "$cfile")
+    local execname="${fname%.*}"
+    gcc -g -o $(dirname $cfile)/$execname $cfile
+}
+
+TEST glusterd
+TEST pidof glusterd
+
+TEST $CLI volume create $V0 $H0:$B0/${V0}0
+TEST $CLI volume start $V0
+
+TEST glusterfs --entry-timeout=0 --attribute-timeout=0 -s $H0 --volfile-id=$V0 $M0
+
+TEST build_tester $(dirname $0)/posix-locks-bench.c
+
+TEST $(dirname $0)/posix-locks-bench $M0/lockfile 20000
+
+#All the locks went away with the benchmark, and the blocked one was
+#accounted as granted after waiting
+statedump=$(generate_brick_statedump $V0 $H0 $B0/${V0}0)
+EXPECT "0" echo $(grep -c "^posixlk\[" $statedump)
+EXPECT "1" echo $(grep "^posixlk.granted-after-wait=" $statedump | cut -f2 -d'=')
+rm -f $statedump
+
+TEST rm -f $(dirname $0)/posix-locks-bench
+cleanup;
@@ -202,11 +202,26 @@ out:
         return ret;
 }
 
+static void
+afr_dir_eager_destroy (afr_dir_eager_t *dir_eager)
+{
+        if (!dir_eager)
+                return;
+
+        GF_FREE (dir_eager->pre_op_done);
+        GF_FREE (dir_eager->pre_op_piggyback);
+        GF_FREE (dir_eager->lock_piggyback);
+        GF_FREE (dir_eager->lock_acquired);
+        pthread_mutex_destroy (&dir_eager->delay_lock);
+        GF_FREE (dir_eager);
+}
+
 void
 afr_inode_ctx_destroy (afr_inode_ctx_t *ctx)
 {
         if (!ctx)
                 return;
+        afr_dir_eager_destroy (ctx->dir_eager);
         GF_FREE (ctx->fresh_children);
         GF_FREE (ctx);
 }
@@ -265,6 +280,94 @@ afr_inode_ctx_get (inode_t *inode, xlator_t *this)
         return ctx;
 }
 
+static afr_dir_eager_t *
+afr_dir_eager_new (xlator_t *this)
+{
+        afr_private_t   *priv      = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+
+        priv = this->private;
+
+        dir_eager = GF_CALLOC (1, sizeof (*dir_eager), gf_afr_mt_dir_eager_t);
+        if (!dir_eager)
+                goto fail;
+
+        dir_eager->pre_op_done = GF_CALLOC (priv->child_count,
+                                            sizeof (*dir_eager->pre_op_done),
+                                            gf_afr_mt_int32_t);
+        if (!dir_eager->pre_op_done)
+                goto fail;
+
+        dir_eager->pre_op_piggyback =
+                GF_CALLOC (priv->child_count,
+                           sizeof (*dir_eager->pre_op_piggyback),
+                           gf_afr_mt_int32_t);
+        if (!dir_eager->pre_op_piggyback)
+                goto fail;
+
+        dir_eager->lock_piggyback =
+                GF_CALLOC (priv->child_count,
+                           sizeof (*dir_eager->lock_piggyback),
+                           gf_afr_mt_int32_t);
+        if (!dir_eager->lock_piggyback)
+                goto fail;
+
+        dir_eager->lock_acquired = GF_CALLOC (priv->child_count,
+                                              sizeof (*dir_eager->lock_acquired),
+                                              gf_afr_mt_int32_t);
+        if (!dir_eager->lock_acquired)
+                goto fail;
+
+        INIT_LIST_HEAD (&dir_eager->waiting);
+        pthread_mutex_init (&dir_eager->delay_lock, NULL);
+
+        return dir_eager;
+
+fail:
+        if (dir_eager) {
+                GF_FREE (dir_eager->pre_op_done);
+                GF_FREE (dir_eager->pre_op_piggyback);
+                GF_FREE (dir_eager->lock_piggyback);
+                GF_FREE (dir_eager);
+        }
+        return NULL;
+}
+
+/* Returns the eager-lock state of directory @inode. With @create unset
+ * nothing is allocated, so callers which only want to release what an
+ * earlier transaction left behind do not grow every inode ctx.
+ */
+afr_dir_eager_t *
+afr_dir_eager_get (inode_t *inode, xlator_t *this, gf_boolean_t create)
+{
+        afr_inode_ctx_t *ctx       = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+        uint64_t         ctx_addr  = 0;
+
+        LOCK (&inode->lock);
+        {
+                if (!create) {
+                        __inode_ctx_get (inode, this, &ctx_addr);
+                        ctx = (afr_inode_ctx_t *) (long) ctx_addr;
+                        if (ctx)
+                                dir_eager = ctx->dir_eager;
+                        goto unlock;
+                }
+
+                ctx = __afr_inode_ctx_get (inode, this);
+                if (!ctx)
+                        goto unlock;
+
+                if (!ctx->dir_eager)
+                        ctx->dir_eager = afr_dir_eager_new (this);
+                dir_eager = ctx->dir_eager;
+        }
+unlock:
+        UNLOCK (&inode->lock);
+
+        return dir_eager;
+}
+
 void
 afr_inode_get_ctx_params (xlator_t *this, inode_t *inode,
                           afr_inode_params_t *params)
@@ -868,6 +971,23 @@ afr_local_transaction_cleanup (afr_local_t *local, xlator_t *this)
 }
 
 
+void
+afr_read_chunks_cleanup (afr_read_chunk_t *chunks, int count)
+{
+        int     i = 0;
+
+        if (!chunks)
+                return;
+
+        for (i = 0; i < count; i++) {
+                GF_FREE (chunks[i].vector);
+                if (chunks[i].iobref)
+                        iobref_unref (chunks[i].iobref);
+        }
+
+        GF_FREE (chunks);
+}
+
 void
 afr_local_cleanup (afr_local_t *local, xlator_t *this)
 {
@@ -961,6 +1081,12 @@ afr_local_cleanup (afr_local_t *local, xlator_t *this)
                         dict_unref (local->cont.symlink.params);
         }
 
+        { /* readv */
+                afr_read_chunks_cleanup (local->cont.readv.chunks,
+                                         local->cont.readv.chunk_count);
+                local->cont.readv.chunks = NULL;
+        }
+
         { /* writev */
                 GF_FREE (local->cont.writev.vector);
         }
@@ -3579,8 +3705,7 @@ afr_forget (xlator_t *this, inode_t *inode)
                 goto out;
 
         ctx = (afr_inode_ctx_t *)(long)ctx_addr;
-        GF_FREE (ctx->fresh_children);
-        GF_FREE (ctx);
+        afr_inode_ctx_destroy (ctx);
 out:
         return 0;
 }
@@ -3607,6 +3732,8 @@ afr_priv_dump (xlator_t *this)
                 gf_proc_dump_write(key, "%d", priv->child_up[i]);
                 sprintf (key, "pending_key[%d]", i);
                 gf_proc_dump_write(key, "%s", priv->pending_key[i]);
+                sprintf (key, "read_latency[%d]", i);
+                gf_proc_dump_write(key, "%"PRIu64, priv->read_latency[i]);
         }
         gf_proc_dump_write("data_self_heal", "%s", priv->data_self_heal);
         gf_proc_dump_write("metadata_self_heal", "%d", priv->metadata_self_heal);
@@ -4213,6 +4340,7 @@ afr_priv_destroy (afr_private_t *priv)
                 eh_destroy (priv->shd.split_brain);
 
         GF_FREE (priv->last_event);
+        GF_FREE (priv->read_latency);
         if (priv->pending_key) {
                 for (i = 0; i < priv->child_count; i++)
                         GF_FREE (priv->pending_key[i]);
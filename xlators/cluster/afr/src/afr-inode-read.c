@@ -1793,6 +1793,324 @@ out:
 }
 
 
+/* chunk boundaries of a split readv are kept page aligned */
+#define AFR_READ_SPLIT_ALIGN   (4 * GF_UNIT_KB)
+
+/* Fold the time a subvolume took to read @size bytes into its moving
+ * average, normalized to usec per MB so that chunks of different sizes
+ * compare.
+ */
+static void
+afr_read_latency_update (xlator_t *this, int child, struct timeval *start,
+                         size_t size)
+{
+        afr_private_t  *priv = NULL;
+        struct timeval  now  = {0, };
+        uint64_t        usec = 0;
+        uint64_t        cost = 0;
+
+        priv = this->private;
+
+        gettimeofday (&now, NULL);
+        usec = (now.tv_sec - start->tv_sec) * 1000000 +
+                (now.tv_usec - start->tv_usec);
+
+        if (size < AFR_READ_SPLIT_ALIGN)
+                size = AFR_READ_SPLIT_ALIGN;
+        cost = (usec * GF_UNIT_MB) / size;
+        if (!cost)
+                cost = 1;
+
+        LOCK (&priv->read_child_lock);
+        {
+                if (!priv->read_latency[child])
+                        priv->read_latency[child] = cost;
+                else
+                        priv->read_latency[child] =
+                                (7 * priv->read_latency[child] + cost) / 8;
+        }
+        UNLOCK (&priv->read_child_lock);
+}
+
+
+static void
+afr_readv_split_done (call_frame_t *frame, xlator_t *this)
+{
+        afr_private_t    *priv       = NULL;
+        afr_local_t      *local      = NULL;
+        afr_read_chunk_t *chunks     = NULL;
+        struct iovec     *vector     = NULL;
+        struct iobref    *iobref     = NULL;
+        struct iatt       buf        = {0, };
+        int32_t           op_ret     = 0;
+        int32_t           op_errno   = 0;
+        int               count      = 0;
+        int               call_child = 0;
+        int               last       = 0;
+        int               i          = 0;
+
+        priv   = this->private;
+        local  = frame->local;
+        chunks = local->cont.readv.chunks;
+
+        for (i = 0; i < local->cont.readv.chunk_count; i++) {
+                if (chunks[i].op_ret < 0)
+                        goto failover;
+        }
+
+        /* the replicas are in sync, so a short chunk is the end of file
+           and whatever was read after it is empty */
+        for (i = 0; i < local->cont.readv.chunk_count; i++) {
+                count  += chunks[i].count;
+                op_ret += chunks[i].op_ret;
+                last    = i;
+                if (chunks[i].op_ret < chunks[i].size)
+                        break;
+        }
+
+        buf = chunks[last].buf;
+
+        iobref = iobref_new ();
+        vector = GF_CALLOC (count ? count : 1, sizeof (*vector),
+                            gf_afr_mt_iovec);
+        if (!iobref || !vector) {
+                op_ret   = -1;
+                op_errno = ENOMEM;
+                goto unwind;
+        }
+
+        count = 0;
+        for (i = 0; i <= last; i++) {
+                if (chunks[i].count) {
+                        memcpy (&vector[count], chunks[i].vector,
+                                chunks[i].count * sizeof (*vector));
+                        count += chunks[i].count;
+                }
+                if (chunks[i].iobref)
+                        iobref_merge (iobref, chunks[i].iobref);
+        }
+
+unwind:
+        AFR_STACK_UNWIND (readv, frame, op_ret, op_errno, vector, count,
+                          &buf, iobref, NULL);
+
+        if (iobref)
+                iobref_unref (iobref);
+        GF_FREE (vector);
+        return;
+
+failover:
+        /* let the read child serve the whole request, failing over to the
+           other subvolumes the same way an unsplit readv does */
+        afr_read_chunks_cleanup (chunks, local->cont.readv.chunk_count);
+        local->cont.readv.chunks      = NULL;
+        local->cont.readv.chunk_count = 0;
+
+        call_child = local->cont.readv.call_child;
+
+        STACK_WIND_COOKIE (frame, afr_readv_cbk,
+                           (void *) (long) call_child,
+                           priv->children[call_child],
+                           priv->children[call_child]->fops->readv,
+                           local->fd, local->cont.readv.size,
+                           local->cont.readv.offset,
+                           local->cont.readv.flags, local->xdata_req);
+}
+
+
+int32_t
+afr_readv_split_cbk (call_frame_t *frame, void *cookie,
+                     xlator_t *this, int32_t op_ret, int32_t op_errno,
+                     struct iovec *vector, int32_t count, struct iatt *buf,
+                     struct iobref *iobref, dict_t *xdata)
+{
+        afr_local_t      *local      = NULL;
+        afr_read_chunk_t *chunk      = NULL;
+        int               call_count = 0;
+
+        local = frame->local;
+        chunk = &local->cont.readv.chunks[(long) cookie];
+
+        chunk->op_ret   = op_ret;
+        chunk->op_errno = op_errno;
+
+        if (op_ret >= 0) {
+                if (count) {
+                        chunk->vector = iov_dup (vector, count);
+                        if (!chunk->vector) {
+                                chunk->op_ret   = -1;
+                                chunk->op_errno = ENOMEM;
+                                goto out;
+                        }
+                        chunk->count = count;
+                }
+                if (iobref)
+                        chunk->iobref = iobref_ref (iobref);
+                if (buf)
+                        chunk->buf = *buf;
+
+                if (op_ret == chunk->size)
+                        afr_read_latency_update (this, chunk->child,
+                                                 &chunk->start, chunk->size);
+        }
+
+out:
+        call_count = afr_frame_return (frame);
+        if (call_count == 0)
+                afr_readv_split_done (frame, this);
+
+        return 0;
+}
+
+
+/* Split a large readv across all the in-sync subvolumes the fd is open
+ * on. Each one gets a share inversely proportional to its read latency,
+ * so that the chunks complete at about the same time and a slow brick
+ * is steered away from instead of holding up the whole request.
+ *
+ * Returns -1 if the request is not split, in which case the caller reads
+ * it from the read child as usual.
+ */
+static int
+afr_readv_split (call_frame_t *frame, xlator_t *this, dict_t *xdata)
+{
+        afr_private_t    *priv       = NULL;
+        afr_local_t      *local      = NULL;
+        afr_fd_ctx_t     *fd_ctx     = NULL;
+        afr_read_chunk_t *chunks     = NULL;
+        int              *candidates = NULL;
+        uint64_t         *weight     = NULL;
+        uint64_t         *len        = NULL;
+        uint64_t          sum        = 0;
+        uint64_t          min        = 0;
+        uint64_t          left       = 0;
+        size_t            size       = 0;
+        off_t             offset     = 0;
+        int               fastest    = 0;
+        int               count      = 0;
+        int               chunk_count = 0;
+        int               child      = 0;
+        int               i          = 0;
+
+        priv  = this->private;
+        local = frame->local;
+        size  = local->cont.readv.size;
+
+        if (!priv->read_split_size || size < priv->read_split_size)
+                return -1;
+
+        fd_ctx = afr_fd_ctx_get (local->fd, this);
+        if (!fd_ctx)
+                return -1;
+
+        candidates = alloca (priv->child_count * sizeof (*candidates));
+        weight     = alloca (priv->child_count * sizeof (*weight));
+        len        = alloca (priv->child_count * sizeof (*len));
+
+        for (i = 0; i < priv->child_count; i++) {
+                child = local->fresh_children[i];
+                if (child == -1)
+                        break;
+                if (!local->child_up[child] ||
+                    fd_ctx->opened_on[child] != AFR_FD_OPENED)
+                        continue;
+                candidates[count++] = child;
+        }
+
+        if (count < 2)
+                return -1;
+
+        LOCK (&priv->read_child_lock);
+        {
+                for (i = 0; i < count; i++)
+                        weight[i] = priv->read_latency[candidates[i]];
+        }
+        UNLOCK (&priv->read_child_lock);
+
+        /* subvolumes without a sample yet are taken to be as fast as the
+           fastest one, so that they get measured */
+        for (i = 0; i < count; i++) {
+                if (weight[i] && (!min || weight[i] < min))
+                        min = weight[i];
+        }
+        if (!min)
+                min = 1;
+
+        for (i = 0; i < count; i++) {
+                weight[i] = (1ULL << 32) / (weight[i] ? weight[i] : min);
+                if (weight[i] > weight[fastest])
+                        fastest = i;
+                sum += weight[i];
+        }
+
+        left = size;
+        for (i = 0; i < count; i++) {
+                len[i]  = (size * weight[i]) / sum;
+                len[i] -= len[i] % AFR_READ_SPLIT_ALIGN;
+                left   -= len[i];
+        }
+        len[fastest] += left;
+
+        for (i = 0; i < count; i++) {
+                if (len[i])
+                        chunk_count++;
+        }
+
+        if (chunk_count < 2)
+                return -1;
+
+        chunks = GF_CALLOC (chunk_count, sizeof (*chunks),
+                            gf_afr_mt_read_chunk_t);
+        if (!chunks)
+                return -1;
+
+        offset = local->cont.readv.offset;
+        chunk_count = 0;
+        for (i = 0; i < count; i++) {
+                if (!len[i]) {
+                        /* too slow to get a share this time; age its
+                           sample so that it gets retried eventually */
+                        LOCK (&priv->read_child_lock);
+                        {
+                                priv->read_latency[candidates[i]] -=
+                                        priv->read_latency[candidates[i]] / 8;
+                        }
+                        UNLOCK (&priv->read_child_lock);
+                        continue;
+                }
+
+                chunks[chunk_count].child  = candidates[i];
+                chunks[chunk_count].offset = offset;
+                chunks[chunk_count].size   = len[i];
+                offset += len[i];
+                chunk_count++;
+        }
+
+        local->cont.readv.chunks      = chunks;
+        local->cont.readv.chunk_count = chunk_count;
+        local->call_count             = chunk_count;
+
+        /* kept for the read child in case the split read fails over */
+        if (xdata)
+                local->xdata_req = dict_ref (xdata);
+
+        for (i = 0; i < chunk_count; i++) {
+                child = chunks[i].child;
+                gettimeofday (&chunks[i].start, NULL);
+
+                STACK_WIND_COOKIE (frame, afr_readv_split_cbk,
+                                   (void *) (long) i,
+                                   priv->children[child],
+                                   priv->children[child]->fops->readv,
+                                   local->fd, chunks[i].size,
+                                   chunks[i].offset,
+                                   local->cont.readv.flags, xdata);
+        }
+
+        return 0;
+}
+
+
 int32_t
 afr_readv (call_frame_t *frame, xlator_t *this,
            fd_t *fd, size_t size, off_t offset, uint32_t flags, dict_t *xdata)
@@ -1847,11 +2165,19 @@ afr_readv (call_frame_t *frame, xlator_t *this,
         local->cont.readv.offset     = offset;
         local->cont.readv.flags      = flags;
 
+        local->cont.readv.call_child = call_child;
+
         ret = afr_open_fd_fix (frame, this, _gf_false);
         if (ret) {
                 op_errno = -ret;
                 goto out;
         }
+
+        if (afr_readv_split (frame, this, xdata) == 0) {
+                ret = 0;
+                goto out;
+        }
+
         STACK_WIND_COOKIE (frame, afr_readv_cbk,
                            (void *) (long) call_child,
                            children[call_child],
@@ -819,6 +819,9 @@ afr_unlock_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         int_lock->lockee[lockee_no].locked_nodes[child_index] &= LOCKED_NO;
+        if (local->transaction.eager_lock)
+                local->transaction.eager_lock[child_index] = 0;
+
         afr_unlock_common_cbk (frame, cookie, this, op_ret, op_errno, NULL);
 
         return 0;
@@ -835,6 +838,9 @@ afr_unlock_entrylk (call_frame_t *frame, xlator_t *this)
         int                     lockee_no       = 0;
         int                     copies          = 0;
         int                     i               = -1;
+        int                     piggyback       = 0;
+        inode_t                 *dir_inode      = NULL;
+        afr_dir_eager_t         *dir_eager      = NULL;
 
         local    = frame->local;
         int_lock = &local->internal_lock;
@@ -852,10 +858,38 @@ afr_unlock_entrylk (call_frame_t *frame, xlator_t *this)
                 goto out;
         }
 
+        dir_inode = afr_entry_eager_lock_inode (local);
+        if (dir_inode)
+                dir_eager = afr_dir_eager_get (dir_inode, this, _gf_false);
+
         for (i = 0; i < int_lock->lockee_count * priv->child_count; i++) {
                 lockee_no = i / copies;
                 index     = i % copies;
                 if (int_lock->lockee[lockee_no].locked_nodes[index] & LOCKED_YES) {
+                        if (!dir_eager || !local->transaction.eager_lock[index])
+                                goto wind;
+
+                        piggyback = 0;
+
+                        LOCK (&dir_inode->lock);
+                        {
+                                if (dir_eager->lock_piggyback[index]) {
+                                        dir_eager->lock_piggyback[index]--;
+                                        piggyback = 1;
+                                } else {
+                                        dir_eager->lock_acquired[index]--;
+                                }
+                        }
+                        UNLOCK (&dir_inode->lock);
+
+                        if (piggyback) {
+                                afr_unlock_entrylk_cbk (frame, (void *) (long) i,
+                                                        this, 1, 0, NULL);
+                                if (!--call_count)
+                                        break;
+                                continue;
+                        }
+                wind:
                         AFR_TRACE_ENTRYLK_IN (frame, this, AFR_ENTRYLK_NB_TRANSACTION,
                                               AFR_UNLOCK_OP,
                                               int_lock->lockee[lockee_no].basename,
@@ -1185,10 +1219,12 @@ afr_lock_blocking (call_frame_t *frame, xlator_t *this, int cookie)
 int32_t
 afr_blocking_lock (call_frame_t *frame, xlator_t *this)
 {
-        afr_internal_lock_t *int_lock = NULL;
-        afr_local_t         *local    = NULL;
-        afr_private_t       *priv     = NULL;
-        int                  up_count = 0;
+        afr_internal_lock_t *int_lock  = NULL;
+        afr_local_t         *local     = NULL;
+        afr_private_t       *priv      = NULL;
+        inode_t             *dir_inode = NULL;
+        int                  up_count  = 0;
+        int                  i         = 0;
 
         priv     = this->private;
         local    = frame->local;
@@ -1202,6 +1238,22 @@ afr_blocking_lock (call_frame_t *frame, xlator_t *this)
 
         case AFR_ENTRY_RENAME_TRANSACTION:
         case AFR_ENTRY_TRANSACTION:
+                /* a directory lock taken the blocking way is not shared,
+                   so do not hold on to it after the fop either. It gets
+                   an lk-owner of its own, an unlock of the eager lock
+                   (owned by the directory) must not release it. */
+                dir_inode = afr_entry_eager_lock_inode (local);
+                if (dir_inode) {
+                        local->delayed_post_op = _gf_false;
+                        afr_set_lk_owner (frame, this, frame->root);
+                        if (local->transaction.eager_lock) {
+                                for (i = 0; i < priv->child_count; i++)
+                                        local->transaction.eager_lock[i] = 0;
+                        }
+                        /* the eager lock it waits for may be parked */
+                        afr_delayed_entry_post_op_wake_up (this, dir_inode);
+                }
+
                 up_count = afr_up_children_count (local->child_up,
                                                   priv->child_count);
                 int_lock->lk_call_count = int_lock->lk_expected_count
@@ -1216,6 +1268,129 @@ afr_blocking_lock (call_frame_t *frame, xlator_t *this)
         return 0;
 }
 
+static void
+afr_dir_eager_lock_acquired (xlator_t *this, afr_local_t *local, int child)
+{
+        inode_t         *inode     = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+
+        inode = afr_entry_eager_lock_inode (local);
+        if (!inode)
+                return;
+
+        dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+        if (!dir_eager)
+                return;
+
+        LOCK (&inode->lock);
+        {
+                dir_eager->lock_acquired[child]++;
+        }
+        UNLOCK (&inode->lock);
+}
+
+int
+afr_nonblocking_entrylk (call_frame_t *frame, xlator_t *this);
+
+/* The eager entrylk wound by @frame is settled, one way or the other.
+ * Let the transactions which queued up behind it try again: they either
+ * take it over, or race for the directory lock themselves.
+ */
+static void
+afr_dir_eager_lock_done (call_frame_t *frame, xlator_t *this)
+{
+        afr_local_t          *local       = NULL;
+        afr_dir_eager_t      *dir_eager   = NULL;
+        inode_t              *inode       = NULL;
+        afr_fd_paused_call_t *paused_call = NULL;
+        afr_fd_paused_call_t *tmp         = NULL;
+        struct list_head      waiting;
+
+        local = frame->local;
+        local->transaction.eager_lock_pending = _gf_false;
+
+        INIT_LIST_HEAD (&waiting);
+
+        inode = local->transaction.parent_loc.inode;
+        dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+        if (!dir_eager)
+                return;
+
+        LOCK (&inode->lock);
+        {
+                dir_eager->lock_pending = _gf_false;
+                list_splice_init (&dir_eager->waiting, &waiting);
+        }
+        UNLOCK (&inode->lock);
+
+        list_for_each_entry_safe (paused_call, tmp, &waiting, call_list) {
+                list_del_init (&paused_call->call_list);
+                afr_nonblocking_entrylk (paused_call->frame, this);
+                GF_FREE (paused_call);
+        }
+}
+
+/* Returns 1 if @frame got queued behind an eager entrylk which is still
+ * on the wire, 0 if it can go ahead. In the latter case @piggyback has
+ * the children on which the directory is locked already.
+ */
+static int
+afr_dir_eager_lock_prepare (call_frame_t *frame, xlator_t *this,
+                            inode_t *inode, unsigned char *piggyback)
+{
+        afr_local_t          *local       = NULL;
+        afr_private_t        *priv        = NULL;
+        afr_dir_eager_t      *dir_eager   = NULL;
+        afr_fd_paused_call_t *paused_call = NULL;
+        int                   queued      = 0;
+        int                   i           = 0;
+
+        local = frame->local;
+        priv  = this->private;
+
+        dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+        if (!dir_eager)
+                goto out;
+
+        LOCK (&inode->lock);
+        {
+                if (dir_eager->lock_pending) {
+                        paused_call = GF_CALLOC (1, sizeof (*paused_call),
+                                                 gf_afr_fd_paused_call_t);
+                        if (paused_call) {
+                                INIT_LIST_HEAD (&paused_call->call_list);
+                                paused_call->frame = frame;
+                                list_add_tail (&paused_call->call_list,
+                                               &dir_eager->waiting);
+                                queued = 1;
+                                goto unlock;
+                        }
+                }
+
+                for (i = 0; i < priv->child_count; i++) {
+                        if (!local->child_up[i])
+                                continue;
+
+                        local->transaction.eager_lock[i] = 1;
+
+                        if (dir_eager->lock_acquired[i]) {
+                                dir_eager->lock_piggyback[i]++;
+                                piggyback[i] = 1;
+                        } else if (!dir_eager->lock_pending) {
+                                dir_eager->lock_pending = _gf_true;
+                                local->transaction.eager_lock_pending = _gf_true;
+                        }
+                }
+        }
+unlock:
+        UNLOCK (&inode->lock);
+
+        if (!queued)
+                afr_set_delayed_post_op (frame, this);
+out:
+        return queued;
+}
+
 static int32_t
 afr_nonblocking_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                              int32_t op_ret, int32_t op_errno, dict_t *xdata)
@@ -1257,11 +1432,19 @@ afr_nonblocking_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 				int_lock->lock_op_errno      = op_errno;
 				local->op_errno              = op_errno;
 			}
-		} else if (op_ret == 0) {
+			if (local->transaction.eager_lock)
+				local->transaction.eager_lock[index] = 0;
+		} else {
+			/* (op_ret == 1) => piggybacked on the eager lock
+			   of the directory */
 			int_lock->lockee[lockee_no].locked_nodes[index] |= \
 				LOCKED_YES;
 			int_lock->lockee[lockee_no].locked_count++;
 			int_lock->entrylk_lock_count++;
+
+			if (op_ret == 0 && local->transaction.eager_lock &&
+			    local->transaction.eager_lock[index])
+				afr_dir_eager_lock_acquired (this, local, index);
 		}
 
                 call_count = --int_lock->lk_call_count;
@@ -1271,6 +1454,9 @@ afr_nonblocking_entrylk_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (call_count == 0) {
                 gf_log (this->name, GF_LOG_TRACE,
                         "Last locking reply received");
+                if (local->transaction.eager_lock_pending)
+                        afr_dir_eager_lock_done (frame, this);
+
                 /* all locks successful. Proceed to call FOP */
                 if (int_lock->entrylk_lock_count ==
                                 int_lock->lk_expected_count) {
@@ -1314,6 +1500,8 @@ afr_nonblocking_entrylk (call_frame_t *frame, xlator_t *this)
         afr_local_t         *local      = NULL;
         afr_private_t       *priv       = NULL;
         afr_fd_ctx_t        *fd_ctx     = NULL;
+        inode_t             *dir_inode  = NULL;
+        unsigned char       *piggyback  = NULL;
         int                 copies      = 0;
         int                 index       = 0;
         int                 lockee_no   = 0;
@@ -1378,6 +1566,15 @@ afr_nonblocking_entrylk (call_frame_t *frame, xlator_t *this)
                         }
                 }
         } else {
+                dir_inode = afr_entry_eager_lock_inode (local);
+                if (dir_inode) {
+                        piggyback = alloca (priv->child_count);
+                        memset (piggyback, 0, priv->child_count);
+                        if (afr_dir_eager_lock_prepare (frame, this, dir_inode,
+                                                        piggyback))
+                                goto out;
+                }
+
                 call_count = int_lock->lockee_count * internal_lock_count (frame, this);
                 int_lock->lk_call_count = call_count;
                 int_lock->lk_expected_count = call_count;
@@ -1386,6 +1583,17 @@ afr_nonblocking_entrylk (call_frame_t *frame, xlator_t *this)
                         index = i%copies;
                         lockee_no = i/copies;
                         if (local->child_up[index]) {
+                                if (piggyback && piggyback[index]) {
+                                        /* (op_ret == 1) => indicate
+                                           piggybacked lock */
+                                        afr_nonblocking_entrylk_cbk (frame,
+                                                                     (void *) (long) i,
+                                                                     this, 1, 0, NULL);
+                                        if (!--call_count)
+                                                break;
+                                        continue;
+                                }
+
                                 AFR_TRACE_ENTRYLK_IN (frame, this, AFR_ENTRYLK_NB_TRANSACTION,
                                                       AFR_LOCK_OP,
                                                       int_lock->lockee[lockee_no].basename,
@@ -42,6 +42,9 @@ enum gf_afr_mem_types_ {
         gf_afr_mt_time_t,
         gf_afr_mt_pos_data_t,
 	gf_afr_mt_reply_t,
+        gf_afr_mt_dir_eager_t,
+        gf_afr_mt_read_chunk_t,
+        gf_afr_mt_read_latency_t,
         gf_afr_mt_end
 };
 #endif
@@ -176,6 +176,78 @@ out:
 }
 
 
+/* The directory whose eager entrylk the transaction in @local takes part
+ * in, or NULL if it locks its name the regular way.
+ */
+inode_t *
+afr_entry_eager_lock_inode (afr_local_t *local)
+{
+        if (local->internal_lock.transaction_lk_type != AFR_TRANSACTION_LK)
+                return NULL;
+
+        if (local->transaction.type != AFR_ENTRY_TRANSACTION)
+                return NULL;
+
+        if (!local->transaction.eager_lock_on || local->fd)
+                return NULL;
+
+        return local->transaction.parent_loc.inode;
+}
+
+
+static void
+__mark_pre_op_done_on_dir (call_frame_t *frame, xlator_t *this,
+                           int child_index)
+{
+        afr_local_t     *local     = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+        inode_t         *inode     = NULL;
+
+        local = frame->local;
+
+        inode = afr_entry_eager_lock_inode (local);
+        if (!inode)
+                return;
+
+        dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+        if (!dir_eager)
+                return;
+
+        LOCK (&inode->lock);
+        {
+                dir_eager->pre_op_done[child_index]++;
+        }
+        UNLOCK (&inode->lock);
+}
+
+
+static void
+__mark_pre_op_undone_on_dir (call_frame_t *frame, xlator_t *this,
+                             int child_index)
+{
+        afr_local_t     *local     = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+        inode_t         *inode     = NULL;
+
+        local = frame->local;
+
+        inode = afr_entry_eager_lock_inode (local);
+        if (!inode)
+                return;
+
+        dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+        if (!dir_eager)
+                return;
+
+        LOCK (&inode->lock);
+        {
+                GF_ASSERT (dir_eager->pre_op_done[child_index]);
+                dir_eager->pre_op_done[child_index]--;
+        }
+        UNLOCK (&inode->lock);
+}
+
+
 static void
 __mark_non_participant_children (int32_t *pending[], int child_count,
                                  unsigned char *participants,
@@ -250,6 +322,9 @@ afr_transaction_perform_fop (call_frame_t *frame, xlator_t *this)
         */
         if (fd)
                 afr_delayed_changelog_wake_up (this, fd);
+        else if (afr_entry_eager_lock_inode (local))
+                afr_delayed_entry_post_op_wake_up (this,
+                                                   local->transaction.parent_loc.inode);
         local->transaction.fop (frame, this);
 }
 
@@ -584,6 +659,8 @@ afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
 
         afr_local_t *  local = NULL;
         afr_fd_ctx_t  *fdctx = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+        inode_t       *dir_inode = NULL;
         dict_t        **xattr = NULL;
         int            piggyback = 0;
         int            index = 0;
@@ -615,6 +692,10 @@ afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
         if (local->fd)
                 fdctx = afr_fd_ctx_get (local->fd, this);
 
+        dir_inode = afr_entry_eager_lock_inode (local);
+        if (dir_inode)
+                dir_eager = afr_dir_eager_get (dir_inode, this, _gf_false);
+
         if (call_count == 0) {
                 /* no child is up */
                 int_lock->lock_cbk = local->transaction.done;
@@ -753,6 +834,32 @@ afr_changelog_post_op_now (call_frame_t *frame, xlator_t *this)
                                 break;
                         }
 
+                        if (dir_eager) {
+                                LOCK (&dir_inode->lock);
+                                {
+                                        piggyback = 0;
+                                        if (dir_eager->pre_op_piggyback[i]) {
+                                                dir_eager->pre_op_piggyback[i]--;
+                                                piggyback = 1;
+                                        }
+                                }
+                                UNLOCK (&dir_inode->lock);
+
+                                afr_set_postop_dict (local, this, xattr[i],
+                                                     piggyback, i);
+
+                                if (nothing_failed && piggyback) {
+                                        afr_changelog_post_op_cbk (frame, (void *)(long)i,
+                                                                   this, 1, 0, xattr[i],
+                                                                   NULL);
+                                        break;
+                                }
+
+                                if (!piggyback)
+                                        __mark_pre_op_undone_on_dir (frame, this,
+                                                                     i);
+                        }
+
                         if (local->fd)
                                 STACK_WIND (frame, afr_changelog_post_op_cbk,
                                             priv->children[i],
@@ -801,6 +908,7 @@ afr_changelog_pre_op_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 switch (op_ret) {
                 case 0:
                         __mark_pre_op_done_on_fd (frame, this, child_index);
+                        __mark_pre_op_done_on_dir (frame, this, child_index);
                         //fallthrough we need to mark the pre_op
                 case 1:
                         local->transaction.pre_op[child_index] = 1;
@@ -848,6 +956,8 @@ afr_changelog_pre_op (call_frame_t *frame, xlator_t *this)
         int call_count = 0;
         dict_t **xattr = NULL;
         afr_fd_ctx_t *fdctx = NULL;
+        afr_dir_eager_t *dir_eager = NULL;
+        inode_t     *dir_inode = NULL;
         afr_local_t *local = NULL;
         int          piggyback = 0;
         afr_internal_lock_t *int_lock = NULL;
@@ -881,6 +991,10 @@ afr_changelog_pre_op (call_frame_t *frame, xlator_t *this)
         if (local->fd)
                 fdctx = afr_fd_ctx_get (local->fd, this);
 
+        dir_inode = afr_entry_eager_lock_inode (local);
+        if (dir_inode)
+                dir_eager = afr_dir_eager_get (dir_inode, this, _gf_false);
+
         locked_nodes = afr_locked_nodes_get (local->transaction.type, int_lock);
         for (i = 0; i < priv->child_count; i++) {
                 if (!locked_nodes[i])
@@ -1015,6 +1129,28 @@ afr_changelog_pre_op (call_frame_t *frame, xlator_t *this)
                                 break;
                         }
 
+                        if (dir_eager) {
+                                LOCK (&dir_inode->lock);
+                                {
+                                        piggyback = 0;
+                                        if (dir_eager->pre_op_done[i]) {
+                                                dir_eager->pre_op_piggyback[i]++;
+                                                piggyback = 1;
+                                                dir_eager->hit++;
+                                        } else {
+                                                dir_eager->miss++;
+                                        }
+                                }
+                                UNLOCK (&dir_inode->lock);
+
+                                if (piggyback) {
+                                        afr_changelog_pre_op_cbk (frame, (void *)(long)i,
+                                                                  this, 1, 0, xattr[i],
+                                                                  NULL);
+                                        break;
+                                }
+                        }
+
                         if (local->fd)
                                 STACK_WIND_COOKIE (frame,
                                                    afr_changelog_pre_op_cbk,
@@ -1298,8 +1434,14 @@ afr_set_delayed_post_op (call_frame_t *frame, xlator_t *this)
 	if (!local)
 		return;
 
-	if (!local->fd)
+	if (!local->fd) {
+                /* every entry fop in an eager-locked directory qualifies,
+                   the next one will likely be on a name in the same
+                   directory */
+		if (afr_entry_eager_lock_inode (local))
+			local->delayed_post_op = _gf_true;
 		return;
+	}
 
 	if (local->op == GF_FOP_WRITE)
 		local->delayed_post_op = _gf_true;
@@ -1379,6 +1521,71 @@ unlock:
 }
 
 
+void
+afr_delayed_entry_post_op (xlator_t *this, call_frame_t *frame,
+                           inode_t *inode);
+
+void
+afr_delayed_entry_post_op_wake_up_cbk (void *data)
+{
+	inode_t        *inode = NULL;
+
+	inode = data;
+
+	afr_delayed_entry_post_op_wake_up (THIS, inode);
+}
+
+
+/* Same as afr_delayed_changelog_post_op(), but the frame is parked on the
+ * parent directory of an entry transaction. The parked frame keeps the
+ * directory referenced through its parent_loc, and with it the eager
+ * entrylk which the next entry transaction in the directory takes over.
+ */
+void
+afr_delayed_entry_post_op (xlator_t *this, call_frame_t *frame,
+                           inode_t *inode)
+{
+	afr_dir_eager_t   *dir_eager = NULL;
+	call_frame_t      *prev_frame = NULL;
+	struct timeval     delta = {0, };
+	afr_private_t     *priv = NULL;
+
+	priv = this->private;
+
+	dir_eager = afr_dir_eager_get (inode, this, _gf_false);
+	if (!dir_eager) {
+		if (frame)
+			afr_changelog_post_op_now (frame, this);
+		return;
+	}
+
+	delta.tv_sec = priv->post_op_delay_secs;
+	delta.tv_usec = 0;
+
+	pthread_mutex_lock (&dir_eager->delay_lock);
+	{
+		prev_frame = dir_eager->delay_frame;
+		dir_eager->delay_frame = NULL;
+		if (dir_eager->delay_timer)
+			gf_timer_call_cancel (this->ctx, dir_eager->delay_timer);
+		dir_eager->delay_timer = NULL;
+		if (!frame)
+			goto unlock;
+		dir_eager->delay_timer =
+			gf_timer_call_after (this->ctx, delta,
+					     afr_delayed_entry_post_op_wake_up_cbk,
+					     inode);
+		dir_eager->delay_frame = frame;
+	}
+unlock:
+	pthread_mutex_unlock (&dir_eager->delay_lock);
+
+	if (prev_frame) {
+		afr_changelog_post_op_now (prev_frame, this);
+	}
+}
+
+
 void
 afr_changelog_post_op (call_frame_t *frame, xlator_t *this)
 {
@@ -1386,10 +1593,13 @@ afr_changelog_post_op (call_frame_t *frame, xlator_t *this)
 
 	local = frame->local;
 
-	if (is_afr_delayed_changelog_post_op_needed (frame, this))
+	if (!is_afr_delayed_changelog_post_op_needed (frame, this))
+		afr_changelog_post_op_now (frame, this);
+	else if (local->fd)
 		afr_delayed_changelog_post_op (this, frame, local->fd);
 	else
-		afr_changelog_post_op_now (frame, this);
+		afr_delayed_entry_post_op (this, frame,
+					   local->transaction.parent_loc.inode);
 }
 
 
@@ -1400,6 +1610,16 @@ afr_delayed_changelog_wake_up (xlator_t *this, fd_t *fd)
 }
 
 
+void
+afr_delayed_entry_post_op_wake_up (xlator_t *this, inode_t *inode)
+{
+	if (!inode)
+		return;
+
+	afr_delayed_entry_post_op (this, NULL, inode);
+}
+
+
 int
 afr_transaction_resume (call_frame_t *frame, xlator_t *this)
 {
@@ -1458,6 +1678,71 @@ _does_transaction_conflict_with_delayed_post_op (call_frame_t *frame)
         return _gf_false;
 }
 
+/* Decide whether the entry transaction in @frame eager-locks its parent
+ * directory. If so, the lockee is widened from the name to the whole
+ * directory, so that later transactions on other names can take it over.
+ */
+static gf_boolean_t
+afr_entry_eager_lock_setup (call_frame_t *frame, xlator_t *this)
+{
+        afr_local_t         *local    = NULL;
+        afr_private_t       *priv     = NULL;
+        afr_internal_lock_t *int_lock = NULL;
+        inode_t             *inode    = NULL;
+
+        local    = frame->local;
+        priv     = this->private;
+        int_lock = &local->internal_lock;
+        inode    = local->transaction.parent_loc.inode;
+
+        local->transaction.eager_lock_on = _gf_false;
+
+        if (!priv->entry_eager_lock)
+                goto out;
+
+        if (local->fd || !inode || int_lock->lockee_count != 1)
+                goto out;
+
+        if (!afr_dir_eager_get (inode, this, _gf_true))
+                goto out;
+
+        GF_FREE (int_lock->lockee[0].basename);
+        int_lock->lockee[0].basename = NULL;
+
+        local->transaction.eager_lock_on = _gf_true;
+out:
+        return local->transaction.eager_lock_on;
+}
+
+/* Entry transactions which do not share the eager lock would block on it,
+ * release the directories they operate on right away instead of letting
+ * them wait for the delayed post-op timer.
+ */
+static void
+afr_entry_transaction_wake_up (call_frame_t *frame, xlator_t *this)
+{
+        afr_local_t     *local = NULL;
+
+        local = frame->local;
+
+        switch (local->transaction.type) {
+        case AFR_ENTRY_RENAME_TRANSACTION:
+                afr_delayed_entry_post_op_wake_up (this,
+                                                   local->transaction.new_parent_loc.inode);
+                /* fall through */
+        case AFR_ENTRY_TRANSACTION:
+                if (!afr_entry_eager_lock_inode (local))
+                        afr_delayed_entry_post_op_wake_up (this,
+                                                           local->transaction.parent_loc.inode);
+                if (local->op == GF_FOP_RMDIR)
+                        afr_delayed_entry_post_op_wake_up (this,
+                                                           local->loc.inode);
+                break;
+        default:
+                break;
+        }
+}
+
 int
 afr_transaction (call_frame_t *frame, xlator_t *this, afr_transaction_type type)
 {
@@ -1480,9 +1765,15 @@ afr_transaction (call_frame_t *frame, xlator_t *this, afr_transaction_type type)
         if (local->fd && local->transaction.eager_lock_on &&
             local->transaction.type == AFR_DATA_TRANSACTION)
                 afr_set_lk_owner (frame, this, local->fd);
+        else if (local->transaction.type == AFR_ENTRY_TRANSACTION &&
+                 afr_entry_eager_lock_setup (frame, this))
+                afr_set_lk_owner (frame, this,
+                                  local->transaction.parent_loc.inode);
         else
                 afr_set_lk_owner (frame, this, frame->root);
 
+        afr_entry_transaction_wake_up (frame, this);
+
         if (_does_transaction_conflict_with_delayed_post_op (frame) &&
             local->loc.inode) {
                 fd = fd_lookup (local->loc.inode, frame->root->pid);
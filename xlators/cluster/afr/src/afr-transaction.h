@@ -37,4 +37,10 @@ afr_set_delayed_post_op (call_frame_t *frame, xlator_t *this);
 void
 afr_delayed_changelog_wake_up (xlator_t *this, fd_t *fd);
 
+void
+afr_delayed_entry_post_op_wake_up (xlator_t *this, inode_t *inode);
+
+inode_t *
+afr_entry_eager_lock_inode (afr_local_t *local);
+
 #endif /* __TRANSACTION_H__ */
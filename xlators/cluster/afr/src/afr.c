@@ -176,6 +176,8 @@ reconfigure (xlator_t *this, dict_t *options)
         }
 
         GF_OPTION_RECONF ("eager-lock", priv->eager_lock, options, bool, out);
+        GF_OPTION_RECONF ("entry-eager-lock", priv->entry_eager_lock, options,
+                          bool, out);
         GF_OPTION_RECONF ("quorum-type", qtype, options, str, out);
         GF_OPTION_RECONF ("quorum-count", priv->quorum_count, options,
                           uint32, out);
@@ -191,6 +193,8 @@ reconfigure (xlator_t *this, dict_t *options)
         /* Reset this so we re-discover in case the topology changed.  */
         GF_OPTION_RECONF ("readdir-failover", priv->readdir_failover, options,
                           bool, out);
+        GF_OPTION_RECONF ("read-split-size", priv->read_split_size, options,
+                          size, out);
         priv->did_discovery = _gf_false;
 
         ret = 0;
@@ -327,6 +331,7 @@ init (xlator_t *this)
         GF_OPTION_INIT ("strict-readdir", priv->strict_readdir, bool, out);
 
         GF_OPTION_INIT ("eager-lock", priv->eager_lock, bool, out);
+        GF_OPTION_INIT ("entry-eager-lock", priv->entry_eager_lock, bool, out);
         GF_OPTION_INIT ("quorum-type", qtype, str, out);
         GF_OPTION_INIT ("quorum-count", priv->quorum_count, uint32, out);
         GF_OPTION_INIT (AFR_SH_READDIR_SIZE_KEY, priv->sh_readdir_size, size,
@@ -335,6 +340,7 @@ init (xlator_t *this)
 
 	GF_OPTION_INIT ("post-op-delay-secs", priv->post_op_delay_secs, uint32, out);
         GF_OPTION_INIT ("readdir-failover", priv->readdir_failover, bool, out);
+        GF_OPTION_INIT ("read-split-size", priv->read_split_size, size, out);
 
         priv->wait_count = 1;
 
@@ -393,6 +399,14 @@ init (xlator_t *this)
                 goto out;
         }
 
+        priv->read_latency = GF_CALLOC (child_count,
+                                        sizeof (*priv->read_latency),
+                                        gf_afr_mt_read_latency_t);
+        if (!priv->read_latency) {
+                ret = -ENOMEM;
+                goto out;
+        }
+
         /* keep more local here as we may need them for self-heal etc */
         this->local_pool = mem_pool_new (afr_local_t, 512);
         if (!this->local_pool) {
@@ -697,6 +711,23 @@ struct volume_options options[] = {
                          "the last \"optimzed\" transaction."
 
         },
+        { .key = {"entry-eager-lock"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Extend eager locking to entry transactions "
+                         "(create, mkdir, unlink, ...). The first such "
+                         "transaction in a directory locks the whole "
+                         "directory instead of just the name it works on. "
+                         "Entry transactions in the same directory which "
+                         "arrive before it unlocks \"take over\" that lock "
+                         "and its changelog pre-op, and the post-op of the "
+                         "last one is delayed by post-op-delay-secs so that "
+                         "a stream of namespace operations on a hot "
+                         "directory pays for the lock only once. Other "
+                         "clients operating on the same directory wait for "
+                         "the lock to be released, so leave this off for "
+                         "directories shared by many clients."
+        },
         { .key = {"self-heal-daemon"},
           .type = GF_OPTION_TYPE_BOOL,
           .default_value = "off",
@@ -765,5 +796,17 @@ struct volume_options options[] = {
           .description = "readdir(p) will not failover if this option is off",
           .default_value = "on",
         },
+        { .key = {"read-split-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min = 0,
+          .max = 134217728,
+          .default_value = "0",
+          .description = "readv requests of at least this size are split "
+                         "into chunks which are read in parallel from all "
+                         "the subvolumes that are in sync, instead of from "
+                         "the read-subvolume alone. Chunks are sized by the "
+                         "observed read latency of each subvolume, so slow "
+                         "bricks get a smaller share. 0 disables splitting."
+        },
         { .key  = {NULL} },
 };
@@ -81,11 +81,53 @@ typedef enum afr_spb_state {
         NO_SPB
 } afr_spb_state_t;
 
+/* Eager-lock state of a directory, shared by the entry transactions
+ * (create, mkdir, unlink ...) on names inside it. The counters play the
+ * same role as their namesakes in afr_fd_ctx_t, with the difference that
+ * they are protected by the inode lock of the directory.
+ */
+typedef struct afr_dir_eager_ {
+        unsigned int     *pre_op_done;
+        unsigned int     *pre_op_piggyback;
+
+        unsigned int     *lock_piggyback;
+        unsigned int     *lock_acquired;
+
+        int               hit, miss;
+
+        /* an eager entrylk is being wound; later transactions wait on
+           @waiting instead of racing it for the same directory lock */
+        gf_boolean_t      lock_pending;
+        struct list_head  waiting;
+
+        /* used for delayed-post-op optimization */
+        pthread_mutex_t   delay_lock;
+        gf_timer_t       *delay_timer;
+        call_frame_t     *delay_frame;
+} afr_dir_eager_t;
+
+/* a piece of a readv which is served by one subvolume, see
+   afr_readv_split () */
+typedef struct {
+        int             child;
+        off_t           offset;
+        size_t          size;
+        struct timeval  start;
+
+        int32_t         op_ret;
+        int32_t         op_errno;
+        struct iovec   *vector;
+        int32_t         count;
+        struct iobref  *iobref;
+        struct iatt     buf;
+} afr_read_chunk_t;
+
 typedef struct afr_inode_ctx_ {
         uint64_t masks;
         int32_t  *fresh_children;//increasing order of latency
         afr_spb_state_t mdata_spb;
         afr_spb_state_t data_spb;
+        afr_dir_eager_t *dir_eager;
 } afr_inode_ctx_t;
 
 typedef enum {
@@ -160,6 +202,7 @@ typedef struct _afr_private {
         struct list_head saved_fds;   /* list of fds on which locks have succeeded */
         gf_boolean_t      optimistic_change_log;
         gf_boolean_t      eager_lock;
+        gf_boolean_t      entry_eager_lock;
 	uint32_t          post_op_delay_secs;
         unsigned int      quorum_count;
 
@@ -170,6 +213,13 @@ typedef struct _afr_private {
         gf_boolean_t           did_discovery;
         gf_boolean_t           readdir_failover;
         uint64_t               sh_readdir_size;
+
+        /* readv requests of at least this size are split across all
+           the in-sync subvolumes (0 = off) */
+        uint64_t               read_split_size;
+        /* per child moving average of the readv service time, in usec
+           per MB read. Guarded by read_child_lock */
+        uint64_t              *read_latency;
 } afr_private_t;
 
 typedef struct {
@@ -524,6 +574,9 @@ typedef struct _afr_local {
                         off_t offset;
                         int last_index;
                         uint32_t flags;
+                        int call_child;
+                        afr_read_chunk_t *chunks;
+                        int chunk_count;
                 } readv;
 
                 /* dir read */
@@ -657,6 +710,8 @@ typedef struct _afr_local {
 
                 gf_boolean_t    eager_lock_on;
                 int *eager_lock;
+                /* this transaction is winding the eager entrylk */
+                gf_boolean_t    eager_lock_pending;
 
                 char *basename;
                 char *new_basename;
@@ -850,6 +905,9 @@ afr_update_loc_gfids (loc_t *loc, struct iatt *buf, struct iatt *postparent);
 int
 afr_locked_nodes_count (unsigned char *locked_nodes, int child_count);
 
+void
+afr_read_chunks_cleanup (afr_read_chunk_t *chunks, int count);
+
 void
 afr_local_cleanup (afr_local_t *local, xlator_t *this);
 
@@ -1035,6 +1093,12 @@ afr_set_elem_count_get (unsigned char *elems, int child_count);
 afr_fd_ctx_t *
 afr_fd_ctx_get (fd_t *fd, xlator_t *this);
 
+afr_inode_ctx_t *
+afr_inode_ctx_get (inode_t *inode, xlator_t *this);
+
+afr_dir_eager_t *
+afr_dir_eager_get (inode_t *inode, xlator_t *this, gf_boolean_t create);
+
 gf_boolean_t
 afr_open_only_data_self_heal (char *data_self_heal);
 
@@ -339,6 +339,13 @@ dht_discover (call_frame_t *frame, xlator_t *this, loc_t *loc)
                         "%s: failed to set 'trusted.glusterfs.dht' key",
                         loc->path);
 
+        ret = dict_set_uint32 (local->xattr_req, DHT_COMMITHASH_KEY,
+                               sizeof (uint32_t));
+        if (ret)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "%s: failed to set '%s' key", loc->path,
+                        DHT_COMMITHASH_KEY);
+
         ret = dict_set_uint32 (local->xattr_req,
                                "trusted.glusterfs.dht.linkto", 256);
         if (ret)
@@ -799,6 +806,10 @@ dht_lookup_everywhere_done (call_frame_t *frame, xlator_t *this)
         }
 
         if (!cached_subvol) {
+                if (local->loc.parent)
+                        dht_neg_cache_add (this, local->loc.parent,
+                                           local->loc.name);
+
                 DHT_STACK_UNWIND (lookup, frame, -1, ENOENT, NULL, NULL, NULL,
                                   NULL);
                 return 0;
@@ -1252,6 +1263,19 @@ dht_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (ENTRY_MISSING (op_ret, op_errno)) {
                 gf_log (this->name, GF_LOG_TRACE, "Entry %s missing on subvol"
                         " %s", loc->path, prev->this->name);
+                if (conf->lookup_optimize && loc->parent) {
+                        ret = dht_inode_ctx_layout_get (loc->parent, this,
+                                                        &parent_layout);
+                        if (!ret && dht_layout_is_committed (this,
+                                                             parent_layout)) {
+                                gf_log (this->name, GF_LOG_TRACE,
+                                        "layout of parent of %s is committed,"
+                                        " not looking it up everywhere",
+                                        loc->path);
+                                goto out;
+                        }
+                        parent_layout = NULL;
+                }
                 if (conf->search_unhashed == GF_DHT_LOOKUP_UNHASHED_ON) {
                         local->op_errno = ENOENT;
                         dht_lookup_everywhere (frame, this, loc);
@@ -1336,6 +1360,9 @@ out:
                                            postparent, 1);
         }
 
+        if (ENTRY_MISSING (op_ret, op_errno) && local && local->loc.parent)
+                dht_neg_cache_add (this, local->loc.parent, local->loc.name);
+
         DHT_STRIP_PHASE1_FLAGS (stbuf);
         DHT_STACK_UNWIND (lookup, frame, op_ret, op_errno, inode, stbuf, xattr,
                           postparent);
@@ -1508,6 +1535,9 @@ dht_lookup (call_frame_t *frame, xlator_t *this,
                 ret = dict_set_uint32 (local->xattr_req,
                                        "trusted.glusterfs.dht", 4 * 4);
 
+                ret = dict_set_uint32 (local->xattr_req,
+                                       DHT_COMMITHASH_KEY, sizeof (uint32_t));
+
                 ret = dict_set_uint32 (local->xattr_req,
                                        DHT_LINKFILE_KEY, 256);
 
@@ -1543,6 +1573,13 @@ dht_lookup (call_frame_t *frame, xlator_t *this,
                         return 0;
                 }
 
+                if (loc->parent &&
+                    dht_neg_cache_check (this, loc->parent, loc->name)) {
+                        DHT_STACK_UNWIND (lookup, frame, -1, ENOENT, NULL,
+                                          NULL, NULL, NULL);
+                        return 0;
+                }
+
                 STACK_WIND (frame, dht_lookup_cbk,
                             hashed_subvol, hashed_subvol->fops->lookup,
                             loc, local->xattr_req);
@@ -2020,6 +2057,9 @@ dht_getxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (dict_get (xattr, "trusted.glusterfs.dht")) {
                 dict_del (xattr, "trusted.glusterfs.dht");
         }
+        if (dict_get (xattr, DHT_COMMITHASH_KEY)) {
+                dict_del (xattr, DHT_COMMITHASH_KEY);
+        }
         local->op_ret = 0;
 
         if (!local->xattr) {
@@ -2961,15 +3001,394 @@ err:
 }
 
 
+static dht_dir_fd_ctx_t *
+dht_dir_fd_ctx_get (xlator_t *this, fd_t *fd, gf_boolean_t create)
+{
+        dht_conf_t       *conf  = NULL;
+        dht_dir_fd_ctx_t *ctx   = NULL;
+        uint64_t          value = 0;
+        int               ret   = -1;
+        int               i     = 0;
+
+        conf = this->private;
+
+        LOCK (&fd->lock);
+        {
+                ret = __fd_ctx_get (fd, this, &value);
+                if (!ret) {
+                        ctx = (dht_dir_fd_ctx_t *)(long) value;
+                        goto unlock;
+                }
+
+                if (!create)
+                        goto unlock;
+
+                ctx = GF_CALLOC (1, sizeof (*ctx) + conf->subvolume_cnt *
+                                 sizeof (dht_readdir_buf_t),
+                                 gf_dht_mt_dir_fd_ctx_t);
+                if (!ctx)
+                        goto unlock;
+
+                LOCK_INIT (&ctx->lock);
+                ctx->cnt = conf->subvolume_cnt;
+                for (i = 0; i < ctx->cnt; i++)
+                        INIT_LIST_HEAD (&ctx->bufs[i].entries.list);
+
+                ret = __fd_ctx_set (fd, this, (uint64_t)(long) ctx);
+                if (ret) {
+                        LOCK_DESTROY (&ctx->lock);
+                        GF_FREE (ctx);
+                        ctx = NULL;
+                }
+        }
+unlock:
+        UNLOCK (&fd->lock);
+
+        return ctx;
+}
+
+
+static void
+__dht_readdir_buf_take (dht_readdir_buf_t *buf, gf_dirent_t *entries,
+                        int *op_ret, int *op_errno)
+{
+        list_splice_init (&buf->entries.list, &entries->list);
+        *op_ret = buf->op_ret;
+        *op_errno = buf->op_errno;
+        buf->ready = _gf_false;
+}
+
+
+/* Store the reply of a read ahead. If a readdirp is parked on it, the chunk
+   is handed over in @entries and the parked frame returned */
+static call_frame_t *
+dht_readdir_buf_fill (dht_dir_fd_ctx_t *ctx, int idx, int op_ret,
+                      int op_errno, gf_dirent_t *orig_entries,
+                      gf_dirent_t *entries)
+{
+        dht_readdir_buf_t *buf    = NULL;
+        call_frame_t      *waiter = NULL;
+
+        buf = &ctx->bufs[idx];
+
+        LOCK (&ctx->lock);
+        {
+                buf->inflight = _gf_false;
+                buf->ready = _gf_true;
+                buf->op_ret = op_ret;
+                buf->op_errno = op_errno;
+                if ((op_ret > 0) && orig_entries)
+                        list_splice_init (&orig_entries->list,
+                                          &buf->entries.list);
+
+                waiter = buf->waiter;
+                buf->waiter = NULL;
+                if (waiter)
+                        __dht_readdir_buf_take (buf, entries, &op_ret,
+                                                &op_errno);
+        }
+        UNLOCK (&ctx->lock);
+
+        return waiter;
+}
+
+
+static dict_t *
+dht_readdirp_prefetch_xattr (xlator_t *this, dict_t *xattr, xlator_t *subvol)
+{
+        dht_conf_t *conf = NULL;
+        dict_t     *dict = NULL;
+
+        conf = this->private;
+
+        if (!xattr)
+                return NULL;
+
+        if (conf->readdir_optimize != _gf_true)
+                return dict_ref (xattr);
+
+        /* the request dict carries the skip flag of the subvolume being
+           read, every read ahead needs its own */
+        dict = dict_copy_with_ref (xattr, NULL);
+        if (!dict)
+                return NULL;
+
+        if (subvol == dht_first_up_subvol (this)) {
+                dict_del (dict, GF_READDIR_SKIP_DIRS);
+        } else if (dict_set_int32 (dict, GF_READDIR_SKIP_DIRS, 1)) {
+                gf_log (this->name, GF_LOG_ERROR, "dict set failed");
+        }
+
+        return dict;
+}
+
+
+int
+dht_readdirp_process (call_frame_t *frame, xlator_t *this, xlator_t *prev,
+                      int op_ret, int op_errno, gf_dirent_t *orig_entries);
+
 int
 dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
-                  int op_errno, gf_dirent_t *orig_entries, dict_t *xdata)
+                  int op_errno, gf_dirent_t *orig_entries, dict_t *xdata);
+
+static void
+dht_readdirp_prefetch (call_frame_t *frame, xlator_t *this,
+                       dht_dir_fd_ctx_t *ctx, int idx, off_t offset);
+
+
+/* Hand a chunk of subvolume @idx to @frame, reading the next chunk of the
+   same subvolume while this one is being consumed */
+static void
+dht_readdirp_serve (call_frame_t *frame, xlator_t *this,
+                    dht_dir_fd_ctx_t *ctx, int idx, int op_ret, int op_errno,
+                    gf_dirent_t *entries)
+{
+        dht_conf_t        *conf   = NULL;
+        dht_readdir_buf_t *buf    = NULL;
+        gf_dirent_t       *last   = NULL;
+        off_t              offset = 0;
+        int                fetch  = 0;
+
+        conf = this->private;
+        buf = &ctx->bufs[idx];
+
+        if ((op_ret > 0) && !list_empty (&entries->list)) {
+                last = list_entry (entries->list.prev, gf_dirent_t, list);
+                offset = last->d_off;
+
+                LOCK (&ctx->lock);
+                {
+                        if (!buf->inflight && !buf->ready) {
+                                buf->inflight = _gf_true;
+                                buf->offset = offset;
+                                fetch = 1;
+                        }
+                }
+                UNLOCK (&ctx->lock);
+
+                if (fetch)
+                        dht_readdirp_prefetch (frame, this, ctx, idx, offset);
+        }
+
+        dht_readdirp_process (frame, this, conf->subvolumes[idx], op_ret,
+                              op_errno, entries);
+}
+
+
+int
+dht_readdirp_prefetch_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                           int op_ret, int op_errno, gf_dirent_t *orig_entries,
+                           dict_t *xdata)
+{
+        dht_local_t      *local  = NULL;
+        dht_dir_fd_ctx_t *ctx    = NULL;
+        call_frame_t     *waiter = NULL;
+        gf_dirent_t       entries;
+        int               idx    = 0;
+
+        INIT_LIST_HEAD (&entries.list);
+        local = frame->local;
+        idx = (long) cookie;
+
+        ctx = dht_dir_fd_ctx_get (this, local->fd, _gf_false);
+        if (!ctx)
+                goto out;
+
+        waiter = dht_readdir_buf_fill (ctx, idx, op_ret, op_errno,
+                                       orig_entries, &entries);
+        if (waiter) {
+                dht_readdirp_serve (waiter, this, ctx, idx, op_ret, op_errno,
+                                    &entries);
+                gf_dirent_free (&entries);
+        }
+out:
+        DHT_STACK_DESTROY (frame);
+
+        return 0;
+}
+
+
+/* The caller has marked bufs[@idx] in flight for @offset */
+static void
+dht_readdirp_prefetch (call_frame_t *frame, xlator_t *this,
+                       dht_dir_fd_ctx_t *ctx, int idx, off_t offset)
+{
+        dht_conf_t   *conf   = NULL;
+        dht_local_t  *local  = NULL;
+        dht_local_t  *plocal = NULL;
+        call_frame_t *pframe = NULL;
+        call_frame_t *waiter = NULL;
+        xlator_t     *subvol = NULL;
+        gf_dirent_t   entries;
+
+        conf = this->private;
+        local = frame->local;
+        subvol = conf->subvolumes[idx];
+
+        pframe = copy_frame (frame);
+        if (!pframe)
+                goto err;
+
+        plocal = dht_local_init (pframe, NULL, local->fd, GF_FOP_READDIRP);
+        if (!plocal)
+                goto err;
+
+        plocal->size = local->size;
+        plocal->xattr = dht_readdirp_prefetch_xattr (this, local->xattr,
+                                                     subvol);
+
+        STACK_WIND_COOKIE (pframe, dht_readdirp_prefetch_cbk,
+                           (void *)(long) idx, subvol,
+                           subvol->fops->readdirp, plocal->fd, plocal->size,
+                           offset, plocal->xattr);
+        return;
+
+err:
+        gf_log (this->name, GF_LOG_WARNING,
+                "failed to read ahead directory entries from %s",
+                subvol->name);
+
+        if (pframe)
+                DHT_STACK_DESTROY (pframe);
+
+        INIT_LIST_HEAD (&entries.list);
+        waiter = dht_readdir_buf_fill (ctx, idx, -1, ENOMEM, NULL, &entries);
+        if (waiter)
+                dht_readdirp_serve (waiter, this, ctx, idx, -1, ENOMEM,
+                                    &entries);
+}
+
+
+/* Start reading the subvolumes after @xvol from their beginning, so that
+   they are ready by the time the listing gets to them */
+static void
+dht_readdirp_fan_out (call_frame_t *frame, xlator_t *this,
+                      dht_dir_fd_ctx_t *ctx, xlator_t *xvol)
+{
+        dht_readdir_buf_t *buf      = NULL;
+        gf_dirent_t        stale;
+        int                op_ret   = 0;
+        int                op_errno = 0;
+        int                fetch    = 0;
+        int                i        = 0;
+
+        for (i = dht_subvol_cnt (this, xvol) + 1; i < ctx->cnt; i++) {
+                buf = &ctx->bufs[i];
+                fetch = 0;
+                INIT_LIST_HEAD (&stale.list);
+
+                LOCK (&ctx->lock);
+                {
+                        if (!buf->inflight &&
+                            !(buf->ready && (buf->offset == 0))) {
+                                if (buf->ready)
+                                        __dht_readdir_buf_take (buf, &stale,
+                                                                &op_ret,
+                                                                &op_errno);
+                                buf->inflight = _gf_true;
+                                buf->offset = 0;
+                                fetch = 1;
+                        }
+                }
+                UNLOCK (&ctx->lock);
+
+                gf_dirent_free (&stale);
+
+                if (fetch)
+                        dht_readdirp_prefetch (frame, this, ctx, i, 0);
+        }
+}
+
+
+/* Read @offset of @subvol, from the read ahead buffer when readdir-parallel
+   is on. A readdirp that finds its chunk still in flight is parked and
+   resumed from dht_readdirp_prefetch_cbk */
+static int
+dht_readdirp_wind (call_frame_t *frame, xlator_t *this, xlator_t *subvol,
+                   off_t offset)
+{
+        dht_local_t       *local    = NULL;
+        dht_conf_t        *conf     = NULL;
+        dht_dir_fd_ctx_t  *ctx      = NULL;
+        dht_readdir_buf_t *buf      = NULL;
+        gf_dirent_t        entries;
+        gf_dirent_t        stale;
+        int                op_ret   = 0;
+        int                op_errno = 0;
+        int                idx      = -1;
+        int                serve    = 0;
+        int                parked   = 0;
+        int                fetch    = 0;
+
+        local = frame->local;
+        conf = this->private;
+
+        if (conf->readdir_parallel)
+                ctx = dht_dir_fd_ctx_get (this, local->fd, _gf_false);
+        if (ctx)
+                idx = dht_subvol_cnt (this, subvol);
+        if ((idx < 0) || (idx >= ctx->cnt))
+                goto wind;
+
+        buf = &ctx->bufs[idx];
+        INIT_LIST_HEAD (&entries.list);
+        INIT_LIST_HEAD (&stale.list);
+
+        LOCK (&ctx->lock);
+        {
+                if (buf->waiter) {
+                        /* somebody else is waiting on this subvolume */
+                } else if (buf->ready && (buf->offset == offset)) {
+                        __dht_readdir_buf_take (buf, &entries, &op_ret,
+                                                &op_errno);
+                        serve = 1;
+                } else if (buf->inflight && (buf->offset == offset)) {
+                        buf->waiter = frame;
+                        parked = 1;
+                } else if (!buf->inflight) {
+                        /* nothing read ahead yet, or the application
+                           seeked away from what was */
+                        if (buf->ready)
+                                __dht_readdir_buf_take (buf, &stale, &op_ret,
+                                                        &op_errno);
+                        buf->inflight = _gf_true;
+                        buf->offset = offset;
+                        buf->waiter = frame;
+                        fetch = 1;
+                }
+        }
+        UNLOCK (&ctx->lock);
+
+        gf_dirent_free (&stale);
+
+        if (serve) {
+                dht_readdirp_serve (frame, this, ctx, idx, op_ret, op_errno,
+                                    &entries);
+                gf_dirent_free (&entries);
+                return 0;
+        }
+
+        if (fetch)
+                dht_readdirp_prefetch (frame, this, ctx, idx, offset);
+
+        if (parked || fetch)
+                return 0;
+
+wind:
+        STACK_WIND (frame, dht_readdirp_cbk, subvol, subvol->fops->readdirp,
+                    local->fd, local->size, offset, local->xattr);
+        return 0;
+}
+
+
+int
+dht_readdirp_process (call_frame_t *frame, xlator_t *this, xlator_t *prev,
+                      int op_ret, int op_errno, gf_dirent_t *orig_entries)
 {
         dht_local_t  *local = NULL;
         gf_dirent_t   entries;
         gf_dirent_t  *orig_entry = NULL;
         gf_dirent_t  *entry = NULL;
-        call_frame_t *prev = NULL;
         xlator_t     *next_subvol = NULL;
         off_t         next_offset = 0;
         int           count = 0;
@@ -2977,9 +3396,10 @@ dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
         dht_conf_t   *conf   = NULL;
         xlator_t     *subvol = 0;
         int           ret    = 0;
+        uint32_t     *hashes = NULL;
+        int           i      = 0;
 
         INIT_LIST_HEAD (&entries.list);
-        prev = cookie;
         local = frame->local;
         conf  = this->private;
 
@@ -2991,10 +3411,14 @@ dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
 
         layout = local->layout;
 
+        if (conf->search_unhashed == GF_DHT_LOOKUP_UNHASHED_AUTO)
+                hashes = dht_layout_hash_entries (this, layout, orig_entries);
+
         list_for_each_entry (orig_entry, (&orig_entries->list), list) {
                 next_offset = orig_entry->d_off;
+                i++;
                 if ((check_is_dir (NULL, (&orig_entry->d_stat), NULL) &&
-                     (prev->this != dht_first_up_subvol (this))) ||
+                     (prev != dht_first_up_subvol (this))) ||
                     check_is_linkfile (NULL, (&orig_entry->d_stat),
                                        orig_entry->dict)) {
                         continue;
@@ -3008,16 +3432,20 @@ dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
 
                 /* Do this if conf->search_unhashed is set to "auto" */
                 if (conf->search_unhashed == GF_DHT_LOOKUP_UNHASHED_AUTO) {
-                        subvol = dht_layout_search (this, layout,
-                                                    orig_entry->d_name);
-                        if (!subvol || (subvol != prev->this)) {
+                        if (hashes)
+                                subvol = dht_layout_search_hash (this, layout,
+                                                                 hashes[i - 1]);
+                        else
+                                subvol = dht_layout_search (this, layout,
+                                                            orig_entry->d_name);
+                        if (!subvol || (subvol != prev)) {
                                 /* TODO: Count the number of entries which need
                                    linkfile to prove its existence in fs */
                                 layout->search_unhashed++;
                         }
                 }
 
-                dht_itransform (this, prev->this, orig_entry->d_off,
+                dht_itransform (this, prev, orig_entry->d_off,
                                 &entry->d_off);
 
                 entry->d_stat = orig_entry->d_stat;
@@ -3032,7 +3460,7 @@ dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
                    currently possible only for non-directories, so for
                    directories don't set entry inodes */
                 if (!IA_ISDIR(entry->d_stat.ia_type)) {
-                        ret = dht_layout_preset (this, prev->this,
+                        ret = dht_layout_preset (this, prev,
                                                  orig_entry->inode);
                         if (ret)
                                 gf_log (this->name, GF_LOG_WARNING,
@@ -3054,18 +3482,21 @@ dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
          * distribute we're not concerned only with a posix's view of the
          * directory but the aggregated namespace' view of the directory.
          */
-        if (prev->this != dht_last_up_subvol (this))
+        if (prev != dht_last_up_subvol (this))
                 op_errno = 0;
 
 done:
+        GF_FREE (hashes);
+        hashes = NULL;
+
         if (count == 0) {
                 /* non-zero next_offset means that
                    EOF is not yet hit on the current subvol
                 */
                 if (next_offset == 0) {
-                        next_subvol = dht_subvol_next (this, prev->this);
+                        next_subvol = dht_subvol_next (this, prev);
                 } else {
-                        next_subvol = prev->this;
+                        next_subvol = prev;
                 }
 
                 if (!next_subvol) {
@@ -3082,14 +3513,13 @@ done:
 		        }
                 }
 
-                STACK_WIND (frame, dht_readdirp_cbk,
-                            next_subvol, next_subvol->fops->readdirp,
-                            local->fd, local->size, next_offset,
-                            local->xattr);
+                dht_readdirp_wind (frame, this, next_subvol, next_offset);
                 return 0;
         }
 
 unwind:
+        GF_FREE (hashes);
+
         if (op_ret < 0)
                 op_ret = 0;
 
@@ -3101,6 +3531,19 @@ unwind:
 }
 
 
+int
+dht_readdirp_cbk (call_frame_t *frame, void *cookie, xlator_t *this, int op_ret,
+                  int op_errno, gf_dirent_t *orig_entries, dict_t *xdata)
+{
+        call_frame_t *prev = NULL;
+
+        prev = cookie;
+
+        return dht_readdirp_process (frame, this, prev->this, op_ret,
+                                     op_errno, orig_entries);
+}
+
+
 
 int
 dht_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
@@ -3117,6 +3560,8 @@ dht_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         int           count = 0;
         dht_layout_t *layout = 0;
         xlator_t     *subvol = 0;
+        uint32_t     *hashes = NULL;
+        int           i      = 0;
 
         INIT_LIST_HEAD (&entries.list);
         prev = cookie;
@@ -3130,10 +3575,18 @@ dht_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         layout = local->layout;
 
+        /* hash the whole batch at once rather than name by name */
+        hashes = dht_layout_hash_entries (this, layout, orig_entries);
+
         list_for_each_entry (orig_entry, (&orig_entries->list), list) {
                 next_offset = orig_entry->d_off;
 
-                subvol = dht_layout_search (this, layout, orig_entry->d_name);
+                if (hashes)
+                        subvol = dht_layout_search_hash (this, layout,
+                                                         hashes[i++]);
+                else
+                        subvol = dht_layout_search (this, layout,
+                                                    orig_entry->d_name);
 
                 if (!subvol || (subvol == prev->this)) {
                         entry = gf_dirent_for_name (orig_entry->d_name);
@@ -3166,6 +3619,9 @@ dht_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 op_errno = 0;
 
 done:
+        GF_FREE (hashes);
+        hashes = NULL;
+
         if (count == 0) {
                 /* non-zero next_offset means that
                    EOF is not yet hit on the current subvol
@@ -3187,6 +3643,8 @@ done:
         }
 
 unwind:
+        GF_FREE (hashes);
+
         if (op_ret < 0)
                 op_ret = 0;
 
@@ -3208,6 +3666,7 @@ dht_do_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
         off_t         xoff = 0;
         int           ret = 0;
         dht_conf_t   *conf = NULL;
+        dht_dir_fd_ctx_t *ctx = NULL;
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -3254,8 +3713,13 @@ dht_do_readdir (call_frame_t *frame, xlator_t *this, fd_t *fd, size_t size,
 			}
                 }
 
-                STACK_WIND (frame, dht_readdirp_cbk, xvol, xvol->fops->readdirp,
-                            fd, size, xoff, local->xattr);
+                if (conf->readdir_parallel) {
+                        ctx = dht_dir_fd_ctx_get (this, fd, _gf_true);
+                        if (ctx)
+                                dht_readdirp_fan_out (frame, this, ctx, xvol);
+                }
+
+                dht_readdirp_wind (frame, this, xvol, xoff);
         } else {
                 STACK_WIND (frame, dht_readdir_cbk, xvol, xvol->fops->readdir,
                             fd, size, xoff, local->xattr);
@@ -3483,6 +3947,8 @@ dht_mknod (call_frame_t *frame, xlator_t *this,
 
         dht_get_du_info (frame, this, loc);
 
+        dht_neg_cache_purge (this, loc->parent, loc->name);
+
         local = dht_local_init (frame, loc, NULL, GF_FOP_MKNOD);
         if (!local) {
                 op_errno = ENOMEM;
@@ -3553,6 +4019,8 @@ dht_symlink (call_frame_t *frame, xlator_t *this,
         VALIDATE_OR_GOTO (this, err);
         VALIDATE_OR_GOTO (loc, err);
 
+        dht_neg_cache_purge (this, loc->parent, loc->name);
+
         local = dht_local_init (frame, loc, NULL, GF_FOP_SYMLINK);
         if (!local) {
                 op_errno = ENOMEM;
@@ -3742,6 +4210,8 @@ dht_link (call_frame_t *frame, xlator_t *this,
         VALIDATE_OR_GOTO (oldloc, err);
         VALIDATE_OR_GOTO (newloc, err);
 
+        dht_neg_cache_purge (this, newloc->parent, newloc->name);
+
         local = dht_local_init (frame, oldloc, NULL, GF_FOP_LINK);
         if (!local) {
                 op_errno = ENOMEM;
@@ -3885,6 +4355,8 @@ dht_create (call_frame_t *frame, xlator_t *this,
 
         dht_get_du_info (frame, this, loc);
 
+        dht_neg_cache_purge (this, loc->parent, loc->name);
+
         local = dht_local_init (frame, loc, fd, GF_FOP_CREATE);
         if (!local) {
                 op_errno = ENOMEM;
@@ -4138,6 +4610,8 @@ dht_mkdir (call_frame_t *frame, xlator_t *this,
 
         dht_get_du_info (frame, this, loc);
 
+        dht_neg_cache_purge (this, loc->parent, loc->name);
+
         local = dht_local_init (frame, loc, NULL, GF_FOP_MKDIR);
         if (!local) {
                 op_errno = ENOMEM;
@@ -4888,6 +5362,32 @@ dht_forget (xlator_t *this, inode_t *inode)
         layout = ctx->layout;
         ctx->layout = NULL;
         dht_layout_unref (this, layout);
+        dht_neg_cache_free (ctx);
+        GF_FREE (ctx);
+
+        return 0;
+}
+
+
+int
+dht_releasedir (xlator_t *this, fd_t *fd)
+{
+        uint64_t          value = 0;
+        dht_dir_fd_ctx_t *ctx   = NULL;
+        int               i     = 0;
+
+        fd_ctx_del (fd, this, &value);
+
+        if (!value)
+                return 0;
+
+        ctx = (dht_dir_fd_ctx_t *)(long) value;
+
+        /* read aheads hold a ref on the fd, none can be in flight here */
+        for (i = 0; i < ctx->cnt; i++)
+                gf_dirent_free (&ctx->bufs[i].entries);
+
+        LOCK_DESTROY (&ctx->lock);
         GF_FREE (ctx);
 
         return 0;
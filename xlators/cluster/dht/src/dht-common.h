@@ -24,6 +24,13 @@
 #define GF_DHT_LOOKUP_UNHASHED_ON   1
 #define GF_DHT_LOOKUP_UNHASHED_AUTO 2
 #define DHT_PATHINFO_HEADER         "DISTRIBUTE:"
+#define DHT_COMMITHASH_KEY          "trusted.glusterfs.dht.commithash"
+
+/* names remembered as missing per directory, see negative-lookup-timeout */
+#define DHT_NEG_CACHE_MAX           256
+
+/* ring points a subvolume may own in a layout-vnodes directory */
+#define DHT_LAYOUT_VNODES_MAX       1024
 
 #include <fnmatch.h>
 
@@ -35,6 +42,35 @@ typedef int (*dht_defrag_cbk_fn_t) (xlator_t        *this, call_frame_t *frame,
                                     int              ret);
 
 
+/* One contiguous hash range of a directory layout, as looked up */
+struct dht_layout_range {
+        uint32_t           start;
+        uint32_t           stop;
+        xlator_t          *xlator;
+};
+typedef struct dht_layout_range dht_layout_range_t;
+
+struct dht_vnode_member {
+        xlator_t          *xlator;
+        uint32_t           id;
+        uint32_t           vnodes;
+};
+typedef struct dht_vnode_member dht_vnode_member_t;
+
+/* Ranges of a layout sorted by start, searched by bisection. Indexes of
+   DHT_HASH_TYPE_DM_VNODE layouts depend only on their members and are
+   shared through dht_conf_t->layout_rings */
+struct dht_layout_index {
+        struct list_head    list;
+        int                 ref;        /* use with dht_conf_t->layout_lock */
+        int                 linear;     /* ranges overlap, scan the layout */
+        int                 member_cnt;
+        dht_vnode_member_t *members;
+        int                 cnt;
+        dht_layout_range_t  ranges[];
+};
+typedef struct dht_layout_index dht_layout_index_t;
+
 struct dht_layout {
         int                spread_cnt;  /* layout spread count per directory,
                                            is controlled by 'setxattr()' with
@@ -45,13 +81,16 @@ struct dht_layout {
         int                type;
         int                ref; /* use with dht_conf_t->layout_lock */
         int                search_unhashed;
+        gf_lock_t          lock;        /* guards index */
+        dht_layout_index_t *index;      /* built on first search */
         struct {
                 int        err;   /* 0 = normal
                                      -1 = dir exists and no xattr
                                      >0 = dir lookup failed with errno
                                   */
-                uint32_t   start;
-                uint32_t   stop;
+                uint32_t   start; /* ring id for DHT_HASH_TYPE_DM_VNODE */
+                uint32_t   stop;  /* ring points for DHT_HASH_TYPE_DM_VNODE */
+                uint32_t   commit_hash; /* 0 = placement not committed */
                 xlator_t  *xlator;
         } list[];
 };
@@ -68,9 +107,24 @@ struct dht_stat_time {
 
 typedef struct dht_stat_time dht_stat_time_t;
 
+struct dht_neg_entry {
+        struct list_head  list;
+        time_t            expire;
+        char              name[];
+};
+typedef struct dht_neg_entry dht_neg_entry_t;
+
+/* Names recently found missing in a directory, under inode->lock */
+struct dht_neg_cache {
+        struct list_head  entries;      /* oldest first */
+        int               cnt;
+};
+typedef struct dht_neg_cache dht_neg_cache_t;
+
 struct dht_inode_ctx {
         dht_layout_t    *layout;
         dht_stat_time_t  time;
+        dht_neg_cache_t *neg;
 };
 
 typedef struct dht_inode_ctx dht_inode_ctx_t;
@@ -79,6 +133,7 @@ typedef struct dht_inode_ctx dht_inode_ctx_t;
 typedef enum {
         DHT_HASH_TYPE_DM,
         DHT_HASH_TYPE_DM_USER,
+        DHT_HASH_TYPE_DM_VNODE,
 } dht_hashfn_type_t;
 
 /* rebalance related */
@@ -187,6 +242,7 @@ struct dht_du {
         double   avail_percent;
 	double   avail_inodes;
         uint64_t avail_space;
+        uint64_t total_space;
         uint32_t log;
 };
 typedef struct dht_du dht_du_t;
@@ -272,9 +328,51 @@ struct dht_conf {
         /* Request to filter directory entries in readdir request */
 
         gf_boolean_t    readdir_optimize;
+
+        /* Prefetch readdirp chunks from all subvolumes concurrently */
+        gf_boolean_t    readdir_parallel;
+
+        /* Directory layouts stamped with this hash were written when all
+           their entries were placed by them, so a miss on the hashed
+           subvolume is authoritative. Derived from the subvolume list */
+        uint32_t        vol_commit_hash;
+        gf_boolean_t    lookup_optimize;
+        uint32_t        neg_timeout;    /* seconds, 0 disables the cache */
+
+        /* New directory layouts give every subvolume this many points on
+           a hash ring instead of one contiguous range, 0 disables */
+        uint32_t        layout_vnodes;
+        struct list_head layout_rings;  /* shared dht_layout_index_t */
+
+        /* Size new layouts by subvolume capacity, or by the configured
+           subvol-weights (under subvolume_lock) when there are any */
+        gf_boolean_t    do_weighting;
+        uint32_t       *subvol_weights;
 };
 typedef struct dht_conf dht_conf_t;
 
+/* One readdirp chunk read ahead from a subvolume. At most one chunk is held
+   or in flight per subvolume, so memory stays bounded by the request size */
+struct dht_readdir_buf {
+        gf_dirent_t        entries;
+        off_t              offset;     /* subvolume offset it was read at */
+        int                op_ret;
+        int                op_errno;
+        gf_boolean_t       inflight;
+        gf_boolean_t       ready;
+        call_frame_t      *waiter;     /* readdirp parked until it arrives */
+};
+typedef struct dht_readdir_buf dht_readdir_buf_t;
+
+/* fd context of a directory when readdir-parallel is on. fds of regular
+   files keep the migration target subvolume in the same slot instead */
+struct dht_dir_fd_ctx {
+        gf_lock_t          lock;
+        int                cnt;
+        dht_readdir_buf_t  bufs[];
+};
+typedef struct dht_dir_fd_ctx dht_dir_fd_ctx_t;
+
 
 struct dht_disk_layout {
         uint32_t           cnt;
@@ -377,6 +475,10 @@ dht_layout_t                            *dht_layout_get (xlator_t *this, inode_t
 dht_layout_t                            *dht_layout_for_subvol (xlator_t *this, xlator_t *subvol);
 xlator_t *dht_layout_search (xlator_t   *this, dht_layout_t *layout,
                              const char *name);
+xlator_t *dht_layout_search_hash (xlator_t *this, dht_layout_t *layout,
+                                  uint32_t hash);
+uint32_t *dht_layout_hash_entries (xlator_t *this, dht_layout_t *layout,
+                                   gf_dirent_t *entries);
 int                                      dht_layout_normalize (xlator_t *this, loc_t *loc, dht_layout_t *layout);
 int dht_layout_anomalies (xlator_t      *this, loc_t *loc, dht_layout_t *layout,
                           uint32_t      *holes_p, uint32_t *overlaps_p,
@@ -418,6 +520,8 @@ xlator_t *dht_subvol_next (xlator_t *this, xlator_t *prev);
 int       dht_subvol_cnt (xlator_t *this, xlator_t *subvol);
 
 int dht_hash_compute (int type, const char *name, uint32_t *hash_p);
+int dht_hash_compute_multi (int type, const char **names, uint32_t *hashes,
+                            int cnt);
 
 int dht_linkfile_create (call_frame_t    *frame, fop_mknod_cbk_t linkfile_cbk,
                          xlator_t        *tovol, xlator_t *fromvol, loc_t *loc);
@@ -440,6 +544,8 @@ int dht_get_du_info (call_frame_t *frame, xlator_t *this, loc_t *loc);
 gf_boolean_t dht_is_subvol_filled (xlator_t *this, xlator_t *subvol);
 xlator_t *dht_free_disk_available_subvol (xlator_t *this, xlator_t *subvol);
 int       dht_get_du_info_for_subvol (xlator_t *this, int subvol_idx);
+uint64_t  dht_subvol_weight (xlator_t *this, xlator_t *subvol);
+gf_boolean_t dht_is_weighted (xlator_t *this);
 
 int dht_layout_preset (xlator_t *this, xlator_t *subvol, inode_t *inode);
 int           dht_layout_set (xlator_t *this, inode_t *inode, dht_layout_t *layout);;
@@ -656,6 +762,7 @@ int32_t dht_fxattrop (call_frame_t *frame,
                       dict_t             *dict, dict_t *xdata);
 
 int32_t dht_forget (xlator_t *this, inode_t *inode);
+int32_t dht_releasedir (xlator_t *this, fd_t *fd);
 int32_t dht_setattr (call_frame_t  *frame, xlator_t *this, loc_t *loc,
                      struct iatt   *stbuf, int32_t valid, dict_t *xdata);
 int32_t dht_fsetattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
@@ -723,6 +830,22 @@ int
 dht_dir_attr_heal_done (int ret, call_frame_t *sync_frame, void *data);
 int
 dht_dir_has_layout (dict_t *xattr);
+uint32_t
+dht_layout_commit_stamp (xlator_t *this, uint32_t start, uint32_t stop);
+void
+dht_layout_commit (xlator_t *this, dht_layout_t *layout);
+gf_boolean_t
+dht_layout_is_committed (xlator_t *this, dht_layout_t *layout);
+void
+dht_layout_index_reset (xlator_t *this, dht_layout_t *layout);
+gf_boolean_t
+dht_neg_cache_check (xlator_t *this, inode_t *parent, const char *name);
+void
+dht_neg_cache_add (xlator_t *this, inode_t *parent, const char *name);
+void
+dht_neg_cache_purge (xlator_t *this, inode_t *parent, const char *name);
+void
+dht_neg_cache_free (dht_inode_ctx_t *ctx);
 gf_boolean_t
 dht_is_subvol_in_layout (dht_layout_t *layout, xlator_t *xlator);
 xlator_t *
@@ -36,6 +36,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 	double         percent = 0;
 	double         percent_inodes = 0;
 	uint64_t       bytes = 0;
+	uint64_t       total = 0;
 
 	conf = this->private;
 	prev = cookie;
@@ -49,6 +50,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 	if (statvfs && statvfs->f_blocks) {
 		percent = (statvfs->f_bavail * 100) / statvfs->f_blocks;
 		bytes = (statvfs->f_bavail * statvfs->f_frsize);
+		total = (statvfs->f_blocks * statvfs->f_frsize);
 	}
 
 	if (statvfs && statvfs->f_files) {
@@ -70,6 +72,7 @@ dht_du_info_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 				conf->du_stats[i].avail_percent = percent;
 				conf->du_stats[i].avail_space   = bytes;
 				conf->du_stats[i].avail_inodes  = percent_inodes;
+				conf->du_stats[i].total_space   = total;
 				gf_log (this->name, GF_LOG_DEBUG,
 					"on subvolume '%s': avail_percent is: "
 					"%.2f and avail_space is: %"PRIu64" "
@@ -249,6 +252,50 @@ dht_is_subvol_filled (xlator_t *this, xlator_t *subvol)
 }
 
 
+gf_boolean_t
+dht_is_weighted (xlator_t *this)
+{
+	dht_conf_t *conf = NULL;
+
+	conf = this->private;
+
+	return (conf->do_weighting || conf->subvol_weights);
+}
+
+
+/* Share of the hash space @subvol should get in new layouts: its configured
+   weight (1 if it has none), else its size with weighted-rebalance, else 1.
+   0 while the size is not known yet */
+uint64_t
+dht_subvol_weight (xlator_t *this, xlator_t *subvol)
+{
+	dht_conf_t *conf   = NULL;
+	uint64_t    weight = 1;
+	int         i      = 0;
+
+	conf = this->private;
+
+	LOCK (&conf->subvolume_lock);
+	{
+		for (i = 0; i < conf->subvolume_cnt; i++) {
+			if (conf->subvolumes[i] != subvol)
+				continue;
+
+			if (conf->subvol_weights) {
+				if (conf->subvol_weights[i])
+					weight = conf->subvol_weights[i];
+			} else if (conf->do_weighting) {
+				weight = conf->du_stats[i].total_space;
+			}
+			break;
+		}
+	}
+	UNLOCK (&conf->subvolume_lock);
+
+	return weight;
+}
+
+
 /*Get the best subvolume to create the file in*/
 xlator_t *
 dht_free_disk_available_subvol (xlator_t *this, xlator_t *subvol)
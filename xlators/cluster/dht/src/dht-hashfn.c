@@ -21,7 +21,8 @@
 
 
 int
-dht_hash_compute_internal (int type, const char *name, uint32_t *hash_p)
+dht_hash_compute_internal (int type, const char *name, int len,
+                           uint32_t *hash_p)
 {
         int      ret = 0;
         uint32_t hash = 0;
@@ -29,7 +30,8 @@ dht_hash_compute_internal (int type, const char *name, uint32_t *hash_p)
         switch (type) {
         case DHT_HASH_TYPE_DM:
         case DHT_HASH_TYPE_DM_USER:
-                hash = gf_dm_hashfn (name, strlen (name));
+        case DHT_HASH_TYPE_DM_VNODE:
+                hash = gf_dm_hashfn (name, len);
                 break;
         default:
                 ret = -1;
@@ -44,30 +46,72 @@ dht_hash_compute_internal (int type, const char *name, uint32_t *hash_p)
 }
 
 
-#define MAKE_RSYNC_FRIENDLY_NAME(rsync_frndly_name, name) do {          \
-                rsync_frndly_name = (char *) name;                      \
-                if (name[0] == '.') {                                   \
-                        char *dot   = 0;                                \
-                        int namelen = 0;                                \
-                                                                        \
-                        dot = strrchr (name, '.');                      \
-                        if (dot && dot > (name + 1) && *(dot + 1)) {    \
-                                namelen = (dot - name);                 \
-                                rsync_frndly_name = alloca (namelen);   \
-                                strncpy (rsync_frndly_name, name + 1,   \
-                                         namelen);                      \
-                                rsync_frndly_name[namelen - 1] = 0;     \
-                        }                                               \
-                }                                                       \
-        } while (0);
+/* rsync writes ".name.XXXXXX" temporaries and renames them to "name"; both
+   hash as "name", which is where it points into @name. No copy is made */
+static inline const char *
+dht_rsync_friendly_name (const char *name, int *len_p)
+{
+        const char *dot = NULL;
+
+        if (name[0] == '.') {
+                dot = strrchr (name, '.');
+                if (dot && dot > (name + 1) && *(dot + 1)) {
+                        *len_p = dot - name - 1;
+                        return name + 1;
+                }
+        }
+
+        *len_p = strlen (name);
+        return name;
+}
 
 
 int
 dht_hash_compute (int type, const char *name, uint32_t *hash_p)
 {
-        char     *rsync_friendly_name = NULL;
+        const char *rsync_friendly_name = NULL;
+        int         len = 0;
+
+        rsync_friendly_name = dht_rsync_friendly_name (name, &len);
+
+        return dht_hash_compute_internal (type, rsync_friendly_name, len,
+                                          hash_p);
+}
+
+
+/* dht_hash_compute of @cnt names, hashed side by side */
+int
+dht_hash_compute_multi (int type, const char **names, uint32_t *hashes,
+                        int cnt)
+{
+        const char **msgs = NULL;
+        int         *lens = NULL;
+        int          i    = 0;
+
+        switch (type) {
+        case DHT_HASH_TYPE_DM:
+        case DHT_HASH_TYPE_DM_USER:
+        case DHT_HASH_TYPE_DM_VNODE:
+                break;
+        default:
+                return -1;
+        }
+
+        msgs = GF_CALLOC (cnt, sizeof (*msgs), gf_dht_mt_char);
+        lens = GF_CALLOC (cnt, sizeof (*lens), gf_dht_mt_int32_t);
+        if (!msgs || !lens) {
+                GF_FREE (msgs);
+                GF_FREE (lens);
+                return -1;
+        }
+
+        for (i = 0; i < cnt; i++)
+                msgs[i] = dht_rsync_friendly_name (names[i], &lens[i]);
+
+        gf_dm_hashfn_multi (msgs, lens, hashes, cnt);
 
-        MAKE_RSYNC_FRIENDLY_NAME (rsync_friendly_name, name);
+        GF_FREE (msgs);
+        GF_FREE (lens);
 
-        return dht_hash_compute_internal (type, rsync_friendly_name, hash_p);
+        return 0;
 }
@@ -17,6 +17,7 @@
 #include "glusterfs.h"
 #include "xlator.h"
 #include "dht-common.h"
+#include "hashfn.h"
 
 
 int
@@ -587,6 +588,14 @@ dht_init_subvolumes (xlator_t *this, dht_conf_t *conf)
                 return -1;
         }
 
+        /* adding or removing a subvolume changes the hash, and with it
+           the stamp every committed directory layout must carry */
+        conf->vol_commit_hash = 0;
+        for (cnt = 0; cnt < conf->subvolume_cnt; cnt++)
+                conf->vol_commit_hash ^= gf_dm_hashfn (
+                        conf->subvolumes[cnt]->name,
+                        strlen (conf->subvolumes[cnt]->name)) + cnt;
+
         return 0;
 }
 
@@ -944,6 +953,12 @@ dht_inode_ctx_time_update (inode_t *inode, xlator_t *this, struct iatt *stat,
 
         time = &ctx->time;
 
+        /* an entry appeared or went away behind our back */
+        if (post && ctx->neg &&
+            is_greater_time (time->mtime, time->mtime_nsec, stat->ia_mtime,
+                             stat->ia_mtime_nsec))
+                dht_neg_cache_purge (this, inode, NULL);
+
         DHT_UPDATE_TIME(time->mtime, time->mtime_nsec,
                         stat->ia_mtime, stat->ia_mtime_nsec, inode, post);
         DHT_UPDATE_TIME(time->ctime, time->ctime_nsec,
@@ -990,3 +1005,170 @@ int dht_inode_ctx_set (inode_t *inode, xlator_t *this, dht_inode_ctx_t *ctx)
 out:
         return ret;
 }
+
+
+static void
+__dht_neg_entry_del (dht_neg_cache_t *neg, dht_neg_entry_t *entry)
+{
+        list_del (&entry->list);
+        neg->cnt--;
+        GF_FREE (entry);
+}
+
+
+static dht_neg_entry_t *
+__dht_neg_entry_find (dht_neg_cache_t *neg, const char *name)
+{
+        dht_neg_entry_t *entry = NULL;
+
+        list_for_each_entry (entry, &neg->entries, list) {
+                if (!strcmp (entry->name, name))
+                        return entry;
+        }
+
+        return NULL;
+}
+
+
+gf_boolean_t
+dht_neg_cache_check (xlator_t *this, inode_t *parent, const char *name)
+{
+        dht_conf_t      *conf  = NULL;
+        dht_inode_ctx_t *ctx   = NULL;
+        dht_neg_entry_t *entry = NULL;
+        gf_boolean_t     hit   = _gf_false;
+
+        conf = this->private;
+
+        if (!conf->neg_timeout || !parent || !name)
+                return _gf_false;
+
+        if (dht_inode_ctx_get (parent, this, &ctx) || !ctx)
+                return _gf_false;
+
+        LOCK (&parent->lock);
+        {
+                if (!ctx->neg)
+                        goto unlock;
+
+                entry = __dht_neg_entry_find (ctx->neg, name);
+                if (!entry)
+                        goto unlock;
+
+                if (entry->expire > time (NULL))
+                        hit = _gf_true;
+                else
+                        __dht_neg_entry_del (ctx->neg, entry);
+        }
+unlock:
+        UNLOCK (&parent->lock);
+
+        return hit;
+}
+
+
+void
+dht_neg_cache_add (xlator_t *this, inode_t *parent, const char *name)
+{
+        dht_conf_t      *conf  = NULL;
+        dht_inode_ctx_t *ctx   = NULL;
+        dht_neg_cache_t *neg   = NULL;
+        dht_neg_entry_t *entry = NULL;
+
+        conf = this->private;
+
+        if (!conf->neg_timeout || !parent || !name)
+                return;
+
+        /* only directories which have been looked up carry a context */
+        if (dht_inode_ctx_get (parent, this, &ctx) || !ctx)
+                return;
+
+        LOCK (&parent->lock);
+        {
+                if (!ctx->neg) {
+                        neg = GF_CALLOC (1, sizeof (*neg),
+                                         gf_dht_mt_neg_cache_t);
+                        if (!neg)
+                                goto unlock;
+                        INIT_LIST_HEAD (&neg->entries);
+                        ctx->neg = neg;
+                }
+                neg = ctx->neg;
+
+                entry = __dht_neg_entry_find (neg, name);
+                if (entry) {
+                        list_move_tail (&entry->list, &neg->entries);
+                } else {
+                        if (neg->cnt >= DHT_NEG_CACHE_MAX)
+                                __dht_neg_entry_del (neg,
+                                        list_entry (neg->entries.next,
+                                                    dht_neg_entry_t, list));
+
+                        entry = GF_CALLOC (1, sizeof (*entry) +
+                                           strlen (name) + 1,
+                                           gf_dht_mt_neg_entry_t);
+                        if (!entry)
+                                goto unlock;
+                        strcpy (entry->name, name);
+                        list_add_tail (&entry->list, &neg->entries);
+                        neg->cnt++;
+                }
+
+                entry->expire = time (NULL) + conf->neg_timeout;
+        }
+unlock:
+        UNLOCK (&parent->lock);
+}
+
+
+/* Forget @name in @parent, or everything in it if @name is NULL */
+void
+dht_neg_cache_purge (xlator_t *this, inode_t *parent, const char *name)
+{
+        dht_inode_ctx_t *ctx   = NULL;
+        dht_neg_entry_t *entry = NULL;
+        dht_neg_entry_t *tmp   = NULL;
+
+        if (!parent)
+                return;
+
+        if (dht_inode_ctx_get (parent, this, &ctx) || !ctx)
+                return;
+
+        LOCK (&parent->lock);
+        {
+                if (!ctx->neg)
+                        goto unlock;
+
+                if (name) {
+                        entry = __dht_neg_entry_find (ctx->neg, name);
+                        if (entry)
+                                __dht_neg_entry_del (ctx->neg, entry);
+                        goto unlock;
+                }
+
+                list_for_each_entry_safe (entry, tmp, &ctx->neg->entries,
+                                          list)
+                        __dht_neg_entry_del (ctx->neg, entry);
+        }
+unlock:
+        UNLOCK (&parent->lock);
+}
+
+
+void
+dht_neg_cache_free (dht_inode_ctx_t *ctx)
+{
+        dht_neg_entry_t *entry = NULL;
+        dht_neg_entry_t *tmp   = NULL;
+
+        if (!ctx->neg)
+                return;
+
+        list_for_each_entry_safe (entry, tmp, &ctx->neg->entries, list)
+                __dht_neg_entry_del (ctx->neg, entry);
+
+        GF_FREE (ctx->neg);
+        ctx->neg = NULL;
+}
@@ -18,6 +18,7 @@
 #include "xlator.h"
 #include "dht-common.h"
 #include "byte-order.h"
+#include "hashfn.h"
 
 #define layout_base_size (sizeof (dht_layout_t))
 
@@ -25,6 +26,9 @@
 
 #define layout_size(cnt) (layout_base_size + (cnt * layout_entry_size))
 
+static void
+dht_layout_index_put (xlator_t *this, dht_layout_index_t *index);
+
 
 dht_layout_t *
 dht_layout_new (xlator_t *this, int cnt)
@@ -43,6 +47,7 @@ dht_layout_new (xlator_t *this, int cnt)
 
         layout->type = DHT_HASH_TYPE_DM;
         layout->cnt = cnt;
+        LOCK_INIT (&layout->lock);
 
         if (conf) {
                 layout->spread_cnt = conf->dir_spread_cnt;
@@ -125,8 +130,11 @@ dht_layout_unref (xlator_t *this, dht_layout_t *layout)
         }
         UNLOCK (&conf->layout_lock);
 
-        if (!ref)
+        if (!ref) {
+                dht_layout_index_put (this, layout->index);
+                LOCK_DESTROY (&layout->lock);
                 GF_FREE (layout);
+        }
 }
 
 
@@ -149,24 +157,382 @@ dht_layout_ref (xlator_t *this, dht_layout_t *layout)
 }
 
 
+static int
+dht_layout_range_cmp (const void *a, const void *b)
+{
+        const dht_layout_range_t *x = a;
+        const dht_layout_range_t *y = b;
+
+        return (x->start < y->start) ? -1 : (x->start > y->start);
+}
+
+
+static void
+dht_layout_index_add (dht_layout_index_t *index, uint32_t start, uint32_t stop,
+                      xlator_t *xlator)
+{
+        dht_layout_range_t *last = NULL;
+
+        if (index->cnt) {
+                last = &index->ranges[index->cnt - 1];
+                if ((last->xlator == xlator) && (last->stop + 1 == start)) {
+                        last->stop = stop;
+                        return;
+                }
+        }
+
+        index->ranges[index->cnt].start  = start;
+        index->ranges[index->cnt].stop   = stop;
+        index->ranges[index->cnt].xlator = xlator;
+        index->cnt++;
+}
+
+
+static dht_layout_index_t *
+dht_layout_index_alloc (int cnt)
+{
+        dht_layout_index_t *index = NULL;
+
+        index = GF_CALLOC (1, sizeof (*index) +
+                           cnt * sizeof (dht_layout_range_t),
+                           gf_dht_mt_layout_index_t);
+        if (!index)
+                return NULL;
+
+        INIT_LIST_HEAD (&index->list);
+        index->ref = 1;
+
+        return index;
+}
+
+
+static void
+dht_layout_index_put (xlator_t *this, dht_layout_index_t *index)
+{
+        dht_conf_t *conf = NULL;
+        int         ref  = 0;
+
+        if (!index)
+                return;
+
+        conf = this->private;
+
+        LOCK (&conf->layout_lock);
+        {
+                ref = --index->ref;
+                if (!ref)
+                        list_del_init (&index->list);
+        }
+        UNLOCK (&conf->layout_lock);
+
+        if (!ref) {
+                GF_FREE (index->members);
+                GF_FREE (index);
+        }
+}
+
+
+/* Ranges of a classic layout. Zero ranges belong to subvolumes without a
+   layout or outside subvols-per-directory and own no hash */
+static dht_layout_index_t *
+dht_layout_index_ranges (xlator_t *this, dht_layout_t *layout)
+{
+        dht_layout_index_t *index = NULL;
+        int                 i     = 0;
+
+        index = dht_layout_index_alloc (layout->cnt);
+        if (!index)
+                return NULL;
+
+        for (i = 0; i < layout->cnt; i++) {
+                if (!layout->list[i].xlator ||
+                    (layout->list[i].start > layout->list[i].stop) ||
+                    (!layout->list[i].start && !layout->list[i].stop))
+                        continue;
+
+                index->ranges[index->cnt].start  = layout->list[i].start;
+                index->ranges[index->cnt].stop   = layout->list[i].stop;
+                index->ranges[index->cnt].xlator = layout->list[i].xlator;
+                index->cnt++;
+        }
+
+        qsort (index->ranges, index->cnt, sizeof (dht_layout_range_t),
+               dht_layout_range_cmp);
+
+        /* an overlapping layout is about to be healed, keep resolving it
+           the way the linear scan always did until then */
+        for (i = 1; i < index->cnt; i++) {
+                if (index->ranges[i].start <= index->ranges[i - 1].stop) {
+                        index->linear = 1;
+                        break;
+                }
+        }
+
+        return index;
+}
+
+
+static gf_boolean_t
+dht_layout_is_vnode_member (dht_layout_t *layout, int i)
+{
+        return (layout->list[i].xlator && layout->list[i].stop &&
+                (layout->list[i].stop <= DHT_LAYOUT_VNODES_MAX));
+}
+
+
+static int
+dht_vnode_member_cmp (const void *a, const void *b)
+{
+        const dht_vnode_member_t *x = a;
+        const dht_vnode_member_t *y = b;
+
+        if (x->id != y->id)
+                return (x->id < y->id) ? -1 : 1;
+
+        return strcmp (x->xlator->name, y->xlator->name);
+}
+
+
+struct dht_vnode_point {
+        uint32_t  point;
+        int       member;
+};
+
+static int
+dht_vnode_point_cmp (const void *a, const void *b)
+{
+        const struct dht_vnode_point *x = a;
+        const struct dht_vnode_point *y = b;
+
+        if (x->point != y->point)
+                return (x->point < y->point) ? -1 : 1;
+
+        return x->member - y->member;
+}
+
+
+static dht_layout_index_t *
+dht_layout_ring_lookup (dht_conf_t *conf, dht_vnode_member_t *members,
+                        int member_cnt)
+{
+        dht_layout_index_t *index = NULL;
+
+        list_for_each_entry (index, &conf->layout_rings, list) {
+                if ((index->member_cnt == member_cnt) &&
+                    !memcmp (index->members, members,
+                             member_cnt * sizeof (*members))) {
+                        index->ref++;
+                        return index;
+                }
+        }
+
+        return NULL;
+}
+
+
+/* Every member of a DHT_HASH_TYPE_DM_VNODE layout puts as many points on
+   the ring as it has vnodes, at hashes of its ring id. A point owns the
+   hashes between the point before it and itself. Points depend on nothing
+   but the member, so a subvolume joining or leaving the ring only moves
+   the hashes its own points take or give up */
+static dht_layout_index_t *
+dht_layout_index_ring (xlator_t *this, dht_layout_t *layout)
+{
+        dht_conf_t              *conf       = NULL;
+        dht_layout_index_t      *index      = NULL;
+        dht_layout_index_t      *found      = NULL;
+        dht_vnode_member_t      *members    = NULL;
+        struct dht_vnode_point  *points     = NULL;
+        int                      member_cnt = 0;
+        int                      total      = 0;
+        int                      i          = 0;
+        int                      n          = 0;
+        uint32_t                 k          = 0;
+        uint32_t                 buf[2];
+        uint32_t                 start      = 0;
+
+        conf = this->private;
+
+        for (i = 0; i < layout->cnt; i++) {
+                if (dht_layout_is_vnode_member (layout, i))
+                        member_cnt++;
+        }
+
+        members = GF_CALLOC (member_cnt ? member_cnt : 1, sizeof (*members),
+                             gf_dht_mt_layout_index_t);
+        if (!members)
+                goto err;
+
+        for (i = 0, n = 0; i < layout->cnt; i++) {
+                if (!dht_layout_is_vnode_member (layout, i))
+                        continue;
+
+                members[n].xlator = layout->list[i].xlator;
+                members[n].id     = layout->list[i].start;
+                members[n].vnodes = layout->list[i].stop;
+                total += members[n].vnodes;
+                n++;
+        }
+
+        qsort (members, member_cnt, sizeof (*members), dht_vnode_member_cmp);
+
+        LOCK (&conf->layout_lock);
+        {
+                found = dht_layout_ring_lookup (conf, members, member_cnt);
+        }
+        UNLOCK (&conf->layout_lock);
+
+        if (found) {
+                GF_FREE (members);
+                return found;
+        }
+
+        points = GF_CALLOC (total ? total : 1, sizeof (*points),
+                            gf_dht_mt_layout_index_t);
+        if (!points)
+                goto err;
+
+        for (i = 0, n = 0; i < member_cnt; i++) {
+                for (k = 0; k < members[i].vnodes; k++) {
+                        buf[0] = hton32 (members[i].id);
+                        buf[1] = hton32 (k);
+                        points[n].point = gf_dm_hashfn ((char *) buf,
+                                                        sizeof (buf));
+                        points[n].member = i;
+                        n++;
+                }
+        }
+
+        qsort (points, total, sizeof (*points), dht_vnode_point_cmp);
+
+        index = dht_layout_index_alloc (total + 1);
+        if (!index)
+                goto err;
+
+        index->members    = members;
+        index->member_cnt = member_cnt;
+        members = NULL;
+
+        for (n = 0; n < total; n++) {
+                if (n && (points[n].point == points[n - 1].point))
+                        continue;
+
+                dht_layout_index_add (index, start, points[n].point,
+                                      index->members[points[n].member].xlator);
+                if (points[n].point == 0xffffffff)
+                        break;
+                start = points[n].point + 1;
+        }
+
+        /* the first point also owns what follows the last one */
+        if (total && (n == total))
+                dht_layout_index_add (index, start, 0xffffffff,
+                                      index->members[points[0].member].xlator);
+
+        GF_FREE (points);
+
+        gf_log (this->name, GF_LOG_DEBUG,
+                "built hash ring of %d members, %d points, %d ranges",
+                member_cnt, total, index->cnt);
+
+        LOCK (&conf->layout_lock);
+        {
+                found = dht_layout_ring_lookup (conf, index->members,
+                                                member_cnt);
+                if (!found)
+                        list_add (&index->list, &conf->layout_rings);
+        }
+        UNLOCK (&conf->layout_lock);
+
+        if (found) {
+                dht_layout_index_put (this, index);
+                index = found;
+        }
+
+        return index;
+err:
+        GF_FREE (members);
+        GF_FREE (points);
+        return NULL;
+}
+
+
+static xlator_t *
+dht_layout_index_search (dht_layout_index_t *index, uint32_t hash)
+{
+        int low   = 0;
+        int high  = index->cnt - 1;
+        int mid   = 0;
+        int found = -1;
+
+        while (low <= high) {
+                mid = low + (high - low) / 2;
+                if (index->ranges[mid].start <= hash) {
+                        found = mid;
+                        low = mid + 1;
+                } else {
+                        high = mid - 1;
+                }
+        }
+
+        if ((found < 0) || (index->ranges[found].stop < hash))
+                return NULL;
+
+        return index->ranges[found].xlator;
+}
+
+
+/* Called whenever the ranges of @layout change */
+void
+dht_layout_index_reset (xlator_t *this, dht_layout_t *layout)
+{
+        dht_layout_index_t *index = NULL;
+
+        LOCK (&layout->lock);
+        {
+                index = layout->index;
+                layout->index = NULL;
+        }
+        UNLOCK (&layout->lock);
+
+        dht_layout_index_put (this, index);
+}
+
+
 xlator_t *
-dht_layout_search (xlator_t *this, dht_layout_t *layout, const char *name)
+dht_layout_search_hash (xlator_t *this, dht_layout_t *layout, uint32_t hash)
 {
-        uint32_t   hash = 0;
         xlator_t  *subvol = NULL;
         int        i = 0;
-        int        ret = 0;
-
+        int        linear = 0;
+
+        /* vnode layouts have no meaning without their ring */
+        linear = (layout->type != DHT_HASH_TYPE_DM_VNODE);
+
+        if (!layout->preset) {
+                LOCK (&layout->lock);
+                {
+                        if (!layout->index) {
+                                if (layout->type == DHT_HASH_TYPE_DM_VNODE)
+                                        layout->index =
+                                             dht_layout_index_ring (this,
+                                                                    layout);
+                                else
+                                        layout->index =
+                                           dht_layout_index_ranges (this,
+                                                                    layout);
+                        }
 
-        ret = dht_hash_compute (layout->type, name, &hash);
-        if (ret != 0) {
-                gf_log (this->name, GF_LOG_WARNING,
-                        "hash computation failed for type=%d name=%s",
-                        layout->type, name);
-                goto out;
+                        if (layout->index && !layout->index->linear) {
+                                subvol = dht_layout_index_search (layout->index,
+                                                                  hash);
+                                linear = 0;
+                        }
+                }
+                UNLOCK (&layout->lock);
         }
 
-        for (i = 0; i < layout->cnt; i++) {
+        for (i = 0; linear && (i < layout->cnt); i++) {
                 if (layout->list[i].start <= hash
                     && layout->list[i].stop >= hash) {
                         subvol = layout->list[i].xlator;
@@ -179,11 +545,69 @@ dht_layout_search (xlator_t *this, dht_layout_t *layout, const char *name)
                         "no subvolume for hash (value) = %u", hash);
         }
 
+        return subvol;
+}
+
+
+xlator_t *
+dht_layout_search (xlator_t *this, dht_layout_t *layout, const char *name)
+{
+        uint32_t   hash = 0;
+        xlator_t  *subvol = NULL;
+        int        ret = 0;
+
+
+        ret = dht_hash_compute (layout->type, name, &hash);
+        if (ret != 0) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "hash computation failed for type=%d name=%s",
+                        layout->type, name);
+                goto out;
+        }
+
+        subvol = dht_layout_search_hash (this, layout, hash);
+
 out:
         return subvol;
 }
 
 
+/* Hashes of the names in @entries, in list order, for
+   dht_layout_search_hash. NULL when they could not be computed */
+uint32_t *
+dht_layout_hash_entries (xlator_t *this, dht_layout_t *layout,
+                         gf_dirent_t *entries)
+{
+        gf_dirent_t  *entry  = NULL;
+        const char  **names  = NULL;
+        uint32_t     *hashes = NULL;
+        int           cnt    = 0;
+        int           i      = 0;
+
+        list_for_each_entry (entry, &entries->list, list)
+                cnt++;
+
+        names = GF_CALLOC (cnt ? cnt : 1, sizeof (*names), gf_dht_mt_char);
+        hashes = GF_CALLOC (cnt ? cnt : 1, sizeof (*hashes),
+                            gf_dht_mt_int32_t);
+        if (!names || !hashes)
+                goto err;
+
+        list_for_each_entry (entry, &entries->list, list)
+                names[i++] = entry->d_name;
+
+        if (dht_hash_compute_multi (layout->type, names, hashes, cnt))
+                goto err;
+
+        GF_FREE (names);
+        return hashes;
+err:
+        GF_FREE (names);
+        GF_FREE (hashes);
+        return NULL;
+}
+
+
 dht_layout_t *
 dht_layout_for_subvol (xlator_t *this, xlator_t *subvol)
 {
@@ -309,6 +733,9 @@ dht_disk_layout_merge (xlator_t *this, dht_layout_t *layout,
                 /* Fall through. */
 	case DHT_HASH_TYPE_DM:
 		break;
+        case DHT_HASH_TYPE_DM_VNODE:
+                layout->type = type;
+                break;
         default:
 		gf_log (this->name, GF_LOG_CRITICAL,
 			"Catastrophic error layout with unknown type found %d",
@@ -340,11 +767,16 @@ dht_layout_merge (xlator_t *this, dht_layout_t *layout, xlator_t *subvol,
         int      err   = -1;
         void    *disk_layout_raw = NULL;
         int      disk_layout_len = 0;
+        void    *commit_hash_raw = NULL;
+        int      commit_hash_len = 0;
+        uint32_t commit_hash     = 0;
 
         if (op_ret != 0) {
                 err = op_errno;
         }
 
+        dht_layout_index_reset (this, layout);
+
         for (i = 0; i < layout->cnt; i++) {
                 if (layout->list[i].xlator == NULL) {
                         layout->list[i].err    = err;
@@ -383,6 +815,14 @@ dht_layout_merge (xlator_t *this, dht_layout_t *layout, xlator_t *subvol,
         }
         layout->list[i].err = 0;
 
+        layout->list[i].commit_hash = 0;
+        if (!dict_get_ptr_and_len (xattr, DHT_COMMITHASH_KEY,
+                                   &commit_hash_raw, &commit_hash_len) &&
+            (commit_hash_len == sizeof (uint32_t))) {
+                memcpy (&commit_hash, commit_hash_raw, sizeof (commit_hash));
+                layout->list[i].commit_hash = ntoh32 (commit_hash);
+        }
+
 out:
         return ret;
 }
@@ -393,21 +833,25 @@ dht_layout_entry_swap (dht_layout_t *layout, int i, int j)
 {
         uint32_t  start_swap = 0;
         uint32_t  stop_swap = 0;
+        uint32_t  commit_swap = 0;
         xlator_t *xlator_swap = 0;
         int       err_swap = 0;
 
         start_swap  = layout->list[i].start;
         stop_swap   = layout->list[i].stop;
+        commit_swap = layout->list[i].commit_hash;
         xlator_swap = layout->list[i].xlator;
         err_swap    = layout->list[i].err;
 
         layout->list[i].start  = layout->list[j].start;
         layout->list[i].stop   = layout->list[j].stop;
+        layout->list[i].commit_hash = layout->list[j].commit_hash;
         layout->list[i].xlator = layout->list[j].xlator;
         layout->list[i].err    = layout->list[j].err;
 
         layout->list[j].start  = start_swap;
         layout->list[j].stop   = stop_swap;
+        layout->list[j].commit_hash = commit_swap;
         layout->list[j].xlator = xlator_swap;
         layout->list[j].err    = err_swap;
 }
@@ -417,15 +861,19 @@ dht_layout_range_swap (dht_layout_t *layout, int i, int j)
 {
         uint32_t  start_swap = 0;
         uint32_t  stop_swap = 0;
+        uint32_t  commit_swap = 0;
 
         start_swap  = layout->list[i].start;
         stop_swap   = layout->list[i].stop;
+        commit_swap = layout->list[i].commit_hash;
 
         layout->list[i].start  = layout->list[j].start;
         layout->list[i].stop   = layout->list[j].stop;
+        layout->list[i].commit_hash = layout->list[j].commit_hash;
 
         layout->list[j].start  = start_swap;
         layout->list[j].stop   = stop_swap;
+        layout->list[j].commit_hash = commit_swap;
 }
 
 int64_t
@@ -522,6 +970,8 @@ dht_layout_anomalies (xlator_t *this, loc_t *loc, dht_layout_t *layout,
         uint32_t    last_stop = 0;
         char        is_virgin = 1;
         uint32_t    no_space  = 0;
+        int         j         = 0;
+        int         members   = 0;
 
         /* TODO: explain what is happening */
 
@@ -549,6 +999,31 @@ dht_layout_anomalies (xlator_t *this, loc_t *loc, dht_layout_t *layout,
 
                 is_virgin = 0;
 
+                /* a ring has no holes while it has a member, and two
+                   members with the same id would shadow each other */
+                if (layout->type == DHT_HASH_TYPE_DM_VNODE) {
+                        if (!layout->list[i].stop)
+                                continue;
+
+                        if (!dht_layout_is_vnode_member (layout, i)) {
+                                overlap_cnt++;
+                                continue;
+                        }
+
+                        for (j = 0; j < i; j++) {
+                                if (!layout->list[j].err &&
+                                    dht_layout_is_vnode_member (layout, j) &&
+                                    (layout->list[j].start ==
+                                     layout->list[i].start)) {
+                                        overlap_cnt++;
+                                        break;
+                                }
+                        }
+
+                        members++;
+                        continue;
+                }
+
                 if ((prev_stop + 1) < layout->list[i].start) {
                         hole_cnt++;
                 }
@@ -560,8 +1035,12 @@ dht_layout_anomalies (xlator_t *this, loc_t *loc, dht_layout_t *layout,
                 prev_stop = layout->list[i].stop;
         }
 
-        if ((last_stop - prev_stop) || is_virgin)
+        if (layout->type == DHT_HASH_TYPE_DM_VNODE) {
+                if (!members)
+                        hole_cnt++;
+        } else if ((last_stop - prev_stop) || is_virgin) {
                 hole_cnt++;
+        }
 
         if (holes_p)
                 *holes_p = hole_cnt;
@@ -649,6 +1128,120 @@ out:
         return ret;
 }
 
+/* The stamp binds the volume commit hash to the range it was written with,
+   so a layout rewritten by anybody unaware of it is no longer committed */
+uint32_t
+dht_layout_commit_stamp (xlator_t *this, uint32_t start, uint32_t stop)
+{
+        dht_conf_t *conf  = NULL;
+        uint32_t    buf[3];
+        uint32_t    stamp = 0;
+
+        conf = this->private;
+
+        buf[0] = hton32 (conf->vol_commit_hash);
+        buf[1] = hton32 (start);
+        buf[2] = hton32 (stop);
+
+        stamp = gf_dm_hashfn ((char *) buf, sizeof (buf));
+
+        /* 0 is reserved for uncommitted layouts */
+        return stamp ? stamp : 1;
+}
+
+
+void
+dht_layout_commit (xlator_t *this, dht_layout_t *layout)
+{
+        int i = 0;
+
+        for (i = 0; i < layout->cnt; i++)
+                layout->list[i].commit_hash =
+                        dht_layout_commit_stamp (this, layout->list[i].start,
+                                                 layout->list[i].stop);
+}
+
+
+/* Ring layouts cover the hash space as soon as they have a member; their
+   stamps bind the ring id and vnode count instead of a range */
+static gf_boolean_t
+dht_layout_vnode_is_committed (xlator_t *this, dht_layout_t *layout)
+{
+        int i       = 0;
+        int members = 0;
+
+        for (i = 0; i < layout->cnt; i++) {
+                if (layout->list[i].err > 0)
+                        return _gf_false;
+
+                if (layout->list[i].err || !layout->list[i].stop)
+                        continue;
+
+                if (!dht_layout_is_vnode_member (layout, i))
+                        return _gf_false;
+
+                if (layout->list[i].commit_hash !=
+                    dht_layout_commit_stamp (this, layout->list[i].start,
+                                             layout->list[i].stop))
+                        return _gf_false;
+
+                members++;
+        }
+
+        return (members > 0);
+}
+
+
+/* A committed layout covers the whole hash space without overlaps, and
+   every range in it carries the stamp written along with it by the current
+   set of subvolumes. Entries without a layout may exist (subvols-per-directory,
+   new bricks) as long as they own no range. The layout need not be sorted */
+gf_boolean_t
+dht_layout_is_committed (xlator_t *this, dht_layout_t *layout)
+{
+        uint64_t covered = 0;
+        int      i       = 0;
+        int      j       = 0;
+
+        if (!layout || (layout->type == DHT_HASH_TYPE_DM_USER))
+                return _gf_false;
+
+        if (layout->type == DHT_HASH_TYPE_DM_VNODE)
+                return dht_layout_vnode_is_committed (this, layout);
+
+        for (i = 0; i < layout->cnt; i++) {
+                if (layout->list[i].err > 0)
+                        return _gf_false;
+
+                if (layout->list[i].err || (!layout->list[i].start &&
+                                            !layout->list[i].stop))
+                        continue;
+
+                if (layout->list[i].start > layout->list[i].stop)
+                        return _gf_false;
+
+                if (layout->list[i].commit_hash !=
+                    dht_layout_commit_stamp (this, layout->list[i].start,
+                                             layout->list[i].stop))
+                        return _gf_false;
+
+                for (j = 0; j < i; j++) {
+                        if (layout->list[j].err || (!layout->list[j].start &&
+                                                    !layout->list[j].stop))
+                                continue;
+                        if ((layout->list[j].start <= layout->list[i].stop) &&
+                            (layout->list[i].start <= layout->list[j].stop))
+                                return _gf_false;
+                }
+
+                covered += (uint64_t) layout->list[i].stop -
+                        layout->list[i].start + 1;
+        }
+
+        return (covered == (1ULL << 32));
+}
+
+
 int
 dht_dir_has_layout (dict_t *xattr)
 {
@@ -30,6 +30,10 @@ enum gf_dht_mem_types_ {
         gf_defrag_info_mt,
         gf_dht_mt_inode_ctx_t,
         gf_dht_mt_ctx_stat_time_t,
+        gf_dht_mt_dir_fd_ctx_t,
+        gf_dht_mt_neg_cache_t,
+        gf_dht_mt_neg_entry_t,
+        gf_dht_mt_layout_index_t,
         gf_dht_mt_end
 };
 #endif
@@ -20,6 +20,8 @@
 #define GF_DISK_SECTOR_SIZE             512
 #define DHT_REBALANCE_PID               4242 /* Change it if required */
 #define DHT_REBALANCE_BLKSIZE           (128 * 1024)
+#define DHT_REBALANCE_WINDOW            8 /* blocks read ahead per file */
+#define DHT_REBALANCE_FRAME_TIMEOUT     1800 /* protocol/client's default */
 
 static int
 dht_write_with_holes (xlator_t *to, fd_t *fd, struct iovec *vec, int count,
@@ -292,7 +294,7 @@ __dht_rebalance_create_dst_file (xlator_t *to, xlator_t *from, loc_t *loc, struc
         /* Create the destination with LINKFILE mode, and linkto xattr,
            if the linkfile already exists, it will just open the file */
         ret = syncop_create (to, loc, O_RDWR, DHT_LINKFILE_MODE, fd,
-                             dict);
+                             dict, NULL);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_ERROR,
                         "failed to create %s on %s (%s)",
@@ -382,52 +384,409 @@ out:
         return ret;
 }
 
+typedef struct dht_migrate_window dht_migrate_window_t;
+
+/* one block of a file being migrated, read from the source and then
+   written to the destination */
+typedef struct dht_migrate_block {
+        dht_migrate_window_t *window;
+        off_t                 offset;
+        size_t                size;
+        int32_t               op_ret;   /* of the read */
+        int32_t               op_errno;
+        int32_t               written;  /* op_ret of the write */
+        struct iovec         *vector;
+        int                   count;
+        struct iobref        *iobref;
+} dht_migrate_block_t;
+
+/* While the blocks of one half are written, the next window of blocks is
+   read into the other half */
+struct dht_migrate_window {
+        struct syncargs       args;     /* to sleep until all are back */
+        gf_lock_t             lock;
+        int                   pending;
+        int                   waiting;
+        dht_migrate_block_t   blocks[2][DHT_REBALANCE_WINDOW];
+};
+
+static void
+dht_migrate_block_done (dht_migrate_block_t *block)
+{
+        dht_migrate_window_t *window = NULL;
+        int                   wake   = 0;
+
+        window = block->window;
+
+        LOCK (&window->lock);
+        {
+                wake = ((--window->pending == 0) && window->waiting);
+                if (wake)
+                        window->waiting = 0;
+        }
+        UNLOCK (&window->lock);
+
+        if (wake)
+                __wake ((&window->args));
+}
+
+static int
+dht_migrate_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int32_t op_ret, int32_t op_errno, struct iovec *vector,
+                       int32_t count, struct iatt *stbuf, struct iobref *iobref,
+                       dict_t *xdata)
+{
+        dht_migrate_block_t *block = NULL;
+
+        block = cookie;
+
+        block->op_ret   = op_ret;
+        block->op_errno = op_errno;
+        if (op_ret > 0) {
+                block->vector = iov_dup (vector, count);
+                block->count  = count;
+                if (iobref)
+                        block->iobref = iobref_ref (iobref);
+                if (!block->vector) {
+                        block->op_ret   = -1;
+                        block->op_errno = ENOMEM;
+                }
+        }
+
+        STACK_DESTROY (frame->root);
+        dht_migrate_block_done (block);
+
+        return 0;
+}
+
+static int
+dht_migrate_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                        int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                        struct iatt *postbuf, dict_t *xdata)
+{
+        dht_migrate_block_t *block = NULL;
+
+        block = cookie;
+
+        block->written  = op_ret;
+        block->op_errno = op_errno;
+
+        STACK_DESTROY (frame->root);
+        dht_migrate_block_done (block);
+
+        return 0;
+}
+
+/* Wind the read (or the write) of @block, without waiting for it */
+static int
+dht_migrate_block_wind (dht_migrate_block_t *block, xlator_t *subvol, fd_t *fd,
+                        int write)
+{
+        dht_migrate_window_t *window = NULL;
+        struct synctask      *task   = NULL;
+        call_frame_t         *frame  = NULL;
+
+        window = block->window;
+
+        /* keep the pid of the rebalance process on the copies */
+        task = synctask_get ();
+        if (task)
+                frame = copy_frame (task->opframe);
+        else
+                frame = create_frame (THIS, THIS->ctx->pool);
+        if (!frame) {
+                block->op_errno = ENOMEM;
+                return -1;
+        }
+
+        LOCK (&window->lock);
+        {
+                window->pending++;
+        }
+        UNLOCK (&window->lock);
+
+        if (write)
+                STACK_WIND_COOKIE (frame, dht_migrate_writev_cbk, block,
+                                   subvol, subvol->fops->writev, fd,
+                                   block->vector, block->count, block->offset,
+                                   0, block->iobref, NULL);
+        else
+                STACK_WIND_COOKIE (frame, dht_migrate_readv_cbk, block,
+                                   subvol, subvol->fops->readv, fd,
+                                   block->size, block->offset, 0, NULL);
+        return 0;
+}
+
+/* Sleep until every block wound in this round is back */
+static void
+dht_migrate_window_wait (dht_migrate_window_t *window)
+{
+        int wait = 0;
+
+        window->args.task = synctask_get ();
+        __yawn ((&window->args));
+
+        LOCK (&window->lock);
+        {
+                window->waiting = (window->pending > 0);
+                wait = window->waiting;
+        }
+        UNLOCK (&window->lock);
+
+        if (!wait)
+                return;
+
+        if (window->args.task)
+                window->args.task->state = SYNCTASK_SUSPEND;
+        __yield ((&window->args));
+}
+
+static void
+dht_migrate_block_release (dht_migrate_block_t *block)
+{
+        GF_FREE (block->vector);
+        if (block->iobref)
+                iobref_unref (block->iobref);
+        memset (block, 0, sizeof (*block));
+}
+
 static inline int
 __dht_rebalance_migrate_data (xlator_t *from, xlator_t *to, fd_t *src, fd_t *dst,
                              uint64_t ia_size, int hole_exists)
 {
-        int            ret    = 0;
-        int            count  = 0;
-        off_t          offset = 0;
-        struct iovec  *vector = NULL;
-        struct iobref *iobref = NULL;
-        uint64_t       total  = 0;
-        size_t         read_size = 0;
+        dht_migrate_window_t  window;
+        dht_migrate_block_t  *reading  = NULL;
+        dht_migrate_block_t  *writing  = NULL;
+        dht_migrate_block_t  *block    = NULL;
+        int                   ret      = 0;
+        int                   i        = 0;
+        int                   cur      = 0;
+        int                   nread    = 0;
+        int                   nwrite   = 0;
+        int                   eof      = 0;
+        int                   op_errno = 0;
+        uint64_t              offset   = 0;
+
+        memset (&window, 0, sizeof (window));
+        LOCK_INIT (&window.lock);
 
         /* if file size is '0', no need to enter this loop */
-        while (total < ia_size) {
-                read_size = (((ia_size - total) > DHT_REBALANCE_BLKSIZE) ?
-                             DHT_REBALANCE_BLKSIZE : (ia_size - total));
-                ret = syncop_readv (from, src, read_size,
-                                    offset, 0, &vector, &count, &iobref);
-                if (!ret || (ret < 0)) {
-                        break;
+        while (((offset < ia_size) && !eof) || nwrite) {
+                reading = window.blocks[cur];
+                writing = window.blocks[!cur];
+
+                for (nread = 0; !eof && (offset < ia_size) &&
+                     (nread < DHT_REBALANCE_WINDOW); nread++) {
+                        block = &reading[nread];
+                        block->window = &window;
+                        block->offset = offset;
+                        block->size   = min (ia_size - offset,
+                                             DHT_REBALANCE_BLKSIZE);
+                        offset += block->size;
+
+                        if (dht_migrate_block_wind (block, from, src, 0)) {
+                                block->op_ret = -1;
+                                eof = 1;
+                        }
                 }
 
-                if (hole_exists)
-                        ret = dht_write_with_holes (to, dst, vector, count,
-                                                    ret, offset, iobref);
-                else
-                        ret = syncop_writev (to, dst, vector, count,
-                                             offset, iobref, 0);
-                if (ret < 0) {
+                /* the previous window goes out while this one is read */
+                for (i = 0; i < nwrite; i++) {
+                        block = &writing[i];
+                        block->written = block->op_ret;
+                        if (!block->op_ret || op_errno)
+                                continue;
+
+                        if (hole_exists) {
+                                block->written = dht_write_with_holes (to, dst,
+                                                        block->vector,
+                                                        block->count,
+                                                        block->op_ret,
+                                                        block->offset,
+                                                        block->iobref);
+                                if (block->written < 0)
+                                        block->op_errno = errno;
+                        } else if (dht_migrate_block_wind (block, to, dst,
+                                                           1)) {
+                                block->written = -1;
+                        }
+
+                        if (block->written < 0)
+                                op_errno = block->op_errno;
+                }
+
+                dht_migrate_window_wait (&window);
+
+                for (i = 0; i < nwrite; i++) {
+                        block = &writing[i];
+                        if (!op_errno && (block->written != block->op_ret))
+                                op_errno = (block->written < 0) ?
+                                        block->op_errno : EIO;
+                        dht_migrate_block_release (block);
+                }
+
+                for (i = 0; i < nread; i++) {
+                        block = &reading[i];
+                        if (block->op_ret < 0) {
+                                if (!op_errno)
+                                        op_errno = block->op_errno;
+                        } else if (block->op_ret < block->size) {
+                                /* the file got shorter, stop reading */
+                                eof = 1;
+                        }
+                }
+
+                if (op_errno) {
+                        for (i = 0; i < nread; i++)
+                                dht_migrate_block_release (&reading[i]);
+                        ret = -1;
                         break;
                 }
-                offset += ret;
-                total += ret;
 
-                GF_FREE (vector);
-                if (iobref)
-                        iobref_unref (iobref);
-                iobref = NULL;
-                vector = NULL;
+                nwrite = nread;
+                cur = !cur;
         }
-        if (iobref)
-                iobref_unref (iobref);
-        GF_FREE (vector);
 
-        if (ret >= 0)
-                ret = 0;
+        LOCK_DESTROY (&window.lock);
+
+        if (ret < 0)
+                errno = op_errno;
+
+        return ret;
+}
+
+/*
+ * Host and backend path of @loc on @subvol from its pathinfo, if @subvol
+ * is a single brick. Both point into *@host, which the caller frees.
+ */
+static int
+dht_rebalance_brick_path (xlator_t *subvol, loc_t *loc, char **host,
+                          char **path)
+{
+        dict_t *dict     = NULL;
+        char   *pathinfo = NULL;
+        char   *tmp      = NULL;
+        int     ret      = -1;
+
+        ret = syncop_getxattr (subvol, loc, &dict, GF_XATTR_PATHINFO_KEY);
+        if (ret)
+                goto out;
+
+        ret = dict_get_str (dict, GF_XATTR_PATHINFO_KEY, &pathinfo);
+        if (ret)
+                goto out;
+
+        /* <POSIX(brick):host:path> */
+        ret = -1;
+        if (strncmp (pathinfo, "<POSIX(", strlen ("<POSIX(")) ||
+            (pathinfo[strlen (pathinfo) - 1] != '>'))
+                goto out;
+
+        tmp = strstr (pathinfo, "):");
+        if (!tmp)
+                goto out;
+
+        *host = gf_strdup (tmp + 2);
+        if (!*host)
+                goto out;
+        (*host)[strlen (*host) - 1] = '\0';
+
+        tmp = strchr (*host, ':');
+        if (!tmp) {
+                GF_FREE (*host);
+                *host = NULL;
+                goto out;
+        }
+        *tmp = '\0';
+        *path = tmp + 1;
+
+        ret = 0;
+out:
+        if (dict)
+                dict_unref (dict);
+        return ret;
+}
+
+/*
+ * When both bricks are on the same host, have the source brick copy the
+ * data straight into the destination brick's file (copy_file_range or a
+ * reflink) instead of streaming it through this process. Returns 0 when
+ * the data was copied, -1 when it has to be streamed.
+ */
+static int
+dht_rebalance_local_copy (xlator_t *from, xlator_t *to, loc_t *loc,
+                          fd_t *src, fd_t *dst, uint64_t ia_size)
+{
+        xlator_t *this     = NULL;
+        dict_t   *dict     = NULL;
+        char     *src_host = NULL;
+        char     *src_path = NULL;
+        char     *dst_host = NULL;
+        char     *dst_path = NULL;
+        char     *str      = NULL;
+        uint32_t  timeout  = 0;
+        int       ret      = -1;
+
+        this = THIS;
+
+        /* the brick has to be done copying before the request times out,
+           the data is streamed meanwhile otherwise */
+        if (dict_get_str (from->options, "frame-timeout", &str) ||
+            gf_string2time (str, &timeout))
+                timeout = DHT_REBALANCE_FRAME_TIMEOUT;
+        timeout /= 2;
+        if (!timeout)
+                goto out;
+
+        ret = dht_rebalance_brick_path (from, loc, &src_host, &src_path);
+        if (ret)
+                goto out;
+
+        ret = dht_rebalance_brick_path (to, loc, &dst_host, &dst_path);
+        if (ret)
+                goto out;
+
+        ret = -1;
+        if (strcmp (src_host, dst_host))
+                goto out;
+
+        dict = dict_new ();
+        if (!dict)
+                goto out;
+
+        ret = dict_set_str (dict, GF_XATTR_COPY_TO_KEY, dst_path);
+        if (ret)
+                goto out;
+
+        ret = dict_set_int32 (dict, GF_XATTR_COPY_TO_TIMEOUT_KEY, timeout);
+        if (ret)
+                goto out;
+
+        ret = syncop_fsetxattr (from, src, dict, 0);
+        if (ret) {
+                gf_log (this->name, GF_LOG_DEBUG,
+                        "%s: local copy from %s to %s failed (%s), streaming",
+                        loc->path, from->name, to->name, strerror (errno));
+                goto out;
+        }
+
+        /* sets the size when the file ends in a hole, and lets the
+           destination brick account for the data it did not see written */
+        ret = syncop_ftruncate (to, dst, ia_size);
+        if (ret) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "%s: failed to set size on %s (%s)",
+                        loc->path, to->name, strerror (errno));
+                goto out;
+        }
+
+        gf_log (this->name, GF_LOG_INFO, "%s: copied locally from %s to %s",
+                loc->path, from->name, to->name);
+out:
+        if (dict)
+                dict_unref (dict);
+        GF_FREE (src_host);
+        GF_FREE (dst_host);
 
         return ret;
 }
@@ -711,9 +1070,13 @@ dht_migrate_file (xlator_t *this, loc_t *loc, xlator_t *from, xlator_t *to,
         if (stbuf.ia_size > (stbuf.ia_blocks * GF_DISK_SECTOR_SIZE))
                 file_has_holes = 1;
 
-        /* All I/O happens in this function */
-        ret = __dht_rebalance_migrate_data (from, to, src_fd, dst_fd,
-					    stbuf.ia_size, file_has_holes);
+        /* All I/O happens in these functions */
+        ret = dht_rebalance_local_copy (from, to, loc, src_fd, dst_fd,
+                                        stbuf.ia_size);
+        if (ret)
+                ret = __dht_rebalance_migrate_data (from, to, src_fd, dst_fd,
+                                                    stbuf.ia_size,
+                                                    file_has_holes);
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR, "%s: failed to migrate data",
                         loc->path);
@@ -789,6 +789,8 @@ dht_rename (call_frame_t *frame, xlator_t *this,
         VALIDATE_OR_GOTO (oldloc, err);
         VALIDATE_OR_GOTO (newloc, err);
 
+        dht_neg_cache_purge (this, newloc->parent, newloc->name);
+
         src_hashed = dht_subvol_get_hashed (this, oldloc);
         if (!src_hashed) {
                 gf_log (this->name, GF_LOG_INFO,
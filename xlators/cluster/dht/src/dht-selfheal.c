@@ -17,6 +17,8 @@
 #include "glusterfs.h"
 #include "xlator.h"
 #include "dht-common.h"
+#include "byte-order.h"
+#include "hashfn.h"
 
 #define DHT_SET_LAYOUT_RANGE(layout,i,srt,chunk,cnt,path)    do {       \
                 layout->list[i].start = srt;                            \
@@ -117,6 +119,7 @@ dht_selfheal_dir_xattr_persubvol (call_frame_t *frame, loc_t *loc,
         int                ret = 0;
         xlator_t          *this = NULL;
         int32_t           *disk_layout = NULL;
+        uint32_t          *commit_hash = NULL;
         dht_local_t       *local = NULL;
 
 
@@ -155,6 +158,22 @@ dht_selfheal_dir_xattr_persubvol (call_frame_t *frame, loc_t *loc,
         }
         disk_layout = NULL;
 
+        /* always written, so that a rewritten range drops an old stamp */
+        commit_hash = GF_CALLOC (1, sizeof (uint32_t), gf_dht_mt_int32_t);
+        if (!commit_hash)
+                goto err;
+
+        *commit_hash = hton32 (layout->list[i].commit_hash);
+        ret = dict_set_bin (xattr, DHT_COMMITHASH_KEY, commit_hash,
+                            sizeof (uint32_t));
+        if (ret == -1) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "%s: (subvol %s) failed to set commit hash",
+                        loc->path, subvol->name);
+                goto err;
+        }
+        commit_hash = NULL;
+
         gf_log (this->name, GF_LOG_TRACE,
                 "setting hash range %u - %u (type %d) on subvolume %s for %s",
                 layout->list[i].start, layout->list[i].stop,
@@ -178,6 +197,7 @@ err:
                 dict_destroy (xattr);
 
         GF_FREE (disk_layout);
+        GF_FREE (commit_hash);
 
         dht_selfheal_dir_xattr_cbk (frame, subvol, frame->this,
                                     -1, ENOMEM, NULL);
@@ -574,6 +594,16 @@ void dht_selfheal_layout_new_directory (call_frame_t *frame, loc_t *loc,
 void dht_layout_entry_swap (dht_layout_t *layout, int i, int j);
 void dht_layout_range_swap (dht_layout_t *layout, int i, int j);
 
+/* Sizes of equal shares differ by the remainder the last one absorbed */
+static gf_boolean_t
+dht_layout_range_size_match (dht_layout_t *layout, int i, int j)
+{
+        uint32_t a = layout->list[i].stop - layout->list[i].start;
+        uint32_t b = layout->list[j].stop - layout->list[j].start;
+
+        return (((a > b) ? a - b : b - a) < layout->cnt);
+}
+
 /*
  * It's a bit icky using local variables in a macro, but it makes the rest
  * of the code a lot clearer.
@@ -591,6 +621,10 @@ dht_selfheal_layout_maximize_overlap (call_frame_t *frame, loc_t *loc,
 	int           max_overlap_idx = -1;
 	uint32_t      overlap      = 0;
         uint32_t     *table = NULL;
+        gf_boolean_t  weighted = _gf_false;
+
+        /* ranges of different sizes carry different weights */
+        weighted = dht_is_weighted (frame->this);
 
 	dht_layout_sort_volname (old);
 	/* Now both old_layout->list[] and new_layout->list[]
@@ -623,6 +657,9 @@ dht_selfheal_layout_maximize_overlap (call_frame_t *frame, loc_t *loc,
                 max_overlap = 0;
                 max_overlap_idx = i;
                 for (j = (i + 1); j < new->cnt; ++j) {
+                        if (weighted &&
+                            !dht_layout_range_size_match (new, i, j))
+                                continue;
                         /* Calculate the overlap now. */
                         curr_overlap = OV_ENTRY(i,i) + OV_ENTRY(j,j);
                         /* Calculate the overlap after the proposed swap. */
@@ -648,6 +685,8 @@ dht_selfheal_layout_maximize_overlap (call_frame_t *frame, loc_t *loc,
                         }
                 }
 	}
+
+        dht_layout_index_reset (frame->this, new);
 }
 
 
@@ -695,6 +734,14 @@ dht_fix_layout_of_directory (call_frame_t *frame, loc_t *loc,
 			new_layout->list[i].err = -1;
 
 		new_layout->list[i].xlator = layout->list[i].xlator;
+
+                /* ring members keep their points, so only the hashes
+                   taken by new members or freed by leaving ones move */
+                if ((layout->type == DHT_HASH_TYPE_DM_VNODE) &&
+                    !layout->list[i].err && layout->list[i].stop) {
+                        new_layout->type = DHT_HASH_TYPE_DM_VNODE;
+                        new_layout->list[i].start = layout->list[i].start;
+                }
         }
 
 	/* First give it a layout as though it is a new directory. This
@@ -703,7 +750,10 @@ dht_fix_layout_of_directory (call_frame_t *frame, loc_t *loc,
 	dht_selfheal_layout_new_directory (frame, loc, new_layout);
 
 	/* Now selectively re-assign ranges only when it helps */
-	dht_selfheal_layout_maximize_overlap (frame, loc, new_layout, layout);
+        if ((new_layout->type != DHT_HASH_TYPE_DM_VNODE) &&
+            (layout->type != DHT_HASH_TYPE_DM_VNODE))
+                dht_selfheal_layout_maximize_overlap (frame, loc, new_layout,
+                                                      layout);
 
 done:
         if (new_layout) {
@@ -721,26 +771,227 @@ done:
 }
 
 
+/* Ring id of layout->list[pos]: the one it already has, else a hash of the
+   subvolume name, moved on until no other member uses it */
+static uint32_t
+dht_selfheal_vnode_id (dht_layout_t *layout, int pos)
+{
+        uint32_t  id   = 0;
+        char     *name = NULL;
+        int       i    = 0;
+
+        id = layout->list[pos].start;
+        if (!id) {
+                name = layout->list[pos].xlator->name;
+                id = gf_dm_hashfn (name, strlen (name));
+        }
+
+again:
+        if (!id)
+                id = 1;
+
+        for (i = 0; i < layout->cnt; i++) {
+                if ((i != pos) && layout->list[i].stop &&
+                    (layout->list[i].start == id)) {
+                        id++;
+                        goto again;
+                }
+        }
+
+        return id;
+}
+
+
+/* The @cnt available entries getting a share, in allocation order */
+static int
+dht_selfheal_layout_members (dht_layout_t *layout, int start_subvol, int cnt,
+                             int *members)
+{
+        int i = 0;
+        int j = 0;
+        int n = 0;
+
+        for (j = 0; (j < layout->cnt) && (n < cnt); j++) {
+                i = (start_subvol + j) % layout->cnt;
+                if (layout->list[i].err == -1)
+                        members[n++] = i;
+        }
+
+        return n;
+}
+
+
+/* Weights of @members. False when they are all equal, or while the size of
+   one of them is not known; every member then gets the same share */
+static gf_boolean_t
+dht_selfheal_layout_weights (xlator_t *this, dht_layout_t *layout,
+                             int *members, int cnt, double *weights,
+                             double *total)
+{
+        gf_boolean_t  differ = _gf_false;
+        uint64_t      weight = 0;
+        int           j      = 0;
+
+        if (!dht_is_weighted (this))
+                return _gf_false;
+
+        *total = 0;
+
+        for (j = 0; j < cnt; j++) {
+                weight = dht_subvol_weight (this,
+                                            layout->list[members[j]].xlator);
+                if (!weight) {
+                        gf_log (this->name, GF_LOG_DEBUG,
+                                "size of %s not known yet, giving equal "
+                                "shares", layout->list[members[j]].xlator->name);
+                        return _gf_false;
+                }
+
+                weights[j] = weight;
+                *total += weight;
+                if (weights[j] != weights[0])
+                        differ = _gf_true;
+        }
+
+        return differ;
+}
+
+
+static void
+dht_selfheal_layout_new_ring (xlator_t *this, loc_t *loc, dht_layout_t *layout,
+                              int cnt)
+{
+        dht_conf_t   *conf = NULL;
+        gf_boolean_t  keep = _gf_false;
+        gf_boolean_t  weighted = _gf_false;
+        int          *members = NULL;
+        double       *weights = NULL;
+        double        total = 0;
+        double        vnodes = 0;
+        int           start_subvol = 0;
+        int           i = 0;
+        int           j = 0;
+        int           n = 0;
+
+        conf = this->private;
+
+        keep = (layout->type == DHT_HASH_TYPE_DM_VNODE);
+        layout->type = DHT_HASH_TYPE_DM_VNODE;
+
+        for (i = 0; i < layout->cnt; i++) {
+                if (layout->list[i].err != -1)
+                        continue;
+                if (!keep)
+                        layout->list[i].start = 0;
+                layout->list[i].stop = 0;
+        }
+
+        start_subvol = dht_selfheal_layout_alloc_start (this, loc, layout);
+
+        members = alloca (layout->cnt * sizeof (*members));
+        weights = alloca (layout->cnt * sizeof (*weights));
+        n = dht_selfheal_layout_members (layout, start_subvol, cnt, members);
+
+        for (j = 0; j < n; j++) {
+                i = members[j];
+                layout->list[i].start = dht_selfheal_vnode_id (layout, i);
+                layout->list[i].stop  = conf->layout_vnodes;
+        }
+
+        /* a heavier member gets more points, the average stays the same */
+        weighted = dht_selfheal_layout_weights (this, layout, members, n,
+                                                weights, &total);
+
+        for (j = 0; j < n; j++) {
+                i = members[j];
+                if (weighted) {
+                        vnodes = (conf->layout_vnodes * weights[j] * n /
+                                  total) + 0.5;
+                        if (vnodes < 1)
+                                vnodes = 1;
+                        if (vnodes > DHT_LAYOUT_VNODES_MAX)
+                                vnodes = DHT_LAYOUT_VNODES_MAX;
+                        layout->list[i].stop = vnodes;
+                }
+
+                gf_log (this->name, GF_LOG_TRACE,
+                        "gave fix: %u vnodes at ring id %u on %s for %s",
+                        layout->list[i].stop, layout->list[i].start,
+                        layout->list[i].xlator->name, loc->path);
+        }
+
+        /* left out by subvols-per-directory */
+        for (i = 0; i < layout->cnt; i++) {
+                if ((layout->list[i].err == -1) && !layout->list[i].stop)
+                        layout->list[i].start = 0;
+        }
+}
+
+
 void
 dht_selfheal_layout_new_directory (call_frame_t *frame, loc_t *loc,
                                    dht_layout_t *layout)
 {
         xlator_t    *this = NULL;
+        dht_conf_t  *conf = NULL;
         uint32_t     chunk = 0;
         int          i = 0;
+        int          j = 0;
+        int          n = 0;
         uint32_t     start = 0;
         int          cnt = 0;
         int          err = 0;
         int          start_subvol = 0;
+        int         *members = NULL;
+        double      *weights = NULL;
+        double       total = 0;
 
         this = frame->this;
+        conf = this->private;
 
         cnt = dht_get_layout_count (this, layout, 1);
 
+        if (conf->layout_vnodes &&
+            (layout->type != DHT_HASH_TYPE_DM_USER)) {
+                dht_selfheal_layout_new_ring (this, loc, layout, cnt);
+                goto done;
+        }
+
+        /* ring ids and vnode counts are no ranges */
+        if (layout->type == DHT_HASH_TYPE_DM_VNODE) {
+                layout->type = DHT_HASH_TYPE_DM;
+                for (i = 0; i < layout->cnt; i++) {
+                        if (layout->list[i].err == -1) {
+                                layout->list[i].start = 0;
+                                layout->list[i].stop  = 0;
+                        }
+                }
+        }
+
         chunk = ((unsigned long) 0xffffffff) / ((cnt) ? cnt : 1);
 
         start_subvol = dht_selfheal_layout_alloc_start (this, loc, layout);
 
+        /* ranges in proportion to the weights, the last one absorbing
+           what rounding left over */
+        members = alloca (layout->cnt * sizeof (*members));
+        weights = alloca (layout->cnt * sizeof (*weights));
+        n = dht_selfheal_layout_members (layout, start_subvol, cnt, members);
+
+        if (dht_selfheal_layout_weights (this, layout, members, n, weights,
+                                         &total)) {
+                for (j = 0; j < n; j++) {
+                        chunk = (uint32_t) (4294967295.0 * weights[j] / total);
+                        if (!chunk)
+                                chunk = 1;
+                        DHT_SET_LAYOUT_RANGE(layout, members[j], start, chunk,
+                                             n, loc->path);
+                        start += chunk;
+                }
+                layout->list[members[n - 1]].stop = 0xffffffff;
+                goto done;
+        }
+
         for (i = start_subvol; i < layout->cnt; i++) {
                 err = layout->list[i].err;
                 if (err == -1) {
@@ -768,6 +1019,7 @@ dht_selfheal_layout_new_directory (call_frame_t *frame, loc_t *loc,
         }
 
 done:
+        dht_layout_index_reset (this, layout);
         return;
 }
 
@@ -818,6 +1070,10 @@ dht_selfheal_new_directory (call_frame_t *frame,
 
         dht_layout_sort_volname (layout);
         dht_selfheal_layout_new_directory (frame, &local->loc, layout);
+
+        /* nothing can be misplaced in a directory that was just created */
+        dht_layout_commit (frame->this, layout);
+
         dht_selfheal_dir_xattr (frame, &local->loc, layout);
         return 0;
 }
@@ -217,6 +217,8 @@ fini (xlator_t *this)
 
                 GF_FREE (conf->subvolume_status);
 
+                GF_FREE (conf->subvol_weights);
+
                 GF_FREE (conf);
         }
 out:
@@ -284,6 +286,73 @@ out:
         return ret;
 }
 
+/* "subvol:weight,..." into conf->subvol_weights, NULL clears them */
+int
+dht_parse_subvol_weights (xlator_t *this, dht_conf_t *conf,
+                          const char *weights)
+{
+        int         i       = 0;
+        int         ret     = -1;
+        char       *tmpstr  = NULL;
+        char       *dup_str = NULL;
+        char       *node    = NULL;
+        char       *colon   = NULL;
+        uint32_t    weight  = 0;
+        uint32_t   *table   = NULL;
+        uint32_t   *old     = NULL;
+
+        if (!conf)
+                goto out;
+
+        if (weights) {
+                table = GF_CALLOC (conf->subvolume_cnt, sizeof (*table),
+                                   gf_dht_mt_int32_t);
+                if (!table)
+                        goto out;
+
+                dup_str = gf_strdup (weights);
+                node = strtok_r (dup_str, ",", &tmpstr);
+                while (node) {
+                        colon = strrchr (node, ':');
+                        if (!colon || gf_string2uint32 (colon + 1, &weight) ||
+                            !weight) {
+                                gf_log (this->name, GF_LOG_ERROR,
+                                        "invalid subvolume weight %s", node);
+                                goto out;
+                        }
+                        *colon = '\0';
+
+                        for (i = 0; i < conf->subvolume_cnt; i++) {
+                                if (!strcmp (conf->subvolumes[i]->name, node)) {
+                                        table[i] = weight;
+                                        break;
+                                }
+                        }
+                        if (i == conf->subvolume_cnt) {
+                                gf_log (this->name, GF_LOG_ERROR,
+                                        "no subvolume %s to weigh", node);
+                                goto out;
+                        }
+                        node = strtok_r (NULL, ",", &tmpstr);
+                }
+        }
+
+        LOCK (&conf->subvolume_lock);
+        {
+                old = conf->subvol_weights;
+                conf->subvol_weights = table;
+        }
+        UNLOCK (&conf->subvolume_lock);
+
+        table = old;
+        ret = 0;
+out:
+        GF_FREE (table);
+        GF_FREE (dup_str);
+
+        return ret;
+}
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
@@ -338,6 +407,16 @@ reconfigure (xlator_t *this, dict_t *options)
 
         GF_OPTION_RECONF ("readdir-optimize", conf->readdir_optimize, options,
                           bool, out);
+        GF_OPTION_RECONF ("readdir-parallel", conf->readdir_parallel, options,
+                          bool, out);
+        GF_OPTION_RECONF ("lookup-optimize", conf->lookup_optimize, options,
+                          bool, out);
+        GF_OPTION_RECONF ("negative-lookup-timeout", conf->neg_timeout,
+                          options, uint32, out);
+        GF_OPTION_RECONF ("layout-vnodes", conf->layout_vnodes, options,
+                          uint32, out);
+        GF_OPTION_RECONF ("weighted-rebalance", conf->do_weighting, options,
+                          bool, out);
         if (conf->defrag) {
                 GF_OPTION_RECONF ("rebalance-stats", conf->defrag->stats,
                                   options, bool, out);
@@ -349,6 +428,12 @@ reconfigure (xlator_t *this, dict_t *options)
                         goto out;
         }
 
+        if (dict_get_str (options, "subvol-weights", &temp_str) != 0)
+                temp_str = NULL;
+        ret = dht_parse_subvol_weights (this, conf, temp_str);
+        if (ret == -1)
+                goto out;
+
         ret = 0;
 out:
         return ret;
@@ -446,6 +531,17 @@ init (xlator_t *this)
 
         GF_OPTION_INIT ("readdir-optimize", conf->readdir_optimize, bool, err);
 
+        GF_OPTION_INIT ("readdir-parallel", conf->readdir_parallel, bool, err);
+
+        GF_OPTION_INIT ("lookup-optimize", conf->lookup_optimize, bool, err);
+
+        GF_OPTION_INIT ("negative-lookup-timeout", conf->neg_timeout, uint32,
+                        err);
+
+        GF_OPTION_INIT ("layout-vnodes", conf->layout_vnodes, uint32, err);
+
+        GF_OPTION_INIT ("weighted-rebalance", conf->do_weighting, bool, err);
+
         if (defrag) {
                 GF_OPTION_INIT ("rebalance-stats", defrag->stats, bool, err);
         }
@@ -473,6 +569,13 @@ init (xlator_t *this)
 
         LOCK_INIT (&conf->subvolume_lock);
         LOCK_INIT (&conf->layout_lock);
+        INIT_LIST_HEAD (&conf->layout_rings);
+
+        if (dict_get_str (this->options, "subvol-weights", &temp_str) == 0) {
+                ret = dht_parse_subvol_weights (this, conf, temp_str);
+                if (ret == -1)
+                        goto err;
+        }
 
         conf->gen = 1;
 
@@ -502,6 +605,8 @@ err:
 
                 GF_FREE (conf->du_stats);
 
+                GF_FREE (conf->subvol_weights);
+
                 GF_FREE (conf->defrag);
 
                 GF_FREE (conf);
@@ -567,7 +672,7 @@ struct xlator_dumpops dumpops = {
 
 struct xlator_cbks cbks = {
 //      .release    = dht_release,
-//      .releasedir = dht_releasedir,
+        .releasedir = dht_releasedir,
         .forget     = dht_forget
 };
 
@@ -643,6 +748,57 @@ struct volume_options options[] = {
           "that allows DHT to requests non-first subvolumes to filter out "
           "directory entries."
         },
+        { .key = {"readdir-parallel"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "This option if set to ON makes readdirp read "
+          "ahead one chunk from every subvolume concurrently and serve them "
+          "in order, so that listing a directory takes as long as the "
+          "slowest subvolume rather than the sum of all of them."
+        },
+        { .key = {"lookup-optimize"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "This option if set to ON trusts a miss on the "
+          "hashed subvolume for directories whose layout was committed, "
+          "instead of looking the name up on every subvolume. Layouts are "
+          "committed when a directory is created, and lose it when "
+          "rebalance or self-heal rewrites them or subvolumes are added or "
+          "removed."
+        },
+        { .key = {"negative-lookup-timeout"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 3600,
+          .default_value = "0",
+          .description = "Number of seconds a name found missing is "
+          "remembered by its directory, answering further lookups of it "
+          "without going to the subvolumes. 0 disables the cache."
+        },
+        { .key = {"layout-vnodes"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = DHT_LAYOUT_VNODES_MAX,
+          .default_value = "0",
+          .description = "Number of points every subvolume gets on a hash "
+          "ring in directory layouts written from now on, instead of one "
+          "contiguous hash range. Adding a subvolume then only moves the "
+          "files its points take over. 0 keeps the contiguous layouts, "
+          "which clients without ring support require."
+        },
+        { .key = {"weighted-rebalance"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "Size the share of the hash space each subvolume "
+          "gets in directory layouts written from now on by its capacity, "
+          "so that bricks of different sizes fill up evenly."
+        },
+        { .key = {"subvol-weights"},
+          .type = GF_OPTION_TYPE_STR,
+          .description = "Explicit layout weights as a comma separated list "
+          "of subvolume:weight pairs, taking precedence over "
+          "weighted-rebalance. Subvolumes not listed weigh 1."
+        },
 
         { .key  = {NULL} },
 };
@@ -571,6 +571,7 @@ init (xlator_t *this)
 
         LOCK_INIT (&conf->subvolume_lock);
         LOCK_INIT (&conf->layout_lock);
+        INIT_LIST_HEAD (&conf->layout_rings);
 
         conf->gen = 1;
 
@@ -746,6 +747,7 @@ struct xlator_fops fops = {
 
 
 struct xlator_cbks cbks = {
+        .releasedir = dht_releasedir,
         .forget     = dht_forget
 };
 
@@ -35,6 +35,11 @@ stripe_local_wipe (stripe_local_t *local)
         if (local->xdata)
                 dict_unref (local->xdata);
 
+        if (local->iobref)
+                iobref_unref (local->iobref);
+
+        GF_FREE (local->vector);
+
 out:
         return;
 }
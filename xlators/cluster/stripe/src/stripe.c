@@ -32,6 +32,11 @@
 
 struct volume_options options[];
 
+static int stripe_readv_wind (call_frame_t *frame, xlator_t *this,
+                              int32_t sub);
+static int stripe_writev_wind (call_frame_t *frame, xlator_t *this,
+                               int32_t sub);
+
 int32_t
 stripe_sh_chown_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                      int32_t op_ret, int32_t op_errno,
@@ -3176,6 +3181,153 @@ err:
 }
 
 
+/*
+ * Account a subrequest wound to (@wind) or returned from @subvol in the
+ * per-subvolume I/O statistics shown in the statedump.
+ */
+static void
+stripe_io_account (xlator_t *this, xlator_t *subvol, int wind, int write,
+                   size_t size)
+{
+        stripe_private_t  *priv = NULL;
+        stripe_io_stats_t *stats = NULL;
+        int                i = 0;
+
+        priv = this->private;
+
+        for (i = 0; i < priv->child_count; i++) {
+                if (priv->xl_array[i] == subvol) {
+                        stats = &priv->io_stats[i];
+                        break;
+                }
+        }
+        if (!stats)
+                return;
+
+        LOCK (&priv->lock);
+        {
+                if (!wind) {
+                        stats->inflight--;
+                        goto unlock;
+                }
+
+                if (++stats->inflight > stats->peak_inflight)
+                        stats->peak_inflight = stats->inflight;
+                if (write) {
+                        stats->writes++;
+                        stats->write_bytes += size;
+                } else {
+                        stats->reads++;
+                        stats->read_bytes += size;
+                }
+        }
+unlock:
+        UNLOCK (&priv->lock);
+}
+
+/*
+ * Byte range [*start, *end) of the file covered by the @chunk'th stripe
+ * unit of an I/O of @size bytes at @offset.
+ */
+static void
+stripe_io_chunk (stripe_local_t *local, int32_t chunk, off_t *start,
+                 off_t *end)
+{
+        off_t base = 0;
+
+        base = floor (local->offset, local->stripe_size) +
+                chunk * local->stripe_size;
+
+        *start = max (base, local->offset);
+        *end   = min (base + local->stripe_size,
+                      local->offset + (off_t) local->io_size);
+}
+
+/*
+ * Split an I/O of @chunks stripe units into subrequests. Without coalesce
+ * every unit is a subrequest of its own. With coalesce the units a
+ * subvolume holds are contiguous on its brick, so they are all sent as
+ * one subrequest: subrequest @s covers the units s, s + sub_step, ...
+ * Returns the number of subrequests to wind straight away, the rest are
+ * wound as earlier ones complete.
+ */
+static int32_t
+stripe_io_plan (xlator_t *this, stripe_local_t *local, int32_t chunks)
+{
+        stripe_private_t *priv = NULL;
+
+        priv = this->private;
+
+        local->wind_count = chunks;
+        local->sub_step   = chunks;
+        if (local->fctx->stripe_coalesce)
+                local->sub_step = min (chunks, local->fctx->stripe_count);
+        local->sub_count  = local->sub_step;
+        local->sub_next   = min (local->sub_count, priv->io_depth);
+
+        return local->sub_next;
+}
+
+/*
+ * A subrequest of @frame is done, either replied to or failed to wind.
+ * Wind the next pending one, and return 1 when all of them are done.
+ */
+static int
+stripe_io_next (call_frame_t *frame, xlator_t *this,
+                int (*wind) (call_frame_t *frame, xlator_t *this,
+                             int32_t sub))
+{
+        stripe_local_t *local = NULL;
+        int32_t         sub = -1;
+        int             finished = 0;
+
+        local = frame->local;
+
+        for (;;) {
+                LOCK (&frame->lock);
+                {
+                        finished = (++local->sub_done == local->sub_count);
+                        sub = -1;
+                        if (local->sub_next < local->sub_count)
+                                sub = local->sub_next++;
+                }
+                UNLOCK (&frame->lock);
+
+                /* a failed wind counts as done too */
+                if ((sub < 0) || !wind (frame, this, sub))
+                        break;
+        }
+
+        return finished;
+}
+
+/*
+ * Fail the stripe units of subrequest @sub with @op_errno.
+ */
+static void
+stripe_io_fail (call_frame_t *frame, int32_t sub, int32_t op_errno)
+{
+        stripe_local_t *local = NULL;
+        int32_t         chunk = 0;
+        off_t           start = 0;
+        off_t           end = 0;
+
+        local = frame->local;
+
+        LOCK (&frame->lock);
+        {
+                for (chunk = sub; chunk < local->wind_count;
+                     chunk += local->sub_step) {
+                        stripe_io_chunk (local, chunk, &start, &end);
+                        local->replies[chunk].op_ret = -1;
+                        local->replies[chunk].op_errno = op_errno;
+                        local->replies[chunk].requested_size = end - start;
+                }
+        }
+        UNLOCK (&frame->lock);
+}
+
+
 int32_t
 stripe_readv_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         int32_t op_ret, int32_t op_errno, struct iatt *buf, dict_t *xdata)
@@ -3186,7 +3338,6 @@ stripe_readv_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         stripe_local_t *local = NULL;
         struct iovec   *vec = NULL;
         struct iatt     tmp_stbuf = {0,};
-        struct iobref  *tmp_iobref = NULL;
         struct iobuf   *iobuf = NULL;
 	call_frame_t   *prev = NULL;
 
@@ -3212,9 +3363,11 @@ stripe_readv_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (!callcnt) {
                 op_ret = 0;
 
-                /* Keep extra space for filling in '\0's */
-                vec = GF_CALLOC ((local->count * 2), sizeof (struct iovec),
-                                 gf_stripe_mt_iovec);
+                /* Keep extra space for filling in '\0's, one per unit: a
+                 * unit that read nothing (a hole or past EOF) brought no
+                 * iovec along but may still need one of zeroes */
+                vec = GF_CALLOC ((local->count + local->wind_count),
+                                 sizeof (struct iovec), gf_stripe_mt_iovec);
                 if (!vec) {
                         op_ret = -1;
                         goto done;
@@ -3264,11 +3417,9 @@ stripe_readv_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         done:
                 GF_FREE (local->replies);
-                tmp_iobref = local->iobref;
                 STRIPE_STACK_UNWIND (readv, frame, op_ret, op_errno, vec,
-                                     count, &tmp_stbuf, tmp_iobref, NULL);
+                                     count, &tmp_stbuf, local->iobref, NULL);
 
-                iobref_unref (tmp_iobref);
                 GF_FREE (vec);
         }
 out:
@@ -3276,26 +3427,117 @@ out:
 }
 
 /**
- * stripe_readv_cbk - get all the striped reads, and order it properly, send it
- *        to above layer after putting it in a single vector.
+ * stripe_readv_unwind - all the striped reads are back, put them in a single
+ *        vector in file order and send it to the above layer. Only the
+ *        iovecs are copied, the data stays in the iobufs of the replies.
  */
-int32_t
-stripe_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
-                  int32_t op_ret, int32_t op_errno, struct iovec *vector,
-                  int32_t count, struct iatt *stbuf, struct iobref *iobref, dict_t *xdata)
+static void
+stripe_readv_unwind (call_frame_t *frame, xlator_t *this)
 {
         int32_t         index = 0;
-        int32_t         callcnt = 0;
+        int32_t         op_ret = 0;
+        int32_t         op_errno = 0;
         int32_t         final_count = 0;
         int32_t         need_to_check_proper_size = 0;
-        call_frame_t   *mframe = NULL;
-        stripe_local_t *mlocal = NULL;
         stripe_local_t *local = NULL;
         struct iovec   *final_vec = NULL;
         struct iatt     tmp_stbuf = {0,};
         struct iatt    *tmp_stbuf_p = NULL; //need it for a warning
-        struct iobref  *tmp_iobref = NULL;
         stripe_fd_ctx_t  *fctx = NULL;
+
+        local = frame->local;
+        fctx = local->fctx;
+
+        for (index = 0; index < local->wind_count; index++) {
+                /* check whether each stripe returned
+                 * 'expected' number of bytes */
+                if (local->replies[index].op_ret == -1) {
+                        op_ret = -1;
+                        op_errno = local->replies[index].op_errno;
+                        break;
+                }
+                /* TODO: handle the 'holes' within the read range
+                   properly */
+                if (local->replies[index].op_ret <
+                    local->replies[index].requested_size) {
+                        need_to_check_proper_size = 1;
+                }
+
+                op_ret       += local->replies[index].op_ret;
+                local->count += local->replies[index].count;
+        }
+        if (op_ret == -1)
+                goto done;
+        if (need_to_check_proper_size)
+                goto check_size;
+
+        final_vec = GF_CALLOC (local->count ? local->count : 1,
+                               sizeof (struct iovec), gf_stripe_mt_iovec);
+
+        if (!final_vec) {
+                op_ret = -1;
+                op_errno = ENOMEM;
+                goto done;
+        }
+
+        for (index = 0; index < local->wind_count; index++) {
+                memcpy ((final_vec + final_count),
+                        local->replies[index].vector,
+                        (local->replies[index].count *
+                         sizeof (struct iovec)));
+                final_count +=  local->replies[index].count;
+        }
+
+        /* FIXME: notice that st_ino, and st_dev (gen) will be
+         * different than what inode will have. Make sure this doesn't
+         * cause any bugs at higher levels */
+        memcpy (&tmp_stbuf, &local->replies[0].stbuf,
+                sizeof (struct iatt));
+        tmp_stbuf.ia_size = local->stbuf_size;
+        tmp_stbuf.ia_blocks = local->stbuf_blocks;
+
+done:
+        for (index = 0; index < local->wind_count; index++)
+                GF_FREE (local->replies[index].vector);
+        GF_FREE (local->replies);
+        /* work around for nfs truncated read. Bug 3774 */
+        tmp_stbuf_p = &tmp_stbuf;
+        WIPE (tmp_stbuf_p);
+        STRIPE_STACK_UNWIND (readv, frame, op_ret, op_errno, final_vec,
+                             final_count, &tmp_stbuf, local->iobref, NULL);
+
+        GF_FREE (final_vec);
+        return;
+
+check_size:
+        local->call_count = fctx->stripe_count;
+
+        for (index = 0; index < fctx->stripe_count; index++) {
+                STACK_WIND (frame, stripe_readv_fstat_cbk,
+                            (fctx->xl_array[index]),
+                            (fctx->xl_array[index])->fops->fstat,
+                            local->fd, NULL);
+        }
+}
+
+/**
+ * stripe_readv_cbk - a subrequest is back. Its data is handed out to the
+ *        stripe units it covers, in order.
+ */
+int32_t
+stripe_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                  int32_t op_ret, int32_t op_errno, struct iovec *vector,
+                  int32_t count, struct iatt *stbuf, struct iobref *iobref, dict_t *xdata)
+{
+        int32_t         chunk = 0;
+        int32_t         sub = 0;
+        off_t           start = 0;
+        off_t           end = 0;
+        off_t           done = 0;
+        call_frame_t   *mframe = NULL;
+        stripe_local_t *mlocal = NULL;
+        stripe_local_t *local = NULL;
+        struct stripe_replies *reply = NULL;
 	call_frame_t	*prev = NULL;
 
         if (!this || !frame || !frame->local || !cookie) {
@@ -3304,7 +3546,7 @@ stripe_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         local  = frame->local;
-        index  = local->node_index;
+        sub    = local->node_index;
 	prev = cookie;
         mframe = local->orig_frame;
         if (!mframe)
@@ -3314,113 +3556,127 @@ stripe_readv_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         if (!mlocal)
                 goto out;
 
-        fctx = mlocal->fctx;
+        stripe_io_account (this, prev->this, 0, 0, 0);
 
         LOCK (&mframe->lock);
         {
-                mlocal->replies[index].op_ret = op_ret;
-                mlocal->replies[index].op_errno = op_errno;
-                mlocal->replies[index].requested_size = local->readv_size;
                 if (op_ret >= 0) {
-                        mlocal->replies[index].stbuf  = *stbuf;
-                        mlocal->replies[index].count  = count;
-                        mlocal->replies[index].vector = iov_dup (vector, count);
-
-			correct_file_size(stbuf, fctx, prev);
+			correct_file_size(stbuf, mlocal->fctx, prev);
 
-                        if (local->stbuf_size < stbuf->ia_size)
-                                local->stbuf_size = stbuf->ia_size;
-                        local->stbuf_blocks += stbuf->ia_blocks;
+                        if (mlocal->stbuf_size < stbuf->ia_size)
+                                mlocal->stbuf_size = stbuf->ia_size;
+                        mlocal->stbuf_blocks += stbuf->ia_blocks;
 
-                        if (!mlocal->iobref)
-                                mlocal->iobref = iobref_new ();
                         iobref_merge (mlocal->iobref, iobref);
                 }
-                callcnt = ++mlocal->call_count;
+
+                for (chunk = sub; chunk < mlocal->wind_count;
+                     chunk += mlocal->sub_step) {
+                        reply = &mlocal->replies[chunk];
+                        stripe_io_chunk (mlocal, chunk, &start, &end);
+
+                        reply->op_ret = op_ret;
+                        reply->op_errno = op_errno;
+                        reply->requested_size = end - start;
+                        if (op_ret < 0)
+                                continue;
+
+                        /* a short read leaves the later units short too */
+                        reply->op_ret = max (min (op_ret - done, end - start),
+                                             0);
+                        reply->stbuf  = *stbuf;
+                        if (!reply->op_ret)
+                                continue;
+
+                        reply->count  = iov_subset (vector, count, done,
+                                                    done + reply->op_ret, NULL);
+                        reply->vector = GF_CALLOC (reply->count,
+                                                   sizeof (struct iovec),
+                                                   gf_stripe_mt_iovec);
+                        if (!reply->vector) {
+                                reply->op_ret = -1;
+                                reply->op_errno = ENOMEM;
+                                reply->count = 0;
+                                continue;
+                        }
+                        iov_subset (vector, count, done, done + reply->op_ret,
+                                    reply->vector);
+                        done += reply->op_ret;
+                }
         }
         UNLOCK(&mframe->lock);
 
-        if (callcnt == mlocal->wind_count) {
-                op_ret = 0;
+        if (stripe_io_next (mframe, this, stripe_readv_wind))
+                stripe_readv_unwind (mframe, this);
 
-                for (index=0; index < mlocal->wind_count; index++) {
-                        /* check whether each stripe returned
-                         * 'expected' number of bytes */
-                        if (mlocal->replies[index].op_ret == -1) {
-                                op_ret = -1;
-                                op_errno = mlocal->replies[index].op_errno;
-                                break;
-                        }
-                        /* TODO: handle the 'holes' within the read range
-                           properly */
-                        if (mlocal->replies[index].op_ret <
-                            mlocal->replies[index].requested_size) {
-                                need_to_check_proper_size = 1;
-                        }
+out:
+        STRIPE_STACK_DESTROY (frame);
+end:
+        return 0;
+}
 
-                        op_ret       += mlocal->replies[index].op_ret;
-                        mlocal->count += mlocal->replies[index].count;
-                }
-                if (op_ret == -1)
-                        goto done;
-                if (need_to_check_proper_size)
-                        goto check_size;
+/*
+ * Wind subrequest @sub of the read in @frame. Returns 0 once wound, or -1
+ * after failing its stripe units.
+ */
+static int
+stripe_readv_wind (call_frame_t *frame, xlator_t *this, int32_t sub)
+{
+        stripe_local_t   *local = NULL;
+        stripe_local_t   *rlocal = NULL;
+        stripe_fd_ctx_t  *fctx = NULL;
+        call_frame_t     *rframe = NULL;
+        xlator_t         *subvol = NULL;
+        int32_t           chunk = 0;
+        off_t             start = 0;
+        off_t             end = 0;
+        off_t             dest_offset = 0;
+        size_t            size = 0;
 
-                final_vec = GF_CALLOC (mlocal->count, sizeof (struct iovec),
-                                       gf_stripe_mt_iovec);
+        local = frame->local;
+        fctx  = local->fctx;
 
-                if (!final_vec) {
-                        op_ret = -1;
-                        goto done;
-                }
+        rframe = copy_frame (frame);
+        if (!rframe)
+                goto err;
 
-                for (index = 0; index < mlocal->wind_count; index++) {
-                        memcpy ((final_vec + final_count),
-                                mlocal->replies[index].vector,
-                                (mlocal->replies[index].count *
-                                 sizeof (struct iovec)));
-                        final_count +=  mlocal->replies[index].count;
-                        GF_FREE (mlocal->replies[index].vector);
-                }
+        rlocal = mem_get0 (this->local_pool);
+        if (!rlocal)
+                goto err;
 
-                /* FIXME: notice that st_ino, and st_dev (gen) will be
-                 * different than what inode will have. Make sure this doesn't
-                 * cause any bugs at higher levels */
-                memcpy (&tmp_stbuf, &mlocal->replies[0].stbuf,
-                        sizeof (struct iatt));
-                tmp_stbuf.ia_size = local->stbuf_size;
-                tmp_stbuf.ia_blocks = local->stbuf_blocks;
+        for (chunk = sub; chunk < local->wind_count;
+             chunk += local->sub_step) {
+                stripe_io_chunk (local, chunk, &start, &end);
+                size += end - start;
+        }
 
-        done:
-                /* */
-                GF_FREE (mlocal->replies);
-                tmp_iobref = mlocal->iobref;
-                /* work around for nfs truncated read. Bug 3774 */
-                tmp_stbuf_p = &tmp_stbuf;
-                WIPE (tmp_stbuf_p);
-                STRIPE_STACK_UNWIND (readv, mframe, op_ret, op_errno, final_vec,
-                                     final_count, &tmp_stbuf, tmp_iobref, NULL);
+        stripe_io_chunk (local, sub, &start, &end);
+        subvol = fctx->xl_array[(start / local->stripe_size) %
+                                fctx->stripe_count];
 
-                iobref_unref (tmp_iobref);
-                GF_FREE (final_vec);
-        }
+        if (fctx->stripe_coalesce)
+                dest_offset = coalesced_offset (start, local->stripe_size,
+                                                fctx->stripe_count);
+        else
+                dest_offset = start;
 
-        goto out;
+        rlocal->node_index = sub;
+        rlocal->orig_frame = frame;
+        rlocal->readv_size = size;
+        rframe->local = rlocal;
 
-check_size:
-        mlocal->call_count = fctx->stripe_count;
+        stripe_io_account (this, subvol, 1, 0, size);
 
-        for (index = 0; index < fctx->stripe_count; index++) {
-                STACK_WIND (mframe, stripe_readv_fstat_cbk,
-                            (fctx->xl_array[index]),
-                            (fctx->xl_array[index])->fops->fstat,
-                            mlocal->fd, NULL);
-        }
+        STACK_WIND (rframe, stripe_readv_cbk, subvol, subvol->fops->readv,
+                    local->fd, size, dest_offset, local->flags, local->xdata);
 
-out:
-        STRIPE_STACK_DESTROY (frame);
-end:
         return 0;
+err:
+        if (rframe)
+                STACK_DESTROY (rframe->root);
+
+        stripe_io_fail (frame, sub, ENOMEM);
+        return -1;
 }
 
 
@@ -3429,20 +3685,14 @@ stripe_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
               size_t size, off_t offset, uint32_t flags, dict_t *xdata)
 {
         int32_t           op_errno = EINVAL;
-        int32_t           idx = 0;
         int32_t           index = 0;
         int32_t           num_stripe = 0;
-        int32_t           off_index = 0;
-        size_t            frame_size = 0;
+        int32_t           depth = 0;
         off_t             rounded_end = 0;
         uint64_t          tmp_fctx = 0;
         uint64_t          stripe_size = 0;
         off_t             rounded_start = 0;
-        off_t             frame_offset = offset;
-	off_t		  dest_offset = 0;
         stripe_local_t   *local = NULL;
-        call_frame_t     *rframe = NULL;
-        stripe_local_t   *rlocal = NULL;
         stripe_fd_ctx_t  *fctx = NULL;
 
         VALIDATE_OR_GOTO (frame, err);
@@ -3472,7 +3722,7 @@ stripe_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
          */
         rounded_start = floor (offset, stripe_size);
         rounded_end = roof (offset+size, stripe_size);
-        num_stripe = (rounded_end- rounded_start)/stripe_size;
+        num_stripe = max ((rounded_end- rounded_start)/stripe_size, 1);
 
         local = mem_get0 (this->local_pool);
         if (!local) {
@@ -3484,70 +3734,105 @@ stripe_readv (call_frame_t *frame, xlator_t *this, fd_t *fd,
         /* This is where all the vectors should be copied. */
         local->replies = GF_CALLOC (num_stripe, sizeof (struct stripe_replies),
                                     gf_stripe_mt_stripe_replies);
-        if (!local->replies) {
+        local->iobref = iobref_new ();
+        if (!local->replies || !local->iobref) {
                 op_errno = ENOMEM;
                 goto err;
         }
 
-        off_index = (offset / stripe_size) % fctx->stripe_count;
-        local->wind_count = num_stripe;
-        local->readv_size = size;
-        local->offset     = offset;
-        local->fd         = fd_ref (fd);
-        local->fctx       = fctx;
-
-        for (index = off_index; index < (num_stripe + off_index); index++) {
-                rframe = copy_frame (frame);
-                rlocal = mem_get0 (this->local_pool);
-                if (!rlocal) {
-                        op_errno = ENOMEM;
-                        goto err;
-                }
-
-                frame_size = min (roof (frame_offset+1, stripe_size),
-                                  (offset + size)) - frame_offset;
-
-                rlocal->node_index = index - off_index;
-                rlocal->orig_frame = frame;
-                rlocal->readv_size = frame_size;
-                rframe->local = rlocal;
-                idx = (index % fctx->stripe_count);
-
-		if (fctx->stripe_coalesce)
-			dest_offset = coalesced_offset(frame_offset,
-				stripe_size, fctx->stripe_count);
-		else
-			dest_offset = frame_offset;
+        local->readv_size  = size;
+        local->io_size     = size;
+        local->offset      = offset;
+        local->stripe_size = stripe_size;
+        local->flags       = flags;
+        local->fd          = fd_ref (fd);
+        local->fctx        = fctx;
+        if (xdata)
+                local->xdata = dict_ref (xdata);
 
-                STACK_WIND (rframe, stripe_readv_cbk, fctx->xl_array[idx],
-                            fctx->xl_array[idx]->fops->readv,
-                            fd, frame_size, dest_offset, flags, xdata);
+        depth = stripe_io_plan (this, local, num_stripe);
 
-                frame_offset += frame_size;
+        /* replies can only complete the read once the last of these is
+           wound, so local stays valid throughout the loop */
+        for (index = 0; index < depth; index++) {
+                if (stripe_readv_wind (frame, this, index) &&
+                    stripe_io_next (frame, this, stripe_readv_wind))
+                        stripe_readv_unwind (frame, this);
         }
 
         return 0;
 err:
-        if (rframe)
-                STRIPE_STACK_DESTROY (rframe);
+        if (local)
+                GF_FREE (local->replies);
 
         STRIPE_STACK_UNWIND (readv, frame, -1, op_errno, NULL, 0, NULL, NULL, NULL);
         return 0;
 }
 
 
+/*
+ * All the striped writes are back.
+ */
+static void
+stripe_writev_unwind (call_frame_t *frame, xlator_t *this)
+{
+        stripe_local_t        *local = NULL;
+	struct stripe_replies *reply = NULL;
+	int32_t		       i = 0;
+
+        local = frame->local;
+
+	local->pre_buf.ia_size = local->prebuf_size;
+	local->pre_buf.ia_blocks = local->prebuf_blocks;
+	local->post_buf.ia_size = local->postbuf_size;
+	local->post_buf.ia_blocks = local->postbuf_blocks;
+
+	/*
+	 * Only return the number of consecutively written bytes up until
+	 * the first error. Only return an error if it occurs first.
+	 *
+	 * When a short write occurs, the application should retry at the
+	 * appropriate offset, at which point we'll potentially pass back
+	 * the error.
+	 */
+	for (i = 0, reply = local->replies; i < local->wind_count;
+		i++, reply++) {
+		if (reply->op_ret == -1) {
+			gf_log(this->name, GF_LOG_DEBUG, "reply %d "
+				"returned error %s", i,
+				strerror(reply->op_errno));
+			if (!local->op_ret) {
+				local->op_ret = -1;
+				local->op_errno = reply->op_errno;
+			}
+			break;
+		}
+
+		local->op_ret += reply->op_ret;
+
+		if (reply->op_ret < reply->requested_size)
+			break;
+	}
+
+	GF_FREE(local->replies);
+
+        STRIPE_STACK_UNWIND (writev, frame, local->op_ret,
+                             local->op_errno, &local->pre_buf,
+                             &local->post_buf, NULL);
+}
+
 int32_t
 stripe_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                    int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
                    struct iatt *postbuf, dict_t *xdata)
 {
-        int32_t         callcnt = 0;
         stripe_local_t *local = NULL;
 	stripe_local_t *mlocal = NULL;
         call_frame_t   *prev = NULL;
 	call_frame_t   *mframe = NULL;
 	struct stripe_replies *reply = NULL;
-	int32_t		i = 0;
+	int32_t		chunk = 0;
+	off_t		done = 0;
 
         if (!this || !frame || !frame->local || !cookie) {
                 gf_log ("stripe", GF_LOG_DEBUG, "possible NULL deref");
@@ -3559,12 +3844,23 @@ stripe_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 	mframe = local->orig_frame;
 	mlocal = mframe->local;
 
-        LOCK(&frame->lock);
-        {
-                callcnt = ++mlocal->call_count;
+        stripe_io_account (this, prev->this, 0, 1, 0);
 
-		mlocal->replies[local->node_index].op_ret = op_ret;
-		mlocal->replies[local->node_index].op_errno = op_errno;
+        LOCK(&mframe->lock);
+        {
+		/* hand the written bytes out to the units in order */
+		for (chunk = local->node_index; chunk < mlocal->wind_count;
+		     chunk += mlocal->sub_step) {
+			reply = &mlocal->replies[chunk];
+			reply->op_errno = op_errno;
+			if (op_ret < 0) {
+				reply->op_ret = -1;
+				continue;
+			}
+			reply->op_ret = max (min (op_ret - done,
+						  reply->requested_size), 0);
+			done += reply->op_ret;
+		}
 
                 if (op_ret >= 0) {
                         mlocal->post_buf = *postbuf;
@@ -3582,50 +3878,103 @@ stripe_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 				mlocal->postbuf_size = postbuf->ia_size;
                 }
         }
-        UNLOCK (&frame->lock);
+        UNLOCK (&mframe->lock);
 
-        if ((callcnt == mlocal->wind_count) && mlocal->unwind) {
-		mlocal->pre_buf.ia_size = mlocal->prebuf_size;
-		mlocal->pre_buf.ia_blocks = mlocal->prebuf_blocks;
-		mlocal->post_buf.ia_size = mlocal->postbuf_size;
-		mlocal->post_buf.ia_blocks = mlocal->postbuf_blocks;
-
-		/*
-		 * Only return the number of consecutively written bytes up until
-		 * the first error. Only return an error if it occurs first.
-		 *
-		 * When a short write occurs, the application should retry at the
-		 * appropriate offset, at which point we'll potentially pass back
-		 * the error.
-		 */
-		for (i = 0, reply = mlocal->replies; i < mlocal->wind_count;
-			i++, reply++) {
-			if (reply->op_ret == -1) {
-				gf_log(this->name, GF_LOG_DEBUG, "reply %d "
-					"returned error %s", i,
-					strerror(reply->op_errno));
-				if (!mlocal->op_ret) {
-					mlocal->op_ret = -1;
-					mlocal->op_errno = reply->op_errno;
-				}
-				break;
-			}
+        if (stripe_io_next (mframe, this, stripe_writev_wind))
+                stripe_writev_unwind (mframe, this);
+out:
+	STRIPE_STACK_DESTROY(frame);
+        return 0;
+}
 
-			mlocal->op_ret += reply->op_ret;
+/*
+ * Wind subrequest @sub of the write in @frame, gathering the parts of the
+ * vector for its stripe units. Returns 0 once wound, or -1 after failing
+ * its stripe units.
+ */
+static int
+stripe_writev_wind (call_frame_t *frame, xlator_t *this, int32_t sub)
+{
+        stripe_local_t   *local = NULL;
+        stripe_local_t   *wlocal = NULL;
+        stripe_fd_ctx_t  *fctx = NULL;
+        call_frame_t     *wframe = NULL;
+        xlator_t         *subvol = NULL;
+        struct iovec     *tmp_vec = NULL;
+        int32_t           tmp_count = 0;
+        int32_t           chunk = 0;
+        off_t             start = 0;
+        off_t             end = 0;
+        off_t             dest_offset = 0;
+        size_t            size = 0;
 
-			if (reply->op_ret < reply->requested_size)
-				break;
-		}
+        local = frame->local;
+        fctx  = local->fctx;
+
+        for (chunk = sub; chunk < local->wind_count;
+             chunk += local->sub_step) {
+                stripe_io_chunk (local, chunk, &start, &end);
+                tmp_count += iov_subset (local->vector, local->count,
+                                         start - local->offset,
+                                         end - local->offset, NULL);
+        }
 
-		GF_FREE(mlocal->replies);
+        tmp_vec = GF_CALLOC (tmp_count ? tmp_count : 1, sizeof (struct iovec),
+                             gf_stripe_mt_iovec);
+        if (!tmp_vec)
+                goto err;
 
-                STRIPE_STACK_UNWIND (writev, mframe, mlocal->op_ret,
-                                     mlocal->op_errno, &mlocal->pre_buf,
-                                     &mlocal->post_buf, NULL);
+        tmp_count = 0;
+        for (chunk = sub; chunk < local->wind_count;
+             chunk += local->sub_step) {
+                stripe_io_chunk (local, chunk, &start, &end);
+                tmp_count += iov_subset (local->vector, local->count,
+                                         start - local->offset,
+                                         end - local->offset,
+                                         tmp_vec + tmp_count);
+                size += end - start;
         }
-out:
-	STRIPE_STACK_DESTROY(frame);
+
+        wframe = copy_frame (frame);
+        if (!wframe)
+                goto err;
+
+        wlocal = mem_get0 (this->local_pool);
+        if (!wlocal)
+                goto err;
+
+        stripe_io_chunk (local, sub, &start, &end);
+        subvol = fctx->xl_array[(start / local->stripe_size) %
+                                fctx->stripe_count];
+
+	dest_offset = start;
+	if (fctx->stripe_coalesce)
+		dest_offset = coalesced_offset(dest_offset,
+				local->stripe_size, fctx->stripe_count);
+
+	/*
+	 * Store off the request index, the callback hands the result out
+	 * to the stripe units of the request in order.
+	 */
+	wlocal->node_index = sub;
+	wlocal->orig_frame = frame;
+	wframe->local = wlocal;
+
+        stripe_io_account (this, subvol, 1, 1, size);
+
+        STACK_WIND (wframe, stripe_writev_cbk, subvol, subvol->fops->writev,
+                    local->fd, tmp_vec, tmp_count, dest_offset, local->flags,
+                    local->iobref, local->xdata);
+
+        GF_FREE (tmp_vec);
         return 0;
+err:
+        if (wframe)
+                STACK_DESTROY (wframe->root);
+        GF_FREE (tmp_vec);
+
+        stripe_io_fail (frame, sub, ENOMEM);
+        return -1;
 }
 
 int32_t
@@ -3633,24 +3982,19 @@ stripe_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
                struct iovec *vector, int32_t count, off_t offset,
                uint32_t flags, struct iobref *iobref, dict_t *xdata)
 {
-        struct iovec     *tmp_vec = NULL;
         stripe_local_t   *local = NULL;
         stripe_fd_ctx_t  *fctx = NULL;
         int32_t           op_errno = 1;
         int32_t           idx = 0;
         int32_t           total_size = 0;
-        int32_t           offset_offset = 0;
-        int32_t           remaining_size = 0;
-        int32_t           tmp_count = count;
-        off_t             fill_size = 0;
+        int32_t           depth = 0;
+        off_t             start = 0;
+        off_t             end = 0;
         uint64_t          stripe_size = 0;
         uint64_t          tmp_fctx = 0;
-	off_t		  dest_offset = 0;
 	off_t		  rounded_start = 0;
 	off_t		  rounded_end = 0;
 	int32_t		  total_chunks = 0;
-	call_frame_t	  *wframe = NULL;
-	stripe_local_t	  *wlocal = NULL;
 
         VALIDATE_OR_GOTO (frame, err);
         VALIDATE_OR_GOTO (this, err);
@@ -3671,7 +4015,6 @@ stripe_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
         for (idx = 0; idx< count; idx ++) {
                 total_size += vector[idx].iov_len;
         }
-        remaining_size = total_size;
 
         local = mem_get0 (this->local_pool);
         if (!local) {
@@ -3691,82 +4034,47 @@ stripe_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
 
 	rounded_start = floor(offset, stripe_size);
 	rounded_end = roof(offset + total_size, stripe_size);
-	total_chunks = (rounded_end - rounded_start) / stripe_size;
+	total_chunks = max((rounded_end - rounded_start) / stripe_size, 1);
 	local->replies = GF_CALLOC(total_chunks, sizeof(struct stripe_replies),
 				gf_stripe_mt_stripe_replies);
-	if (!local->replies) {
+	/* the vector has to outlive this call for the pipelined winds */
+	local->vector = iov_dup (vector, count);
+	if (!local->replies || !local->vector) {
 		op_errno = ENOMEM;
 		goto err;
 	}
 
-	total_chunks = 0;
-        while (1) {
-		wframe = copy_frame(frame);
-		wlocal = mem_get0(this->local_pool);
-		if (!wlocal) {
-			op_errno = ENOMEM;
-			goto err;
-		}
-		wlocal->orig_frame = frame;
-		wframe->local = wlocal;
-
-                /* Send striped chunk of the vector to child
-                   nodes appropriately. */
-                idx = (((offset + offset_offset) /
-                        local->stripe_size) % fctx->stripe_count);
-
-                fill_size = (local->stripe_size -
-                             ((offset + offset_offset) % local->stripe_size));
-                if (fill_size > remaining_size)
-                        fill_size = remaining_size;
-
-                remaining_size -= fill_size;
-
-                tmp_count = iov_subset (vector, count, offset_offset,
-                                        offset_offset + fill_size, NULL);
-                tmp_vec = GF_CALLOC (tmp_count, sizeof (struct iovec),
-                                     gf_stripe_mt_iovec);
-                if (!tmp_vec) {
-                        op_errno = ENOMEM;
-                        goto err;
-                }
-                tmp_count = iov_subset (vector, count, offset_offset,
-                                        offset_offset + fill_size, tmp_vec);
-
-                local->wind_count++;
-                if (remaining_size == 0)
-                        local->unwind = 1;
-
-		/*
-		 * Store off the request index (with respect to the chunk of the
-		 * initial offset) and the size of the request. This is required
-		 * in the callback to calculate an appropriate return value in
-		 * the event of a write failure in one or more requests.
-		 */
-		wlocal->node_index = total_chunks;
-		local->replies[total_chunks].requested_size = fill_size;
-
-		dest_offset = offset + offset_offset;
-		if (fctx->stripe_coalesce)
-			dest_offset = coalesced_offset(dest_offset,
-					local->stripe_size, fctx->stripe_count);
-
-                STACK_WIND (wframe, stripe_writev_cbk, fctx->xl_array[idx],
-                            fctx->xl_array[idx]->fops->writev, fd, tmp_vec,
-                            tmp_count, dest_offset, flags, iobref,
-                            xdata);
+        local->count   = count;
+        local->io_size = total_size;
+        local->offset  = offset;
+        local->flags   = flags;
+        local->fd      = fd_ref (fd);
+        local->iobref  = iobref_ref (iobref);
+        if (xdata)
+                local->xdata = dict_ref (xdata);
 
-                GF_FREE (tmp_vec);
-                offset_offset += fill_size;
-		total_chunks++;
-                if (remaining_size == 0)
-                        break;
+	/*
+	 * The size of each unit is required in the callback to calculate an
+	 * appropriate return value in the event of a write failure in one or
+	 * more requests.
+	 */
+	for (idx = 0; idx < total_chunks; idx++) {
+		stripe_io_chunk (local, idx, &start, &end);
+		local->replies[idx].requested_size = end - start;
+	}
+
+        depth = stripe_io_plan (this, local, total_chunks);
+
+        for (idx = 0; idx < depth; idx++) {
+                if (stripe_writev_wind (frame, this, idx) &&
+                    stripe_io_next (frame, this, stripe_writev_wind))
+                        stripe_writev_unwind (frame, this);
         }
 
         return 0;
 err:
-	if (wframe)
-		STRIPE_STACK_DESTROY(wframe);
+        if (local)
+                GF_FREE (local->replies);
 
         STRIPE_STACK_UNWIND (writev, frame, -1, op_errno, NULL, NULL, NULL);
         return 0;
@@ -4557,6 +4865,9 @@ reconfigure (xlator_t *this, dict_t *options)
 
 		GF_OPTION_RECONF("coalesce", priv->coalesce, options, bool,
 				unlock);
+
+                GF_OPTION_RECONF ("io-depth", priv->io_depth, options, int32,
+                                  unlock);
         }
  unlock:
         UNLOCK (&priv->lock);
@@ -4627,6 +4938,11 @@ init (xlator_t *this)
         if (!priv->last_event)
                 goto out;
 
+        priv->io_stats = GF_CALLOC (count, sizeof (stripe_io_stats_t),
+                                    gf_stripe_mt_io_stats_t);
+        if (!priv->io_stats)
+                goto out;
+
         priv->child_count = count;
         LOCK_INIT (&priv->lock);
 
@@ -4679,6 +4995,8 @@ init (xlator_t *this)
 
 	GF_OPTION_INIT("coalesce", priv->coalesce, bool, out);
 
+        GF_OPTION_INIT ("io-depth", priv->io_depth, int32, out);
+
         this->local_pool = mem_pool_new (stripe_local_t, 128);
         if (!this->local_pool) {
                 ret = -1;
@@ -4694,6 +5012,8 @@ out:
         if (ret) {
                 if (priv) {
                         GF_FREE (priv->xl_array);
+                        GF_FREE (priv->last_event);
+                        GF_FREE (priv->io_stats);
                         GF_FREE (priv);
                 }
         }
@@ -4726,6 +5046,7 @@ fini (xlator_t *this)
                         GF_FREE (prev);
                 }
                 GF_FREE (priv->last_event);
+                GF_FREE (priv->io_stats);
                 LOCK_DESTROY (&priv->lock);
                 GF_FREE (priv);
         }
@@ -5151,6 +5472,7 @@ stripe_priv_dump (xlator_t *this)
         stripe_private_t       *priv = NULL;
         int                     ret = -1;
         struct stripe_options  *options = NULL;
+        stripe_io_stats_t      *stats = NULL;
 
         GF_VALIDATE_OR_GOTO ("stripe", this, out);
 
@@ -5183,6 +5505,23 @@ stripe_priv_dump (xlator_t *this)
         gf_proc_dump_write ("nodes-down", "%d", priv->nodes_down);
         gf_proc_dump_write ("first-child_down", "%d", priv->first_child_down);
         gf_proc_dump_write ("xattr_supported", "%d", priv->xattr_supported);
+        gf_proc_dump_write ("io_depth", "%d", priv->io_depth);
+
+        for (i = 0; i < priv->child_count; i++) {
+                stats = &priv->io_stats[i];
+                sprintf (key, "subvolumes[%d].inflight", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->inflight);
+                sprintf (key, "subvolumes[%d].peak_inflight", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->peak_inflight);
+                sprintf (key, "subvolumes[%d].reads", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->reads);
+                sprintf (key, "subvolumes[%d].read_bytes", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->read_bytes);
+                sprintf (key, "subvolumes[%d].writes", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->writes);
+                sprintf (key, "subvolumes[%d].write_bytes", i);
+                gf_proc_dump_write (key, "%"PRIu64, stats->write_bytes);
+        }
 
         UNLOCK (&priv->lock);
 
@@ -5251,5 +5590,14 @@ struct volume_options options[] = {
 			 "stored on the server (i.e., eliminate holes caused "
 			 "by the traditional format)."
 	},
+        { .key  = {"io-depth"},
+          .type = GF_OPTION_TYPE_INT,
+          .default_value = "16",
+          .min = 1,
+          .max = 1024,
+          .description = "Maximum number of subrequests of one read or write "
+                         "in flight at a time. The rest are sent as earlier "
+                         "ones complete."
+        },
         { .key  = {NULL} },
 };
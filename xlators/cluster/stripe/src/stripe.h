@@ -88,6 +88,18 @@ struct stripe_options {
         uint64_t               block_size;
 };
 
+/**
+ * Per-subvolume read/write statistics, shown in the statedump
+ */
+typedef struct stripe_io_stats {
+        uint64_t                inflight;
+        uint64_t                peak_inflight;
+        uint64_t                reads;
+        uint64_t                read_bytes;
+        uint64_t                writes;
+        uint64_t                write_bytes;
+} stripe_io_stats_t;
+
 /**
  * Private structure for stripe translator
  */
@@ -102,6 +114,8 @@ struct stripe_private {
         int8_t                  child_count;
         gf_boolean_t            xattr_supported;  /* default yes */
 	gf_boolean_t		coalesce;
+        int32_t                 io_depth; /* subrequests in flight per fop */
+        stripe_io_stats_t      *io_stats;
         char                    vol_uuid[UUID_SIZE + 1];
 };
 
@@ -170,6 +184,14 @@ struct stripe_local {
         int32_t              call_count;
         int32_t              wind_count; /* used instead of child_cound
                                             in case of read and write */
+        /* read and write subrequests: sub_next is the next one to wind,
+           and subrequest s covers the stripe units s, s + sub_step, ... */
+        int32_t              sub_count;
+        int32_t              sub_next;
+        int32_t              sub_done;
+        int32_t              sub_step;
+        size_t               io_size;
+        struct iovec        *vector;
         int32_t              op_ret;
         int32_t              op_errno;
         int32_t              count;
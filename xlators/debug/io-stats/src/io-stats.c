@@ -2538,6 +2538,26 @@ ios_destroy_top_stats (struct ios_conf *conf)
         return;
 }
 
+static void
+ios_set_logger (xlator_t *this, char *mode_str, char *format_str,
+                uint64_t buf_size, uint32_t flush_timeout)
+{
+        gf_log_set_log_buf_size (buf_size);
+        gf_log_set_log_flush_timeout (flush_timeout);
+
+        if (format_str)
+                gf_log_set_logformat (strcmp (format_str, "json") ?
+                                      GF_LOG_FORMAT_TEXT : GF_LOG_FORMAT_JSON);
+
+        if (mode_str && !strcmp (mode_str, "async")) {
+                if (gf_log_set_logmode (GF_LOG_MODE_ASYNC))
+                        gf_log (this->name, GF_LOG_WARNING, "failed to start "
+                                "the logger thread, logging synchronously");
+        } else {
+                gf_log_set_logmode (GF_LOG_MODE_SYNC);
+        }
+}
+
 int
 reconfigure (xlator_t *this, dict_t *options)
 {
@@ -2547,6 +2567,10 @@ reconfigure (xlator_t *this, dict_t *options)
         int                 sys_log_level = -1;
         char               *log_str = NULL;
         int                 log_level = -1;
+        char               *log_mode_str = NULL;
+        char               *log_format_str = NULL;
+        uint64_t            log_buf_size = 0;
+        uint32_t            log_flush_timeout = 0;
 
         if (!this || !this->private)
                 goto out;
@@ -2574,6 +2598,14 @@ reconfigure (xlator_t *this, dict_t *options)
                 gf_log_set_loglevel (log_level);
         }
 
+        GF_OPTION_RECONF ("log-mode", log_mode_str, options, str, out);
+        GF_OPTION_RECONF ("log-format", log_format_str, options, str, out);
+        GF_OPTION_RECONF ("log-buf-size", log_buf_size, options, size, out);
+        GF_OPTION_RECONF ("log-flush-timeout", log_flush_timeout, options,
+                          uint32, out);
+        ios_set_logger (this, log_mode_str, log_format_str, log_buf_size,
+                        log_flush_timeout);
+
         ret = 0;
 out:
         gf_log (this->name, GF_LOG_DEBUG, "reconfigure returning %d", ret);
@@ -2608,6 +2640,10 @@ init (xlator_t *this)
         int                 sys_log_level = -1;
         char               *log_str = NULL;
         int                 log_level = -1;
+        char               *log_mode_str = NULL;
+        char               *log_format_str = NULL;
+        uint64_t            log_buf_size = 0;
+        uint32_t            log_flush_timeout = 0;
         int                 ret = -1;
 
         if (!this)
@@ -2663,6 +2699,13 @@ init (xlator_t *this)
                 gf_log_set_loglevel (log_level);
         }
 
+        GF_OPTION_INIT ("log-mode", log_mode_str, str, out);
+        GF_OPTION_INIT ("log-format", log_format_str, str, out);
+        GF_OPTION_INIT ("log-buf-size", log_buf_size, size, out);
+        GF_OPTION_INIT ("log-flush-timeout", log_flush_timeout, uint32, out);
+        ios_set_logger (this, log_mode_str, log_format_str, log_buf_size,
+                        log_flush_timeout);
+
         this->private = conf;
         ret = 0;
 out:
@@ -2846,6 +2889,39 @@ struct volume_options options[] = {
           .value = { "DEBUG", "WARNING", "ERROR", "INFO",
                      "CRITICAL", "NONE", "TRACE"}
         },
+        { .key = {"log-mode"},
+          .type = GF_OPTION_TYPE_STR,
+          .default_value = "sync",
+          .description = "In async mode a thread only queues its messages, "
+                         "a logger thread writes them out. Critical "
+                         "messages are always written out right away.",
+          .value = { "sync", "async"}
+        },
+        { .key = {"log-format"},
+          .type = GF_OPTION_TYPE_STR,
+          .default_value = "text",
+          .description = "Format of the messages written out by the logger "
+                         "thread, json writes one object per line.",
+          .value = { "text", "json"}
+        },
+        { .key = {"log-buf-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .min = GF_LOG_BUF_SIZE_MIN,
+          .max = 16 * GF_UNIT_MB,
+          .default_value = "64KB",
+          .description = "Size of the message queue of each thread in async "
+                         "mode. Messages which do not fit are dropped and "
+                         "counted."
+        },
+        { .key = {"log-flush-timeout"},
+          .type = GF_OPTION_TYPE_INT,
+          .min = 0,
+          .max = 3600,
+          .default_value = "120",
+          .description = "Repeats of a message within this many seconds of "
+                         "it are written out as a count in async mode, 0 "
+                         "writes out every one of them."
+        },
 
         /* These are synthetic entries to assist validation of CLI's  *
          *  volume set  command                                       */
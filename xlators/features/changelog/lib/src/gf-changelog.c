@@ -0,0 +1,615 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "glusterfs.h"
+#include "globals.h"
+#include "uuid.h"
+
+#include "changelog.h"
+#include "gf-changelog.h"
+
+#define GF_CHANGELOG_DIR        ".glusterfs/changelogs"
+#define GF_CHANGELOG_PROCESSING ".processing"
+#define GF_CHANGELOG_PROCESSED  ".processed"
+#define GF_CHANGELOG_SCANNED    ".scanned"
+
+/* The brick registered by this process */
+static struct gf_changelog {
+        char           changelog_dir[PATH_MAX];
+        char           processing_dir[PATH_MAX];
+        char           processed_dir[PATH_MAX];
+        char           scanned_path[PATH_MAX];
+        unsigned long *scanned;        /* journals converted, sorted */
+        size_t         nscanned;
+        unsigned long *pending;        /* journals waiting to be handed out */
+        size_t         npending;
+        size_t         next;
+        int            registered;
+} gf_changelog;
+
+/* Return the number of a rolled over journal name, 0 for anything else */
+static unsigned long
+gf_changelog_name_ts (const char *name)
+{
+        return changelog_journal_number (name);
+}
+
+static int
+gf_changelog_ts_cmp (const void *a, const void *b)
+{
+        unsigned long x = *(const unsigned long *) a;
+        unsigned long y = *(const unsigned long *) b;
+
+        return (x < y) ? -1 : (x > y);
+}
+
+/* Gather the timestamps of the journals in @dir, sorted */
+static ssize_t
+gf_changelog_list (const char *dir, unsigned long **tsp)
+{
+        DIR            *dirp  = NULL;
+        struct dirent  *entry = NULL;
+        unsigned long  *ts    = NULL;
+        unsigned long  *tmp   = NULL;
+        size_t          count = 0;
+        size_t          size  = 0;
+        unsigned long   n     = 0;
+
+        dirp = opendir (dir);
+        if (!dirp)
+                return -1;
+
+        while ((entry = readdir (dirp))) {
+                n = gf_changelog_name_ts (entry->d_name);
+                if (!n)
+                        continue;
+
+                if (count == size) {
+                        size = size ? 2 * size : 64;
+                        tmp = realloc (ts, size * sizeof (*ts));
+                        if (!tmp) {
+                                free (ts);
+                                closedir (dirp);
+                                errno = ENOMEM;
+                                return -1;
+                        }
+                        ts = tmp;
+                }
+
+                ts[count++] = n;
+        }
+
+        closedir (dirp);
+
+        if (count)
+                qsort (ts, count, sizeof (*ts), gf_changelog_ts_cmp);
+
+        *tsp = ts;
+        return count;
+}
+
+static const char *
+gf_changelog_fop_name (int fop)
+{
+        if ((fop <= 0) || (fop >= GF_FOP_MAXVALUE) || !gf_fop_list[fop])
+                return "UNKNOWN";
+
+        return gf_fop_list[fop];
+}
+
+/* Print one (pargfid, name) pair, returning the length consumed */
+static size_t
+gf_changelog_print_name (FILE *out, const char *ptr)
+{
+        char uuid[40] = {0, };
+
+        uuid_unparse ((unsigned char *) ptr, uuid);
+        fprintf (out, " %s/%s", uuid, ptr + CHANGELOG_GFID_LEN);
+
+        return CHANGELOG_GFID_LEN + strlen (ptr + CHANGELOG_GFID_LEN) + 1;
+}
+
+/* Rewrite the binary journal in @buf as text into @out. Records which
+   cannot be decoded end the journal, they are replaced by an 'L' line so
+   that the consumer knows changes were lost. */
+static int
+gf_changelog_decode (const char *buf, size_t len, FILE *out)
+{
+        const char *ptr      = buf;
+        const char *end      = buf + len;
+        char        uuid[40] = {0, };
+        char        type     = 0;
+        int         fop      = 0;
+        size_t      rlen     = 0;
+        size_t      used     = 0;
+
+        if ((len < strlen (CHANGELOG_HEADER)) ||
+            memcmp (buf, CHANGELOG_HEADER, strlen (CHANGELOG_HEADER)))
+                return -1;
+
+        ptr += strlen (CHANGELOG_HEADER);
+
+        while (ptr < end) {
+                rlen = changelog_record_len (ptr, end - ptr);
+                if (!rlen) {
+                        fprintf (out, "%c\n", CHANGELOG_TYPE_LOST);
+                        break;
+                }
+
+                type = ptr[0];
+                uuid_unparse ((unsigned char *) ptr + 1, uuid);
+
+                switch (type) {
+                case CHANGELOG_TYPE_DATA:
+                case CHANGELOG_TYPE_METADATA:
+                        fprintf (out, "%c %s\n", type, uuid);
+                        break;
+
+                case CHANGELOG_TYPE_LOST:
+                        fprintf (out, "%c\n", type);
+                        break;
+
+                case CHANGELOG_TYPE_ENTRY:
+                        fop = (unsigned char) ptr[1 + CHANGELOG_GFID_LEN];
+                        fprintf (out, "%c %s %s", type, uuid,
+                                 gf_changelog_fop_name (fop));
+
+                        used = gf_changelog_print_name (out, ptr + 2 +
+                                                        CHANGELOG_GFID_LEN);
+                        if (fop == GF_FOP_RENAME)
+                                gf_changelog_print_name (out, ptr + 2 +
+                                                         CHANGELOG_GFID_LEN +
+                                                         used);
+
+                        fprintf (out, "\n");
+                        break;
+                }
+
+                ptr += rlen;
+        }
+
+        return 0;
+}
+
+static int
+gf_changelog_read_file (const char *path, char **bufp, size_t *lenp)
+{
+        struct stat  stbuf = {0, };
+        char        *buf   = NULL;
+        size_t       done  = 0;
+        ssize_t      ret   = 0;
+        int          fd    = -1;
+
+        fd = open (path, O_RDONLY);
+        if (fd < 0)
+                return -1;
+
+        if (fstat (fd, &stbuf))
+                goto err;
+
+        buf = malloc (stbuf.st_size + 1);
+        if (!buf) {
+                errno = ENOMEM;
+                goto err;
+        }
+
+        while (done < stbuf.st_size) {
+                ret = read (fd, buf + done, stbuf.st_size - done);
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        goto err;
+                }
+                if (ret == 0)
+                        break;
+                done += ret;
+        }
+
+        close (fd);
+
+        *bufp = buf;
+        *lenp = done;
+        return 0;
+err:
+        free (buf);
+        close (fd);
+        return -1;
+}
+
+/* Fail with ENAMETOOLONG when snprintf() had to truncate a path */
+static int
+gf_changelog_fits (int len)
+{
+        if ((len < 0) || (len >= PATH_MAX)) {
+                errno = ENAMETOOLONG;
+                return -1;
+        }
+
+        return 0;
+}
+
+/* Path of journal @ts in @dir, its name prefixed with @prefix */
+static int
+gf_changelog_path (char *path, const char *dir, const char *prefix,
+                   unsigned long ts)
+{
+        return gf_changelog_fits (snprintf (path, PATH_MAX,
+                                            "%s/%s"CHANGELOG_FILE_NAME".%lu",
+                                            dir, prefix, ts));
+}
+
+/* Convert journal @ts into .processing, through a temporary file so that
+   a crash never leaves a partial changelog to be handed out */
+static int
+gf_changelog_convert (unsigned long ts)
+{
+        char    src[PATH_MAX] = {0, };
+        char    tmp[PATH_MAX] = {0, };
+        char    dst[PATH_MAX] = {0, };
+        char   *buf           = NULL;
+        size_t  len           = 0;
+        FILE   *out           = NULL;
+        int     ret           = -1;
+
+        if (gf_changelog_path (src, gf_changelog.changelog_dir, "", ts) ||
+            gf_changelog_path (dst, gf_changelog.processing_dir, "", ts) ||
+            gf_changelog_path (tmp, gf_changelog.processing_dir, ".tmp.", ts))
+                return -1;
+
+        if (gf_changelog_read_file (src, &buf, &len))
+                goto out;
+
+        out = fopen (tmp, "w");
+        if (!out)
+                goto out;
+
+        if (gf_changelog_decode (buf, len, out)) {
+                errno = EINVAL;
+                goto out;
+        }
+
+        if (fflush (out) || fsync (fileno (out)))
+                goto out;
+
+        ret = fclose (out);
+        out = NULL;
+        if (ret)
+                goto out;
+
+        ret = rename (tmp, dst);
+out:
+        if (out)
+                fclose (out);
+        if (ret)
+                unlink (tmp);
+        free (buf);
+
+        return ret;
+}
+
+static int
+gf_changelog_scanned_has (unsigned long ts)
+{
+        return (bsearch (&ts, gf_changelog.scanned, gf_changelog.nscanned,
+                         sizeof (ts), gf_changelog_ts_cmp) != NULL);
+}
+
+/* Append the journals of @dir to @ts, which holds @count of @size */
+static int
+gf_changelog_scanned_add_dir (const char *dir, unsigned long **ts,
+                              size_t *count, size_t *size)
+{
+        unsigned long *names = NULL;
+        unsigned long *tmp   = NULL;
+        ssize_t        n     = 0;
+
+        n = gf_changelog_list (dir, &names);
+        if (n < 0)
+                return (errno == ENOENT) ? 0 : -1;
+
+        if (*count + n > *size) {
+                tmp = realloc (*ts, (*count + n) * sizeof (**ts));
+                if (!tmp) {
+                        free (names);
+                        errno = ENOMEM;
+                        return -1;
+                }
+                *ts = tmp;
+                *size = *count + n;
+        }
+
+        if (n)
+                memcpy (*ts + *count, names, n * sizeof (*names));
+        *count += n;
+        free (names);
+
+        return 0;
+}
+
+/* The journals converted by earlier runs: those listed in the scanned
+   file, and those still in .processing or .processed in case the run did
+   not get to save the list */
+static int
+gf_changelog_scanned_load ()
+{
+        unsigned long *ts    = NULL;
+        unsigned long *tmp   = NULL;
+        unsigned long  n     = 0;
+        size_t         count = 0;
+        size_t         size  = 0;
+        size_t         i     = 0;
+        size_t         uniq  = 0;
+        FILE          *fp    = NULL;
+
+        fp = fopen (gf_changelog.scanned_path, "r");
+        if (!fp && (errno != ENOENT))
+                return -1;
+
+        while (fp && (fscanf (fp, "%lu", &n) == 1)) {
+                if (count == size) {
+                        size = size ? 2 * size : 64;
+                        tmp = realloc (ts, size * sizeof (*ts));
+                        if (!tmp) {
+                                free (ts);
+                                fclose (fp);
+                                errno = ENOMEM;
+                                return -1;
+                        }
+                        ts = tmp;
+                }
+                ts[count++] = n;
+        }
+        if (fp)
+                fclose (fp);
+
+        if (gf_changelog_scanned_add_dir (gf_changelog.processing_dir, &ts,
+                                          &count, &size) ||
+            gf_changelog_scanned_add_dir (gf_changelog.processed_dir, &ts,
+                                          &count, &size)) {
+                free (ts);
+                return -1;
+        }
+
+        if (count)
+                qsort (ts, count, sizeof (*ts), gf_changelog_ts_cmp);
+        for (i = 0; i < count; i++) {
+                if (!uniq || (ts[uniq - 1] != ts[i]))
+                        ts[uniq++] = ts[i];
+        }
+
+        free (gf_changelog.scanned);
+        gf_changelog.scanned = ts;
+        gf_changelog.nscanned = uniq;
+
+        return 0;
+}
+
+/* Replace the list of converted journals with the @count in @ts, which the
+   brick still has: the others can never show up again */
+static int
+gf_changelog_scanned_save (unsigned long *ts, size_t count)
+{
+        char    tmp[PATH_MAX] = {0, };
+        FILE   *out           = NULL;
+        size_t  i             = 0;
+        int     ret           = -1;
+
+        if (gf_changelog_fits (snprintf (tmp, sizeof (tmp), "%s.tmp",
+                                         gf_changelog.scanned_path)))
+                return -1;
+
+        out = fopen (tmp, "w");
+        if (!out)
+                return -1;
+
+        for (i = 0; i < count; i++) {
+                if (fprintf (out, "%lu\n", ts[i]) < 0)
+                        goto out;
+        }
+
+        if (fflush (out) || fsync (fileno (out)))
+                goto out;
+
+        ret = fclose (out);
+        out = NULL;
+        if (ret)
+                goto out;
+
+        ret = rename (tmp, gf_changelog.scanned_path);
+out:
+        if (out)
+                fclose (out);
+        if (ret)
+                unlink (tmp);
+
+        return ret;
+}
+
+int
+gf_changelog_register (char *brick_path, char *scratch_dir)
+{
+        if (!brick_path || !scratch_dir) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        if (gf_changelog.registered) {
+                errno = EEXIST;
+                return -1;
+        }
+
+        if (gf_changelog_fits (snprintf (gf_changelog.changelog_dir,
+                                         PATH_MAX, "%s/%s", brick_path,
+                                         GF_CHANGELOG_DIR)) ||
+            gf_changelog_fits (snprintf (gf_changelog.processing_dir,
+                                         PATH_MAX, "%s/%s", scratch_dir,
+                                         GF_CHANGELOG_PROCESSING)) ||
+            gf_changelog_fits (snprintf (gf_changelog.processed_dir,
+                                         PATH_MAX, "%s/%s", scratch_dir,
+                                         GF_CHANGELOG_PROCESSED)))
+                return -1;
+
+        if ((mkdir (scratch_dir, 0700) && (errno != EEXIST)) ||
+            (mkdir (gf_changelog.processing_dir, 0700) && (errno != EEXIST)) ||
+            (mkdir (gf_changelog.processed_dir, 0700) && (errno != EEXIST)))
+                return -1;
+
+        if (gf_changelog_fits (snprintf (gf_changelog.scanned_path,
+                                         PATH_MAX, "%s/%s", scratch_dir,
+                                         GF_CHANGELOG_SCANNED)))
+                return -1;
+
+        /* carry on with the journals not converted by an earlier run */
+        if (gf_changelog_scanned_load ())
+                return -1;
+
+        gf_changelog.registered = 1;
+
+        return 0;
+}
+
+ssize_t
+gf_changelog_scan ()
+{
+        unsigned long *ts        = NULL;
+        ssize_t        count     = 0;
+        ssize_t        i         = 0;
+        size_t         done      = 0;
+        size_t         converted = 0;
+        int            failed    = 0;
+        int            saved     = 0;
+
+        if (!gf_changelog.registered) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        count = gf_changelog_list (gf_changelog.changelog_dir, &ts);
+        if (count < 0)
+                return -1;
+
+        /* journals are looked up by name rather than compared against the
+           newest one converted, so every journal is handed out once even
+           if it sorts before ones already converted */
+        for (i = 0; i < count; i++) {
+                if (gf_changelog_scanned_has (ts[i])) {
+                        ts[done++] = ts[i];
+                        continue;
+                }
+
+                if (failed || gf_changelog_convert (ts[i])) {
+                        failed = 1;
+                        continue;
+                }
+
+                ts[done++] = ts[i];
+                converted++;
+        }
+
+        /* errno of a failed conversion is kept */
+        saved = errno;
+        if ((converted || (done != gf_changelog.nscanned)) &&
+            gf_changelog_scanned_save (ts, done)) {
+                free (ts);
+                return -1;
+        }
+        errno = saved;
+
+        free (gf_changelog.scanned);
+        gf_changelog.scanned = ts;
+        gf_changelog.nscanned = done;
+
+        if (failed)
+                return -1;
+
+        free (gf_changelog.pending);
+        gf_changelog.pending = NULL;
+        gf_changelog.npending = 0;
+        gf_changelog.next = 0;
+
+        count = gf_changelog_list (gf_changelog.processing_dir,
+                                   &gf_changelog.pending);
+        if (count < 0)
+                return -1;
+
+        gf_changelog.npending = count;
+
+        return count;
+}
+
+ssize_t
+gf_changelog_next_change (char *bufptr, size_t maxlen)
+{
+        int len = 0;
+
+        if (!gf_changelog.registered || !bufptr) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        if (gf_changelog.next >= gf_changelog.npending)
+                return 0;
+
+        len = snprintf (bufptr, maxlen, "%s/"CHANGELOG_FILE_NAME".%lu",
+                        gf_changelog.processing_dir,
+                        gf_changelog.pending[gf_changelog.next]);
+        if (len >= maxlen) {
+                errno = ENAMETOOLONG;
+                return -1;
+        }
+
+        gf_changelog.next++;
+
+        return len;
+}
+
+int
+gf_changelog_done (char *file)
+{
+        char        from[PATH_MAX] = {0, };
+        char        to[PATH_MAX]   = {0, };
+        const char *name           = NULL;
+
+        if (!gf_changelog.registered || !file) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        name = strrchr (file, '/');
+        name = name ? name + 1 : file;
+
+        if (!gf_changelog_name_ts (name)) {
+                errno = EINVAL;
+                return -1;
+        }
+
+        if (gf_changelog_fits (snprintf (from, sizeof (from), "%s/%s",
+                                         gf_changelog.processing_dir, name)) ||
+            gf_changelog_fits (snprintf (to, sizeof (to), "%s/%s",
+                                         gf_changelog.processed_dir, name)))
+                return -1;
+
+        return rename (from, to);
+}
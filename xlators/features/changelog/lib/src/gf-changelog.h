@@ -0,0 +1,75 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _GF_CHANGELOG_H
+#define _GF_CHANGELOG_H
+
+#include <sys/types.h>
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+/*
+  libgfchangelog: consumer side of the changelog translator.
+
+  The changelog translator journals the modifications made on a brick in
+  <brick>/.glusterfs/changelogs and rolls the journal over at regular
+  intervals. Consumers (e.g. geo-replication) register the brick they are
+  interested in together with a private scratch directory, and then
+  repeatedly:
+
+      gf_changelog_scan ();
+      while (gf_changelog_next_change (buf, sizeof (buf)) > 0) {
+              ... process the changelog at path @buf ...
+              gf_changelog_done (buf);
+      }
+
+  Every rolled over journal is converted once to a text file in
+  <scratch>/.processing, whatever its name sorts against the journals
+  converted before it. The names converted are kept in <scratch>/.scanned.
+  The text files have one change per line:
+
+      E <gfid> <FOP> <pargfid>/<name> [<pargfid>/<name>]
+      D <gfid>
+      M <gfid>
+      L
+
+  The second <pargfid>/<name> is only present for RENAME and is the
+  destination. An L line means changes of the brick were lost (the brick
+  could not write them out, or the journal was damaged), the consumer has
+  to fall back to a full crawl. gf_changelog_done() moves the file to
+  <scratch>/.processed, so changelogs which were handed out but not marked
+  done are handed out again after a restart.
+
+  All functions return -1 and set errno on failure.
+*/
+
+/* Start consuming the changelogs of @brick_path, keeping state in
+   @scratch_dir. Only one brick can be registered per process. */
+int
+gf_changelog_register (char *brick_path, char *scratch_dir);
+
+/* Convert the journals rolled over since the last scan and return the
+   number of changelogs waiting to be processed */
+ssize_t
+gf_changelog_scan ();
+
+/* Copy the path of the next changelog to process into @bufptr and return
+   its length, or 0 when there is none left */
+ssize_t
+gf_changelog_next_change (char *bufptr, size_t maxlen);
+
+/* Mark the changelog at @file as processed */
+int
+gf_changelog_done (char *file);
+
+__END_DECLS
+
+#endif /* _GF_CHANGELOG_H */
@@ -0,0 +1,696 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "changelog-helpers.h"
+#include "common-utils.h"
+
+/*
+ * The journal is only written from the changelog thread and from fops
+ * appending records, both under priv->lock. The thread alone opens, rolls
+ * over and closes journals, so it can fsync them without holding the lock
+ * and without stalling the fops meanwhile.
+ *
+ * Records which cannot be written out stay in priv->buf, in order, until
+ * the journal can be written again.
+ */
+
+static void
+changelog_journal_path (changelog_priv_t *priv, char *path, size_t len)
+{
+        snprintf (path, len, "%s/"CHANGELOG_FILE_NAME, priv->changelog_dir);
+}
+
+static int
+changelog_write_all (int fd, const char *buf, size_t len)
+{
+        ssize_t ret = 0;
+
+        while (len) {
+                ret = write (fd, buf, len);
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return -1;
+                }
+
+                buf += ret;
+                len -= ret;
+        }
+
+        return 0;
+}
+
+/* Write out the gathered records. A failed write is cut off the journal
+   again, so that it only ever holds whole records, and the records are
+   kept to be written later. If the journal cannot be cut, the thread
+   reopens it, which drops the torn tail. */
+static int
+__changelog_flush (xlator_t *this, changelog_priv_t *priv)
+{
+        off_t size = 0;
+
+        if (!priv->buf_used)
+                return 0;
+
+        if ((priv->fd < 0) || priv->reopen)
+                return -1;
+
+        size = lseek (priv->fd, 0, SEEK_END);
+        if ((size >= 0) &&
+            !changelog_write_all (priv->fd, priv->buf, priv->buf_used)) {
+                priv->buf_used = 0;
+                return 0;
+        }
+
+        gf_log (this->name, GF_LOG_ERROR, "failed to write %zu bytes of "
+                "changelog records (%s)", priv->buf_used, strerror (errno));
+
+        if ((size < 0) || ftruncate (priv->fd, size))
+                priv->reopen = _gf_true;
+
+        return -1;
+}
+
+/* Queue a record telling the consumers that changes were lost */
+static void
+__changelog_append_lost (changelog_priv_t *priv)
+{
+        char *ptr = priv->buf + priv->buf_used;
+
+        ptr[0] = CHANGELOG_TYPE_LOST;
+        memset (ptr + 1, 0, CHANGELOG_GFID_LEN);
+
+        priv->buf_used += 1 + CHANGELOG_GFID_LEN;
+        priv->records++;
+}
+
+/* Find the end of the last whole record of the journal open at @fd, 0 if
+   the journal does not even start with a header, -1 on errors */
+static off_t
+changelog_journal_end (xlator_t *this, int fd, off_t size)
+{
+        char    *buf  = NULL;
+        size_t   hlen = strlen (CHANGELOG_HEADER);
+        size_t   have = 0;
+        size_t   used = 0;
+        size_t   rlen = 0;
+        off_t    off  = 0;
+        ssize_t  ret  = 0;
+
+        if (size < hlen)
+                return 0;
+
+        buf = GF_MALLOC (CHANGELOG_BUF_SIZE, gf_changelog_mt_buf_t);
+        if (!buf)
+                return -1;
+
+        ret = pread (fd, buf, hlen, 0);
+        if (ret < 0)
+                goto err;
+        if ((ret != hlen) || memcmp (buf, CHANGELOG_HEADER, hlen))
+                goto out;
+
+        /* buf holds @have bytes of the journal starting at @off */
+        off = hlen;
+        while (off + have < size) {
+                ret = pread (fd, buf + have, CHANGELOG_BUF_SIZE - have,
+                             off + have);
+                if (ret < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        goto err;
+                }
+                if (ret == 0)
+                        break;
+                have += ret;
+
+                for (used = 0; used < have; used += rlen) {
+                        rlen = changelog_record_len (buf + used,
+                                                     have - used);
+                        if (!rlen)
+                                break;
+                }
+
+                off += used;
+                have -= used;
+                memmove (buf, buf + used, have);
+
+                /* enough bytes for any record, yet none: not a record */
+                if (have >= CHANGELOG_MAX_RECORD_SIZE)
+                        break;
+        }
+out:
+        GF_FREE (buf);
+        return off;
+err:
+        gf_log (this->name, GF_LOG_ERROR, "failed to read changelog (%s)",
+                strerror (errno));
+        GF_FREE (buf);
+        return -1;
+}
+
+/* Open the journal, continuing the one left behind by an earlier run if
+   there is one. It is rolled over with the next rollover. A record torn by
+   a crash is cut off, and the consumers are told about the loss. */
+static int
+__changelog_open_journal (xlator_t *this, changelog_priv_t *priv)
+{
+        char        path[PATH_MAX] = {0, };
+        struct stat stbuf          = {0, };
+        off_t       end            = 0;
+        int         fd             = -1;
+
+        changelog_journal_path (priv, path, sizeof (path));
+
+again:
+        fd = open (path, O_CREAT | O_RDWR | O_APPEND, 0600);
+        if (fd < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "failed to open changelog "
+                        "%s (%s)", path, strerror (errno));
+                return -1;
+        }
+
+        if (fstat (fd, &stbuf)) {
+                gf_log (this->name, GF_LOG_ERROR, "failed to stat changelog "
+                        "%s (%s)", path, strerror (errno));
+                goto err;
+        }
+
+        /* rolled over already, the unlink did not happen */
+        if (stbuf.st_nlink > 1) {
+                close (fd);
+                if (unlink (path)) {
+                        gf_log (this->name, GF_LOG_ERROR, "failed to unlink "
+                                "rolled over changelog %s (%s)", path,
+                                strerror (errno));
+                        return -1;
+                }
+                goto again;
+        }
+
+        end = changelog_journal_end (this, fd, stbuf.st_size);
+        if (end < 0)
+                goto err;
+
+        if (end < stbuf.st_size) {
+                gf_log (this->name, GF_LOG_WARNING, "cutting the damaged "
+                        "tail off changelog %s (%"PRId64" of %"PRId64" "
+                        "bytes kept)", path, (int64_t) end,
+                        (int64_t) stbuf.st_size);
+
+                if (ftruncate (fd, end)) {
+                        gf_log (this->name, GF_LOG_ERROR, "failed to "
+                                "truncate changelog %s (%s)", path,
+                                strerror (errno));
+                        goto err;
+                }
+
+                if (stbuf.st_size > strlen (CHANGELOG_HEADER) &&
+                    (priv->buf_used + 1 + CHANGELOG_GFID_LEN <=
+                     CHANGELOG_BUF_SIZE))
+                        __changelog_append_lost (priv);
+        }
+
+        if (!end) {
+                if (changelog_write_all (fd, CHANGELOG_HEADER,
+                                         strlen (CHANGELOG_HEADER))) {
+                        gf_log (this->name, GF_LOG_ERROR, "failed to write "
+                                "changelog header to %s (%s)", path,
+                                strerror (errno));
+                        if (ftruncate (fd, 0))
+                                gf_log (this->name, GF_LOG_WARNING, "failed "
+                                        "to truncate changelog %s (%s)",
+                                        path, strerror (errno));
+                        goto err;
+                }
+        } else if (end > strlen (CHANGELOG_HEADER)) {
+                priv->records++;
+        }
+
+        priv->fd = fd;
+        return 0;
+err:
+        close (fd);
+        return -1;
+}
+
+/* Let go of a journal which could not be cut back after a failed write,
+   opening it again drops whatever got written of the failed records */
+static void
+__changelog_drop_journal (xlator_t *this, changelog_priv_t *priv)
+{
+        gf_log (this->name, GF_LOG_WARNING, "reopening changelog after "
+                "failed write");
+
+        close (priv->fd);
+        priv->fd = -1;
+        priv->reopen = _gf_false;
+}
+
+/* Stop writing to the current journal and hand it to the consumers. The
+   lock is dropped while the old journal is synced. */
+static void
+__changelog_rollover (xlator_t *this, changelog_priv_t *priv, time_t now)
+{
+        char          path[PATH_MAX]   = {0, };
+        char          rolled[PATH_MAX] = {0, };
+        int           oldfd            = -1;
+        unsigned long n                = 0;
+
+        if ((priv->fd < 0) || !priv->records)
+                return;
+
+        /* try again with the next rollover, the records stay in order */
+        if (__changelog_flush (this, priv))
+                return;
+
+        changelog_journal_path (priv, path, sizeof (path));
+
+        /* a journal not consumed yet is never replaced, not even when the
+           clock went back or this is the second rollover in a second */
+        n = max ((unsigned long) now, priv->last_rolled + 1);
+        for (;;) {
+                snprintf (rolled, sizeof (rolled), "%s/"CHANGELOG_FILE_NAME
+                          ".%lu", priv->changelog_dir, n);
+                if (!link (path, rolled))
+                        break;
+                if (errno != EEXIST) {
+                        gf_log (this->name, GF_LOG_ERROR, "failed to roll "
+                                "over changelog %s to %s (%s)", path, rolled,
+                                strerror (errno));
+                        return;
+                }
+                n++;
+        }
+        priv->last_rolled = n;
+
+        /* if this fails, opening the journal again finds it still linked
+           to the rolled over name and starts a new one */
+        if (unlink (path))
+                gf_log (this->name, GF_LOG_WARNING, "failed to unlink "
+                        "changelog %s (%s)", path, strerror (errno));
+
+        oldfd = priv->fd;
+        priv->fd = -1;
+        priv->records = 0;
+        priv->slice++;
+
+        /* on failure recording stays off until the thread manages to
+           open a journal again */
+        __changelog_open_journal (this, priv);
+
+        pthread_mutex_unlock (&priv->lock);
+        {
+                if (fsync (oldfd))
+                        gf_log (this->name, GF_LOG_WARNING, "fsync of "
+                                "changelog %s failed (%s)", rolled,
+                                strerror (errno));
+                close (oldfd);
+        }
+        pthread_mutex_lock (&priv->lock);
+
+        gf_log (this->name, GF_LOG_DEBUG, "rolled over changelog to %s",
+                rolled);
+}
+
+static void
+__changelog_sync (xlator_t *this, changelog_priv_t *priv)
+{
+        int fd = priv->fd;
+
+        __changelog_flush (this, priv);
+
+        if (fd < 0)
+                return;
+
+        pthread_mutex_unlock (&priv->lock);
+        {
+                if (fsync (fd))
+                        gf_log (this->name, GF_LOG_WARNING, "fsync of "
+                                "changelog failed (%s)", strerror (errno));
+        }
+        pthread_mutex_lock (&priv->lock);
+}
+
+static void
+__changelog_close_journal (xlator_t *this, changelog_priv_t *priv)
+{
+        int fd = priv->fd;
+
+        if (fd < 0)
+                return;
+
+        if (__changelog_flush (this, priv)) {
+                gf_log (this->name, GF_LOG_ERROR, "dropping %zu bytes of "
+                        "changelog records", priv->buf_used);
+                priv->buf_used = 0;
+        }
+        priv->fd = -1;
+        priv->reopen = _gf_false;
+
+        pthread_mutex_unlock (&priv->lock);
+        {
+                fsync (fd);
+                close (fd);
+        }
+        pthread_mutex_lock (&priv->lock);
+}
+
+static void *
+changelog_thread (void *data)
+{
+        xlator_t         *this          = data;
+        changelog_priv_t *priv          = this->private;
+        time_t            now           = 0;
+        time_t            next_rollover = 0;
+        time_t            next_fsync    = 0;
+        time_t            deadline      = 0;
+        struct timespec   ts            = {0, };
+
+        THIS = this;
+
+        pthread_mutex_lock (&priv->lock);
+
+        priv->reconfigured = _gf_true;
+
+        while (!priv->stop) {
+                now = time (NULL);
+
+                if (priv->reconfigured) {
+                        priv->reconfigured = _gf_false;
+
+                        if (priv->active && (priv->fd < 0))
+                                __changelog_open_journal (this, priv);
+                        else if (!priv->active)
+                                __changelog_close_journal (this, priv);
+
+                        next_rollover = now + priv->rollover_time;
+                        next_fsync = now + priv->fsync_interval;
+                        continue;
+                }
+
+                deadline = next_rollover;
+                if (priv->fsync_interval && (next_fsync < deadline))
+                        deadline = next_fsync;
+
+                if (now < deadline) {
+                        ts.tv_sec = deadline;
+                        ts.tv_nsec = 0;
+                        pthread_cond_timedwait (&priv->cond, &priv->lock,
+                                                &ts);
+                        continue;
+                }
+
+                if (priv->reopen)
+                        __changelog_drop_journal (this, priv);
+
+                if (priv->active && (priv->fd < 0))
+                        __changelog_open_journal (this, priv);
+
+                if (now >= next_rollover) {
+                        __changelog_rollover (this, priv, now);
+                        next_rollover = now + priv->rollover_time;
+                        next_fsync = now + priv->fsync_interval;
+                } else {
+                        __changelog_sync (this, priv);
+                        next_fsync = now + priv->fsync_interval;
+                }
+        }
+
+        __changelog_close_journal (this, priv);
+
+        pthread_mutex_unlock (&priv->lock);
+
+        return NULL;
+}
+
+void
+changelog_wake_up (changelog_priv_t *priv)
+{
+        pthread_mutex_lock (&priv->lock);
+        {
+                priv->reconfigured = _gf_true;
+                pthread_cond_signal (&priv->cond);
+        }
+        pthread_mutex_unlock (&priv->lock);
+}
+
+/* <n> of the newest journal rolled over in @dir, 0 if there is none */
+static unsigned long
+changelog_newest_journal (const char *dir)
+{
+        DIR           *dirp   = NULL;
+        struct dirent *entry  = NULL;
+        unsigned long  n      = 0;
+        unsigned long  newest = 0;
+
+        dirp = opendir (dir);
+        if (!dirp)
+                return 0;
+
+        while ((entry = readdir (dirp))) {
+                n = changelog_journal_number (entry->d_name);
+                if (n > newest)
+                        newest = n;
+        }
+
+        closedir (dirp);
+
+        return newest;
+}
+
+int
+changelog_init (xlator_t *this, changelog_priv_t *priv)
+{
+        pthread_attr_t attr = {{0, }, };
+        int            ret  = -1;
+
+        ret = mkdir_p (priv->changelog_dir, 0700, _gf_true);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "failed to create "
+                        "changelog directory %s (%s)", priv->changelog_dir,
+                        strerror (errno));
+                goto out;
+        }
+
+        priv->buf = GF_CALLOC (1, CHANGELOG_BUF_SIZE, gf_changelog_mt_buf_t);
+        if (!priv->buf) {
+                ret = -1;
+                goto out;
+        }
+
+        priv->fd = -1;
+        priv->slice = 1;
+        priv->last_rolled = changelog_newest_journal (priv->changelog_dir);
+
+        ret = pthread_attr_init (&attr);
+        if (ret)
+                goto out;
+
+        ret = pthread_attr_setstacksize (&attr, CHANGELOG_THREAD_STACK_SIZE);
+        if (ret == EINVAL)
+                gf_log (this->name, GF_LOG_WARNING,
+                        "Using default thread stack size");
+
+        ret = pthread_create (&priv->thread, &attr, changelog_thread, this);
+        pthread_attr_destroy (&attr);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "failed to create "
+                        "changelog thread (%s)", strerror (ret));
+                ret = -1;
+                goto out;
+        }
+
+        priv->thread_running = _gf_true;
+out:
+        return ret;
+}
+
+void
+changelog_cleanup (xlator_t *this, changelog_priv_t *priv)
+{
+        if (priv->thread_running) {
+                pthread_mutex_lock (&priv->lock);
+                {
+                        priv->stop = _gf_true;
+                        pthread_cond_signal (&priv->cond);
+                }
+                pthread_mutex_unlock (&priv->lock);
+
+                pthread_join (priv->thread, NULL);
+                priv->thread_running = _gf_false;
+        }
+
+        GF_FREE (priv->buf);
+        priv->buf = NULL;
+}
+
+/* Records are gathered while the journal cannot be written to. Only when
+   they do not fit any more they are dropped, and replaced by a record
+   telling the consumers so. */
+static void
+__changelog_append (xlator_t *this, changelog_priv_t *priv,
+                    const char *record, size_t len)
+{
+        if ((priv->buf_used + len > CHANGELOG_BUF_SIZE) &&
+            __changelog_flush (this, priv)) {
+                gf_log (this->name, GF_LOG_ERROR, "dropping %zu bytes of "
+                        "changelog records", priv->buf_used);
+                priv->buf_used = 0;
+                __changelog_append_lost (priv);
+        }
+
+        memcpy (priv->buf + priv->buf_used, record, len);
+        priv->buf_used += len;
+        priv->records++;
+}
+
+void
+changelog_log_record (xlator_t *this, changelog_priv_t *priv,
+                      const char *record, size_t len)
+{
+        pthread_mutex_lock (&priv->lock);
+        {
+                if (priv->active)
+                        __changelog_append (this, priv, record, len);
+        }
+        pthread_mutex_unlock (&priv->lock);
+}
+
+/* Data and metadata changes only need to be recorded once per journal, the
+   inode remembers in which slice each was last recorded: data in the upper
+   half of the context, metadata in the lower half. */
+void
+changelog_log_inode (xlator_t *this, changelog_priv_t *priv, inode_t *inode,
+                     char type)
+{
+        char         record[1 + CHANGELOG_GFID_LEN];
+        uint64_t     ctx    = 0;
+        uint32_t     slice  = 0;
+        gf_boolean_t logged = _gf_false;
+
+        if (!inode || uuid_is_null (inode->gfid))
+                return;
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                if (!priv->active)
+                        goto unlock;
+
+                LOCK (&inode->lock);
+                {
+                        __inode_ctx_get (inode, this, &ctx);
+
+                        if (type == CHANGELOG_TYPE_DATA)
+                                slice = (uint32_t) (ctx >> 32);
+                        else
+                                slice = (uint32_t) ctx;
+
+                        if (slice == priv->slice) {
+                                logged = _gf_true;
+                        } else if (type == CHANGELOG_TYPE_DATA) {
+                                ctx = ((uint64_t) priv->slice << 32) |
+                                        (ctx & 0xffffffffULL);
+                                __inode_ctx_put (inode, this, ctx);
+                        } else {
+                                ctx = (ctx & ~0xffffffffULL) | priv->slice;
+                                __inode_ctx_put (inode, this, ctx);
+                        }
+                }
+                UNLOCK (&inode->lock);
+
+                if (logged)
+                        goto unlock;
+
+                record[0] = type;
+                memcpy (record + 1, inode->gfid, CHANGELOG_GFID_LEN);
+
+                __changelog_append (this, priv, record, sizeof (record));
+        }
+unlock:
+        pthread_mutex_unlock (&priv->lock);
+}
+
+static char *
+changelog_encode_name (char *ptr, loc_t *loc)
+{
+        unsigned char *pargfid = loc->pargfid;
+        size_t         len     = 0;
+
+        if (loc->parent && !uuid_is_null (loc->parent->gfid))
+                pargfid = loc->parent->gfid;
+
+        memcpy (ptr, pargfid, CHANGELOG_GFID_LEN);
+        ptr += CHANGELOG_GFID_LEN;
+
+        len = strlen (loc->name);
+        memcpy (ptr, loc->name, len + 1);
+
+        return ptr + len + 1;
+}
+
+/* Build the record of an entry operation on @loc (and @newloc for
+   renames). A null @gfid is filled in from the reply. */
+changelog_local_t *
+changelog_entry_local (xlator_t *this, glusterfs_fop_t fop, uuid_t gfid,
+                       loc_t *loc, loc_t *newloc)
+{
+        changelog_local_t *local = NULL;
+        char              *ptr   = NULL;
+
+        if (!loc->name || (strlen (loc->name) > NAME_MAX))
+                return NULL;
+        if (newloc && (!newloc->name || (strlen (newloc->name) > NAME_MAX)))
+                return NULL;
+
+        local = mem_get0 (this->local_pool);
+        if (!local)
+                return NULL;
+
+        ptr = local->record;
+        *ptr++ = CHANGELOG_TYPE_ENTRY;
+
+        if (gfid && !uuid_is_null (gfid))
+                memcpy (ptr, gfid, CHANGELOG_GFID_LEN);
+        else
+                local->need_gfid = _gf_true;
+        ptr += CHANGELOG_GFID_LEN;
+
+        *ptr++ = (char) fop;
+
+        ptr = changelog_encode_name (ptr, loc);
+        if (newloc)
+                ptr = changelog_encode_name (ptr, newloc);
+
+        local->len = ptr - local->record;
+
+        return local;
+}
+
+void
+changelog_log_local (xlator_t *this, changelog_priv_t *priv,
+                     changelog_local_t *local, struct iatt *buf)
+{
+        if (!local)
+                return;
+
+        if (local->need_gfid) {
+                if (!buf || uuid_is_null (buf->ia_gfid))
+                        return;
+                memcpy (local->record + 1, buf->ia_gfid, CHANGELOG_GFID_LEN);
+        }
+
+        changelog_log_record (this, priv, local->record, local->len);
+}
@@ -0,0 +1,86 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CHANGELOG_HELPERS_H
+#define _CHANGELOG_HELPERS_H
+
+#include "xlator.h"
+#include "defaults.h"
+#include "changelog.h"
+#include "changelog-mem-types.h"
+
+#define CHANGELOG_THREAD_STACK_SIZE  ((size_t)(1024*1024))
+
+/* records are gathered here and written out when it fills up, at every
+   fsync-interval and at rollover */
+#define CHANGELOG_BUF_SIZE           (128 * GF_UNIT_KB)
+
+/* largest record: type, gfid, fop and two (pargfid, name) pairs */
+#define CHANGELOG_MAX_RECORD_SIZE    (1 + CHANGELOG_GFID_LEN + 1 +       \
+                                      2 * (CHANGELOG_GFID_LEN + NAME_MAX \
+                                           + 1))
+
+typedef struct changelog_priv {
+        gf_boolean_t       active;          /* recording is enabled */
+        char              *changelog_brick;
+        char              *changelog_dir;
+        uint32_t           rollover_time;   /* seconds */
+        uint32_t           fsync_interval;  /* seconds, 0 disables */
+
+        pthread_mutex_t    lock;
+        pthread_cond_t     cond;
+
+        int                fd;              /* journal being written */
+        uint32_t           slice;           /* bumped at every rollover */
+        unsigned long      last_rolled;     /* <n> of the newest journal */
+        uint64_t           records;         /* records in this slice */
+        char              *buf;
+        size_t             buf_used;
+        gf_boolean_t       reopen;          /* journal has a torn tail */
+
+        pthread_t          thread;
+        gf_boolean_t       thread_running;
+        gf_boolean_t       reconfigured;    /* wake the thread up */
+        gf_boolean_t       stop;
+} changelog_priv_t;
+
+/* A record built before the fop is wound, logged once it succeeds */
+typedef struct changelog_local {
+        char               record[CHANGELOG_MAX_RECORD_SIZE];
+        size_t             len;
+        gf_boolean_t       need_gfid;       /* gfid comes from the reply */
+} changelog_local_t;
+
+int
+changelog_init (xlator_t *this, changelog_priv_t *priv);
+
+void
+changelog_cleanup (xlator_t *this, changelog_priv_t *priv);
+
+void
+changelog_wake_up (changelog_priv_t *priv);
+
+void
+changelog_log_record (xlator_t *this, changelog_priv_t *priv,
+                      const char *record, size_t len);
+
+void
+changelog_log_inode (xlator_t *this, changelog_priv_t *priv, inode_t *inode,
+                     char type);
+
+changelog_local_t *
+changelog_entry_local (xlator_t *this, glusterfs_fop_t fop, uuid_t gfid,
+                       loc_t *loc, loc_t *newloc);
+
+void
+changelog_log_local (xlator_t *this, changelog_priv_t *priv,
+                     changelog_local_t *local, struct iatt *buf);
+
+#endif /* _CHANGELOG_HELPERS_H */
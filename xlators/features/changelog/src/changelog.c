@@ -0,0 +1,810 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "xlator.h"
+#include "defaults.h"
+#include "logging.h"
+#include "iobuf.h"
+#include "statedump.h"
+
+#include "changelog-helpers.h"
+
+/*
+ * Records every modification made on the brick into a journal, so that
+ * consumers like geo-replication learn what changed from the journals
+ * instead of crawling the whole namespace for changed xtimes.
+ *
+ * Entry operations are recorded as they succeed, together with the parent
+ * and the name they apply to. Data and metadata modifications are recorded
+ * at most once per inode in each journal.
+ */
+
+#define CHANGELOG_NOT_ACTIVE_THEN_GOTO(priv, label) do {        \
+                if (!priv->active)                              \
+                        goto label;                             \
+        } while (0)
+
+/* keys updated by translators for their own bookkeeping */
+static int
+changelog_xattr_is_internal (const char *key)
+{
+        return (!strncmp (key, "trusted.glusterfs.",
+                          strlen ("trusted.glusterfs.")) ||
+                !strncmp (key, "trusted.afr.", strlen ("trusted.afr.")));
+}
+
+static int
+changelog_xattr_check (dict_t *dict, char *key, data_t *value, void *data)
+{
+        gf_boolean_t *user = data;
+
+        if (!changelog_xattr_is_internal (key))
+                *user = _gf_true;
+
+        return 0;
+}
+
+static gf_boolean_t
+changelog_dict_has_user_xattr (dict_t *dict)
+{
+        gf_boolean_t user = _gf_false;
+
+        if (dict)
+                dict_foreach (dict, changelog_xattr_check, &user);
+
+        return user;
+}
+
+/* Entry operations */
+
+int32_t
+changelog_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, fd_t *fd,
+                      inode_t *inode, struct iatt *buf,
+                      struct iatt *preparent, struct iatt *postparent,
+                      dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (create, frame, op_ret, op_errno, fd, inode, buf,
+                             preparent, postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_create (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                  int32_t flags, mode_t mode, mode_t umask, fd_t *fd,
+                  dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_CREATE, NULL, loc,
+                                              NULL);
+wind:
+        STACK_WIND (frame, changelog_create_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->create, loc, flags, mode, umask,
+                    fd, xdata);
+        return 0;
+}
+
+int32_t
+changelog_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, inode_t *inode,
+                     struct iatt *buf, struct iatt *preparent,
+                     struct iatt *postparent, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (mknod, frame, op_ret, op_errno, inode, buf,
+                             preparent, postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_mknod (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                 mode_t mode, dev_t rdev, mode_t umask, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_MKNOD, NULL, loc,
+                                              NULL);
+wind:
+        STACK_WIND (frame, changelog_mknod_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->mknod, loc, mode, rdev, umask,
+                    xdata);
+        return 0;
+}
+
+int32_t
+changelog_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, inode_t *inode,
+                     struct iatt *buf, struct iatt *preparent,
+                     struct iatt *postparent, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (mkdir, frame, op_ret, op_errno, inode, buf,
+                             preparent, postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_mkdir (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                 mode_t mode, mode_t umask, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_MKDIR, NULL, loc,
+                                              NULL);
+wind:
+        STACK_WIND (frame, changelog_mkdir_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->mkdir, loc, mode, umask, xdata);
+        return 0;
+}
+
+int32_t
+changelog_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int32_t op_ret, int32_t op_errno, inode_t *inode,
+                       struct iatt *buf, struct iatt *preparent,
+                       struct iatt *postparent, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (symlink, frame, op_ret, op_errno, inode, buf,
+                             preparent, postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_symlink (call_frame_t *frame, xlator_t *this, const char *linkpath,
+                   loc_t *loc, mode_t umask, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_SYMLINK, NULL, loc,
+                                              NULL);
+wind:
+        STACK_WIND (frame, changelog_symlink_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->symlink, linkpath, loc, umask,
+                    xdata);
+        return 0;
+}
+
+int32_t
+changelog_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                    int32_t op_ret, int32_t op_errno, inode_t *inode,
+                    struct iatt *buf, struct iatt *preparent,
+                    struct iatt *postparent, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (link, frame, op_ret, op_errno, inode, buf,
+                             preparent, postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_link (call_frame_t *frame, xlator_t *this, loc_t *oldloc,
+                loc_t *newloc, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_LINK,
+                                              oldloc->inode ?
+                                              oldloc->inode->gfid : NULL,
+                                              newloc, NULL);
+wind:
+        STACK_WIND (frame, changelog_link_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->link, oldloc, newloc, xdata);
+        return 0;
+}
+
+int32_t
+changelog_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, struct iatt *buf,
+                      struct iatt *preoldparent, struct iatt *postoldparent,
+                      struct iatt *prenewparent, struct iatt *postnewparent,
+                      dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, buf);
+
+        STACK_UNWIND_STRICT (rename, frame, op_ret, op_errno, buf,
+                             preoldparent, postoldparent, prenewparent,
+                             postnewparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_rename (call_frame_t *frame, xlator_t *this, loc_t *oldloc,
+                  loc_t *newloc, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        frame->local = changelog_entry_local (this, GF_FOP_RENAME,
+                                              oldloc->inode ?
+                                              oldloc->inode->gfid : NULL,
+                                              oldloc, newloc);
+wind:
+        STACK_WIND (frame, changelog_rename_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->rename, oldloc, newloc, xdata);
+        return 0;
+}
+
+int32_t
+changelog_unlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno,
+                      struct iatt *preparent, struct iatt *postparent,
+                      dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, NULL);
+
+        STACK_UNWIND_STRICT (unlink, frame, op_ret, op_errno, preparent,
+                             postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_unlink (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                  int xflag, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        if (loc->inode)
+                frame->local = changelog_entry_local (this, GF_FOP_UNLINK,
+                                                      loc->inode->gfid, loc,
+                                                      NULL);
+wind:
+        STACK_WIND (frame, changelog_unlink_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->unlink, loc, xflag, xdata);
+        return 0;
+}
+
+int32_t
+changelog_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno,
+                     struct iatt *preparent, struct iatt *postparent,
+                     dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_local (this, this->private, frame->local, NULL);
+
+        STACK_UNWIND_STRICT (rmdir, frame, op_ret, op_errno, preparent,
+                             postparent, xdata);
+        return 0;
+}
+
+int32_t
+changelog_rmdir (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                 int flags, dict_t *xdata)
+{
+        changelog_priv_t *priv = this->private;
+
+        CHANGELOG_NOT_ACTIVE_THEN_GOTO (priv, wind);
+
+        if (loc->inode)
+                frame->local = changelog_entry_local (this, GF_FOP_RMDIR,
+                                                      loc->inode->gfid, loc,
+                                                      NULL);
+wind:
+        STACK_WIND (frame, changelog_rmdir_cbk, FIRST_CHILD (this),
+                    FIRST_CHILD (this)->fops->rmdir, loc, flags, xdata);
+        return 0;
+}
+
+/* Data operations, the inode is passed down as the cookie */
+
+int32_t
+changelog_writev_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                      int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                      struct iatt *postbuf, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_DATA);
+
+        STACK_UNWIND_STRICT (writev, frame, op_ret, op_errno, prebuf,
+                             postbuf, xdata);
+        return 0;
+}
+
+int32_t
+changelog_writev (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                  struct iovec *vector, int32_t count, off_t offset,
+                  uint32_t flags, struct iobref *iobref, dict_t *xdata)
+{
+        STACK_WIND_COOKIE (frame, changelog_writev_cbk, fd->inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->writev, fd, vector,
+                           count, offset, flags, iobref, xdata);
+        return 0;
+}
+
+int32_t
+changelog_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                        int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                        struct iatt *postbuf, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_DATA);
+
+        STACK_UNWIND_STRICT (truncate, frame, op_ret, op_errno, prebuf,
+                             postbuf, xdata);
+        return 0;
+}
+
+int32_t
+changelog_truncate (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                    off_t offset, dict_t *xdata)
+{
+        STACK_WIND_COOKIE (frame, changelog_truncate_cbk, loc->inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->truncate, loc, offset,
+                           xdata);
+        return 0;
+}
+
+int32_t
+changelog_ftruncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                         int32_t op_ret, int32_t op_errno,
+                         struct iatt *prebuf, struct iatt *postbuf,
+                         dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_DATA);
+
+        STACK_UNWIND_STRICT (ftruncate, frame, op_ret, op_errno, prebuf,
+                             postbuf, xdata);
+        return 0;
+}
+
+int32_t
+changelog_ftruncate (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                     off_t offset, dict_t *xdata)
+{
+        STACK_WIND_COOKIE (frame, changelog_ftruncate_cbk, fd->inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->ftruncate, fd, offset,
+                           xdata);
+        return 0;
+}
+
+/* Metadata operations */
+
+int32_t
+changelog_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int32_t op_ret, int32_t op_errno, struct iatt *preop,
+                       struct iatt *postop, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (setattr, frame, op_ret, op_errno, preop, postop,
+                             xdata);
+        return 0;
+}
+
+int32_t
+changelog_setattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                   struct iatt *stbuf, int32_t valid, dict_t *xdata)
+{
+        STACK_WIND_COOKIE (frame, changelog_setattr_cbk, loc->inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->setattr, loc, stbuf,
+                           valid, xdata);
+        return 0;
+}
+
+int32_t
+changelog_fsetattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                        int32_t op_ret, int32_t op_errno, struct iatt *preop,
+                        struct iatt *postop, dict_t *xdata)
+{
+        if (op_ret >= 0)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (fsetattr, frame, op_ret, op_errno, preop, postop,
+                             xdata);
+        return 0;
+}
+
+int32_t
+changelog_fsetattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                    struct iatt *stbuf, int32_t valid, dict_t *xdata)
+{
+        STACK_WIND_COOKIE (frame, changelog_fsetattr_cbk, fd->inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->fsetattr, fd, stbuf,
+                           valid, xdata);
+        return 0;
+}
+
+int32_t
+changelog_setxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                        int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        if ((op_ret >= 0) && cookie)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (setxattr, frame, op_ret, op_errno, xdata);
+        return 0;
+}
+
+int32_t
+changelog_setxattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                    dict_t *dict, int32_t flags, dict_t *xdata)
+{
+        inode_t *inode = NULL;
+
+        if (changelog_dict_has_user_xattr (dict))
+                inode = loc->inode;
+
+        STACK_WIND_COOKIE (frame, changelog_setxattr_cbk, inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->setxattr, loc, dict,
+                           flags, xdata);
+        return 0;
+}
+
+int32_t
+changelog_fsetxattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                         int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        if ((op_ret >= 0) && cookie)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (fsetxattr, frame, op_ret, op_errno, xdata);
+        return 0;
+}
+
+int32_t
+changelog_fsetxattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                     dict_t *dict, int32_t flags, dict_t *xdata)
+{
+        inode_t *inode = NULL;
+
+        if (changelog_dict_has_user_xattr (dict))
+                inode = fd->inode;
+
+        STACK_WIND_COOKIE (frame, changelog_fsetxattr_cbk, inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->fsetxattr, fd, dict,
+                           flags, xdata);
+        return 0;
+}
+
+int32_t
+changelog_removexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                           int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        if ((op_ret >= 0) && cookie)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (removexattr, frame, op_ret, op_errno, xdata);
+        return 0;
+}
+
+int32_t
+changelog_removexattr (call_frame_t *frame, xlator_t *this, loc_t *loc,
+                       const char *name, dict_t *xdata)
+{
+        inode_t *inode = NULL;
+
+        if (name && !changelog_xattr_is_internal (name))
+                inode = loc->inode;
+
+        STACK_WIND_COOKIE (frame, changelog_removexattr_cbk, inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->removexattr, loc, name,
+                           xdata);
+        return 0;
+}
+
+int32_t
+changelog_fremovexattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                            int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        if ((op_ret >= 0) && cookie)
+                changelog_log_inode (this, this->private, cookie,
+                                     CHANGELOG_TYPE_METADATA);
+
+        STACK_UNWIND_STRICT (fremovexattr, frame, op_ret, op_errno, xdata);
+        return 0;
+}
+
+int32_t
+changelog_fremovexattr (call_frame_t *frame, xlator_t *this, fd_t *fd,
+                        const char *name, dict_t *xdata)
+{
+        inode_t *inode = NULL;
+
+        if (name && !changelog_xattr_is_internal (name))
+                inode = fd->inode;
+
+        STACK_WIND_COOKIE (frame, changelog_fremovexattr_cbk, inode,
+                           FIRST_CHILD (this),
+                           FIRST_CHILD (this)->fops->fremovexattr, fd, name,
+                           xdata);
+        return 0;
+}
+
+int32_t
+mem_acct_init (xlator_t *this)
+{
+        int ret = -1;
+
+        if (!this)
+                return ret;
+
+        ret = xlator_mem_acct_init (this, gf_changelog_mt_end + 1);
+
+        if (ret != 0) {
+                gf_log (this->name, GF_LOG_WARNING, "Memory accounting"
+                        " init failed");
+                return ret;
+        }
+
+        return ret;
+}
+
+int
+changelog_priv_dump (xlator_t *this)
+{
+        changelog_priv_t *priv                     = this->private;
+        char              key_prefix[GF_DUMP_MAX_BUF_LEN];
+
+        if (!priv)
+                return 0;
+
+        gf_proc_dump_build_key (key_prefix, this->type, this->name);
+        gf_proc_dump_add_section (key_prefix);
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                gf_proc_dump_write ("active", "%d", priv->active);
+                gf_proc_dump_write ("changelog-dir", "%s",
+                                    priv->changelog_dir);
+                gf_proc_dump_write ("rollover-time", "%u",
+                                    priv->rollover_time);
+                gf_proc_dump_write ("fsync-interval", "%u",
+                                    priv->fsync_interval);
+                gf_proc_dump_write ("slice", "%u", priv->slice);
+                gf_proc_dump_write ("records", "%"PRIu64, priv->records);
+                gf_proc_dump_write ("buffered-bytes", "%zu", priv->buf_used);
+        }
+        pthread_mutex_unlock (&priv->lock);
+
+        return 0;
+}
+
+int
+reconfigure (xlator_t *this, dict_t *options)
+{
+        changelog_priv_t *priv           = this->private;
+        gf_boolean_t      active         = _gf_false;
+        uint32_t          rollover_time  = 0;
+        uint32_t          fsync_interval = 0;
+        int               ret            = -1;
+
+        GF_OPTION_RECONF ("changelog", active, options, bool, out);
+        GF_OPTION_RECONF ("rollover-time", rollover_time, options, uint32,
+                          out);
+        GF_OPTION_RECONF ("fsync-interval", fsync_interval, options, uint32,
+                          out);
+
+        pthread_mutex_lock (&priv->lock);
+        {
+                priv->active = active;
+                priv->rollover_time = rollover_time;
+                priv->fsync_interval = fsync_interval;
+        }
+        pthread_mutex_unlock (&priv->lock);
+
+        changelog_wake_up (priv);
+
+        ret = 0;
+out:
+        return ret;
+}
+
+int32_t
+init (xlator_t *this)
+{
+        changelog_priv_t *priv         = NULL;
+        gf_boolean_t      lock_inited  = _gf_false;
+        gf_boolean_t      cond_inited  = _gf_false;
+        int               ret          = -1;
+
+        if (!this->children || this->children->next) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "changelog translator needs a single subvolume");
+                goto out;
+        }
+
+        if (!this->parents) {
+                gf_log (this->name, GF_LOG_WARNING,
+                        "dangling volume. check volfile");
+        }
+
+        priv = GF_CALLOC (1, sizeof (*priv), gf_changelog_mt_priv_t);
+        if (!priv)
+                goto out;
+
+        this->local_pool = mem_pool_new (changelog_local_t, 64);
+        if (!this->local_pool) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "failed to create local_t's memory pool");
+                goto out;
+        }
+
+        GF_OPTION_INIT ("changelog", priv->active, bool, out);
+        GF_OPTION_INIT ("changelog-brick", priv->changelog_brick, path, out);
+        GF_OPTION_INIT ("changelog-dir", priv->changelog_dir, path, out);
+        GF_OPTION_INIT ("rollover-time", priv->rollover_time, uint32, out);
+        GF_OPTION_INIT ("fsync-interval", priv->fsync_interval, uint32, out);
+
+        if (!priv->changelog_dir) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "changelog-dir is not configured");
+                goto out;
+        }
+
+        if (!priv->rollover_time)
+                priv->rollover_time = 1;
+
+        if ((ret = pthread_mutex_init (&priv->lock, NULL)) != 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "pthread_mutex_init failed (%d)", ret);
+                goto out;
+        }
+        lock_inited = _gf_true;
+
+        if ((ret = pthread_cond_init (&priv->cond, NULL)) != 0) {
+                gf_log (this->name, GF_LOG_ERROR,
+                        "pthread_cond_init failed (%d)", ret);
+                goto out;
+        }
+        cond_inited = _gf_true;
+
+        this->private = priv;
+
+        ret = changelog_init (this, priv);
+out:
+        if (ret) {
+                if (priv) {
+                        changelog_cleanup (this, priv);
+                        if (cond_inited)
+                                pthread_cond_destroy (&priv->cond);
+                        if (lock_inited)
+                                pthread_mutex_destroy (&priv->lock);
+                        GF_FREE (priv);
+                }
+                if (this->local_pool) {
+                        mem_pool_destroy (this->local_pool);
+                        this->local_pool = NULL;
+                }
+                this->private = NULL;
+        }
+
+        return ret;
+}
+
+void
+fini (xlator_t *this)
+{
+        changelog_priv_t *priv = this->private;
+
+        if (!priv)
+                return;
+
+        changelog_cleanup (this, priv);
+
+        pthread_cond_destroy (&priv->cond);
+        pthread_mutex_destroy (&priv->lock);
+
+        if (this->local_pool) {
+                mem_pool_destroy (this->local_pool);
+                this->local_pool = NULL;
+        }
+
+        this->private = NULL;
+        GF_FREE (priv);
+
+        return;
+}
+
+struct xlator_fops fops = {
+        .create       = changelog_create,
+        .mknod        = changelog_mknod,
+        .mkdir        = changelog_mkdir,
+        .symlink      = changelog_symlink,
+        .link         = changelog_link,
+        .rename       = changelog_rename,
+        .unlink       = changelog_unlink,
+        .rmdir        = changelog_rmdir,
+        .writev       = changelog_writev,
+        .truncate     = changelog_truncate,
+        .ftruncate    = changelog_ftruncate,
+        .setattr      = changelog_setattr,
+        .fsetattr     = changelog_fsetattr,
+        .setxattr     = changelog_setxattr,
+        .fsetxattr    = changelog_fsetxattr,
+        .removexattr  = changelog_removexattr,
+        .fremovexattr = changelog_fremovexattr,
+};
+
+struct xlator_cbks cbks;
+
+struct xlator_dumpops dumpops = {
+        .priv = changelog_priv_dump,
+};
+
+struct volume_options options[] = {
+        { .key = {"changelog"},
+          .type = GF_OPTION_TYPE_BOOL,
+          .default_value = "off",
+          .description = "enable/disable change-logging"
+        },
+        { .key = {"changelog-brick"},
+          .type = GF_OPTION_TYPE_PATH,
+          .description = "brick path the changes are recorded for"
+        },
+        { .key = {"changelog-dir"},
+          .type = GF_OPTION_TYPE_PATH,
+          .description = "directory for the changelog files"
+        },
+        { .key = {"rollover-time"},
+          .type = GF_OPTION_TYPE_INT,
+          .min = 1,
+          .default_value = "15",
+          .description = "seconds between changelog rollovers"
+        },
+        { .key = {"fsync-interval"},
+          .type = GF_OPTION_TYPE_INT,
+          .min = 0,
+          .default_value = "5",
+          .description = "seconds between fsyncs of the changelog being "
+                         "written, 0 only syncs it at rollover"
+        },
+        { .key = {NULL}
+        },
+};
@@ -0,0 +1,140 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+
+#ifndef _CHANGELOG_H
+#define _CHANGELOG_H
+
+/*
+ * On-disk format of the changelog journal, shared by the translator which
+ * writes it and libgfchangelog which reads it.
+ *
+ * Each journal starts with CHANGELOG_HEADER, followed by records:
+ *
+ *   'D' <gfid>                         data of <gfid> was modified
+ *   'M' <gfid>                         metadata of <gfid> was modified
+ *   'E' <gfid> <fop> <pargfid> <name>  entry operation
+ *   'L' <null gfid>                    records were lost before this one
+ *
+ * <gfid> and <pargfid> are the 16 raw bytes of the gfid, <fop> is one byte
+ * holding the glusterfs_fop_t of the operation and <name> is a NUL
+ * terminated basename. RENAME records carry a second <pargfid> <name>
+ * pair for the destination.
+ *
+ * The journal being written is CHANGELOG_FILE_NAME in the changelog
+ * directory. At every rollover it is renamed to CHANGELOG.<n> and is not
+ * written to anymore. <n> is the time of the rollover in seconds since the
+ * epoch, or one more than the previous journal's if the clock has not moved
+ * past that, so journals sort in the order they were written and a name is
+ * never used twice.
+ *
+ * Records are only appended whole, but a crash can leave the last one torn.
+ * The translator cuts such a tail off when it opens the journal again, and
+ * libgfchangelog turns whatever cannot be decoded into an 'L' record.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "glusterfs.h"
+
+#define CHANGELOG_FILE_NAME      "CHANGELOG"
+#define CHANGELOG_VERSION        1
+#define CHANGELOG_HEADER         "GlusterFS Changelog | version: 1 | "    \
+                                 "encoding: binary\n"
+
+#define CHANGELOG_TYPE_DATA      'D'
+#define CHANGELOG_TYPE_METADATA  'M'
+#define CHANGELOG_TYPE_ENTRY     'E'
+#define CHANGELOG_TYPE_LOST      'L'
+
+#define CHANGELOG_GFID_LEN       16
+
+/* The <n> of a rolled over journal name, 0 for anything else */
+static inline unsigned long
+changelog_journal_number (const char *name)
+{
+        unsigned long  n   = 0;
+        char          *end = NULL;
+
+        if (strncmp (name, CHANGELOG_FILE_NAME".",
+                     strlen (CHANGELOG_FILE_NAME".")))
+                return 0;
+
+        name += strlen (CHANGELOG_FILE_NAME".");
+        if ((*name < '0') || (*name > '9'))
+                return 0;
+
+        errno = 0;
+        n = strtoul (name, &end, 10);
+        if (errno || *end)
+                return 0;
+
+        return n;
+}
+
+static inline size_t
+changelog_name_len (const char *ptr, size_t len)
+{
+        const char *nul = NULL;
+
+        if (len < CHANGELOG_GFID_LEN + 1)
+                return 0;
+
+        nul = memchr (ptr + CHANGELOG_GFID_LEN, '\0',
+                      len - CHANGELOG_GFID_LEN);
+        if (!nul)
+                return 0;
+
+        return (nul + 1) - ptr;
+}
+
+/* Length of the record at @ptr, 0 if the @len bytes there do not start
+   with a whole and valid record */
+static inline size_t
+changelog_record_len (const char *ptr, size_t len)
+{
+        size_t used = 1 + CHANGELOG_GFID_LEN;
+        size_t name = 0;
+        int    fop  = 0;
+
+        if (len < used)
+                return 0;
+
+        switch (ptr[0]) {
+        case CHANGELOG_TYPE_DATA:
+        case CHANGELOG_TYPE_METADATA:
+        case CHANGELOG_TYPE_LOST:
+                return used;
+
+        case CHANGELOG_TYPE_ENTRY:
+                if (len < used + 1)
+                        return 0;
+                fop = (unsigned char) ptr[used++];
+
+                name = changelog_name_len (ptr + used, len - used);
+                if (!name)
+                        return 0;
+                used += name;
+
+                if (fop == GF_FOP_RENAME) {
+                        name = changelog_name_len (ptr + used, len - used);
+                        if (!name)
+                                return 0;
+                        used += name;
+                }
+
+                return used;
+
+        default:
+                return 0;
+        }
+}
+
+#endif /* _CHANGELOG_H */
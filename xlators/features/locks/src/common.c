@@ -57,6 +57,8 @@ __allocate_domain (const char *volume)
         INIT_LIST_HEAD (&dom->blocked_entrylks);
         INIT_LIST_HEAD (&dom->inodelk_list);
         INIT_LIST_HEAD (&dom->blocked_inodelks);
+        pl_itree_init (&dom->inodelk_tree);
+        pl_itree_init (&dom->blocked_tree);
 
 out:
         if (dom && (NULL == dom->domain)) {
@@ -446,6 +448,8 @@ pl_inode_get (xlator_t *this, inode_t *inode)
 
                 INIT_LIST_HEAD (&pl_inode->dom_list);
                 INIT_LIST_HEAD (&pl_inode->ext_list);
+                INIT_LIST_HEAD (&pl_inode->blocked_ext);
+                pl_itree_init (&pl_inode->ext_tree);
                 INIT_LIST_HEAD (&pl_inode->rw_list);
                 INIT_LIST_HEAD (&pl_inode->reservelk_list);
                 INIT_LIST_HEAD (&pl_inode->blocked_reservelks);
@@ -460,6 +464,18 @@ unlock:
 }
 
 
+/* Reset the list and index linkage of a lock which is not (or is a copy
+   of a lock which is) in the inode's lock tables */
+static void
+__init_lock_links (posix_lock_t *lock)
+{
+        INIT_LIST_HEAD (&lock->list);
+        INIT_LIST_HEAD (&lock->blocked_locks);
+        INIT_LIST_HEAD (&lock->owner_list);
+        lock->owner_ent = NULL;
+        pl_itree_node_init (&lock->range);
+}
+
 /* Create a new posix_lock_t */
 posix_lock_t *
 new_posix_lock (struct gf_flock *flock, void *transport, pid_t client_pid,
@@ -491,18 +507,117 @@ new_posix_lock (struct gf_flock *flock, void *transport, pid_t client_pid,
         lock->client_pid = client_pid;
         lock->owner      = *owner;
 
-        INIT_LIST_HEAD (&lock->list);
+        __init_lock_links (lock);
 
 out:
         return lock;
 }
 
 
+static int
+pl_owner_cmp (const void *a, const void *b, void *param)
+{
+        const gf_lkowner_t *o1 = a;
+        const gf_lkowner_t *o2 = b;
+
+        if (o1->len != o2->len)
+                return (o1->len < o2->len) ? -1 : 1;
+
+        return memcmp (o1->data, o2->data, o1->len);
+}
+
+/* Returns the locks of @owner on the inode, NULL if it has none */
+pl_owner_t *
+__pl_owner_find (pl_inode_t *pl_inode, gf_lkowner_t *owner)
+{
+        if (!pl_inode->owners)
+                return NULL;
+
+        /* the owner is the first member of pl_owner_t, so it can be
+           looked up with just the lk-owner as the key */
+        return rb_find (pl_inode->owners, owner);
+}
+
+static void
+__pl_owner_link (pl_inode_t *pl_inode, posix_lock_t *lock)
+{
+        pl_owner_t  *owner = NULL;
+        void       **slot  = NULL;
+
+        if (!pl_inode->owners) {
+                pl_inode->owners = rb_create (pl_owner_cmp, NULL, NULL);
+                if (!pl_inode->owners)
+                        goto err;
+        }
+
+        owner = rb_find (pl_inode->owners, &lock->owner);
+        if (!owner) {
+                owner = GF_CALLOC (1, sizeof (*owner),
+                                   gf_locks_mt_pl_owner_t);
+                if (!owner)
+                        goto err;
+
+                owner->owner = lock->owner;
+                INIT_LIST_HEAD (&owner->locks);
+
+                slot = rb_probe (pl_inode->owners, owner);
+                if (!slot) {
+                        GF_FREE (owner);
+                        goto err;
+                }
+        }
+
+        list_add_tail (&lock->owner_list, &owner->locks);
+        lock->owner_ent = owner;
+
+        return;
+err:
+        /* flush falls back to walking all the locks of the inode */
+        pl_inode->owners_stale = _gf_true;
+}
+
+static void
+__pl_owner_unlink (pl_inode_t *pl_inode, posix_lock_t *lock)
+{
+        pl_owner_t *owner = lock->owner_ent;
+
+        if (!owner)
+                return;
+
+        list_del_init (&lock->owner_list);
+        lock->owner_ent = NULL;
+
+        if (list_empty (&owner->locks)) {
+                rb_delete (pl_inode->owners, owner);
+                GF_FREE (owner);
+        }
+}
+
+void
+pl_owners_destroy (pl_inode_t *pl_inode)
+{
+        if (pl_inode->owners)
+                rb_destroy (pl_inode->owners, NULL);
+        pl_inode->owners = NULL;
+}
+
+
 /* Delete a lock from the inode's lock list */
 void
 __delete_lock (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
         list_del_init (&lock->list);
+
+        if (!list_empty (&lock->blocked_locks)) {
+                list_del_init (&lock->blocked_locks);
+                pl_inode->blocked_ext_count--;
+        }
+
+        pl_itree_remove (&pl_inode->ext_tree, &lock->range);
+        __pl_owner_unlink (pl_inode, lock);
+
+        if (list_empty (&pl_inode->ext_list))
+                pl_inode->owners_stale = _gf_false;
 }
 
 
@@ -533,11 +648,19 @@ posix_lock_to_flock (posix_lock_t *lock, struct gf_flock *flock)
 static void
 __insert_lock (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        if (lock->blocked)
-                gettimeofday (&lock->blkd_time, NULL);
-        else
+        if (lock->blocked) {
+                /* keep the time of the first block across regrant passes */
+                if (!lock->blkd_time.tv_sec)
+                        gettimeofday (&lock->blkd_time, NULL);
+                list_add_tail (&lock->blocked_locks, &pl_inode->blocked_ext);
+                pl_inode->blocked_ext_count++;
+        } else {
                 gettimeofday (&lock->granted_time, NULL);
+                pl_itree_insert (&pl_inode->ext_tree, &lock->range,
+                                 lock->fl_start, lock->fl_end);
+        }
 
+        __pl_owner_link (pl_inode, lock);
         list_add_tail (&lock->list, &pl_inode->ext_list);
 
         return;
@@ -570,22 +693,6 @@ same_owner (posix_lock_t *l1, posix_lock_t *l2)
 }
 
 
-/* Delete all F_UNLCK locks */
-void
-__delete_unlck_locks (pl_inode_t *pl_inode)
-{
-        posix_lock_t *l = NULL;
-        posix_lock_t *tmp = NULL;
-
-        list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
-                if (l->fl_type == F_UNLCK) {
-                        __delete_lock (pl_inode, l);
-                        __destroy_lock (l);
-                }
-        }
-}
-
-
 /* Add two locks */
 static posix_lock_t *
 add_locks (posix_lock_t *l1, posix_lock_t *l2)
@@ -600,6 +707,8 @@ add_locks (posix_lock_t *l1, posix_lock_t *l2)
         sum->fl_start = min (l1->fl_start, l2->fl_start);
         sum->fl_end   = max (l1->fl_end, l2->fl_end);
 
+        __init_lock_links (sum);
+
         return sum;
 }
 
@@ -714,55 +823,62 @@ done:
         return v;
 }
 
+static int
+__conflict_match (pl_itree_node_t *node, void *data)
+{
+        posix_lock_t *lock = data;
+        posix_lock_t *l    = pl_itree_entry (node, posix_lock_t, range);
+
+        if (same_owner (l, lock))
+                return 0;
+
+        return ((l->fl_type == F_WRLCK) || (lock->fl_type == F_WRLCK));
+}
+
+static int
+__owner_match (pl_itree_node_t *node, void *data)
+{
+        return same_owner (pl_itree_entry (node, posix_lock_t, range), data);
+}
+
+/* Return the first granted lock overlapping {lock} for which {match}
+   is true, any overlapping lock if {match} is NULL */
+static posix_lock_t *
+__first_overlap_match (pl_inode_t *pl_inode, posix_lock_t *lock,
+                       pl_itree_match_t match)
+{
+        pl_itree_node_t *node = NULL;
+
+        node = pl_itree_search (&pl_inode->ext_tree, lock->fl_start,
+                                lock->fl_end, match, lock);
+        if (!node)
+                return NULL;
+
+        return pl_itree_entry (node, posix_lock_t, range);
+}
+
 static posix_lock_t *
 first_conflicting_overlap (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        posix_lock_t *l = NULL;
         posix_lock_t *conf = NULL;
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                list_for_each_entry (l, &pl_inode->ext_list, list) {
-                        if (l->blocked)
-                                continue;
-
-                        if (locks_overlap (l, lock)) {
-                                if (same_owner (l, lock))
-                                        continue;
-
-                                if ((l->fl_type == F_WRLCK) ||
-                                    (lock->fl_type == F_WRLCK)) {
-                                        conf = l;
-                                        goto unlock;
-                                }
-                        }
-                }
+                conf = __first_overlap_match (pl_inode, lock,
+                                              __conflict_match);
         }
-unlock:
         pthread_mutex_unlock (&pl_inode->mutex);
 
         return conf;
 }
 
 /*
-  Start searching from {begin}, and return the first lock that
-  conflicts, NULL if no conflict
-  If {begin} is NULL, then start from the beginning of the list
+  Return the first granted lock that overlaps {lock}, NULL if none
 */
 static posix_lock_t *
 first_overlap (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        posix_lock_t *l = NULL;
-
-        list_for_each_entry (l, &pl_inode->ext_list, list) {
-                if (l->blocked)
-                        continue;
-
-                if (locks_overlap (l, lock))
-                        return l;
-        }
-
-        return NULL;
+        return __first_overlap_match (pl_inode, lock, NULL);
 }
 
 
@@ -771,21 +887,11 @@ first_overlap (pl_inode_t *pl_inode, posix_lock_t *lock)
 static int
 __is_lock_grantable (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
-        posix_lock_t *l = NULL;
-        int           ret = 1;
-
-        list_for_each_entry (l, &pl_inode->ext_list, list) {
-                if (!l->blocked && locks_overlap (lock, l)) {
-                        if (((l->fl_type == F_WRLCK)
-                             || (lock->fl_type == F_WRLCK))
-                            && (lock->fl_type != F_UNLCK)
-                            && !same_owner (l, lock)) {
-                                ret = 0;
-                                break;
-                        }
-                }
-        }
-        return ret;
+        if (lock->fl_type == F_UNLCK)
+                return 1;
+
+        return (__first_overlap_match (pl_inode, lock,
+                                       __conflict_match) == NULL);
 }
 
 
@@ -796,77 +902,63 @@ static void
 __insert_and_merge (pl_inode_t *pl_inode, posix_lock_t *lock)
 {
         posix_lock_t  *conf = NULL;
-        posix_lock_t  *t = NULL;
         posix_lock_t  *sum = NULL;
         int            i = 0;
         struct _values v = { .locks = {0, 0, 0} };
 
-        list_for_each_entry_safe (conf, t, &pl_inode->ext_list, list) {
-                if (conf->blocked)
-                        continue;
-                if (!locks_overlap (conf, lock))
-                        continue;
-
-                if (same_owner (conf, lock)) {
-                        if (conf->fl_type == lock->fl_type) {
-                                sum = add_locks (lock, conf);
-
-                                sum->fl_type    = lock->fl_type;
-                                sum->transport  = lock->transport;
-                                sum->fd_num     = lock->fd_num;
-                                sum->client_pid = lock->client_pid;
-                                sum->owner      = lock->owner;
+        /* Only the owner's own locks are merged with or split by {lock},
+           locks of other owners were already checked not to conflict */
+        conf = __first_overlap_match (pl_inode, lock, __owner_match);
+        if (conf) {
+                if (conf->fl_type == lock->fl_type) {
+                        sum = add_locks (lock, conf);
 
-                                __delete_lock (pl_inode, conf);
-                                __destroy_lock (conf);
+                        sum->fl_type    = lock->fl_type;
+                        sum->transport  = lock->transport;
+                        sum->fd_num     = lock->fd_num;
+                        sum->client_pid = lock->client_pid;
+                        sum->owner      = lock->owner;
 
-                                __destroy_lock (lock);
-                                INIT_LIST_HEAD (&sum->list);
-                                posix_lock_to_flock (sum, &sum->user_flock);
-                                __insert_and_merge (pl_inode, sum);
+                        __delete_lock (pl_inode, conf);
+                        __destroy_lock (conf);
 
-                                return;
-                        } else {
-                                sum = add_locks (lock, conf);
+                        __destroy_lock (lock);
+                        posix_lock_to_flock (sum, &sum->user_flock);
+                        __insert_and_merge (pl_inode, sum);
 
-                                sum->fl_type    = conf->fl_type;
-                                sum->transport  = conf->transport;
-                                sum->fd_num     = conf->fd_num;
-                                sum->client_pid = conf->client_pid;
-                                sum->owner      = conf->owner;
+                        return;
+                } else {
+                        sum = add_locks (lock, conf);
 
-                                v = subtract_locks (sum, lock);
+                        sum->fl_type    = conf->fl_type;
+                        sum->transport  = conf->transport;
+                        sum->fd_num     = conf->fd_num;
+                        sum->client_pid = conf->client_pid;
+                        sum->owner      = conf->owner;
 
-                                __delete_lock (pl_inode, conf);
-                                __destroy_lock (conf);
+                        v = subtract_locks (sum, lock);
 
-                                __delete_lock (pl_inode, lock);
-                                __destroy_lock (lock);
+                        __delete_lock (pl_inode, conf);
+                        __destroy_lock (conf);
 
-                                __destroy_lock (sum);
+                        __delete_lock (pl_inode, lock);
+                        __destroy_lock (lock);
 
-                                for (i = 0; i < 3; i++) {
-                                        if (!v.locks[i])
-                                                continue;
+                        __destroy_lock (sum);
 
-                                        INIT_LIST_HEAD (&v.locks[i]->list);
-                                        posix_lock_to_flock (v.locks[i],
-                                                       &v.locks[i]->user_flock);
-                                        __insert_and_merge (pl_inode,
-                                                            v.locks[i]);
-                                }
+                        /* The F_UNLCK piece, if any, is dropped by the
+                           recursion instead of being inserted, so there is
+                           nothing left to clean up afterwards */
+                        for (i = 0; i < 3; i++) {
+                                if (!v.locks[i])
+                                        continue;
 
-                                __delete_unlck_locks (pl_inode);
-                                return;
+                                __init_lock_links (v.locks[i]);
+                                posix_lock_to_flock (v.locks[i],
+                                                     &v.locks[i]->user_flock);
+                                __insert_and_merge (pl_inode, v.locks[i]);
                         }
-                }
 
-                if (lock->fl_type == F_UNLCK) {
-                        continue;
-                }
-
-                if ((conf->fl_type == F_RDLCK) && (lock->fl_type == F_RDLCK)) {
-                        __insert_lock (pl_inode, lock);
                         return;
                 }
         }
@@ -890,15 +982,18 @@ __grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode, struct list_head *g
 
         INIT_LIST_HEAD (&tmp_list);
 
-        list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
-                if (l->blocked) {
-                        conf = first_overlap (pl_inode, l);
-                        if (conf)
-                                continue;
+        if (!pl_inode->blocked_ext_count)
+                return;
 
-                        l->blocked = 0;
-                        list_move_tail (&l->list, &tmp_list);
-                }
+        list_for_each_entry_safe (l, tmp, &pl_inode->blocked_ext,
+                                  blocked_locks) {
+                conf = first_overlap (pl_inode, l);
+                if (conf)
+                        continue;
+
+                __delete_lock (pl_inode, l);
+                l->blocked = 0;
+                list_add_tail (&l->list, &tmp_list);
         }
 
         list_for_each_entry_safe (l, tmp, &tmp_list, list) {
@@ -915,6 +1010,7 @@ __grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode, struct list_head *g
                         }
 
                         conf->frame = l->frame;
+                        conf->blkd_time = l->blkd_time;
                         l->frame = NULL;
 
                         posix_lock_to_flock (l, &conf->user_flock);
@@ -955,6 +1051,8 @@ grant_blocked_locks (xlator_t *this, pl_inode_t *pl_inode)
         list_for_each_entry_safe (lock, tmp, &granted_list, list) {
                 list_del_init (&lock->list);
 
+                pl_stats_granted (this, _gf_false, &lock->blkd_time);
+
                 pl_trace_out (this, lock->frame, NULL, NULL, F_SETLKW,
                               &lock->user_flock, 0, 0, NULL);
 
@@ -1001,6 +1099,8 @@ pl_send_prelock_unlock (xlator_t *this, pl_inode_t *pl_inode,
         list_for_each_entry_safe (lock, tmp, &granted_list, list) {
                 list_del_init (&lock->list);
 
+                pl_stats_granted (this, _gf_false, &lock->blkd_time);
+
                 pl_trace_out (this, lock->frame, NULL, NULL, F_SETLKW,
                               &lock->user_flock, 0, 0, NULL);
 
@@ -1014,11 +1114,56 @@ out:
         return ret;
 }
 
+void
+pl_stats_lock (xlator_t *this, gf_boolean_t inodelk, gf_boolean_t blocked)
+{
+        posix_locks_private_t *priv  = this->private;
+        pl_lock_stats_t       *stats = NULL;
+
+        stats = inodelk ? &priv->inodelk_stats : &priv->posixlk_stats;
+
+        LOCK (&priv->stats_lock);
+        {
+                if (blocked)
+                        stats->blocked++;
+                else
+                        stats->granted++;
+        }
+        UNLOCK (&priv->stats_lock);
+}
+
+void
+pl_stats_granted (xlator_t *this, gf_boolean_t inodelk,
+                  struct timeval *blkd_time)
+{
+        posix_locks_private_t *priv  = this->private;
+        pl_lock_stats_t       *stats = NULL;
+        struct timeval         now   = {0, };
+        uint64_t               wait  = 0;
+
+        stats = inodelk ? &priv->inodelk_stats : &priv->posixlk_stats;
+
+        gettimeofday (&now, NULL);
+        if (timercmp (&now, blkd_time, >))
+                wait = (now.tv_sec - blkd_time->tv_sec) * 1000000 +
+                        (now.tv_usec - blkd_time->tv_usec);
+
+        LOCK (&priv->stats_lock);
+        {
+                stats->waited++;
+                stats->wait_usec += wait;
+                if (wait > stats->max_wait_usec)
+                        stats->max_wait_usec = wait;
+        }
+        UNLOCK (&priv->stats_lock);
+}
+
 int
 pl_setlk (xlator_t *this, pl_inode_t *pl_inode, posix_lock_t *lock,
           int can_block)
 {
         int              ret = 0;
+        short            type = lock->fl_type;
 
         errno = 0;
 
@@ -1050,6 +1195,8 @@ pl_setlk (xlator_t *this, pl_inode_t *pl_inode, posix_lock_t *lock,
                                 lock->user_flock.l_start,
                                 lock->user_flock.l_len);
                         __insert_and_merge (pl_inode, lock);
+                        if (type != F_UNLCK)
+                                pl_stats_lock (this, _gf_false, _gf_false);
                 } else if (can_block) {
                         gf_log (this->name, GF_LOG_TRACE,
                                 "%s (pid=%d) lk-owner:%s %"PRId64" - %"PRId64" => Blocked",
@@ -1060,6 +1207,7 @@ pl_setlk (xlator_t *this, pl_inode_t *pl_inode, posix_lock_t *lock,
                                 lock->user_flock.l_len);
                         lock->blocked = 1;
                         __insert_lock (pl_inode, lock);
+                        pl_stats_lock (this, _gf_false, _gf_true);
                         ret = -1;
                 } else {
                         gf_log (this->name, GF_LOG_TRACE,
@@ -57,6 +57,12 @@ same_owner (posix_lock_t *l1, posix_lock_t *l2);
 
 void __delete_lock (pl_inode_t *, posix_lock_t *);
 
+pl_owner_t *
+__pl_owner_find (pl_inode_t *pl_inode, gf_lkowner_t *owner);
+
+void
+pl_owners_destroy (pl_inode_t *pl_inode);
+
 void __destroy_lock (posix_lock_t *);
 
 pl_dom_list_t *
@@ -66,7 +72,10 @@ void
 grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *dom);
 
 void
-__delete_inode_lock (pl_inode_lock_t *lock);
+__delete_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock);
+
+void
+__unblock_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock);
 
 void
 __pl_inodelk_unref (pl_inode_lock_t *lock);
@@ -77,6 +86,13 @@ grant_blocked_entry_locks (xlator_t *this, pl_inode_t *pl_inode,
 
 void pl_update_refkeeper (xlator_t *this, inode_t *inode);
 
+void
+pl_stats_lock (xlator_t *this, gf_boolean_t inodelk, gf_boolean_t blocked);
+
+void
+pl_stats_granted (xlator_t *this, gf_boolean_t inodelk,
+                  struct timeval *blkd_time);
+
 int32_t
 __get_inodelk_count (xlator_t *this, pl_inode_t *pl_inode);
 int32_t
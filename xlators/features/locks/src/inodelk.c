@@ -24,9 +24,17 @@
 #include "common.h"
 
 inline void
-__delete_inode_lock (pl_inode_lock_t *lock)
+__delete_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
-        list_del (&lock->list);
+        list_del_init (&lock->list);
+        pl_itree_remove (&dom->inodelk_tree, &lock->range);
+}
+
+inline void
+__unblock_inode_lock (pl_dom_list_t *dom, pl_inode_lock_t *lock)
+{
+        list_del_init (&lock->blocked_locks);
+        pl_itree_remove (&dom->blocked_tree, &lock->range);
 }
 
 static inline void
@@ -109,14 +117,6 @@ pl_print_inodelk (char *str, int size, int cmd, struct gf_flock *flock, const ch
                   (unsigned long long) flock->l_pid);
 }
 
-/* Determine if the two inodelks overlap reach other's lock regions */
-static int
-inodelk_overlap (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
-{
-        return ((l1->fl_end >= l2->fl_start) &&
-                (l2->fl_end >= l1->fl_start));
-}
-
 /* Returns true if the 2 inodelks have the same owner */
 static inline int
 same_inodelk_owner (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
@@ -125,51 +125,48 @@ same_inodelk_owner (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
                 (l1->transport  == l2->transport));
 }
 
-/* Returns true if the 2 inodelks conflict with each other */
 static int
-inodelk_conflict (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
+__inodelk_conflict_match (pl_itree_node_t *node, void *data)
+{
+        pl_inode_lock_t *l = pl_itree_entry (node, pl_inode_lock_t, range);
+
+        return (inodelk_type_conflict (data, l) &&
+                !same_inodelk_owner (data, l));
+}
+
+static int
+__inodelk_blocked_match (pl_itree_node_t *node, void *data)
 {
-        return (inodelk_overlap (l1, l2) &&
-                inodelk_type_conflict (l1, l2));
+        return inodelk_type_conflict (data, pl_itree_entry (node,
+                                                            pl_inode_lock_t,
+                                                            range));
 }
 
 /* Determine if lock is grantable or not */
 static pl_inode_lock_t *
 __inodelk_grantable (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
-        pl_inode_lock_t *l = NULL;
-        pl_inode_lock_t *ret = NULL;
-        if (list_empty (&dom->inodelk_list))
-                goto out;
-        list_for_each_entry (l, &dom->inodelk_list, list){
-                if (inodelk_conflict (lock, l) &&
-                    !same_inodelk_owner (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
-out:
-        return ret;
+        pl_itree_node_t *node = NULL;
+
+        node = pl_itree_search (&dom->inodelk_tree, lock->fl_start,
+                                lock->fl_end, __inodelk_conflict_match, lock);
+        if (!node)
+                return NULL;
+
+        return pl_itree_entry (node, pl_inode_lock_t, range);
 }
 
 static pl_inode_lock_t *
 __blocked_lock_conflict (pl_dom_list_t *dom, pl_inode_lock_t *lock)
 {
-        pl_inode_lock_t *l   = NULL;
-        pl_inode_lock_t *ret = NULL;
+        pl_itree_node_t *node = NULL;
 
-        if (list_empty (&dom->blocked_inodelks))
+        node = pl_itree_search (&dom->blocked_tree, lock->fl_start,
+                                lock->fl_end, __inodelk_blocked_match, lock);
+        if (!node)
                 return NULL;
 
-        list_for_each_entry (l, &dom->blocked_inodelks, blocked_locks) {
-                if (inodelk_conflict (lock, l)) {
-                        ret = l;
-                        goto out;
-                }
-        }
-
-out:
-        return ret;
+        return pl_itree_entry (node, pl_inode_lock_t, range);
 }
 
 static int
@@ -207,8 +204,11 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                 if (can_block == 0)
                         goto out;
 
-                gettimeofday (&lock->blkd_time, NULL);
+                if (!lock->blkd_time.tv_sec)
+                        gettimeofday (&lock->blkd_time, NULL);
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_tree, &lock->range,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "%s (pid=%d) lk-owner:%s %"PRId64" - %"PRId64" => Blocked",
@@ -227,8 +227,11 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
                 if (can_block == 0)
                         goto out;
 
-                gettimeofday (&lock->blkd_time, NULL);
+                if (!lock->blkd_time.tv_sec)
+                        gettimeofday (&lock->blkd_time, NULL);
                 list_add_tail (&lock->blocked_locks, &dom->blocked_inodelks);
+                pl_itree_insert (&dom->blocked_tree, &lock->range,
+                                 lock->fl_start, lock->fl_end);
 
                 gf_log (this->name, GF_LOG_TRACE,
                         "Lock is grantable, but blocking to prevent starvation");
@@ -246,6 +249,8 @@ __lock_inodelk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
         __pl_inodelk_ref (lock);
         gettimeofday (&lock->granted_time, NULL);
         list_add (&lock->list, &dom->inodelk_list);
+        pl_itree_insert (&dom->inodelk_tree, &lock->range,
+                         lock->fl_start, lock->fl_end);
 
         ret = 0;
 
@@ -265,16 +270,25 @@ inodelks_equal (pl_inode_lock_t *l1, pl_inode_lock_t *l2)
 }
 
 
+static int
+__inodelk_match (pl_itree_node_t *node, void *data)
+{
+        pl_inode_lock_t *l = pl_itree_entry (node, pl_inode_lock_t, range);
+
+        return (inodelks_equal (l, data) && same_inodelk_owner (l, data));
+}
+
 static pl_inode_lock_t *
 find_matching_inodelk (pl_inode_lock_t *lock, pl_dom_list_t *dom)
 {
-        pl_inode_lock_t *l = NULL;
-        list_for_each_entry (l, &dom->inodelk_list, list) {
-                if (inodelks_equal (l, lock) &&
-                    same_inodelk_owner (l, lock))
-                        return l;
-        }
-        return NULL;
+        pl_itree_node_t *node = NULL;
+
+        node = pl_itree_search (&dom->inodelk_tree, lock->fl_start,
+                                lock->fl_end, __inodelk_match, lock);
+        if (!node)
+                return NULL;
+
+        return pl_itree_entry (node, pl_inode_lock_t, range);
 }
 
 /* Set F_UNLCK removes a lock which has the exact same lock boundaries
@@ -295,7 +309,7 @@ __inode_unlock_lock (xlator_t *this, pl_inode_lock_t *lock, pl_dom_list_t *dom)
                         lkowner_utoa (&lock->owner), lock->transport);
                 goto out;
         }
-        __delete_inode_lock (conf);
+        __delete_inode_lock (dom, conf);
         gf_log (this->name, GF_LOG_DEBUG,
                 " Matching lock found for unlock %llu-%llu, by %s on %p",
                 (unsigned long long)lock->fl_start,
@@ -317,10 +331,13 @@ __grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode,
 
         INIT_LIST_HEAD (&blocked_list);
         list_splice_init (&dom->blocked_inodelks, &blocked_list);
+        /* rebuilt as the locks which stay blocked are queued again */
+        pl_itree_init (&dom->blocked_tree);
 
         list_for_each_entry_safe (bl, tmp, &blocked_list, blocked_locks) {
 
                 list_del_init (&bl->blocked_locks);
+                pl_itree_node_init (&bl->range);
 
                 bl_ret = __lock_inodelk (this, pl_inode, bl, 1, dom);
 
@@ -356,6 +373,8 @@ grant_blocked_inode_locks (xlator_t *this, pl_inode_t *pl_inode, pl_dom_list_t *
                         lock->user_flock.l_start,
                         lock->user_flock.l_len);
 
+                pl_stats_granted (this, _gf_true, &lock->blkd_time);
+
                 pl_trace_out (this, lock->frame, NULL, NULL, F_SETLKW,
                               &lock->user_flock, 0, 0, lock->volume);
 
@@ -398,7 +417,7 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                         if (l->transport != trans)
                                 continue;
 
-                        list_del_init (&l->blocked_locks);
+                        __unblock_inode_lock (dom, l);
 
                         inode_path (inode, NULL, &path);
                         if (path)
@@ -440,7 +459,7 @@ release_inode_locks_of_transport (xlator_t *this, pl_dom_list_t *dom,
                                 path = NULL;
                         }
 
-                        __delete_inode_lock (l);
+                        __delete_inode_lock (dom, l);
                         __pl_inodelk_unref (l);
                 }
         }
@@ -473,6 +492,8 @@ pl_inode_setlk (xlator_t *this, pl_inode_t *pl_inode, pl_inode_lock_t *lock,
         {
                 if (lock->fl_type != F_UNLCK) {
                         ret = __lock_inodelk (this, pl_inode, lock, can_block, dom);
+                        if ((ret == 0) || can_block)
+                                pl_stats_lock (this, _gf_true, (ret != 0));
                         if (ret == 0) {
                                 gf_log (this->name, GF_LOG_TRACE,
                                         "%s (pid=%d) (lk-owner=%s) %"PRId64" - %"PRId64" => OK",
@@ -688,17 +709,11 @@ int32_t
 __get_inodelk_count (xlator_t *this, pl_inode_t *pl_inode)
 {
         int32_t            count  = 0;
-        pl_inode_lock_t   *lock   = NULL;
         pl_dom_list_t     *dom    = NULL;
 
         list_for_each_entry (dom, &pl_inode->dom_list, inode_list) {
-                list_for_each_entry (lock, &dom->inodelk_list, list) {
-                        count++;
-                }
-                list_for_each_entry (lock, &dom->blocked_inodelks, blocked_locks) {
-                        count++;
-                }
-
+                count += dom->inodelk_tree.count;
+                count += dom->blocked_tree.count;
         }
 
         return count;
@@ -0,0 +1,248 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "itree.h"
+
+/* Nodes are ordered on start, ties are broken on the address of the node
+ * so that every node has a unique position and can be found for removal.
+ */
+static inline int
+__itree_cmp (pl_itree_node_t *a, pl_itree_node_t *b)
+{
+        if (a->start != b->start)
+                return (a->start < b->start) ? -1 : 1;
+
+        if (a == b)
+                return 0;
+
+        return ((unsigned long) a < (unsigned long) b) ? -1 : 1;
+}
+
+static inline int
+__itree_height (pl_itree_node_t *node)
+{
+        return node ? node->height : 0;
+}
+
+static void
+__itree_update (pl_itree_node_t *node)
+{
+        int lh = __itree_height (node->left);
+        int rh = __itree_height (node->right);
+
+        node->height  = 1 + ((lh > rh) ? lh : rh);
+        node->max_end = node->end;
+
+        if (node->left && node->left->max_end > node->max_end)
+                node->max_end = node->left->max_end;
+        if (node->right && node->right->max_end > node->max_end)
+                node->max_end = node->right->max_end;
+}
+
+static pl_itree_node_t *
+__itree_rotate_right (pl_itree_node_t *node)
+{
+        pl_itree_node_t *pivot = node->left;
+
+        node->left   = pivot->right;
+        pivot->right = node;
+
+        __itree_update (node);
+        __itree_update (pivot);
+
+        return pivot;
+}
+
+static pl_itree_node_t *
+__itree_rotate_left (pl_itree_node_t *node)
+{
+        pl_itree_node_t *pivot = node->right;
+
+        node->right = pivot->left;
+        pivot->left = node;
+
+        __itree_update (node);
+        __itree_update (pivot);
+
+        return pivot;
+}
+
+static pl_itree_node_t *
+__itree_balance (pl_itree_node_t *node)
+{
+        int balance = 0;
+
+        __itree_update (node);
+
+        balance = __itree_height (node->left) - __itree_height (node->right);
+
+        if (balance > 1) {
+                if (__itree_height (node->left->left) <
+                    __itree_height (node->left->right))
+                        node->left = __itree_rotate_left (node->left);
+                return __itree_rotate_right (node);
+        }
+
+        if (balance < -1) {
+                if (__itree_height (node->right->right) <
+                    __itree_height (node->right->left))
+                        node->right = __itree_rotate_right (node->right);
+                return __itree_rotate_left (node);
+        }
+
+        return node;
+}
+
+static pl_itree_node_t *
+__itree_insert (pl_itree_node_t *root, pl_itree_node_t *node)
+{
+        if (!root)
+                return node;
+
+        if (__itree_cmp (node, root) < 0)
+                root->left = __itree_insert (root->left, node);
+        else
+                root->right = __itree_insert (root->right, node);
+
+        return __itree_balance (root);
+}
+
+static pl_itree_node_t *
+__itree_remove_min (pl_itree_node_t *root, pl_itree_node_t **min)
+{
+        if (!root->left) {
+                *min = root;
+                return root->right;
+        }
+
+        root->left = __itree_remove_min (root->left, min);
+
+        return __itree_balance (root);
+}
+
+static pl_itree_node_t *
+__itree_remove (pl_itree_node_t *root, pl_itree_node_t *node, int *found)
+{
+        pl_itree_node_t *left  = NULL;
+        pl_itree_node_t *right = NULL;
+        pl_itree_node_t *min   = NULL;
+        int              cmp   = 0;
+
+        if (!root)
+                return NULL;
+
+        cmp = __itree_cmp (node, root);
+        if (cmp < 0) {
+                root->left = __itree_remove (root->left, node, found);
+        } else if (cmp > 0) {
+                root->right = __itree_remove (root->right, node, found);
+        } else {
+                *found = 1;
+
+                left  = root->left;
+                right = root->right;
+                if (!right)
+                        return left;
+
+                right = __itree_remove_min (right, &min);
+                min->left  = left;
+                min->right = right;
+
+                return __itree_balance (min);
+        }
+
+        return __itree_balance (root);
+}
+
+static pl_itree_node_t *
+__itree_search (pl_itree_node_t *node, off_t start, off_t end,
+                pl_itree_match_t match, void *data)
+{
+        pl_itree_node_t *found = NULL;
+
+        /* nothing in this subtree reaches @start */
+        if (!node || node->max_end < start)
+                return NULL;
+
+        found = __itree_search (node->left, start, end, match, data);
+        if (found)
+                return found;
+
+        /* this node and everything to its right begins after @end */
+        if (node->start > end)
+                return NULL;
+
+        if ((node->end >= start) && (!match || match (node, data)))
+                return node;
+
+        return __itree_search (node->right, start, end, match, data);
+}
+
+void
+pl_itree_init (pl_itree_t *tree)
+{
+        tree->root  = NULL;
+        tree->count = 0;
+}
+
+void
+pl_itree_node_init (pl_itree_node_t *node)
+{
+        node->left    = NULL;
+        node->right   = NULL;
+        node->start   = 0;
+        node->end     = 0;
+        node->max_end = 0;
+        node->height  = 0;
+}
+
+void
+pl_itree_insert (pl_itree_t *tree, pl_itree_node_t *node,
+                 off_t start, off_t end)
+{
+        node->left    = NULL;
+        node->right   = NULL;
+        node->start   = start;
+        node->end     = end;
+        node->max_end = end;
+        node->height  = 1;
+
+        tree->root = __itree_insert (tree->root, node);
+        tree->count++;
+}
+
+/* Removing a node which is not in @tree is a no-op */
+void
+pl_itree_remove (pl_itree_t *tree, pl_itree_node_t *node)
+{
+        int found = 0;
+
+        if (!node->height)
+                return;
+
+        tree->root = __itree_remove (tree->root, node, &found);
+        if (found) {
+                tree->count--;
+                pl_itree_node_init (node);
+        }
+}
+
+pl_itree_node_t *
+pl_itree_search (pl_itree_t *tree, off_t start, off_t end,
+                 pl_itree_match_t match, void *data)
+{
+        return __itree_search (tree->root, start, end, match, data);
+}
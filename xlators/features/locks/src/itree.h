@@ -0,0 +1,75 @@
+/*
+   Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+   This file is part of GlusterFS.
+
+   This file is licensed to you under your choice of the GNU Lesser
+   General Public License, version 3 or any later version (LGPLv3 or
+   later), or the GNU General Public License, version 2 (GPLv2), in all
+   cases as published by the Free Software Foundation.
+*/
+#ifndef __PL_ITREE_H__
+#define __PL_ITREE_H__
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/* Interval tree of byte ranges.
+ *
+ * An AVL tree ordered on the start of the range, where every node also
+ * carries the largest end offset found in its subtree. This lets all the
+ * ranges overlapping a given [start, end] be found in O(log n + k) instead
+ * of walking every lock held on the inode.
+ *
+ * Nodes are embedded in the lock structures, the tree never allocates.
+ * A node must be inserted in at most one tree at a time, and its range
+ * must not be changed while it is inserted.
+ */
+
+struct pl_itree_node {
+        struct pl_itree_node *left;
+        struct pl_itree_node *right;
+        off_t                 start;
+        off_t                 end;
+        off_t                 max_end;   /* largest end in this subtree */
+        int                   height;    /* 0 when not in a tree */
+};
+typedef struct pl_itree_node pl_itree_node_t;
+
+typedef struct {
+        pl_itree_node_t *root;
+        uint32_t         count;
+} pl_itree_t;
+
+/* Return non-zero to stop the search at @node */
+typedef int (*pl_itree_match_t) (pl_itree_node_t *node, void *data);
+
+#define pl_itree_entry(node, type, member) \
+        ((type *)((char *)(node) - (unsigned long)(&((type *)0)->member)))
+
+void
+pl_itree_init (pl_itree_t *tree);
+
+void
+pl_itree_node_init (pl_itree_node_t *node);
+
+void
+pl_itree_insert (pl_itree_t *tree, pl_itree_node_t *node,
+                 off_t start, off_t end);
+
+void
+pl_itree_remove (pl_itree_t *tree, pl_itree_node_t *node);
+
+/* Return the first node (in order of start) overlapping [start, end] for
+ * which @match returns non-zero, or the first overlapping node at all if
+ * @match is NULL.
+ */
+pl_itree_node_t *
+pl_itree_search (pl_itree_t *tree, off_t start, off_t end,
+                 pl_itree_match_t match, void *data);
+
+#endif /* __PL_ITREE_H__ */
@@ -21,12 +21,19 @@
 #include "locks-mem-types.h"
 
 #include "lkowner.h"
+#include "rb.h"
+#include "itree.h"
 
 #define POSIX_LOCKS "posix-locks"
 struct __pl_fd;
+struct __pl_owner;
 
 struct __posix_lock {
         struct list_head   list;
+        struct list_head   blocked_locks; /* list_head back to blocked_ext */
+        struct list_head   owner_list;    /* list_head back to pl_owner_t */
+        struct __pl_owner *owner_ent;
+        pl_itree_node_t    range;         /* node in ext_tree when granted */
 
         short              fl_type;
         off_t              fl_start;
@@ -55,6 +62,7 @@ typedef struct __posix_lock posix_lock_t;
 struct __pl_inode_lock {
         struct list_head   list;
         struct list_head   blocked_locks; /* list_head pointing to blocked_inodelks */
+        pl_itree_node_t    range;         /* node in inodelk_tree or blocked_tree */
         int                ref;
 
         short              fl_type;
@@ -95,6 +103,8 @@ struct __pl_dom_list_t {
         struct list_head   blocked_entrylks; /* List of all blocked entrylks */
         struct list_head   inodelk_list;     /* List of inode locks */
         struct list_head   blocked_inodelks; /* List of all blocked inodelks */
+        pl_itree_t         inodelk_tree;     /* granted inodelks by range */
+        pl_itree_t         blocked_tree;     /* blocked inodelks by range */
 };
 typedef struct __pl_dom_list_t pl_dom_list_t;
 
@@ -120,6 +130,16 @@ struct __entry_lock {
 typedef struct __entry_lock pl_entry_lock_t;
 
 
+/* All the fcntl locks held or awaited by one lk-owner on an inode, so that
+   a flush does not have to look at the locks of every other owner */
+
+struct __pl_owner {
+        gf_lkowner_t      owner;         /* key, must be the first member */
+        struct list_head  locks;         /* posix locks of this owner */
+};
+typedef struct __pl_owner pl_owner_t;
+
+
 /* The "simulated" inode. This contains a list of all the locks associated
    with this file */
 
@@ -128,6 +148,11 @@ struct __pl_inode {
 
         struct list_head dom_list;       /* list of domains */
         struct list_head ext_list;       /* list of fcntl locks */
+        pl_itree_t       ext_tree;       /* granted fcntl locks by range */
+        struct list_head blocked_ext;    /* blocked fcntl locks, in order */
+        int              blocked_ext_count;
+        struct rb_table *owners;         /* lk-owner => pl_owner_t */
+        gf_boolean_t     owners_stale;   /* some lock could not be indexed */
         struct list_head rw_list;        /* list of waiting r/w requests */
         struct list_head reservelk_list;        /* list of reservelks */
         struct list_head blocked_reservelks;        /* list of blocked reservelks */
@@ -146,10 +171,22 @@ struct __pl_fd {
 typedef struct __pl_fd pl_fd_t;
 
 
+typedef struct {
+        uint64_t        granted;        /* granted without waiting */
+        uint64_t        blocked;        /* queued behind a conflicting lock */
+        uint64_t        waited;         /* granted after being blocked */
+        uint64_t        wait_usec;      /* total time spent blocked */
+        uint64_t        max_wait_usec;
+} pl_lock_stats_t;
+
 typedef struct {
         gf_boolean_t    mandatory;      /* if mandatory locking is enabled */
         gf_boolean_t    trace;          /* trace lock requests in and out */
         char           *brickname;
+
+        gf_lock_t       stats_lock;
+        pl_lock_stats_t posixlk_stats;
+        pl_lock_stats_t inodelk_stats;
 } posix_locks_private_t;
 
 typedef struct {
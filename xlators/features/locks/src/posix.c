@@ -117,12 +117,17 @@ pl_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 }
 
 
+static int
+__other_owner_match (pl_itree_node_t *node, void *data)
+{
+        return !same_owner (pl_itree_entry (node, posix_lock_t, range), data);
+}
+
 static int
 truncate_allowed (pl_inode_t *pl_inode,
                   void *transport, pid_t client_pid,
                   gf_lkowner_t *owner, off_t offset)
 {
-        posix_lock_t *l = NULL;
         posix_lock_t  region = {.list = {0, }, };
         int           ret = 1;
 
@@ -134,15 +139,12 @@ truncate_allowed (pl_inode_t *pl_inode,
 
         pthread_mutex_lock (&pl_inode->mutex);
         {
-                list_for_each_entry (l, &pl_inode->ext_list, list) {
-                        if (!l->blocked
-                            && locks_overlap (&region, l)
-                            && !same_owner (&region, l)) {
-                                ret = 0;
-                                gf_log (POSIX_LOCKS, GF_LOG_TRACE, "Truncate "
-                                        "allowed");
-                                break;
-                        }
+                if (pl_itree_search (&pl_inode->ext_tree, region.fl_start,
+                                     region.fl_end, __other_owner_match,
+                                     &region)) {
+                        ret = 0;
+                        gf_log (POSIX_LOCKS, GF_LOG_TRACE, "Truncate "
+                                "allowed");
                 }
         }
         pthread_mutex_unlock (&pl_inode->mutex);
@@ -320,11 +322,11 @@ delete_locks_of_fd (xlator_t *this, pl_inode_t *pl_inode, fd_t *fd)
 
                list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
                        if ((l->fd_num == fd_to_fdnum(fd))) {
+                               __delete_lock (pl_inode, l);
                                if (l->blocked) {
-                                       list_move_tail (&l->list, &blocked_list);
+                                       list_add_tail (&l->list, &blocked_list);
                                        continue;
                                }
-                               __delete_lock (pl_inode, l);
                                __destroy_lock (l);
                        }
                }
@@ -345,35 +347,64 @@ delete_locks_of_fd (xlator_t *this, pl_inode_t *pl_inode, fd_t *fd)
 
 }
 
+static void
+__flush_lock (pl_inode_t *pl_inode, posix_lock_t *l)
+{
+        gf_log ("posix-locks", GF_LOG_TRACE,
+                " Flushing lock"
+                "%s (pid=%d) (lk-owner=%s) %"PRId64" - %"PRId64" state: %s",
+                l->fl_type == F_UNLCK ? "Unlock" : "Lock",
+                l->client_pid,
+                lkowner_utoa (&l->owner),
+                l->user_flock.l_start,
+                l->user_flock.l_len,
+                l->blocked == 1 ? "Blocked" : "Active");
+
+        __delete_lock (pl_inode, l);
+        __destroy_lock (l);
+}
+
 static void
 __delete_locks_of_owner (pl_inode_t *pl_inode,
                          void *transport, gf_lkowner_t *owner)
 {
         posix_lock_t *tmp = NULL;
         posix_lock_t *l = NULL;
+        pl_owner_t   *ent = NULL;
+
+        struct list_head flushed;
+
+        INIT_LIST_HEAD (&flushed);
 
         /* TODO: what if it is a blocked lock with pending l->frame */
 
-        list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
-                if (l->blocked)
-                        continue;
-                if ((l->transport == transport) &&
-                    is_same_lkowner (&l->owner, owner)) {
-                        gf_log ("posix-locks", GF_LOG_TRACE,
-                                " Flushing lock"
-                                "%s (pid=%d) (lk-owner=%s) %"PRId64" - %"PRId64" state: %s",
-                                l->fl_type == F_UNLCK ? "Unlock" : "Lock",
-                                l->client_pid,
-                                lkowner_utoa (&l->owner),
-                                l->user_flock.l_start,
-                                l->user_flock.l_len,
-                                l->blocked == 1 ? "Blocked" : "Active");
-
-                        __delete_lock (pl_inode, l);
-                        __destroy_lock (l);
+        if (pl_inode->owners_stale) {
+                list_for_each_entry_safe (l, tmp, &pl_inode->ext_list, list) {
+                        if (l->blocked)
+                                continue;
+                        if ((l->transport == transport) &&
+                            is_same_lkowner (&l->owner, owner))
+                                __flush_lock (pl_inode, l);
                 }
+
+                return;
         }
 
+        ent = __pl_owner_find (pl_inode, owner);
+        if (!ent)
+                return;
+
+        list_for_each_entry_safe (l, tmp, &ent->locks, owner_list) {
+                if (l->blocked || (l->transport != transport))
+                        continue;
+
+                list_move_tail (&l->owner_list, &flushed);
+        }
+
+        /* {ent} is freed along with the last of its locks */
+        list_for_each_entry_safe (l, tmp, &flushed, owner_list)
+                __flush_lock (pl_inode, l);
+
         return;
 }
 
@@ -1748,7 +1779,7 @@ pl_forget (xlator_t *this,
                                         "Pending inode locks found, releasing.");
 
                                 list_for_each_entry_safe (ino_l, ino_tmp, &dom->inodelk_list, list) {
-                                        __delete_inode_lock (ino_l);
+                                        __delete_inode_lock (dom, ino_l);
                                         __pl_inodelk_unref (ino_l);
                                 }
 
@@ -1801,6 +1832,7 @@ pl_forget (xlator_t *this,
 
         }
 
+        pl_owners_destroy (pl_inode);
         GF_FREE (pl_inode);
 
         return 0;
@@ -1875,15 +1907,7 @@ out:
 int32_t
 __get_posixlk_count (xlator_t *this, pl_inode_t *pl_inode)
 {
-        posix_lock_t *lock   = NULL;
-        int32_t       count  = 0;
-
-        list_for_each_entry (lock, &pl_inode->ext_list, list) {
-
-                count++;
-        }
-
-        return count;
+        return (pl_inode->ext_tree.count + pl_inode->blocked_ext_count);
 }
 
 int32_t
@@ -2442,6 +2466,8 @@ unlock:
                 count = __get_posixlk_count (this, pl_inode);
                 if (count) {
                         gf_proc_dump_write("posixlk-count", "%d", count);
+                        gf_proc_dump_write("posixlk-blocked-count", "%d",
+                                           pl_inode->blocked_ext_count);
                         __dump_posixlks (pl_inode);
                 }
         }
@@ -2461,6 +2487,54 @@ out:
         return ret;
 }
 
+static void
+pl_dump_lock_stats (const char *prefix, pl_lock_stats_t *stats)
+{
+        char key[GF_DUMP_MAX_BUF_LEN];
+
+        gf_proc_dump_build_key (key, prefix, "granted");
+        gf_proc_dump_write (key, "%"PRIu64, stats->granted);
+        gf_proc_dump_build_key (key, prefix, "blocked");
+        gf_proc_dump_write (key, "%"PRIu64, stats->blocked);
+        gf_proc_dump_build_key (key, prefix, "granted-after-wait");
+        gf_proc_dump_write (key, "%"PRIu64, stats->waited);
+        gf_proc_dump_build_key (key, prefix, "avg-wait-usec");
+        gf_proc_dump_write (key, "%"PRIu64, stats->waited ?
+                            (stats->wait_usec / stats->waited) : 0);
+        gf_proc_dump_build_key (key, prefix, "max-wait-usec");
+        gf_proc_dump_write (key, "%"PRIu64, stats->max_wait_usec);
+}
+
+int32_t
+pl_dump_priv (xlator_t *this)
+{
+        posix_locks_private_t *priv    = NULL;
+        pl_lock_stats_t        posixlk = {0, };
+        pl_lock_stats_t        inodelk = {0, };
+
+        if (!this)
+                return -1;
+
+        priv = this->private;
+        if (!priv)
+                return -1;
+
+        LOCK (&priv->stats_lock);
+        {
+                posixlk = priv->posixlk_stats;
+                inodelk = priv->inodelk_stats;
+        }
+        UNLOCK (&priv->stats_lock);
+
+        gf_proc_dump_add_section ("xlator.features.locks.%s.priv",
+                                  this->name);
+
+        pl_dump_lock_stats ("posixlk", &posixlk);
+        pl_dump_lock_stats ("inodelk", &inodelk);
+
+        return 0;
+}
+
 int32_t
 mem_acct_init (xlator_t *this)
 {
@@ -2513,6 +2587,10 @@ init (xlator_t *this)
 
         priv = GF_CALLOC (1, sizeof (*priv),
                           gf_locks_mt_posix_locks_private_t);
+        if (!priv)
+                goto out;
+
+        LOCK_INIT (&priv->stats_lock);
 
         mandatory = dict_get (this->options, "mandatory-locks");
         if (mandatory)
@@ -2557,6 +2635,7 @@ fini (xlator_t *this)
         if (!priv)
                 return 0;
         this->private = NULL;
+        LOCK_DESTROY (&priv->stats_lock);
         GF_FREE (priv->brickname);
         GF_FREE (priv);
 
@@ -2607,6 +2686,7 @@ struct xlator_fops fops = {
 
 struct xlator_dumpops dumpops = {
         .inodectx    = pl_dump_inode_priv,
+        .priv        = pl_dump_priv,
 };
 
 struct xlator_cbks cbks = {
@@ -125,6 +125,25 @@ out:
         return ret;
 }
 
+int32_t
+mq_set_ctx_batched (quota_inode_ctx_t *ctx, gf_boolean_t batched)
+{
+        int32_t   ret = -1;
+
+        if (ctx == NULL)
+                goto out;
+
+        LOCK (&ctx->lock);
+        {
+                ctx->batched = batched;
+        }
+        UNLOCK (&ctx->lock);
+
+        ret = 0;
+out:
+        return ret;
+}
+
 void
 mq_assign_lk_owner (xlator_t *this, call_frame_t *frame)
 {
@@ -1285,6 +1304,383 @@ out:
 }
 
 
+/*
+ * Batched quota propagation.
+ *
+ * Running a transaction up to the root for every write costs an inodelk,
+ * two setxattrs, a lookup and two xattrops on every ancestor. When
+ * quota-update-interval is set, mq_initiate_quota_txn () only queues the
+ * inode (once, however many times it is modified) and a thread starts the
+ * transactions of everything queued every interval. A transaction applies
+ * the difference between the size and the contribution of the inode, so
+ * one of them accounts for all the writes gathered in the meantime.
+ * Instead of climbing on by itself, a batched transaction queues the
+ * parent it updated, and the next round is started as soon as the current
+ * one is over: siblings updating the same directory are propagated once.
+ *
+ * The parent of a queued inode is marked dirty on disk as long as it has
+ * children waiting, so that after a crash its size is recomputed from its
+ * children on the next lookup, like after an interrupted transaction.
+ */
+
+int
+mq_start_quota_txn (xlator_t *this, loc_t *loc, quota_inode_ctx_t *ctx,
+                    inode_contribution_t *contri, gf_boolean_t batched);
+
+void
+mq_batch_set_dirty (xlator_t *this, inode_t *inode, int8_t dirty);
+
+int32_t
+mq_batch_dirty_done (call_frame_t *frame, void *cookie, xlator_t *this,
+                     int32_t op_ret, int32_t op_errno, dict_t *xdata)
+{
+        int32_t            ret     = -1;
+        int32_t            pending = 0;
+        int8_t             dirty   = (long) cookie;
+        quota_local_t     *local   = frame->local;
+        quota_inode_ctx_t *ctx     = NULL;
+
+        if (op_ret == -1)
+                gf_log (this->name, (op_errno == ENOENT) ? GF_LOG_DEBUG
+                        : GF_LOG_WARNING, "failed to update the dirty "
+                        "xattr of %s (%s)", local->loc.path,
+                        strerror (op_errno));
+
+        /* a child may have been queued while the xattr was being cleared,
+           and its setxattr may have reached the disk first */
+        if (!dirty && (op_ret == 0)) {
+                ret = mq_inode_ctx_get (local->loc.inode, this, &ctx);
+                if (ret == 0) {
+                        LOCK (&ctx->lock);
+                        {
+                                pending = ctx->pending_children;
+                        }
+                        UNLOCK (&ctx->lock);
+
+                        if (pending > 0)
+                                mq_batch_set_dirty (this, local->loc.inode, 1);
+                }
+        }
+
+        QUOTA_STACK_DESTROY (frame, this);
+
+        return 0;
+}
+
+/* Set the dirty xattr of @inode to @dirty without taking any lock. The
+   xattr is cleared only when no child is pending, and set again when one
+   got queued while it was being cleared. */
+void
+mq_batch_set_dirty (xlator_t *this, inode_t *inode, int8_t dirty)
+{
+        int32_t        ret   = -1;
+        call_frame_t  *frame = NULL;
+        quota_local_t *local = NULL;
+        dict_t        *dict  = NULL;
+
+        frame = create_frame (this, this->ctx->pool);
+        if (frame == NULL)
+                goto out;
+
+        local = mq_local_new ();
+        if (local == NULL)
+                goto out;
+
+        frame->local = local;
+
+        ret = mq_inode_loc_fill (NULL, inode, &local->loc);
+        if (ret < 0)
+                goto out;
+
+        uuid_copy (local->loc.gfid, inode->gfid);
+
+        dict = dict_new ();
+        if (dict == NULL) {
+                ret = -1;
+                goto out;
+        }
+
+        ret = dict_set_int8 (dict, QUOTA_DIRTY_KEY, dirty);
+        if (ret < 0)
+                goto out;
+
+        STACK_WIND_COOKIE (frame, mq_batch_dirty_done, (void *) (long) dirty,
+                           FIRST_CHILD(this),
+                           FIRST_CHILD(this)->fops->setxattr, &local->loc,
+                           dict, 0, NULL);
+        ret = 0;
+out:
+        if (ret < 0 && frame)
+                QUOTA_STACK_DESTROY (frame, this);
+
+        if (dict)
+                dict_unref (dict);
+}
+
+/* Drop the count held on @parent by a queued child, return the number
+   of children still pending */
+int32_t
+mq_batch_drop_pending (xlator_t *this, inode_t *parent, gf_boolean_t undirty)
+{
+        int32_t            ret     = -1;
+        int32_t            pending = 0;
+        quota_inode_ctx_t *ctx     = NULL;
+
+        ret = mq_inode_ctx_get (parent, this, &ctx);
+        if (ret < 0)
+                return 0;
+
+        LOCK (&ctx->lock);
+        {
+                if (ctx->pending_children > 0)
+                        ctx->pending_children--;
+                pending = ctx->pending_children;
+        }
+        UNLOCK (&ctx->lock);
+
+        if (!pending && undirty)
+                mq_batch_set_dirty (this, parent, 0);
+
+        return pending;
+}
+
+int32_t
+mq_batch_release_pending (xlator_t *this, quota_local_t *local,
+                          gf_boolean_t undirty)
+{
+        local->pending_held = _gf_false;
+
+        return mq_batch_drop_pending (this, local->parent_loc.inode, undirty);
+}
+
+void
+mq_batch_entry_free (quota_batch_entry_t *entry)
+{
+        inode_unref (entry->inode);
+        inode_unref (entry->parent);
+        GF_FREE (entry);
+}
+
+/* Queue the size change of @inode to be propagated to @parent. Returns
+   0 if it is queued, or already was. */
+int32_t
+mq_batch_enqueue (xlator_t *this, inode_t *inode, inode_t *parent)
+{
+        int32_t              ret        = -1;
+        int32_t              pending    = 0;
+        gf_boolean_t         queued     = _gf_false;
+        marker_conf_t       *priv       = NULL;
+        quota_inode_ctx_t   *ctx        = NULL;
+        quota_inode_ctx_t   *parent_ctx = NULL;
+        quota_batch_entry_t *entry      = NULL;
+
+        priv = this->private;
+
+        if (!inode || !parent)
+                goto out;
+
+        ret = mq_inode_ctx_get (inode, this, &ctx);
+        if (ret < 0)
+                goto out;
+
+        ret = mq_inode_ctx_get (parent, this, &parent_ctx);
+        if (ret < 0)
+                goto out;
+
+        LOCK (&ctx->lock);
+        {
+                queued = ctx->batched;
+                ctx->batched = _gf_true;
+        }
+        UNLOCK (&ctx->lock);
+
+        if (queued) {
+                ret = 0;
+                goto out;
+        }
+
+        QUOTA_ALLOC (entry, quota_batch_entry_t, ret);
+        if (ret < 0) {
+                mq_set_ctx_batched (ctx, _gf_false);
+                goto out;
+        }
+
+        INIT_LIST_HEAD (&entry->list);
+        entry->inode = inode_ref (inode);
+        entry->parent = inode_ref (parent);
+
+        LOCK (&parent_ctx->lock);
+        {
+                pending = ++parent_ctx->pending_children;
+        }
+        UNLOCK (&parent_ctx->lock);
+
+        if (pending == 1)
+                mq_batch_set_dirty (this, parent, 1);
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+        {
+                list_add_tail (&entry->list, &priv->quota_batch_queue);
+                if (!priv->quota_update_interval)
+                        pthread_cond_signal (&priv->quota_batch_cond);
+        }
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+
+        ret = 0;
+out:
+        return ret;
+}
+
+/* A batched txn is over: queue the directory it updated and start the
+   next round once all the txns of this one are done */
+void
+mq_batch_txn_done (xlator_t *this, quota_local_t *local)
+{
+        marker_conf_t *priv = this->private;
+
+        if (!local->err && local->delta &&
+            local->parent_loc.inode && local->parent_loc.parent)
+                mq_batch_enqueue (this, local->parent_loc.inode,
+                                  local->parent_loc.parent);
+
+        if (local->pending_held)
+                mq_batch_release_pending (this, local, _gf_false);
+
+        local->batched = _gf_false;
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+        {
+                if ((--priv->quota_batch_inflight == 0) &&
+                    !list_empty (&priv->quota_batch_queue)) {
+                        priv->quota_batch_kick = _gf_true;
+                        pthread_cond_signal (&priv->quota_batch_cond);
+                }
+        }
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+}
+
+void
+mq_batch_start_txn (xlator_t *this, quota_batch_entry_t *entry)
+{
+        int32_t               ret    = -1;
+        gf_boolean_t          status = _gf_true;
+        marker_conf_t        *priv   = NULL;
+        quota_inode_ctx_t    *ctx    = NULL;
+        inode_contribution_t *contri = NULL;
+        loc_t                 loc    = {0, };
+
+        priv = this->private;
+
+        ret = mq_inode_ctx_get (entry->inode, this, &ctx);
+        if (ret < 0)
+                goto drop;
+
+        mq_set_ctx_batched (ctx, _gf_false);
+
+        /* fails when the inode got unlinked, its contribution has been
+           taken off the parent already */
+        ret = mq_inode_loc_fill ((char *) entry->parent->gfid, entry->inode,
+                                 &loc);
+        if (ret < 0)
+                goto drop;
+
+        contri = mq_get_contribution_node (entry->parent, ctx);
+        if (contri == NULL)
+                goto drop;
+
+        ret = mq_test_and_set_ctx_updation_status (ctx, &status);
+        if (ret < 0)
+                goto drop;
+
+        if (status == _gf_true) {
+                /* a txn is already running on it, retry next round */
+                mq_batch_enqueue (this, entry->inode, entry->parent);
+                goto drop;
+        }
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+        {
+                priv->quota_batch_inflight++;
+        }
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+
+        ret = mq_start_quota_txn (this, &loc, ctx, contri, _gf_true);
+        if (ret == 0)
+                goto out;
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+        {
+                priv->quota_batch_inflight--;
+        }
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+drop:
+        mq_batch_drop_pending (this, entry->parent, _gf_true);
+out:
+        loc_wipe (&loc);
+}
+
+void *
+mq_batch_worker (void *data)
+{
+        xlator_t            *this     = data;
+        marker_conf_t       *priv     = NULL;
+        quota_batch_entry_t *entry    = NULL;
+        quota_batch_entry_t *tmp      = NULL;
+        time_t               now      = 0;
+        time_t               deadline = 0;
+        struct timespec      ts       = {0, };
+        struct list_head     entries;
+
+        THIS = this;
+        priv = this->private;
+
+        INIT_LIST_HEAD (&entries);
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+
+        while (!priv->quota_batch_stop) {
+                now = time (NULL);
+
+                if (priv->quota_update_interval && !priv->quota_batch_kick
+                    && (now < deadline)) {
+                        ts.tv_sec = deadline;
+                        ts.tv_nsec = 0;
+                        pthread_cond_timedwait (&priv->quota_batch_cond,
+                                                &priv->quota_batch_mutex,
+                                                &ts);
+                        continue;
+                }
+
+                /* batching got disabled, only drain what is left */
+                if (!priv->quota_update_interval &&
+                    list_empty (&priv->quota_batch_queue)) {
+                        pthread_cond_wait (&priv->quota_batch_cond,
+                                           &priv->quota_batch_mutex);
+                        continue;
+                }
+
+                priv->quota_batch_kick = _gf_false;
+                deadline = now + priv->quota_update_interval;
+
+                list_splice_init (&priv->quota_batch_queue, &entries);
+
+                pthread_mutex_unlock (&priv->quota_batch_mutex);
+                {
+                        list_for_each_entry_safe (entry, tmp, &entries,
+                                                  list) {
+                                list_del_init (&entry->list);
+                                mq_batch_start_txn (this, entry);
+                                mq_batch_entry_free (entry);
+                        }
+                }
+                pthread_mutex_lock (&priv->quota_batch_mutex);
+        }
+
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+
+        return NULL;
+}
+
 int32_t
 mq_xattr_updation_done (call_frame_t *frame,
                         void *cookie,
@@ -1314,6 +1710,8 @@ mq_inodelk_cbk (call_frame_t *frame, void *cookie,
                                 "unlocking failed on path (%s)(%s)",
                                 local->parent_loc.path, strerror (op_errno));
                 }
+                if (local->batched)
+                        mq_batch_txn_done (this, local);
                 mq_xattr_updation_done (frame, NULL, this, 0, 0, NULL, NULL);
 
                 return 0;
@@ -1322,6 +1720,12 @@ mq_inodelk_cbk (call_frame_t *frame, void *cookie,
         gf_log (this->name, GF_LOG_DEBUG,
                 "inodelk released on %s", local->parent_loc.path);
 
+        if (local->batched) {
+                mq_batch_txn_done (this, local);
+                mq_xattr_updation_done (frame, NULL, this, 0, 0, NULL, NULL);
+                goto out;
+        }
+
         if ((strcmp (local->parent_loc.path, "/") == 0)
             || (local->delta == 0)) {
                 mq_xattr_updation_done (frame, NULL, this, 0, 0, NULL, NULL);
@@ -1369,6 +1773,9 @@ mq_release_parent_lock (call_frame_t *frame, void *cookie,
                                   strerror (local->err));
         }
 
+        if (local->pending_held)
+                mq_batch_release_pending (this, local, _gf_false);
+
         ret = mq_inode_ctx_get (local->parent_loc.inode, this, &ctx);
         if (ret < 0)
                 goto wind;
@@ -1455,6 +1862,12 @@ mq_mark_undirty (call_frame_t *frame,
                 UNLOCK (&ctx->lock);
         }
 
+        if (local->pending_held &&
+            (mq_batch_release_pending (this, local, _gf_false) > 0)) {
+                mq_release_parent_lock (frame, NULL, this, 0, 0, NULL);
+                return 0;
+        }
+
         newdict = dict_new ();
         if (!newdict) {
                 op_errno = ENOMEM;
@@ -1905,7 +2318,8 @@ fr_destroy:
 int
 mq_start_quota_txn (xlator_t *this, loc_t *loc,
                     quota_inode_ctx_t *ctx,
-                    inode_contribution_t *contri)
+                    inode_contribution_t *contri,
+                    gf_boolean_t batched)
 {
         int32_t        ret      = -1;
         call_frame_t  *frame    = NULL;
@@ -1934,6 +2348,8 @@ mq_start_quota_txn (xlator_t *this, loc_t *loc,
 
         local->ctx = ctx;
         local->contri = contri;
+        local->batched = batched;
+        local->pending_held = batched;
 
         ret = mq_get_lock_on_parent (frame, this);
         if (ret == -1)
@@ -1955,6 +2371,7 @@ mq_initiate_quota_txn (xlator_t *this, loc_t *loc)
 {
         int32_t               ret          = -1;
         gf_boolean_t          status       = _gf_false;
+        marker_conf_t        *priv         = NULL;
         quota_inode_ctx_t    *ctx          = NULL;
         inode_contribution_t *contribution = NULL;
 
@@ -1962,6 +2379,8 @@ mq_initiate_quota_txn (xlator_t *this, loc_t *loc)
         GF_VALIDATE_OR_GOTO ("marker", loc, out);
         GF_VALIDATE_OR_GOTO ("marker", loc->inode, out);
 
+        priv = this->private;
+
         ret = mq_inode_ctx_get (loc->inode, this, &ctx);
         if (ret == -1) {
                 gf_log (this->name, GF_LOG_WARNING,
@@ -1974,6 +2393,12 @@ mq_initiate_quota_txn (xlator_t *this, loc_t *loc)
         if (contribution == NULL)
                 goto out;
 
+        if (priv->quota_update_interval &&
+            (mq_batch_enqueue (this, loc->inode, loc->parent) == 0)) {
+                ret = 0;
+                goto out;
+        }
+
         /* To improve performance, donot start another transaction
          * if one is already in progress for same inode
          */
@@ -1984,7 +2409,7 @@ mq_initiate_quota_txn (xlator_t *this, loc_t *loc)
                 goto out;
 
         if (status == _gf_false) {
-                mq_start_quota_txn (this, loc, ctx, contribution);
+                mq_start_quota_txn (this, loc, ctx, contribution, _gf_false);
         }
 
         ret = 0;
@@ -2074,6 +2499,11 @@ mq_inspect_directory_xattr (xlator_t *this,
                 ctx->size = ntoh64 (*size);
                 ctx->dirty = dirty;
                 size_int = ctx->size;
+
+                /* dirty only because of children queued for batched
+                   propagation, not a leftover of a crash */
+                if (ctx->pending_children)
+                        dirty = 0;
         }
         UNLOCK (&ctx->lock);
 
@@ -2235,8 +2665,10 @@ _mq_inode_remove_done (call_frame_t *frame, void *cookie, xlator_t *this,
         int32_t        ret                = 0;
         char           contri_key [512]   = {0, };
         quota_local_t *local              = NULL;
+        marker_conf_t *priv               = NULL;
 
         local = (quota_local_t *) frame->local;
+        priv = this->private;
 
         if (op_ret == -1 || local->err == -1) {
                 mq_removexattr_cbk (frame, NULL, this, -1, 0, NULL);
@@ -2261,7 +2693,13 @@ _mq_inode_remove_done (call_frame_t *frame, void *cookie, xlator_t *this,
                 if (ret < 0)
                         goto out;
 
-                mq_start_quota_txn (this, &local->loc, local->ctx, local->contri);
+                if (priv->quota_update_interval &&
+                    (mq_batch_enqueue (this, local->loc.inode,
+                                       local->loc.parent) == 0))
+                        goto out;
+
+                mq_start_quota_txn (this, &local->loc, local->ctx,
+                                    local->contri, _gf_false);
         }
 out:
         mq_local_unref (this, local);
@@ -2466,9 +2904,113 @@ out:
 
 
 int32_t
-init_quota_priv (xlator_t *this)
+init_quota_priv (xlator_t *this, dict_t *options)
 {
-        return 0;
+        int32_t        ret      = -1;
+        uint32_t       interval = 0;
+        data_t        *data     = NULL;
+        marker_conf_t *priv     = NULL;
+
+        priv = this->private;
+
+        data = dict_get (options, "quota-update-interval");
+        if (data) {
+                ret = gf_string2time (data->data, &interval);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "invalid quota-update-interval %s",
+                                data->data);
+                        goto out;
+                }
+        }
+
+        if (!priv->quota_batch_inited) {
+                INIT_LIST_HEAD (&priv->quota_batch_queue);
+
+                ret = pthread_mutex_init (&priv->quota_batch_mutex, NULL);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "pthread_mutex_init failed (%d)", ret);
+                        goto out;
+                }
+
+                ret = pthread_cond_init (&priv->quota_batch_cond, NULL);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR,
+                                "pthread_cond_init failed (%d)", ret);
+                        pthread_mutex_destroy (&priv->quota_batch_mutex);
+                        goto out;
+                }
+
+                priv->quota_batch_inited = _gf_true;
+        }
+
+        pthread_mutex_lock (&priv->quota_batch_mutex);
+        {
+                priv->quota_update_interval = interval;
+                priv->quota_batch_kick = _gf_true;
+                pthread_cond_signal (&priv->quota_batch_cond);
+        }
+        pthread_mutex_unlock (&priv->quota_batch_mutex);
+
+        if (interval && !priv->quota_batch_running) {
+                ret = pthread_create (&priv->quota_batch_thread, NULL,
+                                      mq_batch_worker, this);
+                if (ret) {
+                        gf_log (this->name, GF_LOG_ERROR, "failed to start "
+                                "the quota update thread (%s)",
+                                strerror (ret));
+                        pthread_mutex_lock (&priv->quota_batch_mutex);
+                        {
+                                priv->quota_update_interval = 0;
+                        }
+                        pthread_mutex_unlock (&priv->quota_batch_mutex);
+                        ret = -1;
+                        goto out;
+                }
+
+                priv->quota_batch_running = _gf_true;
+        }
+
+        ret = 0;
+out:
+        return ret;
+}
+
+void
+mq_batch_fini (xlator_t *this)
+{
+        marker_conf_t       *priv  = NULL;
+        quota_batch_entry_t *entry = NULL;
+        quota_batch_entry_t *tmp   = NULL;
+
+        priv = this->private;
+
+        if (!priv->quota_batch_inited)
+                return;
+
+        if (priv->quota_batch_running) {
+                pthread_mutex_lock (&priv->quota_batch_mutex);
+                {
+                        priv->quota_batch_stop = _gf_true;
+                        pthread_cond_signal (&priv->quota_batch_cond);
+                }
+                pthread_mutex_unlock (&priv->quota_batch_mutex);
+
+                pthread_join (priv->quota_batch_thread, NULL);
+                priv->quota_batch_running = _gf_false;
+        }
+
+        /* whatever is left is reconciled from the dirty parents later */
+        list_for_each_entry_safe (entry, tmp, &priv->quota_batch_queue,
+                                  list) {
+                list_del_init (&entry->list);
+                mq_batch_entry_free (entry);
+        }
+
+        pthread_cond_destroy (&priv->quota_batch_cond);
+        pthread_mutex_destroy (&priv->quota_batch_mutex);
+        priv->quota_batch_inited = _gf_false;
 }
 
 
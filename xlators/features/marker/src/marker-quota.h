@@ -81,6 +81,11 @@ struct quota_inode_ctx {
         int64_t                size;
         int8_t                 dirty;
         gf_boolean_t           updation_status;
+        gf_boolean_t           batched;          /* queued for propagation */
+        int32_t                pending_children; /* children queued or in a
+                                                    batched txn, the
+                                                    directory is kept dirty
+                                                    on disk meanwhile */
         gf_lock_t              lock;
         struct list_head       contribution_head;
 };
@@ -94,6 +99,14 @@ struct inode_contribution {
 };
 typedef struct inode_contribution inode_contribution_t;
 
+/* An inode whose size change is waiting to be propagated to @parent */
+struct quota_batch_entry {
+        struct list_head list;
+        inode_t         *inode;
+        inode_t         *parent;
+};
+typedef struct quota_batch_entry quota_batch_entry_t;
+
 int32_t
 mq_get_lock_on_parent (call_frame_t *, xlator_t *);
 
@@ -101,7 +114,10 @@ int32_t
 mq_req_xattr (xlator_t *, loc_t *, dict_t *);
 
 int32_t
-init_quota_priv (xlator_t *);
+init_quota_priv (xlator_t *, dict_t *);
+
+void
+mq_batch_fini (xlator_t *);
 
 int32_t
 mq_xattr_state (xlator_t *, loc_t *, dict_t *, struct iatt);
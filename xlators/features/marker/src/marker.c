@@ -2433,6 +2433,8 @@ marker_priv_cleanup (xlator_t *this)
 
         marker_xtime_priv_cleanup (this);
 
+        mq_batch_fini (this);
+
         LOCK_DESTROY (&priv->lock);
 
         GF_FREE (priv);
@@ -2461,7 +2463,7 @@ reconfigure (xlator_t *this, dict_t *options)
         if (data) {
                 ret = gf_string2boolean (data->data, &flag);
                 if (ret == 0 && flag == _gf_true) {
-                        ret = init_quota_priv (this);
+                        ret = init_quota_priv (this, options);
                         if (ret < 0) {
                                 gf_log (this->name, GF_LOG_WARNING,
                                         "failed to initialize quota private");
@@ -2527,7 +2529,7 @@ init (xlator_t *this)
         if (data) {
                 ret = gf_string2boolean (data->data, &flag);
                 if (ret == 0 && flag == _gf_true) {
-                        ret = init_quota_priv (this);
+                        ret = init_quota_priv (this, options);
                         if (ret < 0)
                                 goto err;
 
@@ -2618,6 +2620,13 @@ struct volume_options options[] = {
         {.key = {"volume-uuid"}},
         {.key = {"timestamp-file"}},
         {.key = {"quota"}},
+        {.key = {"quota-update-interval"},
+         .type = GF_OPTION_TYPE_TIME,
+         .default_value = "0",
+         .description = "Propagate quota size changes in batches every so "
+                        "many seconds instead of at every modification, "
+                        "0 disables batching."
+        },
         {.key = {"xtime"}},
         {.key = {NULL}}
 };
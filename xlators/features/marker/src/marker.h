@@ -108,6 +108,9 @@ struct marker_local{
 
         quota_inode_ctx_t    *ctx;
         inode_contribution_t *contri;
+        gf_boolean_t          batched;      /* txn started by the batcher */
+        gf_boolean_t          pending_held; /* holds a pending_children
+                                               count on the parent */
 
         int xflag;
 };
@@ -130,6 +133,18 @@ struct marker_conf{
         char        *marker_xattr;
         uint64_t     quota_lk_owner;
         gf_lock_t    lock;
+
+        /* batched quota propagation, see mq_batch_enqueue () */
+        uint32_t          quota_update_interval; /* seconds, 0 disables */
+        gf_boolean_t      quota_batch_inited;
+        gf_boolean_t      quota_batch_running;
+        gf_boolean_t      quota_batch_stop;
+        gf_boolean_t      quota_batch_kick;
+        int32_t           quota_batch_inflight;
+        struct list_head  quota_batch_queue;
+        pthread_t         quota_batch_thread;
+        pthread_mutex_t   quota_batch_mutex;
+        pthread_cond_t    quota_batch_cond;
 };
 typedef struct marker_conf marker_conf_t;
 
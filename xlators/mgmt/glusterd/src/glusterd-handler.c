@@ -699,6 +699,239 @@ out:
         return ret;
 }
 
+/* Volume transactions come from glusterds that take volume locks, see
+ * gd_sync_task_begin (). Their stage and commit requests are served right
+ * here instead of through the op state machine, which only knows of one
+ * transaction at a time.
+ */
+static int
+glusterd_volume_op_req_get (rpcsvc_request_t *req, glusterd_op_t *op,
+                            uuid_t uuid, dict_t **dict)
+{
+        int                      ret      = -1;
+        gd1_mgmt_stage_op_req    op_req   = {{0},};
+        glusterd_req_ctx_t      *req_ctx  = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+        xlator_t                *this     = NULL;
+
+        this = THIS;
+
+        //the structures should always be equal
+        GF_ASSERT (sizeof (gd1_mgmt_commit_op_req) == sizeof (gd1_mgmt_stage_op_req));
+        ret = xdr_to_generic (req->msg[0], &op_req,
+                              (xdrproc_t)xdr_gd1_mgmt_stage_op_req);
+        if (ret < 0) {
+                gf_log (this->name, GF_LOG_ERROR, "Failed to decode volume "
+                        "transaction request received from peer");
+                req->rpc_err = GARBAGE_ARGS;
+                goto out;
+        }
+
+        if (glusterd_friend_find_by_uuid (op_req.uuid, &peerinfo)) {
+                gf_log (this->name, GF_LOG_WARNING, "%s doesn't "
+                        "belong to the cluster. Ignoring request.",
+                        uuid_utoa (op_req.uuid));
+                ret = -1;
+                goto out;
+        }
+
+        ret = glusterd_req_ctx_create (req, op_req.op, op_req.uuid,
+                                       op_req.buf.buf_val, op_req.buf.buf_len,
+                                       gf_gld_mt_op_stage_ctx_t, &req_ctx);
+        if (ret)
+                goto out;
+
+        *op = req_ctx->op;
+        uuid_copy (uuid, req_ctx->uuid);
+        *dict = req_ctx->dict;
+        GF_FREE (req_ctx);
+out:
+        free (op_req.buf.buf_val);//malloced by xdr
+        return ret;
+}
+
+/* Staging and commit are done under the volume lock of the originator */
+static int
+glusterd_volume_op_check_lock (glusterd_op_t op, uuid_t uuid, dict_t *dict,
+                               char **op_errstr)
+{
+        int     ret     = 0;
+        char   *volname = NULL;
+
+        ret = dict_get_str (dict, "volname", &volname);
+        if (ret || !glusterd_volume_is_locked_by (volname, uuid)) {
+                gf_asprintf (op_errstr, "Volume %s is not locked by %s",
+                             volname ? volname : "(null)", uuid_utoa (uuid));
+                gf_log (THIS->name, GF_LOG_ERROR, "%s", *op_errstr);
+                ret = -1;
+        }
+
+        return ret;
+}
+
+static int
+glusterd_handle_volume_lock_common (rpcsvc_request_t *req, gf_boolean_t lock)
+{
+        int32_t                  ret      = -1;
+        int32_t                  status   = -1;
+        glusterd_op_t            op       = GD_OP_NONE;
+        uuid_t                   uuid     = {0,};
+        dict_t                  *dict     = NULL;
+        char                    *volname  = NULL;
+        xlator_t                *this     = NULL;
+
+        this = THIS;
+        GF_ASSERT (req);
+
+        ret = glusterd_volume_op_req_get (req, &op, uuid, &dict);
+        if (ret)
+                goto out;
+
+        gf_log (this->name, GF_LOG_DEBUG, "Received volume %s for '%s' from "
+                "uuid: %s", lock ? "LOCK" : "UNLOCK", gd_op_list[op],
+                uuid_utoa (uuid));
+
+        ret = dict_get_str (dict, "volname", &volname);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "volname is not present in "
+                        "the lock request");
+                goto respond;
+        }
+
+        if (lock)
+                status = glusterd_volume_lock (volname, uuid,
+                                               GD_OP_VOLUME_LOCK_SHARED (op));
+        else
+                status = glusterd_volume_unlock (volname, uuid);
+
+respond:
+        if (lock)
+                ret = glusterd_op_lock_send_resp (req, status);
+        else
+                ret = glusterd_op_unlock_send_resp (req, status);
+out:
+        if (dict)
+                dict_unref (dict);
+        return ret;
+}
+
+int
+glusterd_handle_volume_lock (rpcsvc_request_t *req)
+{
+        return glusterd_handle_volume_lock_common (req, _gf_true);
+}
+
+int
+glusterd_handle_volume_unlock (rpcsvc_request_t *req)
+{
+        return glusterd_handle_volume_lock_common (req, _gf_false);
+}
+
+int
+glusterd_handle_volume_stage_op (rpcsvc_request_t *req)
+{
+        int32_t                  ret       = -1;
+        int32_t                  status    = 0;
+        glusterd_op_t            op        = GD_OP_NONE;
+        uuid_t                   uuid      = {0,};
+        dict_t                  *dict      = NULL;
+        dict_t                  *rsp_dict  = NULL;
+        char                    *op_errstr = NULL;
+        xlator_t                *this      = NULL;
+
+        this = THIS;
+        GF_ASSERT (req);
+
+        ret = glusterd_volume_op_req_get (req, &op, uuid, &dict);
+        if (ret)
+                goto out;
+
+        rsp_dict = dict_new ();
+        if (!rsp_dict) {
+                ret = -1;
+                goto out;
+        }
+
+        status = glusterd_volume_op_check_lock (op, uuid, dict, &op_errstr);
+        if (!status)
+                status = glusterd_op_stage_validate (op, dict, &op_errstr,
+                                                     rsp_dict);
+        if (status)
+                gf_log (this->name, GF_LOG_ERROR, "Stage failed on operation"
+                        " 'Volume %s', Status : %d", gd_op_list[op], status);
+
+        ret = glusterd_op_stage_send_resp (req, op, status, op_errstr,
+                                           rsp_dict);
+out:
+        if (op_errstr && (strcmp (op_errstr, "")))
+                GF_FREE (op_errstr);
+        if (rsp_dict)
+                dict_unref (rsp_dict);
+        if (dict)
+                dict_unref (dict);
+        return ret;
+}
+
+int
+glusterd_handle_volume_commit_op (rpcsvc_request_t *req)
+{
+        int32_t                  ret       = -1;
+        int32_t                  status    = 0;
+        glusterd_op_t            op        = GD_OP_NONE;
+        uuid_t                   uuid      = {0,};
+        dict_t                  *dict      = NULL;
+        dict_t                  *rsp_dict  = NULL;
+        char                    *op_errstr = NULL;
+        xlator_t                *this      = NULL;
+
+        this = THIS;
+        GF_ASSERT (req);
+
+        ret = glusterd_volume_op_req_get (req, &op, uuid, &dict);
+        if (ret)
+                goto out;
+
+        rsp_dict = dict_new ();
+        if (!rsp_dict) {
+                ret = -1;
+                goto out;
+        }
+
+        status = glusterd_volume_op_check_lock (op, uuid, dict, &op_errstr);
+        if (status)
+                goto respond;
+
+        /* the local bricks answer into the commit response, like they do
+         * into the op ctx of the state machine */
+        if (glusterd_need_brick_op (op)) {
+                status = gd_brick_op_phase (op, rsp_dict, dict, &op_errstr);
+                if (status)
+                        goto respond;
+        }
+
+        /*clear locks should be run only on
+         * originator glusterd*/
+        if (GD_OP_CLEARLOCKS_VOLUME != op)
+                status = glusterd_op_commit_perform (op, dict, &op_errstr,
+                                                     rsp_dict);
+
+respond:
+        if (status)
+                gf_log (this->name, GF_LOG_ERROR, "Commit of operation "
+                        "'Volume %s' failed: %d", gd_op_list[op], status);
+
+        ret = glusterd_op_commit_send_resp (req, op, status, op_errstr,
+                                            rsp_dict);
+out:
+        if (op_errstr && (strcmp (op_errstr, "")))
+                GF_FREE (op_errstr);
+        if (rsp_dict)
+                dict_unref (rsp_dict);
+        if (dict)
+                dict_unref (dict);
+        return ret;
+}
+
 int
 glusterd_handle_cli_probe (rpcsvc_request_t *req)
 {
@@ -3223,10 +3456,14 @@ glusterd_peer_rpc_notify (struct rpc_clnt *rpc, void *mydata,
                   a peer.
                 */
                 if (peerinfo->connected) {
+                        /* volume transactions the peer was running here
+                         * will not unlock anymore */
+                        glusterd_volume_unlock_all (peerinfo->uuid);
+
                         /*TODO: The following is needed till all volume
                          * operations are synctaskized.
                          * */
-                        if (is_origin_glusterd ()) {
+                        if (is_origin_glusterd (NULL)) {
                                 switch (glusterd_op_get_op ()) {
                                 case GD_OP_START_VOLUME:
                                 case GD_OP_ADD_BRICK:
@@ -3298,6 +3535,10 @@ rpcsvc_actor_t gd_svc_mgmt_actors[] = {
         [GLUSTERD_MGMT_CLUSTER_UNLOCK] = { "CLUSTER_UNLOCK", GLUSTERD_MGMT_CLUSTER_UNLOCK, glusterd_handle_cluster_unlock, NULL, 0},
         [GLUSTERD_MGMT_STAGE_OP]       = { "STAGE_OP", GLUSTERD_MGMT_STAGE_OP, glusterd_handle_stage_op, NULL, 0},
         [GLUSTERD_MGMT_COMMIT_OP]      = { "COMMIT_OP", GLUSTERD_MGMT_COMMIT_OP, glusterd_handle_commit_op, NULL, 0},
+        [GLUSTERD_MGMT_VOLUME_LOCK]    = { "VOLUME_LOCK", GLUSTERD_MGMT_VOLUME_LOCK, glusterd_handle_volume_lock, NULL, 0},
+        [GLUSTERD_MGMT_VOLUME_UNLOCK]  = { "VOLUME_UNLOCK", GLUSTERD_MGMT_VOLUME_UNLOCK, glusterd_handle_volume_unlock, NULL, 0},
+        [GLUSTERD_MGMT_VOLUME_STAGE_OP]  = { "VOLUME_STAGE_OP", GLUSTERD_MGMT_VOLUME_STAGE_OP, glusterd_handle_volume_stage_op, NULL, 0},
+        [GLUSTERD_MGMT_VOLUME_COMMIT_OP] = { "VOLUME_COMMIT_OP", GLUSTERD_MGMT_VOLUME_COMMIT_OP, glusterd_handle_volume_commit_op, NULL, 0},
 };
 
 struct rpcsvc_program gd_svc_mgmt_prog = {
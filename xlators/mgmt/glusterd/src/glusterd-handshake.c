@@ -691,6 +691,7 @@ gd_validate_peer_op_version (xlator_t *this, glusterd_peerinfo_t *peerinfo,
                 goto out;
         }
 
+        peerinfo->max_op_version = peer_max_op_version;
         ret = 0;
 out:
         gf_log (this->name , GF_LOG_DEBUG, "Peer %s %s", peerinfo->hostname,
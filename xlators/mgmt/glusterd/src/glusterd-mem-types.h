@@ -65,7 +65,9 @@ typedef enum gf_gld_mem_types_ {
         gf_gld_mt_charptr                       = gf_common_mt_end + 49,
         gf_gld_mt_hooks_stub_t                  = gf_common_mt_end + 50,
         gf_gld_mt_hooks_priv_t                  = gf_common_mt_end + 51,
-        gf_gld_mt_end                           = gf_common_mt_end + 52,
+        gf_gld_mt_vol_lock_t                    = gf_common_mt_end + 52,
+        gf_gld_mt_xaction_peer_t                = gf_common_mt_end + 53,
+        gf_gld_mt_end                           = gf_common_mt_end + 54,
 } gf_gld_mem_types_t;
 #endif
 
@@ -417,7 +417,7 @@ glusterd_op_stage_set_volume (dict_t *dict, char **op_errstr)
          * This check is not done on the originator glusterd. The originator
          * glusterd sets this value.
          */
-        origin_glusterd = is_origin_glusterd ();
+        origin_glusterd = is_origin_glusterd (dict);
 
         if (!origin_glusterd) {
                 /* Check for v3.3.x origin glusterd */
@@ -1971,13 +1971,13 @@ glusterd_op_status_volume (dict_t *dict, char **op_errstr,
 
         GF_ASSERT (dict);
 
-        origin_glusterd = is_origin_glusterd ();
+        origin_glusterd = is_origin_glusterd (dict);
 
         ret = dict_get_uint32 (dict, "cmd", &cmd);
         if (ret)
                 goto out;
 
-        if (is_origin_glusterd ()) {
+        if (is_origin_glusterd (dict)) {
                 ret = 0;
                 if ((cmd & GF_CLI_STATUS_ALL)) {
                         ret = glusterd_get_all_volnames (rsp_dict);
@@ -3526,7 +3526,7 @@ glusterd_op_ac_stage_op (glusterd_op_sm_event_t *event, void *ctx)
         return ret;
 }
 
-static gf_boolean_t
+gf_boolean_t
 glusterd_need_brick_op (glusterd_op_t op)
 {
         gf_boolean_t ret        = _gf_false;
@@ -3675,6 +3675,12 @@ glusterd_op_stage_validate (glusterd_op_t op, dict_t *dict, char **op_errstr,
 {
         int ret = -1;
         xlator_t *this = THIS;
+        glusterd_conf_t *priv = this->private;
+
+        /* Transactions on different volumes may stage and commit at the
+         * same time from the synctask threads, keep the local work of
+         * each one apart. */
+        pthread_mutex_lock (&priv->xaction_lock);
 
         switch (op) {
                 case GD_OP_CREATE_VOLUME:
@@ -3765,6 +3771,8 @@ glusterd_op_stage_validate (glusterd_op_t op, dict_t *dict, char **op_errstr,
                                 gd_op_list[op]);
         }
 
+        pthread_mutex_unlock (&priv->xaction_lock);
+
         gf_log (this->name, GF_LOG_DEBUG, "Returning %d", ret);
 
         return ret;
@@ -3777,6 +3785,9 @@ glusterd_op_commit_perform (glusterd_op_t op, dict_t *dict, char **op_errstr,
 {
         int ret = -1;
         xlator_t *this = THIS;
+        glusterd_conf_t *priv = this->private;
+
+        pthread_mutex_lock (&priv->xaction_lock);
 
         glusterd_op_commit_hook (op, dict, GD_COMMIT_HOOK_PRE);
         switch (op) {
@@ -3871,6 +3882,9 @@ glusterd_op_commit_perform (glusterd_op_t op, dict_t *dict, char **op_errstr,
 
         if (ret == 0)
             glusterd_op_commit_hook (op, dict, GD_COMMIT_HOOK_POST);
+
+        pthread_mutex_unlock (&priv->xaction_lock);
+
         gf_log (this->name, GF_LOG_DEBUG, "Returning %d", ret);
 
         return ret;
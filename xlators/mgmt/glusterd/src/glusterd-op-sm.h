@@ -249,6 +249,9 @@ glusterd_handle_brick_rsp (void *pending_entry, glusterd_op_t op,
 dict_t*
 glusterd_op_init_commit_rsp_dict (glusterd_op_t op);
 
+gf_boolean_t
+glusterd_need_brick_op (glusterd_op_t op);
+
 void
 glusterd_op_modify_op_ctx (glusterd_op_t op, void *op_ctx);
 int32_t
@@ -325,7 +325,7 @@ glusterd_op_stage_replace_brick (dict_t *dict, char **op_errstr,
                         ret = -1;
                         goto out;
                 }
-                if (is_origin_glusterd ()) {
+                if (is_origin_glusterd (dict)) {
                         if (!ctx) {
                                 ret = -1;
                                 gf_log (this->name, GF_LOG_ERROR,
@@ -1629,7 +1629,7 @@ glusterd_op_replace_brick (dict_t *dict, dict_t *rsp_dict)
                 /* Set task-id, if available, in op_ctx dict for operations
                  * other than start
                  */
-                if  (is_origin_glusterd ()) {
+                if  (is_origin_glusterd (dict)) {
                         ctx = glusterd_op_get_ctx();
                         if (!ctx) {
                                 gf_log (this->name, GF_LOG_ERROR, "Failed to "
@@ -1516,6 +1516,10 @@ struct rpc_clnt_procedure gd_mgmt_actors[GLUSTERD_MGMT_MAXVALUE] = {
         [GLUSTERD_MGMT_CLUSTER_UNLOCK] = {"CLUSTER_UNLOCK", glusterd_cluster_unlock},
         [GLUSTERD_MGMT_STAGE_OP]       = {"STAGE_OP", glusterd_stage_op},
         [GLUSTERD_MGMT_COMMIT_OP]      = {"COMMIT_OP", glusterd_commit_op},
+        [GLUSTERD_MGMT_VOLUME_LOCK]    = {"VOLUME_LOCK", NULL},
+        [GLUSTERD_MGMT_VOLUME_UNLOCK]  = {"VOLUME_UNLOCK", NULL},
+        [GLUSTERD_MGMT_VOLUME_STAGE_OP]  = {"VOLUME_STAGE_OP", NULL},
+        [GLUSTERD_MGMT_VOLUME_COMMIT_OP] = {"VOLUME_COMMIT_OP", NULL},
 };
 
 struct rpc_clnt_program gd_mgmt_prog = {
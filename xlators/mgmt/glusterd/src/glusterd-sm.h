@@ -31,7 +31,7 @@
 struct glusterd_store_handle_ {
         char    *path;
         int     fd;
-        FILE    *read;
+        dict_t  *kv;    /* keys of the file, parsed on first retrieve */
 };
 
 typedef struct glusterd_store_handle_  glusterd_store_handle_t;
@@ -98,7 +98,6 @@ struct glusterd_peerinfo_ {
         char                            *hostname;
         int                             port;
         struct list_head                uuid_list;
-        struct list_head                op_peers_list;
         struct rpc_clnt                 *rpc;
         rpc_clnt_prog_t                 *mgmt;
         rpc_clnt_prog_t                 *peer;
@@ -107,6 +106,7 @@ struct glusterd_peerinfo_ {
         glusterd_sm_tr_log_t            sm_log;
         gf_boolean_t                    quorum_action;
         gd_quorum_contrib_t             quorum_contrib;
+        int                             max_op_version;
 };
 
 typedef struct glusterd_peerinfo_ glusterd_peerinfo_t;
@@ -89,7 +89,7 @@ glusterd_store_mkstemp (glusterd_store_handle_t *shandle)
         GF_ASSERT (shandle->path);
 
         snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
-        fd = open (tmppath, O_RDWR | O_CREAT | O_TRUNC | O_SYNC, 0600);
+        fd = open (tmppath, O_RDWR | O_CREAT | O_TRUNC, 0600);
         if (fd <= 0) {
                 gf_log (THIS->name, GF_LOG_ERROR, "Failed to open %s, "
                         "error: %s", tmppath, strerror (errno));
@@ -98,6 +98,24 @@ glusterd_store_mkstemp (glusterd_store_handle_t *shandle)
         return fd;
 }
 
+/* The tmp file is written without O_SYNC and flushed once here, before it
+ * is renamed over the old copy.
+ */
+int32_t
+glusterd_store_tmp_sync (glusterd_store_handle_t *shandle, int fd)
+{
+        int32_t         ret = -1;
+
+        GF_ASSERT (shandle);
+        GF_ASSERT (fd > 0);
+
+        ret = fsync (fd);
+        if (ret)
+                gf_log (THIS->name, GF_LOG_ERROR, "Failed to fsync %s.tmp, "
+                        "error: %s", shandle->path, strerror (errno));
+        return ret;
+}
+
 int
 glusterd_store_sync_direntry (char *path)
 {
@@ -144,8 +162,14 @@ out:
         return ret;
 }
 
-int32_t
-glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
+static void
+glusterd_store_handle_unload (glusterd_store_handle_t *handle);
+
+/* Renames without syncing the directory, for callers that replace several
+ * files of one directory and sync it once at the end.
+ */
+static int32_t
+__glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
 {
         int32_t         ret = -1;
         char            tmppath[PATH_MAX] = {0,};
@@ -161,7 +185,21 @@ glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
                 goto out;
         }
 
-        ret = glusterd_store_sync_direntry (tmppath);
+        glusterd_store_handle_unload (shandle);
+out:
+        return ret;
+}
+
+int32_t
+glusterd_store_rename_tmppath (glusterd_store_handle_t *shandle)
+{
+        int32_t         ret = -1;
+
+        ret = __glusterd_store_rename_tmppath (shandle);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_sync_direntry (shandle->path);
 out:
         return ret;
 }
@@ -402,10 +440,9 @@ glusterd_store_perform_brick_store (glusterd_brickinfo_t *brickinfo)
                 goto out;
         }
 
+        /* synced along with the rest of the volume's tmp files, see
+         * glusterd_store_volume_tmp_sync */
         ret = glusterd_store_brickinfo_write (fd, brickinfo);
-        if (ret)
-                goto out;
-
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (brickinfo->shandle);
@@ -963,8 +1000,9 @@ out:
         return ret;
 }
 
-int32_t
-glusterd_store_perform_rbstate_store (glusterd_volinfo_t *volinfo)
+static int32_t
+__glusterd_store_perform_rbstate_store (glusterd_volinfo_t *volinfo,
+                                          gf_boolean_t sync)
 {
         int                         fd = -1;
         int32_t                     ret = -1;
@@ -977,13 +1015,10 @@ glusterd_store_perform_rbstate_store (glusterd_volinfo_t *volinfo)
         }
 
         ret = glusterd_store_rbstate_write (fd, volinfo);
-        if (ret)
-                goto out;
-
-        ret = glusterd_store_rename_tmppath (volinfo->rb_shandle);
-        if (ret)
+        if (ret || !sync)
                 goto out;
 
+        ret = glusterd_store_tmp_sync (volinfo->rb_shandle, fd);
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (volinfo->rb_shandle);
@@ -993,6 +1028,22 @@ out:
         return ret;
 }
 
+int32_t
+glusterd_store_perform_rbstate_store (glusterd_volinfo_t *volinfo)
+{
+        int32_t                     ret = -1;
+
+        ret = __glusterd_store_perform_rbstate_store (volinfo, _gf_true);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_rename_tmppath (volinfo->rb_shandle);
+        if (ret)
+                glusterd_store_unlink_tmppath (volinfo->rb_shandle);
+out:
+        return ret;
+}
+
 int32_t
 glusterd_store_node_state_write (int fd, glusterd_volinfo_t *volinfo)
 {
@@ -1030,8 +1081,9 @@ out:
         return ret;
 }
 
-int32_t
-glusterd_store_perform_node_state_store (glusterd_volinfo_t *volinfo)
+static int32_t
+__glusterd_store_perform_node_state_store (glusterd_volinfo_t *volinfo,
+                                             gf_boolean_t sync)
 {
         int                         fd = -1;
         int32_t                     ret = -1;
@@ -1044,13 +1096,10 @@ glusterd_store_perform_node_state_store (glusterd_volinfo_t *volinfo)
         }
 
         ret = glusterd_store_node_state_write (fd, volinfo);
-        if (ret)
-                goto out;
-
-        ret = glusterd_store_rename_tmppath (volinfo->node_state_shandle);
-        if (ret)
+        if (ret || !sync)
                 goto out;
 
+        ret = glusterd_store_tmp_sync (volinfo->node_state_shandle, fd);
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (volinfo->node_state_shandle);
@@ -1060,6 +1109,22 @@ out:
         return ret;
 }
 
+int32_t
+glusterd_store_perform_node_state_store (glusterd_volinfo_t *volinfo)
+{
+        int32_t                     ret = -1;
+
+        ret = __glusterd_store_perform_node_state_store (volinfo, _gf_true);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_rename_tmppath (volinfo->node_state_shandle);
+        if (ret)
+                glusterd_store_unlink_tmppath (volinfo->node_state_shandle);
+out:
+        return ret;
+}
+
 int32_t
 glusterd_store_perform_volume_store (glusterd_volinfo_t *volinfo)
 {
@@ -1078,9 +1143,6 @@ glusterd_store_perform_volume_store (glusterd_volinfo_t *volinfo)
                 goto out;
 
         ret = glusterd_store_brickinfos (volinfo, fd);
-        if (ret)
-                goto out;
-
 out:
         if (ret && (fd > 0))
                 glusterd_store_unlink_tmppath (volinfo->shandle);
@@ -1134,6 +1196,57 @@ glusterd_store_volume_cleanup_tmp (glusterd_volinfo_t *volinfo)
         glusterd_store_unlink_tmppath (volinfo->node_state_shandle);
 }
 
+static int32_t
+glusterd_store_tmppath_sync (glusterd_store_handle_t *shandle)
+{
+        int32_t         ret = -1;
+        int             fd  = -1;
+        char            tmppath[PATH_MAX] = {0,};
+
+        snprintf (tmppath, sizeof (tmppath), "%s.tmp", shandle->path);
+        fd = open (tmppath, O_RDONLY);
+        if (fd == -1) {
+                gf_log (THIS->name, GF_LOG_ERROR, "Failed to open %s, "
+                        "error: %s", tmppath, strerror (errno));
+                goto out;
+        }
+
+        ret = glusterd_store_tmp_sync (shandle, fd);
+        close (fd);
+out:
+        return ret;
+}
+
+/* Flushes the tmp files of the volume, its bricks included, once all of
+ * them are written and before any is renamed in place.
+ */
+static int32_t
+glusterd_store_volume_tmp_sync (glusterd_volinfo_t *volinfo)
+{
+        int32_t                  ret       = -1;
+        glusterd_brickinfo_t    *brickinfo = NULL;
+
+        GF_ASSERT (volinfo);
+
+        list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
+                ret = glusterd_store_tmppath_sync (brickinfo->shandle);
+                if (ret)
+                        goto out;
+        }
+
+        ret = glusterd_store_tmppath_sync (volinfo->shandle);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_tmppath_sync (volinfo->rb_shandle);
+        if (ret)
+                goto out;
+
+        ret = glusterd_store_tmppath_sync (volinfo->node_state_shandle);
+out:
+        return ret;
+}
+
 int32_t
 glusterd_store_brickinfos_atomic_update (glusterd_volinfo_t *volinfo)
 {
@@ -1142,11 +1255,19 @@ glusterd_store_brickinfos_atomic_update (glusterd_volinfo_t *volinfo)
 
         GF_ASSERT (volinfo);
 
+        ret = 0;
         list_for_each_entry (brickinfo, &volinfo->bricks, brick_list) {
-                ret = glusterd_store_rename_tmppath (brickinfo->shandle);
+                ret = __glusterd_store_rename_tmppath (brickinfo->shandle);
                 if (ret)
                         goto out;
         }
+
+        /* all the brick files live in one directory */
+        if (!list_empty (&volinfo->bricks)) {
+                brickinfo = list_entry (volinfo->bricks.next,
+                                        glusterd_brickinfo_t, brick_list);
+                ret = glusterd_store_sync_direntry (brickinfo->shandle->path);
+        }
 out:
         return ret;
 }
@@ -1157,10 +1278,19 @@ glusterd_store_volinfo_atomic_update (glusterd_volinfo_t *volinfo)
         int ret = -1;
         GF_ASSERT (volinfo);
 
-        ret = glusterd_store_rename_tmppath (volinfo->shandle);
+        ret = __glusterd_store_rename_tmppath (volinfo->shandle);
+        if (ret)
+                goto out;
+
+        ret = __glusterd_store_rename_tmppath (volinfo->rb_shandle);
+        if (ret)
+                goto out;
+
+        ret = __glusterd_store_rename_tmppath (volinfo->node_state_shandle);
         if (ret)
                 goto out;
 
+        ret = glusterd_store_sync_direntry (volinfo->shandle->path);
 out:
         if (ret)
                 gf_log (THIS->name, GF_LOG_ERROR, "Couldn't rename "
@@ -1208,25 +1338,33 @@ glusterd_store_volinfo (glusterd_volinfo_t *volinfo, glusterd_volinfo_ver_ac_t a
         if (ret)
                 goto out;
 
+        /* every file of the volume is written out first, flushed to disk
+         * together and then renamed in place, with one sync per directory.
+         */
         ret = glusterd_store_perform_volume_store (volinfo);
         if (ret)
-                goto out;
+                goto undo;
+
+        ret = __glusterd_store_perform_rbstate_store (volinfo, _gf_false);
+        if (ret)
+                goto undo;
+
+        ret = __glusterd_store_perform_node_state_store (volinfo, _gf_false);
+        if (ret)
+                goto undo;
+
+        ret = glusterd_store_volume_tmp_sync (volinfo);
+        if (ret)
+                goto undo;
 
         ret = glusterd_store_volume_atomic_update (volinfo);
+undo:
         if (ret) {
                 glusterd_perform_volinfo_version_action (volinfo,
                                                          GLUSTERD_VOLINFO_VER_AC_DECREMENT);
                 goto out;
         }
 
-        ret = glusterd_store_perform_rbstate_store (volinfo);
-        if (ret)
-                goto out;
-
-        ret = glusterd_store_perform_node_state_store (volinfo);
-        if (ret)
-                goto out;
-
         //checksum should be computed at the end
         ret = glusterd_volume_compute_cksum (volinfo);
         if (ret)
@@ -1329,38 +1467,52 @@ out:
 }
 
 
+/* Takes the next key=value line out of the buffer of an iterator, in place.
+ * Blank lines are skipped, the value runs to the end of its line.
+ */
 int
-glusterd_store_read_and_tokenize (FILE *file, char *str,
+glusterd_store_read_and_tokenize (glusterd_store_iter_t *iter,
                                   char **iter_key, char **iter_val,
                                   glusterd_store_op_errno_t *store_errno)
 {
-        int32_t  ret = -1;
-        char *savetok = NULL;
+        int32_t  ret  = -1;
+        char    *line = NULL;
+        char    *end  = NULL;
+        char    *eq   = NULL;
 
-        GF_ASSERT (file);
-        GF_ASSERT (str);
+        GF_ASSERT (iter);
         GF_ASSERT (iter_key);
         GF_ASSERT (iter_val);
         GF_ASSERT (store_errno);
 
-        ret = fscanf (file, "%s", str);
-        if (ret <= 0 || feof (file)) {
-                ret = -1;
-                *store_errno = GD_STORE_EOF;
-                goto out;
-        }
+        do {
+                if (iter->off >= iter->len) {
+                        ret = -1;
+                        *store_errno = GD_STORE_EOF;
+                        goto out;
+                }
 
-        *iter_key = strtok_r (str, "=", &savetok);
-        if (*iter_key == NULL) {
-                ret = -1;
-                *store_errno = GD_STORE_KEY_NULL;
-                goto out;
+                line = iter->buf + iter->off;
+                end = memchr (line, '\n', iter->len - iter->off);
+                if (!end)
+                        end = iter->buf + iter->len;
+                *end = '\0';
+                iter->off = end - iter->buf + 1;
+        } while (*line == '\0');
+
+        *iter_key = line;
+        *iter_val = NULL;
+
+        eq = strchr (line, '=');
+        if (eq) {
+                *eq = '\0';
+                if (eq[1] != '\0')
+                        *iter_val = eq + 1;
         }
 
-        *iter_val = strtok_r (NULL, "=", &savetok);
-        if (*iter_key == NULL) {
+        if (**iter_key == '\0') {
                 ret = -1;
-                *store_errno = GD_STORE_VALUE_NULL;
+                *store_errno = GD_STORE_KEY_NULL;
                 goto out;
         }
 
@@ -1370,81 +1522,88 @@ out:
         return ret;
 }
 
-int32_t
-glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
-                               char *key, char **value)
+/* All keys of the file are read into handle->kv on the first lookup, the
+ * later ones are served from there until the file is replaced.
+ */
+static int32_t
+glusterd_store_handle_load (glusterd_store_handle_t *handle)
 {
-        int32_t         ret = -1;
-        char            *scan_str = NULL;
-        char            *iter_key = NULL;
-        char            *iter_val = NULL;
-        char            *free_str = NULL;
-        struct stat     st        = {0,};
+        int32_t                   ret      = -1;
+        glusterd_store_iter_t    *iter     = NULL;
+        char                     *iter_key = NULL;
+        char                     *iter_val = NULL;
+        dict_t                   *kv       = NULL;
         glusterd_store_op_errno_t store_errno = GD_STORE_SUCCESS;
 
-        GF_ASSERT (handle);
-
-        handle->fd = open (handle->path, O_RDWR);
-
-        if (handle->fd == -1) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %s",
-                        handle->path, strerror (errno));
+        kv = dict_new ();
+        if (!kv)
                 goto out;
-        }
-        if (!handle->read)
-                handle->read = fdopen (handle->fd, "r");
 
-        if (!handle->read) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %s",
-                        handle->path, strerror (errno));
+        ret = glusterd_store_iter_new (handle, &iter);
+        if (ret)
                 goto out;
-        }
 
-        ret = fstat (handle->fd, &st);
-        if (ret < 0) {
-                gf_log ("glusterd", GF_LOG_WARNING,
-                        "stat on file failed");
-                ret = -1;
-                store_errno = GD_STORE_STAT_FAILED;
-                goto out;
+        while (!glusterd_store_read_and_tokenize (iter, &iter_key, &iter_val,
+                                                  &store_errno)) {
+                gf_log ("", GF_LOG_DEBUG, "key %s read", iter_key);
+                if (!iter_val)
+                        continue;
+                ret = dict_set_dynstr (kv, iter_key, gf_strdup (iter_val));
+                if (ret)
+                        goto out;
         }
 
-        scan_str = GF_CALLOC (1, st.st_size,
-                              gf_gld_mt_char);
-        if (scan_str == NULL) {
+        if (store_errno != GD_STORE_EOF) {
                 ret = -1;
-                store_errno = GD_STORE_ENOMEM;
                 goto out;
         }
 
-        free_str = scan_str;
+        handle->kv = kv;
+        kv = NULL;
+        ret = 0;
+out:
+        glusterd_store_iter_destroy (iter);
+        if (kv)
+                dict_unref (kv);
+        return ret;
+}
 
-        do {
-                ret = glusterd_store_read_and_tokenize (handle->read, scan_str,
-                                                        &iter_key, &iter_val,
-                                                        &store_errno);
-                if (ret < 0) {
-                        goto out;
-                }
+static void
+glusterd_store_handle_unload (glusterd_store_handle_t *handle)
+{
+        if (handle->kv) {
+                dict_unref (handle->kv);
+                handle->kv = NULL;
+        }
+}
 
-                gf_log ("", GF_LOG_DEBUG, "key %s read", iter_key);
+int32_t
+glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
+                               char *key, char **value)
+{
+        int32_t         ret = -1;
+        char           *val = NULL;
 
-                if (!strcmp (key, iter_key)) {
-                        gf_log ("", GF_LOG_DEBUG, "key %s found", key);
-                        ret = 0;
-                        if (iter_val)
-                                *value = gf_strdup (iter_val);
+        GF_ASSERT (handle);
+
+        if (!handle->kv) {
+                ret = glusterd_store_handle_load (handle);
+                if (ret) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to read file %s",
+                                handle->path);
                         goto out;
                 }
-        } while (1);
-out:
-        if (handle->fd > 0) {
-                close (handle->fd);
-                handle->read = NULL;
         }
 
-        GF_FREE (free_str);
+        ret = dict_get_str (handle->kv, key, &val);
+        if (ret)
+                goto out;
 
+        gf_log ("", GF_LOG_DEBUG, "key %s found", key);
+        *value = gf_strdup (val);
+        if (!*value)
+                ret = -1;
+out:
         return ret;
 }
 
@@ -1452,7 +1611,6 @@ int32_t
 glusterd_store_save_value (int fd, char *key, char *value)
 {
         int32_t         ret = -1;
-        FILE           *fp  = NULL;
         xlator_t       *this = NULL;
 
         this = THIS;
@@ -1461,14 +1619,7 @@ glusterd_store_save_value (int fd, char *key, char *value)
         GF_ASSERT (key);
         GF_ASSERT (value);
 
-        fp = fdopen (fd, "a+");
-        if (fp == NULL) {
-                gf_log (this->name, GF_LOG_WARNING, "fdopen failed.");
-                ret = -1;
-                goto out;
-        }
-
-        ret = fprintf (fp, "%s=%s\n", key, value);
+        ret = dprintf (fd, "%s=%s\n", key, value);
         if (ret < 0) {
                 gf_log (this->name, GF_LOG_WARNING, "Unable to store key: %s,"
                         "value: %s, error: %s", key, value,
@@ -1477,15 +1628,6 @@ glusterd_store_save_value (int fd, char *key, char *value)
                 goto out;
         }
 
-        ret = fflush (fp);
-        if (feof (fp)) {
-                gf_log (this->name, GF_LOG_WARNING,
-                        "fflush failed, error: %s",
-                        strerror (errno));
-                ret = -1;
-                goto out;
-        }
-
         ret = 0;
 out:
 
@@ -1548,13 +1690,29 @@ glusterd_store_handle_retrieve (char *path, glusterd_store_handle_t **handle)
         int32_t                 ret = -1;
         struct stat statbuf = {0};
 
+        glusterd_store_handle_t *shandle = NULL;
+
         ret = stat (path, &statbuf);
         if (ret) {
                 gf_log ("glusterd", GF_LOG_ERROR, "Unable to retrieve store "
                         "handle for %s, error: %s", path, strerror (errno));
                 goto out;
         }
-        ret =  glusterd_store_handle_new (path, handle);
+
+        /* the file is there already, nothing to create or sync */
+        ret = -1;
+        shandle = GF_CALLOC (1, sizeof (*shandle), gf_gld_mt_store_handle_t);
+        if (!shandle)
+                goto out;
+
+        shandle->path = gf_strdup (path);
+        if (!shandle->path) {
+                GF_FREE (shandle);
+                goto out;
+        }
+
+        *handle = shandle;
+        ret = 0;
 out:
         gf_log ("", GF_LOG_DEBUG, "Returning %d", ret);
         return ret;
@@ -1570,6 +1728,8 @@ glusterd_store_handle_destroy (glusterd_store_handle_t *handle)
                 goto out;
         }
 
+        glusterd_store_handle_unload (handle);
+
         GF_FREE (handle->path);
 
         GF_FREE (handle);
@@ -1643,6 +1803,10 @@ glusterd_store_global_info (xlator_t *this)
                 goto out;
         }
 
+        ret = glusterd_store_tmp_sync (handle, handle->fd);
+        if (ret)
+                goto out;
+
         ret = glusterd_store_rename_tmppath (handle);
 out:
         if (ret && (handle->fd > 0))
@@ -1798,6 +1962,8 @@ glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
         int32_t                 ret = -1;
         glusterd_store_iter_t   *tmp_iter = NULL;
         int                     fd = -1;
+        struct stat             st = {0,};
+        ssize_t                 size = 0;
 
         GF_ASSERT (shandle);
         GF_ASSERT (iter);
@@ -1810,7 +1976,7 @@ glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
                 goto out;
         }
 
-        fd = open (shandle->path, O_RDWR);
+        fd = open (shandle->path, O_RDONLY);
 
         if (fd < 0) {
                 gf_log ("", GF_LOG_ERROR, "Unable to open %s, errno: %d",
@@ -1818,22 +1984,48 @@ glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
                 goto out;
         }
 
-        tmp_iter->fd = fd;
-
-        tmp_iter->file = fdopen (tmp_iter->fd, "r");
-
-        if (!tmp_iter->file) {
-                gf_log ("", GF_LOG_ERROR, "Unable to open file %s errno: %d",
+        ret = fstat (fd, &st);
+        if (ret) {
+                gf_log ("", GF_LOG_ERROR, "Unable to stat %s, errno: %d",
                         shandle->path, errno);
                 goto out;
         }
 
+        /* the file is read in one go and tokenized from memory */
+        ret = -1;
+        tmp_iter->buf = GF_MALLOC (st.st_size + 1, gf_gld_mt_char);
+        if (!tmp_iter->buf)
+                goto out;
+
+        while (tmp_iter->len < st.st_size) {
+                size = read (fd, tmp_iter->buf + tmp_iter->len,
+                             st.st_size - tmp_iter->len);
+                if (size < 0 && errno == EINTR)
+                        continue;
+                if (size < 0) {
+                        gf_log ("", GF_LOG_ERROR, "Unable to read %s, "
+                                "errno: %d", shandle->path, errno);
+                        goto out;
+                }
+                if (size == 0)
+                        break;
+                tmp_iter->len += size;
+        }
+        tmp_iter->buf[tmp_iter->len] = '\0';
+
         strncpy (tmp_iter->filepath, shandle->path, sizeof (tmp_iter->filepath));
         tmp_iter->filepath[sizeof (tmp_iter->filepath) - 1] = 0;
         *iter = tmp_iter;
+        tmp_iter = NULL;
         ret = 0;
 
 out:
+        if (fd >= 0)
+                close (fd);
+        if (tmp_iter) {
+                GF_FREE (tmp_iter->buf);
+                GF_FREE (tmp_iter);
+        }
         gf_log ("", GF_LOG_DEBUG, "Returning with %d", ret);
         return ret;
 }
@@ -1878,42 +2070,19 @@ glusterd_store_iter_get_next (glusterd_store_iter_t *iter,
                               glusterd_store_op_errno_t *op_errno)
 {
         int32_t         ret = -1;
-        char            *scan_str = NULL;
-        char            *free_str = NULL;
         char            *iter_key = NULL;
         char            *iter_val = NULL;
-        struct stat     st        = {0,};
         glusterd_store_op_errno_t store_errno = GD_STORE_SUCCESS;
 
         GF_ASSERT (iter);
-        GF_ASSERT (iter->file);
+        GF_ASSERT (iter->buf);
         GF_ASSERT (key);
         GF_ASSERT (value);
 
-        ret = fstat (iter->fd, &st);
-        if (ret < 0) {
-                gf_log ("glusterd", GF_LOG_WARNING,
-                        "stat on file failed");
-                ret = -1;
-                store_errno = GD_STORE_STAT_FAILED;
-                goto out;
-        }
-
-        scan_str = GF_CALLOC (1, st.st_size,
-                              gf_gld_mt_char);
-        if (scan_str == NULL) {
-                ret = -1;
-                store_errno = GD_STORE_ENOMEM;
-                goto out;
-        }
-
         *key = NULL;
         *value = NULL;
 
-        free_str = scan_str;
-
-        ret = glusterd_store_read_and_tokenize (iter->file, scan_str,
-                                                &iter_key, &iter_val,
+        ret = glusterd_store_read_and_tokenize (iter, &iter_key, &iter_val,
                                                 &store_errno);
         if (ret < 0) {
                 goto out;
@@ -1928,7 +2097,7 @@ glusterd_store_iter_get_next (glusterd_store_iter_t *iter,
         *value = gf_strdup (iter_val);
 
         *key   = gf_strdup (iter_key);
-        if (!iter_key || !iter_val) {
+        if (!*key || !*value) {
                 ret = -1;
                 store_errno = GD_STORE_ENOMEM;
                 goto out;
@@ -1947,7 +2116,6 @@ out:
                         *value = NULL;
                 }
         }
-        GF_FREE (free_str);
         if (op_errno)
                 *op_errno = store_errno;
 
@@ -1983,24 +2151,13 @@ out:
 int32_t
 glusterd_store_iter_destroy (glusterd_store_iter_t *iter)
 {
-        int32_t         ret = -1;
-
         if (!iter)
                 return 0;
 
-        if (iter->file)
-                ret = fclose (iter->file);
-        else
-                ret = 0;
-
-        if (ret) {
-                gf_log ("", GF_LOG_ERROR, "Unable to close fd: %d, ret: %d, "
-                        "errno: %d" ,iter->fd, ret, errno);
-        }
-
+        GF_FREE (iter->buf);
         GF_FREE (iter);
 
-        return ret;
+        return 0;
 }
 
 char*
@@ -2598,6 +2755,9 @@ glusterd_store_options (xlator_t *this, dict_t *opts)
         shandle->fd = fd;
         dict_foreach (opts, _store_global_opts, shandle);
         shandle->fd = 0;
+        ret = glusterd_store_tmp_sync (shandle, fd);
+        if (ret)
+                goto out;
         ret = glusterd_store_rename_tmppath (shandle);
         if (ret)
                 goto out;
@@ -2938,6 +3098,10 @@ glusterd_store_perform_peer_store (glusterd_peerinfo_t *peerinfo)
         if (ret)
                 goto out;
 
+        ret = glusterd_store_tmp_sync (peerinfo->shandle, fd);
+        if (ret)
+                goto out;
+
         ret = glusterd_store_rename_tmppath (peerinfo->shandle);
 out:
         if (ret && (fd > 0))
@@ -107,6 +107,13 @@ int32_t
 glusterd_store_retrieve_value (glusterd_store_handle_t *handle,
                                char *key, char **value);
 
+int32_t
+glusterd_store_iter_new (glusterd_store_handle_t  *shandle,
+                         glusterd_store_iter_t  **iter);
+
+int32_t
+glusterd_store_iter_destroy (glusterd_store_iter_t *iter);
+
 int32_t
 glusterd_retrieve_uuid ();
 
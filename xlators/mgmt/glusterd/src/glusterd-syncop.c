@@ -212,6 +212,62 @@ gd_syncop_mgmt_unlock (struct rpc_clnt *rpc, uuid_t my_uuid, uuid_t recv_uuid)
 
 }
 
+/* Volume locks go out with the stage request layout, the op dict names
+ * the volume; the answer is the one of the cluster lock.
+ */
+static int
+gd_syncop_mgmt_volume_lock_op (struct rpc_clnt *rpc, uuid_t my_uuid,
+                               uuid_t recv_uuid, int op, dict_t *dict_out,
+                               gf_boolean_t lock)
+{
+        struct syncargs       args = {0, };
+        gd1_mgmt_stage_op_req req  = {{0},};
+        int                   ret  = 0;
+
+        uuid_copy (req.uuid, my_uuid);
+        req.op = op;
+
+        args.op_ret = -1;
+        args.op_errno = ENOTCONN;
+
+        ret = dict_allocate_and_serialize (dict_out,
+                                           &req.buf.buf_val, &req.buf.buf_len);
+        if (ret)
+                goto out;
+
+        if (lock)
+                GD_SYNCOP (rpc, (&args), gd_syncop_mgmt_lock_cbk,
+                           &req, &gd_mgmt_prog, GLUSTERD_MGMT_VOLUME_LOCK,
+                           xdr_gd1_mgmt_stage_op_req);
+        else
+                GD_SYNCOP (rpc, (&args), gd_syncop_mgmt_unlock_cbk,
+                           &req, &gd_mgmt_prog, GLUSTERD_MGMT_VOLUME_UNLOCK,
+                           xdr_gd1_mgmt_stage_op_req);
+        GF_FREE (req.buf.buf_val);
+
+        if (!args.op_ret)
+                uuid_copy (recv_uuid, args.uuid);
+out:
+        errno = args.op_errno;
+        return args.op_ret;
+}
+
+int
+gd_syncop_mgmt_volume_lock (struct rpc_clnt *rpc, uuid_t my_uuid,
+                            uuid_t recv_uuid, int op, dict_t *dict_out)
+{
+        return gd_syncop_mgmt_volume_lock_op (rpc, my_uuid, recv_uuid, op,
+                                              dict_out, _gf_true);
+}
+
+int
+gd_syncop_mgmt_volume_unlock (struct rpc_clnt *rpc, uuid_t my_uuid,
+                              uuid_t recv_uuid, int op, dict_t *dict_out)
+{
+        return gd_syncop_mgmt_volume_lock_op (rpc, my_uuid, recv_uuid, op,
+                                              dict_out, _gf_false);
+}
+
 int32_t
 gd_syncop_stage_op_cbk (struct rpc_req *req, struct iovec *iov,
                         int count, void *myframe)
@@ -273,8 +329,8 @@ out:
 
 int
 gd_syncop_mgmt_stage_op (struct rpc_clnt *rpc, uuid_t my_uuid, uuid_t recv_uuid,
-                         int op, dict_t *dict_out, dict_t **dict_in,
-                         char **errstr)
+                         int procnum, int op, dict_t *dict_out,
+                         dict_t **dict_in, char **errstr)
 {
         struct syncargs       args = {0, };
         gd1_mgmt_stage_op_req req  = {{0},};
@@ -292,8 +348,9 @@ gd_syncop_mgmt_stage_op (struct rpc_clnt *rpc, uuid_t my_uuid, uuid_t recv_uuid,
                 goto out;
 
         GD_SYNCOP (rpc, (&args), gd_syncop_stage_op_cbk,
-                   &req, &gd_mgmt_prog, GLUSTERD_MGMT_STAGE_OP,
+                   &req, &gd_mgmt_prog, procnum,
                    xdr_gd1_mgmt_stage_op_req);
+        GF_FREE (req.buf.buf_val);
 
         if (args.errstr && errstr)
                 *errstr = args.errstr;
@@ -504,8 +561,8 @@ out:
 
 int
 gd_syncop_mgmt_commit_op (struct rpc_clnt *rpc, uuid_t my_uuid, uuid_t recv_uuid,
-                          int op, dict_t *dict_out, dict_t **dict_in,
-                          char **errstr)
+                          int procnum, int op, dict_t *dict_out,
+                          dict_t **dict_in, char **errstr)
 {
         struct syncargs        args = {0, };
         gd1_mgmt_commit_op_req req  = {{0},};
@@ -523,8 +580,9 @@ gd_syncop_mgmt_commit_op (struct rpc_clnt *rpc, uuid_t my_uuid, uuid_t recv_uuid
                 goto out;
 
         GD_SYNCOP (rpc, (&args), gd_syncop_commit_op_cbk,
-                   &req, &gd_mgmt_prog, GLUSTERD_MGMT_COMMIT_OP,
+                   &req, &gd_mgmt_prog, procnum,
                    xdr_gd1_mgmt_commit_op_req);
+        GF_FREE (req.buf.buf_val);
 
         if (args.errstr && errstr)
                 *errstr = args.errstr;
@@ -609,6 +667,126 @@ out:
         return ret;
 }
 
+/* Which lock a transaction takes. Operations confined to one volume lock
+ * just that volume, so that independent volumes can be managed at the same
+ * time; read-only ones share it. Peer and cluster wide operations, those
+ * claiming brick paths any volume could use, and everything in a cluster
+ * with glusterds that know no volume locks take the cluster lock.
+ */
+static gd_xaction_scope_t
+gd_xaction_scope_get (glusterd_op_t op, dict_t *op_ctx, char **volname)
+{
+        glusterd_conf_t         *conf     = NULL;
+        glusterd_peerinfo_t     *peerinfo = NULL;
+
+        conf = THIS->private;
+
+        switch (op) {
+        case GD_OP_STATUS_VOLUME:
+        case GD_OP_START_VOLUME:
+        case GD_OP_STOP_VOLUME:
+        case GD_OP_DELETE_VOLUME:
+        case GD_OP_REMOVE_BRICK:
+        case GD_OP_SET_VOLUME:
+        case GD_OP_RESET_VOLUME:
+        case GD_OP_STATEDUMP_VOLUME:
+        case GD_OP_CLEARLOCKS_VOLUME:
+                if (dict_get_str (op_ctx, "volname", volname) ||
+                    !strcasecmp (*volname, "all"))
+                        return GD_XACTION_CLUSTER;
+                break;
+
+        default:
+                return GD_XACTION_CLUSTER;
+        }
+
+        list_for_each_entry (peerinfo, &conf->peers, uuid_list) {
+                if (!peerinfo->connected)
+                        continue;
+                if (peerinfo->state.state != GD_FRIEND_STATE_BEFRIENDED)
+                        continue;
+                if (peerinfo->max_op_version < GD_OP_VERSION_VOLUME_LOCKS)
+                        return GD_XACTION_CLUSTER;
+        }
+
+        return GD_XACTION_VOLUME;
+}
+
+static void
+gd_xaction_peers_free (struct list_head *xaction_peers)
+{
+        gd_xaction_peer_t       *xpeer = NULL;
+        gd_xaction_peer_t       *tmp   = NULL;
+
+        list_for_each_entry_safe (xpeer, tmp, xaction_peers, list) {
+                list_del_init (&xpeer->list);
+                GF_FREE (xpeer);
+        }
+}
+
+/* Sends the op to the bricks and node services of this glusterd which it
+ * concerns and gathers their answers into op_ctx.
+ */
+int
+gd_brick_op_phase (glusterd_op_t op, dict_t *op_ctx, dict_t *req_dict,
+                   char **op_errstr)
+{
+        int                         ret             = -1;
+        glusterd_pending_node_t     *pending_node   = NULL;
+        rpc_clnt_t                  *rpc            = NULL;
+        int                         brick_count     = 0;
+        struct list_head            selected        = {0};
+        xlator_t                    *this           = NULL;
+        glusterd_conf_t             *conf           = NULL;
+
+        this = THIS;
+        conf = this->private;
+
+        /* selection walks conf->volumes, which a commit of a transaction
+         * on another volume may change. The nodes selected belong to the
+         * volume locked by this transaction, they stay valid after. */
+        INIT_LIST_HEAD (&selected);
+        pthread_mutex_lock (&conf->xaction_lock);
+        ret = glusterd_op_bricks_select (op, req_dict, op_errstr, &selected);
+        pthread_mutex_unlock (&conf->xaction_lock);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "%s",
+                       (*op_errstr)? *op_errstr: "Brick op failed. Check "
+                       "glusterd log file for more details.");
+                goto out;
+        }
+
+        brick_count = 0;
+        list_for_each_entry (pending_node, &selected, list) {
+                rpc = glusterd_pending_node_get_rpc (pending_node);
+                if (!rpc) {
+                        if (pending_node->type == GD_NODE_REBALANCE) {
+                                ret = 0;
+                                glusterd_defrag_volume_node_rsp (req_dict,
+                                                                 NULL, op_ctx);
+                                goto out;
+                        }
+
+                        ret = -1;
+                        gf_log (this->name, GF_LOG_ERROR, "Brick Op failed "
+                                "due to rpc failure.");
+                        goto out;
+                }
+                ret = gd_syncop_mgmt_brick_op (rpc, pending_node, op, req_dict,
+                                               op_ctx, op_errstr);
+                if (ret)
+                        goto out;
+
+                brick_count++;
+        }
+
+        gf_log (this->name, GF_LOG_DEBUG, "Sent op req to %d bricks",
+                brick_count);
+out:
+        glusterd_clear_pending_nodes (&selected);
+        return ret;
+}
+
 void
 gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
 {
@@ -616,25 +794,28 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
         dict_t                      *req_dict       = NULL;
         dict_t                      *rsp_dict       = NULL;
         glusterd_peerinfo_t         *peerinfo       = NULL;
-        glusterd_peerinfo_t         *tmp            = NULL;
         glusterd_conf_t             *conf           = NULL;
         uuid_t                      tmp_uuid        = {0,};
         glusterd_op_t               op              = 0;
         int32_t                     tmp_op          = 0;
         gf_boolean_t                local_locked    = _gf_false;
         char                        *op_errstr      = NULL;
-        glusterd_pending_node_t     *pending_node   = NULL;
-        rpc_clnt_t                  *rpc            = NULL;
-        int                         brick_count     = 0;
-        struct list_head            selected        = {0};
         xlator_t                    *this           = NULL;
         char                        *hostname       = NULL;
+        char                        *volname        = NULL;
+        gd_xaction_scope_t          scope           = GD_XACTION_CLUSTER;
+        gd_xaction_peer_t           *xpeer          = NULL;
+        struct list_head            xaction_peers   = {0};
+        int                         stage_proc      = GLUSTERD_MGMT_STAGE_OP;
+        int                         commit_proc     = GLUSTERD_MGMT_COMMIT_OP;
 
         this = THIS;
         GF_ASSERT (this);
         conf = this->private;
         GF_ASSERT (conf);
 
+        INIT_LIST_HEAD (&xaction_peers);
+
         ret = dict_get_int32 (op_ctx, GD_SYNC_OPCODE_KEY, &tmp_op);
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR, "Failed to get volume "
@@ -644,8 +825,25 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
 
         op = tmp_op;
 
+        ret = glusterd_set_originator_uuid (op_ctx);
+        if (ret) {
+                gf_log (this->name, GF_LOG_ERROR, "Failed to set originator "
+                        "uuid");
+                goto out;
+        }
+
+        scope = gd_xaction_scope_get (op, op_ctx, &volname);
+        if (scope == GD_XACTION_VOLUME) {
+                stage_proc  = GLUSTERD_MGMT_VOLUME_STAGE_OP;
+                commit_proc = GLUSTERD_MGMT_VOLUME_COMMIT_OP;
+        }
+
         /*  Lock everything */
-        ret = glusterd_lock (MY_UUID);
+        if (scope == GD_XACTION_CLUSTER)
+                ret = glusterd_lock (MY_UUID);
+        else if (scope == GD_XACTION_VOLUME)
+                ret = glusterd_volume_lock (volname, MY_UUID,
+                                            GD_OP_VOLUME_LOCK_SHARED (op));
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR, "Unable to acquire lock");
                 gf_asprintf (&op_errstr, "Another transaction is in progress. "
@@ -659,16 +857,21 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
          * This is still acceptable, as we are performing this under
          * the 'cluster' lock*/
 
-        glusterd_op_set_op  (op);
-        INIT_LIST_HEAD (&conf->xaction_peers);
+        if (scope == GD_XACTION_CLUSTER)
+                glusterd_op_set_op  (op);
         list_for_each_entry (peerinfo, &conf->peers, uuid_list) {
                 if (!peerinfo->connected)
                         continue;
                 if (peerinfo->state.state != GD_FRIEND_STATE_BEFRIENDED)
                         continue;
 
-                ret = gd_syncop_mgmt_lock (peerinfo->rpc,
-                                           MY_UUID, tmp_uuid);
+                if (scope == GD_XACTION_CLUSTER)
+                        ret = gd_syncop_mgmt_lock (peerinfo->rpc,
+                                                   MY_UUID, tmp_uuid);
+                else if (scope == GD_XACTION_VOLUME)
+                        ret = gd_syncop_mgmt_volume_lock (peerinfo->rpc,
+                                                          MY_UUID, tmp_uuid,
+                                                          op, op_ctx);
                 if (ret) {
                         gf_asprintf (&op_errstr, "Another transaction could be "
                                      "in progress. Please try again after "
@@ -676,13 +879,31 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
                         gf_log (this->name, GF_LOG_ERROR, "Failed to acquire "
                                 "lock on peer %s", peerinfo->hostname);
                         goto out;
-                } else {
-                        list_add_tail (&peerinfo->op_peers_list,
-                                       &conf->xaction_peers);
                 }
+
+                xpeer = GF_CALLOC (1, sizeof (*xpeer),
+                                   gf_gld_mt_xaction_peer_t);
+                if (!xpeer) {
+                        /* this one is locked all the same */
+                        if (scope == GD_XACTION_CLUSTER)
+                                gd_syncop_mgmt_unlock (peerinfo->rpc,
+                                                       MY_UUID, tmp_uuid);
+                        else if (scope == GD_XACTION_VOLUME)
+                                gd_syncop_mgmt_volume_unlock (peerinfo->rpc,
+                                                              MY_UUID, tmp_uuid,
+                                                              op, op_ctx);
+                        ret = -1;
+                        goto out;
+                }
+                xpeer->peerinfo = peerinfo;
+                list_add_tail (&xpeer->list, &xaction_peers);
         }
 
+        /* the payload of some ops takes from global state, e.g. the brick
+         * port of a new volume */
+        pthread_mutex_lock (&conf->xaction_lock);
         ret = glusterd_op_build_payload (&req_dict, &op_errstr, op_ctx);
+        pthread_mutex_unlock (&conf->xaction_lock);
         if (ret) {
                 gf_log (this->name, GF_LOG_ERROR, LOGSTR_BUILD_PAYLOAD,
                         gd_op_list[op]);
@@ -691,6 +912,10 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
                 goto out;
         }
 
+        ret = glusterd_set_originator_uuid (req_dict);
+        if (ret)
+                goto out;
+
         /* stage op */
         ret = -1;
         rsp_dict = dict_new ();
@@ -717,9 +942,10 @@ gd_sync_task_begin (dict_t *op_ctx, rpcsvc_request_t * req)
         dict_unref (rsp_dict);
         rsp_dict = NULL;
 
-        list_for_each_entry (peerinfo, &conf->xaction_peers, op_peers_list) {
+        list_for_each_entry (xpeer, &xaction_peers, list) {
+                peerinfo = xpeer->peerinfo;
                 ret = gd_syncop_mgmt_stage_op (peerinfo->rpc,
-                                               MY_UUID, tmp_uuid,
+                                               MY_UUID, tmp_uuid, stage_proc,
                                                op, req_dict, &rsp_dict,
                                                &op_errstr);
                 if (ret) {
@@ -753,41 +979,9 @@ stage_done:
         }
 
         /*brick op */
-        INIT_LIST_HEAD (&selected);
-        ret = glusterd_op_bricks_select (op, req_dict, &op_errstr, &selected);
-        if (ret) {
-                gf_log (this->name, GF_LOG_ERROR, "%s",
-                       (op_errstr)? op_errstr: "Brick op failed. Check "
-                       "glusterd log file for more details.");
+        ret = gd_brick_op_phase (op, op_ctx, req_dict, &op_errstr);
+        if (ret)
                 goto out;
-        }
-
-        brick_count = 0;
-        list_for_each_entry (pending_node, &selected, list) {
-                rpc = glusterd_pending_node_get_rpc (pending_node);
-                if (!rpc) {
-                        if (pending_node->type == GD_NODE_REBALANCE) {
-                                ret = 0;
-                                glusterd_defrag_volume_node_rsp (req_dict,
-                                                                 NULL, op_ctx);
-                                goto out;
-                        }
-
-                        ret = -1;
-                        gf_log (this->name, GF_LOG_ERROR, "Brick Op failed "
-                                "due to rpc failure.");
-                        goto out;
-                }
-                ret = gd_syncop_mgmt_brick_op (rpc, pending_node, op, req_dict,
-                                               op_ctx, &op_errstr);
-                if (ret)
-                        goto out;
-
-                brick_count++;
-        }
-
-        gf_log (this->name, GF_LOG_DEBUG, "Sent op req to %d bricks",
-                brick_count);
 
         /* commit op */
         rsp_dict = dict_new ();
@@ -811,9 +1005,10 @@ stage_done:
         dict_unref (rsp_dict);
         rsp_dict = NULL;
 
-        list_for_each_entry (peerinfo, &conf->xaction_peers, op_peers_list) {
+        list_for_each_entry (xpeer, &xaction_peers, list) {
+                peerinfo = xpeer->peerinfo;
                 ret = gd_syncop_mgmt_commit_op (peerinfo->rpc,
-                                                MY_UUID, tmp_uuid,
+                                                MY_UUID, tmp_uuid, commit_proc,
                                                 op, req_dict, &rsp_dict,
                                                 &op_errstr);
                 if (ret) {
@@ -847,18 +1042,27 @@ commit_done:
         ret = 0;
 out:
         if (local_locked) {
-                list_for_each_entry_safe (peerinfo, tmp, &conf->xaction_peers,
-                                          op_peers_list) {
-                        gd_syncop_mgmt_unlock (peerinfo->rpc,
-                                               MY_UUID, tmp_uuid);
-                        list_del_init (&peerinfo->op_peers_list);
+                list_for_each_entry (xpeer, &xaction_peers, list) {
+                        peerinfo = xpeer->peerinfo;
+                        if (scope == GD_XACTION_CLUSTER)
+                                gd_syncop_mgmt_unlock (peerinfo->rpc,
+                                                       MY_UUID, tmp_uuid);
+                        else if (scope == GD_XACTION_VOLUME)
+                                gd_syncop_mgmt_volume_unlock (peerinfo->rpc,
+                                                              MY_UUID, tmp_uuid,
+                                                              op, op_ctx);
                 }
 
                 /* Local node should be the one to be locked first,
                    unlocked last to prevent races */
-                glusterd_op_clear_op (op);
-                glusterd_unlock (MY_UUID);
+                if (scope == GD_XACTION_CLUSTER) {
+                        glusterd_op_clear_op (op);
+                        glusterd_unlock (MY_UUID);
+                } else if (scope == GD_XACTION_VOLUME) {
+                        glusterd_volume_unlock (volname, MY_UUID);
+                }
         }
+        gd_xaction_peers_free (&xaction_peers);
 
         glusterd_op_send_cli_response (op, ret, 0, req, op_ctx, op_errstr);
 
@@ -11,10 +11,25 @@
 #define __RPC_SYNCOP_H
 
 #include "syncop.h"
+#include "glusterd.h"
 
 
 #define GD_SYNC_OPCODE_KEY "sync-mgmt-operation"
 
+typedef enum gd_xaction_scope_ {
+        GD_XACTION_CLUSTER,     /* cluster lock, peers in the op-sm */
+        GD_XACTION_VOLUME,      /* lock on the volume of the op */
+} gd_xaction_scope_t;
+
+/* read-only operations share the lock of their volume */
+#define GD_OP_VOLUME_LOCK_SHARED(op) ((op) == GD_OP_STATUS_VOLUME)
+
+/* a peer taking part in a synctask transaction */
+typedef struct gd_xaction_peer_ {
+        struct list_head         list;
+        glusterd_peerinfo_t     *peerinfo;
+} gd_xaction_peer_t;
+
 /* gd_syncop_* */
 #define GD_SYNCOP(rpc, stb, cbk, req, prog, procnum, xdrproc) do {      \
                 int ret = 0;                                            \
@@ -40,11 +55,19 @@ int gd_syncop_mgmt_lock (struct rpc_clnt *rpc, uuid_t my_uuid,
                           uuid_t recv_uuid);
 int gd_syncop_mgmt_unlock (struct rpc_clnt *rpc, uuid_t my_uuid,
                             uuid_t recv_uuid);
+int gd_syncop_mgmt_volume_lock (struct rpc_clnt *rpc, uuid_t my_uuid,
+                                uuid_t recv_uuid, int op, dict_t *dict_out);
+int gd_syncop_mgmt_volume_unlock (struct rpc_clnt *rpc, uuid_t my_uuid,
+                                  uuid_t recv_uuid, int op, dict_t *dict_out);
 int gd_syncop_mgmt_stage_op (struct rpc_clnt *rpc, uuid_t my_uuid,
-                              uuid_t recv_uuid, int op, dict_t *dict_out,
-                              dict_t **dict_in, char **errstr);
+                              uuid_t recv_uuid, int procnum, int op,
+                              dict_t *dict_out, dict_t **dict_in,
+                              char **errstr);
 int gd_syncop_mgmt_commit_op (struct rpc_clnt *rpc, uuid_t my_uuid,
-                               uuid_t recv_uuid, int op, dict_t *dict_out,
-                               dict_t **dict_in, char **errstr);
+                               uuid_t recv_uuid, int procnum, int op,
+                               dict_t *dict_out, dict_t **dict_in,
+                               char **errstr);
+int gd_brick_op_phase (glusterd_op_t op, dict_t *op_ctx, dict_t *req_dict,
+                       char **op_errstr);
 
 #endif /* __RPC_SYNCOP_H */
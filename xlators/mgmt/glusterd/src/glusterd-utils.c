@@ -73,6 +73,14 @@
 
 static glusterd_lock_t lock;
 
+/* Volume locks taken by transactions that touch a single volume. The
+ * cluster lock above excludes all of them and they exclude it, so that
+ * peer and cluster wide operations still run alone. Read-only transactions
+ * share the lock of their volume with each other.
+ */
+static struct list_head vol_locks = {&vol_locks, &vol_locks};
+static pthread_mutex_t  lock_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 static void
 md5_wrapper(const unsigned char *data, size_t len, char *md5)
 {
@@ -304,6 +312,26 @@ out:
         return found;
 }
 
+/* The first lock on @volname held by @uuid, by anyone if @uuid is NULL,
+ * and only an exclusive one if @excl is set */
+static glusterd_vol_lock_t *
+__glusterd_volume_lock_find (char *volname, uuid_t uuid, gf_boolean_t excl)
+{
+        glusterd_vol_lock_t *vol_lock = NULL;
+
+        list_for_each_entry (vol_lock, &vol_locks, list) {
+                if (strcmp (vol_lock->volname, volname))
+                        continue;
+                if (uuid && uuid_compare (uuid, vol_lock->owner))
+                        continue;
+                if (excl && vol_lock->shared)
+                        continue;
+                return vol_lock;
+        }
+
+        return NULL;
+}
+
 int32_t
 glusterd_lock (uuid_t   uuid)
 {
@@ -313,30 +341,46 @@ glusterd_lock (uuid_t   uuid)
         char    owner_str[50];
         int     ret = -1;
         xlator_t *this = NULL;
+        glusterd_vol_lock_t *vol_lock = NULL;
 
         this = THIS;
         GF_ASSERT (this);
 
         GF_ASSERT (uuid);
 
-        glusterd_get_lock_owner (&owner);
+        pthread_mutex_lock (&lock_mutex);
+        {
+                glusterd_get_lock_owner (&owner);
 
-        if (!uuid_is_null (owner)) {
-                gf_log (this->name, GF_LOG_ERROR, "Unable to get lock"
-                        " for uuid: %s, lock held by: %s",
-                        uuid_utoa_r (uuid, new_owner_str),
-                        uuid_utoa_r (owner, owner_str));
-                goto out;
-        }
+                if (!uuid_is_null (owner)) {
+                        gf_log (this->name, GF_LOG_ERROR, "Unable to get lock"
+                                " for uuid: %s, lock held by: %s",
+                                uuid_utoa_r (uuid, new_owner_str),
+                                uuid_utoa_r (owner, owner_str));
+                        goto unlock;
+                }
 
-        ret = glusterd_set_lock_owner (uuid);
+                if (!list_empty (&vol_locks)) {
+                        vol_lock = list_entry (vol_locks.next,
+                                               glusterd_vol_lock_t, list);
+                        gf_log (this->name, GF_LOG_ERROR, "Unable to get lock"
+                                " for uuid: %s, volume %s locked by: %s",
+                                uuid_utoa_r (uuid, new_owner_str),
+                                vol_lock->volname,
+                                uuid_utoa_r (vol_lock->owner, owner_str));
+                        goto unlock;
+                }
+
+                ret = glusterd_set_lock_owner (uuid);
+        }
+unlock:
+        pthread_mutex_unlock (&lock_mutex);
 
         if (!ret) {
                 gf_log (this->name, GF_LOG_DEBUG, "Cluster lock held by"
                          " %s", uuid_utoa (uuid));
         }
 
-out:
         return ret;
 }
 
@@ -355,6 +399,8 @@ glusterd_unlock (uuid_t uuid)
 
         GF_ASSERT (uuid);
 
+        pthread_mutex_lock (&lock_mutex);
+
         glusterd_get_lock_owner (&owner);
 
         if (uuid_is_null (owner)) {
@@ -382,9 +428,166 @@ glusterd_unlock (uuid_t uuid)
         ret = 0;
 
 out:
+        pthread_mutex_unlock (&lock_mutex);
+        return ret;
+}
+
+int32_t
+glusterd_volume_lock (char *volname, uuid_t uuid, gf_boolean_t shared)
+{
+        uuid_t               owner;
+        char                 new_owner_str[50];
+        char                 owner_str[50];
+        int32_t              ret      = -1;
+        xlator_t            *this     = NULL;
+        glusterd_vol_lock_t *vol_lock = NULL;
+
+        this = THIS;
+        GF_ASSERT (this);
+
+        GF_ASSERT (volname);
+        GF_ASSERT (uuid);
+
+        pthread_mutex_lock (&lock_mutex);
+
+        glusterd_get_lock_owner (&owner);
+
+        if (!uuid_is_null (owner)) {
+                gf_log (this->name, GF_LOG_ERROR, "Unable to lock volume %s "
+                        "for uuid: %s, cluster lock held by: %s", volname,
+                        uuid_utoa_r (uuid, new_owner_str),
+                        uuid_utoa_r (owner, owner_str));
+                goto out;
+        }
+
+        /* a shared lock only waits for an exclusive one */
+        vol_lock = __glusterd_volume_lock_find (volname, NULL, shared);
+        if (vol_lock) {
+                gf_log (this->name, GF_LOG_ERROR, "Unable to lock volume %s "
+                        "for uuid: %s, lock held by: %s", volname,
+                        uuid_utoa_r (uuid, new_owner_str),
+                        uuid_utoa_r (vol_lock->owner, owner_str));
+                vol_lock = NULL;
+                goto out;
+        }
+
+        vol_lock = GF_CALLOC (1, sizeof (*vol_lock), gf_gld_mt_vol_lock_t);
+        if (!vol_lock)
+                goto out;
+
+        vol_lock->volname = gf_strdup (volname);
+        if (!vol_lock->volname) {
+                GF_FREE (vol_lock);
+                goto out;
+        }
+
+        uuid_copy (vol_lock->owner, uuid);
+        vol_lock->shared = shared;
+        list_add_tail (&vol_lock->list, &vol_locks);
+        ret = 0;
+
+out:
+        pthread_mutex_unlock (&lock_mutex);
+
+        if (!ret)
+                gf_log (this->name, GF_LOG_DEBUG, "Volume %s locked%s by %s",
+                        volname, shared ? " (shared)" : "",
+                        uuid_utoa (uuid));
+        return ret;
+}
+
+int32_t
+glusterd_volume_unlock (char *volname, uuid_t uuid)
+{
+        char                 new_owner_str[50];
+        char                 owner_str[50];
+        int32_t              ret      = -1;
+        xlator_t            *this     = NULL;
+        glusterd_vol_lock_t *vol_lock = NULL;
+
+        this = THIS;
+        GF_ASSERT (this);
+
+        GF_ASSERT (volname);
+        GF_ASSERT (uuid);
+
+        pthread_mutex_lock (&lock_mutex);
+
+        vol_lock = __glusterd_volume_lock_find (volname, uuid, _gf_false);
+        if (!vol_lock)
+                vol_lock = __glusterd_volume_lock_find (volname, NULL,
+                                                        _gf_false);
+        if (!vol_lock) {
+                gf_log (this->name, GF_LOG_ERROR, "Volume %s not locked!",
+                        volname);
+                goto out;
+        }
+
+        if (uuid_compare (uuid, vol_lock->owner)) {
+                gf_log (this->name, GF_LOG_ERROR, "Volume %s locked by %s, "
+                        "unlock req from %s!", volname,
+                        uuid_utoa_r (vol_lock->owner, owner_str),
+                        uuid_utoa_r (uuid, new_owner_str));
+                goto out;
+        }
+
+        list_del_init (&vol_lock->list);
+        GF_FREE (vol_lock->volname);
+        GF_FREE (vol_lock);
+        ret = 0;
+
+out:
+        pthread_mutex_unlock (&lock_mutex);
         return ret;
 }
 
+/* Drops the volume locks of a peer that went away in the middle of its
+ * transactions, returns the number of locks released.
+ */
+int
+glusterd_volume_unlock_all (uuid_t uuid)
+{
+        int                  count    = 0;
+        glusterd_vol_lock_t *vol_lock = NULL;
+        glusterd_vol_lock_t *tmp      = NULL;
+
+        pthread_mutex_lock (&lock_mutex);
+        {
+                list_for_each_entry_safe (vol_lock, tmp, &vol_locks, list) {
+                        if (uuid_compare (uuid, vol_lock->owner))
+                                continue;
+                        gf_log (THIS->name, GF_LOG_INFO, "Releasing lock on "
+                                "volume %s held by %s", vol_lock->volname,
+                                uuid_utoa (uuid));
+                        list_del_init (&vol_lock->list);
+                        GF_FREE (vol_lock->volname);
+                        GF_FREE (vol_lock);
+                        count++;
+                }
+        }
+        pthread_mutex_unlock (&lock_mutex);
+
+        return count;
+}
+
+gf_boolean_t
+glusterd_volume_is_locked_by (char *volname, uuid_t uuid)
+{
+        gf_boolean_t         locked   = _gf_false;
+        glusterd_vol_lock_t *vol_lock = NULL;
+
+        pthread_mutex_lock (&lock_mutex);
+        {
+                vol_lock = __glusterd_volume_lock_find (volname, uuid,
+                                                        _gf_false);
+                if (vol_lock)
+                        locked = _gf_true;
+        }
+        pthread_mutex_unlock (&lock_mutex);
+
+        return locked;
+}
+
 
 int
 glusterd_get_uuid (uuid_t *uuid)
@@ -6690,7 +6893,7 @@ glusterd_volume_status_copy_to_op_ctx_dict (dict_t *aggr, dict_t *rsp_dict)
         if (ret)
                 goto out;
 
-        if (cmd & GF_CLI_STATUS_ALL && is_origin_glusterd ()) {
+        if (cmd & GF_CLI_STATUS_ALL && is_origin_glusterd (ctx_dict)) {
                 ret = dict_get_int32 (rsp_dict, "vol_count", &vol_count);
                 if (ret == 0) {
                         ret = dict_set_int32 (ctx_dict, "vol_count",
@@ -6934,12 +7137,9 @@ int
 glusterd_volume_clearlocks_use_rsp_dict (dict_t *aggr, dict_t *rsp_dict)
 {
         int            ret      = 0;
-        glusterd_op_t  op       = GD_OP_NONE;
 
-        op = glusterd_op_get_op ();
         GF_ASSERT (aggr);
         GF_ASSERT (rsp_dict);
-        GF_ASSERT (GD_OP_CLEARLOCKS_VOLUME == op);
 
         if (!aggr)
                 goto out;
@@ -7323,14 +7523,23 @@ glusterd_handle_node_rsp (dict_t *req_dict, void *pending_entry,
 }
 
 /* Should be used only when an operation is in progress, as that is the only
- * time a lock_owner is set
+ * time a lock_owner is set. Transactions under volume locks carry their
+ * originator in the op dict instead, pass it when at hand.
  */
 gf_boolean_t
-is_origin_glusterd ()
+is_origin_glusterd (dict_t *dict)
 {
         int     ret = 0;
+        char   *originator = NULL;
         uuid_t  lock_owner = {0,};
 
+        if (dict && !dict_get_str (dict, "originator_uuid", &originator)) {
+                ret = uuid_parse (originator, lock_owner);
+                if (ret)
+                        return _gf_false;
+                return (uuid_compare (MY_UUID, lock_owner) == 0);
+        }
+
         ret = glusterd_get_lock_owner (&lock_owner);
         if (ret)
                 return _gf_false;
@@ -7338,6 +7547,23 @@ is_origin_glusterd ()
         return (uuid_compare (MY_UUID, lock_owner) == 0);
 }
 
+int
+glusterd_set_originator_uuid (dict_t *dict)
+{
+        int     ret = -1;
+        char   *originator = NULL;
+
+        originator = gf_strdup (uuid_utoa (MY_UUID));
+        if (!originator)
+                goto out;
+
+        ret = dict_set_dynstr (dict, "originator_uuid", originator);
+        if (ret)
+                GF_FREE (originator);
+out:
+        return ret;
+}
+
 int
 glusterd_generate_and_set_task_id (dict_t *dict, char *key)
 {
@@ -35,6 +35,14 @@ struct glusterd_lock_ {
         time_t  timestamp;
 };
 
+struct glusterd_vol_lock_ {
+        struct list_head  list;
+        char             *volname;
+        uuid_t            owner;
+        gf_boolean_t      shared;    /* read-only, held along others */
+};
+typedef struct glusterd_vol_lock_ glusterd_vol_lock_t;
+
 typedef struct glusterd_dict_ctx_ {
         dict_t  *dict;
         int     opt_count;
@@ -60,6 +68,18 @@ glusterd_lock (uuid_t new_owner);
 int32_t
 glusterd_unlock (uuid_t owner);
 
+int32_t
+glusterd_volume_lock (char *volname, uuid_t owner, gf_boolean_t shared);
+
+int32_t
+glusterd_volume_unlock (char *volname, uuid_t owner);
+
+int
+glusterd_volume_unlock_all (uuid_t owner);
+
+gf_boolean_t
+glusterd_volume_is_locked_by (char *volname, uuid_t owner);
+
 int32_t
 glusterd_get_uuid (uuid_t *uuid);
 
@@ -481,7 +501,10 @@ glusterd_profile_volume_brick_rsp (void *pending_entry,
  * time a lock_owner is set
  */
 gf_boolean_t
-is_origin_glusterd ();
+is_origin_glusterd (dict_t *dict);
+
+int
+glusterd_set_originator_uuid (dict_t *dict);
 
 gf_boolean_t
 glusterd_is_quorum_changed (dict_t *options, char *option, char *value);
@@ -108,6 +108,12 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"cluster.rebalance-stats",              "cluster/distribute", NULL, NULL, DOC, 0, 2},
         {"cluster.subvols-per-directory",        "cluster/distribute", "directory-layout-spread", NULL, DOC, 0, 2},
         {"cluster.readdir-optimize",             "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.readdir-parallel",             "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.lookup-optimize",              "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.negative-lookup-timeout",      "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.layout-vnodes",                "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.weighted-rebalance",           "cluster/distribute", NULL, NULL, DOC, 0, 2},
+        {"cluster.subvol-weights",               "cluster/distribute", NULL, NULL, DOC, 0, 2},
         {"cluster.nufa",                         "cluster/distribute", "!nufa", NULL, NO_DOC, 0, 2},
 
         /* AFR xlator options */
@@ -133,10 +139,13 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"cluster.self-heal-readdir-size",       "cluster/replicate",  NULL, NULL, DOC, 0, 2},
         {"cluster.post-op-delay-secs",           "cluster/replicate",  NULL, NULL, NO_DOC, 0, 2},
         {"cluster.readdir-failover",             "cluster/replicate",  NULL, NULL, DOC, 0, 2},
+        {"cluster.entry-eager-lock",             "cluster/replicate",  NULL, NULL, DOC, 0, 2},
+        {"cluster.read-split-size",              "cluster/replicate",  NULL, NULL, DOC, 0, 2},
 
         /* Stripe xlator options */
         {"cluster.stripe-block-size",            "cluster/stripe",     "block-size", NULL, DOC, 0, 1},
 	{"cluster.stripe-coalesce",		 "cluster/stripe",     "coalesce", NULL, DOC, 0, 2},
+        {"cluster.stripe-io-depth",              "cluster/stripe",     "io-depth", NULL, DOC, 0, 2},
 
         /* IO-stats xlator options */
         {VKEY_DIAG_LAT_MEASUREMENT,              "debug/io-stats",     "latency-measurement", "off", DOC, 0, 1},
@@ -146,6 +155,14 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"diagnostics.client-log-level",         "debug/io-stats",     "!client-log-level", NULL, DOC, 0, 1},
         {"diagnostics.brick-sys-log-level",      "debug/io-stats",     "!sys-log-level", NULL, DOC, 0, 1},
         {"diagnostics.client-sys-log-level",     "debug/io-stats",     "!sys-log-level", NULL, DOC, 0, 1},
+        {"diagnostics.brick-log-mode",           "debug/io-stats",     "!log-mode", NULL, DOC, 0, 2},
+        {"diagnostics.client-log-mode",          "debug/io-stats",     "!log-mode", NULL, DOC, 0, 2},
+        {"diagnostics.brick-log-format",         "debug/io-stats",     "!log-format", NULL, DOC, 0, 2},
+        {"diagnostics.client-log-format",        "debug/io-stats",     "!log-format", NULL, DOC, 0, 2},
+        {"diagnostics.brick-log-buf-size",       "debug/io-stats",     "!log-buf-size", NULL, DOC, 0, 2},
+        {"diagnostics.client-log-buf-size",      "debug/io-stats",     "!log-buf-size", NULL, DOC, 0, 2},
+        {"diagnostics.brick-log-flush-timeout",  "debug/io-stats",     "!log-flush-timeout", NULL, DOC, 0, 2},
+        {"diagnostics.client-log-flush-timeout", "debug/io-stats",     "!log-flush-timeout", NULL, DOC, 0, 2},
 
         /* IO-cache xlator options */
         {"performance.cache-max-file-size",      "performance/io-cache",      "max-file-size", NULL, DOC, 0, 1},
@@ -195,6 +212,7 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"features.lock-heal",                   "protocol/server",           "lk-heal", NULL, NO_DOC, 0, 1},
         {"features.grace-timeout",               "protocol/server",           "grace-timeout", NULL, NO_DOC, 0, 1},
         {"server.ssl",                           "protocol/server",           "transport.socket.ssl-enabled", NULL, NO_DOC, 0, 2},
+        {"server.zerocopy-threshold",            "protocol/server",           "transport.socket.zerocopy-threshold", NULL, NO_DOC, 0, 2},
 
         /* Performance xlators enable/disbable options */
         {"performance.write-behind",             "performance/write-behind",  "!perf", "on", NO_DOC, 0, 1},
@@ -221,6 +239,7 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {VKEY_MARKER_XTIME,                      "features/marker",           "xtime", "off", NO_DOC, OPT_FLAG_FORCE, 1},
         {VKEY_MARKER_XTIME,                      "features/marker",           "!xtime", "off", NO_DOC, OPT_FLAG_FORCE, 1},
         {VKEY_FEATURES_QUOTA,                    "features/marker",           "quota", "off", NO_DOC, OPT_FLAG_FORCE, 1},
+        {"features.quota-update-interval",       "features/marker",           "quota-update-interval", NULL, DOC, 0, 2},
 
         /* Debug xlators options */
         {"debug.trace",                          "debug/trace",               "!debug","off", NO_DOC, 0, 1},
@@ -233,6 +252,12 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         /* NFS xlator options */
         {"nfs.enable-ino32",                     "nfs/server",                "nfs.enable-ino32", NULL, GLOBAL_DOC, 0, 1},
         {"nfs.mem-factor",                       "nfs/server",                "nfs.mem-factor", NULL, GLOBAL_DOC, 0, 1},
+        {"nfs.write-gather-size",                "nfs/server",                "nfs3.write-gather-size", NULL, GLOBAL_DOC, 0, 2},
+        {"nfs.write-gather-budget",              "nfs/server",                "nfs3.write-gather-budget", NULL, GLOBAL_DOC, 0, 2},
+        {"nfs.fh-cache-size",                    "nfs/server",                "nfs3.fh-cache-size", NULL, GLOBAL_DOC, 0, 2},
+        {"nfs.fh-cache-file",                    "nfs/server",                "nfs3.fh-cache-file", NULL, GLOBAL_DOC, 0, 2},
+        {"nfs.readdir-cache-timeout",            "nfs/server",                "nfs3.readdir-cache-timeout", NULL, GLOBAL_DOC, 0, 2},
+        {"nfs.readdir-cache-entries",            "nfs/server",                "nfs3.readdir-cache-entries", NULL, GLOBAL_DOC, 0, 2},
         {"nfs.export-dirs",                      "nfs/server",                "nfs3.export-dirs", NULL, GLOBAL_DOC, 0, 1},
         {"nfs.export-volumes",                   "nfs/server",                "nfs3.export-volumes", NULL, GLOBAL_DOC, 0, 1},
         {"nfs.addr-namelookup",                  "nfs/server",                "rpc-auth.addr.namelookup", NULL, GLOBAL_DOC, 0, 1},
@@ -261,6 +286,9 @@ static struct volopt_map_entry glusterd_volopt_map[] = {
         {"storage.linux-aio",                    "storage/posix",             NULL, NULL, DOC, 0, 2},
         {"storage.owner-uid",                    "storage/posix",             "brick-uid", NULL, DOC, 0, 2},
         {"storage.owner-gid",                    "storage/posix",             "brick-gid", NULL, DOC, 0, 2},
+        {"changelog.changelog",                  "features/changelog",        NULL, NULL, NO_DOC, 0, 2},
+        {"changelog.rollover-time",              "features/changelog",        NULL, NULL, NO_DOC, 0, 2},
+        {"changelog.fsync-interval",             "features/changelog",        NULL, NULL, NO_DOC, 0, 2},
         {"config.memory-accounting",             "configuration",             "!config", NULL, DOC, 0, 2},
         {"config.transport",                     "configuration",             "!config", NULL, DOC, 0, 2},
         {GLUSTERD_QUORUM_TYPE_KEY,               "mgmt/glusterd",             NULL, "off", DOC, 0, 2},
@@ -1552,6 +1580,28 @@ sys_loglevel_option_handler (volgen_graph_t *graph,
         return basic_option_handler (graph, &vme2, NULL);
 }
 
+static int
+logger_option_handler (volgen_graph_t *graph,
+                       struct volopt_map_entry *vme, void *param)
+{
+        char  *role = NULL;
+        struct volopt_map_entry vme2 = {0,};
+
+        role = (char *) param;
+
+        if ((strcmp (vme->option, "!log-mode") != 0 &&
+             strcmp (vme->option, "!log-format") != 0 &&
+             strcmp (vme->option, "!log-buf-size") != 0 &&
+             strcmp (vme->option, "!log-flush-timeout") != 0) ||
+            !strstr (vme->key, role))
+                return 0;
+
+        memcpy (&vme2, vme, sizeof (vme2));
+        vme2.option = vme->option + 1;
+
+        return basic_option_handler (graph, &vme2, NULL);
+}
+
 static int
 volgen_graph_set_xl_options (volgen_graph_t *graph, dict_t *dict)
 {
@@ -1604,6 +1654,9 @@ server_spec_option_handler (volgen_graph_t *graph,
         if (!ret)
                 ret = sys_loglevel_option_handler (graph, vme, "brick");
 
+        if (!ret)
+                ret = logger_option_handler (graph, vme, "brick");
+
         return ret;
 }
 
@@ -1646,6 +1699,7 @@ server_graph_builder (volgen_graph_t *graph, glusterd_volinfo_t *volinfo,
         char     *username                = NULL;
         char     *password                = NULL;
         char     index_basepath[PATH_MAX] = {0};
+        char     changelog_basepath[PATH_MAX] = {0};
         char     key[1024]                = {0};
         char     *vgname                  = NULL;
         char     *vg                      = NULL;
@@ -1706,6 +1760,21 @@ server_graph_builder (volgen_graph_t *graph, glusterd_volinfo_t *volinfo,
                                                 "posix");
                 if (ret)
                         return -1;
+
+                xl = volgen_graph_add (graph, "features/changelog", volname);
+                if (!xl)
+                        return -1;
+
+                ret = xlator_set_option (xl, "changelog-brick", path);
+                if (ret)
+                        return -1;
+
+                snprintf (changelog_basepath, sizeof (changelog_basepath),
+                          "%s/%s", path, ".glusterfs/changelogs");
+                ret = xlator_set_option (xl, "changelog-dir",
+                                         changelog_basepath);
+                if (ret)
+                        return -1;
         }
         xl = volgen_graph_add (graph, "features/access-control", volname);
         if (!xl)
@@ -2654,6 +2723,12 @@ client_graph_builder (volgen_graph_t *graph, glusterd_volinfo_t *volinfo,
         if (ret)
                 gf_log (THIS->name, GF_LOG_WARNING, "changing client syslog "
                         "level failed");
+
+        ret = volgen_graph_set_options_generic (graph, set_dict, "client",
+                                                &logger_option_handler);
+        if (ret)
+                gf_log (THIS->name, GF_LOG_WARNING, "changing client logger "
+                        "options failed");
 out:
         return ret;
 }
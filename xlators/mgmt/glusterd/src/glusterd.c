@@ -1079,6 +1079,7 @@ init (xlator_t *this)
         INIT_LIST_HEAD (&conf->peers);
         INIT_LIST_HEAD (&conf->volumes);
         pthread_mutex_init (&conf->mutex, NULL);
+        pthread_mutex_init (&conf->xaction_lock, NULL);
         conf->rpc = rpc;
         conf->gfs_mgmt = &gd_brick_prog;
         strncpy (conf->workdir, workdir, PATH_MAX);
@@ -46,6 +46,9 @@
 #define GLUSTERD_QUORUM_TYPE_KEY        "cluster.server-quorum-type"
 #define GLUSTERD_QUORUM_RATIO_KEY       "cluster.server-quorum-ratio"
 #define GLUSTERD_GLOBAL_OPT_VERSION     "global-option-version"
+/* first op-version whose glusterd takes volume locks and runs staging and
+ * commit outside of the op state machine */
+#define GD_OP_VERSION_VOLUME_LOCKS      3
 
 #define GLUSTERD_SERVER_QUORUM "server"
 
@@ -98,8 +101,9 @@ typedef enum glusterd_op_ {
 
 extern const char * gd_op_list[];
 struct glusterd_store_iter_ {
-        int     fd;
-        FILE    *file;
+        char    *buf;   /* the whole file, read once */
+        size_t   len;
+        size_t   off;
         char    filepath[PATH_MAX];
 };
 
@@ -124,7 +128,6 @@ typedef struct {
         struct _volfile_ctx *volfile;
 	pthread_mutex_t   mutex;
 	struct list_head  peers;
-	struct list_head  xaction_peers;
         gf_boolean_t      verify_volfile_checksum;
         gf_boolean_t      trace;
         uuid_t            uuid;
@@ -152,6 +155,8 @@ typedef struct {
         xlator_t       *xl;  /* Should be set to 'THIS' before creating thread */
         gf_boolean_t   pending_quorum_action;
         dict_t             *opts;
+        pthread_mutex_t     xaction_lock; /* stage and commit of concurrent
+                                             volume transactions */
 } glusterd_conf_t;
 
 
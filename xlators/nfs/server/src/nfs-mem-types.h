@@ -54,6 +54,11 @@ enum gf_nfs_mem_types_ {
         gf_nfs_mt_nlm4_share,
         gf_nfs_mt_aux_gids,
         gf_nfs_mt_inode_ctx,
+        gf_nfs_mt_nfs3_write_gather,
+        gf_nfs_mt_nfs3_write_gather_error,
+        gf_nfs_mt_nfs3_fhcache,
+        gf_nfs_mt_nfs3_dircache,
+        gf_nfs_mt_nsm_pending,
         gf_nfs_mt_end
 };
 #endif
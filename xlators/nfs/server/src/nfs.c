@@ -40,6 +40,8 @@
 #include "nfs3.h"
 #include "nfs-mem-types.h"
 #include "nfs3-helpers.h"
+#include "nfs3-fhcache.h"
+#include "nfs3-dircache.h"
 #include "nlm4.h"
 #include "options.h"
 #include "acl3.h"
@@ -886,6 +888,10 @@ fini (xlator_t *this)
 
         nfs = (struct nfs_state *)this->private;
         gf_log (GF_NFS, GF_LOG_DEBUG, "NFS service going down");
+        if (nfs->nfs3state) {
+                nfs3_fhcache_stop (nfs->nfs3state->fhcache);
+                nfs3_fhcache_save (nfs->nfs3state->fhcache);
+        }
         nfs_deinit_versions (&nfs->versions, this);
         return 0;
 }
@@ -996,6 +1002,13 @@ nlm_priv (xlator_t *this);
 int32_t
 nfs_priv (xlator_t *this)
 {
+        struct nfs_state        *nfs = this->private;
+
+        if (nfs && nfs->nfs3state) {
+                nfs3_fhcache_dump (nfs->nfs3state->fhcache);
+                nfs3_dircache_dump (nfs->nfs3state->dircache);
+        }
+
         return nlm_priv (this);
 }
 
@@ -1034,6 +1047,56 @@ struct volume_options options[] = {
           .description = "Size in which the client should issue directory "
                          " reading requests."
         },
+        { .key  = {"nfs3.write-gather-size"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .description = "Adjacent UNSTABLE writes to a file are acknowledged"
+                         " right away and sent to the volume together, in "
+                         "writes of up to this size. They are written out on "
+                         "COMMIT, before any other request on the file and "
+                         "after a second at the latest. 0 disables gathering."
+                         " 1MB by default."
+        },
+        { .key  = {"nfs3.fh-cache-size"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 16777216,
+          .description = "Number of file handles whose parent and name are "
+                         "remembered, so that a handle that is not in the "
+                         "inode table any more can be resolved with a lookup "
+                         "on one subvolume instead of all of them. 0 disables"
+                         " the cache. 65536 by default."
+        },
+        { .key  = {"nfs3.fh-cache-file"},
+          .type = GF_OPTION_TYPE_PATH,
+          .description = "File the fh cache is saved to every minute and on "
+                         "shutdown, and loaded from at start-up, so that it "
+                         "is warm after a restart of the NFS server."
+        },
+        { .key  = {"nfs3.readdir-cache-timeout"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .max  = 3600,
+          .description = "Seconds for which the entries of a directory read "
+                         "by a client are kept to serve the following pages "
+                         "of its READDIR and READDIRPLUS requests. Entry ops "
+                         "through this server and changes to the mtime of "
+                         "the directory drop them earlier. 0 disables the "
+                         "cache. 5 by default."
+        },
+        { .key  = {"nfs3.readdir-cache-entries"},
+          .type = GF_OPTION_TYPE_INT,
+          .min  = 0,
+          .description = "Number of directory entries kept by the readdir "
+                         "cache for all directories together. Pages of a "
+                         "bigger directory are read from the volume once "
+                         "this is reached. 262144 by default."
+        },
+        { .key  = {"nfs3.write-gather-budget"},
+          .type = GF_OPTION_TYPE_SIZET,
+          .description = "Total size of the UNSTABLE writes gathered for all "
+                         "files. Once it is reached, all of them are written "
+                         "out. 64MB by default."
+        },
         { .key  = {"nfs3.*.volume-access"},
           .type = GF_OPTION_TYPE_STR,
           .value = {"read-only", "read-write"},
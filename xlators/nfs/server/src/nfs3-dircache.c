@@ -0,0 +1,596 @@
+/*
+ * Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "nfs.h"
+#include "nfs3.h"
+#include "nfs3-fh.h"
+#include "nfs3-dircache.h"
+#include "nfs-mem-types.h"
+#include "xdr-nfs3.h"
+#include "statedump.h"
+
+static struct list_head *
+nfs3_dircache_bucket (nfs3_dircache_table_t *table, uuid_t gfid)
+{
+        uint64_t        hash = 0;
+
+        memcpy (&hash, gfid + 8, sizeof (hash));
+        return &table->buckets[hash % GF_NFS3_DIRCACHE_BUCKETS];
+}
+
+
+static void
+nfs3_dircache_destroy (nfs3_dircache_t *dc)
+{
+        gf_dirent_free (&dc->entries);
+        GF_FREE (dc);
+}
+
+
+/*
+ * Take @dc out of the table. It goes away once the calls still serving
+ * from it are done, its entries no longer count against the budget right
+ * away. Returns 1 if the caller has to destroy it.
+ */
+static int
+__nfs3_dircache_unlink (nfs3_dircache_table_t *table, nfs3_dircache_t *dc)
+{
+        list_del_init (&dc->hash);
+        list_del_init (&dc->lru);
+        dc->stale = 1;
+        table->dirs--;
+        table->entries -= dc->count;
+
+        return (--dc->ref == 0);
+}
+
+
+static nfs3_dircache_t *
+__nfs3_dircache_find (nfs3_dircache_table_t *table, uuid_t gfid)
+{
+        nfs3_dircache_t         *dc = NULL;
+
+        list_for_each_entry (dc, nfs3_dircache_bucket (table, gfid), hash) {
+                if (uuid_compare (dc->gfid, gfid) == 0)
+                        return dc;
+        }
+
+        return NULL;
+}
+
+
+nfs3_dircache_table_t *
+nfs3_dircache_table_new (uint32_t timeout, uint64_t max_entries)
+{
+        nfs3_dircache_table_t   *table = NULL;
+        int                     i = 0;
+
+        table = GF_CALLOC (1, sizeof (*table), gf_nfs_mt_nfs3_dircache);
+        if (!table)
+                return NULL;
+
+        LOCK_INIT (&table->lock);
+        for (i = 0; i < GF_NFS3_DIRCACHE_BUCKETS; i++) {
+                INIT_LIST_HEAD (&table->buckets[i]);
+                INIT_LIST_HEAD (&table->changes[i]);
+        }
+        INIT_LIST_HEAD (&table->lru);
+        INIT_LIST_HEAD (&table->change_lru);
+        table->timeout = timeout;
+        table->max_entries = max_entries;
+
+        return table;
+}
+
+
+/* Changes whenever an entry is added to or removed from the directory */
+uint64_t
+nfs3_dircache_verf (struct iatt *buf)
+{
+        uint64_t        verf = 0;
+
+        verf = ((uint64_t)buf->ia_mtime << 32) ^ buf->ia_mtime_nsec;
+        verf ^= ((uint64_t)buf->ia_ctime_nsec << 32) ^ buf->ia_ctime;
+
+        /* a zero verifier means no cookie was handed out yet */
+        return verf ? verf : 1;
+}
+
+
+/*
+ * The cache of the directory @gfid, empty if it was not cached, or was
+ * cached with a different @verf or too long ago. Put it when done.
+ */
+nfs3_dircache_t *
+nfs3_dircache_get (nfs3_dircache_table_t *table, uuid_t gfid, uint64_t verf)
+{
+        nfs3_dircache_t         *dc = NULL;
+        nfs3_dircache_t         *old = NULL;
+        time_t                  now = 0;
+        int                     destroy = 0;
+
+        if (!table)
+                return NULL;
+
+        now = time (NULL);
+
+        LOCK (&table->lock);
+        {
+                dc = __nfs3_dircache_find (table, gfid);
+                if (dc && ((dc->verf != verf) || (now >= dc->expire))) {
+                        old = dc;
+                        destroy = __nfs3_dircache_unlink (table, old);
+                        dc = NULL;
+                }
+
+                if (!dc) {
+                        dc = GF_CALLOC (1, sizeof (*dc),
+                                        gf_nfs_mt_nfs3_dircache);
+                        if (!dc)
+                                goto unlock;
+
+                        INIT_LIST_HEAD (&dc->entries.list);
+                        uuid_copy (dc->gfid, gfid);
+                        dc->verf = verf;
+                        dc->born = now;
+                        dc->expire = now + table->timeout;
+                        dc->ref = 1;
+                        list_add (&dc->hash, nfs3_dircache_bucket (table,
+                                                                   gfid));
+                        INIT_LIST_HEAD (&dc->lru);
+                        table->dirs++;
+                }
+
+                list_move (&dc->lru, &table->lru);
+                dc->ref++;
+        }
+unlock:
+        UNLOCK (&table->lock);
+
+        if (destroy)
+                nfs3_dircache_destroy (old);
+
+        return dc;
+}
+
+
+void
+nfs3_dircache_put (nfs3_dircache_table_t *table, nfs3_dircache_t *dc)
+{
+        int     destroy = 0;
+
+        if (!table || !dc)
+                return;
+
+        LOCK (&table->lock);
+        {
+                destroy = (--dc->ref == 0);
+        }
+        UNLOCK (&table->lock);
+
+        if (destroy)
+                nfs3_dircache_destroy (dc);
+}
+
+
+void
+nfs3_dircache_invalidate (nfs3_dircache_table_t *table, uuid_t gfid)
+{
+        nfs3_dircache_t         *dc = NULL;
+        int                     destroy = 0;
+
+        if (!table || uuid_is_null (gfid))
+                return;
+
+        LOCK (&table->lock);
+        {
+                dc = __nfs3_dircache_find (table, gfid);
+                if (dc) {
+                        destroy = __nfs3_dircache_unlink (table, dc);
+                        table->invalidations++;
+                }
+        }
+        UNLOCK (&table->lock);
+
+        if (destroy)
+                nfs3_dircache_destroy (dc);
+}
+
+
+/* Drop the parent directory of the entry at @loc */
+void
+nfs3_dircache_invalidate_loc (nfs3_dircache_table_t *table, loc_t *loc)
+{
+        if (!table || !loc)
+                return;
+
+        if (loc->parent)
+                nfs3_dircache_invalidate (table, loc->parent->gfid);
+        else
+                nfs3_dircache_invalidate (table, loc->pargfid);
+}
+
+
+static nfs3_dircache_change_t *
+__nfs3_dircache_change_find (nfs3_dircache_table_t *table, uuid_t gfid)
+{
+        nfs3_dircache_change_t  *change = NULL;
+
+        list_for_each_entry (change, &table->changes[gfid[15] %
+                                                     GF_NFS3_DIRCACHE_BUCKETS],
+                             hash) {
+                if (uuid_compare (change->gfid, gfid) == 0)
+                        return change;
+        }
+
+        return NULL;
+}
+
+
+static void
+__nfs3_dircache_change_del (nfs3_dircache_table_t *table,
+                            nfs3_dircache_change_t *change)
+{
+        list_del (&change->hash);
+        list_del (&change->lru);
+        table->nchanges--;
+        GF_FREE (change);
+}
+
+
+/*
+ * The data or the attributes of the file @gfid were changed through this
+ * server. Changes older than the timeout are forgotten, no cache is that
+ * old. If still more changes are around than can be remembered, the
+ * whole cache is dropped instead of forgetting a recent one.
+ */
+void
+nfs3_dircache_changed (nfs3_dircache_table_t *table, uuid_t gfid)
+{
+        nfs3_dircache_change_t  *change = NULL;
+        nfs3_dircache_t         *dc = NULL;
+        nfs3_dircache_t         *next = NULL;
+        struct list_head        doomed;
+        time_t                  now = 0;
+
+        if (!table || uuid_is_null (gfid))
+                return;
+
+        INIT_LIST_HEAD (&doomed);
+        now = time (NULL);
+
+        LOCK (&table->lock);
+        {
+                while (!list_empty (&table->change_lru)) {
+                        change = list_entry (table->change_lru.prev,
+                                             nfs3_dircache_change_t, lru);
+                        if (change->when + table->timeout > now)
+                                break;
+                        __nfs3_dircache_change_del (table, change);
+                }
+
+                change = __nfs3_dircache_change_find (table, gfid);
+                if (change) {
+                        change->when = now;
+                        list_move (&change->lru, &table->change_lru);
+                        goto unlock;
+                }
+
+                if (table->nchanges >= GF_NFS3_DIRCACHE_CHANGES) {
+                        list_for_each_entry_safe (dc, next, &table->lru,
+                                                  lru) {
+                                table->invalidations++;
+                                if (__nfs3_dircache_unlink (table, dc))
+                                        list_add (&dc->lru, &doomed);
+                        }
+                        while (!list_empty (&table->change_lru)) {
+                                change = list_entry (table->change_lru.next,
+                                                     nfs3_dircache_change_t,
+                                                     lru);
+                                __nfs3_dircache_change_del (table, change);
+                        }
+                }
+
+                change = GF_CALLOC (1, sizeof (*change),
+                                    gf_nfs_mt_nfs3_dircache);
+                if (!change) {
+                        /* nothing to go by any more, start over */
+                        list_for_each_entry_safe (dc, next, &table->lru,
+                                                  lru) {
+                                table->invalidations++;
+                                if (__nfs3_dircache_unlink (table, dc))
+                                        list_add (&dc->lru, &doomed);
+                        }
+                        goto unlock;
+                }
+
+                uuid_copy (change->gfid, gfid);
+                change->when = now;
+                list_add (&change->hash,
+                          &table->changes[gfid[15] %
+                                          GF_NFS3_DIRCACHE_BUCKETS]);
+                list_add (&change->lru, &table->change_lru);
+                table->nchanges++;
+        }
+unlock:
+        UNLOCK (&table->lock);
+
+        list_for_each_entry_safe (dc, next, &doomed, lru) {
+                list_del_init (&dc->lru);
+                nfs3_dircache_destroy (dc);
+        }
+}
+
+
+/* Whether the attributes of @entry may have changed since @dc was cached */
+static int
+__nfs3_dircache_entry_changed (nfs3_dircache_table_t *table,
+                               nfs3_dircache_t *dc, gf_dirent_t *entry)
+{
+        nfs3_dircache_change_t  *change = NULL;
+
+        if (!table->nchanges)
+                return 0;
+
+        change = __nfs3_dircache_change_find (table, entry->d_stat.ia_gfid);
+
+        return (change && (change->when >= dc->born));
+}
+
+
+static gf_dirent_t *
+nfs3_dircache_entry_dup (gf_dirent_t *entry)
+{
+        gf_dirent_t     *dup = NULL;
+
+        dup = gf_dirent_for_name (entry->d_name);
+        if (!dup)
+                return NULL;
+
+        dup->d_ino = entry->d_ino;
+        dup->d_off = entry->d_off;
+        dup->d_type = entry->d_type;
+        dup->d_stat = entry->d_stat;
+
+        return dup;
+}
+
+
+/*
+ * Copy to @entries the page after @cookie, sized the way the reply will
+ * be filled from it: by @maxcount and @dircount for READDIRPLUS, by
+ * @dircount alone for READDIR (@maxcount is 0).
+ *
+ * Returns 1 with the page copied and *@eof set, 0 when the cache does not
+ * reach far enough yet and has to be read from *@tail on, and -1 when the
+ * page cannot come from the cache at all: the cookie is not one of its
+ * entries, or the directory is too big to be cached to the end.
+ */
+int
+nfs3_dircache_fill (nfs3_dircache_table_t *table, nfs3_dircache_t *dc,
+                    uint64_t cookie, uint32_t dircount, uint32_t maxcount,
+                    gf_dirent_t *entries, int *eof, uint64_t *tail)
+{
+        gf_dirent_t     *pos = NULL;
+        gf_dirent_t     *last = NULL;
+        gf_dirent_t     *entry = NULL;
+        gf_dirent_t     *dup = NULL;
+        uint32_t        filled = 0;
+        uint32_t        dirsize = 0;
+        int             namelen = 0;
+        int             ret = -1;
+
+        LOCK (&table->lock);
+        {
+                if (cookie == 0) {
+                        pos = &dc->entries;
+                } else if (dc->hint && (dc->hint->d_off == cookie)) {
+                        pos = dc->hint;
+                } else {
+                        list_for_each_entry (entry, &dc->entries.list, list) {
+                                if (entry->d_off == cookie) {
+                                        pos = entry;
+                                        break;
+                                }
+                        }
+                }
+
+                if (!pos)
+                        goto bypass;
+
+                filled = NFS3_READDIR_RESOK_SIZE;
+                last = pos;
+                for (entry = pos->next; entry != &dc->entries;
+                     entry = entry->next) {
+                        namelen = strlen (entry->d_name);
+                        if (maxcount) {
+                                if ((filled >= maxcount) ||
+                                    (dirsize >= dircount))
+                                        break;
+                                filled += NFS3_ENTRYP3_FIXED_SIZE +
+                                          GF_NFSFH_STATIC_SIZE + namelen;
+                                dirsize += NFS3_ENTRY3_FIXED_SIZE + namelen;
+                        } else {
+                                if (filled >= dircount)
+                                        break;
+                                filled += NFS3_ENTRY3_FIXED_SIZE + namelen;
+                        }
+                        last = entry;
+                }
+
+                /* ran out of cached entries before the page was full */
+                if ((entry == &dc->entries) && !dc->eof) {
+                        if (!dc->full) {
+                                *tail = dc->tail;
+                                ret = 0;
+                                goto unlock;
+                        }
+
+                        if (last == pos)
+                                goto bypass;
+                }
+
+                /* READDIRPLUS hands out the attributes of the entries */
+                for (entry = pos->next; maxcount && (entry != last->next);
+                     entry = entry->next) {
+                        if (!__nfs3_dircache_entry_changed (table, dc, entry))
+                                continue;
+
+                        if (!dc->stale) {
+                                table->invalidations++;
+                                __nfs3_dircache_unlink (table, dc);
+                        }
+                        goto bypass;
+                }
+
+                for (entry = pos->next; entry != last->next;
+                     entry = entry->next) {
+                        dup = nfs3_dircache_entry_dup (entry);
+                        if (!dup) {
+                                gf_dirent_free (entries);
+                                goto bypass;
+                        }
+                        list_add_tail (&dup->list, &entries->list);
+                }
+
+                *eof = ((last->next == &dc->entries) && dc->eof);
+                dc->hint = last;
+                table->hits++;
+                ret = 1;
+                goto unlock;
+bypass:
+                table->bypassed++;
+                ret = -1;
+        }
+unlock:
+        UNLOCK (&table->lock);
+
+        return ret;
+}
+
+
+/*
+ * Add to the end of @dc the @entries read from the graph from the cookie
+ * @from on, taking them off @entries. Returns -1 and leaves @entries alone
+ * if another call got there first, or if they do not fit in the budget
+ * even after dropping the other directories.
+ */
+int
+nfs3_dircache_append (nfs3_dircache_table_t *table, nfs3_dircache_t *dc,
+                      uint64_t from, gf_dirent_t *entries, int eof)
+{
+        nfs3_dircache_t         *victim = NULL;
+        nfs3_dircache_t         *next = NULL;
+        gf_dirent_t             *entry = NULL;
+        gf_dirent_t             *tmp = NULL;
+        struct list_head        doomed;
+        int                     count = 0;
+        int                     ret = -1;
+
+        INIT_LIST_HEAD (&doomed);
+
+        list_for_each_entry (entry, &entries->list, list)
+                count++;
+
+        LOCK (&table->lock);
+        {
+                if (dc->eof || dc->full || (dc->tail != from))
+                        goto unlock;
+
+                while (!dc->stale &&
+                       (table->entries + count > table->max_entries) &&
+                       (table->lru.prev != &dc->lru)) {
+                        victim = list_entry (table->lru.prev, nfs3_dircache_t,
+                                             lru);
+                        if (__nfs3_dircache_unlink (table, victim))
+                                list_add (&victim->lru, &doomed);
+                }
+
+                if (!dc->stale &&
+                    (table->entries + count > table->max_entries)) {
+                        dc->full = 1;
+                        goto unlock;
+                }
+
+                list_for_each_entry_safe (entry, tmp, &entries->list, list) {
+                        /* only the dirent is needed to build replies */
+                        if (entry->dict) {
+                                dict_unref (entry->dict);
+                                entry->dict = NULL;
+                        }
+                        if (entry->inode) {
+                                inode_unref (entry->inode);
+                                entry->inode = NULL;
+                        }
+                        list_move_tail (&entry->list, &dc->entries.list);
+                        dc->tail = entry->d_off;
+                }
+
+                dc->count += count;
+                dc->eof = eof;
+                if (!dc->stale)
+                        table->entries += count;
+                table->fetches++;
+                ret = 0;
+        }
+unlock:
+        UNLOCK (&table->lock);
+
+        list_for_each_entry_safe (victim, next, &doomed, lru) {
+                list_del_init (&victim->lru);
+                nfs3_dircache_destroy (victim);
+        }
+
+        return ret;
+}
+
+
+void
+nfs3_dircache_dump (nfs3_dircache_table_t *table)
+{
+        char    key[GF_DUMP_MAX_BUF_LEN] = {0, };
+
+        gf_proc_dump_add_section ("nfs.nfsv3.readdir-cache");
+
+        if (!table) {
+                gf_proc_dump_build_key (key, "readdir-cache", "enabled");
+                gf_proc_dump_write (key, "no");
+                return;
+        }
+
+        LOCK (&table->lock);
+        {
+                gf_proc_dump_build_key (key, "readdir-cache", "timeout");
+                gf_proc_dump_write (key, "%u", table->timeout);
+                gf_proc_dump_build_key (key, "readdir-cache", "max-entries");
+                gf_proc_dump_write (key, "%"PRIu64, table->max_entries);
+                gf_proc_dump_build_key (key, "readdir-cache", "entries");
+                gf_proc_dump_write (key, "%"PRIu64, table->entries);
+                gf_proc_dump_build_key (key, "readdir-cache", "dirs");
+                gf_proc_dump_write (key, "%d", table->dirs);
+                gf_proc_dump_build_key (key, "readdir-cache", "changes");
+                gf_proc_dump_write (key, "%d", table->nchanges);
+                gf_proc_dump_build_key (key, "readdir-cache", "hits");
+                gf_proc_dump_write (key, "%"PRIu64, table->hits);
+                gf_proc_dump_build_key (key, "readdir-cache", "fetches");
+                gf_proc_dump_write (key, "%"PRIu64, table->fetches);
+                gf_proc_dump_build_key (key, "readdir-cache", "bypassed");
+                gf_proc_dump_write (key, "%"PRIu64, table->bypassed);
+                gf_proc_dump_build_key (key, "readdir-cache",
+                                        "invalidations");
+                gf_proc_dump_write (key, "%"PRIu64, table->invalidations);
+        }
+        UNLOCK (&table->lock);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+#ifndef _NFS3_DIRCACHE_H_
+#define _NFS3_DIRCACHE_H_
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "xlator.h"
+#include "locking.h"
+#include "list.h"
+
+/*
+ * The entries of a directory as a client pages through it with READDIR or
+ * READDIRPLUS. Every page is read from the graph only once, with a larger
+ * readdirp than the client asked for; the following pages are served from
+ * here. Entries are kept in the order of their d_off, starting from the
+ * beginning of the directory, so a page can start at any cookie that was
+ * handed out.
+ *
+ * A directory is dropped from the cache when its verifier, made from the
+ * mtime and ctime of the directory, changes, when an entry op through this
+ * server changes it, and after the timeout in any case.
+ *
+ * The attributes of the entries change without the directory changing.
+ * The files written to or set attributes on through this server are
+ * remembered for as long as a cache can be, and a READDIRPLUS page which
+ * has one of them that changed since its directory was cached drops the
+ * directory instead of handing out the old attributes.
+ */
+#define GF_NFS3_DIRCACHE_TIMEOUT        5               /* seconds */
+#define GF_NFS3_DIRCACHE_ENTRIES        (256 * 1024)
+#define GF_NFS3_DIRCACHE_BUCKETS        256
+#define GF_NFS3_DIRCACHE_CHANGES        4096
+
+typedef struct nfs3_dircache_change {
+        struct list_head        hash;
+        struct list_head        lru;
+        uuid_t                  gfid;
+        time_t                  when;
+} nfs3_dircache_change_t;
+
+typedef struct nfs3_dircache {
+        struct list_head        hash;   /* in its table bucket */
+        struct list_head        lru;
+        uuid_t                  gfid;
+        uint64_t                verf;
+        time_t                  born;
+        time_t                  expire;
+        int                     ref;
+        int                     stale;  /* not in the table any more */
+
+        gf_dirent_t             entries;
+        int                     count;
+        uint64_t                tail;   /* d_off of the last entry */
+        int                     eof;    /* entries up to the end are here */
+        int                     full;   /* hit the budget, stopped growing */
+
+        /* The last entry handed out, where the next page usually starts */
+        gf_dirent_t             *hint;
+} nfs3_dircache_t;
+
+typedef struct nfs3_dircache_table {
+        gf_lock_t               lock;
+        struct list_head        buckets[GF_NFS3_DIRCACHE_BUCKETS];
+        struct list_head        lru;
+        uint32_t                timeout;
+        uint64_t                max_entries;
+        uint64_t                entries;
+        int                     dirs;
+
+        /* files changed through this server, newest first */
+        struct list_head        changes[GF_NFS3_DIRCACHE_BUCKETS];
+        struct list_head        change_lru;
+        int                     nchanges;
+
+        uint64_t                hits;
+        uint64_t                fetches;
+        uint64_t                bypassed;
+        uint64_t                invalidations;
+} nfs3_dircache_table_t;
+
+extern nfs3_dircache_table_t *
+nfs3_dircache_table_new (uint32_t timeout, uint64_t max_entries);
+
+extern uint64_t
+nfs3_dircache_verf (struct iatt *buf);
+
+extern nfs3_dircache_t *
+nfs3_dircache_get (nfs3_dircache_table_t *table, uuid_t gfid, uint64_t verf);
+
+extern void
+nfs3_dircache_put (nfs3_dircache_table_t *table, nfs3_dircache_t *dc);
+
+extern void
+nfs3_dircache_invalidate (nfs3_dircache_table_t *table, uuid_t gfid);
+
+extern void
+nfs3_dircache_invalidate_loc (nfs3_dircache_table_t *table, loc_t *loc);
+
+extern void
+nfs3_dircache_changed (nfs3_dircache_table_t *table, uuid_t gfid);
+
+extern int
+nfs3_dircache_fill (nfs3_dircache_table_t *table, nfs3_dircache_t *dc,
+                    uint64_t cookie, uint32_t dircount, uint32_t maxcount,
+                    gf_dirent_t *entries, int *eof, uint64_t *tail);
+
+extern int
+nfs3_dircache_append (nfs3_dircache_table_t *table, nfs3_dircache_t *dc,
+                      uint64_t from, gf_dirent_t *entries, int eof);
+
+extern void
+nfs3_dircache_dump (nfs3_dircache_table_t *table);
+
+#endif
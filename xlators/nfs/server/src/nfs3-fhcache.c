@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <sys/time.h>
+
+#include "nfs.h"
+#include "nfs3.h"
+#include "nfs3-fhcache.h"
+#include "nfs-mem-types.h"
+#include "timer.h"
+#include "statedump.h"
+
+#define BUCKET_START(shard, n)  ((shard)->entries + \
+                                 ((n) * GF_NFS3_FHCACHE_ASSOC))
+
+static nfs3_fhcache_entry_t *
+__nfs3_fhcache_bucket (nfs3_fhcache_t *cache, uuid_t gfid,
+                       nfs3_fhcache_shard_t **shard)
+{
+        uint64_t        hash = 0;
+
+        /* the second half of a gfid is random enough */
+        memcpy (&hash, gfid + 8, sizeof (hash));
+        *shard = &cache->shards[hash % GF_NFS3_FHCACHE_SHARDS];
+        hash /= GF_NFS3_FHCACHE_SHARDS;
+
+        return BUCKET_START (*shard, hash % cache->nbuckets);
+}
+
+
+/*
+ * Slide the entries after @slot down over it, so that the last populated
+ * one is free to take the most recently used entry. Returns that slot.
+ */
+static nfs3_fhcache_entry_t *
+__nfs3_fhcache_slide (nfs3_fhcache_entry_t *bucket, nfs3_fhcache_entry_t *slot)
+{
+        nfs3_fhcache_entry_t    tmp;
+
+        tmp = *slot;
+        for (; slot < bucket + GF_NFS3_FHCACHE_ASSOC - 1; slot++) {
+                if (!slot[1].name)
+                        break;
+                slot[0] = slot[1];
+        }
+        *slot = tmp;
+
+        return slot;
+}
+
+
+void
+nfs3_fhcache_add (nfs3_fhcache_t *cache, uuid_t gfid, uuid_t pargfid,
+                  const char *name)
+{
+        nfs3_fhcache_shard_t    *shard = NULL;
+        nfs3_fhcache_entry_t    *bucket = NULL;
+        nfs3_fhcache_entry_t    *slot = NULL;
+        char                    *newname = NULL;
+        int                     i = 0;
+
+        if (!cache || !name || uuid_is_null (gfid) || uuid_is_null (pargfid))
+                return;
+
+        bucket = __nfs3_fhcache_bucket (cache, gfid, &shard);
+
+        LOCK (&shard->lock);
+        {
+                /* an entry of this gfid or the first free slot, the least
+                   recently used one if there is none */
+                slot = bucket;
+                for (i = 0; i < GF_NFS3_FHCACHE_ASSOC; i++) {
+                        if (!bucket[i].name ||
+                            !uuid_compare (bucket[i].gfid, gfid)) {
+                                slot = &bucket[i];
+                                break;
+                        }
+                }
+
+                if (slot->name && !uuid_compare (slot->pargfid, pargfid) &&
+                    !strcmp (slot->name, name)) {
+                        __nfs3_fhcache_slide (bucket, slot);
+                        goto unlock;
+                }
+
+                newname = gf_strdup (name);
+                if (!newname)
+                        goto unlock;
+
+                GF_FREE (slot->name);
+                slot->name = newname;
+                uuid_copy (slot->gfid, gfid);
+                uuid_copy (slot->pargfid, pargfid);
+                __nfs3_fhcache_slide (bucket, slot);
+                cache->dirty = 1;
+        }
+unlock:
+        UNLOCK (&shard->lock);
+}
+
+
+void
+nfs3_fhcache_add_loc (nfs3_fhcache_t *cache, loc_t *loc, uuid_t gfid)
+{
+        if (!cache || !loc || !loc->name)
+                return;
+
+        if (loc->parent)
+                nfs3_fhcache_add (cache, gfid, loc->parent->gfid, loc->name);
+        else
+                nfs3_fhcache_add (cache, gfid, loc->pargfid, loc->name);
+}
+
+
+void
+nfs3_fhcache_add_dirents (nfs3_fhcache_t *cache, uuid_t pargfid,
+                          gf_dirent_t *entries)
+{
+        gf_dirent_t     *entry = NULL;
+
+        if (!cache)
+                return;
+
+        list_for_each_entry (entry, &entries->list, list) {
+                if (!strcmp (entry->d_name, ".") ||
+                    !strcmp (entry->d_name, ".."))
+                        continue;
+
+                nfs3_fhcache_add (cache, entry->d_stat.ia_gfid, pargfid,
+                                  entry->d_name);
+        }
+}
+
+
+/*
+ * Parent gfid and name last seen for @gfid. *@name is allocated, for the
+ * caller to free. Returns -1 if @gfid is not in the cache.
+ */
+int
+nfs3_fhcache_get (nfs3_fhcache_t *cache, uuid_t gfid, uuid_t pargfid,
+                  char **name)
+{
+        nfs3_fhcache_shard_t    *shard = NULL;
+        nfs3_fhcache_entry_t    *bucket = NULL;
+        int                     i = 0;
+        int                     ret = -1;
+
+        if (!cache)
+                return -1;
+
+        bucket = __nfs3_fhcache_bucket (cache, gfid, &shard);
+
+        LOCK (&shard->lock);
+        {
+                for (i = 0; i < GF_NFS3_FHCACHE_ASSOC; i++) {
+                        if (!bucket[i].name)
+                                break;
+                        if (uuid_compare (bucket[i].gfid, gfid))
+                                continue;
+
+                        *name = gf_strdup (bucket[i].name);
+                        if (!*name)
+                                break;
+                        uuid_copy (pargfid, bucket[i].pargfid);
+                        __nfs3_fhcache_slide (bucket, &bucket[i]);
+                        ret = 0;
+                        break;
+                }
+        }
+        UNLOCK (&shard->lock);
+
+        if (ret) {
+                LOCK (&cache->statlock);
+                {
+                        cache->misses++;
+                }
+                UNLOCK (&cache->statlock);
+        }
+
+        return ret;
+}
+
+
+/* The entry of @gfid led to some other file, or nowhere */
+void
+nfs3_fhcache_stale (nfs3_fhcache_t *cache, uuid_t gfid)
+{
+        nfs3_fhcache_shard_t    *shard = NULL;
+        nfs3_fhcache_entry_t    *bucket = NULL;
+        nfs3_fhcache_entry_t    *slot = NULL;
+        int                     i = 0;
+
+        if (!cache)
+                return;
+
+        bucket = __nfs3_fhcache_bucket (cache, gfid, &shard);
+
+        LOCK (&shard->lock);
+        {
+                for (i = 0; i < GF_NFS3_FHCACHE_ASSOC; i++) {
+                        if (!bucket[i].name)
+                                break;
+                        if (uuid_compare (bucket[i].gfid, gfid))
+                                continue;
+
+                        /* move it to the end and free it there */
+                        slot = __nfs3_fhcache_slide (bucket, &bucket[i]);
+                        GF_FREE (slot->name);
+                        memset (slot, 0, sizeof (*slot));
+                        cache->dirty = 1;
+                        break;
+                }
+        }
+        UNLOCK (&shard->lock);
+
+        LOCK (&cache->statlock);
+        {
+                cache->stale++;
+        }
+        UNLOCK (&cache->statlock);
+}
+
+
+/* A hard resolution that started at @start is done, through the cache if
+ * @hit.
+ */
+void
+nfs3_fhcache_hard_done (nfs3_fhcache_t *cache, struct timeval *start, int hit)
+{
+        struct timeval  now = {0, };
+        uint64_t        usec = 0;
+
+        if (!cache)
+                return;
+
+        gettimeofday (&now, NULL);
+        usec = (now.tv_sec - start->tv_sec) * 1000000 +
+               (now.tv_usec - start->tv_usec);
+
+        LOCK (&cache->statlock);
+        {
+                cache->hard++;
+                if (hit)
+                        cache->hits++;
+                cache->hard_usec += usec;
+                if (usec > cache->hard_max_usec)
+                        cache->hard_max_usec = usec;
+        }
+        UNLOCK (&cache->statlock);
+}
+
+
+/*
+ * The snapshot has one entry a line: gfid, parent gfid and name, separated
+ * by single spaces. Names with a newline are left out.
+ */
+static void
+nfs3_fhcache_load (nfs3_fhcache_t *cache)
+{
+        FILE            *fp = NULL;
+        char            line[2 * GF_UUID_BUF_SIZE + NAME_MAX + 2] = {0, };
+        char            *gfidstr = NULL;
+        char            *pargfidstr = NULL;
+        char            *name = NULL;
+        char            *end = NULL;
+        uuid_t          gfid = {0, };
+        uuid_t          pargfid = {0, };
+        int             count = 0;
+
+        fp = fopen (cache->snapshot, "r");
+        if (!fp) {
+                if (errno != ENOENT)
+                        gf_log (GF_NFS3, GF_LOG_WARNING, "could not open fh "
+                                "cache snapshot %s: %s", cache->snapshot,
+                                strerror (errno));
+                return;
+        }
+
+        while (fgets (line, sizeof (line), fp)) {
+                end = strchr (line, '\n');
+                if (!end)
+                        continue;
+                *end = '\0';
+
+                gfidstr = line;
+                pargfidstr = strchr (gfidstr, ' ');
+                if (!pargfidstr)
+                        continue;
+                *pargfidstr++ = '\0';
+                name = strchr (pargfidstr, ' ');
+                if (!name || !name[1])
+                        continue;
+                *name++ = '\0';
+
+                if (uuid_parse (gfidstr, gfid) ||
+                    uuid_parse (pargfidstr, pargfid))
+                        continue;
+
+                nfs3_fhcache_add (cache, gfid, pargfid, name);
+                count++;
+        }
+
+        fclose (fp);
+        cache->dirty = 0;
+
+        gf_log (GF_NFS3, GF_LOG_INFO, "loaded %d fh cache entries from %s",
+                count, cache->snapshot);
+}
+
+
+int
+nfs3_fhcache_save (nfs3_fhcache_t *cache)
+{
+        nfs3_fhcache_shard_t    *shard = NULL;
+        nfs3_fhcache_entry_t    *entry = NULL;
+        FILE                    *fp = NULL;
+        char                    tmpfile[PATH_MAX] = {0, };
+        char                    gfidstr[GF_UUID_BUF_SIZE] = {0, };
+        char                    pargfidstr[GF_UUID_BUF_SIZE] = {0, };
+        unsigned int            i = 0;
+        unsigned int            s = 0;
+        int                     fd = -1;
+        int                     ret = -1;
+
+        if (!cache || !cache->snapshot)
+                return 0;
+
+        /* the names in it are not for everyone to read, whatever the
+           umask */
+        snprintf (tmpfile, sizeof (tmpfile), "%s.tmp", cache->snapshot);
+        unlink (tmpfile);
+        fd = open (tmpfile, O_WRONLY | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+                goto out;
+
+        fp = fdopen (fd, "w");
+        if (!fp) {
+                close (fd);
+                goto out;
+        }
+
+        /* cleared first, a change while saving is saved the next time */
+        cache->dirty = 0;
+
+        for (s = 0; s < GF_NFS3_FHCACHE_SHARDS; s++) {
+                shard = &cache->shards[s];
+                LOCK (&shard->lock);
+                {
+                        for (i = 0; i < cache->nbuckets *
+                                    GF_NFS3_FHCACHE_ASSOC; i++) {
+                                entry = &shard->entries[i];
+                                if (!entry->name || strchr (entry->name, '\n'))
+                                        continue;
+                                uuid_unparse (entry->gfid, gfidstr);
+                                uuid_unparse (entry->pargfid, pargfidstr);
+                                fprintf (fp, "%s %s %s\n", gfidstr, pargfidstr,
+                                         entry->name);
+                        }
+                }
+                UNLOCK (&shard->lock);
+        }
+
+        if (fclose (fp))
+                goto out;
+
+        ret = rename (tmpfile, cache->snapshot);
+out:
+        if (ret) {
+                gf_log (GF_NFS3, GF_LOG_WARNING, "could not save fh cache to "
+                        "%s: %s", cache->snapshot, strerror (errno));
+                unlink (tmpfile);
+                cache->dirty = 1;
+        }
+
+        return ret;
+}
+
+
+static void
+nfs3_fhcache_save_timer (void *data)
+{
+        nfs3_fhcache_t  *cache = data;
+        struct timeval  delta = {GF_NFS3_FHCACHE_SAVE_SECS, 0};
+
+        THIS = cache->nfsx;
+
+        /* held while saving, so that nfs3_fhcache_stop () waits for it */
+        LOCK (&cache->savelock);
+        {
+                if (cache->save_timer) {
+                        gf_timer_call_cancel (cache->nfsx->ctx,
+                                              cache->save_timer);
+                        cache->save_timer = NULL;
+                }
+
+                if (cache->stopped)
+                        goto unlock;
+
+                if (cache->dirty)
+                        nfs3_fhcache_save (cache);
+
+                cache->save_timer =
+                        gf_timer_call_after (cache->nfsx->ctx, delta,
+                                             nfs3_fhcache_save_timer, cache);
+                if (!cache->save_timer)
+                        gf_log (GF_NFS3, GF_LOG_WARNING, "could not schedule "
+                                "saving the fh cache, not saving it any more");
+        }
+unlock:
+        UNLOCK (&cache->savelock);
+}
+
+
+/* Stop saving the cache periodically. Called before the cache goes away,
+   a final save is up to the caller. */
+void
+nfs3_fhcache_stop (nfs3_fhcache_t *cache)
+{
+        if (!cache)
+                return;
+
+        LOCK (&cache->savelock);
+        {
+                cache->stopped = 1;
+                if (cache->save_timer) {
+                        gf_timer_call_cancel (cache->nfsx->ctx,
+                                              cache->save_timer);
+                        cache->save_timer = NULL;
+                }
+        }
+        UNLOCK (&cache->savelock);
+}
+
+
+nfs3_fhcache_t *
+nfs3_fhcache_new (xlator_t *nfsx, unsigned int size, char *snapshot)
+{
+        nfs3_fhcache_t  *cache = NULL;
+        struct timeval  delta = {GF_NFS3_FHCACHE_SAVE_SECS, 0};
+        int             s = 0;
+
+        cache = GF_CALLOC (1, sizeof (*cache), gf_nfs_mt_nfs3_fhcache);
+        if (!cache)
+                return NULL;
+
+        cache->nfsx = nfsx;
+        cache->nbuckets = size / (GF_NFS3_FHCACHE_SHARDS *
+                                  GF_NFS3_FHCACHE_ASSOC);
+        if (!cache->nbuckets)
+                cache->nbuckets = 1;
+        LOCK_INIT (&cache->statlock);
+        LOCK_INIT (&cache->savelock);
+
+        for (s = 0; s < GF_NFS3_FHCACHE_SHARDS; s++) {
+                LOCK_INIT (&cache->shards[s].lock);
+                cache->shards[s].entries =
+                        GF_CALLOC (cache->nbuckets * GF_NFS3_FHCACHE_ASSOC,
+                                   sizeof (nfs3_fhcache_entry_t),
+                                   gf_nfs_mt_nfs3_fhcache);
+                if (!cache->shards[s].entries)
+                        goto err;
+        }
+
+        if (snapshot) {
+                cache->snapshot = gf_strdup (snapshot);
+                if (!cache->snapshot)
+                        goto err;
+
+                nfs3_fhcache_load (cache);
+                cache->save_timer =
+                        gf_timer_call_after (nfsx->ctx, delta,
+                                             nfs3_fhcache_save_timer, cache);
+                if (!cache->save_timer)
+                        gf_log (GF_NFS3, GF_LOG_WARNING, "could not schedule "
+                                "saving the fh cache");
+        }
+
+        return cache;
+err:
+        nfs3_fhcache_destroy (cache);
+        return NULL;
+}
+
+
+void
+nfs3_fhcache_destroy (nfs3_fhcache_t *cache)
+{
+        unsigned int    i = 0;
+        int             s = 0;
+
+        if (!cache)
+                return;
+
+        nfs3_fhcache_stop (cache);
+
+        for (s = 0; s < GF_NFS3_FHCACHE_SHARDS; s++) {
+                if (!cache->shards[s].entries)
+                        continue;
+                for (i = 0; i < cache->nbuckets * GF_NFS3_FHCACHE_ASSOC; i++)
+                        GF_FREE (cache->shards[s].entries[i].name);
+                GF_FREE (cache->shards[s].entries);
+                LOCK_DESTROY (&cache->shards[s].lock);
+        }
+
+        LOCK_DESTROY (&cache->statlock);
+        LOCK_DESTROY (&cache->savelock);
+        GF_FREE (cache->snapshot);
+        GF_FREE (cache);
+}
+
+
+void
+nfs3_fhcache_dump (nfs3_fhcache_t *cache)
+{
+        char    key[GF_DUMP_MAX_BUF_LEN] = {0, };
+
+        gf_proc_dump_add_section ("nfs.nfsv3.fh-cache");
+
+        if (!cache) {
+                gf_proc_dump_build_key (key, "fh-cache", "enabled");
+                gf_proc_dump_write (key, "no");
+                return;
+        }
+
+        gf_proc_dump_build_key (key, "fh-cache", "size");
+        gf_proc_dump_write (key, "%u", cache->nbuckets *
+                            GF_NFS3_FHCACHE_SHARDS * GF_NFS3_FHCACHE_ASSOC);
+
+        LOCK (&cache->statlock);
+        {
+                gf_proc_dump_build_key (key, "fh-cache", "hard-resolves");
+                gf_proc_dump_write (key, "%"PRIu64, cache->hard);
+                gf_proc_dump_build_key (key, "fh-cache", "hits");
+                gf_proc_dump_write (key, "%"PRIu64, cache->hits);
+                gf_proc_dump_build_key (key, "fh-cache", "misses");
+                gf_proc_dump_write (key, "%"PRIu64, cache->misses);
+                gf_proc_dump_build_key (key, "fh-cache", "stale");
+                gf_proc_dump_write (key, "%"PRIu64, cache->stale);
+                gf_proc_dump_build_key (key, "fh-cache", "hard-resolve-avg-usec");
+                gf_proc_dump_write (key, "%"PRIu64, cache->hard ?
+                                    cache->hard_usec / cache->hard : 0);
+                gf_proc_dump_build_key (key, "fh-cache", "hard-resolve-max-usec");
+                gf_proc_dump_write (key, "%"PRIu64, cache->hard_max_usec);
+        }
+        UNLOCK (&cache->statlock);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2013 Red Hat, Inc. <http://www.redhat.com>
+ * This file is part of GlusterFS.
+ *
+ * This file is licensed to you under your choice of the GNU Lesser
+ * General Public License, version 3 or any later version (LGPLv3 or
+ * later), or the GNU General Public License, version 2 (GPLv2), in all
+ * cases as published by the Free Software Foundation.
+ */
+
+#ifndef _NFS3_FHCACHE_H_
+#define _NFS3_FHCACHE_H_
+
+#ifndef _CONFIG_H
+#define _CONFIG_H
+#include "config.h"
+#endif
+
+#include "xlator.h"
+#include "locking.h"
+#include "timer.h"
+
+/*
+ * Where the gfid of a file handle was last seen in the namespace: the gfid
+ * of its parent and its name. An fh whose inode is not in the inode table
+ * any more can then be resolved with a lookup of that entry, which DHT
+ * sends to the hashed subvolume, instead of a nameless lookup that has to
+ * go everywhere. Entries are only hints, the lookup is checked to return
+ * the gfid of the fh.
+ *
+ * Set-associative like the aux gid cache, split into shards with a lock
+ * each, and sized on its own instead of with the inode table LRU.
+ */
+#define GF_NFS3_FHCACHE_SIZE            65536
+#define GF_NFS3_FHCACHE_SHARDS          16
+#define GF_NFS3_FHCACHE_ASSOC           4
+#define GF_NFS3_FHCACHE_SAVE_SECS       60
+
+typedef struct nfs3_fhcache_entry {
+        uuid_t                  gfid;
+        uuid_t                  pargfid;
+        char                    *name;  /* NULL if the slot is free */
+} nfs3_fhcache_entry_t;
+
+typedef struct nfs3_fhcache_shard {
+        gf_lock_t               lock;
+        nfs3_fhcache_entry_t    *entries;
+} nfs3_fhcache_shard_t;
+
+typedef struct nfs3_fhcache {
+        xlator_t                *nfsx;
+        unsigned int            nbuckets;       /* per shard */
+        nfs3_fhcache_shard_t    shards[GF_NFS3_FHCACHE_SHARDS];
+
+        /* Entries are loaded from here at start-up and written back to it
+         * every GF_NFS3_FHCACHE_SAVE_SECS when they changed.
+         */
+        char                    *snapshot;
+        int                     dirty;
+        gf_lock_t               savelock;       /* timer, stopped, saves */
+        gf_timer_t              *save_timer;
+        int                     stopped;
+
+        gf_lock_t               statlock;
+        uint64_t                hard;           /* fhs not in the itable */
+        uint64_t                hits;
+        uint64_t                misses;
+        uint64_t                stale;
+        uint64_t                hard_usec;
+        uint64_t                hard_max_usec;
+} nfs3_fhcache_t;
+
+extern nfs3_fhcache_t *
+nfs3_fhcache_new (xlator_t *nfsx, unsigned int size, char *snapshot);
+
+extern void
+nfs3_fhcache_stop (nfs3_fhcache_t *cache);
+
+extern void
+nfs3_fhcache_destroy (nfs3_fhcache_t *cache);
+
+extern void
+nfs3_fhcache_add (nfs3_fhcache_t *cache, uuid_t gfid, uuid_t pargfid,
+                  const char *name);
+
+extern void
+nfs3_fhcache_add_loc (nfs3_fhcache_t *cache, loc_t *loc, uuid_t gfid);
+
+extern void
+nfs3_fhcache_add_dirents (nfs3_fhcache_t *cache, uuid_t pargfid,
+                          gf_dirent_t *entries);
+
+extern int
+nfs3_fhcache_get (nfs3_fhcache_t *cache, uuid_t gfid, uuid_t pargfid,
+                  char **name);
+
+extern void
+nfs3_fhcache_stale (nfs3_fhcache_t *cache, uuid_t gfid);
+
+extern int
+nfs3_fhcache_save (nfs3_fhcache_t *cache);
+
+extern void
+nfs3_fhcache_hard_done (nfs3_fhcache_t *cache, struct timeval *start, int hit);
+
+extern void
+nfs3_fhcache_dump (nfs3_fhcache_t *cache);
+
+#endif
@@ -33,6 +33,7 @@
 #include "nfs-inodes.h"
 #include "nfs-generics.h"
 #include "nfs3-helpers.h"
+#include "nfs3-fhcache.h"
 #include "nfs-mem-types.h"
 #include "iatt.h"
 #include "common-utils.h"
@@ -1578,7 +1579,9 @@ nfs3_verify_dircookie (struct nfs3_state *nfs3, fd_t *dirfd, cookie3 cookie,
                 goto err;
         }
 
-        /* Yes, its true, our cookie is simply the fd_t address.
+        /* The cookieverf is made from the mtime and ctime of the directory,
+         * see nfs3_dircache_verf (). A stale one only keeps the readdir
+         * from being served from the cache.
          * NOTE: We used have the check for cookieverf but VMWare client sends
          * a readdirp requests even after we've told it that EOF has been
          * reached on the directory. This causes a problem because we close a
@@ -3571,6 +3574,8 @@ nfs3_fh_resolve_entry_lookup_cbk (call_frame_t *frame, void *cookie,
 
 	memcpy (&cs->stbuf, buf, sizeof (*buf));
 	memcpy (&cs->postparent, postparent, sizeof (*postparent));
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
         linked_inode = inode_link (inode, cs->resolvedloc.parent,
                                    cs->resolvedloc.name, buf);
         if (linked_inode) {
@@ -3597,6 +3602,8 @@ nfs3_fh_resolve_inode_lookup_cbk (call_frame_t *frame, void *cookie,
         cs = frame->local;
         cs->resolve_ret = op_ret;
         cs->resolve_errno = op_errno;
+        nfs3_fhcache_hard_done (cs->nfs3state->fhcache,
+                                &cs->hardresolve_start, 0);
 
         if (op_ret == -1) {
                 gf_log (GF_NFS3, (op_errno == ENOENT ? GF_LOG_TRACE : GF_LOG_ERROR),
@@ -3631,21 +3638,15 @@ err:
 
 
 
-/* Needs no extra argument since it knows that the fh to be resolved is in
- * resolvefh and that it needs to start looking from the root.
+/* Resolves the fh in resolvefh with a nameless lookup of its gfid, which
+ * has to be sent to every subvolume.
  */
-int
-nfs3_fh_resolve_inode_hard (nfs3_call_state_t *cs)
+static int
+nfs3_fh_resolve_inode_nameless (nfs3_call_state_t *cs)
 {
         int             ret = -EFAULT;
         nfs_user_t      nfu = {0, };
 
-        if (!cs)
-                return ret;
-
-        gf_log (GF_NFS3, GF_LOG_TRACE, "FH hard resolution for: gfid 0x%s",
-                uuid_utoa (cs->resolvefh.gfid));
-	cs->hardresolved = 1;
         nfs_loc_wipe (&cs->resolvedloc);
         ret = nfs_gfid_loc_fill (cs->vol->itable, cs->resolvefh.gfid,
                                  &cs->resolvedloc, NFS_RESOLVE_CREATE);
@@ -3664,6 +3665,175 @@ out:
 }
 
 
+/* Falls back to the nameless lookup from a callback of the fh cache path */
+static void
+nfs3_fh_resolve_cached_fallback (nfs3_call_state_t *cs)
+{
+        int     ret = -EFAULT;
+
+        ret = nfs3_fh_resolve_inode_nameless (cs);
+        if (ret < 0) {
+                cs->resolve_ret = -1;
+                cs->resolve_errno = -ret;
+                nfs3_call_resume (cs);
+        }
+}
+
+
+static int
+nfs3_fh_resolve_inode_cached (nfs3_call_state_t *cs, int parent_lookup);
+
+
+int32_t
+nfs3_fh_resolve_cached_lookup_cbk (call_frame_t *frame, void *cookie,
+                                   xlator_t *this, int32_t op_ret,
+                                   int32_t op_errno, inode_t *inode,
+                                   struct iatt *buf, dict_t *xattr,
+                                   struct iatt *postparent)
+{
+        nfs3_call_state_t       *cs = NULL;
+        inode_t                 *linked_inode = NULL;
+
+        cs = frame->local;
+
+        /* the entry may have been renamed, removed or replaced since */
+        if ((op_ret == -1) || uuid_compare (buf->ia_gfid, cs->resolvefh.gfid)) {
+                gf_log (GF_NFS3, GF_LOG_TRACE, "Cached entry %s of %s is "
+                        "stale", cs->resolvedloc.path,
+                        uuid_utoa (cs->resolvefh.gfid));
+                nfs3_fhcache_stale (cs->nfs3state->fhcache, cs->resolvefh.gfid);
+                nfs3_fh_resolve_cached_fallback (cs);
+                goto out;
+        }
+
+        cs->resolve_ret = 0;
+        cs->resolve_errno = 0;
+        nfs3_fhcache_hard_done (cs->nfs3state->fhcache,
+                                &cs->hardresolve_start, 1);
+
+	memcpy (&cs->stbuf, buf, sizeof (*buf));
+	memcpy (&cs->postparent, postparent, sizeof (*postparent));
+        linked_inode = inode_link (inode, cs->resolvedloc.parent,
+                                   cs->resolvedloc.name, buf);
+        if (linked_inode) {
+                inode_lookup (linked_inode);
+                inode_unref (cs->resolvedloc.inode);
+                cs->resolvedloc.inode = linked_inode;
+        }
+
+        if (cs->resolventry)
+                nfs3_fh_resolve_entry_hard (cs);
+        else
+                nfs3_call_resume (cs);
+out:
+        return 0;
+}
+
+
+int32_t
+nfs3_fh_resolve_cached_parent_cbk (call_frame_t *frame, void *cookie,
+                                   xlator_t *this, int32_t op_ret,
+                                   int32_t op_errno, inode_t *inode,
+                                   struct iatt *buf, dict_t *xattr,
+                                   struct iatt *postparent)
+{
+        nfs3_call_state_t       *cs = NULL;
+        inode_t                 *linked_inode = NULL;
+
+        cs = frame->local;
+        if (op_ret == -1) {
+                nfs3_fhcache_stale (cs->nfs3state->fhcache, cs->resolvefh.gfid);
+                nfs3_fh_resolve_cached_fallback (cs);
+                goto out;
+        }
+
+        linked_inode = inode_link (inode, NULL, NULL, buf);
+        if (linked_inode) {
+                inode_lookup (linked_inode);
+                inode_unref (linked_inode);
+        }
+
+        nfs_loc_wipe (&cs->resolvedloc);
+        if (nfs3_fh_resolve_inode_cached (cs, 0) < 0)
+                nfs3_fh_resolve_cached_fallback (cs);
+out:
+        return 0;
+}
+
+
+/*
+ * Resolves the fh in resolvefh with a lookup of the entry the fh cache last
+ * saw it at, which DHT sends to the hashed subvolume only. The parent comes
+ * first if it is not in the inode table either, and if @parent_lookup.
+ * Returns -1 if the cache cannot help.
+ */
+static int
+nfs3_fh_resolve_inode_cached (nfs3_call_state_t *cs, int parent_lookup)
+{
+        nfs3_fhcache_t  *cache = cs->nfs3state->fhcache;
+        uuid_t          pargfid = {0, };
+        char            *name = NULL;
+        nfs_user_t      nfu = {0, };
+        int             ret = -1;
+
+        if (nfs3_fhcache_get (cache, cs->resolvefh.gfid, pargfid, &name))
+                return -1;
+
+        nfs_user_root_create (&nfu);
+        ret = nfs_entry_loc_fill (cs->vol->itable, pargfid, name,
+                                  &cs->resolvedloc, NFS_RESOLVE_CREATE);
+        if (ret == -2) {
+                gf_log (GF_NFS3, GF_LOG_TRACE, "FH resolution through cached "
+                        "entry: %s", cs->resolvedloc.path);
+                ret = nfs_lookup (cs->nfsx, cs->vol, &nfu, &cs->resolvedloc,
+                                  nfs3_fh_resolve_cached_lookup_cbk, cs);
+        } else if ((ret == -1) && parent_lookup) {
+                nfs_loc_wipe (&cs->resolvedloc);
+                ret = nfs_gfid_loc_fill (cs->vol->itable, pargfid,
+                                         &cs->resolvedloc, NFS_RESOLVE_CREATE);
+                if (ret == 0)
+                        ret = nfs_lookup (cs->nfsx, cs->vol, &nfu,
+                                          &cs->resolvedloc,
+                                          nfs3_fh_resolve_cached_parent_cbk,
+                                          cs);
+        } else if (ret == 0) {
+                /* the name is linked to some other inode, because ours
+                   would have been found by its gfid */
+                nfs3_fhcache_stale (cache, cs->resolvefh.gfid);
+                ret = -1;
+        } else
+                ret = -1;
+
+        if (ret < 0)
+                nfs_loc_wipe (&cs->resolvedloc);
+        GF_FREE (name);
+
+        return (ret < 0) ? -1 : 0;
+}
+
+
+/* Needs no extra argument since it knows that the fh to be resolved is in
+ * resolvefh and that it needs to start looking from the root.
+ */
+int
+nfs3_fh_resolve_inode_hard (nfs3_call_state_t *cs)
+{
+        if (!cs)
+                return -EFAULT;
+
+        gf_log (GF_NFS3, GF_LOG_TRACE, "FH hard resolution for: gfid 0x%s",
+                uuid_utoa (cs->resolvefh.gfid));
+        gettimeofday (&cs->hardresolve_start, NULL);
+	cs->hardresolved = 1;
+        nfs_loc_wipe (&cs->resolvedloc);
+
+        if (nfs3_fh_resolve_inode_cached (cs, 1) == 0)
+                return 0;
+
+        return nfs3_fh_resolve_inode_nameless (cs);
+}
+
+
 int
 nfs3_fh_resolve_entry_hard (nfs3_call_state_t *cs)
 {
@@ -37,6 +37,8 @@
 #include "nfs-inodes.h"
 #include "nfs-generics.h"
 #include "nfs3-helpers.h"
+#include "nfs3-fhcache.h"
+#include "nfs3-dircache.h"
 #include "nfs-mem-types.h"
 #include "nfs.h"
 #include "xdr-rpc.h"
@@ -428,6 +430,7 @@ nfs3_call_state_init (struct nfs3_state *s, rpcsvc_request_t *req, xlator_t *v)
         memset (cs, 0, sizeof (*cs));
         INIT_LIST_HEAD (&cs->entries.list);
         INIT_LIST_HEAD (&cs->openwait_q);
+        INIT_LIST_HEAD (&cs->gatherwait_q);
         cs->operrno = EINVAL;
         cs->req = req;
         cs->vol = v;
@@ -456,6 +459,9 @@ nfs3_call_state_wipe (nfs3_call_state_t *cs)
         if (!list_empty (&cs->entries.list))
                 gf_dirent_free (&cs->entries);
 
+        if (cs->dircache)
+                nfs3_dircache_put (cs->nfs3state->dircache, cs->dircache);
+
         nfs_loc_wipe (&cs->oploc);
         nfs_loc_wipe (&cs->resolvedloc);
         if (cs->iob)
@@ -470,6 +476,28 @@ nfs3_call_state_wipe (nfs3_call_state_t *cs)
 }
 
 
+uint64_t
+nfs3_write_verf (struct nfs3_state *nfs3)
+{
+        uint64_t        verf = 0;
+
+        LOCK (&nfs3->gatherlock);
+        {
+                verf = nfs3->write_verf;
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        return verf;
+}
+
+
+static int
+nfs3_write_gather_wait (nfs3_call_state_t *cs, nfs3_resume_fn_t resume);
+
+int
+nfs3_write_fd_resume (void *carg);
+
+
 #define nfs3_handle_call_state_init(nfs3state, calls, rq, vl ,opstat, errlabel)\
         do {                                                            \
                 calls = nfs3_call_state_init ((nfs3state), (rq), (vl)); \
@@ -762,6 +790,10 @@ nfs3_getattr_resume (void *carg)
 
         cs = (nfs3_call_state_t *)carg;
         nfs3_check_fh_resolve_status (cs, stat, nfs3err);
+        /* Attributes have to include the UNSTABLE writes acknowledged so far */
+        if (nfs3_write_gather_wait (cs, nfs3_getattr_resume))
+                return 0;
+
         nfs_request_user_init (&nfu, cs->req);
         /* If inode which is to be getattr'd is the root, we need to do a
          * lookup instead because after a server reboot, it is not necessary
@@ -930,6 +962,7 @@ nfs3svc_truncate_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         else
                 prestat = prebuf;
 
+        nfs3_dircache_changed (cs->nfs3state->dircache, postbuf->ia_gfid);
         stat = NFS3_OK;
 nfs3err:
         nfs3_log_common_res (rpcsvc_request_xid (cs->req), NFS3_SETATTR, stat,
@@ -966,6 +999,7 @@ nfs3svc_setattr_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
          * in which case the preop to be returned will be this one.
          */
         cs->preparent = *preop;
+        nfs3_dircache_changed (cs->nfs3state->dircache, postop->ia_gfid);
 
         /* Only truncate if the size is not already same as the requested
          * truncation and also only if this is not a directory.
@@ -1055,6 +1089,9 @@ nfs3_setattr_resume (void *carg)
 
         cs = (nfs3_call_state_t *)carg;
         nfs3_check_fh_resolve_status (cs, stat, nfs3err);
+        if (nfs3_write_gather_wait (cs, nfs3_setattr_resume))
+                return 0;
+
         nfs_request_user_init (&nfu, cs->req);
         ret = nfs_setattr (cs->nfsx, cs->vol, &nfu, &cs->resolvedloc,
                            &cs->stbuf, cs->setattr_valid,
@@ -1231,6 +1268,8 @@ nfs3svc_lookup_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         nfs3_fh_build_child_fh (&cs->parent, buf, &newfh);
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
         oldinode = inode_link (inode, cs->resolvedloc.parent,
                                cs->resolvedloc.name, buf);
 xmit_res:
@@ -1884,6 +1923,9 @@ nfs3_read_resume (void *carg)
 
         cs = (nfs3_call_state_t *)carg;
         nfs3_check_fh_resolve_status (cs, stat, nfs3err);
+        if (nfs3_write_gather_wait (cs, nfs3_read_resume))
+                return 0;
+
         fd = fd_anonymous (cs->resolvedloc.inode);
         if (!fd) {
                 gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to create anonymous fd");
@@ -2000,9 +2042,11 @@ nfs3svc_write_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         struct nfs3_state       *nfs3 = NULL;
         nfsstat3                stat = NFS3ERR_SERVERFAULT;
         nfs3_call_state_t       *cs = NULL;
+        uint64_t                verf = 0;
 
         cs = frame->local;
         nfs3 = rpcsvc_request_program_private (cs->req);
+        verf = nfs3_write_verf (nfs3);
 
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
@@ -2013,9 +2057,9 @@ nfs3svc_write_fsync_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 stat = NFS3_OK;
 
         nfs3_log_write_res (rpcsvc_request_xid (cs->req), stat, op_errno,
-                            cs->maxcount, cs->writetype, nfs3->serverstart);
+                            cs->maxcount, cs->writetype, verf);
         nfs3_write_reply (cs->req, stat, cs->maxcount, cs->writetype,
-                          nfs3->serverstart, &cs->stbuf, postbuf);
+                          verf, &cs->stbuf, postbuf);
         nfs3_call_state_wipe (cs);
         return 0;
 }
@@ -2100,6 +2144,7 @@ nfs3svc_write_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         struct nfs3_state       *nfs3 = NULL;
         int                     write_trusted = 0;
         int                     sync_trusted = 0;
+        uint64_t                verf = 0;
 
         cs = frame->local;
         nfs3 = rpcsvc_request_program_private (cs->req);
@@ -2113,6 +2158,7 @@ nfs3svc_write_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
         stat = NFS3_OK;
         cs->maxcount = op_ret;
+        nfs3_dircache_changed (cs->nfs3state->dircache, postbuf->ia_gfid);
 
         write_trusted = nfs3_export_write_trusted (cs->nfs3state,
                                                    cs->resolvefh.exportid);
@@ -2135,12 +2181,12 @@ nfs3svc_write_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 
 err:
         if (ret < 0) {
+                verf = nfs3_write_verf (nfs3);
                 nfs3_log_write_res (rpcsvc_request_xid (cs->req), stat,
                                     op_errno, cs->maxcount, cs->writetype,
-                                    nfs3->serverstart);
+                                    verf);
                 nfs3_write_reply (cs->req, stat, cs->maxcount,
-                                  cs->writetype, nfs3->serverstart, prebuf,
-                                  postbuf);
+                                  cs->writetype, verf, prebuf, postbuf);
                 nfs3_call_state_wipe (cs);
         }
 
@@ -2178,6 +2224,538 @@ __nfs3_write_resume (nfs3_call_state_t *cs)
 }
 
 
+static struct list_head *
+__nfs3_write_gather_bucket (struct nfs3_state *nfs3, inode_t *inode)
+{
+        return &nfs3->gathers[inode->gfid[15] % GF_NFS3_GATHER_BUCKETS];
+}
+
+
+static struct nfs3_write_gather *
+__nfs3_write_gather_get (struct nfs3_state *nfs3, inode_t *inode)
+{
+        struct list_head                *bucket = NULL;
+        struct nfs3_write_gather        *g = NULL;
+
+        if (!nfs3->gather_count)
+                return NULL;
+
+        bucket = __nfs3_write_gather_bucket (nfs3, inode);
+        list_for_each_entry (g, bucket, list) {
+                if (g->inode == inode)
+                        return g;
+        }
+
+        return NULL;
+}
+
+
+static int
+__nfs3_write_gather_add (struct nfs3_write_gather *g, nfs3_call_state_t *cs)
+{
+        struct nfs3_state       *nfs3 = g->nfs3state;
+
+        /* keeps the request buffers around till the data is written */
+        if (iobref_merge (g->iobref, cs->iobref))
+                return -1;
+
+        g->vector[g->count].iov_base = cs->datavec.iov_base;
+        g->vector[g->count].iov_len = cs->datacount;
+        g->count++;
+        g->size += cs->datacount;
+        nfs3->gather_bytes += cs->datacount;
+
+        return 0;
+}
+
+
+static struct nfs3_write_gather *
+__nfs3_write_gather_new (struct nfs3_state *nfs3, nfs3_call_state_t *cs,
+                         nfs_user_t *nfu)
+{
+        struct nfs3_write_gather        *g = NULL;
+
+        g = GF_CALLOC (1, sizeof (*g), gf_nfs_mt_nfs3_write_gather);
+        if (!g)
+                goto err;
+
+        g->vector = GF_CALLOC (GF_NFS3_GATHER_MAXVEC, sizeof (struct iovec),
+                               gf_nfs_mt_nfs3_write_gather);
+        if (!g->vector)
+                goto err;
+
+        g->iobref = iobref_new ();
+        if (!g->iobref)
+                goto err;
+
+        INIT_LIST_HEAD (&g->flush_list);
+        INIT_LIST_HEAD (&g->waiters);
+        g->nfs3state = nfs3;
+        g->inode = inode_ref (cs->resolvedloc.inode);
+        g->fd = fd_ref (cs->fd);
+        g->vol = cs->vol;
+        g->nfu = *nfu;
+        g->offset = cs->dataoffset;
+        g->start = time (NULL);
+        if (__nfs3_write_gather_add (g, cs))
+                goto err;
+
+        list_add_tail (&g->list, __nfs3_write_gather_bucket (nfs3, g->inode));
+        nfs3->gather_count++;
+
+        return g;
+err:
+        if (g) {
+                if (g->iobref)
+                        iobref_unref (g->iobref);
+                if (g->fd)
+                        fd_unref (g->fd);
+                if (g->inode)
+                        inode_unref (g->inode);
+                GF_FREE (g->vector);
+                GF_FREE (g);
+        }
+        return NULL;
+}
+
+
+static void
+nfs3_write_gather_destroy (struct nfs3_write_gather *g)
+{
+        iobref_unref (g->iobref);
+        fd_unref (g->fd);
+        inode_unref (g->inode);
+        GF_FREE (g->vector);
+        GF_FREE (g);
+}
+
+
+/* Whether the write in @cs continues @g and can be sent along with it */
+static int
+__nfs3_write_gather_fits (struct nfs3_write_gather *g, nfs3_call_state_t *cs,
+                          nfs_user_t *nfu)
+{
+        struct nfs3_state       *nfs3 = g->nfs3state;
+
+        if (g->flushing || (g->vol != cs->vol))
+                return 0;
+
+        if (cs->dataoffset != (g->offset + g->size))
+                return 0;
+
+        if ((g->size + cs->datacount > nfs3->gather_size) ||
+            (g->count == GF_NFS3_GATHER_MAXVEC))
+                return 0;
+
+        /* the whole gather is written with the credentials of its first
+           write */
+        if ((g->nfu.uid != nfu->uid) ||
+            (g->nfu.gids[NFS_PRIMGID_IDX] != nfu->gids[NFS_PRIMGID_IDX]))
+                return 0;
+
+        return 1;
+}
+
+
+/* Mark @g to be written out by the caller once it drops gatherlock. No
+ * more writes are added to it from here on.
+ */
+static void
+__nfs3_write_gather_close (struct nfs3_write_gather *g, struct list_head *flush)
+{
+        if (g->flushing)
+                return;
+
+        g->flushing = 1;
+        list_add_tail (&g->flush_list, flush);
+}
+
+
+static struct list_head *
+__nfs3_write_gather_error_bucket (struct nfs3_state *nfs3, inode_t *inode)
+{
+        return &nfs3->gather_errors[inode->gfid[15] % GF_NFS3_GATHER_BUCKETS];
+}
+
+
+static struct nfs3_write_gather_error *
+__nfs3_write_gather_error_get (struct nfs3_state *nfs3, inode_t *inode)
+{
+        struct nfs3_write_gather_error  *e = NULL;
+
+        list_for_each_entry (e, __nfs3_write_gather_error_bucket (nfs3, inode),
+                             list) {
+                if (e->inode == inode)
+                        return e;
+        }
+
+        return NULL;
+}
+
+
+static void
+__nfs3_write_gather_error_set (struct nfs3_state *nfs3, inode_t *inode,
+                               int32_t op_errno)
+{
+        struct nfs3_write_gather_error  *e = NULL;
+
+        e = __nfs3_write_gather_error_get (nfs3, inode);
+        if (!e) {
+                e = GF_CALLOC (1, sizeof (*e),
+                               gf_nfs_mt_nfs3_write_gather_error);
+                if (!e) {
+                        /* the client resends everything not committed */
+                        nfs3->write_verf++;
+                        return;
+                }
+                e->inode = inode_ref (inode);
+                list_add_tail (&e->list,
+                               __nfs3_write_gather_error_bucket (nfs3, inode));
+        }
+
+        e->op_errno = op_errno;
+}
+
+
+/*
+ * The error of a failed gathered write on the inode of @cs, if it has not
+ * been reported yet; it is reported only once. @failed is set if the inode
+ * has had one since its last successful COMMIT.
+ */
+static int32_t
+nfs3_write_gather_error (nfs3_call_state_t *cs, int *failed)
+{
+        struct nfs3_state               *nfs3 = cs->nfs3state;
+        struct nfs3_write_gather_error  *e = NULL;
+        int32_t                         op_errno = 0;
+
+        LOCK (&nfs3->gatherlock);
+        {
+                e = __nfs3_write_gather_error_get (nfs3,
+                                                   cs->resolvedloc.inode);
+                if (e) {
+                        op_errno = e->op_errno;
+                        e->op_errno = 0;
+                }
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        if (failed)
+                *failed = (e != NULL);
+
+        return op_errno;
+}
+
+
+/* A COMMIT succeeded, writes to the inode of @cs are gathered again */
+static void
+nfs3_write_gather_error_clear (nfs3_call_state_t *cs)
+{
+        struct nfs3_state               *nfs3 = cs->nfs3state;
+        struct nfs3_write_gather_error  *e = NULL;
+
+        LOCK (&nfs3->gatherlock);
+        {
+                e = __nfs3_write_gather_error_get (nfs3,
+                                                   cs->resolvedloc.inode);
+                /* unless another gathered write failed meanwhile */
+                if (e && !e->op_errno)
+                        list_del_init (&e->list);
+                else
+                        e = NULL;
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        if (e) {
+                inode_unref (e->inode);
+                GF_FREE (e);
+        }
+}
+
+
+static void
+nfs3_write_gather_done (struct nfs3_write_gather *g, int32_t op_ret,
+                        int32_t op_errno)
+{
+        struct nfs3_state       *nfs3 = g->nfs3state;
+        nfs3_call_state_t       *cs = NULL;
+        nfs3_call_state_t       *tmp = NULL;
+        struct list_head        waiters;
+        int                     failed = 0;
+
+        INIT_LIST_HEAD (&waiters);
+        failed = ((op_ret < 0) || ((size_t)op_ret != g->size));
+
+        LOCK (&nfs3->gatherlock);
+        {
+                /* The client was told this data was written. It learns
+                 * otherwise from the next WRITE or COMMIT to the file,
+                 * which are not gathered from then on: resending the data
+                 * would only fail the same way again.
+                 */
+                if (failed)
+                        __nfs3_write_gather_error_set (nfs3, g->inode,
+                                                       (op_ret < 0) ?
+                                                       op_errno : EIO);
+
+                list_del_init (&g->list);
+                nfs3->gather_count--;
+                nfs3->gather_bytes -= g->size;
+                list_splice_init (&g->waiters, &waiters);
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        nfs3_dircache_changed (nfs3->dircache, g->inode->gfid);
+
+        if (failed)
+                gf_log (GF_NFS3, GF_LOG_WARNING, "%s: gathered write of %zu "
+                        "bytes at %"PRId64" failed: %s",
+                        uuid_utoa (g->inode->gfid), g->size, (int64_t)g->offset,
+                        (op_ret < 0) ? strerror (op_errno) : "short write");
+
+        nfs3_write_gather_destroy (g);
+
+        list_for_each_entry_safe (cs, tmp, &waiters, gatherwait_q) {
+                list_del_init (&cs->gatherwait_q);
+                cs->resume_fn (cs);
+        }
+}
+
+
+int32_t
+nfs3_write_gather_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                       int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                       struct iatt *postbuf, dict_t *xdata)
+{
+        nfs3_write_gather_done (frame->local, op_ret, op_errno);
+        return 0;
+}
+
+
+static void
+nfs3_write_gather_flush (struct list_head *flush)
+{
+        struct nfs3_write_gather        *g = NULL;
+        struct nfs3_write_gather        *tmp = NULL;
+        int                             ret = -EFAULT;
+
+        list_for_each_entry_safe (g, tmp, flush, flush_list) {
+                list_del_init (&g->flush_list);
+                ret = nfs_write (g->nfs3state->nfsx, g->vol, &g->nfu, g->fd,
+                                 g->iobref, g->vector, g->count, g->offset,
+                                 nfs3_write_gather_cbk, g);
+                if (ret < 0)
+                        nfs3_write_gather_done (g, -1, -ret);
+        }
+}
+
+
+void
+nfs3_write_gather_timer (void *data)
+{
+        struct nfs3_state               *nfs3 = data;
+        struct nfs3_write_gather        *g = NULL;
+        struct list_head                flush;
+        struct timeval                  delta = {GF_NFS3_GATHER_AGE, 0};
+        time_t                          now = 0;
+        int                             i = 0;
+        int                             rearm = 0;
+
+        THIS = nfs3->nfsx;
+        INIT_LIST_HEAD (&flush);
+        now = time (NULL);
+
+        LOCK (&nfs3->gatherlock);
+        {
+                for (i = 0; i < GF_NFS3_GATHER_BUCKETS; i++) {
+                        list_for_each_entry (g, &nfs3->gathers[i], list) {
+                                if (now - g->start >= GF_NFS3_GATHER_AGE)
+                                        __nfs3_write_gather_close (g, &flush);
+                        }
+                }
+
+                rearm = nfs3->gather_timer = (nfs3->gather_count > 0);
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        nfs3_write_gather_flush (&flush);
+
+        if (rearm && !gf_timer_call_after (nfs3->nfsx->ctx, delta,
+                                           nfs3_write_gather_timer, nfs3)) {
+                LOCK (&nfs3->gatherlock);
+                {
+                        nfs3->gather_timer = 0;
+                }
+                UNLOCK (&nfs3->gatherlock);
+        }
+}
+
+
+/*
+ * Gather the UNSTABLE write in @cs with the earlier ones to the same inode.
+ * A write that continues the current gather is acknowledged right away and
+ * sent to the volume later as part of one big writev. Any other write to
+ * the inode has the gather written out first, and then starts a new one.
+ * When the gathers would use more than the budget, all of them are written
+ * out and @cs goes to the volume by itself.
+ */
+static int
+nfs3_write_gather (nfs3_call_state_t *cs)
+{
+        struct nfs3_state               *nfs3 = cs->nfs3state;
+        struct nfs3_write_gather        *g = NULL;
+        nfs_user_t                      nfu = {0, };
+        struct list_head                flush;
+        struct timeval                  delta = {GF_NFS3_GATHER_AGE, 0};
+        uint64_t                        verf = 0;
+        int                             i = 0;
+        int                             gathered = 0;
+        int                             queued = 0;
+        int                             arm = 0;
+
+        INIT_LIST_HEAD (&flush);
+        nfs_request_user_init (&nfu, cs->req);
+
+        LOCK (&nfs3->gatherlock);
+        {
+                if (nfs3->gather_bytes + cs->datacount > nfs3->gather_budget) {
+                        for (i = 0; i < GF_NFS3_GATHER_BUCKETS; i++) {
+                                list_for_each_entry (g, &nfs3->gathers[i], list)
+                                        __nfs3_write_gather_close (g, &flush);
+                        }
+                }
+
+                g = __nfs3_write_gather_get (nfs3, cs->resolvedloc.inode);
+                if (g && __nfs3_write_gather_fits (g, cs, &nfu)) {
+                        gathered = (__nfs3_write_gather_add (g, cs) == 0);
+                } else if (g) {
+                        __nfs3_write_gather_close (g, &flush);
+                        list_add_tail (&cs->gatherwait_q, &g->waiters);
+                        cs->resume_fn = nfs3_write_fd_resume;
+                        queued = 1;
+                } else if (list_empty (&flush) &&
+                           (cs->datacount < nfs3->gather_size)) {
+                        g = __nfs3_write_gather_new (nfs3, cs, &nfu);
+                        gathered = (g != NULL);
+                        arm = !nfs3->gather_timer;
+                        nfs3->gather_timer = 1;
+                }
+
+                if (gathered && ((g->size == nfs3->gather_size) ||
+                                 (g->count == GF_NFS3_GATHER_MAXVEC)))
+                        __nfs3_write_gather_close (g, &flush);
+
+                verf = nfs3->write_verf;
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        if (arm && !gf_timer_call_after (nfs3->nfsx->ctx, delta,
+                                         nfs3_write_gather_timer, nfs3)) {
+                LOCK (&nfs3->gatherlock);
+                {
+                        nfs3->gather_timer = 0;
+                }
+                UNLOCK (&nfs3->gatherlock);
+        }
+
+        if (gathered) {
+                nfs3_log_write_res (rpcsvc_request_xid (cs->req), NFS3_OK, 0,
+                                    cs->datacount, UNSTABLE, verf);
+                nfs3_write_reply (cs->req, NFS3_OK, cs->datacount, UNSTABLE,
+                                  verf, NULL, NULL);
+                nfs3_call_state_wipe (cs);
+        }
+
+        /* @cs is not ours anymore once it is queued on a gather or wiped */
+        nfs3_write_gather_flush (&flush);
+
+        if (gathered || queued)
+                return 0;
+
+        return __nfs3_write_resume (cs);
+}
+
+
+/*
+ * Ops that need to see the data of UNSTABLE writes acknowledged so far have
+ * those written out first. Returns 1 if @cs was queued to be resumed with
+ * @resume then, 0 if it can go ahead right away.
+ */
+static int
+nfs3_write_gather_wait (nfs3_call_state_t *cs, nfs3_resume_fn_t resume)
+{
+        struct nfs3_state               *nfs3 = cs->nfs3state;
+        struct nfs3_write_gather        *g = NULL;
+        struct list_head                flush;
+        int                             queued = 0;
+
+        if (!nfs3->gather_size || cs->gatherwaited)
+                return 0;
+
+        INIT_LIST_HEAD (&flush);
+
+        LOCK (&nfs3->gatherlock);
+        {
+                g = __nfs3_write_gather_get (nfs3, cs->resolvedloc.inode);
+                if (g) {
+                        __nfs3_write_gather_close (g, &flush);
+                        list_add_tail (&cs->gatherwait_q, &g->waiters);
+                        cs->resume_fn = resume;
+                        cs->gatherwaited = 1;
+                        queued = 1;
+                }
+        }
+        UNLOCK (&nfs3->gatherlock);
+
+        nfs3_write_gather_flush (&flush);
+
+        return queued;
+}
+
+
+int
+nfs3_write_fd_resume (void *carg)
+{
+        nfsstat3                stat = NFS3ERR_SERVERFAULT;
+        int                     ret = -EFAULT;
+        int                     failed = 0;
+        nfs3_call_state_t       *cs = NULL;
+
+        if (!carg)
+                return ret;
+
+        cs = (nfs3_call_state_t *)carg;
+        if (cs->nfs3state->gather_size) {
+                ret = nfs3_write_gather_error (cs, &failed);
+                if (ret) {
+                        ret = -ret;
+                        goto err;
+                }
+        }
+
+        if ((cs->writetype == UNSTABLE) && cs->nfs3state->gather_size &&
+            !failed && !nfs3_export_write_trusted (cs->nfs3state,
+                                                   cs->resolvefh.exportid)) {
+                ret = nfs3_write_gather (cs);
+        } else if (nfs3_write_gather_wait (cs, nfs3_write_fd_resume)) {
+                ret = 0;
+        } else
+                ret = __nfs3_write_resume (cs);
+
+err:
+        if (ret < 0) {
+                stat = nfs3_errno_to_nfsstat3 (-ret);
+                nfs3_log_common_res (rpcsvc_request_xid (cs->req), NFS3_WRITE,
+                                     stat, -ret);
+                nfs3_write_reply (cs->req, stat, 0, cs->writetype, 0, NULL,
+                                  NULL);
+                nfs3_call_state_wipe (cs);
+        }
+
+        return ret;
+}
+
+
 int
 nfs3_write_resume (void *carg)
 {
@@ -2198,9 +2776,8 @@ nfs3_write_resume (void *carg)
         }
 
         cs->fd = fd;    /* Gets unrefd when the call state is wiped. */
-        ret = __nfs3_write_resume (cs);
-        if (ret < 0)
-                stat = nfs3_errno_to_nfsstat3 (-ret);
+        nfs3_write_fd_resume (cs);
+        ret = 0;
 nfs3err:
         if (ret < 0) {
                 nfs3_log_common_res (rpcsvc_request_xid (cs->req), NFS3_WRITE,
@@ -2390,6 +2967,8 @@ nfs3svc_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
 	inode_t			*oldinode = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -2399,6 +2978,8 @@ nfs3svc_create_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         nfs3_fh_build_child_fh (&cs->parent, buf, &cs->fh);
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
         oldinode = inode_link (inode, cs->resolvedloc.parent,
                                cs->resolvedloc.name, buf);
 
@@ -2748,6 +3329,8 @@ nfs3svc_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t               *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -2757,6 +3340,8 @@ nfs3svc_mkdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         nfs3_fh_build_child_fh (&cs->parent, buf, &cs->fh);
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
 
         /* Means no attributes were required to be set. */
         if (!cs->setattr_valid) {
@@ -2926,6 +3511,8 @@ nfs3svc_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t               *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -2935,6 +3522,8 @@ nfs3svc_symlink_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         nfs3_fh_build_child_fh (&cs->parent, buf, &cs->fh);
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
         stat = NFS3_OK;
 
 nfs3err:
@@ -3120,6 +3709,8 @@ nfs3svc_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t               *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -3129,6 +3720,8 @@ nfs3svc_mknod_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         }
 
         nfs3_fh_build_child_fh (&cs->parent, buf, &cs->fh);
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
 
         /* Means no attributes were required to be set. */
         if (!cs->setattr_valid) {
@@ -3378,6 +3971,12 @@ nfs3svc_remove_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t       *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
+        /* the other links of the file are one fewer now */
+        if ((op_ret == 0) && cs->resolvedloc.inode)
+                nfs3_dircache_changed (cs->nfs3state->dircache,
+                                       cs->resolvedloc.inode->gfid);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -3544,6 +4143,8 @@ nfs3svc_rmdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t       *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
@@ -3698,6 +4299,10 @@ nfs3svc_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t       *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->oploc);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: rename %s -> %s => -1 (%s)",
@@ -3707,6 +4312,8 @@ nfs3svc_rename_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto nfs3err;
         }
 
+        nfs3_fhcache_add_loc (cs->nfs3state->fhcache, &cs->resolvedloc,
+                              buf->ia_gfid);
         stat = NFS3_OK;
 nfs3err:
         nfs3_log_common_res (rpcsvc_request_xid (cs->req), NFS3_RENAME, stat,
@@ -3903,6 +4510,12 @@ nfs3svc_link_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         nfs3_call_state_t       *cs = NULL;
 
         cs = frame->local;
+        nfs3_dircache_invalidate_loc (cs->nfs3state->dircache,
+                                      &cs->resolvedloc);
+        /* the other links of the file are one more now */
+        if (op_ret >= 0)
+                nfs3_dircache_changed (cs->nfs3state->dircache,
+                                       buf->ia_gfid);
         if (op_ret == -1) {
                 gf_log (GF_NFS, GF_LOG_WARNING,
                         "%x: link %s <- %s => -1 (%s)",
@@ -4104,56 +4717,67 @@ nfs3_readdir_reply (rpcsvc_request_t *req, nfsstat3 stat, struct nfs3_fh *dirfh,
 }
 
 
-int32_t
-nfs3svc_readdir_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
-                           int32_t op_ret, int32_t op_errno, struct iatt *buf,
-                           dict_t *xdata)
+/*
+ * Reply with the entries in cs->entries. The cookie verifier is made from
+ * @buf, the attributes of the directory, so that it stays the same for as
+ * long as the directory does.
+ */
+void
+nfs3_readdir_reply_entries (nfs3_call_state_t *cs, nfsstat3 stat,
+                            int32_t op_errno, struct iatt *buf)
 {
-        nfsstat3                stat = NFS3ERR_SERVERFAULT;
         int                     is_eof = 0;
-        nfs3_call_state_t       *cs = NULL;
+        uint64_t                cverf = 0;
 
-        cs = frame->local;
-        if (op_ret == -1) {
-                gf_log (GF_NFS, GF_LOG_WARNING,
-                        "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
-                        cs->resolvedloc.path, strerror (op_errno));
-                stat = nfs3_errno_to_nfsstat3 (op_errno);
-                goto nfs3err;
-        }
+        if (stat == NFS3_OK) {
+                /* Check whether we encountered a end of directory stream
+                 * while readdir'ing.
+                 */
+                if (cs->operrno == ENOENT) {
+                        gf_log (GF_NFS3, GF_LOG_TRACE,
+                                "Reached end-of-directory");
+                        is_eof = 1;
+                }
 
-        /* Check whether we encountered a end of directory stream while
-         * readdir'ing.
-         */
-        if (cs->operrno == ENOENT) {
-                gf_log (GF_NFS3, GF_LOG_TRACE, "Reached end-of-directory");
-                is_eof = 1;
+                cverf = nfs3_dircache_verf (buf);
         }
 
-        stat = NFS3_OK;
-nfs3err:
         if (cs->maxcount == 0) {
                 nfs3_log_readdir_res (rpcsvc_request_xid (cs->req), stat,
-                                      op_errno, (uintptr_t)cs->fd,
-                                      cs->dircount, is_eof);
-                nfs3_readdir_reply (cs->req, stat, &cs->parent,
-                                    (uintptr_t)cs->fd, buf, &cs->entries,
-                                    cs->dircount, is_eof);
+                                      op_errno, cverf, cs->dircount, is_eof);
+                nfs3_readdir_reply (cs->req, stat, &cs->parent, cverf, buf,
+                                    &cs->entries, cs->dircount, is_eof);
         } else {
                 nfs3_log_readdirp_res (rpcsvc_request_xid (cs->req), stat,
-                                       op_errno, (uintptr_t)cs->fd,
-                                       cs->dircount, cs->maxcount, is_eof);
-                nfs3_readdirp_reply (cs->req, stat, &cs->parent,
-                                     (uintptr_t)cs->fd, buf,
+                                       op_errno, cverf, cs->dircount,
+                                       cs->maxcount, is_eof);
+                nfs3_readdirp_reply (cs->req, stat, &cs->parent, cverf, buf,
                                      &cs->entries, cs->dircount,
                                      cs->maxcount, is_eof);
         }
 
-        if (is_eof) {
-                /* do nothing */
-        }
-
         nfs3_call_state_wipe (cs);
+}
+
+
+int32_t
+nfs3svc_readdir_fstat_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                           int32_t op_ret, int32_t op_errno, struct iatt *buf,
+                           dict_t *xdata)
+{
+        nfsstat3                stat = NFS3ERR_SERVERFAULT;
+        nfs3_call_state_t       *cs = NULL;
+
+        cs = frame->local;
+        if (op_ret == -1) {
+                gf_log (GF_NFS, GF_LOG_WARNING,
+                        "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
+                        cs->resolvedloc.path, strerror (op_errno));
+                stat = nfs3_errno_to_nfsstat3 (op_errno);
+        } else
+                stat = NFS3_OK;
+
+        nfs3_readdir_reply_entries (cs, stat, op_errno, buf);
         return 0;
 }
 
@@ -4177,6 +4801,11 @@ nfs3svc_readdir_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto err;
         }
 
+        /* clients get fhs for these */
+        if (cs->maxcount)
+                nfs3_fhcache_add_dirents (cs->nfs3state->fhcache,
+                                          cs->resolvedloc.inode->gfid, entries);
+
         cs->operrno = op_errno;
         list_splice_init (&entries->list, &cs->entries.list);
         nfs_request_user_init (&nfu, cs->req);
@@ -4228,6 +4857,128 @@ nfs3_readdir_process (nfs3_call_state_t *cs)
 }
 
 
+void
+nfs3_readdir_cache_serve (nfs3_call_state_t *cs);
+
+int32_t
+nfs3svc_readdir_cache_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
+                           int32_t op_ret, int32_t op_errno,
+                           gf_dirent_t *entries, dict_t *xdata)
+{
+        nfs3_call_state_t       *cs = NULL;
+        int                     eof = 0;
+
+        cs = frame->local;
+        if (op_ret == -1) {
+                gf_log (GF_NFS, GF_LOG_WARNING,
+                        "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
+                        cs->resolvedloc.path, strerror (op_errno));
+                nfs3_readdir_reply_entries (cs, nfs3_errno_to_nfsstat3
+                                            (op_errno), op_errno, NULL);
+                return 0;
+        }
+
+        if (cs->maxcount)
+                nfs3_fhcache_add_dirents (cs->nfs3state->fhcache,
+                                          cs->resolvedloc.inode->gfid, entries);
+
+        eof = ((op_ret == 0) || (op_errno == ENOENT));
+        nfs3_dircache_append (cs->nfs3state->dircache, cs->dircache,
+                              cs->dircache_tail, entries, eof);
+
+        /* whether these entries made it in or another call's did, the
+         * cache now reaches further
+         */
+        nfs3_readdir_cache_serve (cs);
+        return 0;
+}
+
+
+/*
+ * Reply from the cache of the directory, reading further into the
+ * directory first if the page is not cached yet. The read is bigger than
+ * the page, so that the next pages can be served without one.
+ */
+void
+nfs3_readdir_cache_serve (nfs3_call_state_t *cs)
+{
+        struct nfs3_state       *nfs3 = NULL;
+        nfs_user_t              nfu = {0, };
+        size_t                  size = 0;
+        int                     eof = 0;
+        int                     ret = -EFAULT;
+
+        nfs3 = cs->nfs3state;
+        ret = nfs3_dircache_fill (nfs3->dircache, cs->dircache, cs->cookie,
+                                  cs->dircount, cs->maxcount, &cs->entries,
+                                  &eof, &cs->dircache_tail);
+        if (ret == 1) {
+                cs->operrno = eof ? ENOENT : 0;
+                nfs3_readdir_reply_entries (cs, NFS3_OK, 0, &cs->stbuf);
+                return;
+        }
+
+        if (ret == 0) {
+                size = max (cs->dircount, nfs3->readdirsize);
+                nfs_request_user_init (&nfu, cs->req);
+                ret = nfs_readdirp (cs->nfsx, cs->vol, &nfu, cs->fd, size,
+                                    cs->dircache_tail,
+                                    nfs3svc_readdir_cache_cbk, cs);
+        } else {
+                nfs3_dircache_put (nfs3->dircache, cs->dircache);
+                cs->dircache = NULL;
+                ret = nfs3_readdir_process (cs);
+        }
+
+        if (ret < 0)
+                nfs3_readdir_reply_entries (cs, nfs3_errno_to_nfsstat3 (-ret),
+                                            -ret, NULL);
+}
+
+
+int32_t
+nfs3svc_readdir_cache_fstat_cbk (call_frame_t *frame, void *cookie,
+                                 xlator_t *this, int32_t op_ret,
+                                 int32_t op_errno, struct iatt *buf,
+                                 dict_t *xdata)
+{
+        nfs3_call_state_t       *cs = NULL;
+        uint64_t                verf = 0;
+        int                     ret = -EFAULT;
+
+        cs = frame->local;
+        if (op_ret == -1) {
+                gf_log (GF_NFS, GF_LOG_WARNING,
+                        "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
+                        cs->resolvedloc.path, strerror (op_errno));
+                nfs3_readdir_reply_entries (cs, nfs3_errno_to_nfsstat3
+                                            (op_errno), op_errno, NULL);
+                return 0;
+        }
+
+        cs->stbuf = *buf;
+        verf = nfs3_dircache_verf (buf);
+
+        /* A listing that started before the directory changed goes on
+         * uncached, like it would without the cache.
+         */
+        if ((cs->cookie == 0) || (cs->cookieverf == verf))
+                cs->dircache = nfs3_dircache_get (cs->nfs3state->dircache,
+                                                  cs->resolvedloc.inode->gfid,
+                                                  verf);
+        if (cs->dircache) {
+                nfs3_readdir_cache_serve (cs);
+                return 0;
+        }
+
+        ret = nfs3_readdir_process (cs);
+        if (ret < 0)
+                nfs3_readdir_reply_entries (cs, nfs3_errno_to_nfsstat3 (-ret),
+                                            -ret, NULL);
+        return 0;
+}
+
+
 int
 nfs3_readdir_read_resume (void *carg)
 {
@@ -4235,6 +4986,7 @@ nfs3_readdir_read_resume (void *carg)
         int                     ret = -EFAULT;
         nfs3_call_state_t       *cs = NULL;
         struct nfs3_state       *nfs3 = NULL;
+        nfs_user_t              nfu = {0, };
 
         if (!carg)
                 return ret;
@@ -4247,7 +4999,15 @@ nfs3_readdir_read_resume (void *carg)
         if (ret < 0)    /* Stat already set by verifier function above. */
                 goto nfs3err;
 
-        ret = nfs3_readdir_process (cs);
+        /* The attributes of the directory tell whether its cache is still
+         * good, so they come first when it is enabled.
+         */
+        if (nfs3->dircache) {
+                nfs_request_user_init (&nfu, cs->req);
+                ret = nfs_fstat (cs->nfsx, cs->vol, &nfu, cs->fd,
+                                 nfs3svc_readdir_cache_fstat_cbk, cs);
+        } else
+                ret = nfs3_readdir_process (cs);
         if (ret < 0)
                 stat = nfs3_errno_to_nfsstat3 (-ret);
 nfs3err:
@@ -4975,11 +5735,13 @@ nfs3_commit_reply (rpcsvc_request_t *req, nfsstat3 stat, uint64_t wverf,
 
 int32_t
 nfs3svc_commit_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
-                    int32_t op_ret, int32_t op_errno, dict_t *xdata)
+                    int32_t op_ret, int32_t op_errno, struct iatt *prebuf,
+                    struct iatt *postbuf, dict_t *xdata)
 {
         nfsstat3                stat = NFS3ERR_SERVERFAULT;
         nfs3_call_state_t       *cs = NULL;
         struct nfs3_state       *nfs3 = NULL;
+        uint64_t                verf = 0;
 
         cs = frame->local;
         if (op_ret == -1) {
@@ -4987,13 +5749,16 @@ nfs3svc_commit_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                         "%x: %s => -1 (%s)", rpcsvc_request_xid (cs->req),
                         cs->resolvedloc.path, strerror (op_errno));
                 stat = nfs3_errno_to_nfsstat3 (op_errno);
-        } else
+        } else {
                 stat = NFS3_OK;
+                nfs3_write_gather_error_clear (cs);
+        }
 
         nfs3 = rpcsvc_request_program_private (cs->req);
+        verf = nfs3_write_verf (nfs3);
         nfs3_log_commit_res (rpcsvc_request_xid (cs->req), stat, op_errno,
-                             nfs3->serverstart);
-        nfs3_commit_reply (cs->req, stat, nfs3->serverstart, NULL, NULL);
+                             verf);
+        nfs3_commit_reply (cs->req, stat, verf, prebuf, postbuf);
         nfs3_call_state_wipe (cs);
 
         return 0;
@@ -5014,13 +5779,17 @@ nfs3_commit_resume (void *carg)
         nfs3_check_fh_resolve_status (cs, stat, nfs3err);
 
         if (nfs3_export_sync_trusted (cs->nfs3state, cs->resolvefh.exportid)) {
+                nfs3_write_gather_error_clear (cs);
                 ret = -1;
                 stat = NFS3_OK;
                 goto nfs3err;
         }
 
+        /* Writes acknowledged as UNSTABLE are only on stable storage after
+         * an fsync, a flush is not enough.
+         */
         nfs_request_user_init (&nfu, cs->req);
-        ret = nfs_flush (cs->nfsx, cs->vol, &nfu, cs->fd,
+        ret = nfs_fsync (cs->nfsx, cs->vol, &nfu, cs->fd, 0,
                          nfs3svc_commit_cbk, cs);
         if (ret < 0)
                 stat = nfs3_errno_to_nfsstat3 (-ret);
@@ -5029,8 +5798,8 @@ nfs3err:
         if (ret < 0) {
                 nfs3_log_common_res (rpcsvc_request_xid (cs->req), NFS3_COMMIT,
                                      stat, -ret);
-                nfs3_commit_reply (cs->req, stat, cs->nfs3state->serverstart,
-                                   NULL, NULL);
+                nfs3_commit_reply (cs->req, stat,
+                                   nfs3_write_verf (cs->nfs3state), NULL, NULL);
                 nfs3_call_state_wipe (cs);
                 ret = 0;
         }
@@ -5051,6 +5820,20 @@ nfs3_commit_open_resume (void *carg)
 
         cs = (nfs3_call_state_t *)carg;
         nfs3_check_fh_resolve_status (cs, stat, nfs3err);
+        if (nfs3_write_gather_wait (cs, nfs3_commit_open_resume))
+                return 0;
+
+        /* acknowledged writes that never made it */
+        if (cs->nfs3state->gather_size) {
+                ret = nfs3_write_gather_error (cs, NULL);
+                if (ret) {
+                        stat = nfs3_errno_to_nfsstat3 (ret);
+                        ret = -ret;
+                        goto nfs3err;
+                }
+                ret = -EFAULT;
+        }
+
         cs->fd = fd_anonymous (cs->resolvedloc.inode);
         if (!cs->fd) {
                 gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to create anonymous fd.");
@@ -5272,6 +6055,54 @@ nfs3_init_options (struct nfs3_state *nfs3, xlator_t *nfsx)
          * accommodate the NFS headers also in the same buffer. */
         nfs3->iobsize = nfs3->iobsize * 2;
 
+        /* nfs3.write-gather-size */
+        nfs3->gather_size = GF_NFS3_GATHER_SIZE;
+        if (dict_get (nfsx->options, "nfs3.write-gather-size")) {
+                ret = dict_get_str (nfsx->options, "nfs3.write-gather-size",
+                                    &optstr);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.write-gather-size");
+                        ret = -1;
+                        goto err;
+                }
+
+                ret = gf_string2bytesize (optstr, &size64);
+                nfs3->gather_size = size64;
+                if (ret == -1) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to format"
+                                " option: nfs3.write-gather-size");
+                        ret = -1;
+                        goto err;
+                }
+        }
+
+        /* nfs3.write-gather-budget */
+        nfs3->gather_budget = GF_NFS3_GATHER_BUDGET;
+        if (dict_get (nfsx->options, "nfs3.write-gather-budget")) {
+                ret = dict_get_str (nfsx->options, "nfs3.write-gather-budget",
+                                    &optstr);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.write-gather-budget");
+                        ret = -1;
+                        goto err;
+                }
+
+                ret = gf_string2bytesize (optstr, &size64);
+                nfs3->gather_budget = size64;
+                if (ret == -1) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to format"
+                                " option: nfs3.write-gather-budget");
+                        ret = -1;
+                        goto err;
+                }
+        }
+
+        /* a gather never holds more than the budget */
+        if (nfs3->gather_size > nfs3->gather_budget)
+                nfs3->gather_size = nfs3->gather_budget;
+
         /* mem-factor */
         nfs3->memfactor = GF_NFS3_DEFAULT_MEMFACTOR;
         ret = 0;
@@ -5508,6 +6339,118 @@ err:
 }
 
 
+int
+nfs3_init_fhcache (struct nfs3_state *nfs3, xlator_t *nfsx)
+{
+        int             ret = -1;
+        char            *optstr = NULL;
+        char            *snapshot = NULL;
+        uint32_t        size = GF_NFS3_FHCACHE_SIZE;
+
+        /* nfs3.fh-cache-size */
+        if (dict_get (nfsx->options, "nfs3.fh-cache-size")) {
+                ret = dict_get_str (nfsx->options, "nfs3.fh-cache-size",
+                                    &optstr);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.fh-cache-size");
+                        return -1;
+                }
+
+                ret = gf_string2uint32 (optstr, &size);
+                if (ret == -1) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to format"
+                                " option: nfs3.fh-cache-size");
+                        return -1;
+                }
+        }
+
+        if (!size) {
+                gf_log (GF_NFS3, GF_LOG_DEBUG, "fh cache disabled");
+                return 0;
+        }
+
+        /* nfs3.fh-cache-file */
+        if (dict_get (nfsx->options, "nfs3.fh-cache-file")) {
+                ret = dict_get_str (nfsx->options, "nfs3.fh-cache-file",
+                                    &snapshot);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.fh-cache-file");
+                        return -1;
+                }
+        }
+
+        nfs3->fhcache = nfs3_fhcache_new (nfsx, size, snapshot);
+        if (!nfs3->fhcache) {
+                gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to create fh cache");
+                return -1;
+        }
+
+        return 0;
+}
+
+
+int
+nfs3_init_dircache (struct nfs3_state *nfs3, xlator_t *nfsx)
+{
+        int             ret = -1;
+        char            *optstr = NULL;
+        uint32_t        timeout = GF_NFS3_DIRCACHE_TIMEOUT;
+        uint64_t        entries = GF_NFS3_DIRCACHE_ENTRIES;
+
+        /* nfs3.readdir-cache-timeout */
+        if (dict_get (nfsx->options, "nfs3.readdir-cache-timeout")) {
+                ret = dict_get_str (nfsx->options,
+                                    "nfs3.readdir-cache-timeout", &optstr);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.readdir-cache-timeout");
+                        return -1;
+                }
+
+                ret = gf_string2uint32 (optstr, &timeout);
+                if (ret == -1) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to format"
+                                " option: nfs3.readdir-cache-timeout");
+                        return -1;
+                }
+        }
+
+        /* nfs3.readdir-cache-entries */
+        if (dict_get (nfsx->options, "nfs3.readdir-cache-entries")) {
+                ret = dict_get_str (nfsx->options,
+                                    "nfs3.readdir-cache-entries", &optstr);
+                if (ret < 0) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to read "
+                                " option: nfs3.readdir-cache-entries");
+                        return -1;
+                }
+
+                ret = gf_string2uint64 (optstr, &entries);
+                if (ret == -1) {
+                        gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to format"
+                                " option: nfs3.readdir-cache-entries");
+                        return -1;
+                }
+        }
+
+        if (!timeout || !entries) {
+                gf_log (GF_NFS3, GF_LOG_DEBUG, "readdir cache disabled");
+                return 0;
+        }
+
+        nfs3->dircache = nfs3_dircache_table_new (timeout, entries);
+        if (!nfs3->dircache) {
+                gf_log (GF_NFS3, GF_LOG_ERROR, "Failed to create readdir "
+                        "cache");
+                return -1;
+        }
+
+        return 0;
+}
+
+
 struct nfs3_state *
 nfs3_init_state (xlator_t *nfsx)
 {
@@ -5515,6 +6458,8 @@ nfs3_init_state (xlator_t *nfsx)
         int                     ret = -1;
         unsigned int            localpool = 0;
         struct nfs_state        *nfs = NULL;
+        struct timeval          tv = {0, };
+        int                     i = 0;
 
         if (!nfsx)
                 return NULL;
@@ -5554,11 +6499,28 @@ nfs3_init_state (xlator_t *nfsx)
                 goto free_localpool;
         }
 
-        nfs3->serverstart = (uint64_t)time (NULL);
+        ret = nfs3_init_fhcache (nfs3, nfsx);
+        if (ret == -1)
+                goto free_localpool;
+
+        ret = nfs3_init_dircache (nfs3, nfsx);
+        if (ret == -1)
+                goto free_localpool;
+
+        /* Changes on every restart, even a quick one */
+        gettimeofday (&tv, NULL);
+        nfs3->write_verf = ((uint64_t)tv.tv_sec << 32) |
+                           (uint32_t)(tv.tv_usec ^ (getpid () << 20));
         INIT_LIST_HEAD (&nfs3->fdlru);
         LOCK_INIT (&nfs3->fdlrulock);
         nfs3->fdcount = 0;
 
+        for (i = 0; i < GF_NFS3_GATHER_BUCKETS; i++) {
+                INIT_LIST_HEAD (&nfs3->gathers[i]);
+                INIT_LIST_HEAD (&nfs3->gather_errors[i]);
+        }
+        LOCK_INIT (&nfs3->gatherlock);
+
         rpcsvc_create_listeners (nfs->rpcsvc, nfsx->options, nfsx->name);
         if (ret == -1) {
                 gf_log (GF_NFS, GF_LOG_ERROR, "Unable to create listeners");
@@ -5569,8 +6531,10 @@ nfs3_init_state (xlator_t *nfsx)
         ret = 0;
 
 free_localpool:
-        if (ret == -1)
+        if (ret == -1) {
+                nfs3_fhcache_destroy (nfs3->fhcache);
                 mem_pool_destroy (nfs3->localpool);
+        }
 
 ret:
         if (ret == -1) {
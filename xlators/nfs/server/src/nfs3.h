@@ -37,6 +37,7 @@
 #include "nlm4.h"
 #include "acl3-xdr.h"
 #include "acl3.h"
+#include "timer.h"
 #include <sys/statvfs.h>
 
 #define GF_NFS3                 GF_NFS"-nfsv3"
@@ -73,6 +74,13 @@ FIXME: This should be configurable */
 
 
 #define GF_NFS3_FDCACHE_SIZE    512
+
+/* UNSTABLE write gathering, see nfs3_write_gather () */
+#define GF_NFS3_GATHER_SIZE     (1 * GF_UNIT_MB)
+#define GF_NFS3_GATHER_BUDGET   (64 * GF_UNIT_MB)
+#define GF_NFS3_GATHER_MAXVEC   128
+#define GF_NFS3_GATHER_BUCKETS  64
+#define GF_NFS3_GATHER_AGE      1       /* seconds */
 /* This should probably be moved to a more generic layer so that if needed
  * different versions of NFS protocol can use the same thing.
  */
@@ -116,8 +124,11 @@ typedef struct nfs3_state {
         /* Mempool for allocations of struct nfs3_local */
         struct mem_pool         *localpool;
 
-        /* Server start-up timestamp, currently used for write verifier. */
-        uint64_t                serverstart;
+        /* Write verifier. Set from the server start-up time and changed
+         * whenever data acknowledged as UNSTABLE could not be written, so
+         * that clients send it again.
+         */
+        uint64_t                write_verf;
 
         /* NFSv3 Protocol configurables */
         size_t                  readsize;
@@ -134,6 +145,31 @@ typedef struct nfs3_state {
         struct list_head        fdlru;
         gf_lock_t               fdlrulock;
         int                     fdcount;
+
+        /* UNSTABLE writes gathered per inode. A gather is written out when
+         * it is full, when it gets old, when all gathers together use up
+         * the budget, and before any op that needs to see its data.
+         * gatherlock also protects write_verf.
+         */
+        size_t                  gather_size;
+        size_t                  gather_budget;
+        size_t                  gather_bytes;
+        int                     gather_count;
+        int                     gather_timer;
+        struct list_head        gathers[GF_NFS3_GATHER_BUCKETS];
+        /* inodes whose gathered writes failed, see nfs3_write_gather_done */
+        struct list_head        gather_errors[GF_NFS3_GATHER_BUCKETS];
+        gf_lock_t               gatherlock;
+
+        /* Last known parent and name of fh gfids, used when they are not
+         * in the inode table. NULL if disabled.
+         */
+        struct nfs3_fhcache     *fhcache;
+
+        /* Directory entries being paged through by clients. NULL if
+         * disabled.
+         */
+        struct nfs3_dircache_table *dircache;
 } nfs3_state_t;
 
 typedef enum nfs3_lookup_type {
@@ -187,6 +223,12 @@ struct nfs3_local {
          */
         struct list_head        openwait_q;
 
+        /* The list hook to attach this call state to a gather of UNSTABLE
+         * writes till that is written out.
+         */
+        struct list_head        gatherwait_q;
+        int                     gatherwaited;
+
         /* Per-NFSv3 Op state */
         struct nfs3_fh          parent;
         struct nfs3_fh          fh;
@@ -215,11 +257,14 @@ struct nfs3_local {
         ftype3                  mknodtype;
         specdata3               devnums;
         cookie3                 cookie;
+        struct nfs3_dircache    *dircache;
+        uint64_t                dircache_tail;  /* read from here */
         struct iovec            datavec;
         mode_t                  mode;
 
         /* NFSv3 FH resolver state */
 	int			hardresolved;
+        struct timeval          hardresolve_start;
         struct nfs3_fh          resolvefh;
         loc_t                   resolvedloc;
         int                     resolve_ret;
@@ -256,6 +301,39 @@ struct nfs3_local {
 
 typedef struct nfs3_local nfs3_call_state_t;
 
+/* Adjacent UNSTABLE writes to one inode, acknowledged to the client and
+ * written to the volume as a single writev.
+ */
+struct nfs3_write_gather {
+        struct list_head        list;
+        struct list_head        flush_list;
+        struct nfs3_state       *nfs3state;
+        inode_t                 *inode;
+        fd_t                    *fd;
+        xlator_t                *vol;
+        nfs_user_t              nfu;
+        off_t                   offset;
+        size_t                  size;
+        int                     count;
+        struct iovec            *vector;
+        struct iobref           *iobref;
+        int                     flushing;
+        time_t                  start;
+
+        /* Call states to resume once this is written out. */
+        struct list_head        waiters;
+};
+
+/* An inode whose gathered write failed after it was acknowledged. The
+ * error goes back on its next WRITE or COMMIT, and its writes are not
+ * gathered until a COMMIT succeeds.
+ */
+struct nfs3_write_gather_error {
+        struct list_head        list;
+        inode_t                 *inode;
+        int32_t                 op_errno;       /* 0 once reported */
+};
+
 /* Queue of ops waiting for open fop to return. */
 struct inode_op_queue {
         struct list_head        opq;
@@ -43,7 +43,9 @@
 #include "rpc-clnt.h"
 #include "nsm-xdr.h"
 #include "nlmcbk-xdr.h"
+#include "xdr-generic.h"
 #include "run.h"
+#include "hashfn.h"
 #include <unistd.h>
 #include <rpc/pmap_clnt.h>
 #include <rpc/rpc.h>
@@ -60,8 +62,17 @@ typedef ssize_t (*nlm4_serializer) (struct iovec outmsg, void *args);
 extern void nfs3_call_state_wipe (nfs3_call_state_t *cs);
 
 struct list_head nlm_client_list;
+struct list_head nlm_client_table[NLM_CLIENT_HASH_SIZE];
 gf_lock_t nlm_client_list_lk;
 
+/* NSM requests go over one rpc-clnt to the local rpc.statd. SM_MONs made
+ * before it is connected wait on nsm_pending and go out on RPC_CLNT_CONNECT.
+ */
+rpc_clnt_t *nsm_rpc_clnt;
+int nsm_rpc_clnt_connected;
+struct list_head nsm_pending;
+gf_lock_t nsm_rpc_clnt_lk;
+
 /* race on this is harmless */
 int nlm_grace_period = 50;
 
@@ -285,6 +296,89 @@ nlm4_call_state_init (struct nfs3_state *s, rpcsvc_request_t *req)
         return cs;
 }
 
+static inline uint32_t
+nlm_client_hash (char *caller_name)
+{
+        return SuperFastHash (caller_name, strlen (caller_name))
+                & (NLM_CLIENT_HASH_SIZE - 1);
+}
+
+static inline uint32_t
+nlm_fde_hash (fd_t *fd)
+{
+        return ((unsigned long)fd / sizeof (*fd)) & (NLM_FDE_HASH_SIZE - 1);
+}
+
+/* to be called with nlm_client_list_lk held */
+nlm_client_t *
+__nlm_get_uniq (char *caller_name)
+{
+        nlm_client_t *nlmclnt = NULL;
+        struct list_head *head = NULL;
+
+        if (!caller_name)
+                return NULL;
+
+        head = &nlm_client_table[nlm_client_hash (caller_name)];
+        list_for_each_entry (nlmclnt, head, nlm_hash) {
+                if (!strcmp(caller_name, nlmclnt->caller_name))
+                        return nlmclnt;
+        }
+
+        return NULL;
+}
+
+static nlm_client_t *
+__nlm_client_new (char *caller_name)
+{
+        nlm_client_t *nlmclnt = NULL;
+        int i = 0;
+
+        nlmclnt = GF_CALLOC (1, sizeof(*nlmclnt), gf_nfs_mt_nlm4_nlmclnt);
+        if (nlmclnt == NULL)
+                return NULL;
+
+        nlmclnt->caller_name = gf_strdup (caller_name);
+        if (nlmclnt->caller_name == NULL) {
+                GF_FREE (nlmclnt);
+                return NULL;
+        }
+
+        INIT_LIST_HEAD(&nlmclnt->fdes);
+        INIT_LIST_HEAD(&nlmclnt->nlm_clients);
+        INIT_LIST_HEAD(&nlmclnt->nlm_hash);
+        INIT_LIST_HEAD(&nlmclnt->shares);
+        for (i = 0; i < NLM_FDE_HASH_SIZE; i++)
+                INIT_LIST_HEAD (&nlmclnt->fde_table[i]);
+
+        list_add (&nlmclnt->nlm_clients, &nlm_client_list);
+        list_add (&nlmclnt->nlm_hash,
+                  &nlm_client_table[nlm_client_hash (caller_name)]);
+
+        return nlmclnt;
+}
+
+static nlm_fde_t *
+__nlm_fde_find (nlm_client_t *nlmclnt, fd_t *fd)
+{
+        nlm_fde_t *fde = NULL;
+
+        list_for_each_entry (fde, &nlmclnt->fde_table[nlm_fde_hash (fd)],
+                             fde_hash) {
+                if (fde->fd == fd)
+                        return fde;
+        }
+
+        return NULL;
+}
+
+static void
+__nlm_fde_del (nlm_fde_t *fde)
+{
+        list_del (&fde->fde_list);
+        list_del (&fde->fde_hash);
+}
+
 int
 nlm_monitor (char *caller_name)
 {
@@ -292,12 +386,10 @@ nlm_monitor (char *caller_name)
         int monitor = -1;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt, &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        monitor = nlmclnt->nsm_monitor;
-                        nlmclnt->nsm_monitor = 1;
-                        break;
-                }
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (nlmclnt) {
+                monitor = nlmclnt->nsm_monitor;
+                nlmclnt->nsm_monitor = 1;
         }
         UNLOCK (&nlm_client_list_lk);
 
@@ -308,21 +400,27 @@ nlm_monitor (char *caller_name)
         return monitor;
 }
 
+void
+nlm_unmonitor (char *caller_name)
+{
+        nlm_client_t *nlmclnt = NULL;
+
+        LOCK (&nlm_client_list_lk);
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (nlmclnt)
+                nlmclnt->nsm_monitor = 0;
+        UNLOCK (&nlm_client_list_lk);
+}
+
 rpc_clnt_t *
 nlm_get_rpc_clnt (char *caller_name)
 {
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
         rpc_clnt_t *rpc_clnt = NULL;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt, &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-        if (!nlmclnt_found)
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt)
                 goto ret;
         if (nlmclnt->rpc_clnt)
                 rpc_clnt = rpc_clnt_ref (nlmclnt->rpc_clnt);
@@ -335,29 +433,14 @@ int
 nlm_set_rpc_clnt (rpc_clnt_t *rpc_clnt, char *caller_name)
 {
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
         int ret = -1;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt, &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-
-        if (!nlmclnt_found) {
-                nlmclnt = GF_CALLOC (1, sizeof(*nlmclnt),
-                                     gf_nfs_mt_nlm4_nlmclnt);
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt) {
+                nlmclnt = __nlm_client_new (caller_name);
                 if (nlmclnt == NULL)
                         goto ret;
-
-                INIT_LIST_HEAD(&nlmclnt->fdes);
-                INIT_LIST_HEAD(&nlmclnt->nlm_clients);
-                INIT_LIST_HEAD(&nlmclnt->shares);
-
-                list_add (&nlmclnt->nlm_clients, &nlm_client_list);
-                nlmclnt->caller_name = gf_strdup (caller_name);
         }
 
         if (nlmclnt->rpc_clnt == NULL) {
@@ -400,30 +483,16 @@ int
 nlm_add_nlmclnt (char *caller_name)
 {
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
         int ret = -1;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt, &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-        if (!nlmclnt_found) {
-                nlmclnt = GF_CALLOC (1, sizeof(*nlmclnt),
-                                     gf_nfs_mt_nlm4_nlmclnt);
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt) {
+                nlmclnt = __nlm_client_new (caller_name);
                 if (nlmclnt == NULL) {
                         gf_log (GF_NLM, GF_LOG_DEBUG, "malloc error");
                         goto ret;
                 }
-
-                INIT_LIST_HEAD(&nlmclnt->fdes);
-                INIT_LIST_HEAD(&nlmclnt->nlm_clients);
-                INIT_LIST_HEAD(&nlmclnt->shares);
-
-                list_add (&nlmclnt->nlm_clients, &nlm_client_list);
-                nlmclnt->caller_name = gf_strdup (caller_name);
         }
         ret = 0;
 ret:
@@ -506,74 +575,362 @@ nlm4_file_open_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         return 0;
 }
 
-void *
-nsm_monitor(void *arg)
-{
-        CLIENT *clnt = NULL;
-        enum clnt_stat ret;
-        struct mon nsm_mon;
-        struct sm_stat_res res;
-        struct timeval tout = { 5, 0 };
-        char *host = NULL;
-
-        host = arg;
-        nsm_mon.mon_id.mon_name = gf_strdup(host);
-        nsm_mon.mon_id.my_id.my_name = gf_strdup("localhost");
+int
+nsm_monitor_submit (xlator_t *nfsx, rpc_clnt_t *rpc_clnt, char *host);
+
+int
+nsm_rpcclnt_notify (struct rpc_clnt *rpc_clnt, void *mydata,
+                    rpc_clnt_event_t fn, void *data)
+{
+        xlator_t         *nfsx    = NULL;
+        nsm_pending_t    *pending = NULL;
+        nsm_pending_t    *tmp     = NULL;
+        struct list_head  queued;
+
+        nfsx = mydata;
+        INIT_LIST_HEAD (&queued);
+
+        switch (fn) {
+        case RPC_CLNT_CONNECT:
+                LOCK (&nsm_rpc_clnt_lk);
+                {
+                        if (nsm_rpc_clnt == rpc_clnt) {
+                                nsm_rpc_clnt_connected = 1;
+                                list_splice_init (&nsm_pending, &queued);
+                        }
+                }
+                UNLOCK (&nsm_rpc_clnt_lk);
+
+                list_for_each_entry_safe (pending, tmp, &queued, list) {
+                        list_del_init (&pending->list);
+                        nsm_monitor_submit (nfsx, rpc_clnt, pending->host);
+                        GF_FREE (pending->host);
+                        GF_FREE (pending);
+                }
+                break;
+
+        case RPC_CLNT_DISCONNECT:
+                /* the next SM_MON looks statd up again, it may have been
+                 * restarted on another port */
+                LOCK (&nsm_rpc_clnt_lk);
+                {
+                        if (nsm_rpc_clnt == rpc_clnt) {
+                                nsm_rpc_clnt = NULL;
+                                nsm_rpc_clnt_connected = 0;
+                                list_splice_init (&nsm_pending, &queued);
+                        } else {
+                                rpc_clnt = NULL;
+                        }
+                }
+                UNLOCK (&nsm_rpc_clnt_lk);
+
+                /* never connected, the hosts are monitored on their next
+                 * lock instead */
+                list_for_each_entry_safe (pending, tmp, &queued, list) {
+                        list_del_init (&pending->list);
+                        gf_log (GF_NLM, GF_LOG_ERROR, "SM_MON of %s failed, "
+                                "rpc.statd is not reachable", pending->host);
+                        nlm_unmonitor (pending->host);
+                        GF_FREE (pending->host);
+                        GF_FREE (pending);
+                }
+
+                if (rpc_clnt) {
+                        rpc_clnt_connection_cleanup (&rpc_clnt->conn);
+                        rpc_clnt_unref (rpc_clnt);
+                }
+                break;
+        default:
+                break;
+        }
+
+        return 0;
+}
+
+/* returns a ref on the rpc-clnt to the local rpc.statd, creating it the
+ * first time it is needed. It may not be connected yet. */
+rpc_clnt_t *
+nsm_get_rpc_clnt (xlator_t *nfsx)
+{
+        int                 ret      = -1;
+        int                 port     = 0;
+        struct sockaddr_in  sin      = {0, };
+        dict_t             *options  = NULL;
+        char               *portstr  = NULL;
+        rpc_clnt_t         *rpc_clnt = NULL;
+        rpc_clnt_t         *existing = NULL;
+
+        LOCK (&nsm_rpc_clnt_lk);
+        {
+                if (nsm_rpc_clnt)
+                        rpc_clnt = rpc_clnt_ref (nsm_rpc_clnt);
+        }
+        UNLOCK (&nsm_rpc_clnt_lk);
+
+        if (rpc_clnt)
+                return rpc_clnt;
+
+        sin.sin_family = AF_INET;
+        sin.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+        port = pmap_getport (&sin, NSM_PROGRAM, NSM_V1, IPPROTO_TCP);
+        if (port == 0) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Unable to get the port of "
+                        "rpc.statd. Is it running?");
+                goto err;
+        }
+
+        options = dict_new ();
+        if (!options)
+                goto err;
+
+        ret = dict_set_str (options, "transport-type", "socket");
+        if (ret == -1)
+                goto err;
+
+        ret = dict_set_str (options, "remote-host", "127.0.0.1");
+        if (ret == -1)
+                goto err;
+
+        ret = gf_asprintf (&portstr, "%d", port);
+        if (ret == -1)
+                goto err;
+
+        ret = dict_set_dynstr (options, "remote-port", portstr);
+        if (ret == -1) {
+                GF_FREE (portstr);
+                goto err;
+        }
+
+        ret = dict_set_str (options, "auth-null", "on");
+        if (ret == -1)
+                goto err;
+
+        rpc_clnt = rpc_clnt_new (options, nfsx->ctx, "NSM-client", 32);
+        if (rpc_clnt == NULL) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "rpc_clnt NULL");
+                ret = -1;
+                goto err;
+        }
+        /* the transport owns the options now */
+        options = NULL;
+
+        ret = rpc_clnt_register_notify (rpc_clnt, nsm_rpcclnt_notify, nfsx);
+        if (ret == -1) {
+                gf_log (GF_NLM, GF_LOG_ERROR,"rpc_clnt_register_connect error");
+                goto err;
+        }
+
+        /* published before connecting, so that RPC_CLNT_CONNECT finds it
+         * and sends out the SM_MONs queued meanwhile */
+        LOCK (&nsm_rpc_clnt_lk);
+        {
+                if (nsm_rpc_clnt)
+                        existing = rpc_clnt_ref (nsm_rpc_clnt);
+                else
+                        nsm_rpc_clnt = rpc_clnt_ref (rpc_clnt);
+        }
+        UNLOCK (&nsm_rpc_clnt_lk);
+
+        if (existing) {
+                /* lost the race against another lock reply */
+                rpc_clnt_unref (rpc_clnt);
+                rpc_clnt = existing;
+                goto err;
+        }
+
+        ret = rpc_transport_connect (rpc_clnt->conn.trans, port);
+        if (ret == -1 && EINPROGRESS == errno)
+                ret = 0;
+        if (ret == -1) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Unable to connect to "
+                        "rpc.statd on port %d", port);
+                nsm_rpcclnt_notify (rpc_clnt, nfsx, RPC_CLNT_DISCONNECT,
+                                    NULL);
+        }
+
+err:
+        if (ret == -1) {
+                if (rpc_clnt)
+                        rpc_clnt_unref (rpc_clnt);
+                rpc_clnt = NULL;
+        }
+        if (options)
+                dict_unref (options);
+
+        return rpc_clnt;
+}
+
+int
+nsm_monitor_cbk (struct rpc_req *req, struct iovec *iov, int count,
+                 void *myframe)
+{
+        call_frame_t        *frame = myframe;
+        char                *host  = NULL;
+        struct sm_stat_res   res   = {0, };
+        int                  ret   = -1;
+
+        host = frame->local;
+        frame->local = NULL;
+
+        if (req->rpc_status == -1)
+                goto out;
+
+        ret = xdr_to_generic (*iov, &res, (xdrproc_t)xdr_sm_stat_res);
+        if (ret < 0) {
+                ret = -1;
+                goto out;
+        }
+
+        ret = (res.res_stat == STAT_SUCC) ? 0 : -1;
+out:
+        if (ret == -1) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "SM_MON of %s failed, will "
+                        "retry on its next lock", host);
+                nlm_unmonitor (host);
+        }
+
+        GF_FREE (host);
+        STACK_DESTROY (frame->root);
+        return 0;
+}
+
+rpc_clnt_procedure_t nsm_clnt_actors[NSM_PROC_COUNT] = {
+        [NSM_MON] = {"MON", NULL},
+};
+
+char *nsm_clnt_names[NSM_PROC_COUNT] = {
+        [NSM_MON] = "MON",
+};
+
+rpc_clnt_prog_t nsmclntprog = {
+        .progname = "NSMv1",
+        .prognum = NSM_PROGRAM,
+        .progver = NSM_V1,
+        .numproc = NSM_PROC_COUNT,
+        .proctable = nsm_clnt_actors,
+        .procnames = nsm_clnt_names,
+};
+
+int
+nsm_monitor_submit (xlator_t *nfsx, rpc_clnt_t *rpc_clnt, char *host)
+{
+        int            ret      = -1;
+        call_frame_t  *frame    = NULL;
+        struct mon     nsm_mon  = {{0, }, };
+        struct iovec   outmsg   = {0, };
+        struct iobuf  *iobuf    = NULL;
+        struct iobref *iobref   = NULL;
+
+        frame = create_frame (nfsx, nfsx->ctx->pool);
+        if (!frame)
+                goto out;
+
+        frame->local = gf_strdup (host);
+        if (!frame->local)
+                goto out;
+
+        nsm_mon.mon_id.mon_name = host;
+        nsm_mon.mon_id.my_id.my_name = "localhost";
         nsm_mon.mon_id.my_id.my_prog = NLMCBK_PROGRAM;
         nsm_mon.mon_id.my_id.my_vers = NLMCBK_V1;
         nsm_mon.mon_id.my_id.my_proc = NLMCBK_SM_NOTIFY;
         /* nothing to put in the private data */
-#define SM_PROG 100024
-#define SM_VERS 1
-#define SM_MON 2
 
-        /* create a connection to nsm on the localhost */
-        clnt = clnt_create("localhost", SM_PROG, SM_VERS, "tcp");
-        if(!clnt)
-        {
-                gf_log (GF_NLM, GF_LOG_ERROR, "%s",
-                        clnt_spcreateerror ("Clnt_create()"));
+        iobuf = iobuf_get (nfsx->ctx->iobuf_pool);
+        if (!iobuf) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Failed to get iobuf");
                 goto out;
         }
 
-        ret = clnt_call(clnt, SM_MON,
-                        (xdrproc_t) xdr_mon, (caddr_t) & nsm_mon,
-                        (xdrproc_t) xdr_sm_stat_res, (caddr_t) & res, tout);
-        if(ret != RPC_SUCCESS)
-        {
-                gf_log (GF_NLM, GF_LOG_ERROR, "clnt_call(): %s",
-                        clnt_sperrno(ret));
+        iobuf_to_iovec (iobuf, &outmsg);
+        ret = xdr_serialize_generic (outmsg, &nsm_mon, (xdrproc_t)xdr_mon);
+        if (ret == -1)
                 goto out;
-        }
-        if(res.res_stat != STAT_SUCC)
-        {
-                gf_log (GF_NLM, GF_LOG_ERROR, "clnt_call(): %s",
-                        clnt_sperrno(ret));
+        outmsg.iov_len = ret;
+
+        iobref = iobref_new ();
+        if (iobref == NULL) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Failed to get iobref");
+                ret = -1;
                 goto out;
         }
+        iobref_add (iobref, iobuf);
 
+        /* on failure the cbk has already been called with the frame */
+        rpc_clnt_submit (rpc_clnt, &nsmclntprog, NSM_MON, nsm_monitor_cbk,
+                         &outmsg, 1, NULL, 0, iobref, frame, NULL, 0,
+                         NULL, 0, NULL);
+        frame = NULL;
+        ret = 0;
 out:
-        GF_FREE(nsm_mon.mon_id.mon_name);
-        GF_FREE(nsm_mon.mon_id.my_id.my_name);
-        if (clnt != NULL)
-                clnt_destroy(clnt);
-        return NULL;
+        if (ret == -1) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Failed to monitor %s", host);
+                nlm_unmonitor (host);
+        }
+        if (frame) {
+                GF_FREE (frame->local);
+                frame->local = NULL;
+                STACK_DESTROY (frame->root);
+        }
+        if (iobref)
+                iobref_unref (iobref);
+        if (iobuf)
+                iobuf_unref (iobuf);
+
+        return ret;
 }
 
-nlm_client_t *
-__nlm_get_uniq (char *caller_name)
+/* asks the local rpc.statd to monitor host, the reply is handled from the
+ * event loop so lock replies never wait on statd */
+int
+nsm_monitor (nfs3_call_state_t *cs, char *host)
 {
-        nlm_client_t *nlmclnt = NULL;
+        int            ret      = -1;
+        int            queued   = 0;
+        rpc_clnt_t    *rpc_clnt = NULL;
+        nsm_pending_t *pending  = NULL;
 
-        if (!caller_name)
-                return NULL;
+        rpc_clnt = nsm_get_rpc_clnt (cs->nfsx);
+        if (!rpc_clnt)
+                goto out;
 
-        list_for_each_entry (nlmclnt, &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name))
-                        return nlmclnt;
+        pending = GF_CALLOC (1, sizeof (*pending), gf_nfs_mt_nsm_pending);
+        if (!pending)
+                goto out;
+
+        pending->host = gf_strdup (host);
+        if (!pending->host)
+                goto out;
+
+        /* the socket refuses requests until it is connected */
+        LOCK (&nsm_rpc_clnt_lk);
+        {
+                if ((nsm_rpc_clnt == rpc_clnt) && !nsm_rpc_clnt_connected) {
+                        list_add_tail (&pending->list, &nsm_pending);
+                        queued = 1;
+                }
         }
+        UNLOCK (&nsm_rpc_clnt_lk);
 
-        return NULL;
+        if (queued)
+                pending = NULL;
+        else
+                /* failures are logged and unmonitored there */
+                nsm_monitor_submit (cs->nfsx, rpc_clnt, host);
+        ret = 0;
+out:
+        if (ret == -1) {
+                gf_log (GF_NLM, GF_LOG_ERROR, "Failed to monitor %s", host);
+                nlm_unmonitor (host);
+        }
+        if (pending) {
+                GF_FREE (pending->host);
+                GF_FREE (pending);
+        }
+        if (rpc_clnt)
+                rpc_clnt_unref (rpc_clnt);
+
+        return ret;
 }
 
 nlm_client_t *
@@ -1113,20 +1470,12 @@ ret:
 int
 nlm_cleanup_fds (char *caller_name)
 {
-        int nlmclnt_found = 0;
         nlm_fde_t *fde = NULL, *tmp = NULL;
         nlm_client_t *nlmclnt = NULL;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt,
-                             &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-
-        if (!nlmclnt_found)
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt)
                 goto ret;
 
         if (list_empty (&nlmclnt->fdes))
@@ -1134,7 +1483,7 @@ nlm_cleanup_fds (char *caller_name)
 
         list_for_each_entry_safe (fde, tmp, &nlmclnt->fdes, fde_list) {
                 fd_unref (fde->fd);
-                list_del (&fde->fde_list);
+                __nlm_fde_del (fde);
                 GF_FREE (fde);
         }
 
@@ -1148,35 +1497,22 @@ nlm_search_and_delete (fd_t *fd, char *caller_name)
 {
         nlm_fde_t *fde = NULL;
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
         int fde_found = 0;
         int transit_cnt = 0;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt,
-                             &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-
-        if (!nlmclnt_found)
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt)
                 goto ret;
 
-        list_for_each_entry (fde, &nlmclnt->fdes, fde_list) {
-                if (fde->fd == fd) {
-                        fde_found = 1;
-                        break;
-                }
-        }
-
-        if (!fde_found)
+        fde = __nlm_fde_find (nlmclnt, fd);
+        if (!fde)
                 goto ret;
+        fde_found = 1;
         transit_cnt = fde->transit_cnt;
         if (transit_cnt)
                 goto ret;
-        list_del (&fde->fde_list);
+        __nlm_fde_del (fde);
 
 ret:
         UNLOCK (&nlm_client_list_lk);
@@ -1193,36 +1529,18 @@ nlm_dec_transit_count (fd_t *fd, char *caller_name)
 {
         nlm_fde_t *fde = NULL;
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
-        int fde_found = 0;
         int transit_cnt = -1;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt,
-                             &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-
-        if (!nlmclnt_found) {
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt) {
                 gf_log (GF_NLM, GF_LOG_ERROR, "nlmclnt not found");
-                nlmclnt = NULL;
                 goto ret;
         }
 
-        list_for_each_entry (fde, &nlmclnt->fdes, fde_list) {
-                if (fde->fd == fd) {
-                        fde_found = 1;
-                        break;
-                }
-        }
-
-        if (fde_found) {
+        fde = __nlm_fde_find (nlmclnt, fd);
+        if (fde)
                 transit_cnt = --fde->transit_cnt;
-                goto ret;
-        }
 ret:
 
         UNLOCK (&nlm_client_list_lk);
@@ -1235,40 +1553,27 @@ nlm_search_and_add (fd_t *fd, char *caller_name)
 {
         nlm_fde_t *fde = NULL;
         nlm_client_t *nlmclnt = NULL;
-        int nlmclnt_found = 0;
-        int fde_found = 0;
 
         LOCK (&nlm_client_list_lk);
-        list_for_each_entry (nlmclnt,
-                             &nlm_client_list, nlm_clients) {
-                if (!strcmp(caller_name, nlmclnt->caller_name)) {
-                        nlmclnt_found = 1;
-                        break;
-                }
-        }
-
-        if (!nlmclnt_found) {
+        nlmclnt = __nlm_get_uniq (caller_name);
+        if (!nlmclnt) {
                 gf_log (GF_NLM, GF_LOG_ERROR, "nlmclnt not found");
-                nlmclnt = NULL;
                 goto ret;
         }
 
-        list_for_each_entry (fde, &nlmclnt->fdes, fde_list) {
-                if (fde->fd == fd) {
-                        fde_found = 1;
-                        break;
-                }
-        }
-
-        if (fde_found)
+        fde = __nlm_fde_find (nlmclnt, fd);
+        if (fde)
                 goto ret;
 
         fde = GF_CALLOC (1, sizeof (*fde), gf_nfs_mt_nlm4_fde);
+        if (!fde)
+                goto ret;
 
         fde->fd = fd_ref (fd);
         list_add (&fde->fde_list, &nlmclnt->fdes);
+        list_add (&fde->fde_hash, &nlmclnt->fde_table[nlm_fde_hash (fd)]);
 ret:
-        if (nlmclnt_found && fde)
+        if (nlmclnt && fde)
                 fde->transit_cnt++;
         UNLOCK (&nlm_client_list_lk);
         return nlmclnt;
@@ -1283,7 +1588,6 @@ nlm4svc_lock_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
         int                              transit_cnt = -1;
         char                            *caller_name = NULL;
         nfs3_call_state_t               *cs          = NULL;
-        pthread_t                        thr;
 
         cs = frame->local;
         caller_name = cs->args.nlm4_lockargs.alock.caller_name;
@@ -1296,10 +1600,8 @@ nlm4svc_lock_cbk (call_frame_t *frame, void *cookie, xlator_t *this,
                 goto err;
         } else {
                 stat = nlm4_granted;
-                if (cs->monitor && !nlm_monitor (caller_name)) {
-                        /* FIXME: handle nsm_monitor failure */
-                        pthread_create (&thr, NULL, nsm_monitor, (void*)caller_name);
-                }
+                if (cs->monitor && !nlm_monitor (caller_name))
+                        nsm_monitor (cs, caller_name);
         }
 
 err:
@@ -2346,6 +2648,7 @@ nlm4svc_init(xlator_t *nfsx)
         struct timeval timeout = {0,};
         FILE   *pidfile = NULL;
         pid_t   pid     = -1;
+        int     i       = 0;
 
         nfs = (struct nfs_state*)nfsx->private;
 
@@ -2398,7 +2701,11 @@ nlm4svc_init(xlator_t *nfsx)
                 goto err;
         }
         INIT_LIST_HEAD(&nlm_client_list);
+        for (i = 0; i < NLM_CLIENT_HASH_SIZE; i++)
+                INIT_LIST_HEAD (&nlm_client_table[i]);
         LOCK_INIT (&nlm_client_list_lk);
+        LOCK_INIT (&nsm_rpc_clnt_lk);
+        INIT_LIST_HEAD (&nsm_pending);
 
         /* unlink sm-notify.pid so that when we restart rpc.statd/sm-notify
          * it thinks that the machine has restarted and sends NOTIFY to clients.
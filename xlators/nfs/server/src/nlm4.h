@@ -53,6 +53,16 @@ nlm4_init_state (xlator_t *nfsx);
 #define NLM_PROGRAM 100021
 #define NLM_V4 4
 
+/* rpc.statd, asked to monitor the hosts holding locks */
+#define NSM_PROGRAM 100024
+#define NSM_V1 1
+#define NSM_MON 2
+#define NSM_PROC_COUNT 7
+
+/* clients are hashed on their caller_name, the fds of a client on the fd */
+#define NLM_CLIENT_HASH_SIZE 1024
+#define NLM_FDE_HASH_SIZE 64
+
 typedef struct nlm4_lwowner {
         char temp[1024];
 } nlm4_lkowner_t;
@@ -61,13 +71,21 @@ typedef struct nlm_client {
         struct sockaddr_storage sa;
         pid_t uniq;
         struct list_head nlm_clients;
+        struct list_head nlm_hash;
         struct list_head fdes;
+        struct list_head fde_table[NLM_FDE_HASH_SIZE];
         struct list_head shares;
         struct rpc_clnt *rpc_clnt;
         char *caller_name;
         int nsm_monitor;
 } nlm_client_t;
 
+/* an SM_MON waiting for the rpc-clnt to rpc.statd to connect */
+typedef struct nsm_pending {
+        struct list_head list;
+        char *host;
+} nsm_pending_t;
+
 typedef struct nlm_share {
         struct list_head     client_list;
         struct list_head     inode_list;
@@ -79,6 +97,7 @@ typedef struct nlm_share {
 
 typedef struct nlm_fde {
         struct list_head fde_list;
+        struct list_head fde_hash;
         fd_t *fd;
         int transit_cnt;
 } nlm_fde_t;
@@ -2593,6 +2593,18 @@ client_priv_dump (xlator_t *this)
 
                 gf_proc_dump_write("total_bytes_written", "%"PRIu64,
                                    conf->rpc->conn.trans->total_bytes_write);
+
+                gf_proc_dump_write("total_msgs_read", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_msgs_read);
+
+                gf_proc_dump_write("total_read_calls", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_read_calls);
+
+                gf_proc_dump_write("total_msgs_written", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_msgs_write);
+
+                gf_proc_dump_write("total_write_calls", "%"PRIu64,
+                                   conf->rpc->conn.trans->total_write_calls);
         }
         pthread_mutex_unlock(&conf->lock);
 
@@ -439,6 +439,7 @@ server_priv (xlator_t *this)
         char              key[GF_DUMP_MAX_BUF_LEN] = {0,};
         uint64_t          total_read = 0;
         uint64_t          total_write = 0;
+        int               count = 0;
         int32_t           ret  = -1;
 
         GF_VALIDATE_OR_GOTO ("server", this, out);
@@ -457,6 +458,29 @@ server_priv (xlator_t *this)
                 list_for_each_entry (xprt, &conf->xprt_list, list) {
                         total_read  += xprt->total_bytes_read;
                         total_write += xprt->total_bytes_write;
+
+                        /* syscalls per message, for each connection */
+                        gf_proc_dump_build_key (key, "server", "xprt%d.peer",
+                                                count);
+                        gf_proc_dump_write (key, "%s",
+                                            xprt->peerinfo.identifier);
+                        gf_proc_dump_build_key (key, "server",
+                                                "xprt%d.msgs-read", count);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            xprt->total_msgs_read);
+                        gf_proc_dump_build_key (key, "server",
+                                                "xprt%d.read-calls", count);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            xprt->total_read_calls);
+                        gf_proc_dump_build_key (key, "server",
+                                                "xprt%d.msgs-write", count);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            xprt->total_msgs_write);
+                        gf_proc_dump_build_key (key, "server",
+                                                "xprt%d.write-calls", count);
+                        gf_proc_dump_write (key, "%"PRIu64,
+                                            xprt->total_write_calls);
+                        count++;
                 }
         }
         pthread_mutex_unlock (&conf->mutex);
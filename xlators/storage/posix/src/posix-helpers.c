@@ -25,6 +25,10 @@
 
 #ifndef GF_BSD_HOST_OS
 #include <alloca.h>
+#include <sys/ioctl.h>
+#ifdef GF_LINUX_HOST_OS
+#include <linux/fs.h>
+#endif
 #endif /* GF_BSD_HOST_OS */
 
 #include "glusterfs.h"
@@ -1063,3 +1067,217 @@ posix_fd_ctx_get (fd_t *fd, xlator_t *this, struct posix_fd **pfd)
 
         return ret;
 }
+
+
+/* Copy the data of @src into @dst within the kernel, skipping holes. The
+   copy is done in chunks and gives up with -ETIMEDOUT once @deadline has
+   passed, so that it never outlives the request asking for it. */
+static int
+posix_copy_range (int src, int dst, off_t size, time_t deadline)
+{
+#ifdef HAVE_COPY_FILE_RANGE
+        off_t    pos  = 0;
+        off_t    data = 0;
+        off_t    hole = 0;
+        off_t    in   = 0;
+        off_t    out  = 0;
+        ssize_t  ret  = 0;
+#endif
+
+#ifdef FICLONE
+        /* sharing the extents is cheapest, where the filesystem can */
+        if (ioctl (dst, FICLONE, src) == 0)
+                return 0;
+#endif
+
+#ifndef HAVE_COPY_FILE_RANGE
+        return -ENOTSUP;
+#else
+        while (pos < size) {
+                data = pos;
+                hole = size;
+#ifdef SEEK_DATA
+                data = lseek (src, pos, SEEK_DATA);
+                if ((data == -1) && (errno == ENXIO))
+                        break; /* nothing but a hole left */
+                if (data == -1) {
+                        data = pos;
+                } else {
+                        hole = lseek (src, data, SEEK_HOLE);
+                        if ((hole == -1) || (hole > size))
+                                hole = size;
+                }
+#endif
+                in = out = data;
+                while (in < hole) {
+                        if (time (NULL) >= deadline)
+                                return -ETIMEDOUT;
+
+                        ret = copy_file_range (src, &in, dst, &out,
+                                               min (hole - in,
+                                                    POSIX_COPY_CHUNK_SIZE),
+                                               0);
+                        if (ret == -1)
+                                return -errno;
+                        if (ret == 0)
+                                return 0; /* @src shrank under us */
+                }
+                pos = hole;
+        }
+
+        return 0;
+#endif
+}
+
+/*
+ * Resolve @path, which must not be a symlink itself, to the real path of
+ * a file in a brick of the volume this brick belongs to: the first of its
+ * parent directories carrying a volume-id has to be a brick root with
+ * ours. Returns the resolved path, NULL when it is anywhere else.
+ */
+static char *
+posix_copy_to_path (xlator_t *this, const char *path)
+{
+        struct posix_private *priv   = NULL;
+        char                 *dir    = NULL;
+        char                 *real   = NULL;
+        char                 *rpath  = NULL;
+        char                 *tmp    = NULL;
+        const char           *name   = NULL;
+        uuid_t                ours   = {0,};
+        uuid_t                theirs = {0,};
+        ssize_t               size   = 0;
+
+        priv = this->private;
+
+        size = sys_lgetxattr (priv->base_path, GF_XATTR_VOL_ID_KEY, ours,
+                              sizeof (ours));
+        if (size != sizeof (ours))
+                return NULL;
+
+        name = strrchr (path, '/');
+        if (!name || (name == path) || !name[1] || !strcmp (name, "/..") ||
+            !strcmp (name, "/."))
+                return NULL;
+
+        dir = gf_strndup (path, name - path);
+        if (!dir)
+                return NULL;
+
+        real = realpath (dir, NULL);
+        GF_FREE (dir);
+        if (!real)
+                return NULL;
+
+        if (gf_asprintf (&rpath, "%s%s", real, name) < 0) {
+                rpath = NULL;
+                goto out;
+        }
+
+        /* walk up to the brick root, the resolved path has no symlinks */
+        for (;;) {
+                size = sys_lgetxattr (real, GF_XATTR_VOL_ID_KEY, theirs,
+                                      sizeof (theirs));
+                if (size == sizeof (theirs))
+                        break;
+
+                tmp = strrchr (real, '/');
+                if (!tmp || (tmp == real))
+                        break;
+                *tmp = '\0';
+        }
+
+        if ((size != sizeof (theirs)) || uuid_compare (ours, theirs)) {
+                GF_FREE (rpath);
+                rpath = NULL;
+        }
+out:
+        free (real);
+        return rpath;
+}
+
+/*
+ * Copy the data of the file open on @fd into the brick file named by
+ * GF_XATTR_COPY_TO_KEY in @dict, for rebalance when both bricks are on
+ * this host. The target has to be a regular file in a brick of the same
+ * volume, and the migration target of the same file, i.e. carry its gfid.
+ * The copy gives up after GF_XATTR_COPY_TO_TIMEOUT_KEY seconds, which the
+ * caller keeps below its frame-timeout. Returns 0 or -errno.
+ */
+int
+posix_copy_to (call_frame_t *frame, xlator_t *this, fd_t *fd, int src,
+               dict_t *dict)
+{
+        char        *path    = NULL;
+        char        *rpath   = NULL;
+        int          dst     = -1;
+        int          ret     = -1;
+        int32_t      timeout = POSIX_COPY_TO_TIMEOUT;
+        uuid_t       gfid    = {0,};
+        struct stat  stbuf   = {0,};
+
+        if (frame->root->pid != GF_CLIENT_PID_DEFRAG)
+                return -EPERM;
+
+        ret = dict_get_str (dict, GF_XATTR_COPY_TO_KEY, &path);
+        if (ret)
+                return -EINVAL;
+
+        if (!dict_get_int32 (dict, GF_XATTR_COPY_TO_TIMEOUT_KEY, &timeout) &&
+            (timeout <= 0))
+                return -EINVAL;
+
+        rpath = posix_copy_to_path (this, path);
+        if (!rpath) {
+                gf_log (this->name, GF_LOG_WARNING, "%s is not in a brick "
+                        "of this volume, not copying", path);
+                return -EPERM;
+        }
+
+        /* O_NONBLOCK keeps a fifo or a device from blocking the open */
+        dst = open (rpath, O_WRONLY|O_NOFOLLOW|O_NONBLOCK|O_LARGEFILE);
+        if (dst == -1) {
+                ret = -errno;
+                gf_log (this->name, GF_LOG_DEBUG, "open on %s failed: %s",
+                        rpath, strerror (errno));
+                goto out;
+        }
+
+        ret = fstat (dst, &stbuf);
+        if (ret == -1) {
+                ret = -errno;
+                goto out;
+        }
+
+        if (!S_ISREG (stbuf.st_mode)) {
+                gf_log (this->name, GF_LOG_WARNING, "%s is not a regular "
+                        "file, not copying", rpath);
+                ret = -EPERM;
+                goto out;
+        }
+
+        ret = sys_fgetxattr (dst, GFID_XATTR_KEY, gfid, sizeof (gfid));
+        if ((ret != sizeof (gfid)) || uuid_compare (gfid, fd->inode->gfid)) {
+                gf_log (this->name, GF_LOG_WARNING, "%s is not a copy of "
+                        "%s, not copying", rpath, uuid_utoa (fd->inode->gfid));
+                ret = -EPERM;
+                goto out;
+        }
+
+        ret = fstat (src, &stbuf);
+        if (ret == -1) {
+                ret = -errno;
+                goto out;
+        }
+
+        ret = posix_copy_range (src, dst, stbuf.st_size,
+                                time (NULL) + timeout);
+        if (ret)
+                gf_log (this->name, GF_LOG_DEBUG, "copy to %s failed: %s",
+                        rpath, strerror (-ret));
+out:
+        if (dst != -1)
+                close (dst);
+        GF_FREE (rpath);
+        return ret;
+}
@@ -2948,6 +2948,15 @@ posix_fsetxattr (call_frame_t *frame, xlator_t *this,
         }
         _fd = pfd->fd;
 
+        if (dict_get (dict, GF_XATTR_COPY_TO_KEY)) {
+                op_ret = posix_copy_to (frame, this, fd, _fd, dict);
+                if (op_ret < 0) {
+                        op_errno = -op_ret;
+                        op_ret = -1;
+                }
+                goto out;
+        }
+
         dict_del (dict, GFID_XATTR_KEY);
 
         filler.fd = _fd;
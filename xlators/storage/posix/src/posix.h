@@ -143,6 +143,11 @@ typedef struct {
 
 #define POSIX_BASE_PATH_LEN(this) (((struct posix_private *)this->private)->base_path_length)
 
+/* brick-local copies for rebalance: bytes per copy_file_range() call, and
+   seconds allowed when the request does not say */
+#define POSIX_COPY_CHUNK_SIZE (64 * GF_UNIT_MB)
+#define POSIX_COPY_TO_TIMEOUT 900
+
 /* Helper functions */
 int posix_gfid_set (xlator_t *this, const char *path, loc_t *loc,
                     dict_t *xattr_req);
@@ -168,6 +173,8 @@ int posix_entry_create_xattr_set (xlator_t *this, const char *path,
                                   dict_t *dict);
 
 int posix_fd_ctx_get (fd_t *fd, xlator_t *this, struct posix_fd **pfd);
+int posix_copy_to (call_frame_t *frame, xlator_t *this, fd_t *fd, int src,
+                   dict_t *dict);
 void posix_fill_ino_from_gfid (xlator_t *this, struct iatt *buf);
 
 gf_boolean_t posix_special_xattr (char **pattern, char *key);